@@ -0,0 +1,86 @@
+// Ambient occlusion bake passes in rays per second on a bumpy sphere of
+// about 40k vertices, on one thread and on the shared pool, with the time
+// a full bake of the app's 256 samples would take.
+
+#include "AmbientOcclusion.h"
+#include "Benchmark.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Bumps deep enough that most vertices are partly occluded.
+	void MakeSphere(std::uint32_t rings, std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+	{
+		for (std::uint32_t i = 0; i <= rings; ++i)
+			for (std::uint32_t j = 0; j < rings; ++j)
+			{
+				float theta = XM_PI * i / rings;
+				float phi = XM_2PI * j / rings;
+				float r = 1.0f + 0.2f * std::sin(9.0f * theta) * std::cos(7.0f * phi);
+				positions.push_back(XMFLOAT3(r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi)));
+			}
+
+		// Wrapping around in phi, so there is no seam to open up.
+		for (std::uint32_t i = 0; i < rings; ++i)
+			for (std::uint32_t j = 0; j < rings; ++j)
+			{
+				std::uint32_t a = i * rings + j;
+				std::uint32_t b = i * rings + (j + 1) % rings;
+				std::uint32_t quad[6] = { a, a + rings, b, b, a + rings, b + rings };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("AmbientOcclusion", argc, argv);
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<std::uint32_t> indices;
+	MakeSphere(suite.Quick() ? 60 : 200, positions, indices);
+	std::uint32_t vertexCount = (std::uint32_t)positions.size();
+	std::uint32_t triangleCount = (std::uint32_t)indices.size() / 3;
+
+	Bvh bvh;
+	bvh.Build(positions.data(), (std::uint32_t)sizeof(XMFLOAT3), indices.data(), triangleCount);
+
+	// A pass of 4 samples, as the app's background bake traces.
+	const std::uint32_t samples = 4;
+	const std::uint32_t fullBake = 256;
+
+	ThreadPool serial(0);
+	ThreadPool* const pools[] = { &serial, &ThreadPool::Get() };
+	const char* const names[] = { "Trace/1 thread", "Trace/pool" };
+
+	for (int p = 0; p < 2; ++p)
+	{
+		AmbientOcclusionBaker baker;
+		baker.Begin(positions.data(), (std::uint32_t)sizeof(XMFLOAT3), vertexCount, indices.data(), triangleCount, bvh, 0.3f, 1);
+
+		const BenchmarkResult& result = suite.Run(names[p], "rays", [&]()
+		{
+			baker.Trace(samples, *pools[p]);
+			return (std::uint64_t)samples * vertexCount;
+		});
+		if (!result.Items)
+			continue;
+
+		std::vector<float> visibility(vertexCount);
+		baker.Resolve(visibility.data());
+		double mean = 0.0;
+		for (float v : visibility)
+			mean += v;
+
+		suite.AddMetric("mrays_per_second", result.ItemsPerSecond * 1e-6);
+		suite.AddMetric("full_bake_seconds", (double)fullBake * vertexCount / result.ItemsPerSecond);
+		suite.AddMetric("mean_visibility", mean / vertexCount);
+	}
+
+	return suite.Finish();
+}
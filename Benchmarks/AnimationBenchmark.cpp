@@ -0,0 +1,121 @@
+// Playback of many animated characters: each samples its clip, builds its
+// palette and skins its mesh every frame.
+
+#include "Animation.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t JointCount = 60;
+	const std::uint32_t VertexCount = 4000;
+
+	struct Vertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT4 Color;
+		XMFLOAT2 TexC;
+	};
+
+	BoneTransform Bone(float angle, float length)
+	{
+		BoneTransform bone;
+		bone.Rotation = XMFLOAT4A(std::sin(0.5f * angle), 0.0f, 0.0f, std::cos(0.5f * angle));
+		bone.Translation = XMFLOAT4A(0.0f, length, 0.0f, 0.0f);
+		bone.Scale = XMFLOAT4A(1.0f, 1.0f, 1.0f, 0.0f);
+		return bone;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Animation", argc, argv);
+	std::mt19937 random(32);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// A branching skeleton and a two-second clip at 30 Hz.
+	Skeleton skeleton;
+	for (std::uint32_t j = 0; j < JointCount; ++j)
+	{
+		skeleton.Parents.push_back(j == 0 ? -1 : (std::int32_t)(j - 1 - random() % std::min<std::uint32_t>(j, 4)));
+		skeleton.BindPose.push_back(Bone(0.0f, 0.1f));
+
+		XMFLOAT4X4A identity;
+		XMStoreFloat4x4A(&identity, XMMatrixIdentity());
+		skeleton.InverseBindPose.push_back(identity);
+	}
+
+	AnimationClip clip;
+	clip.Name = "Walk";
+	clip.SampleRate = 30.0f;
+	clip.FrameCount = 61;
+	clip.Duration = 2.0f;
+	clip.JointCount = JointCount;
+	for (std::uint32_t f = 0; f < clip.FrameCount; ++f)
+		for (std::uint32_t j = 0; j < JointCount; ++j)
+			clip.Keys.push_back(Bone(0.5f * std::sin(0.2f * f + j), 0.1f));
+
+	std::vector<XMFLOAT3> bind(VertexCount);
+	std::vector<SkinInfluence> influences(VertexCount);
+	for (std::uint32_t i = 0; i < VertexCount; ++i)
+	{
+		bind[i] = XMFLOAT3(unit(random), unit(random) * 6.0f, unit(random));
+		influences[i] = SkinInfluence();
+		for (int k = 0; k < 4; ++k)
+			Animator::AddInfluence(influences[i], (std::uint16_t)(random() % JointCount), unit(random));
+		Animator::NormalizeInfluence(influences[i]);
+	}
+
+	for (std::uint32_t characters : { 100u, 300u })
+	{
+		std::vector<Animator> animators(characters);
+		for (Animator& animator : animators)
+			animator.SetSkeleton(&skeleton);
+		std::vector<Vertex> vertices((size_t)characters * VertexCount);
+
+		float time = 0.0f;
+		suite.Run("Playback/" + std::to_string(characters) + " characters", "characters", [&]()
+		{
+			time += 1.0f / 60.0f;
+			for (std::uint32_t c = 0; c < characters; ++c)
+			{
+				Animator& animator = animators[c];
+				animator.Sample(clip, time + 0.01f * c, true);
+				animator.BuildPalette();
+				animator.Skin(bind.data(), influences.data(), VertexCount, &vertices[(size_t)c * VertexCount].Pos, (std::uint32_t)sizeof(Vertex));
+			}
+			return characters;
+		});
+	}
+
+	// The kernels alone, for one character.
+	std::vector<BoneTransform> pose(JointCount);
+	suite.Run("SampleClip", "joints", [&]()
+	{
+		Animator::SampleClip(clip, 0.77f, true, pose.data());
+		return JointCount;
+	});
+
+	std::vector<XMFLOAT4X4A> modelSpace(JointCount), palette(JointCount);
+	suite.Run("BuildMatrixPalette", "joints", [&]()
+	{
+		Animator::BuildMatrixPalette(skeleton, pose.data(), modelSpace.data(), palette.data());
+		return JointCount;
+	});
+
+	std::vector<Vertex> vertices(VertexCount);
+	suite.Run("SkinPositions", "vertices", [&]()
+	{
+		Animator::SkinPositions(palette.data(), bind.data(), influences.data(), VertexCount, &vertices[0].Pos, (std::uint32_t)sizeof(Vertex));
+		return VertexCount;
+	});
+
+	return suite.Finish();
+}
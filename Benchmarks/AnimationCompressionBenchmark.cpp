@@ -0,0 +1,114 @@
+// CompressedClip decode throughput in bones per microsecond, playing
+// forward and seeking at random, next to the raw clip's sampler, with the
+// compression ratio and error of each clip.
+
+#include "AnimationCompression.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	AnimationClip MakeClip(std::uint32_t jointCount, std::uint32_t frameCount, float motion)
+	{
+		AnimationClip clip;
+		clip.Name = "Clip";
+		clip.SampleRate = 30.0f;
+		clip.FrameCount = frameCount;
+		clip.JointCount = jointCount;
+		clip.Duration = (frameCount - 1) / clip.SampleRate;
+
+		for (std::uint32_t f = 0; f < frameCount; ++f)
+		{
+			float t = f / clip.SampleRate;
+			for (std::uint32_t j = 0; j < jointCount; ++j)
+			{
+				// A third of the joints hold still.
+				float angle = j % 3 == 0 ? 0.4f : motion * std::sin((0.5f + 0.1f * j) * t + j);
+
+				BoneTransform bone;
+				bone.Rotation = XMFLOAT4A(std::sin(0.5f * angle), 0.0f, 0.0f, std::cos(0.5f * angle));
+				bone.Translation = XMFLOAT4A(j == 0 ? motion * std::sin(t) : 0.0f, 0.1f, 0.0f, 0.0f);
+				bone.Scale = XMFLOAT4A(1.0f, 1.0f, 1.0f, 0.0f);
+				clip.Keys.push_back(bone);
+			}
+		}
+
+		return clip;
+	}
+
+	double BonesPerMicrosecond(const BenchmarkResult& result)
+	{
+		return result.ItemsPerSecond * 1e-6;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("AnimationCompression", argc, argv);
+	const CompressionSettings settings = { 0.001f, 0.001f, 0.0001f };
+	const std::uint32_t samples = 1000;
+
+	struct Case
+	{
+		const char* Name;
+		std::uint32_t Joints;
+		std::uint32_t Frames;
+		float Motion;
+	};
+	const Case cases[] = { { "60 joints, 4 s, gentle", 60, 121, 0.3f }, { "60 joints, 4 s, wild", 60, 121, 2.0f },
+		{ "120 joints, 20 s", 120, 601, 0.8f } };
+
+	for (const Case& c : cases)
+	{
+		AnimationClip clip = MakeClip(c.Joints, c.Frames, c.Motion);
+		CompressedClip compressed;
+		CompressionStats stats = compressed.Compress(clip, settings);
+
+		std::vector<BoneTransform> pose(c.Joints);
+		std::vector<float> times(samples);
+		std::mt19937 random(33);
+		std::uniform_real_distribution<float> time(0.0f, clip.Duration);
+		for (float& t : times)
+			t = time(random);
+
+		const BenchmarkResult& forward = suite.Run(std::string("Decode forward/") + c.Name, "bones", [&]()
+		{
+			for (std::uint32_t i = 0; i < samples; ++i)
+				compressed.Sample(clip.Duration * i / samples, true, pose.data());
+			return (std::uint64_t)samples * c.Joints;
+		});
+		if (forward.Items)
+		{
+			suite.AddMetric("bones_per_us", BonesPerMicrosecond(forward));
+			suite.AddMetric("compression_ratio", stats.Ratio);
+			suite.AddMetric("max_rotation_error", stats.MaxRotationError);
+			suite.AddMetric("max_translation_error", stats.MaxTranslationError);
+		}
+
+		const BenchmarkResult& seek = suite.Run(std::string("Decode random/") + c.Name, "bones", [&]()
+		{
+			for (float t : times)
+				compressed.Sample(t, true, pose.data());
+			return (std::uint64_t)samples * c.Joints;
+		});
+		if (seek.Items)
+			suite.AddMetric("bones_per_us", BonesPerMicrosecond(seek));
+
+		const BenchmarkResult& raw = suite.Run(std::string("Raw random/") + c.Name, "bones", [&]()
+		{
+			for (float t : times)
+				Animator::SampleClip(clip, t, true, pose.data());
+			return (std::uint64_t)samples * c.Joints;
+		});
+		if (raw.Items)
+			suite.AddMetric("bones_per_us", BonesPerMicrosecond(raw));
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,66 @@
+// TextureAtlas::Pack on thousands of rects, in rects per second, with the
+// share of the atlas the images cover.  Sizes mix the powers of two most
+// textures come in with arbitrary ones, and pack both with the app's
+// gutter and alignment and with the tightest that still keeps BC blocks
+// apart.
+
+#include "Benchmark.h"
+#include "TextureAtlas.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Atlas", argc, argv);
+
+	std::vector<std::uint32_t> counts = { 1000, 4000 };
+	if (!suite.Quick())
+		counts.push_back(16000);
+
+	struct Layout
+	{
+		const char* Name;
+		std::uint32_t Gutter;
+		std::uint32_t Alignment;
+	};
+	const Layout layouts[] = { { "App", 8, 16 }, { "Tight", 1, 4 } };
+
+	std::mt19937 random(23);
+	std::uniform_int_distribution<std::uint32_t> power(3, 8);
+	std::uniform_int_distribution<std::uint32_t> size(8, 256);
+
+	for (std::uint32_t count : counts)
+	{
+		std::vector<AtlasRect> rects(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			bool pot = i % 3 != 0;
+			rects[i].Width = pot ? 1u << power(random) : size(random);
+			rects[i].Height = pot ? 1u << power(random) : size(random);
+		}
+
+		for (const Layout& layout : layouts)
+		{
+			std::uint32_t width = 0;
+			std::uint32_t height = 0;
+			bool packed = true;
+			const BenchmarkResult& result = suite.Run(std::string("Pack/") + layout.Name + "/" + std::to_string(count), "rects", [&]()
+			{
+				packed = TextureAtlas::Pack(rects, layout.Gutter, layout.Alignment, 1u << 16, width, height) && packed;
+				return (std::uint64_t)count;
+			});
+			if (!packed)
+				suite.Fail(std::to_string(count) + " rects did not fit");
+			if (result.Items && packed)
+			{
+				suite.AddMetric("ms_per_pack", 1e3 * count / result.ItemsPerSecond);
+				suite.AddMetric("occupied", TextureAtlas::Efficiency(rects, width, height));
+				suite.AddMetric("atlas_side", width);
+			}
+		}
+	}
+
+	return suite.Finish();
+}
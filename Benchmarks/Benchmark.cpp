@@ -0,0 +1,217 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	std::atomic<std::uint64_t> gAllocatedBytes(0);
+	std::atomic<std::uint64_t> gAllocationCount(0);
+
+	void* Allocate(std::size_t size)
+	{
+		gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+
+	// JSON strings here are benchmark names, so only quotes and
+	// backslashes need escaping.
+	void WriteString(FILE* file, const std::string& text)
+	{
+		std::fputc('"', file);
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				std::fputc('\\', file);
+			std::fputc(c, file);
+		}
+		std::fputc('"', file);
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	if (void* p = Allocate(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+AllocationCounters CurrentAllocations()
+{
+	AllocationCounters counters;
+	counters.Bytes = gAllocatedBytes.load(std::memory_order_relaxed);
+	counters.Count = gAllocationCount.load(std::memory_order_relaxed);
+	return counters;
+}
+
+std::uint64_t PeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (std::uint64_t)usage.ru_maxrss;
+#else
+	return (std::uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+BenchmarkSuite::BenchmarkSuite(const char* name, int argc, char** argv)
+	: mName(name)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			mJsonPath = argv[++i];
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			mFilter = argv[++i];
+		else if (std::strcmp(argv[i], "--quick") == 0)
+			mQuick = true;
+		else
+			std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+	}
+
+	std::printf("%-40s %14s %12s %21s %12s %10s\n", mName.c_str(), "median", "fastest", "items/s", "bytes", "allocs");
+}
+
+bool BenchmarkSuite::Quick()const
+{
+	return mQuick;
+}
+
+bool BenchmarkSuite::Selected(const std::string& name)const
+{
+	return mFilter.empty() || name.find(mFilter) != std::string::npos;
+}
+
+BenchmarkResult& BenchmarkSuite::Add(BenchmarkResult result, std::vector<double>& seconds)
+{
+	std::sort(seconds.begin(), seconds.end());
+
+	result.Iterations = (std::uint32_t)seconds.size();
+	result.MinSeconds = seconds.front();
+	result.MedianSeconds = seconds[seconds.size() / 2];
+	result.ItemsPerSecond = result.MedianSeconds > 0.0 ? result.Items / result.MedianSeconds : 0.0;
+	result.PeakRssBytes = PeakResidentBytes();
+	mLastSkipped = false;
+
+	std::printf("%-40s %11.3f ms %9.3f ms %12.4g %-8s %12llu %10llu\n", result.Name.c_str(), 1000.0 * result.MedianSeconds,
+		1000.0 * result.MinSeconds, result.ItemsPerSecond, result.Unit.c_str(),
+		(unsigned long long)result.BytesAllocated, (unsigned long long)result.Allocations);
+
+	mResults.push_back(result);
+	return mResults.back();
+}
+
+void BenchmarkSuite::AddMetric(const char* name, double value)
+{
+	if (mLastSkipped || mResults.empty())
+		return;
+
+	mResults.back().Metrics.push_back(std::make_pair(std::string(name), value));
+	std::printf("%-40s %s = %g\n", "", name, value);
+}
+
+void BenchmarkSuite::Fail(const std::string& message)
+{
+	std::fprintf(stderr, "FAILED: %s\n", message.c_str());
+	mFailed = true;
+}
+
+int BenchmarkSuite::Finish()
+{
+	if (!mJsonPath.empty())
+	{
+		FILE* file = std::fopen(mJsonPath.c_str(), "w");
+		if (!file)
+		{
+			std::fprintf(stderr, "Cannot write %s\n", mJsonPath.c_str());
+			return 1;
+		}
+
+		std::fprintf(file, "{\n  \"suite\": ");
+		WriteString(file, mName);
+		std::fprintf(file, ",\n  \"peak_rss_bytes\": %llu,\n  \"benchmarks\": [", (unsigned long long)PeakResidentBytes());
+
+		for (size_t i = 0; i < mResults.size(); ++i)
+		{
+			const BenchmarkResult& r = mResults[i];
+
+			std::fprintf(file, "%s\n    {\"name\": ", i ? "," : "");
+			WriteString(file, r.Name);
+			std::fprintf(file, ", \"unit\": ");
+			WriteString(file, r.Unit);
+			std::fprintf(file, ", \"items\": %llu, \"iterations\": %u, \"min_seconds\": %.9g, \"median_seconds\": %.9g, "
+				"\"items_per_second\": %.9g, \"bytes_allocated\": %llu, \"allocations\": %llu, \"peak_rss_bytes\": %llu",
+				(unsigned long long)r.Items, r.Iterations, r.MinSeconds, r.MedianSeconds, r.ItemsPerSecond,
+				(unsigned long long)r.BytesAllocated, (unsigned long long)r.Allocations, (unsigned long long)r.PeakRssBytes);
+
+			std::fprintf(file, ", \"metrics\": {");
+			for (size_t m = 0; m < r.Metrics.size(); ++m)
+			{
+				std::fprintf(file, "%s", m ? ", " : "");
+				WriteString(file, r.Metrics[m].first);
+				std::fprintf(file, ": %.9g", r.Metrics[m].second);
+			}
+			std::fprintf(file, "}}");
+		}
+
+		std::fprintf(file, "\n  ]\n}\n");
+		std::fclose(file);
+	}
+
+	return mFailed ? 1 : 0;
+}
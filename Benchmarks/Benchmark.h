@@ -0,0 +1,143 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// A small harness for the benchmark executables.
+//
+//   int main(int argc, char** argv)
+//   {
+//       BenchmarkSuite suite("Geometry", argc, argv);
+//       suite.Run("CreateSphere/64x64", "vertices", [&]() { ...; return vertexCount; });
+//       return suite.Finish();
+//   }
+//
+// Each benchmark body runs once to warm up, then repeatedly until a time
+// budget is spent, and returns how many items it processed.  The suite
+// reports the fastest and median iteration, items per second, the bytes
+// and allocations one iteration makes, and the process's peak resident set
+// so far.  With --json <path> the results are also written as JSON, which
+// Tools/compare_benchmarks.py compares against a baseline.  --quick runs
+// every benchmark only a few times, for smoke runs under ctest, and
+// --filter <text> runs only the benchmarks whose names contain text.
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchmarkResult
+{
+	std::string Name;
+	std::string Unit;
+	std::uint64_t Items = 0;
+	std::uint32_t Iterations = 0;
+	double MinSeconds = 0.0;
+	double MedianSeconds = 0.0;
+	double ItemsPerSecond = 0.0;
+	std::uint64_t BytesAllocated = 0;
+	std::uint64_t Allocations = 0;
+	std::uint64_t PeakRssBytes = 0;
+
+	// Figures particular to the benchmark, such as an error or a ratio.
+	std::vector<std::pair<std::string, double>> Metrics;
+};
+
+// Allocations made so far by operator new, on any thread.
+struct AllocationCounters
+{
+	std::uint64_t Bytes;
+	std::uint64_t Count;
+};
+AllocationCounters CurrentAllocations();
+
+// The process's peak resident set so far, in bytes, or 0 where unknown.
+std::uint64_t PeakResidentBytes();
+
+// Keeps the compiler from optimising away a result.
+template<class T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+class BenchmarkSuite
+{
+public:
+	BenchmarkSuite(const char* name, int argc, char** argv);
+
+	bool Quick()const;
+
+	// Runs body as described above.
+	template<class Body>
+	BenchmarkResult& Run(const std::string& name, const char* unit, Body body);
+
+	// Adds a figure to the result of the last Run.
+	void AddMetric(const char* name, double value);
+
+	// Records a failed expectation; Finish then returns nonzero.
+	void Fail(const std::string& message);
+
+	// Writes the JSON, if asked for, and returns the exit code.
+	int Finish();
+
+private:
+	bool Selected(const std::string& name)const;
+	BenchmarkResult& Add(BenchmarkResult result, std::vector<double>& seconds);
+
+	std::string mName;
+	std::string mJsonPath;
+	std::string mFilter;
+	bool mQuick = false;
+	bool mFailed = false;
+	bool mLastSkipped = false;
+	double mBudgetSeconds = 0.25;
+	std::vector<BenchmarkResult> mResults;
+	BenchmarkResult mSkipped;
+};
+
+template<class Body>
+BenchmarkResult& BenchmarkSuite::Run(const std::string& name, const char* unit, Body body)
+{
+	if (!Selected(name))
+	{
+		mLastSkipped = true;
+		return mSkipped = BenchmarkResult();
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	BenchmarkResult result;
+	result.Name = name;
+	result.Unit = unit;
+
+	// Warm up, and count what one iteration allocates.
+	AllocationCounters before = CurrentAllocations();
+	result.Items = body();
+	AllocationCounters after = CurrentAllocations();
+	result.BytesAllocated = after.Bytes - before.Bytes;
+	result.Allocations = after.Count - before.Count;
+
+	std::vector<double> seconds;
+	std::uint32_t minIterations = mQuick ? 1 : 5;
+	std::uint32_t maxIterations = mQuick ? 3 : 1000;
+	double spent = 0.0;
+
+	while (seconds.size() < maxIterations && (seconds.size() < minIterations || spent < mBudgetSeconds))
+	{
+		Clock::time_point start = Clock::now();
+		DoNotOptimize(body());
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		seconds.push_back(elapsed);
+		spent += elapsed;
+	}
+
+	return Add(result, seconds);
+}
+
+#endif // BENCHMARK_H
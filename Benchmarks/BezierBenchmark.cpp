@@ -0,0 +1,106 @@
+// BezierSurface::Update in patches per ms, on the app's torus of 16 patches
+// and on a field of copies of it.  The eye moves between near and far
+// every iteration, so every patch's factors change and it is retessellated;
+// an eye that stays put measures choosing factors alone.
+
+#include "Benchmark.h"
+#include "BezierSurface.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The app's torus, copies side by side on a square grid, each four
+	// patches around each way sharing control points along their edges.
+	void MakeTori(std::uint32_t side, std::vector<XMFLOAT3>& points, std::vector<std::uint32_t>& patches)
+	{
+		const float k = 0.5522847f;
+		const float majorRadius = 1.0f;
+		const float minorRadius = 0.4f;
+
+		XMFLOAT2 circle[12];
+		for (std::uint32_t q = 0; q < 4; ++q)
+		{
+			XMFLOAT2 c = q == 0 ? XMFLOAT2(1.0f, 0.0f) : q == 1 ? XMFLOAT2(0.0f, 1.0f) : q == 2 ? XMFLOAT2(-1.0f, 0.0f) : XMFLOAT2(0.0f, -1.0f);
+			XMFLOAT2 n(-c.y, c.x);
+			circle[3 * q] = c;
+			circle[3 * q + 1] = XMFLOAT2(c.x + k * n.x, c.y + k * n.y);
+			circle[3 * q + 2] = XMFLOAT2(n.x + k * c.x, n.y + k * c.y);
+		}
+
+		for (std::uint32_t tz = 0; tz < side; ++tz)
+			for (std::uint32_t tx = 0; tx < side; ++tx)
+			{
+				const std::uint32_t base = (std::uint32_t)points.size();
+				const float offsetX = 3.0f * tx;
+				const float offsetZ = 3.0f * tz;
+				for (std::uint32_t j = 0; j < 12; ++j)
+				{
+					float radius = majorRadius + minorRadius * circle[j].x;
+					for (std::uint32_t i = 0; i < 12; ++i)
+						points.push_back(XMFLOAT3(offsetX + radius * circle[i].x, minorRadius * circle[j].y, offsetZ - radius * circle[i].y));
+				}
+
+				for (std::uint32_t b = 0; b < 4; ++b)
+					for (std::uint32_t a = 0; a < 4; ++a)
+						for (std::uint32_t r = 0; r < 4; ++r)
+							for (std::uint32_t c = 0; c < 4; ++c)
+								patches.push_back(base + (3 * b + r) % 12 * 12 + (3 * a + c) % 12);
+			}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Bezier", argc, argv);
+
+	// As at the app's 1080-pixel window and 1-pixel error.
+	const float pixelScale = 1080.0f * 0.5f / 0.41421356f;
+	const float pixelError = 1.0f;
+
+	std::vector<std::uint32_t> sides = { 1, 8 };
+	if (!suite.Quick())
+		sides.push_back(32);
+
+	for (std::uint32_t side : sides)
+	{
+		std::vector<XMFLOAT3> points;
+		std::vector<std::uint32_t> patches;
+		MakeTori(side, points, patches);
+
+		BezierSurface surface;
+		surface.Create(points.data(), (std::uint32_t)points.size(), patches.data(), (std::uint32_t)patches.size() / 16);
+		const std::string name = std::to_string(surface.PatchCount()) + "patches";
+
+		// From above the middle of the field, near enough for fine
+		// factors and then far enough for coarse ones.
+		const float middle = 1.5f * (side - 1);
+		const XMVECTOR eyes[] = { XMVectorSet(middle, 4.0f, middle, 1.0f), XMVectorSet(middle, 40.0f, middle, 1.0f) };
+		std::uint32_t next = 0;
+
+		const BenchmarkResult& changing = suite.Run("Update/Retessellate/" + name, "patches", [&]()
+		{
+			surface.Update(eyes[next], pixelScale, pixelError);
+			next ^= 1;
+			return (std::uint64_t)surface.ChangedPatches().size();
+		});
+		if (changing.Items)
+		{
+			suite.AddMetric("patches_per_ms", changing.ItemsPerSecond / 1e3);
+			suite.AddMetric("triangles", (double)surface.TriangleCount());
+		}
+
+		const BenchmarkResult& still = suite.Run("Update/Unchanged/" + name, "patches", [&]()
+		{
+			surface.Update(eyes[0], pixelScale, pixelError);
+			return (std::uint64_t)surface.PatchCount();
+		});
+		if (still.Items)
+			suite.AddMetric("patches_per_ms", still.ItemsPerSecond / 1e3);
+	}
+
+	return suite.Finish();
+}
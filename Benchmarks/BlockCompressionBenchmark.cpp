@@ -0,0 +1,44 @@
+// Block compression of the shipped texture in megapixels per second, with
+// the quality each format reaches on it.
+
+#include "Benchmark.h"
+#include "BlockCompression.h"
+#include "Texture.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("BlockCompression", argc, argv);
+
+	TextureImage image;
+	if (!TgaLoader::Load(RESOURCE_DIR "/ao_twinte_chan/ao_twinte_chan640x640.tga", image))
+	{
+		suite.Fail("Could not load the shipped texture");
+		return suite.Finish();
+	}
+
+	const BlockCompressor::Format formats[] = { BlockCompressor::BC1, BlockCompressor::BC3, BlockCompressor::BC7 };
+	const char* const names[] = { "BC1", "BC3", "BC7" };
+	std::vector<std::uint8_t> blocks;
+
+	for (int f = 0; f < 3; ++f)
+	{
+		const BenchmarkResult& result = suite.Run(std::string("Encode/") + names[f] + " 640x640", "pixels", [&]()
+		{
+			BlockCompressor::Encode(image, formats[f], blocks);
+			return (std::uint64_t)image.Width * image.Height;
+		});
+		if (!result.Items)
+			continue;
+
+		TextureImage decoded;
+		BlockCompressor::Decode(blocks.data(), blocks.size(), formats[f], image.Width, image.Height, decoded);
+		suite.AddMetric("megapixels_per_second", result.ItemsPerSecond * 1e-6);
+		suite.AddMetric("psnr_rgb_db", BlockCompressor::Psnr(image, decoded, false));
+		suite.AddMetric("psnr_rgba_db", BlockCompressor::Psnr(image, decoded, true));
+	}
+
+	return suite.Finish();
+}
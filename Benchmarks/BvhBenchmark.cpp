@@ -0,0 +1,143 @@
+// Bvh build time and ray throughput on a bumpy sphere of about 180k
+// triangles, the size of a decimated scan, with brute force for scale.
+
+#include "Benchmark.h"
+#include "Bvh.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	void MakeSphere(std::uint32_t rings, std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+	{
+		for (std::uint32_t i = 0; i <= rings; ++i)
+			for (std::uint32_t j = 0; j <= rings; ++j)
+			{
+				float theta = XM_PI * i / rings;
+				float phi = XM_2PI * j / rings;
+				float r = 1.0f + 0.1f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+				positions.push_back(XMFLOAT3(r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi)));
+			}
+
+		for (std::uint32_t i = 0; i < rings; ++i)
+			for (std::uint32_t j = 0; j < rings; ++j)
+			{
+				std::uint32_t a = i * (rings + 1) + j;
+				std::uint32_t c = a + rings + 1;
+				std::uint32_t quad[6] = { a, c, a + 1, a + 1, c, c + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+	}
+
+	// One Moller-Trumbore test per triangle, as picking did before the Bvh.
+	bool BruteForce(const std::vector<XMFLOAT3>& positions, const std::vector<std::uint32_t>& indices, FXMVECTOR origin,
+		FXMVECTOR direction, float& nearest)
+	{
+		nearest = FLT_MAX;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&positions[indices[t]]);
+			XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&positions[indices[t + 1]]), a);
+			XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&positions[indices[t + 2]]), a);
+			XMVECTOR p = XMVector3Cross(direction, e2);
+			float det = XMVectorGetX(XMVector3Dot(e1, p));
+			if (det == 0.0f)
+				continue;
+
+			float inverse = 1.0f / det;
+			XMVECTOR s = XMVectorSubtract(origin, a);
+			float u = XMVectorGetX(XMVector3Dot(s, p)) * inverse;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			XMVECTOR q = XMVector3Cross(s, e1);
+			float v = XMVectorGetX(XMVector3Dot(direction, q)) * inverse;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float distance = XMVectorGetX(XMVector3Dot(e2, q)) * inverse;
+			if (distance >= 0.0f && distance < nearest)
+				nearest = distance;
+		}
+		return nearest < FLT_MAX;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Bvh", argc, argv);
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<std::uint32_t> indices;
+	MakeSphere(suite.Quick() ? 100 : 300, positions, indices);
+	std::uint32_t triangleCount = (std::uint32_t)indices.size() / 3;
+
+	Bvh bvh;
+	const BenchmarkResult& build = suite.Run("Build", "triangles", [&]()
+	{
+		bvh.Build(positions.data(), (std::uint32_t)sizeof(XMFLOAT3), indices.data(), triangleCount);
+		return (std::uint64_t)triangleCount;
+	});
+	if (build.Items)
+	{
+		suite.AddMetric("build_ms", build.MedianSeconds * 1e3);
+		suite.AddMetric("bytes_per_triangle", (double)bvh.SizeInBytes() / triangleCount);
+	}
+
+	// Rays from a shell around the mesh to points near its middle, about
+	// as many hitting as missing the bumps.
+	const std::uint32_t rayCount = 4096;
+	std::vector<XMFLOAT3> origins(rayCount);
+	std::vector<XMFLOAT3> directions(rayCount);
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+	for (std::uint32_t i = 0; i < rayCount; ++i)
+	{
+		XMVECTOR origin = XMVectorScale(XMVector3Normalize(XMVectorSet(spread(random), spread(random), spread(random), 0.0f)), 3.0f);
+		XMVECTOR target = XMVectorSet(1.2f * spread(random), 1.2f * spread(random), 1.2f * spread(random), 0.0f);
+		XMStoreFloat3(&origins[i], origin);
+		XMStoreFloat3(&directions[i], XMVectorSubtract(target, origin));
+	}
+
+	std::uint64_t hits = 0;
+	const BenchmarkResult& closest = suite.Run("Intersect", "rays", [&]()
+	{
+		for (std::uint32_t i = 0; i < rayCount; ++i)
+		{
+			BvhHit hit;
+			hits += bvh.Intersect(XMLoadFloat3(&origins[i]), XMLoadFloat3(&directions[i]), FLT_MAX, hit);
+		}
+		return (std::uint64_t)rayCount;
+	});
+	if (closest.Items)
+		suite.AddMetric("mrays_per_second", closest.ItemsPerSecond * 1e-6);
+
+	const BenchmarkResult& any = suite.Run("Occluded", "rays", [&]()
+	{
+		for (std::uint32_t i = 0; i < rayCount; ++i)
+			hits += bvh.Occluded(XMLoadFloat3(&origins[i]), XMLoadFloat3(&directions[i]), FLT_MAX);
+		return (std::uint64_t)rayCount;
+	});
+	if (any.Items)
+		suite.AddMetric("mrays_per_second", any.ItemsPerSecond * 1e-6);
+
+	const BenchmarkResult& brute = suite.Run("Brute force", "rays", [&]()
+	{
+		for (std::uint32_t i = 0; i < 16; ++i)
+		{
+			float nearest;
+			hits += BruteForce(positions, indices, XMLoadFloat3(&origins[i]), XMLoadFloat3(&directions[i]), nearest);
+		}
+		return (std::uint64_t)16;
+	});
+	if (brute.Items && closest.Items)
+		suite.AddMetric("bvh_speedup", closest.ItemsPerSecond / brute.ItemsPerSecond);
+
+	DoNotOptimize(hits);
+	return suite.Finish();
+}
@@ -0,0 +1,80 @@
+// ConvexHull::Build on 1M points (100k under --quick), in points per
+// second: points filling a ball, whose hull keeps a few thousand of them,
+// and the ball again stopped at a budget of 64 vertices, as for a
+// collision shape.  Points on a sphere, nearly all of which end up on the
+// hull, are the worst case, and run with a tenth as many.
+
+#include "Benchmark.h"
+#include "ConvexHull.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Uniform in the unit ball, or on the unit sphere.
+	void MakePoints(std::uint32_t count, bool surface, std::vector<XMFLOAT3>& points)
+	{
+		std::mt19937 random(48);
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		points.resize(count);
+		for (XMFLOAT3& point : points)
+		{
+			XMVECTOR direction = XMVector3Normalize(XMVectorSet(normal(random), normal(random), normal(random), 0.0f));
+			float radius = surface ? 1.0f : std::cbrt(unit(random));
+			XMStoreFloat3(&point, XMVectorScale(direction, radius));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("ConvexHull", argc, argv);
+
+	const std::uint32_t count = suite.Quick() ? 100000 : 1000000;
+
+	struct Case
+	{
+		const char* Name;
+		bool Surface;
+		std::uint32_t MaxVertices;
+		std::uint32_t Count;
+	};
+	const Case cases[] =
+	{
+		{ "Ball/", false, 0, count },
+		{ "Ball/64Vertices/", false, 64, count },
+		{ "Sphere/", true, 0, count / 10 },
+	};
+
+	std::vector<XMFLOAT3> points;
+	for (const Case& c : cases)
+	{
+		MakePoints(c.Count, c.Surface, points);
+
+		ConvexHull hull;
+		bool built = true;
+		const std::string name = c.Name + std::to_string(c.Count);
+		const BenchmarkResult& result = suite.Run(name, "points", [&]()
+		{
+			built = hull.Build(points.data(), (std::uint32_t)sizeof(XMFLOAT3), c.Count, c.MaxVertices) && built;
+			return (std::uint64_t)c.Count;
+		});
+		if (!built)
+			suite.Fail("No hull of " + name);
+		if (result.Items && built)
+		{
+			suite.AddMetric("mpoints_per_s", result.ItemsPerSecond / 1e6);
+			suite.AddMetric("vertices", (double)hull.Vertices().size());
+			suite.AddMetric("triangles", hull.TriangleCount());
+		}
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,170 @@
+// DistanceField::Bake against the brute force DistanceFieldTest checks it
+// with: every sample measured to every triangle of a geosphere (Ericson's
+// closest point), signed by which side of the faces it is on.  Both fill
+// the same grid, so the bake's speedup is the ratio of their samples per
+// second, and its worst error at the samples is kept alongside.  The bake
+// alone also runs at the 128^3 the app uses for AngelLucy.
+
+#include "Benchmark.h"
+#include "Bvh.h"
+#include "DistanceField.h"
+#include "GeometryGenerator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef GeometryGenerator::MeshData MeshData;
+
+	// The nearest point of triangle abc to p (Ericson 5.1.5).
+	XMVECTOR ClosestOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+		XMVECTOR ap = XMVectorSubtract(p, a);
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		XMVECTOR bp = XMVectorSubtract(p, b);
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+
+		XMVECTOR cp = XMVectorSubtract(p, c);
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+	}
+
+	// Measured to every triangle, negative behind all of them, which is
+	// inside for a convex mesh.
+	float ConvexMeshDistance(const MeshData& mesh, FXMVECTOR point)
+	{
+		float nearest = FLT_MAX;
+		bool inside = true;
+		for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t]].Position);
+			XMVECTOR b = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 1]].Position);
+			XMVECTOR c = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 2]].Position);
+			nearest = std::min(nearest, XMVectorGetX(XMVector3Length(XMVectorSubtract(point, ClosestOnTriangle(point, a, b, c)))));
+
+			XMVECTOR face = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			inside = inside && XMVectorGetX(XMVector3Dot(face, XMVectorSubtract(point, a))) < 0.0f;
+		}
+		return inside ? -nearest : nearest;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("DistanceField", argc, argv);
+
+	GeometryGenerator generator;
+	MeshData sphere = generator.CreateGeosphere(1.0f, 3);
+	const std::uint32_t triangleCount = (std::uint32_t)sphere.Indices32.size() / 3;
+	const float band = 4.0f;
+
+	Bvh bvh;
+	bvh.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(), triangleCount);
+
+	std::vector<std::uint32_t> resolutions = { 24 };
+	if (!suite.Quick())
+		resolutions.push_back(48);
+
+	DistanceField field;
+	for (std::uint32_t resolution : resolutions)
+	{
+		const std::uint64_t samples = (std::uint64_t)resolution * resolution * resolution;
+		const std::string grid = std::to_string(resolution) + "^3";
+
+		const BenchmarkResult& bake = suite.Run("Bake/" + grid, "samples", [&]()
+		{
+			field.Bake(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+				triangleCount, bvh, resolution, band);
+			return samples;
+		});
+		const double bakeRate = bake.ItemsPerSecond;
+		if (bake.Items)
+			suite.AddMetric("ms_per_bake", 1e3 * samples / bakeRate);
+
+		// Over the bake's own grid, so the two can be compared sample for
+		// sample within the band.
+		const float size = field.VoxelSize();
+		const XMFLOAT3 origin = field.Origin();
+		std::vector<float> exact((size_t)samples);
+		const BenchmarkResult& brute = suite.Run("BruteForce/" + grid, "samples", [&]()
+		{
+			size_t i = 0;
+			for (std::uint32_t z = 0; z < resolution; ++z)
+				for (std::uint32_t y = 0; y < resolution; ++y)
+					for (std::uint32_t x = 0; x < resolution; ++x)
+					{
+						XMVECTOR p = XMVectorSet(origin.x + (x + 0.5f) * size, origin.y + (y + 0.5f) * size, origin.z + (z + 0.5f) * size, 1.0f);
+						exact[i++] = ConvexMeshDistance(sphere, p);
+					}
+			DoNotOptimize(exact.data());
+			return samples;
+		});
+		if (brute.Items && bakeRate > 0.0)
+		{
+			float worst = 0.0f;
+			size_t i = 0;
+			for (std::uint32_t z = 0; z < resolution; ++z)
+				for (std::uint32_t y = 0; y < resolution; ++y)
+					for (std::uint32_t x = 0; x < resolution; ++x, ++i)
+					{
+						if (std::fabs(exact[i]) >= field.Band())
+							continue;
+						XMVECTOR p = XMVectorSet(origin.x + (x + 0.5f) * size, origin.y + (y + 0.5f) * size, origin.z + (z + 0.5f) * size, 1.0f);
+						worst = std::max(worst, std::fabs(field.Sample(p) - exact[i]));
+					}
+
+			suite.AddMetric("bake_speedup", bakeRate / brute.ItemsPerSecond);
+			suite.AddMetric("worst_error_voxels", worst / size);
+		}
+	}
+
+	// As for AngelLucy, where brute force would take minutes.
+	const std::uint32_t appResolution = 128;
+	const std::uint64_t appSamples = (std::uint64_t)appResolution * appResolution * appResolution;
+	const BenchmarkResult& app = suite.Run("Bake/128^3", "samples", [&]()
+	{
+		field.Bake(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+			triangleCount, bvh, appResolution, band);
+		return appSamples;
+	});
+	if (app.Items)
+	{
+		suite.AddMetric("ms_per_bake", 1e3 * appSamples / app.ItemsPerSecond);
+		suite.AddMetric("bricks", field.BrickCount());
+		suite.AddMetric("kb", field.SizeInBytes() / 1024.0);
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,77 @@
+// 2D FFTs of the sizes the ocean might use, and the ocean's whole update
+// at each, in points per second.  Each records its cost per point and per
+// point and stage, which stays flat while the transform is O(n^2 log n)
+// and rises once a grid stops fitting in cache.
+
+#include "Benchmark.h"
+#include "Fft.h"
+#include "Ocean.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Fft", argc, argv);
+
+	std::vector<std::uint32_t> sizes = { 64, 128, 256 };
+	if (!suite.Quick())
+		sizes.push_back(512);
+
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	for (std::uint32_t n : sizes)
+	{
+		const std::uint64_t points = (std::uint64_t)n * n;
+		const double stages = 2.0 * std::log2((double)n);
+		const std::string grid = std::to_string(n) + "x" + std::to_string(n);
+
+		Fft fft;
+		fft.Create(n);
+		std::vector<float> real(points);
+		std::vector<float> imag(points);
+		for (std::uint64_t i = 0; i < points; ++i)
+		{
+			real[i] = unit(random);
+			imag[i] = unit(random);
+		}
+
+		// Forward then back, so the values stay the same size.
+		bool inverse = false;
+		const BenchmarkResult& transform = suite.Run("Transform/" + grid, "points", [&]()
+		{
+			fft.Transform(real.data(), imag.data(), inverse);
+			inverse = !inverse;
+			return points;
+		});
+		if (transform.Items)
+		{
+			suite.AddMetric("ns_per_point", 1e9 / transform.ItemsPerSecond);
+			suite.AddMetric("ns_per_point_stage", 1e9 / (transform.ItemsPerSecond * stages));
+			suite.AddMetric("ms_per_transform", 1e3 * points / transform.ItemsPerSecond);
+		}
+
+		// As the app's, three transforms and the fields around them.
+		Ocean ocean;
+		ocean.Create(n, 64.0f, 6.0f, XMFLOAT2(0.8f, 0.6f), 0.0004f, 1.0f, 0x6f63);
+		double time = 0.0;
+		const BenchmarkResult& update = suite.Run("Ocean/" + grid, "points", [&]()
+		{
+			time += 1.0 / 60.0;
+			ocean.Update(time);
+			return points;
+		});
+		if (update.Items)
+		{
+			suite.AddMetric("ns_per_point", 1e9 / update.ItemsPerSecond);
+			suite.AddMetric("ms_per_update", 1e3 * points / update.ItemsPerSecond);
+		}
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,172 @@
+// GeometryGenerator over a sweep of tessellations, and the FBX extraction
+// loops over synthetic meshes.
+
+#include "Benchmark.h"
+#include "GeometryGenerator.h"
+#include "MeshExtraction.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Stands in for FbxMesh: a triangulated grid of control points, with
+	// FbxMesh's accessors.
+	class SyntheticMesh
+	{
+	public:
+		explicit SyntheticMesh(std::uint32_t side)
+		{
+			for (std::uint32_t z = 0; z < side; ++z)
+			{
+				for (std::uint32_t x = 0; x < side; ++x)
+				{
+					Point point = { { (double)x, std::sin(0.1 * x) * std::cos(0.1 * z), (double)z, 1.0 } };
+					mPoints.push_back(point);
+				}
+			}
+
+			for (std::uint32_t z = 0; z + 1 < side; ++z)
+			{
+				for (std::uint32_t x = 0; x + 1 < side; ++x)
+				{
+					int i = (int)(z * side + x);
+					int corners[6] = { i, i + (int)side, i + 1, i + 1, i + (int)side, i + (int)side + 1 };
+					mCorners.insert(mCorners.end(), corners, corners + 6);
+				}
+			}
+		}
+
+		struct Point
+		{
+			double v[4];
+
+			const double& operator[](int i)const { return v[i]; }
+		};
+
+		int GetControlPointsCount()const { return (int)mPoints.size(); }
+		const Point* GetControlPoints()const { return mPoints.data(); }
+		int GetPolygonCount()const { return (int)mCorners.size() / 3; }
+		int GetPolygonSize(int)const { return 3; }
+		int GetPolygonVertex(int polygon, int corner)const { return mCorners[3 * polygon + corner]; }
+
+	private:
+		std::vector<Point> mPoints;
+		std::vector<int> mCorners;
+	};
+
+	std::string Name(const char* function, std::uint32_t a)
+	{
+		return std::string(function) + "/" + std::to_string(a);
+	}
+
+	std::string Name(const char* function, std::uint32_t a, std::uint32_t b)
+	{
+		return Name(function, a) + "x" + std::to_string(b);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Geometry", argc, argv);
+	GeometryGenerator generator;
+
+	for (std::uint32_t subdivisions : { 0u, 2u, 4u, 6u })
+	{
+		suite.Run(Name("CreateBox", subdivisions), "vertices", [&]()
+		{
+			return generator.CreateBox(1.0f, 2.0f, 3.0f, subdivisions).Vertices.size();
+		});
+	}
+
+	for (std::uint32_t slices : { 16u, 64u, 256u, 1024u })
+	{
+		suite.Run(Name("CreateSphere", slices, slices), "vertices", [&]()
+		{
+			return generator.CreateSphere(1.0f, slices, slices).Vertices.size();
+		});
+	}
+
+	// Each level subdivides the icosahedron once more, through Subdivide and
+	// MidPoint.
+	for (std::uint32_t subdivisions : { 0u, 2u, 4u, 6u })
+	{
+		suite.Run(Name("CreateGeosphere", subdivisions), "vertices", [&]()
+		{
+			return generator.CreateGeosphere(1.0f, subdivisions).Vertices.size();
+		});
+	}
+
+	for (std::uint32_t slices : { 16u, 64u, 256u, 1024u })
+	{
+		suite.Run(Name("CreateCylinder", slices, slices), "vertices", [&]()
+		{
+			return generator.CreateCylinder(1.0f, 0.5f, 2.0f, slices, slices).Vertices.size();
+		});
+	}
+
+	for (std::uint32_t side : { 16u, 128u, 512u, 2048u })
+	{
+		suite.Run(Name("CreateGrid", side, side), "vertices", [&]()
+		{
+			return generator.CreateGrid(10.0f, 10.0f, side, side).Vertices.size();
+		});
+	}
+
+	suite.Run("CreateQuad", "vertices", [&]()
+	{
+		return generator.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f).Vertices.size();
+	});
+
+	for (std::uint32_t side : { 32u, 64u, 128u })
+	{
+		suite.Run(Name("CreateIsosurface", side), "vertices", [&]()
+		{
+			auto sphere = [side](const float* x, float y, float z, std::uint32_t count, float* values)
+			{
+				float r = 0.4f * side;
+				for (std::uint32_t i = 0; i < count; ++i)
+					values[i] = std::sqrt(x[i] * x[i] + y * y + z * z) - r;
+			};
+
+			float half = -0.5f * side;
+			return generator.CreateIsosurface(sphere, XMFLOAT3(half, half, half), 1.0f, side, side, side, 0.0f).Vertices.size();
+		});
+	}
+
+	for (std::uint32_t slices : { 64u, 256u })
+	{
+		GeometryGenerator::MeshData sphere = generator.CreateSphere(1.0f, slices, slices);
+
+		suite.Run(Name("GetIndices16", slices, slices), "indices", [&]()
+		{
+			GeometryGenerator::MeshData mesh;
+			mesh.Indices32 = sphere.Indices32;
+			return mesh.GetIndices16().size();
+		});
+	}
+
+	for (std::uint32_t side : { 64u, 256u, 1024u })
+	{
+		SyntheticMesh mesh(side);
+
+		suite.Run(Name("ExtractControlPoints", side, side), "vertices", [&]()
+		{
+			std::vector<XMFLOAT3> positions;
+			ExtractControlPoints(mesh, positions);
+			return positions.size();
+		});
+
+		suite.Run(Name("ExtractPolygons", side, side), "indices", [&]()
+		{
+			std::vector<std::uint32_t> indices;
+			ExtractPolygons(mesh, indices);
+			return indices.size();
+		});
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,65 @@
+// GeometryGenerator::CreateIsosurface on a rippled sphere from 64^3 to
+// 512^3 samples (to 128^3 under --quick), in triangles per second.  The
+// cells the surface crosses grow as the square of the side and the
+// samples as its cube, so each size also records ns per sample.
+
+#include "Benchmark.h"
+#include "GeometryGenerator.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef GeometryGenerator::uint32 uint32;
+
+	// A sphere with bumps a tenth of its radius across, so the mesh is not
+	// all gentle curvature.
+	void RippledSphere(const float* xs, float y, float z, uint32 count, float* values)
+	{
+		for (uint32 i = 0; i < count; ++i)
+		{
+			float x = xs[i];
+			values[i] = std::sqrt(x * x + y * y + z * z) - 0.8f + 0.03f * std::sin(12.0f * x) * std::sin(12.0f * y) * std::sin(12.0f * z);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Isosurface", argc, argv);
+
+	std::vector<uint32> sizes = { 64, 128 };
+	if (!suite.Quick())
+	{
+		sizes.push_back(256);
+		sizes.push_back(512);
+	}
+
+	GeometryGenerator generator;
+	for (uint32 n : sizes)
+	{
+		const float cellSize = 2.0f / (n - 1);
+		const XMFLOAT3 origin(-1.0f, -1.0f, -1.0f);
+		std::uint64_t triangles = 0;
+
+		const BenchmarkResult& result = suite.Run("CreateIsosurface/" + std::to_string(n) + "^3", "triangles", [&]()
+		{
+			GeometryGenerator::MeshData mesh = generator.CreateIsosurface(RippledSphere, origin, cellSize, n, n, n, 0.0f);
+			triangles = mesh.Indices32.size() / 3;
+			return triangles;
+		});
+		if (result.Items)
+		{
+			const double samples = (double)n * n * n;
+			suite.AddMetric("triangles", (double)triangles);
+			suite.AddMetric("ms_per_mesh", 1e3 * triangles / result.ItemsPerSecond);
+			suite.AddMetric("ns_per_sample", 1e9 * triangles / (result.ItemsPerSecond * samples));
+		}
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,81 @@
+// MorphTargetSet::Apply with 50 targets over a 30k-vertex face mesh, all
+// active and with most weights zero, and the memory each target takes
+// next to a dense delta array.
+
+#include "Benchmark.h"
+#include "MorphTargets.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("MorphTargets", argc, argv);
+
+	const std::uint32_t vertexCount = 30000;
+	const std::uint32_t targetCount = 50;
+
+	std::mt19937 random(34);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<XMFLOAT3> base(vertexCount);
+	for (XMFLOAT3& p : base)
+		p = XMFLOAT3(unit(random), unit(random), unit(random));
+
+	// Each target moves one contiguous region of about a tenth of the mesh,
+	// as a facial shape moves the brow or the mouth.
+	MorphTargetSet set;
+	std::vector<XMFLOAT3> deltas(vertexCount);
+	for (std::uint32_t t = 0; t < targetCount; ++t)
+	{
+		std::uint32_t begin = random() % (vertexCount - vertexCount / 10);
+		for (std::uint32_t i = 0; i < vertexCount; ++i)
+		{
+			bool moved = i >= begin && i < begin + vertexCount / 10;
+			deltas[i] = moved ? XMFLOAT3(0.02f * unit(random), 0.02f * unit(random), 0.01f * unit(random)) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+		set.AddTarget("Target " + std::to_string(t), 0, deltas.data(), vertexCount, 1e-5f);
+	}
+
+	struct Vertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT4 Color;
+		XMFLOAT2 TexC;
+	};
+	std::vector<Vertex> vertices(vertexCount);
+
+	struct Case
+	{
+		const char* Name;
+		std::uint32_t Active;
+	};
+	const Case cases[] = { { "Apply/50 active", 50 }, { "Apply/10 active", 10 }, { "Apply/0 active", 0 } };
+
+	for (const Case& c : cases)
+	{
+		std::vector<float> weights(targetCount, 0.0f);
+		for (std::uint32_t t = 0; t < c.Active; ++t)
+			weights[t * targetCount / c.Active] = 0.5f + 0.5f * unit(random);
+
+		const BenchmarkResult& result = suite.Run(c.Name, "vertices", [&]()
+		{
+			set.Apply(base.data(), vertexCount, weights.data(), &vertices[0].Pos, (std::uint32_t)sizeof(Vertex));
+			return vertexCount;
+		});
+		if (!result.Items)
+			continue;
+
+		suite.AddMetric("apply_us", result.MedianSeconds * 1e6);
+		if (c.Active == targetCount)
+		{
+			suite.AddMetric("bytes_per_target", (double)set.SizeInBytes() / targetCount);
+			suite.AddMetric("dense_bytes_per_target", (double)vertexCount * sizeof(XMFLOAT3));
+		}
+	}
+
+	return suite.Finish();
+}
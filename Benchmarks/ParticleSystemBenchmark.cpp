@@ -0,0 +1,123 @@
+// A million particles, kept full by fountains emitting as fast as they
+// die, updated a frame at a time in particles per second.  Beside it the
+// same step over particles as structs, one at a time, for what keeping
+// them as arrays of each field is worth.
+
+#include "Benchmark.h"
+#include "ParticleSystem.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Particle
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Velocity;
+		float Age;
+		float Lifetime;
+		std::uint16_t Emitter;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("ParticleSystem", argc, argv);
+
+	const std::uint32_t capacity = suite.Quick() ? 1u << 16 : 1u << 20;
+	const std::string name = std::to_string(capacity);
+	const float dt = 1.0f / 60.0f;
+	const XMFLOAT3 gravity(0.0f, -9.8f, 0.0f);
+
+	// Lifetimes average three quarters of the emitters', so a little more
+	// than capacity over that a second keeps the pool full.
+	const float lifetime = 2.5f;
+	const std::uint32_t emitterCount = 4;
+	ParticleSystem system;
+	system.Create(capacity, gravity, 0x7073);
+	for (std::uint32_t e = 0; e < emitterCount; ++e)
+	{
+		ParticleEmitter emitter;
+		emitter.Position = XMFLOAT3(4.0f * e - 6.0f, -2.8f, 4.0f);
+		emitter.Rate = 1.1f * capacity / (0.75f * lifetime * emitterCount);
+		emitter.Velocity = XMFLOAT3(0.0f, 6.0f, 0.0f);
+		emitter.Spread = 1.5f;
+		emitter.Lifetime = lifetime;
+		emitter.Size = 0.04f;
+		emitter.Color = XMFLOAT4(1.0f, 0.75f, 0.35f, 1.0f);
+		system.AddEmitter(emitter);
+	}
+
+	// Past the first lifetimes, so particles die all through the pool.
+	for (int frame = 0; frame < 180; ++frame)
+		system.Update(dt);
+
+	const BenchmarkResult& update = suite.Run("Update/" + name, "particles", [&]()
+	{
+		system.Update(dt);
+		return (std::uint64_t)system.Count();
+	});
+	if (update.Items)
+	{
+		suite.AddMetric("ns_per_particle", 1e9 / update.ItemsPerSecond);
+		suite.AddMetric("ms_per_update", 1e3 * system.Count() / update.ItemsPerSecond);
+	}
+
+	// The same particles as structs, integrated, the dead replaced by the
+	// last and the pool refilled plainly, without the emitters' sampling:
+	// less work than the update above.
+	std::vector<Particle> particles(system.Count());
+	const ParticleArrays& p = system.Particles();
+	for (std::uint32_t i = 0; i < system.Count(); ++i)
+	{
+		particles[i].Position = XMFLOAT3(p.PositionX[i], p.PositionY[i], p.PositionZ[i]);
+		particles[i].Velocity = XMFLOAT3(p.VelocityX[i], p.VelocityY[i], p.VelocityZ[i]);
+		particles[i].Age = p.Age[i];
+		particles[i].Lifetime = p.Lifetime[i];
+		particles[i].Emitter = p.Emitter[i];
+	}
+
+	std::mt19937 random(19);
+	std::uniform_real_distribution<float> unit(0.5f, 1.0f);
+	const BenchmarkResult& structs = suite.Run("Structs/" + name, "particles", [&]()
+	{
+		const std::uint64_t count = particles.size();
+		for (size_t i = 0; i < particles.size();)
+		{
+			Particle& particle = particles[i];
+			particle.Velocity.x += gravity.x * dt;
+			particle.Velocity.y += gravity.y * dt;
+			particle.Velocity.z += gravity.z * dt;
+			particle.Position.x += particle.Velocity.x * dt;
+			particle.Position.y += particle.Velocity.y * dt;
+			particle.Position.z += particle.Velocity.z * dt;
+			particle.Age += dt;
+			if (particle.Age < particle.Lifetime)
+			{
+				++i;
+				continue;
+			}
+			particle = particles.back();
+			particles.pop_back();
+		}
+
+		// Back to full, so every run has as many.
+		while (particles.size() < count)
+		{
+			Particle particle = {};
+			particle.Velocity = XMFLOAT3(0.0f, 6.0f, 0.0f);
+			particle.Lifetime = lifetime * unit(random);
+			particles.push_back(particle);
+		}
+		DoNotOptimize(particles.data());
+		return count;
+	});
+	if (structs.Items)
+		suite.AddMetric("ns_per_particle", 1e9 / structs.ItemsPerSecond);
+
+	return suite.Finish();
+}
@@ -0,0 +1,107 @@
+// The cost of a PROFILE_SCOPE, which should stay under 50 ns so scopes can
+// go in per-frame loops.
+//
+// A scope reads the clock twice.  Where that alone takes half the budget,
+// as rdtsc does under some hypervisors, the budget applies to what the
+// profiler adds on top of the reads; both figures are reported, with the
+// share of the budget used.  Timings on a loaded machine say little, so
+// nothing here fails a run: Tools/compare_benchmarks.py flags a scope that
+// got slower against a recorded baseline.
+
+#include "Benchmark.h"
+#include "Profiler.h"
+#include <cstdint>
+#include <cstdio>
+
+namespace
+{
+	const double BudgetNs = 50.0;
+
+	std::uint64_t EmptyLoop(std::uint32_t count)
+	{
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			sum += i;
+			DoNotOptimize(sum);
+		}
+		return count;
+	}
+
+	std::uint64_t ClockLoop(std::uint32_t count)
+	{
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			sum += Profiler::Now();
+			DoNotOptimize(sum);
+		}
+		return count;
+	}
+
+	std::uint64_t ScopedLoop(std::uint32_t count)
+	{
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			PROFILE_SCOPE("ScopedLoop");
+			sum += i;
+			DoNotOptimize(sum);
+		}
+		return count;
+	}
+
+	std::uint64_t NestedLoop(std::uint32_t count)
+	{
+		std::uint64_t sum = 0;
+		for (std::uint32_t i = 0; i < count; i += 2)
+		{
+			PROFILE_SCOPE("NestedLoop outer");
+			{
+				PROFILE_SCOPE("NestedLoop inner");
+				sum += i;
+				DoNotOptimize(sum);
+			}
+		}
+		return count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Profiler", argc, argv);
+	const std::uint32_t count = suite.Quick() ? 200000 : 2000000;
+
+	// The first scope on a thread allocates its ring.
+	ScopedLoop(1);
+
+	double emptySeconds = suite.Run("EmptyLoop", "iterations", [&]() { return EmptyLoop(count); }).MedianSeconds;
+	double clockNs = 1e9 * (suite.Run("Profiler::Now", "reads", [&]() { return ClockLoop(count); }).MedianSeconds - emptySeconds) / count;
+
+	// Two clock reads per scope; the budget covers them unless they take
+	// half of it.
+	double allowanceNs = 2.0 * clockNs > 0.5 * BudgetNs ? 2.0 * clockNs : 0.0;
+	if (allowanceNs > 0.0)
+		std::printf("Two clock reads take %.1f ns; the budget applies on top of them.\n", allowanceNs);
+
+	struct Case
+	{
+		const char* Name;
+		std::uint64_t (*Loop)(std::uint32_t);
+	};
+	const Case cases[] = { { "PROFILE_SCOPE", ScopedLoop }, { "PROFILE_SCOPE nested", NestedLoop } };
+
+	for (const Case& c : cases)
+	{
+		const BenchmarkResult& result = suite.Run(c.Name, "scopes", [&]() { return c.Loop(count); });
+		if (!result.Items)
+			continue;
+
+		double scopeNs = 1e9 * (result.MedianSeconds - emptySeconds) / count;
+		suite.AddMetric("ns_per_scope", scopeNs);
+		suite.AddMetric("ns_per_scope_beyond_clock", scopeNs - 2.0 * clockNs);
+		suite.AddMetric("budget_used", (scopeNs - allowanceNs) / BudgetNs);
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,108 @@
+// SceneGraph::Update over 100k nodes: everything dirty, a few subtrees
+// dirty and nothing dirty, against naive recursion up the parents.
+
+#include "Benchmark.h"
+#include "SceneGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	XMMATRIX RandomLocal(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		return XMMatrixRotationY(3.0f * unit(random)) * XMMatrixTranslation(unit(random), unit(random), unit(random));
+	}
+
+	XMMATRIX NaiveWorld(const SceneGraph& graph, SceneGraph::NodeId node)
+	{
+		SceneGraph::NodeId parent = graph.GetParent(node);
+		if (parent == SceneGraph::InvalidNode)
+			return graph.GetLocal(node);
+		return graph.GetLocal(node) * NaiveWorld(graph, parent);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("SceneGraph", argc, argv);
+
+	// 100 trees of 1000 nodes, each node's parent within 8 before it.
+	const std::uint32_t nodeCount = 100000;
+	const std::uint32_t treeSize = 1000;
+	std::mt19937 random(31);
+
+	SceneGraph graph;
+	graph.Reserve(nodeCount);
+	std::vector<SceneGraph::NodeId> roots;
+	for (std::uint32_t i = 0; i < nodeCount; ++i)
+	{
+		SceneGraph::NodeId parent = SceneGraph::InvalidNode;
+		if (i % treeSize == 0)
+			roots.push_back(i);
+		else
+			parent = i - 1 - random() % std::min<std::uint32_t>(i % treeSize, 8);
+
+		graph.AddNode(parent, RandomLocal(random));
+	}
+	graph.Update();
+
+	std::vector<XMFLOAT4X4A> naive(nodeCount);
+	double naiveSeconds = suite.Run("Naive recursion/100k", "nodes", [&]()
+	{
+		for (SceneGraph::NodeId node = 0; node < nodeCount; ++node)
+			XMStoreFloat4x4A(&naive[node], NaiveWorld(graph, node));
+		return nodeCount;
+	}).MedianSeconds;
+
+	// Moving every root dirties every node.
+	const BenchmarkResult& all = suite.Run("Update/100k all dirty", "nodes", [&]()
+	{
+		for (SceneGraph::NodeId root : roots)
+			graph.SetLocal(root, graph.GetLocal(root));
+		graph.Update();
+		return nodeCount;
+	});
+	if (all.Items && naiveSeconds > 0.0)
+		suite.AddMetric("speedup_over_naive", naiveSeconds / all.MedianSeconds);
+
+	std::vector<SceneGraph::NodeId> moved(50);
+	for (SceneGraph::NodeId& node : moved)
+		node = random() % nodeCount;
+
+	suite.Run("Update/100k 50 dirty", "nodes", [&]()
+	{
+		for (SceneGraph::NodeId node : moved)
+			graph.SetLocal(node, graph.GetLocal(node));
+		graph.Update();
+		return nodeCount;
+	});
+
+	suite.Run("Update/100k clean", "nodes", [&]()
+	{
+		graph.Update();
+		return nodeCount;
+	});
+
+	// The last update must agree with the recursion.
+	float error = 0.0f;
+	for (SceneGraph::NodeId node = 0; node < nodeCount; node += 97)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, graph.GetWorld(node));
+		XMStoreFloat4x4A(&naive[node], NaiveWorld(graph, node));
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				error = std::max(error, std::abs(world.m[r][c] - naive[node].m[r][c]));
+	}
+	if (error > 1e-4f)
+		suite.Fail("Update differs from naive recursion by " + std::to_string(error));
+
+	return suite.Finish();
+}
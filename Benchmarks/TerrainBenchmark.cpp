@@ -0,0 +1,118 @@
+// Terrain at the app's scale: cooking the heightmap, selecting patches for
+// a view low across it, and building a patch's vertices.  Each selection
+// records its triangles against the flat grid that would hold the same
+// error everywhere, which needs the finest step any patch used.
+
+#include "Benchmark.h"
+#include "Terrain.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Octaves of crossed sines, from hills a kilometre across to bumps of a
+	// few metres.
+	void MakeHeights(std::uint32_t size, std::vector<float>& heights)
+	{
+		heights.resize((size_t)size * size);
+		for (std::uint32_t r = 0; r < size; ++r)
+			for (std::uint32_t c = 0; c < size; ++c)
+			{
+				float height = 0.0f;
+				float amplitude = 60.0f;
+				float frequency = 0.006f;
+				for (int octave = 0; octave < 6; ++octave)
+				{
+					height += amplitude * std::sin(frequency * c + 1.3f * octave) * std::cos(frequency * r - 0.7f * octave);
+					amplitude *= 0.45f;
+					frequency *= 2.1f;
+				}
+				heights[(size_t)r * size + c] = height;
+			}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Terrain", argc, argv);
+
+	// The app's two kilometres at a metre a sample in 32-quad chunks.
+	const std::uint32_t size = suite.Quick() ? 513 : 2049;
+	const std::uint32_t chunkQuads = 32;
+	const float spacing = 1.0f;
+	const std::string grid = std::to_string(size) + "x" + std::to_string(size);
+	const char* path = "TerrainBenchmark.trn";
+
+	std::vector<float> heights;
+	MakeHeights(size, heights);
+
+	const BenchmarkResult& cook = suite.Run("Cook/" + grid, "samples", [&]()
+	{
+		if (!Terrain::Cook(heights.data(), size, chunkQuads, spacing, path))
+			return (std::uint64_t)0;
+		return (std::uint64_t)size * size;
+	});
+	if (cook.Items)
+		suite.AddMetric("ms_per_cook", 1e3 * size * size / cook.ItemsPerSecond);
+
+	Terrain terrain;
+	if (!terrain.Open(path))
+	{
+		suite.Fail("Could not cook and open " + std::string(path));
+		return suite.Finish();
+	}
+
+	// From 40 m over one corner, looking across to the far one, as at the
+	// app's 1080-pixel window.
+	const float extent = terrain.Extent();
+	XMVECTOR eye = XMVectorSet(0.02f * extent, 40.0f, 0.02f * extent, 1.0f);
+	XMVECTOR target = XMVectorSet(0.5f * extent, 0.0f, 0.5f * extent, 1.0f);
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 2.0f * extent);
+	XMMATRIX viewProj = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * proj;
+	const float pixelScale = 1080.0f * 0.5f * XMVectorGetY(proj.r[1]);
+
+	std::vector<TerrainPatch> patches;
+	TerrainStats stats = {};
+	for (float pixelError : { 1.0f, 2.0f, 4.0f })
+	{
+		char name[64];
+		std::snprintf(name, sizeof(name), "Select/%s/%gpx", grid.c_str(), pixelError);
+		const BenchmarkResult& select = suite.Run(name, "patches", [&]()
+		{
+			terrain.Select(viewProj, eye, pixelScale, pixelError, patches, stats);
+			return (std::uint64_t)stats.Patches;
+		});
+		if (select.Items)
+		{
+			suite.AddMetric("patches", stats.Patches);
+			suite.AddMetric("triangles", (double)stats.Triangles);
+			suite.AddMetric("flat_triangles", (double)stats.FlatTriangles);
+			suite.AddMetric("flat_over_selected", (double)stats.FlatTriangles / stats.Triangles);
+		}
+	}
+
+	// Every patch the app's 1-pixel selection draws, as a camera sweeping
+	// in would build them all.
+	terrain.Select(viewProj, eye, pixelScale, 1.0f, patches, stats);
+	std::vector<XMFLOAT3> positions(terrain.VertexCount());
+	std::vector<XMFLOAT3> normals(terrain.VertexCount());
+	const BenchmarkResult& build = suite.Run("BuildPatch/" + grid, "vertices", [&]()
+	{
+		for (const TerrainPatch& patch : patches)
+			terrain.BuildPatch(patch, positions.data(), normals.data());
+		DoNotOptimize(positions.data());
+		return (std::uint64_t)patches.size() * terrain.VertexCount();
+	});
+	if (build.Items)
+		suite.AddMetric("us_per_patch", 1e6 * terrain.VertexCount() / build.ItemsPerSecond);
+
+	terrain.Close();
+	std::remove(path);
+
+	return suite.Finish();
+}
@@ -0,0 +1,94 @@
+// TGA decode and mip chain generation in megapixels per second, on the
+// shipped texture and on a larger image tiled from it.
+
+#include "Benchmark.h"
+#include "Texture.h"
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// An uncompressed 32-bit top-down TGA of image.
+	std::vector<std::uint8_t> RawTga(const TextureImage& image)
+	{
+		std::vector<std::uint8_t> file(18, 0);
+		file[2] = 2;
+		file[12] = (std::uint8_t)(image.Width & 0xff);
+		file[13] = (std::uint8_t)(image.Width >> 8);
+		file[14] = (std::uint8_t)(image.Height & 0xff);
+		file[15] = (std::uint8_t)(image.Height >> 8);
+		file[16] = 32;
+		file[17] = 0x28;
+
+		for (size_t i = 0; i < image.Pixels.size(); i += 4)
+		{
+			std::uint8_t bgra[4] = { image.Pixels[i + 2], image.Pixels[i + 1], image.Pixels[i], image.Pixels[i + 3] };
+			file.insert(file.end(), bgra, bgra + 4);
+		}
+		return file;
+	}
+
+	void AddMegapixels(BenchmarkSuite& suite, const BenchmarkResult& result)
+	{
+		if (result.Items)
+			suite.AddMetric("megapixels_per_second", result.ItemsPerSecond * 1e-6);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("Texture", argc, argv);
+
+	std::ifstream stream(RESOURCE_DIR "/ao_twinte_chan/ao_twinte_chan640x640.tga", std::ios::binary);
+	std::vector<std::uint8_t> shipped((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	TextureImage image;
+	if (!TgaLoader::Decode(shipped.data(), shipped.size(), image))
+	{
+		suite.Fail("Could not decode the shipped texture");
+		return suite.Finish();
+	}
+
+	// 2048x2048 tiled from the shipped image.
+	TextureImage large;
+	large.Width = 2048;
+	large.Height = 2048;
+	large.Pixels.resize((size_t)large.Width * large.Height * 4);
+	for (std::uint32_t y = 0; y < large.Height; ++y)
+		for (std::uint32_t x = 0; x < large.Width; ++x)
+			for (int c = 0; c < 4; ++c)
+				large.Pixels[4 * ((size_t)y * large.Width + x) + c] = image.Pixels[4 * ((size_t)(y % image.Height) * image.Width + x % image.Width) + c];
+
+	std::vector<std::uint8_t> raw = RawTga(large);
+	TextureImage decoded;
+
+	AddMegapixels(suite, suite.Run("Decode/RLE 640x640", "pixels", [&]()
+	{
+		TgaLoader::Decode(shipped.data(), shipped.size(), decoded);
+		return (std::uint64_t)decoded.Width * decoded.Height;
+	}));
+
+	AddMegapixels(suite, suite.Run("Decode/raw 2048x2048", "pixels", [&]()
+	{
+		TgaLoader::Decode(raw.data(), raw.size(), decoded);
+		return (std::uint64_t)decoded.Width * decoded.Height;
+	}));
+
+	std::vector<TextureImage> mips;
+	const MipGenerator::Filter filters[] = { MipGenerator::Box, MipGenerator::Kaiser };
+	const char* const filterNames[] = { "box", "Kaiser" };
+
+	for (int f = 0; f < 2; ++f)
+	{
+		AddMegapixels(suite, suite.Run(std::string("Mips/") + filterNames[f] + " sRGB 2048x2048", "pixels", [&]()
+		{
+			MipGenerator::Generate(large, filters[f], true, mips);
+			return (std::uint64_t)large.Width * large.Height;
+		}));
+	}
+
+	return suite.Finish();
+}
@@ -0,0 +1,48 @@
+// VoxelOctree::Build on a geosphere of 80k triangles, solid and as a
+// shell, at the 512^3 and 1024^3 the app could use for a whole model (128^3
+// and 256^3 under --quick).  Each build records its time and the bytes it
+// keeps per set voxel, which the octree is meant to keep well under one.
+
+#include "Benchmark.h"
+#include "GeometryGenerator.h"
+#include "VoxelOctree.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	BenchmarkSuite suite("VoxelOctree", argc, argv);
+
+	GeometryGenerator generator;
+	GeometryGenerator::MeshData sphere = generator.CreateGeosphere(1.0f, 6);
+	const std::uint32_t triangleCount = (std::uint32_t)sphere.Indices32.size() / 3;
+
+	std::vector<std::uint32_t> resolutions;
+	if (suite.Quick())
+		resolutions = { 128, 256 };
+	else
+		resolutions = { 512, 1024 };
+
+	for (std::uint32_t resolution : resolutions)
+		for (bool solid : { true, false })
+		{
+			VoxelOctree voxels;
+			const std::string name = std::string(solid ? "Build/Solid/" : "Build/Shell/") + std::to_string(resolution) + "^3";
+			const BenchmarkResult& result = suite.Run(name, "triangles", [&]()
+			{
+				voxels.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+					triangleCount, resolution, solid);
+				return (std::uint64_t)triangleCount;
+			});
+			if (result.Items)
+			{
+				suite.AddMetric("ms_per_build", 1e3 * triangleCount / result.ItemsPerSecond);
+				suite.AddMetric("voxels", (double)voxels.VoxelCount());
+				suite.AddMetric("bytes_per_voxel", (double)voxels.SizeInBytes() / voxels.VoxelCount());
+				suite.AddMetric("kb", voxels.SizeInBytes() / 1024.0);
+			}
+		}
+
+	return suite.Finish();
+}
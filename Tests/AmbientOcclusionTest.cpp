@@ -0,0 +1,160 @@
+// AmbientOcclusionBaker on a sphere inside a larger one: the outer surface
+// is open and the inner one closed in, and the bake comes out bit for bit
+// the same whatever the thread count, however its samples are split into
+// passes, and when resumed from a saved file.
+
+#include "Check.h"
+#include "AmbientOcclusion.h"
+#include "GeometryGenerator.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Rays from the inner sphere further off its normal than acos(0.37)
+	// reach past this, which with cosine weighting is 0.37^2 of them.
+	const float Radius = 0.7f;
+	const double InnerVisibility = 0.371 * 0.371;
+
+	struct Scene
+	{
+		GeometryGenerator::MeshData Mesh;
+		std::uint32_t OuterVertexCount;
+		std::uint32_t OuterTriangleCount;
+		Bvh Triangles;
+	};
+
+	// Both wound outward, so the inner one's rays all end on the outer
+	// one, from half a unit away along its normal to 0.87 across it.
+	void MakeScene(Scene& scene)
+	{
+		GeometryGenerator generator;
+		scene.Mesh = generator.CreateGeosphere(1.0f, 3);
+		scene.OuterVertexCount = (std::uint32_t)scene.Mesh.Vertices.size();
+		scene.OuterTriangleCount = (std::uint32_t)scene.Mesh.Indices32.size() / 3;
+
+		GeometryGenerator::MeshData inner = generator.CreateGeosphere(0.5f, 2);
+		for (std::uint32_t index : inner.Indices32)
+			scene.Mesh.Indices32.push_back(index + scene.OuterVertexCount);
+		scene.Mesh.Vertices.insert(scene.Mesh.Vertices.end(), inner.Vertices.begin(), inner.Vertices.end());
+
+		scene.Triangles.Build(&scene.Mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex),
+			scene.Mesh.Indices32.data(), (std::uint32_t)scene.Mesh.Indices32.size() / 3);
+	}
+
+	void Begin(const Scene& scene, AmbientOcclusionBaker& baker, std::uint32_t seed)
+	{
+		baker.Begin(&scene.Mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex),
+			(std::uint32_t)scene.Mesh.Vertices.size(), scene.Mesh.Indices32.data(),
+			(std::uint32_t)scene.Mesh.Indices32.size() / 3, scene.Triangles, Radius, seed);
+	}
+
+	std::vector<float> Resolve(const Scene& scene, const AmbientOcclusionBaker& baker)
+	{
+		std::vector<float> visibility(scene.Mesh.Vertices.size());
+		baker.Resolve(visibility.data());
+		return visibility;
+	}
+
+	bool Same(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+	}
+}
+
+int main()
+{
+	Scene scene;
+	MakeScene(scene);
+	std::uint32_t vertexCount = (std::uint32_t)scene.Mesh.Vertices.size();
+
+	// Nothing traced yet reads as open.
+	AmbientOcclusionBaker baker;
+	Begin(scene, baker, 7);
+	CHECK(baker.SampleCount() == 0);
+	std::vector<float> unbaked = Resolve(scene, baker);
+	CHECK(unbaked.size() == vertexCount && unbaked[0] == 1.0f && unbaked.back() == 1.0f);
+
+	// One thread against several, in one pass of 16.
+	ThreadPool serial(0);
+	ThreadPool parallel(3);
+	baker.Trace(16, serial);
+	std::vector<float> reference = Resolve(scene, baker);
+	CHECK(baker.SampleCount() == 16);
+	CHECK(baker.RayCount() == 16ull * vertexCount);
+
+	AmbientOcclusionBaker threaded;
+	Begin(scene, threaded, 7);
+	threaded.Trace(16, parallel);
+	CHECK(Same(Resolve(scene, threaded), reference));
+
+	// The same 16 samples over passes of 4, 8 and 4.
+	AmbientOcclusionBaker split;
+	Begin(scene, split, 7);
+	split.Trace(4, parallel);
+	split.Trace(8, serial);
+	split.Trace(4, parallel);
+	CHECK(split.SampleCount() == 16);
+	CHECK(Same(Resolve(scene, split), reference));
+
+	// The outer sphere sees the sky, up to the odd ray grazing a neighbour
+	// off the biased origin; the inner one sees past the outer only at a
+	// slant.
+	double outer = 0.0;
+	double inner = 0.0;
+	for (std::uint32_t i = 0; i < vertexCount; ++i)
+		(i < scene.OuterVertexCount ? outer : inner) += reference[i];
+	outer /= scene.OuterVertexCount;
+	inner /= vertexCount - scene.OuterVertexCount;
+	std::printf("outer visibility %.4f, inner %.4f (expected %.4f)\n", outer, inner, InnerVisibility);
+	CHECK(outer > 0.97);
+	CHECK_NEAR(inner, InnerVisibility, 0.03);
+
+	// Another seed gives other samples.
+	AmbientOcclusionBaker reseeded;
+	Begin(scene, reseeded, 8);
+	reseeded.Trace(16, serial);
+	CHECK(!Same(Resolve(scene, reseeded), reference));
+
+	// Saved after 8 and resumed for 8 more, it matches the bake made in
+	// one go.
+	{
+		const char* path = "AmbientOcclusionTest.ao";
+		AmbientOcclusionBaker first;
+		Begin(scene, first, 7);
+		first.Trace(8, parallel);
+		CHECK(first.Save(path));
+
+		AmbientOcclusionBaker resumed;
+		Begin(scene, resumed, 7);
+		CHECK(resumed.Load(path));
+		CHECK(resumed.SampleCount() == 8);
+		resumed.Trace(8, parallel);
+		CHECK(Same(Resolve(scene, resumed), reference));
+
+		// A file from another seed, radius or mesh is turned away and
+		// leaves the bake as it was.
+		AmbientOcclusionBaker other;
+		Begin(scene, other, 8);
+		CHECK(!other.Load(path));
+		CHECK(other.SampleCount() == 0);
+
+		other.Begin(&scene.Mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), vertexCount,
+			scene.Mesh.Indices32.data(), (std::uint32_t)scene.Mesh.Indices32.size() / 3, scene.Triangles, 2.0f, 7);
+		CHECK(!other.Load(path));
+
+		other.Begin(&scene.Mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), scene.OuterVertexCount,
+			scene.Mesh.Indices32.data(), scene.OuterTriangleCount, scene.Triangles, Radius, 7);
+		CHECK(!other.Load(path));
+
+		std::remove(path);
+		CHECK(!other.Load(path));
+	}
+
+	return CHECK_RESULT();
+}
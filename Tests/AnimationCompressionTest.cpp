@@ -0,0 +1,141 @@
+// CompressedClip: the reported error stays within the tolerances, decoding
+// at any time matches the source clip within them, and constant and
+// smooth tracks shrink.
+
+#include "AnimationCompression.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Joint 0 never moves, the rest swing and slide at their own rates, and
+	// joint 5's keys flip the quaternion sign every few frames.
+	AnimationClip MakeClip(std::uint32_t jointCount, std::uint32_t frameCount)
+	{
+		AnimationClip clip;
+		clip.Name = "Swing";
+		clip.SampleRate = 30.0f;
+		clip.FrameCount = frameCount;
+		clip.JointCount = jointCount;
+		clip.Duration = (frameCount - 1) / clip.SampleRate;
+
+		for (std::uint32_t f = 0; f < frameCount; ++f)
+		{
+			float t = f / clip.SampleRate;
+			for (std::uint32_t j = 0; j < jointCount; ++j)
+			{
+				float angle = j == 0 ? 0.4f : 0.8f * std::sin((0.5f + 0.3f * j) * t + j);
+
+				BoneTransform bone;
+				bone.Rotation = XMFLOAT4A(std::sin(0.5f * angle), 0.0f, 0.0f, std::cos(0.5f * angle));
+				if (j == 5 && f % 7 == 0)
+					bone.Rotation = XMFLOAT4A(-bone.Rotation.x, 0.0f, 0.0f, -bone.Rotation.w);
+
+				bone.Translation = XMFLOAT4A(j == 0 ? 1.0f : 10.0f * std::sin(t * (0.5f + 0.1f * j)), 2.0f, 0.0f, 0.0f);
+				bone.Scale = XMFLOAT4A(1.0f, 1.0f + (j % 4 == 1 ? 0.2f * t : 0.0f), 1.0f, 0.0f);
+				clip.Keys.push_back(bone);
+			}
+		}
+
+		return clip;
+	}
+
+	float RotationError(const BoneTransform& a, const BoneTransform& b)
+	{
+		float dot = std::fabs(a.Rotation.x * b.Rotation.x + a.Rotation.y * b.Rotation.y + a.Rotation.z * b.Rotation.z + a.Rotation.w * b.Rotation.w);
+		return 2.0f * std::acos(std::fmin(dot, 1.0f));
+	}
+
+	float VectorError(const XMFLOAT4A& a, const XMFLOAT4A& b)
+	{
+		return std::fmax(std::fabs(a.x - b.x), std::fmax(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+	}
+}
+
+int main()
+{
+	const std::uint32_t jointCount = 30;
+	const CompressionSettings settings = { 0.001f, 0.001f, 0.0001f };
+
+	AnimationClip clip = MakeClip(jointCount, 121);
+
+	CompressedClip compressed;
+	CompressionStats stats = compressed.Compress(clip, settings);
+	std::printf("%zu bytes to %zu, %.2f:1\n", stats.RawBytes, stats.CompressedBytes, stats.Ratio);
+
+	CHECK(compressed.JointCount() == jointCount);
+	CHECK(std::fabs(compressed.Duration() - clip.Duration) < 1e-6f);
+	CHECK(stats.CompressedBytes == compressed.SizeInBytes());
+	CHECK(stats.Ratio > 3.0);
+
+	// Quantization adds up to half a step on top of the tolerance.  The
+	// rotation tolerance bounds each quaternion component, and the angle
+	// between two unit quaternions is about twice their distance.
+	CHECK(stats.MaxRotationError <= 4.0f * settings.RotationTolerance);
+	CHECK(stats.MaxTranslationError <= 2.0f * settings.TranslationTolerance);
+	CHECK(stats.MaxScaleError <= 2.0f * settings.ScaleTolerance);
+
+	// Between frames, including those at block edges, the decoder follows
+	// the raw sampler just as closely: both interpolate keys that are each
+	// within the bounds above.
+	{
+		std::vector<BoneTransform> decoded(jointCount), raw(jointCount);
+		std::mt19937 random(33);
+		std::uniform_real_distribution<float> time(-clip.Duration, 2.0f * clip.Duration);
+
+		float rotation = 0.0f, translation = 0.0f, scale = 0.0f;
+		for (int i = 0; i < 2000; ++i)
+		{
+			float t = i < 16 ? (i * CompressedClip::BlockFrames + (i & 1) * 0.5f) / clip.SampleRate : time(random);
+			bool loop = i % 5 != 0;
+
+			compressed.Sample(t, loop, decoded.data());
+			Animator::SampleClip(clip, t, loop, raw.data());
+
+			for (std::uint32_t j = 0; j < jointCount; ++j)
+			{
+				rotation = std::fmax(rotation, RotationError(decoded[j], raw[j]));
+				translation = std::fmax(translation, VectorError(decoded[j].Translation, raw[j].Translation));
+				scale = std::fmax(scale, VectorError(decoded[j].Scale, raw[j].Scale));
+			}
+		}
+
+		std::printf("Decoded between frames: rotation %g, translation %g, scale %g\n", rotation, translation, scale);
+		CHECK(rotation <= 4.0f * settings.RotationTolerance);
+		CHECK(translation <= 2.0f * settings.TranslationTolerance);
+		CHECK(scale <= 2.0f * settings.ScaleTolerance);
+	}
+
+	// Every track constant: nothing but the values and the tables.
+	{
+		AnimationClip still = clip;
+		for (std::uint32_t f = 1; f < still.FrameCount; ++f)
+			for (std::uint32_t j = 0; j < jointCount; ++j)
+				still.Keys[(size_t)f * jointCount + j] = still.Keys[j];
+
+		CompressedClip stillCompressed;
+		CompressionStats stillStats = stillCompressed.Compress(still, settings);
+		CHECK(stillStats.Ratio > 20.0);
+		CHECK(stillStats.MaxTranslationError == 0.0f);
+	}
+
+	// One frame.
+	{
+		AnimationClip single = MakeClip(jointCount, 1);
+		CompressedClip singleCompressed;
+		CompressionStats singleStats = singleCompressed.Compress(single, settings);
+
+		std::vector<BoneTransform> pose(jointCount);
+		singleCompressed.Sample(3.0f, true, pose.data());
+		CHECK(singleStats.MaxTranslationError <= settings.TranslationTolerance);
+		CHECK(VectorError(pose[3].Translation, single.Keys[3].Translation) <= settings.TranslationTolerance);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,302 @@
+// The animation kernels against scalar references written out longhand:
+// clip sampling, pose blending, the matrix palette and skinning, serial and
+// spread over the thread pool.
+
+#include "Animation.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Matrix
+	{
+		float m[4][4];
+	};
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix r = {};
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				for (int k = 0; k < 4; ++k)
+					r.m[i][j] += a.m[i][k] * b.m[k][j];
+		return r;
+	}
+
+	Matrix ToMatrix(const XMFLOAT4X4A& source)
+	{
+		Matrix r;
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				r.m[i][j] = source.m[i][j];
+		return r;
+	}
+
+	// Scale, then rotate, then translate, for row vectors.
+	Matrix Compose(const BoneTransform& bone)
+	{
+		float x = bone.Rotation.x, y = bone.Rotation.y, z = bone.Rotation.z, w = bone.Rotation.w;
+		Matrix rotation = { {
+			{ 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0 },
+			{ 2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0 },
+			{ 2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0 },
+			{ 0, 0, 0, 1 } } };
+
+		Matrix r = rotation;
+		for (int j = 0; j < 3; ++j)
+		{
+			r.m[0][j] *= bone.Scale.x;
+			r.m[1][j] *= bone.Scale.y;
+			r.m[2][j] *= bone.Scale.z;
+		}
+		r.m[3][0] = bone.Translation.x;
+		r.m[3][1] = bone.Translation.y;
+		r.m[3][2] = bone.Translation.z;
+		return r;
+	}
+
+	// Normalized lerp the short way round, and plain lerps.
+	BoneTransform Interpolate(const BoneTransform& a, const BoneTransform& b, float t)
+	{
+		const float* q0 = &a.Rotation.x;
+		float q1[4] = { b.Rotation.x, b.Rotation.y, b.Rotation.z, b.Rotation.w };
+		if (q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3] < 0.0f)
+			for (float& c : q1)
+				c = -c;
+
+		float q[4];
+		float length = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			q[i] = q0[i] + t * (q1[i] - q0[i]);
+			length += q[i] * q[i];
+		}
+		length = std::sqrt(length);
+
+		BoneTransform r;
+		r.Rotation = XMFLOAT4A(q[0] / length, q[1] / length, q[2] / length, q[3] / length);
+		r.Translation = XMFLOAT4A(a.Translation.x + t * (b.Translation.x - a.Translation.x), a.Translation.y + t * (b.Translation.y - a.Translation.y),
+			a.Translation.z + t * (b.Translation.z - a.Translation.z), 0.0f);
+		r.Scale = XMFLOAT4A(a.Scale.x + t * (b.Scale.x - a.Scale.x), a.Scale.y + t * (b.Scale.y - a.Scale.y),
+			a.Scale.z + t * (b.Scale.z - a.Scale.z), 0.0f);
+		return r;
+	}
+
+	float BoneError(const BoneTransform& a, const BoneTransform& b)
+	{
+		const float* x = &a.Rotation.x;
+		const float* y = &b.Rotation.x;
+		float error = 0.0f;
+		for (int i = 0; i < 12; ++i)
+			error = std::fmax(error, std::fabs(x[i] - y[i]));
+		return error;
+	}
+
+	BoneTransform RandomBone(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		float q[4] = { unit(random), unit(random), unit(random), unit(random) };
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+		BoneTransform bone;
+		bone.Rotation = XMFLOAT4A(q[0] / length, q[1] / length, q[2] / length, q[3] / length);
+		bone.Translation = XMFLOAT4A(unit(random), 1.0f + unit(random), unit(random), 0.0f);
+		bone.Scale = XMFLOAT4A(1.0f + 0.2f * unit(random), 1.0f + 0.2f * unit(random), 1.0f + 0.2f * unit(random), 0.0f);
+		return bone;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(32);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	const std::uint32_t jointCount = 40;
+
+	Skeleton skeleton;
+	for (std::uint32_t j = 0; j < jointCount; ++j)
+	{
+		skeleton.Parents.push_back(j == 0 ? -1 : (std::int32_t)(random() % j));
+		skeleton.BindPose.push_back(RandomBone(random));
+
+		XMFLOAT4X4A inverseBind;
+		XMStoreFloat4x4A(&inverseBind, XMMatrixTranslation(unit(random), unit(random), unit(random)));
+		skeleton.InverseBindPose.push_back(inverseBind);
+	}
+
+	// Keys far apart, some across the quaternion sign flip.
+	AnimationClip clip;
+	clip.Name = "Test";
+	clip.SampleRate = 30.0f;
+	clip.FrameCount = 31;
+	clip.Duration = 1.0f;
+	clip.JointCount = jointCount;
+	for (std::uint32_t i = 0; i < clip.FrameCount * jointCount; ++i)
+		clip.Keys.push_back(RandomBone(random));
+
+	// Sampling: between keys, looped past the end, and clamped to the last
+	// key when not looping.
+	{
+		std::vector<BoneTransform> pose(jointCount);
+		float error = 0.0f;
+
+		for (float time : { 0.0f, 0.01f, 0.3333f, 0.99f, 1.45f, -0.2f })
+		{
+			Animator::SampleClip(clip, time, true, pose.data());
+
+			float wrapped = std::fmod(time, clip.Duration);
+			if (wrapped < 0.0f)
+				wrapped += clip.Duration;
+			float frame = wrapped * clip.SampleRate;
+			std::uint32_t f0 = (std::uint32_t)frame;
+
+			for (std::uint32_t j = 0; j < jointCount; ++j)
+			{
+				BoneTransform expected = f0 >= clip.FrameCount - 1 ? clip.Keys[(clip.FrameCount - 1) * jointCount + j]
+					: Interpolate(clip.Keys[f0 * jointCount + j], clip.Keys[(f0 + 1) * jointCount + j], frame - f0);
+				error = std::fmax(error, BoneError(pose[j], expected));
+			}
+		}
+
+		Animator::SampleClip(clip, 5.0f, false, pose.data());
+		for (std::uint32_t j = 0; j < jointCount; ++j)
+			error = std::fmax(error, BoneError(pose[j], clip.Keys[(clip.FrameCount - 1) * jointCount + j]));
+
+		CHECK(error < 1e-5f);
+	}
+
+	// Blending.
+	{
+		std::vector<BoneTransform> a(skeleton.BindPose), b(jointCount), out(jointCount);
+		for (BoneTransform& bone : b)
+			bone = RandomBone(random);
+
+		Animator::BlendPoses(a.data(), b.data(), 0.3f, jointCount, out.data());
+
+		float error = 0.0f;
+		for (std::uint32_t j = 0; j < jointCount; ++j)
+			error = std::fmax(error, BoneError(out[j], Interpolate(a[j], b[j], 0.3f)));
+		CHECK(error < 1e-5f);
+	}
+
+	// The palette: each joint composed, carried down from its parent, and
+	// premultiplied by its inverse bind matrix.
+	std::vector<BoneTransform> pose(jointCount);
+	Animator::SampleClip(clip, 0.47f, true, pose.data());
+
+	std::vector<XMFLOAT4X4A> modelSpace(jointCount), palette(jointCount);
+	Animator::BuildMatrixPalette(skeleton, pose.data(), modelSpace.data(), palette.data());
+
+	std::vector<Matrix> expectedPalette(jointCount);
+	{
+		std::vector<Matrix> model(jointCount);
+		float error = 0.0f;
+
+		for (std::uint32_t j = 0; j < jointCount; ++j)
+		{
+			Matrix local = Compose(pose[j]);
+			std::int32_t parent = skeleton.Parents[j];
+			model[j] = parent < 0 ? local : Multiply(local, model[parent]);
+			expectedPalette[j] = Multiply(ToMatrix(skeleton.InverseBindPose[j]), model[j]);
+
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					error = std::fmax(error, std::fabs(palette[j].m[r][c] - expectedPalette[j].m[r][c]));
+		}
+
+		CHECK(error < 1e-3f);
+	}
+
+	// Influences: the four heaviest, repeats summed, scaled to one.
+	std::vector<SkinInfluence> influences(5000);
+	for (SkinInfluence& influence : influences)
+	{
+		influence = SkinInfluence();
+		std::uint32_t count = random() % 7;
+		for (std::uint32_t k = 0; k < count; ++k)
+			Animator::AddInfluence(influence, (std::uint16_t)(random() % jointCount), unit(random));
+		Animator::NormalizeInfluence(influence);
+
+		float sum = 0.0f;
+		for (int k = 0; k < 4; ++k)
+		{
+			CHECK(k == 0 || influence.Weights[k] <= influence.Weights[k - 1]);
+			sum += influence.Weights[k];
+		}
+		CHECK(count == 0 ? sum == 0.0f : std::fabs(sum - 1.0f) < 1e-5f);
+	}
+
+	{
+		SkinInfluence influence = SkinInfluence();
+		Animator::AddInfluence(influence, 3, 0.1f);
+		Animator::AddInfluence(influence, 5, 0.4f);
+		Animator::AddInfluence(influence, 3, 0.35f);
+		Animator::AddInfluence(influence, 7, 0.2f);
+		Animator::AddInfluence(influence, 8, 0.05f);
+		Animator::AddInfluence(influence, 9, 0.01f);
+		CHECK(influence.Joints[0] == 3 && std::fabs(influence.Weights[0] - 0.45f) < 1e-6f);
+		CHECK(influence.Joints[1] == 5 && influence.Joints[2] == 7 && influence.Joints[3] == 8);
+	}
+
+	// Skinning into an interleaved array, serially and on the pool.  A
+	// vertex with no weights keeps its bind position.
+	{
+		struct Vertex
+		{
+			XMFLOAT3 Pos;
+			float Color[4];
+		};
+
+		std::uint32_t vertexCount = (std::uint32_t)influences.size();
+		std::vector<XMFLOAT3> bind(vertexCount);
+		for (XMFLOAT3& p : bind)
+			p = XMFLOAT3(unit(random) * 2.0f - 1.0f, unit(random) * 2.0f, unit(random) - 0.5f);
+
+		std::vector<Vertex> serial(vertexCount), parallel(vertexCount);
+		Animator::SkinPositions(palette.data(), bind.data(), influences.data(), vertexCount, &serial[0].Pos, (std::uint32_t)sizeof(Vertex));
+
+		Animator animator;
+		animator.SetSkeleton(&skeleton);
+		animator.Sample(clip, 0.47f, true);
+		animator.BuildPalette();
+		animator.Skin(bind.data(), influences.data(), vertexCount, &parallel[0].Pos, (std::uint32_t)sizeof(Vertex));
+
+		float error = 0.0f;
+		std::uint32_t mismatched = 0;
+		for (std::uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const SkinInfluence& influence = influences[i];
+			float p[4] = { bind[i].x, bind[i].y, bind[i].z, 1.0f };
+			float expected[3] = { bind[i].x, bind[i].y, bind[i].z };
+
+			if (influence.Weights[0] != 0.0f)
+			{
+				expected[0] = expected[1] = expected[2] = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					const Matrix& m = expectedPalette[influence.Joints[k]];
+					for (int c = 0; c < 3; ++c)
+						expected[c] += influence.Weights[k] * (p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + p[3] * m.m[3][c]);
+				}
+			}
+
+			const float* got = &serial[i].Pos.x;
+			for (int c = 0; c < 3; ++c)
+				error = std::fmax(error, std::fabs(got[c] - expected[c]));
+
+			if (std::memcmp(&serial[i].Pos, &parallel[i].Pos, sizeof(XMFLOAT3)) != 0)
+				++mismatched;
+		}
+
+		CHECK(error < 1e-3f);
+		CHECK(mismatched == 0);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,193 @@
+// AppEventQueue between a window thread and a render thread: posting never
+// waits, clicks and keys all arrive once and in order however far behind
+// the render thread falls, mouse moves and resizes behind a full queue are
+// folded into the latest, and a drain reports the last size and the oldest
+// input.
+
+#include "AppEventQueue.h"
+#include "Check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	AppEvent MakeEvent(AppEvent::Type type, std::uintptr_t param, int x, int y, std::int64_t timestamp)
+	{
+		AppEvent e;
+		e.EventType = type;
+		e.Param = param;
+		e.X = x;
+		e.Y = y;
+		e.Timestamp = timestamp;
+		return e;
+	}
+
+	std::vector<AppEvent> DrainAll(AppEventQueue& queue, AppEventBatch& batch)
+	{
+		std::vector<AppEvent> events;
+		batch = queue.Drain([&](const AppEvent& e) { events.push_back(e); });
+		return events;
+	}
+}
+
+int main()
+{
+	// Nothing posted, nothing drained.
+	{
+		AppEventQueue queue;
+		AppEventBatch batch;
+		CHECK(DrainAll(queue, batch).empty());
+		CHECK(batch.Count == 0 && !batch.Resized && batch.FirstInput == 0);
+	}
+
+	// Resizes fold into the last size and never reach the handler; the
+	// oldest input's timestamp is reported, not a pause's.
+	{
+		AppEventQueue queue;
+		queue.Post(MakeEvent(AppEvent::Pause, 0, 0, 0, 1));
+		queue.Post(MakeEvent(AppEvent::Resize, 0, 640, 480, 2));
+		queue.Post(MakeEvent(AppEvent::MouseDown, 1, 5, 6, 3));
+		queue.Post(MakeEvent(AppEvent::Resize, 0, 800, 600, 4));
+		queue.Post(MakeEvent(AppEvent::KeyDown, 'A', 0, 0, 5));
+
+		AppEventBatch batch;
+		std::vector<AppEvent> events = DrainAll(queue, batch);
+		CHECK(batch.Count == 5);
+		CHECK(batch.Resized && batch.Width == 800 && batch.Height == 600);
+		CHECK(batch.FirstInput == 3);
+		CHECK(events.size() == 3 && events[0].EventType == AppEvent::Pause && events[1].EventType == AppEvent::MouseDown
+			&& events[2].EventType == AppEvent::KeyDown && events[2].Param == 'A');
+	}
+
+	// Behind a full queue: later events wait in order, a run of mouse moves
+	// or resizes becomes its latest with its first timestamp, and a click
+	// between moves keeps them apart.
+	{
+		AppEventQueue queue;
+		for (std::uint32_t i = 0; i < AppEventQueue::Capacity; ++i)
+			queue.Post(MakeEvent(AppEvent::KeyDown, i, 0, 0, 100 + i));
+		CHECK(queue.Backlog() == 0);
+
+		queue.Post(MakeEvent(AppEvent::MouseMove, 0, 1, 1, 1000));
+		queue.Post(MakeEvent(AppEvent::MouseMove, 0, 2, 2, 1001));
+		queue.Post(MakeEvent(AppEvent::MouseMove, 0, 3, 3, 1002));
+		queue.Post(MakeEvent(AppEvent::MouseDown, 1, 3, 3, 1003));
+		queue.Post(MakeEvent(AppEvent::MouseMove, 1, 4, 4, 1004));
+		queue.Post(MakeEvent(AppEvent::Resize, 0, 100, 100, 1005));
+		queue.Post(MakeEvent(AppEvent::Resize, 0, 200, 150, 1006));
+		CHECK(queue.Backlog() == 4);
+		CHECK(queue.Coalesced() == 3);
+
+		// Nothing moves on until the render thread makes room.
+		CHECK(queue.Flush() == 0);
+
+		AppEventBatch batch;
+		std::vector<AppEvent> events = DrainAll(queue, batch);
+		CHECK(events.size() == AppEventQueue::Capacity && !batch.Resized);
+		std::uint32_t outOfOrder = 0;
+		for (std::uint32_t i = 0; i < events.size(); ++i)
+			outOfOrder += events[i].Param != i;
+		CHECK(outOfOrder == 0);
+
+		CHECK(queue.Flush() == 4);
+		CHECK(queue.Backlog() == 0);
+		events = DrainAll(queue, batch);
+		CHECK(events.size() == 3);
+		if (events.size() == 3)
+		{
+			CHECK(events[0].EventType == AppEvent::MouseMove && events[0].X == 3 && events[0].Timestamp == 1000);
+			CHECK(events[1].EventType == AppEvent::MouseDown);
+			CHECK(events[2].EventType == AppEvent::MouseMove && events[2].X == 4);
+		}
+		CHECK(batch.Resized && batch.Width == 200 && batch.Height == 150);
+		CHECK(batch.FirstInput == 1000);
+	}
+
+	// Two threads: the window thread posts bursts of moves with clicks,
+	// keys and resizes among them and never waits; the render thread drains
+	// a frame at a time and now and then stalls far longer than a frame.
+	{
+		const std::uint32_t keyCount = 200000;
+		AppEventQueue queue;
+		std::atomic<bool> posted(false);
+
+		std::uint64_t longestPostNs = 0;
+		std::thread window([&]()
+		{
+			int size = 0;
+			for (std::uint32_t key = 0; key < keyCount; ++key)
+			{
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				for (int move = 0; move < 4; ++move)
+					queue.Post(MakeEvent(AppEvent::MouseMove, 0, (int)key, move, 1 + key));
+				queue.Post(MakeEvent(key % 2 ? AppEvent::MouseDown : AppEvent::KeyDown, key, 0, 0, 1 + key));
+				if (key % 64 == 0)
+				{
+					++size;
+					queue.Post(MakeEvent(AppEvent::Resize, 0, size, 2 * size, 1 + key));
+				}
+				std::uint64_t ns = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				if (ns > longestPostNs)
+					longestPostNs = ns;
+			}
+
+			// What is still backlogged moves on as the render thread drains.
+			while (queue.Backlog() != 0)
+			{
+				queue.Flush();
+				std::this_thread::yield();
+			}
+			posted.store(true, std::memory_order_release);
+		});
+
+		std::uint32_t nextKey = 0;
+		std::uint32_t wrongKeys = 0;
+		std::uint32_t movesBackwards = 0;
+		int lastMove = -1;
+		int lastWidth = 0;
+		int lastHeight = 0;
+		std::uint32_t frames = 0;
+		for (;;)
+		{
+			bool done = posted.load(std::memory_order_acquire);
+			AppEventBatch batch = queue.Drain([&](const AppEvent& e)
+			{
+				if (e.EventType == AppEvent::MouseMove)
+				{
+					movesBackwards += e.X < lastMove;
+					lastMove = e.X;
+					return;
+				}
+				wrongKeys += e.Param != nextKey || e.EventType != (nextKey % 2 ? AppEvent::MouseDown : AppEvent::KeyDown);
+				++nextKey;
+			});
+			if (batch.Resized)
+			{
+				lastWidth = batch.Width;
+				lastHeight = batch.Height;
+			}
+			if (done && batch.Count == 0)
+				break;
+
+			++frames;
+			std::this_thread::sleep_for(std::chrono::microseconds(frames % 50 == 0 ? 5000 : 100));
+		}
+		window.join();
+
+		const int lastSize = (int)((keyCount - 1) / 64 + 1);
+		std::printf("threads: %u keys in %u frames, %llu coalesced, longest post %.1f us\n", nextKey, frames,
+			(unsigned long long)queue.Coalesced(), longestPostNs / 1000.0);
+		CHECK(nextKey == keyCount);
+		CHECK(wrongKeys == 0);
+		CHECK(movesBackwards == 0);
+		CHECK(lastMove == (int)keyCount - 1);
+		CHECK(lastWidth == lastSize && lastHeight == 2 * lastSize);
+		CHECK(queue.Coalesced() > 0);
+	}
+
+	return CHECK_RESULT();
+}
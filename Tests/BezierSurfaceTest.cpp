@@ -0,0 +1,198 @@
+// BezierSurface on the app's torus of 16 patches, seen from near and far:
+// welded by position, the patches form a closed mesh with every triangle
+// facing out, the triangles stay within the pixel error of the torus, and
+// only patches whose factors change are retessellated.
+
+#include "Check.h"
+#include "BezierSurface.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const float MajorRadius = 1.0f;
+	const float MinorRadius = 0.4f;
+
+	// Each circle is four cubic arcs, so the torus is four patches around
+	// each way, sharing control points along their edges.
+	void MakeTorus(std::vector<XMFLOAT3>& points, std::vector<std::uint32_t>& patches)
+	{
+		const float k = 0.5522847f;
+		XMFLOAT2 circle[12];
+		for (std::uint32_t q = 0; q < 4; ++q)
+		{
+			XMFLOAT2 c = q == 0 ? XMFLOAT2(1.0f, 0.0f) : q == 1 ? XMFLOAT2(0.0f, 1.0f) : q == 2 ? XMFLOAT2(-1.0f, 0.0f) : XMFLOAT2(0.0f, -1.0f);
+			XMFLOAT2 n(-c.y, c.x);
+			circle[3 * q] = c;
+			circle[3 * q + 1] = XMFLOAT2(c.x + k * n.x, c.y + k * n.y);
+			circle[3 * q + 2] = XMFLOAT2(n.x + k * c.x, n.y + k * c.y);
+		}
+
+		for (std::uint32_t j = 0; j < 12; ++j)
+		{
+			float radius = MajorRadius + MinorRadius * circle[j].x;
+			for (std::uint32_t i = 0; i < 12; ++i)
+				points.push_back(XMFLOAT3(radius * circle[i].x, MinorRadius * circle[j].y, -radius * circle[i].y));
+		}
+
+		for (std::uint32_t b = 0; b < 4; ++b)
+			for (std::uint32_t a = 0; a < 4; ++a)
+				for (std::uint32_t r = 0; r < 4; ++r)
+					for (std::uint32_t c = 0; c < 4; ++c)
+						patches.push_back((3 * b + r) % 12 * 12 + (3 * a + c) % 12);
+	}
+
+	// How far p is from the torus.
+	float TorusDistance(FXMVECTOR p)
+	{
+		float x = XMVectorGetX(p);
+		float z = XMVectorGetZ(p);
+		float ring = std::sqrt(x * x + z * z) - MajorRadius;
+		float y = XMVectorGetY(p);
+		return std::fabs(std::sqrt(ring * ring + y * y) - MinorRadius);
+	}
+
+	struct MeshCheck
+	{
+		std::uint32_t OpenEdges = 0;
+		std::uint32_t Flipped = 0;
+		std::uint32_t OutOfRange = 0;
+		float WorstPixels = 0.0f;
+		double Area = 0.0;
+		std::uint64_t Triangles = 0;
+	};
+
+	MeshCheck CheckMesh(const BezierSurface& surface, FXMVECTOR eye, float pixelScale)
+	{
+		MeshCheck check;
+		std::map<std::array<std::uint32_t, 3>, std::uint32_t> weld;
+		std::map<std::pair<std::uint32_t, std::uint32_t>, int> edges;
+
+		for (std::uint32_t p = 0; p < surface.PatchCount(); ++p)
+		{
+			const GeometryGenerator::MeshData& mesh = surface.PatchMesh(p);
+			check.OutOfRange += mesh.Vertices.size() > BezierSurface::MaxPatchVertices
+				|| mesh.Indices32.size() > BezierSurface::MaxPatchIndices;
+
+			// Welded on the exact bits, so a crack of any size shows.
+			std::vector<std::uint32_t> ids;
+			for (const GeometryGenerator::Vertex& vertex : mesh.Vertices)
+			{
+				std::array<std::uint32_t, 3> key;
+				std::memcpy(key.data(), &vertex.Position, sizeof(key));
+				ids.push_back(weld.emplace(key, (std::uint32_t)weld.size()).first->second);
+
+				check.OutOfRange += vertex.TexC.x < 0.0f || vertex.TexC.x > 1.0f || vertex.TexC.y < 0.0f || vertex.TexC.y > 1.0f;
+			}
+
+			for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+					edges[std::make_pair(ids[mesh.Indices32[t + e]], ids[mesh.Indices32[t + (e + 1) % 3]])]++;
+
+				XMVECTOR a = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t]].Position);
+				XMVECTOR b = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 1]].Position);
+				XMVECTOR c = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 2]].Position);
+				XMVECTOR face = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+				check.Area += 0.5 * XMVectorGetX(XMVector3Length(face));
+				check.Flipped += XMVectorGetX(XMVector3Dot(face, XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t]].Normal))) <= 0.0f;
+
+				// The middle of a triangle is about as far as it gets from
+				// the surface.
+				XMVECTOR centroid = XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), 1.0f / 3.0f);
+				float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(centroid, eye)));
+				check.WorstPixels = std::fmax(check.WorstPixels, TorusDistance(centroid) * pixelScale / distance);
+			}
+
+			check.Triangles += mesh.Indices32.size() / 3;
+		}
+
+		for (const std::pair<const std::pair<std::uint32_t, std::uint32_t>, int>& edge : edges)
+		{
+			std::map<std::pair<std::uint32_t, std::uint32_t>, int>::const_iterator reverse
+				= edges.find(std::make_pair(edge.first.second, edge.first.first));
+			check.OpenEdges += edge.second != 1 || reverse == edges.end() || reverse->second != 1;
+		}
+
+		return check;
+	}
+}
+
+int main()
+{
+	std::vector<XMFLOAT3> points;
+	std::vector<std::uint32_t> patches;
+	MakeTorus(points, patches);
+
+	BezierSurface surface;
+	surface.Create(points.data(), (std::uint32_t)points.size(), patches.data(), (std::uint32_t)patches.size() / 16);
+	CHECK(surface.PatchCount() == 16);
+
+	const float pixelScale = 500.0f;
+	const float pixelError = 1.0f;
+	const double exactArea = 4.0 * XM_PI * XM_PI * MajorRadius * MinorRadius;
+
+	// From far off, near the side, over the top and inside the hole, so
+	// neighbouring edges take factors from 1 to MaxFactor.
+	const XMFLOAT3 eyes[] = { { 0.0f, 0.0f, -50.0f }, { 0.0f, 0.0f, -5.0f }, { 2.0f, 0.5f, -0.3f }, { 0.0f, 3.0f, 0.0f },
+		{ -0.3f, 0.1f, 0.2f } };
+
+	std::uint64_t farthest = 0;
+	for (const XMFLOAT3& e : eyes)
+	{
+		XMVECTOR eye = XMLoadFloat3(&e);
+		surface.Update(eye, pixelScale, pixelError);
+		MeshCheck check = CheckMesh(surface, eye, pixelScale);
+
+		std::printf("eye (%g, %g, %g): %llu triangles, %.2f px worst, area %.4f of %.4f\n", e.x, e.y, e.z,
+			(unsigned long long)check.Triangles, check.WorstPixels, check.Area, exactArea);
+
+		CHECK(check.Triangles == surface.TriangleCount());
+		CHECK(check.OpenEdges == 0);
+		CHECK(check.Flipped == 0);
+		CHECK(check.OutOfRange == 0);
+
+		// The cubic arcs are off the circle by 0.03%, a hair of a pixel
+		// even from inside the hole.
+		CHECK(check.WorstPixels <= pixelError + 0.1f);
+		CHECK(std::fabs(check.Area - exactArea) < 0.05 * exactArea);
+
+		if (farthest == 0)
+			farthest = check.Triangles;
+		else
+			CHECK(check.Triangles > farthest);
+	}
+
+	// Closer than MaxFactor can keep to the error, the nearest patches stop
+	// at it, within their buffer bounds, and the mesh is still closed.
+	{
+		XMVECTOR eye = XMVectorSet(1.45f, 0.0f, 0.0f, 1.0f);
+		surface.Update(eye, pixelScale, pixelError);
+		MeshCheck check = CheckMesh(surface, eye, pixelScale);
+		CHECK(check.OpenEdges == 0 && check.Flipped == 0 && check.OutOfRange == 0);
+		CHECK(check.WorstPixels > pixelError);
+	}
+
+	// The same view again changes nothing; a new one retessellates some.
+	XMVECTOR eye = XMVectorSet(0.0f, 0.0f, -3.0f, 1.0f);
+	surface.Update(eye, pixelScale, pixelError);
+	CHECK(!surface.ChangedPatches().empty());
+	surface.Update(eye, pixelScale, pixelError);
+	CHECK(surface.ChangedPatches().empty());
+
+	// A looser error needs fewer triangles.
+	std::uint64_t triangles = surface.TriangleCount();
+	surface.Update(eye, pixelScale, 4.0f * pixelError);
+	CHECK(surface.TriangleCount() < triangles);
+	CHECK(CheckMesh(surface, eye, pixelScale).OpenEdges == 0);
+
+	return CHECK_RESULT();
+}
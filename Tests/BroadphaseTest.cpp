@@ -0,0 +1,198 @@
+// SweepAndPrune and HashGrid against testing every pair of boxes: the same
+// pairs in the same order, for boxes spread out, crowded together, of
+// mixed sizes and touching exactly, and frame after frame as they move,
+// whether the sweep's order carries over or starts again.
+
+#include "Check.h"
+#include "Broadphase.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	std::vector<BroadphasePair> BruteForce(const BoxArrays& boxes)
+	{
+		std::vector<BroadphasePair> pairs;
+		for (std::uint32_t a = 0; a < boxes.Size(); ++a)
+			for (std::uint32_t b = a + 1; b < boxes.Size(); ++b)
+			{
+				if (boxes.MinX[a] <= boxes.MaxX[b] && boxes.MinX[b] <= boxes.MaxX[a] && boxes.MinY[a] <= boxes.MaxY[b]
+					&& boxes.MinY[b] <= boxes.MaxY[a] && boxes.MinZ[a] <= boxes.MaxZ[b] && boxes.MinZ[b] <= boxes.MaxZ[a])
+				{
+					BroadphasePair pair = { a, b };
+					pairs.push_back(pair);
+				}
+			}
+		return pairs;
+	}
+
+	bool Same(const std::vector<BroadphasePair>& a, const std::vector<BroadphasePair>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].A != b[i].A || a[i].B != b[i].B)
+				return false;
+		}
+		return true;
+	}
+
+	// Boxes of half-size from minSize to maxSize, centered in a cube of
+	// side spread.
+	void Scatter(BoxArrays& boxes, std::vector<XMFLOAT3>& centers, std::vector<float>& sizes, std::uint32_t count,
+		float spread, float minSize, float maxSize, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		boxes.Resize(count);
+		centers.resize(count);
+		sizes.resize(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			centers[i] = XMFLOAT3(spread * unit(random), spread * unit(random), spread * unit(random));
+			sizes[i] = minSize + (maxSize - minSize) * unit(random);
+			XMVECTOR center = XMLoadFloat3(&centers[i]);
+			boxes.Set(i, XMVectorSubtract(center, XMVectorReplicate(sizes[i])), XMVectorAdd(center, XMVectorReplicate(sizes[i])));
+		}
+	}
+
+	// Both broadphases against the brute force, printing the counts.
+	void Compare(const char* name, const BoxArrays& boxes)
+	{
+		std::vector<BroadphasePair> expected = BruteForce(boxes);
+
+		SweepAndPrune sweep;
+		sweep.Update(boxes);
+		HashGrid grid;
+		grid.Update(boxes);
+
+		std::printf("%-10s %5u boxes, %6zu pairs, sweep %6zu, grid %6zu in %u cells\n", name, boxes.Size(), expected.size(),
+			sweep.Pairs().size(), grid.Pairs().size(), grid.CellCount());
+		CHECK(Same(sweep.Pairs(), expected));
+		CHECK(Same(grid.Pairs(), expected));
+	}
+}
+
+int main()
+{
+	std::mt19937 random(3);
+	BoxArrays boxes;
+	std::vector<XMFLOAT3> centers;
+	std::vector<float> sizes;
+
+	// Like the app's bodies, a few pairs apiece; then crowded, so most
+	// boxes touch many; then a few large among many small, so the grid's
+	// cells are far wider than most boxes.
+	Scatter(boxes, centers, sizes, 3000, 40.0f, 0.1f, 0.25f, random);
+	Compare("spread", boxes);
+	Scatter(boxes, centers, sizes, 1500, 4.0f, 0.1f, 0.3f, random);
+	Compare("crowded", boxes);
+	Scatter(boxes, centers, sizes, 2000, 30.0f, 0.05f, 0.2f, random);
+	for (std::uint32_t i = 0; i < 20; ++i)
+	{
+		XMVECTOR center = XMLoadFloat3(&centers[i]);
+		boxes.Set(i, XMVectorSubtract(center, XMVectorReplicate(3.0f)), XMVectorAdd(center, XMVectorReplicate(3.0f)));
+	}
+	Compare("mixed", boxes);
+
+	// Unit boxes on a lattice, each touching its neighbours exactly at a
+	// face, edge or corner, and a few repeated on top of each other.
+	{
+		const std::uint32_t side = 10;
+		boxes.Resize(side * side * side + 4);
+		for (std::uint32_t z = 0; z < side; ++z)
+			for (std::uint32_t y = 0; y < side; ++y)
+				for (std::uint32_t x = 0; x < side; ++x)
+				{
+					XMVECTOR corner = XMVectorSet((float)x, (float)y, (float)z, 0.0f);
+					boxes.Set(x + side * (y + side * z), corner, XMVectorAdd(corner, XMVectorReplicate(1.0f)));
+				}
+		for (std::uint32_t i = 0; i < 4; ++i)
+			boxes.Set(side * side * side + i, XMVectorSet(4.0f, 4.0f, 4.0f, 0.0f), XMVectorSet(5.0f, 5.0f, 5.0f, 0.0f));
+
+		Compare("lattice", boxes);
+
+		// Along each axis a box meets itself and the two either side, so
+		// (3 side - 2)^3 ordered pairs with the boxes themselves.  The four
+		// repeats meet the 27 around their place and each other.
+		const std::uint32_t around = 3 * side - 2;
+		CHECK(BruteForce(boxes).size() == (around * around * around - side * side * side) / 2 + 4 * 27 + 6);
+	}
+
+	// Frame after frame of small steps: the sweep re-sorts by a few swaps
+	// apiece and still matches, as does the grid.
+	{
+		Scatter(boxes, centers, sizes, 2000, 20.0f, 0.1f, 0.25f, random);
+		std::vector<XMFLOAT3> velocities(boxes.Size());
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (XMFLOAT3& velocity : velocities)
+			velocity = XMFLOAT3(2.0f * unit(random), 2.0f * unit(random), 2.0f * unit(random));
+
+		SweepAndPrune sweep;
+		HashGrid grid;
+		std::uint32_t wrong = 0;
+		std::uint64_t swaps = 0;
+		for (int frame = 0; frame < 30; ++frame)
+		{
+			for (std::uint32_t i = 0; i < boxes.Size(); ++i)
+			{
+				XMVECTOR center = XMVectorMultiplyAdd(XMLoadFloat3(&velocities[i]), XMVectorReplicate(1.0f / 60.0f), XMLoadFloat3(&centers[i]));
+				XMStoreFloat3(&centers[i], center);
+				boxes.Set(i, XMVectorSubtract(center, XMVectorReplicate(sizes[i])), XMVectorAdd(center, XMVectorReplicate(sizes[i])));
+			}
+
+			sweep.Update(boxes);
+			grid.Update(boxes);
+			std::vector<BroadphasePair> expected = BruteForce(boxes);
+			wrong += !Same(sweep.Pairs(), expected) + !Same(grid.Pairs(), expected);
+			if (frame > 0)
+				swaps += sweep.SortSwaps();
+		}
+		std::printf("moving: %u frames wrong, %.2f swaps per box per frame\n", wrong, (double)swaps / (29.0 * boxes.Size()));
+		CHECK(wrong == 0);
+		CHECK(swaps < 2u * 29u * boxes.Size());
+
+		// A jump far out of order, then fewer boxes: sorted again from
+		// scratch, still the same.
+		for (std::uint32_t i = 0; i < boxes.Size(); ++i)
+		{
+			XMVECTOR center = XMVectorSet(centers[i].z, centers[i].x, -centers[i].y, 0.0f);
+			boxes.Set(i, XMVectorSubtract(center, XMVectorReplicate(sizes[i])), XMVectorAdd(center, XMVectorReplicate(sizes[i])));
+		}
+		sweep.Update(boxes);
+		CHECK(Same(sweep.Pairs(), BruteForce(boxes)));
+
+		boxes.Resize(700);
+		sweep.Update(boxes);
+		grid.Update(boxes);
+		CHECK(Same(sweep.Pairs(), BruteForce(boxes)));
+		CHECK(Same(grid.Pairs(), BruteForce(boxes)));
+	}
+
+	// Nothing to pair.
+	{
+		SweepAndPrune sweep;
+		HashGrid grid;
+		boxes.Resize(0);
+		sweep.Update(boxes);
+		grid.Update(boxes);
+		CHECK(sweep.Pairs().empty() && grid.Pairs().empty());
+
+		boxes.Resize(1);
+		boxes.Set(0, XMVectorZero(), XMVectorReplicate(1.0f));
+		sweep.Update(boxes);
+		grid.Update(boxes);
+		CHECK(sweep.Pairs().empty() && grid.Pairs().empty());
+
+		sweep.Clear();
+		grid.Clear();
+		CHECK(sweep.Pairs().empty() && grid.Pairs().empty());
+	}
+
+	return CHECK_RESULT();
+}
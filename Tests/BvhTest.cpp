@@ -0,0 +1,286 @@
+// Bvh against brute force over every triangle: the nearest hit, any hit and
+// the nearest point agree on a bumpy sphere with loose triangles scattered
+// through and around it.
+
+#include "Check.h"
+#include "Bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Positions sit inside a larger vertex, as they do in the app's.
+	struct TestVertex
+	{
+		XMFLOAT3 Position;
+		float Other[5];
+	};
+
+	struct Mesh
+	{
+		std::vector<TestVertex> Vertices;
+		std::vector<std::uint32_t> Indices;
+
+		const XMFLOAT3& Corner(std::uint32_t triangle, std::uint32_t corner)const
+		{
+			return Vertices[Indices[3 * triangle + corner]].Position;
+		}
+
+		std::uint32_t TriangleCount()const
+		{
+			return (std::uint32_t)Indices.size() / 3;
+		}
+	};
+
+	Mesh MakeMesh(std::uint32_t rings, std::uint32_t looseCount, std::mt19937& random)
+	{
+		Mesh mesh;
+		for (std::uint32_t i = 0; i <= rings; ++i)
+			for (std::uint32_t j = 0; j <= rings; ++j)
+			{
+				float theta = XM_PI * i / rings;
+				float phi = XM_2PI * j / rings;
+				float r = 1.0f + 0.1f * std::sin(7.0f * theta) * std::cos(5.0f * phi);
+
+				TestVertex vertex = {};
+				vertex.Position = XMFLOAT3(r * std::sin(theta) * std::cos(phi), r * std::cos(theta), r * std::sin(theta) * std::sin(phi));
+				mesh.Vertices.push_back(vertex);
+			}
+
+		for (std::uint32_t i = 0; i < rings; ++i)
+			for (std::uint32_t j = 0; j < rings; ++j)
+			{
+				std::uint32_t a = i * (rings + 1) + j;
+				std::uint32_t c = a + rings + 1;
+				std::uint32_t quad[6] = { a, c, a + 1, a + 1, c, c + 1 };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+
+		std::uniform_real_distribution<float> spread(-2.0f, 2.0f);
+		for (std::uint32_t k = 0; k < looseCount; ++k)
+		{
+			std::uint32_t base = (std::uint32_t)mesh.Vertices.size();
+			XMFLOAT3 center(spread(random), spread(random), spread(random));
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				TestVertex vertex = {};
+				vertex.Position = XMFLOAT3(center.x + 0.05f * spread(random), center.y + 0.05f * spread(random),
+					center.z + 0.05f * spread(random));
+				mesh.Vertices.push_back(vertex);
+				mesh.Indices.push_back(base + corner);
+			}
+		}
+
+		return mesh;
+	}
+
+	// Moller-Trumbore in doubles, both sides.
+	bool RayTriangle(const double* origin, const double* direction, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c,
+		double& distance)
+	{
+		double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		double e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		double p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2],
+			direction[0] * e2[1] - direction[1] * e2[0] };
+		double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (det == 0.0)
+			return false;
+
+		double t[3] = { origin[0] - a.x, origin[1] - a.y, origin[2] - a.z };
+		double u = (t[0] * p[0] + t[1] * p[1] + t[2] * p[2]) / det;
+		if (u < 0.0 || u > 1.0)
+			return false;
+
+		double q[3] = { t[1] * e1[2] - t[2] * e1[1], t[2] * e1[0] - t[0] * e1[2], t[0] * e1[1] - t[1] * e1[0] };
+		double v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) / det;
+		if (v < 0.0 || u + v > 1.0)
+			return false;
+
+		distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+		return distance >= 0.0;
+	}
+
+	XMVECTOR Load(const XMFLOAT3& v)
+	{
+		return XMLoadFloat3(&v);
+	}
+
+	// The point of the triangle nearest to p, from its Voronoi regions.
+	XMVECTOR ClosestOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+		XMVECTOR ap = XMVectorSubtract(p, a);
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		XMVECTOR bp = XMVectorSubtract(p, b);
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+
+		XMVECTOR cp = XMVectorSubtract(p, c);
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+	}
+
+	XMVECTOR PointAt(const Mesh& mesh, const BvhHit& hit)
+	{
+		XMVECTOR a = Load(mesh.Corner(hit.Triangle, 0));
+		XMVECTOR b = Load(mesh.Corner(hit.Triangle, 1));
+		XMVECTOR c = Load(mesh.Corner(hit.Triangle, 2));
+		return XMVectorAdd(a, XMVectorAdd(XMVectorScale(XMVectorSubtract(b, a), hit.U), XMVectorScale(XMVectorSubtract(c, a), hit.V)));
+	}
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	Mesh mesh = MakeMesh(60, 500, random);
+
+	Bvh bvh;
+	bvh.Build(&mesh.Vertices[0].Position, (std::uint32_t)sizeof(TestVertex), mesh.Indices.data(), mesh.TriangleCount());
+	CHECK(bvh.TriangleCount() == mesh.TriangleCount());
+	CHECK(bvh.NodeCount() > 0);
+
+	// Rays from around the mesh towards its middle, some straight up, so
+	// both the shell and the loose triangles are hit and missed.
+	std::uniform_real_distribution<float> spread(-2.0f, 2.0f);
+	std::uint32_t hits = 0;
+	std::uint32_t wrongHit = 0;
+	std::uint32_t wrongDistance = 0;
+	std::uint32_t wrongPoint = 0;
+	std::uint32_t wrongOccluded = 0;
+	std::uint32_t wrongLimited = 0;
+
+	for (int ray = 0; ray < 1000; ++ray)
+	{
+		double origin[3] = { 2.0 * spread(random), 2.0 * spread(random), 2.0 * spread(random) };
+		double direction[3];
+		for (int i = 0; i < 3; ++i)
+			direction[i] = 0.25 * spread(random) - origin[i];
+		if (ray % 50 == 0)
+		{
+			direction[0] = direction[2] = 0.0;
+			direction[1] = 1.0;
+		}
+
+		double nearest = 1e30;
+		for (std::uint32_t t = 0; t < mesh.TriangleCount(); ++t)
+		{
+			double distance;
+			if (RayTriangle(origin, direction, mesh.Corner(t, 0), mesh.Corner(t, 1), mesh.Corner(t, 2), distance))
+				nearest = std::min(nearest, distance);
+		}
+		bool expected = nearest < 1e30;
+
+		XMVECTOR o = XMVectorSet((float)origin[0], (float)origin[1], (float)origin[2], 1.0f);
+		XMVECTOR d = XMVectorSet((float)direction[0], (float)direction[1], (float)direction[2], 0.0f);
+
+		BvhHit hit;
+		bool found = bvh.Intersect(o, d, FLT_MAX, hit);
+		if (found != expected)
+		{
+			++wrongHit;
+			continue;
+		}
+		if (bvh.Occluded(o, d, FLT_MAX) != expected)
+			++wrongOccluded;
+		if (!found)
+			continue;
+
+		++hits;
+		if (std::fabs(hit.Distance - nearest) > 1e-4 * nearest + 1e-6)
+			++wrongDistance;
+
+		// The triangle and barycentrics reported put the hit on the ray.
+		XMVECTOR onRay = XMVectorAdd(o, XMVectorScale(d, hit.Distance));
+		if (XMVectorGetX(XMVector3Length(XMVectorSubtract(PointAt(mesh, hit), onRay))) > 1e-4f)
+			++wrongPoint;
+
+		// Stopping short of the hit finds nothing; a little past finds it.
+		BvhHit limited;
+		if (bvh.Intersect(o, d, 0.99f * hit.Distance, limited) || bvh.Occluded(o, d, 0.99f * hit.Distance)
+			|| !bvh.Intersect(o, d, 1.01f * hit.Distance, limited))
+			++wrongLimited;
+	}
+
+	std::printf("%u of 1000 rays hit\n", hits);
+	CHECK(hits > 300 && hits < 990);
+	CHECK(wrongHit == 0);
+	CHECK(wrongOccluded == 0);
+	CHECK(wrongDistance == 0);
+	CHECK(wrongPoint == 0);
+	CHECK(wrongLimited == 0);
+
+	// Nearest points, inside, near and outside the mesh.
+	std::uint32_t wrongNearest = 0;
+	std::uint32_t wrongNearestPoint = 0;
+
+	for (int query = 0; query < 300; ++query)
+	{
+		XMVECTOR p = XMVectorSet(1.5f * spread(random), 1.5f * spread(random), 1.5f * spread(random), 1.0f);
+
+		float nearest = FLT_MAX;
+		for (std::uint32_t t = 0; t < mesh.TriangleCount(); ++t)
+		{
+			XMVECTOR closest = ClosestOnTriangle(p, Load(mesh.Corner(t, 0)), Load(mesh.Corner(t, 1)), Load(mesh.Corner(t, 2)));
+			nearest = std::min(nearest, XMVectorGetX(XMVector3Length(XMVectorSubtract(p, closest))));
+		}
+
+		BvhHit hit;
+		if (!bvh.Nearest(p, FLT_MAX, hit) || std::fabs(hit.Distance - nearest) > 1e-4f)
+		{
+			++wrongNearest;
+			continue;
+		}
+
+		if (std::fabs(XMVectorGetX(XMVector3Length(XMVectorSubtract(PointAt(mesh, hit), p))) - hit.Distance) > 1e-4f)
+			++wrongNearestPoint;
+
+		// Nothing is nearer than the nearest.
+		BvhHit none;
+		if (bvh.Nearest(p, 0.99f * nearest, none))
+			++wrongNearest;
+	}
+
+	CHECK(wrongNearest == 0);
+	CHECK(wrongNearestPoint == 0);
+
+	// An empty hierarchy hits nothing.
+	bvh.Clear();
+	BvhHit hit;
+	CHECK(bvh.TriangleCount() == 0);
+	CHECK(!bvh.Intersect(XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), FLT_MAX, hit));
+	CHECK(!bvh.Occluded(XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), FLT_MAX));
+	CHECK(!bvh.Nearest(XMVectorZero(), FLT_MAX, hit));
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,243 @@
+// ConvexHull and ConvexDecomposition: every hull is closed and convex with
+// outward planes matching its triangles, holds the points it was built
+// from unless cut short by a budget it keeps to, and the pieces of a mesh
+// cover it with less volume than its one hull.
+
+#include "Check.h"
+#include "ConvexDecomposition.h"
+#include "ConvexHull.h"
+#include "GeometryGenerator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct HullCheck
+	{
+		std::uint32_t OpenEdges = 0;
+		std::uint32_t Concave = 0;
+		std::uint32_t BadPlanes = 0;
+		std::uint32_t Outside = 0;
+		double Volume = 0.0;
+	};
+
+	// Points count as outside further out than the tens of tolerances the
+	// hull allows itself.
+	HullCheck CheckHull(const ConvexHull& hull, const XMFLOAT3* points, std::uint32_t count)
+	{
+		HullCheck check;
+		const std::vector<XMFLOAT3>& vertices = hull.Vertices();
+		const std::vector<std::uint32_t>& indices = hull.Indices();
+		const std::vector<XMFLOAT4>& planes = hull.Planes();
+		const float tolerance = hull.Tolerance();
+
+		std::map<std::pair<std::uint32_t, std::uint32_t>, int> edges;
+		for (std::uint32_t t = 0; t < hull.TriangleCount(); ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+				edges[std::make_pair(indices[3 * t + e], indices[3 * t + (e + 1) % 3])]++;
+
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[3 * t]]);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[3 * t + 1]]);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[3 * t + 2]]);
+			XMVECTOR face = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			check.Volume += XMVectorGetX(XMVector3Dot(a, face)) / 6.0;
+
+			// The plane is the triangle's, facing the same way.
+			XMVECTOR normal = XMVectorSet(planes[t].x, planes[t].y, planes[t].z, 0.0f);
+			float alignment = XMVectorGetX(XMVector3Dot(XMVector3Normalize(face), normal));
+			float offset = XMVectorGetX(XMVector3Dot(normal, a)) + planes[t].w;
+			check.BadPlanes += std::fabs(XMVectorGetX(XMVector3Length(normal)) - 1.0f) > 1e-4f || alignment < 0.999f
+				|| std::fabs(offset) > tolerance;
+
+			for (const XMFLOAT3& v : vertices)
+				check.Concave += planes[t].x * v.x + planes[t].y * v.y + planes[t].z * v.z + planes[t].w > tolerance;
+		}
+
+		for (const std::pair<const std::pair<std::uint32_t, std::uint32_t>, int>& edge : edges)
+		{
+			std::map<std::pair<std::uint32_t, std::uint32_t>, int>::const_iterator reverse
+				= edges.find(std::make_pair(edge.first.second, edge.first.first));
+			check.OpenEdges += edge.second != 1 || reverse == edges.end() || reverse->second != 1;
+		}
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			float out = -FLT_MAX;
+			for (const XMFLOAT4& plane : planes)
+				out = std::max(out, plane.x * points[i].x + plane.y * points[i].y + plane.z * points[i].z + plane.w);
+			check.Outside += out > 50.0f * tolerance;
+		}
+
+		return check;
+	}
+
+	bool Valid(const HullCheck& check)
+	{
+		return check.OpenEdges == 0 && check.Concave == 0 && check.BadPlanes == 0;
+	}
+
+	// Two boxes a little apart, as one mesh.
+	void MakeBoxes(std::vector<XMFLOAT3>& positions, std::vector<std::uint32_t>& indices)
+	{
+		GeometryGenerator generator;
+		GeometryGenerator::MeshData box = generator.CreateBox(1.0f, 2.0f, 1.0f, 0);
+		const XMFLOAT3 offsets[] = { { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.5f, 0.0f } };
+		for (const XMFLOAT3& offset : offsets)
+		{
+			std::uint32_t base = (std::uint32_t)positions.size();
+			for (const GeometryGenerator::Vertex& vertex : box.Vertices)
+				positions.push_back(XMFLOAT3(vertex.Position.x + offset.x, vertex.Position.y + offset.y, vertex.Position.z + offset.z));
+			for (std::uint32_t index : box.Indices32)
+				indices.push_back(base + index);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	// A cloud in a ball, with some points on the sphere around it.
+	std::vector<XMFLOAT3> cloud;
+	for (int i = 0; i < 20000; ++i)
+	{
+		XMVECTOR p = XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+		float length = XMVectorGetX(XMVector3Length(p));
+		if (length > 1.0f || length == 0.0f)
+			continue;
+		if (i % 10 == 0)
+			p = XMVectorScale(p, 1.0f / length);
+		XMFLOAT3 point;
+		XMStoreFloat3(&point, p);
+		cloud.push_back(point);
+	}
+
+	ConvexHull full;
+	CHECK(full.Build(cloud.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)cloud.size()));
+	HullCheck fullCheck = CheckHull(full, cloud.data(), (std::uint32_t)cloud.size());
+	std::printf("cloud: %zu points to %zu vertices, %u triangles, volume %.4f\n", cloud.size(), full.Vertices().size(),
+		full.TriangleCount(), full.Volume());
+	CHECK(Valid(fullCheck));
+	CHECK(fullCheck.Outside == 0);
+	CHECK(std::fabs(fullCheck.Volume - full.Volume()) < 1e-3 * full.Volume());
+	CHECK(full.Volume() < 4.0 / 3.0 * XM_PI && full.Volume() > 0.95 * 4.0 / 3.0 * XM_PI);
+
+	std::uint32_t notContained = 0;
+	for (const XMFLOAT3& point : cloud)
+		notContained += !full.Contains(XMLoadFloat3(&point)) && CheckHull(full, &point, 1).Outside != 0;
+	CHECK(notContained == 0);
+	CHECK(!full.Contains(XMVectorSet(1.1f, 0.0f, 0.0f, 1.0f)));
+	CHECK(full.Contains(XMVectorZero()));
+
+	// Under budgets, still valid, within them, and smaller the fewer.
+	float previous = 0.0f;
+	for (std::uint32_t budget : { 4u, 8u, 16u, 64u })
+	{
+		ConvexHull hull;
+		CHECK(hull.Build(cloud.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)cloud.size(), budget));
+		HullCheck check = CheckHull(hull, cloud.data(), (std::uint32_t)cloud.size());
+		std::printf("budget %2u: %zu vertices, volume %.4f, %u points left out\n", budget, hull.Vertices().size(), hull.Volume(),
+			check.Outside);
+		CHECK(Valid(check));
+		CHECK(hull.Vertices().size() <= budget);
+		CHECK(hull.Volume() > previous && hull.Volume() <= full.Volume() * 1.0001f);
+		previous = hull.Volume();
+	}
+
+	// A cube's corners with points across its faces and repeated: the
+	// hull is the cube, whatever points on its faces start it off.
+	{
+		std::vector<XMFLOAT3> points;
+		for (int i = 0; i < 3000; ++i)
+		{
+			XMFLOAT3 p(unit(random), unit(random), unit(random));
+			(&p.x)[i % 3] = i % 2 ? 1.0f : -1.0f;
+			points.push_back(p);
+		}
+		for (int c = 0; c < 8; ++c)
+			for (int repeat = 0; repeat < 3; ++repeat)
+				points.push_back(XMFLOAT3(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? 1.0f : -1.0f));
+
+		ConvexHull cube;
+		CHECK(cube.Build(points.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)points.size()));
+		HullCheck check = CheckHull(cube, points.data(), (std::uint32_t)points.size());
+		CHECK(Valid(check) && check.Outside == 0);
+		std::uint32_t corners = 0;
+		std::uint32_t offSurface = 0;
+		for (const XMFLOAT3& v : cube.Vertices())
+		{
+			float a[3] = { std::fabs(v.x), std::fabs(v.y), std::fabs(v.z) };
+			corners += a[0] == 1.0f && a[1] == 1.0f && a[2] == 1.0f;
+			offSurface += std::max(std::max(a[0], a[1]), a[2]) != 1.0f;
+		}
+		CHECK(corners == 8 && offSurface == 0);
+		CHECK(cube.Vertices().size() < 16 && cube.TriangleCount() == 2 * cube.Vertices().size() - 4);
+		CHECK(std::fabs(cube.Volume() - 8.0f) < 1e-4f);
+	}
+
+	// Flat points make no hull.
+	{
+		std::vector<XMFLOAT3> flat;
+		for (int i = 0; i < 100; ++i)
+			flat.push_back(XMFLOAT3(unit(random), 0.5f * unit(random), 0.0f));
+		ConvexHull hull;
+		CHECK(!hull.Build(flat.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)flat.size()));
+		CHECK(hull.Vertices().empty() && hull.TriangleCount() == 0);
+	}
+
+	// Two boxes apart come out as at least two pieces, each a valid hull
+	// within its budget, covering every corner, with far less volume than
+	// the one hull around both.
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<std::uint32_t> indices;
+		MakeBoxes(positions, indices);
+
+		ConvexHull whole;
+		whole.Build(positions.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)positions.size());
+
+		ConvexDecomposition pieces;
+		pieces.Build(positions.data(), (std::uint32_t)sizeof(XMFLOAT3), indices.data(), (std::uint32_t)indices.size() / 3, 64, 8,
+			0.01f, 16);
+
+		std::uint32_t invalid = 0;
+		std::uint32_t overBudget = 0;
+		double volume = 0.0;
+		for (const ConvexHull& hull : pieces.Hulls())
+		{
+			invalid += !Valid(CheckHull(hull, nullptr, 0));
+			overBudget += hull.Vertices().size() > 16;
+			volume += hull.Volume();
+		}
+
+		std::uint32_t uncovered = 0;
+		for (const XMFLOAT3& position : positions)
+		{
+			bool covered = false;
+			for (const ConvexHull& hull : pieces.Hulls())
+				covered = covered || hull.Contains(XMLoadFloat3(&position));
+			uncovered += !covered;
+		}
+
+		std::printf("boxes: %zu pieces, concavity %.4f, volume %.4f against %.4f for one hull and 4 exactly\n", pieces.Hulls().size(),
+			pieces.Concavity(), volume, whole.Volume());
+		CHECK(pieces.Hulls().size() >= 2 && pieces.Hulls().size() <= 8);
+		CHECK(pieces.Concavity() <= 0.01f || pieces.Hulls().size() == 8);
+		CHECK(invalid == 0 && overBudget == 0);
+		CHECK(uncovered == 0);
+		CHECK(volume >= 4.0 && volume < 0.75 * whole.Volume());
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,271 @@
+// DistanceField against exact distances: a box, whose signed distance is
+// known in closed form, and a geosphere, measured to every triangle.  The
+// samples are within their quantization of the truth, points between them
+// within a fraction of a voxel, signs are right everywhere in the grid, and
+// sphere tracing stops where a ray meets the mesh.
+
+#include "Check.h"
+#include "Bvh.h"
+#include "DistanceField.h"
+#include "GeometryGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef GeometryGenerator::MeshData MeshData;
+
+	const XMFLOAT3 HalfBox(0.75f, 0.5f, 0.4f);
+
+	float BoxDistance(const XMFLOAT3& point)
+	{
+		float q[3] = { std::fabs(point.x) - HalfBox.x, std::fabs(point.y) - HalfBox.y, std::fabs(point.z) - HalfBox.z };
+		float outside = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			outside += std::max(q[k], 0.0f) * std::max(q[k], 0.0f);
+		return std::sqrt(outside) + std::min(std::max(std::max(q[0], q[1]), q[2]), 0.0f);
+	}
+
+	// The nearest point of triangle abc to p (Ericson 5.1.5).
+	XMVECTOR ClosestOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = XMVectorSubtract(b, a);
+		XMVECTOR ac = XMVectorSubtract(c, a);
+		XMVECTOR ap = XMVectorSubtract(p, a);
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		XMVECTOR bp = XMVectorSubtract(p, b);
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+
+		XMVECTOR cp = XMVectorSubtract(p, c);
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+	}
+
+	// Measured to every triangle, negative behind all of them, which is
+	// inside for a convex mesh.
+	float ConvexMeshDistance(const MeshData& mesh, const XMFLOAT3& p)
+	{
+		XMVECTOR point = XMLoadFloat3(&p);
+		float nearest = FLT_MAX;
+		bool inside = true;
+		for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t]].Position);
+			XMVECTOR b = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 1]].Position);
+			XMVECTOR c = XMLoadFloat3(&mesh.Vertices[mesh.Indices32[t + 2]].Position);
+			nearest = std::min(nearest, XMVectorGetX(XMVector3Length(XMVectorSubtract(point, ClosestOnTriangle(point, a, b, c)))));
+
+			XMVECTOR face = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			inside = inside && XMVectorGetX(XMVector3Dot(face, XMVectorSubtract(point, a))) < 0.0f;
+		}
+		return inside ? -nearest : nearest;
+	}
+
+	struct FieldCheck
+	{
+		float WorstAtSamples = 0.0f;
+		float WorstBetween = 0.0f;
+		double MeanBetween = 0.0;
+		std::uint32_t WrongSigns = 0;
+		std::uint32_t WrongOutsideBand = 0;
+	};
+
+	FieldCheck CheckField(const DistanceField& field, const std::function<float(const XMFLOAT3&)>& exact, std::mt19937& random)
+	{
+		FieldCheck check;
+		const float size = field.VoxelSize();
+		const float band = field.Band();
+		const float step = band / 127.0f;
+		const XMFLOAT3 origin = field.Origin();
+		const std::uint32_t n = field.Resolution();
+
+		// Every sample, at the voxel centers.
+		for (std::uint32_t z = 0; z < n; ++z)
+			for (std::uint32_t y = 0; y < n; ++y)
+				for (std::uint32_t x = 0; x < n; ++x)
+				{
+					XMFLOAT3 p(origin.x + (x + 0.5f) * size, origin.y + (y + 0.5f) * size, origin.z + (z + 0.5f) * size);
+					float truth = exact(p);
+					float sampled = field.Sample(XMLoadFloat3(&p));
+
+					if (std::fabs(truth) < band)
+						check.WorstAtSamples = std::max(check.WorstAtSamples, std::fabs(sampled - truth));
+					else
+						check.WrongOutsideBand += std::fabs(std::fabs(sampled) - band) > 1e-6f;
+
+					// Within a step of the surface either sign will do.
+					check.WrongSigns += std::fabs(truth) > step && (sampled < 0.0f) != (truth < 0.0f);
+				}
+
+		// Anywhere in the band, between samples.
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const float side = n * size;
+		std::uint32_t count = 0;
+		while (count < 20000)
+		{
+			XMFLOAT3 p(origin.x + side * unit(random), origin.y + side * unit(random), origin.z + side * unit(random));
+			float truth = exact(p);
+			if (std::fabs(truth) > band - size)
+				continue;
+
+			float error = std::fabs(field.Sample(XMLoadFloat3(&p)) - truth);
+			check.WorstBetween = std::max(check.WorstBetween, error);
+			check.MeanBetween += error;
+			++count;
+		}
+		check.MeanBetween /= count;
+
+		return check;
+	}
+
+	DistanceField Bake(const MeshData& mesh, std::uint32_t resolution, float band)
+	{
+		Bvh bvh;
+		bvh.Build(&mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), mesh.Indices32.data(),
+			(std::uint32_t)mesh.Indices32.size() / 3);
+
+		DistanceField field;
+		field.Bake(&mesh.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), mesh.Indices32.data(),
+			(std::uint32_t)mesh.Indices32.size() / 3, bvh, resolution, band);
+		return field;
+	}
+}
+
+int main()
+{
+	GeometryGenerator generator;
+	std::mt19937 random(11);
+
+	MeshData box = generator.CreateBox(2.0f * HalfBox.x, 2.0f * HalfBox.y, 2.0f * HalfBox.z, 0);
+	MeshData sphere = generator.CreateGeosphere(1.0f, 2);
+
+	struct Case
+	{
+		const char* Name;
+		const MeshData* Mesh;
+		std::function<float(const XMFLOAT3&)> Exact;
+	};
+	const Case cases[] =
+	{
+		{ "box", &box, BoxDistance },
+		{ "geosphere", &sphere, [&](const XMFLOAT3& p) { return ConvexMeshDistance(sphere, p); } },
+	};
+
+	for (const Case& c : cases)
+	{
+		// 60 rounds up to 64, several bricks a side.
+		DistanceField field = Bake(*c.Mesh, 60, 4.0f);
+		CHECK(field.Resolution() == 64);
+		CHECK(std::fabs(field.Band() - 4.0f * field.VoxelSize()) < 1e-6f);
+
+		FieldCheck check = CheckField(field, c.Exact, random);
+		const float size = field.VoxelSize();
+		std::printf("%-10s voxel %.4f, %u bricks, %zu bytes: worst %.5f at samples, %.5f between (mean %.5f)\n", c.Name, size,
+			field.BrickCount(), field.SizeInBytes(), check.WorstAtSamples, check.WorstBetween, check.MeanBetween);
+
+		// Half a step of the bytes the band is stored in, plus rounding.
+		CHECK(check.WorstAtSamples <= 0.5f * field.Band() / 127.0f + 1e-5f);
+
+		// Trilinear rounds off the kinks where the nearest face changes,
+		// inside along the box's diagonals, by no more than half a voxel.
+		CHECK(check.WorstBetween < 0.5f * size);
+		CHECK(check.MeanBetween < 0.02 * size);
+		CHECK(check.WrongSigns == 0);
+		CHECK(check.WrongOutsideBand == 0);
+
+		// Only bricks near the surface keep samples.
+		CHECK(field.BrickCount() > 0 && field.BrickCount() < 8 * 8 * 8);
+	}
+
+	// Sphere tracing toward the mesh from all round stops where the ray
+	// meets it, give or take the field's own error.
+	{
+		DistanceField field = Bake(sphere, 64, 4.0f);
+		Bvh bvh;
+		bvh.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+			(std::uint32_t)sphere.Indices32.size() / 3);
+
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		float worst = 0.0f;
+		std::uint32_t wrong = 0;
+		for (int i = 0; i < 500; ++i)
+		{
+			XMVECTOR origin = XMVectorScale(XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0.0f)), 3.0f);
+			XMVECTOR target = XMVectorSet(0.5f * unit(random), 0.5f * unit(random), 0.5f * unit(random), 1.0f);
+			XMVECTOR direction = XMVectorSubtract(target, origin);
+			float length = XMVectorGetX(XMVector3Length(direction));
+
+			BvhHit hit;
+			float distance;
+			bool traced = field.SphereTrace(origin, direction, 1.0f, distance);
+			wrong += !traced || !bvh.Intersect(origin, direction, 1.0f, hit);
+			if (!traced)
+				continue;
+
+			worst = std::max(worst, std::fabs(hit.Distance - distance) * length);
+		}
+		std::printf("traces: worst %.5f from the hit, %u wrong\n", worst, wrong);
+		CHECK(wrong == 0);
+		CHECK(worst < 0.25f * field.VoxelSize());
+
+		// Away from it, nothing, and not so far, nothing.
+		float distance;
+		CHECK(!field.SphereTrace(XMVectorSet(-3.0f, 2.0f, 0.0f, 1.0f), XMVectorSet(6.0f, 0.0f, 0.0f, 0.0f), 1.0f, distance));
+		CHECK(!field.SphereTrace(XMVectorSet(-3.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(6.0f, 0.0f, 0.0f, 0.0f), 0.25f, distance));
+
+		// A pool of its own, as a bake in the background uses, gives the
+		// same field however many threads it has.
+		ThreadPool serial(0);
+		DistanceField serialField;
+		serialField.Bake(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+			(std::uint32_t)sphere.Indices32.size() / 3, bvh, 64, 4.0f, serial);
+		CHECK(serialField.BrickCount() == field.BrickCount());
+		std::uint32_t different = 0;
+		for (int i = 0; i < 1000; ++i)
+		{
+			XMVECTOR p = XMVectorSet(1.5f * unit(random), 1.5f * unit(random), 1.5f * unit(random), 1.0f);
+			different += serialField.Sample(p) != field.Sample(p);
+		}
+		CHECK(different == 0);
+	}
+
+	// Nothing to bake is empty.
+	DistanceField empty;
+	Bvh none;
+	empty.Bake(&box.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), box.Indices32.data(), 0, none, 64, 4.0f);
+	CHECK(empty.Resolution() == 0 && empty.BrickCount() == 0);
+
+	return CHECK_RESULT();
+}
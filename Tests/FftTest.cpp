@@ -0,0 +1,180 @@
+// Fft against a direct DFT in double precision: forward and inverse agree
+// to float rounding at every size, an inverse after a forward gives back
+// the grid times size^2, and a transform run serially is the same bytes as
+// one split across the pool.
+
+#include "Check.h"
+#include "Fft.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// The 2D DFT by rows and then columns, each summed directly.
+	void Dft(std::uint32_t n, const std::vector<float>& real, const std::vector<float>& imag, bool inverse,
+		std::vector<double>& outReal, std::vector<double>& outImag)
+	{
+		const double sign = inverse ? 1.0 : -1.0;
+		std::vector<double> c(n);
+		std::vector<double> s(n);
+		for (std::uint32_t k = 0; k < n; ++k)
+		{
+			c[k] = std::cos(2.0 * Pi * k / n);
+			s[k] = sign * std::sin(2.0 * Pi * k / n);
+		}
+
+		std::vector<double> rowReal((size_t)n * n);
+		std::vector<double> rowImag((size_t)n * n);
+		for (std::uint32_t y = 0; y < n; ++y)
+			for (std::uint32_t k = 0; k < n; ++k)
+			{
+				double sumReal = 0.0;
+				double sumImag = 0.0;
+				for (std::uint32_t x = 0; x < n; ++x)
+				{
+					std::uint32_t w = x * k % n;
+					double a = real[y * n + x];
+					double b = imag[y * n + x];
+					sumReal += a * c[w] - b * s[w];
+					sumImag += a * s[w] + b * c[w];
+				}
+				rowReal[y * n + k] = sumReal;
+				rowImag[y * n + k] = sumImag;
+			}
+
+		outReal.assign((size_t)n * n, 0.0);
+		outImag.assign((size_t)n * n, 0.0);
+		for (std::uint32_t k = 0; k < n; ++k)
+			for (std::uint32_t x = 0; x < n; ++x)
+			{
+				double sumReal = 0.0;
+				double sumImag = 0.0;
+				for (std::uint32_t y = 0; y < n; ++y)
+				{
+					std::uint32_t w = y * k % n;
+					double a = rowReal[y * n + x];
+					double b = rowImag[y * n + x];
+					sumReal += a * c[w] - b * s[w];
+					sumImag += a * s[w] + b * c[w];
+				}
+				outReal[k * n + x] = sumReal;
+				outImag[k * n + x] = sumImag;
+			}
+	}
+
+	// The largest difference over the largest magnitude of the reference.
+	double RelativeError(const std::vector<float>& real, const std::vector<float>& imag, const std::vector<double>& expectedReal,
+		const std::vector<double>& expectedImag)
+	{
+		double worst = 0.0;
+		double largest = 0.0;
+		for (size_t i = 0; i < real.size(); ++i)
+		{
+			worst = std::max(worst, std::hypot(real[i] - expectedReal[i], imag[i] - expectedImag[i]));
+			largest = std::max(largest, std::hypot(expectedReal[i], expectedImag[i]));
+		}
+		return worst / largest;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	for (std::uint32_t n : { 4u, 8u, 16u, 32u, 128u })
+	{
+		Fft fft;
+		fft.Create(n);
+		CHECK(fft.Size() == n);
+
+		std::vector<float> real((size_t)n * n);
+		std::vector<float> imag((size_t)n * n);
+		for (size_t i = 0; i < real.size(); ++i)
+		{
+			real[i] = unit(random);
+			imag[i] = unit(random);
+		}
+
+		// A few float epsilons a stage.
+		const double tolerance = 4.0 * 1.2e-7 * std::log2((double)n);
+
+		for (bool inverse : { false, true })
+		{
+			std::vector<double> expectedReal, expectedImag;
+			Dft(n, real, imag, inverse, expectedReal, expectedImag);
+
+			std::vector<float> outReal = real;
+			std::vector<float> outImag = imag;
+			fft.Transform(outReal.data(), outImag.data(), inverse);
+
+			double error = RelativeError(outReal, outImag, expectedReal, expectedImag);
+			std::printf("%3u^2 %s: %.2e of the largest term\n", n, inverse ? "inverse" : "forward", error);
+			CHECK(error < tolerance);
+		}
+
+		// There and back, scaled by the size^2 neither direction divides by.
+		std::vector<float> roundReal = real;
+		std::vector<float> roundImag = imag;
+		fft.Transform(roundReal.data(), roundImag.data(), false);
+		fft.Transform(roundReal.data(), roundImag.data(), true);
+		float worst = 0.0f;
+		const float scale = 1.0f / ((float)n * n);
+		for (size_t i = 0; i < real.size(); ++i)
+			worst = std::max(worst, std::max(std::fabs(roundReal[i] * scale - real[i]), std::fabs(roundImag[i] * scale - imag[i])));
+		CHECK(worst < tolerance);
+
+		// Inside another parallel loop the strips run on this thread one
+		// after another, to the same bytes.
+		std::vector<float> pooledReal = real;
+		std::vector<float> pooledImag = imag;
+		fft.Transform(pooledReal.data(), pooledImag.data(), false);
+
+		std::vector<float> serialReal = real;
+		std::vector<float> serialImag = imag;
+		ThreadPool outer(1);
+		outer.ParallelFor(2, 1, [&](std::uint32_t begin, std::uint32_t)
+		{
+			if (begin == 0)
+				fft.Transform(serialReal.data(), serialImag.data(), false);
+		});
+		CHECK(std::memcmp(pooledReal.data(), serialReal.data(), real.size() * sizeof(float)) == 0);
+		CHECK(std::memcmp(pooledImag.data(), serialImag.data(), imag.size() * sizeof(float)) == 0);
+	}
+
+	// A single wave comes out as a single spike where its frequency is.
+	{
+		const std::uint32_t n = 64;
+		Fft fft;
+		fft.Create(n);
+		std::vector<float> real((size_t)n * n);
+		std::vector<float> imag((size_t)n * n);
+		for (std::uint32_t y = 0; y < n; ++y)
+			for (std::uint32_t x = 0; x < n; ++x)
+			{
+				double phase = 2.0 * Pi * (3.0 * x + 5.0 * y) / n;
+				real[y * n + x] = (float)std::cos(phase);
+				imag[y * n + x] = (float)std::sin(phase);
+			}
+
+		fft.Transform(real.data(), imag.data(), false);
+		float elsewhere = 0.0f;
+		for (size_t i = 0; i < real.size(); ++i)
+		{
+			if (i != 5 * n + 3)
+				elsewhere = std::max(elsewhere, std::hypot(real[i], imag[i]));
+		}
+		CHECK(std::fabs(real[5 * n + 3] - (float)(n * n)) < 1e-3f * n * n && std::fabs(imag[5 * n + 3]) < 1e-3f * n * n);
+		CHECK(elsewhere < 1e-3f * n * n);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,151 @@
+// FramePacer against a clock the test controls: cadence, spinning, wakes
+// while active and idle, the idle rate, and which frames the stats count.
+
+#include "Check.h"
+#include "FramePacer.h"
+#include <cstdint>
+
+namespace
+{
+	// Microsecond ticks.  Sleeps oversleep by a fixed amount unless woken,
+	// in which case they return at once; spins take 10 us each.
+	class FakeClock : public PacingClock
+	{
+	public:
+		std::int64_t Time = 1;
+		std::int64_t Oversleep = 300;
+		bool Woken = false;
+		std::uint32_t Sleeps = 0;
+		std::uint32_t Spins = 0;
+
+		std::int64_t Now() override { return Time; }
+		std::int64_t TicksPerSecond() override { return 1000000; }
+
+		void Sleep(std::int64_t ticks) override
+		{
+			++Sleeps;
+			if (Woken)
+				Woken = false;
+			else
+				Time += ticks + Oversleep;
+		}
+
+		void Wake() override { Woken = true; }
+
+		void Spin() override
+		{
+			++Spins;
+			Time += 10;
+		}
+	};
+
+	// Runs count frames of workTicks each and returns the spins they took.
+	std::uint32_t RunFrames(FramePacer& pacer, FakeClock& clock, std::uint32_t count, std::int64_t workTicks)
+	{
+		std::uint32_t spins = clock.Spins;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			pacer.WaitForNextFrame();
+			clock.Time += workTicks;
+		}
+		return clock.Spins - spins;
+	}
+}
+
+int main()
+{
+	// Capped at 100 fps: frames start on 10 ms deadlines, sleeping until
+	// the 2 ms spin threshold and spinning the rest.
+	{
+		FakeClock clock;
+		FramePacer pacer(&clock);
+		pacer.SetTargetFrameRate(100.0);
+
+		std::uint32_t spins = RunFrames(pacer, clock, 50, 3000);
+
+		const PacingStats& stats = pacer.Stats();
+		CHECK(stats.FrameCount == 50);
+		CHECK_NEAR(stats.MeanInterval, 0.010, 1e-5);
+		CHECK(stats.MaxError < 20e-6);
+		CHECK(spins <= 50 * (2000 - 300) / 10 + 50);
+	}
+
+	// A Wake while active, here one left latched from the previous frame,
+	// must not end the sleep and leave the frame to spin out its period.
+	{
+		FakeClock clock;
+		FramePacer pacer(&clock);
+		pacer.SetTargetFrameRate(100.0);
+		RunFrames(pacer, clock, 5, 1000);
+
+		pacer.Wake();
+		std::uint32_t spins = RunFrames(pacer, clock, 1, 0);
+
+		CHECK(spins <= (2000 - 300) / 10 + 1);
+		CHECK(!clock.Woken);
+		CHECK(pacer.Stats().MaxError < 20e-6);
+	}
+
+	// Idle: only sleeping, a Wake starts the frame at once, and none of it
+	// is counted.
+	{
+		FakeClock clock;
+		FramePacer pacer(&clock);
+		pacer.SetTargetFrameRate(100.0);
+		RunFrames(pacer, clock, 10, 1000);
+		std::uint32_t activeFrames = pacer.Stats().FrameCount;
+		double activeInterval = pacer.Stats().MeanInterval;
+
+		pacer.SetIdle(true);
+		CHECK(RunFrames(pacer, clock, 5, 1000) == 0);
+		CHECK(pacer.Stats().FrameCount == activeFrames);
+
+		std::int64_t before = clock.Time;
+		pacer.Wake();
+		pacer.WaitForNextFrame();
+		CHECK(clock.Time == before);
+
+		// Back to active; the idle gap is not an interval.
+		pacer.SetIdle(false);
+		RunFrames(pacer, clock, 10, 1000);
+		CHECK(pacer.Stats().FrameCount == activeFrames + 10);
+		CHECK_NEAR(pacer.Stats().MeanInterval, activeInterval, 1e-5);
+	}
+
+	// The idle rate starts at 10 fps and halves every second idle, down to
+	// 2 fps.
+	{
+		FakeClock clock;
+		clock.Oversleep = 0;
+		FramePacer pacer(&clock);
+		pacer.SetIdleFrameRate(10.0, 2.0);
+		pacer.SetIdle(true);
+
+		std::int64_t start = clock.Time;
+		pacer.WaitForNextFrame();
+		CHECK(clock.Time - start == 100000);
+
+		clock.Time = start + 1100000;
+		std::int64_t before = clock.Time;
+		pacer.WaitForNextFrame();
+		pacer.WaitForNextFrame();
+		CHECK(clock.Time - before >= 200000 - 1 && clock.Time - before <= 400000 + 1);
+
+		clock.Time = start + 5000000;
+		before = clock.Time;
+		pacer.WaitForNextFrame();
+		pacer.WaitForNextFrame();
+		CHECK(clock.Time - before >= 500000 - 1 && clock.Time - before <= 1000000 + 1);
+	}
+
+	// Uncapped frames neither sleep nor spin.
+	{
+		FakeClock clock;
+		FramePacer pacer(&clock);
+		RunFrames(pacer, clock, 10, 1000);
+		CHECK(clock.Sleeps == 0 && clock.Spins == 0);
+		CHECK(pacer.Stats().FrameCount == 10);
+	}
+
+	return CHECK_RESULT();
+}
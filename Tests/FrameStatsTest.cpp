@@ -0,0 +1,120 @@
+// FrameStats: exact recent percentiles, session percentiles within the
+// frames' range, and one stutter definition for both summaries.
+
+#include "Check.h"
+#include "FrameStats.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+int main()
+{
+	// 1 to 100 ms in random order, past the histogram's 64 ms.  The
+	// percentiles interpolate between the sorted samples.
+	{
+		static FrameStats stats;
+
+		std::vector<double> frames;
+		for (int ms = 1; ms <= 100; ++ms)
+			frames.push_back(ms);
+		std::shuffle(frames.begin(), frames.end(), std::mt19937(7));
+
+		for (double ms : frames)
+			stats.AddFrame(ms);
+
+		FrameStatsSummary recent = stats.SummarizeRecent(100);
+		CHECK(recent.FrameCount == 100);
+		CHECK_NEAR(recent.MinMs, 1.0, 1e-9);
+		CHECK_NEAR(recent.MaxMs, 100.0, 1e-9);
+		CHECK_NEAR(recent.AvgMs, 50.5, 1e-9);
+		CHECK_NEAR(recent.P50Ms, 50.5, 1e-6);
+		CHECK_NEAR(recent.P95Ms, 95.05, 1e-6);
+		CHECK_NEAR(recent.P99Ms, 99.01, 1e-6);
+
+		// Fewer frames than asked for, and a window of the most recent.
+		CHECK(stats.SummarizeRecent(1000).FrameCount == 100);
+		FrameStatsSummary last = stats.SummarizeRecent(1);
+		CHECK_NEAR(last.P50Ms, frames.back(), 1e-9);
+		CHECK_NEAR(last.P99Ms, frames.back(), 1e-9);
+	}
+
+	// Every frame past the histogram: session percentiles stay at the
+	// frames' actual time rather than the overflow bucket's edge.
+	{
+		static FrameStats stats;
+		for (int i = 0; i < 500; ++i)
+			stats.AddFrame(100.0);
+
+		FrameStatsSummary session = stats.SummarizeSession();
+		CHECK_NEAR(session.P50Ms, 100.0, 1e-9);
+		CHECK_NEAR(session.P99Ms, 100.0, 1e-9);
+
+		// And inside the histogram, within a bucket of the exact figure.
+		static FrameStats steady;
+		for (int i = 0; i < 500; ++i)
+			steady.AddFrame(16.6);
+
+		session = steady.SummarizeSession();
+		CHECK(session.P50Ms >= session.MinMs && session.P50Ms <= session.MaxMs);
+		CHECK_NEAR(session.P95Ms, 16.6, FrameStats::BucketWidthMs);
+	}
+
+	// A steady 10 ms with two long frames, then a sustained slowdown.  The
+	// first long frames are stutters; once the average catches up with the
+	// slowdown its frames are not.  Both summaries agree.
+	{
+		static FrameStats stats;
+		for (int i = 0; i < 200; ++i)
+			stats.AddFrame(10.0);
+		stats.AddFrame(35.0);
+		for (int i = 0; i < 100; ++i)
+			stats.AddFrame(10.0);
+		stats.AddFrame(50.0);
+		for (int i = 0; i < 100; ++i)
+			stats.AddFrame(10.0);
+
+		CHECK(stats.SummarizeSession().StutterCount == 2);
+		CHECK(stats.SummarizeRecent(FrameStats::RingSize).StutterCount == 2);
+		CHECK(stats.SummarizeRecent(100).StutterCount == 0);
+		CHECK(stats.SummarizeRecent(101).StutterCount == 1);
+
+		std::uint32_t before = stats.SummarizeSession().StutterCount;
+		for (int i = 0; i < 400; ++i)
+			stats.AddFrame(25.0);
+
+		std::uint32_t slowdown = stats.SummarizeSession().StutterCount - before;
+		CHECK(slowdown > 0 && slowdown < 10);
+		CHECK(stats.SummarizeRecent(400).StutterCount == slowdown);
+		CHECK(stats.SummarizeRecent(300).StutterCount == 0);
+	}
+
+	// The JSON has both summaries and the histogram.
+	{
+		static FrameStats stats;
+		for (int i = 0; i < 10; ++i)
+			stats.AddFrame(5.0 + i);
+
+		const char* path = "FrameStatsTest.json";
+		CHECK(stats.WriteJson(path));
+
+		std::vector<char> text(4096, 0);
+		FILE* file = std::fopen(path, "r");
+		CHECK(file != nullptr);
+		if (file)
+		{
+			std::fread(text.data(), 1, text.size() - 1, file);
+			std::fclose(file);
+		}
+		std::remove(path);
+
+		std::string json(text.data());
+		CHECK(json.find("\"recent\": { \"frames\": 10") != std::string::npos);
+		CHECK(json.find("\"session\": { \"frames\": 10") != std::string::npos);
+		CHECK(json.find("\"histogram\"") != std::string::npos);
+	}
+
+	return CHECK_RESULT();
+}
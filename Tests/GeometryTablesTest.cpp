@@ -0,0 +1,79 @@
+// GeometryTables against GeometryGenerator: every table is worked out at
+// compile time, has the runtime mesh's indices exactly, and its vertices to
+// within the last bit of the trigonometry.
+
+#include "Check.h"
+#include "GeometryTables.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+namespace
+{
+	// Each is a constant expression, or this file would not compile.
+	constexpr auto Box0 = GeometryTables::Box<0>(1.0f, 2.0f, 3.0f);
+	constexpr auto Box3 = GeometryTables::Box<3>(1.0f, 2.0f, 3.0f);
+	constexpr auto Sphere = GeometryTables::UVSphere<60, 60>(1.0f);
+	constexpr auto SmallSphere = GeometryTables::UVSphere<7, 5>(2.5f);
+	constexpr auto Geosphere0 = GeometryTables::Geosphere<0>(1.0f);
+	constexpr auto Geosphere1 = GeometryTables::Geosphere<1>(2.0f);
+	constexpr auto Geosphere3 = GeometryTables::Geosphere<3>(1.0f);
+	constexpr auto Quad = GeometryTables::Quad(-1.0f, 1.0f, 2.0f, 2.0f, 0.0f);
+
+	static_assert(decltype(Sphere)::VertexCount == 2 + 59 * 61 && decltype(Sphere)::IndexCount == 6 * 60 * 59, "UVSphere sizes");
+	static_assert(decltype(Box3)::VertexCount == 6 * 12 * 16 && decltype(Box3)::IndexCount == 36 * 64, "Box sizes");
+	static_assert(Geosphere0.Indices[0] == 1 && Sphere.Vertices[0].Position.y == 1.0f, "Tables are readable at compile time");
+
+	// Vertices differing in more than this, or any index, count as wrong.
+	const float Tolerance = 1e-6f;
+
+	template<std::uint32_t VertexCount, std::uint32_t IndexCount>
+	void Compare(const char* name, const GeometryTables::BakedMesh<VertexCount, IndexCount>& table,
+		const GeometryGenerator::MeshData& mesh)
+	{
+		CHECK(mesh.Vertices.size() == VertexCount && mesh.Indices32.size() == IndexCount);
+		if (mesh.Vertices.size() != VertexCount || mesh.Indices32.size() != IndexCount)
+			return;
+
+		std::uint32_t wrongIndices = 0;
+		for (std::uint32_t i = 0; i < IndexCount; ++i)
+			wrongIndices += table.Indices[i] != mesh.Indices32[i];
+
+		// Position, normal, tangent and texture coordinates, eleven floats.
+		float worst = 0.0f;
+		for (std::uint32_t i = 0; i < VertexCount; ++i)
+		{
+			const float* a = &table.Vertices[i].Position.x;
+			const float* b = &mesh.Vertices[i].Position.x;
+			for (int k = 0; k < 11; ++k)
+				worst = std::fmax(worst, std::fabs(a[k] - b[k]));
+		}
+
+		std::printf("%-12s %5u vertices %6u indices, worst difference %g\n", name, VertexCount, IndexCount, worst);
+		CHECK(wrongIndices == 0);
+		CHECK(worst <= Tolerance);
+	}
+}
+
+int main()
+{
+	GeometryGenerator generator;
+
+	Compare("Box 0", Box0, generator.CreateBox(1.0f, 2.0f, 3.0f, 0));
+	Compare("Box 3", Box3, generator.CreateBox(1.0f, 2.0f, 3.0f, 3));
+	Compare("Sphere 60", Sphere, generator.CreateSphere(1.0f, 60, 60));
+	Compare("Sphere 7x5", SmallSphere, generator.CreateSphere(2.5f, 7, 5));
+	Compare("Geosphere 0", Geosphere0, generator.CreateGeosphere(1.0f, 0));
+	Compare("Geosphere 1", Geosphere1, generator.CreateGeosphere(2.0f, 1));
+	Compare("Geosphere 3", Geosphere3, generator.CreateGeosphere(1.0f, 3));
+	Compare("Quad", Quad, generator.CreateQuad(-1.0f, 1.0f, 2.0f, 2.0f, 0.0f));
+
+	// The MeshData copy is the table, and runs the 32-bit indices down to
+	// 16 bits like any other.
+	GeometryGenerator::MeshData copy = GeometryTables::ToMeshData(Geosphere3);
+	Compare("ToMeshData", Geosphere3, copy);
+	CHECK(copy.GetIndices16().size() == decltype(Geosphere3)::IndexCount);
+	CHECK(copy.GetIndices16()[7] == Geosphere3.Indices[7]);
+
+	return CHECK_RESULT();
+}
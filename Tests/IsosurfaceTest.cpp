@@ -0,0 +1,180 @@
+// GeometryGenerator::CreateIsosurface: surfaces inside the grid come out
+// closed and consistently wound across the seams between the blocks meshed
+// in parallel, lie on the field's zero set with the gradient's normals, and
+// are the same bytes whether meshed on the pool or serially, from a
+// callback or from samples.
+
+#include "Check.h"
+#include "GeometryGenerator.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef GeometryGenerator::MeshData MeshData;
+	typedef GeometryGenerator::uint32 uint32;
+
+	// Edges that are not matched by exactly one edge the other way, which
+	// is none on a closed, consistently wound mesh.
+	std::uint32_t OpenEdges(const MeshData& mesh)
+	{
+		std::unordered_map<std::uint64_t, int> directed;
+		for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+			for (int e = 0; e < 3; ++e)
+				directed[(std::uint64_t)mesh.Indices32[t + e] << 32 | mesh.Indices32[t + (e + 1) % 3]]++;
+
+		std::uint32_t open = 0;
+		for (const std::pair<const std::uint64_t, int>& edge : directed)
+		{
+			std::unordered_map<std::uint64_t, int>::const_iterator reverse = directed.find(edge.first >> 32 | edge.first << 32);
+			open += edge.second != 1 || reverse == directed.end() || reverse->second != 1;
+		}
+		return open;
+	}
+
+	// Triangles facing against their vertices' normals, and the volume the
+	// mesh encloses.
+	std::uint32_t Backfacing(const MeshData& mesh, double& volume)
+	{
+		std::uint32_t backfacing = 0;
+		volume = 0.0;
+		for (size_t t = 0; t < mesh.Indices32.size(); t += 3)
+		{
+			const GeometryGenerator::Vertex& a = mesh.Vertices[mesh.Indices32[t]];
+			const GeometryGenerator::Vertex& b = mesh.Vertices[mesh.Indices32[t + 1]];
+			const GeometryGenerator::Vertex& c = mesh.Vertices[mesh.Indices32[t + 2]];
+
+			XMVECTOR p0 = XMLoadFloat3(&a.Position);
+			XMVECTOR face = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b.Position), p0), XMVectorSubtract(XMLoadFloat3(&c.Position), p0));
+			XMVECTOR normals = XMVectorAdd(XMVectorAdd(XMLoadFloat3(&a.Normal), XMLoadFloat3(&b.Normal)), XMLoadFloat3(&c.Normal));
+
+			backfacing += XMVectorGetX(XMVector3Dot(face, normals)) < 0.0f;
+			volume += XMVectorGetX(XMVector3Dot(p0, face)) / 6.0;
+		}
+		return backfacing;
+	}
+
+	bool Same(const MeshData& a, const MeshData& b)
+	{
+		return a.Indices32 == b.Indices32 && a.Vertices.size() == b.Vertices.size()
+			&& std::memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(GeometryGenerator::Vertex)) == 0;
+	}
+
+	const float SphereRadius = 0.8f;
+
+	void Sphere(const float* xs, float y, float z, uint32 count, float* values)
+	{
+		for (uint32 i = 0; i < count; ++i)
+			values[i] = std::sqrt(xs[i] * xs[i] + y * y + z * z) - SphereRadius;
+	}
+
+	// Rounded to eighths, so many samples sit exactly on the surface and
+	// the mesher has to break the ties the same way in every cell.
+	void QuantizedTorus(const float* xs, float y, float z, uint32 count, float* values)
+	{
+		for (uint32 i = 0; i < count; ++i)
+		{
+			float q = std::sqrt(xs[i] * xs[i] + z * z) - 0.6f;
+			values[i] = std::round((std::sqrt(q * q + y * y) - 0.25f) * 8.0f) / 8.0f;
+		}
+	}
+}
+
+int main()
+{
+	GeometryGenerator generator;
+
+	// 80 samples a side is three blocks, so the surface crosses seams.
+	const uint32 n = 80;
+	const float cellSize = 2.2f / (n - 1);
+	const XMFLOAT3 origin(-1.1f, -1.1f, -1.1f);
+
+	MeshData sphere = generator.CreateIsosurface(Sphere, origin, cellSize, n, n, n, 0.0f);
+	{
+		double volume = 0.0;
+		std::uint32_t backfacing = Backfacing(sphere, volume);
+		double expected = 4.0 / 3.0 * XM_PI * SphereRadius * SphereRadius * SphereRadius;
+		std::printf("sphere: %zu vertices, %zu triangles, volume %.4f of %.4f\n", sphere.Vertices.size(), sphere.Indices32.size() / 3,
+			volume, expected);
+
+		CHECK(!sphere.Indices32.empty());
+		CHECK(OpenEdges(sphere) == 0);
+		CHECK(backfacing == 0);
+		CHECK(std::fabs(volume - expected) < 0.01 * expected);
+
+		// On the surface to within the linear interpolation's error, with
+		// unit normals pointing out.
+		float offSurface = 0.0f;
+		float offNormal = 0.0f;
+		for (const GeometryGenerator::Vertex& vertex : sphere.Vertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertex.Position);
+			XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+			offSurface = std::fmax(offSurface, std::fabs(XMVectorGetX(XMVector3Length(p)) - SphereRadius));
+			offNormal = std::fmax(offNormal, XMVectorGetX(XMVector3Length(XMVectorSubtract(normal, XMVector3Normalize(p)))));
+		}
+		CHECK(offSurface < 0.05f * cellSize);
+		CHECK(offNormal < 0.05f);
+	}
+
+	// The same field as samples.
+	{
+		std::vector<float> samples((size_t)n * n * n);
+		std::vector<float> xs(n);
+		for (uint32 x = 0; x < n; ++x)
+			xs[x] = origin.x + x * cellSize;
+		for (uint32 z = 0; z < n; ++z)
+			for (uint32 y = 0; y < n; ++y)
+				Sphere(xs.data(), origin.y + y * cellSize, origin.z + z * cellSize, n, &samples[((size_t)z * n + y) * n]);
+
+		CHECK(Same(generator.CreateIsosurface(samples.data(), origin, cellSize, n, n, n, 0.0f), sphere));
+	}
+
+	// Meshed from inside another parallel loop, where the blocks run one
+	// after another on this thread, it is the same mesh.
+	{
+		ThreadPool outer(1);
+		MeshData serial;
+		outer.ParallelFor(2, 1, [&](std::uint32_t begin, std::uint32_t)
+		{
+			if (begin == 0)
+				serial = generator.CreateIsosurface(Sphere, origin, cellSize, n, n, n, 0.0f);
+		});
+		CHECK(Same(serial, sphere));
+	}
+
+	{
+		MeshData torus = generator.CreateIsosurface(QuantizedTorus, origin, cellSize, n, n, n, 0.0f);
+		CHECK(!torus.Indices32.empty());
+		CHECK(OpenEdges(torus) == 0);
+
+		// The steps leave the gradient flat in places, so only the winding
+		// as a whole is checked.
+		double volume = 0.0;
+		Backfacing(torus, volume);
+		CHECK(volume > 0.0);
+	}
+
+	// A sphere cut by the grid stays inside it and is left open.
+	{
+		MeshData cut = generator.CreateIsosurface(Sphere, XMFLOAT3(0.0f, -1.1f, -1.1f), cellSize, n / 2, n, n, 0.0f);
+		std::uint32_t strays = 0;
+		for (const GeometryGenerator::Vertex& vertex : cut.Vertices)
+			strays += vertex.Position.x < 0.0f;
+		CHECK(!cut.Indices32.empty() && OpenEdges(cut) > 0);
+		CHECK(strays == 0);
+	}
+
+	// Nothing to mesh.
+	CHECK(generator.CreateIsosurface(Sphere, XMFLOAT3(5.0f, 5.0f, 5.0f), cellSize, n, n, n, 0.0f).Indices32.empty());
+	CHECK(generator.CreateIsosurface(Sphere, origin, cellSize, 1, n, n, 0.0f).Vertices.empty());
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,132 @@
+// MorphTargetSet against dense deltas: sparse storage keeps exactly the
+// vertices that move, and Apply matches the weighted sum within the
+// quantization step.
+
+#include "Check.h"
+#include "MorphTargets.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+int main()
+{
+	const std::uint32_t vertexCount = 20000;
+	const std::uint32_t targetCount = 50;
+	const std::uint32_t firstVertex = 100;
+	const float threshold = 1e-4f;
+
+	std::mt19937 random(34);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<XMFLOAT3> base(vertexCount);
+	for (XMFLOAT3& p : base)
+		p = XMFLOAT3(unit(random), unit(random), unit(random));
+
+	// Each target moves about a tenth of the vertices after firstVertex,
+	// and nudges a few by less than the threshold.
+	MorphTargetSet set;
+	std::vector<std::vector<XMFLOAT3>> dense(targetCount, std::vector<XMFLOAT3>(vertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f)));
+	std::vector<float> steps(targetCount);
+
+	for (std::uint32_t t = 0; t < targetCount; ++t)
+	{
+		std::uint32_t moved = 0;
+		std::vector<XMFLOAT3>& deltas = dense[t];
+		for (std::uint32_t i = firstVertex; i < vertexCount; ++i)
+		{
+			std::uint32_t roll = random() % 20;
+			if (roll < 2)
+			{
+				deltas[i] = XMFLOAT3(0.1f * unit(random), 0.1f * unit(random), 0.05f * unit(random));
+				++moved;
+			}
+			else if (roll == 2)
+			{
+				deltas[i] = XMFLOAT3(0.3f * threshold, 0.0f, 0.0f);
+			}
+		}
+
+		CHECK(set.AddTarget("Target " + std::to_string(t), firstVertex, deltas.data() + firstVertex, vertexCount - firstVertex, threshold) == t);
+
+		// Three components per kept vertex, and one slot of padding.
+		const MorphTarget& target = set.Target(t);
+		CHECK(target.Vertices.size() == moved);
+		CHECK(target.Deltas.size() == 3 * moved + 1);
+		for (size_t k = 1; k < target.Vertices.size(); ++k)
+			CHECK(target.Vertices[k] > target.Vertices[k - 1]);
+
+		// Half a quantization step of the widest component.
+		steps[t] = 0.5f * std::fmax(target.DeltaScale.x, std::fmax(target.DeltaScale.y, target.DeltaScale.z)) + 1e-7f;
+	}
+
+	CHECK(set.TargetCount() == targetCount);
+	CHECK(set.SizeInBytes() < targetCount * vertexCount * sizeof(XMFLOAT3) / 4);
+
+	// Every fifth weight zero, the rest anywhere in [-1, 1].
+	std::vector<float> weights(targetCount);
+	for (std::uint32_t t = 0; t < targetCount; ++t)
+		weights[t] = t % 5 == 0 ? 0.0f : unit(random);
+
+	struct Vertex
+	{
+		XMFLOAT3 Pos;
+		XMFLOAT4 Color;
+	};
+	std::vector<Vertex> out(vertexCount);
+	set.Apply(base.data(), vertexCount, weights.data(), &out[0].Pos, (std::uint32_t)sizeof(Vertex));
+
+	float tolerance = 0.0f;
+	for (std::uint32_t t = 0; t < targetCount; ++t)
+		tolerance += std::fabs(weights[t]) * steps[t];
+
+	float error = 0.0f;
+	for (std::uint32_t i = 0; i < vertexCount; ++i)
+	{
+		float expected[3] = { base[i].x, base[i].y, base[i].z };
+		for (std::uint32_t t = 0; t < targetCount; ++t)
+		{
+			const XMFLOAT3& d = dense[t][i];
+			if (d.x * d.x + d.y * d.y + d.z * d.z <= threshold * threshold)
+				continue;
+			expected[0] += weights[t] * d.x;
+			expected[1] += weights[t] * d.y;
+			expected[2] += weights[t] * d.z;
+		}
+
+		const float* got = &out[i].Pos.x;
+		for (int c = 0; c < 3; ++c)
+			error = std::fmax(error, std::fabs(got[c] - expected[c]));
+	}
+	CHECK(error <= tolerance);
+
+	// All weights zero: the base comes through untouched.
+	std::vector<float> zero(targetCount, 0.0f);
+	set.Apply(base.data(), vertexCount, zero.data(), &out[0].Pos, (std::uint32_t)sizeof(Vertex));
+	std::uint32_t changed = 0;
+	for (std::uint32_t i = 0; i < vertexCount; ++i)
+		if (out[i].Pos.x != base[i].x || out[i].Pos.y != base[i].y || out[i].Pos.z != base[i].z)
+			++changed;
+	CHECK(changed == 0);
+
+	// Weight tracks interpolate between frames and clamp or wrap past the end.
+	MorphWeightTrack track;
+	track.Duration = 1.0f;
+	track.SampleRate = 2.0f;
+	track.FrameCount = 3;
+	track.TargetCount = 2;
+	track.Weights = { 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+
+	float sampled[2];
+	track.Sample(0.25f, true, sampled);
+	CHECK(std::fabs(sampled[0] - 0.5f) < 1e-6f && std::fabs(sampled[1] - 0.5f) < 1e-6f);
+	track.Sample(3.0f, false, sampled);
+	CHECK(sampled[0] == 0.0f && sampled[1] == 1.0f);
+	track.Sample(1.25f, true, sampled);
+	CHECK(std::fabs(sampled[0] - 0.5f) < 1e-6f);
+
+	return CHECK_RESULT();
+}
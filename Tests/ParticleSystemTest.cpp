@@ -0,0 +1,329 @@
+// ParticleSystem against a plain array of particle structs updated one at
+// a time: after every update the same particles are alive, in whatever
+// order, with the same state, emitters fill up to capacity in order, the
+// particles are the same bytes however the pool runs them, and billboards
+// are the particles' quads.
+
+#include "Check.h"
+#include "ParticleSystem.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Particle
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Velocity;
+		float Age;
+		float Lifetime;
+		std::uint16_t Emitter;
+	};
+
+	// The same randomness as the system's, from each particle's serial
+	// number.
+	std::uint64_t Mix(std::uint64_t x)
+	{
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	float Unit(std::uint64_t& state)
+	{
+		state += 0x9e3779b97f4a7c15ull;
+		return (float)(Mix(state) >> 40) * (1.0f / 16777216.0f);
+	}
+
+	// Particles as structs, moved one after another and removed by
+	// erasing, with the system's rules written out directly.
+	class Reference
+	{
+	public:
+		Reference(std::uint32_t capacity, XMFLOAT3 gravity, std::uint32_t seed) : mCapacity(capacity), mGravity(gravity), mSeed(seed)
+		{
+		}
+
+		void AddEmitter(const ParticleEmitter& emitter)
+		{
+			mEmitters.push_back(emitter);
+			mCarry.push_back(0.0f);
+		}
+
+		void Update(float dt)
+		{
+			for (Particle& p : mParticles)
+			{
+				p.Velocity.x += mGravity.x * dt;
+				p.Velocity.y += mGravity.y * dt;
+				p.Velocity.z += mGravity.z * dt;
+				p.Position.x += p.Velocity.x * dt;
+				p.Position.y += p.Velocity.y * dt;
+				p.Position.z += p.Velocity.z * dt;
+				p.Age += dt;
+			}
+
+			mParticles.erase(std::remove_if(mParticles.begin(), mParticles.end(), [](const Particle& p) { return !(p.Age < p.Lifetime); }),
+				mParticles.end());
+
+			for (std::uint32_t e = 0; e < mEmitters.size(); ++e)
+			{
+				const ParticleEmitter& emitter = mEmitters[e];
+				float wanted = mCarry[e] + emitter.Rate * dt;
+				std::uint32_t count = (std::uint32_t)wanted;
+				mCarry[e] = wanted - (float)count;
+
+				for (std::uint32_t k = 0; k < count && mParticles.size() < mCapacity; ++k)
+				{
+					std::uint64_t state = Mix(mSeed ^ Mix(mEmitted++));
+					float z = 2.0f * Unit(state) - 1.0f;
+					float angle = XM_2PI * Unit(state);
+					float radius = emitter.Spread * std::cbrt(Unit(state));
+					float ring = radius * std::sqrt(std::max(1.0f - z * z, 0.0f));
+
+					Particle p;
+					p.Position = emitter.Position;
+					p.Velocity = XMFLOAT3(emitter.Velocity.x + ring * std::cos(angle), emitter.Velocity.y + ring * std::sin(angle),
+						emitter.Velocity.z + radius * z);
+					p.Age = 0.0f;
+					p.Lifetime = emitter.Lifetime * (0.5f + 0.5f * Unit(state));
+					p.Emitter = (std::uint16_t)e;
+					mParticles.push_back(p);
+				}
+			}
+		}
+
+		const std::vector<Particle>& Particles()const
+		{
+			return mParticles;
+		}
+
+	private:
+		std::uint32_t mCapacity;
+		XMFLOAT3 mGravity;
+		std::uint32_t mSeed;
+		std::uint64_t mEmitted = 0;
+		std::vector<ParticleEmitter> mEmitters;
+		std::vector<float> mCarry;
+		std::vector<Particle> mParticles;
+	};
+
+	std::vector<Particle> Gather(const ParticleSystem& system)
+	{
+		const ParticleArrays& p = system.Particles();
+		std::vector<Particle> particles(system.Count());
+		for (std::uint32_t i = 0; i < system.Count(); ++i)
+		{
+			particles[i].Position = XMFLOAT3(p.PositionX[i], p.PositionY[i], p.PositionZ[i]);
+			particles[i].Velocity = XMFLOAT3(p.VelocityX[i], p.VelocityY[i], p.VelocityZ[i]);
+			particles[i].Age = p.Age[i];
+			particles[i].Lifetime = p.Lifetime[i];
+			particles[i].Emitter = p.Emitter[i];
+		}
+		return particles;
+	}
+
+	// Lifetimes are drawn at random and never change, so they tell the
+	// particles apart once sorted.
+	void Sort(std::vector<Particle>& particles)
+	{
+		std::sort(particles.begin(), particles.end(), [](const Particle& a, const Particle& b)
+		{
+			return std::make_tuple(a.Lifetime, a.Emitter, a.Velocity.x, a.Velocity.y) < std::make_tuple(b.Lifetime, b.Emitter, b.Velocity.x, b.Velocity.y);
+		});
+	}
+
+	// The largest difference in position, velocity or age, or infinity
+	// when the particles differ in count, lifetime or emitter.
+	float Difference(std::vector<Particle> a, std::vector<Particle> b)
+	{
+		if (a.size() != b.size())
+			return INFINITY;
+
+		Sort(a);
+		Sort(b);
+		float worst = 0.0f;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].Lifetime != b[i].Lifetime || a[i].Emitter != b[i].Emitter)
+				return INFINITY;
+
+			const float* x = &a[i].Position.x;
+			const float* y = &b[i].Position.x;
+			for (int k = 0; k < 7; ++k)
+				worst = std::max(worst, std::fabs(x[k] - y[k]));
+		}
+		return worst;
+	}
+
+	ParticleEmitter MakeEmitter(XMFLOAT3 position, float rate, float lifetime)
+	{
+		ParticleEmitter emitter;
+		emitter.Position = position;
+		emitter.Rate = rate;
+		emitter.Velocity = XMFLOAT3(0.0f, 6.0f, 0.0f);
+		emitter.Spread = 1.5f;
+		emitter.Lifetime = lifetime;
+		emitter.Size = 0.04f;
+		emitter.Color = XMFLOAT4(1.0f, 0.75f, 0.35f, 1.0f);
+		return emitter;
+	}
+}
+
+int main()
+{
+	const XMFLOAT3 gravity(0.0f, -9.8f, 0.0f);
+
+	// The app's three fountains, in a pool big enough for all of them: a
+	// few thousand particles through several ranges, dying and compacting
+	// every update.
+	{
+		ParticleSystem system;
+		system.Create(32768, gravity, 0x7073);
+		Reference reference(32768, gravity, 0x7073);
+
+		const ParticleEmitter emitters[] =
+		{
+			MakeEmitter(XMFLOAT3(-6.0f, -2.8f, 4.0f), 4000.0f, 2.5f),
+			MakeEmitter(XMFLOAT3(6.0f, -2.8f, 4.0f), 4000.0f, 2.5f),
+			MakeEmitter(XMFLOAT3(0.0f, -2.8f, 8.0f), 3333.3f, 1.0f)
+		};
+		for (const ParticleEmitter& emitter : emitters)
+		{
+			system.AddEmitter(emitter);
+			reference.AddEmitter(emitter);
+		}
+
+		float worst = 0.0f;
+		std::uint32_t mismatched = 0;
+		for (int frame = 0; frame < 240; ++frame)
+		{
+			float dt = frame % 3 == 0 ? 1.0f / 30.0f : 1.0f / 60.0f;
+			system.Update(dt);
+			reference.Update(dt);
+
+			float difference = Difference(Gather(system), reference.Particles());
+			mismatched += std::isinf(difference);
+			if (!std::isinf(difference))
+				worst = std::max(worst, difference);
+		}
+		std::printf("fountains: %u particles, %u updates mismatched, worst difference %g\n", system.Count(), mismatched, worst);
+		CHECK(mismatched == 0);
+		CHECK(worst < 1e-4f);
+		CHECK(system.Count() > 15000 && system.Count() < 32768);
+	}
+
+	// Too small a pool: the emitters fill it in order, and the first takes
+	// what room there is before the second.
+	{
+		ParticleSystem system;
+		system.Create(1000, gravity, 5);
+		Reference reference(1000, gravity, 5);
+		for (ParticleEmitter emitter : { MakeEmitter(XMFLOAT3(0.0f, 0.0f, 0.0f), 120000.0f, 10.0f), MakeEmitter(XMFLOAT3(1.0f, 0.0f, 0.0f), 120000.0f, 10.0f) })
+		{
+			system.AddEmitter(emitter);
+			reference.AddEmitter(emitter);
+		}
+
+		system.Update(1.0f / 60.0f);
+		reference.Update(1.0f / 60.0f);
+		std::uint32_t fromSecond = 0;
+		for (std::uint32_t i = 0; i < system.Count(); ++i)
+			fromSecond += system.Particles().Emitter[i] == 1;
+		CHECK(system.Count() == 1000 && system.Capacity() == 1000);
+		CHECK(fromSecond == 0);
+
+		// Full, so nothing more is emitted until some die.
+		for (int frame = 0; frame < 30; ++frame)
+		{
+			system.Update(1.0f / 60.0f);
+			reference.Update(1.0f / 60.0f);
+		}
+		CHECK(system.Count() == 1000);
+		CHECK(Difference(Gather(system), reference.Particles()) < 1e-4f);
+	}
+
+	// Run serially inside another parallel loop, the same bytes.
+	{
+		ParticleSystem pooled;
+		ParticleSystem serial;
+		pooled.Create(50000, gravity, 9);
+		serial.Create(50000, gravity, 9);
+		pooled.AddEmitter(MakeEmitter(XMFLOAT3(0.0f, 0.0f, 0.0f), 200000.0f, 0.5f));
+		serial.AddEmitter(MakeEmitter(XMFLOAT3(0.0f, 0.0f, 0.0f), 200000.0f, 0.5f));
+
+		ThreadPool outer(1);
+		for (int frame = 0; frame < 40; ++frame)
+		{
+			pooled.Update(1.0f / 60.0f);
+			outer.ParallelFor(2, 1, [&](std::uint32_t begin, std::uint32_t)
+			{
+				if (begin == 0)
+					serial.Update(1.0f / 60.0f);
+			});
+		}
+
+		const ParticleArrays& a = pooled.Particles();
+		const ParticleArrays& b = serial.Particles();
+		const std::uint32_t count = pooled.Count();
+		CHECK(count == serial.Count() && count > 4096);
+		CHECK(std::memcmp(a.PositionX.data(), b.PositionX.data(), count * sizeof(float)) == 0);
+		CHECK(std::memcmp(a.VelocityY.data(), b.VelocityY.data(), count * sizeof(float)) == 0);
+		CHECK(std::memcmp(a.Age.data(), b.Age.data(), count * sizeof(float)) == 0);
+		CHECK(std::memcmp(a.Lifetime.data(), b.Lifetime.data(), count * sizeof(float)) == 0);
+	}
+
+	// Billboards: four corners per particle around its center, shrinking
+	// with age, in the emitter's color, into interleaved vertices.
+	{
+		struct Vertex
+		{
+			XMFLOAT3 Pos;
+			XMFLOAT4 Color;
+			XMFLOAT2 TexC;
+		};
+
+		ParticleSystem system;
+		system.Create(4096, gravity, 3);
+		ParticleEmitter emitter = MakeEmitter(XMFLOAT3(1.0f, 2.0f, 3.0f), 6000.0f, 2.0f);
+		system.AddEmitter(emitter);
+		for (int frame = 0; frame < 20; ++frame)
+			system.Update(1.0f / 60.0f);
+
+		const std::uint32_t first = 10;
+		const std::uint32_t count = system.Count() - first;
+		std::vector<Vertex> vertices(4 * (size_t)count);
+		system.WriteBillboards(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMFLOAT2(0.25f, 0.75f), first,
+			count, &vertices[0].Pos, &vertices[0].Color, &vertices[0].TexC, (std::uint32_t)sizeof(Vertex));
+
+		const ParticleArrays& p = system.Particles();
+		const float signs[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+		float worst = 0.0f;
+		std::uint32_t wrong = 0;
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			std::uint32_t i = first + k;
+			float size = emitter.Size * (1.0f - p.Age[i] / p.Lifetime[i]);
+			for (int c = 0; c < 4; ++c)
+			{
+				const Vertex& vertex = vertices[4 * k + c];
+				worst = std::max(worst, std::fabs(vertex.Pos.x - (p.PositionX[i] + signs[c][0] * size)));
+				worst = std::max(worst, std::fabs(vertex.Pos.y - (p.PositionY[i] + signs[c][1] * size)));
+				worst = std::max(worst, std::fabs(vertex.Pos.z - p.PositionZ[i]));
+				wrong += std::memcmp(&vertex.Color, &emitter.Color, sizeof(XMFLOAT4)) != 0 || vertex.TexC.x != 0.25f || vertex.TexC.y != 0.75f;
+			}
+		}
+		CHECK(worst < 1e-5f);
+		CHECK(wrong == 0);
+	}
+
+	return CHECK_RESULT();
+}
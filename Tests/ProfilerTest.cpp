@@ -0,0 +1,123 @@
+// Profiler::WriteChromeTrace while other threads record: every exported
+// event is one that was recorded, whole, and none is exported twice.
+
+#include "Check.h"
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+	// Three names, so an event and the one that reuses its slot, a power
+	// of two later, have different names.
+	const char* const Names[] = { "Alpha", "Beta", "Gamma" };
+
+	// Each thread records scopes whose depth encodes the name and a
+	// sequence number, so the exporter's output can be checked against
+	// what was written.  Start and end are raw ticks a fixed distance apart.
+	void Record(std::uint32_t thread, std::atomic<bool>& stop, std::atomic<std::uint64_t>& recorded)
+	{
+		PROFILE_THREAD_NAME(thread == 0 ? "Writer 0" : "Writer 1");
+
+		std::uint64_t count = 0;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			std::uint32_t name = (std::uint32_t)(count % 3);
+			std::uint32_t depth = (std::uint32_t)((count & 0xffffff) << 2 | name);
+			std::uint64_t start = Profiler::Now();
+			Profiler::Record(Names[name], start, start + 1000, depth);
+			++count;
+		}
+		recorded.fetch_add(count);
+	}
+
+	// Pulls the value after key out of one event's text.
+	bool Field(const std::string& event, const char* key, std::string& value)
+	{
+		size_t at = event.find(key);
+		if (at == std::string::npos)
+			return false;
+
+		at += std::strlen(key);
+		size_t end = event.find_first_of(",}", at);
+		value = event.substr(at, end - at);
+		return true;
+	}
+}
+
+int main()
+{
+	std::atomic<bool> stop(false);
+	std::atomic<std::uint64_t> recorded(0);
+
+	std::thread writers[2] = {
+		std::thread(Record, 0, std::ref(stop), std::ref(recorded)),
+		std::thread(Record, 1, std::ref(stop), std::ref(recorded)) };
+
+	// Export repeatedly while the rings wrap underneath.
+	const char* path = "ProfilerTest.json";
+	std::uint32_t exported = 0;
+	std::uint32_t bad = 0;
+	std::uint32_t duplicates = 0;
+	std::string firstDuration;
+
+	for (int round = 0; round < 6; ++round)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		CHECK(Profiler::WriteChromeTrace(path));
+
+		std::ifstream file(path);
+		std::stringstream text;
+		text << file.rdbuf();
+
+		std::string line;
+		std::set<std::string> seen;
+		while (std::getline(text, line))
+		{
+			if (line.find("\"ph\":\"X\"") == std::string::npos)
+				continue;
+
+			++exported;
+			std::string name, depth, duration, tid;
+			if (!Field(line, "{\"name\":", name) || !Field(line, "\"depth\":", depth) || !Field(line, "\"dur\":", duration) ||
+				!Field(line, "\"tid\":", tid))
+			{
+				++bad;
+				continue;
+			}
+
+			// The name must match the one the depth was recorded with, and
+			// every scope lasted the same 1000 ticks.
+			std::uint32_t d = (std::uint32_t)std::stoul(depth);
+			if ((d & 3) > 2 || name != std::string("\"") + Names[d & 3] + "\"")
+				++bad;
+			if (firstDuration.empty())
+				firstDuration = duration;
+			if (duration != firstDuration)
+				++bad;
+			if (!seen.insert(tid + ":" + depth).second)
+				++duplicates;
+		}
+	}
+
+	stop.store(true);
+	for (std::thread& writer : writers)
+		writer.join();
+	std::remove(path);
+
+	std::printf("%llu recorded, %u exported\n", (unsigned long long)recorded.load(), exported);
+	CHECK(recorded.load() > 2 * Profiler::EventsPerThread);
+	CHECK(exported > 0);
+	CHECK(bad == 0);
+	CHECK(duplicates == 0);
+
+	return CHECK_RESULT();
+}
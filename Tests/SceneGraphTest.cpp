@@ -0,0 +1,111 @@
+// SceneGraph::Update against naive recursion up the parents, after a full
+// update and after updates of a few dirty subtrees.
+
+#include "Check.h"
+#include "SceneGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	XMMATRIX RandomLocal(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		return XMMatrixScaling(1.0f + 0.1f * unit(random), 1.0f + 0.1f * unit(random), 1.0f + 0.1f * unit(random)) *
+			XMMatrixRotationY(3.0f * unit(random)) * XMMatrixTranslation(unit(random), unit(random), unit(random));
+	}
+
+	XMMATRIX NaiveWorld(const SceneGraph& graph, SceneGraph::NodeId node)
+	{
+		SceneGraph::NodeId parent = graph.GetParent(node);
+		if (parent == SceneGraph::InvalidNode)
+			return graph.GetLocal(node);
+		return graph.GetLocal(node) * NaiveWorld(graph, parent);
+	}
+
+	float MaxError(const SceneGraph& graph)
+	{
+		float error = 0.0f;
+		for (SceneGraph::NodeId node = 0; node < graph.NodeCount(); ++node)
+		{
+			XMFLOAT4X4 a, b;
+			XMStoreFloat4x4(&a, graph.GetWorld(node));
+			XMStoreFloat4x4(&b, NaiveWorld(graph, node));
+
+			for (int r = 0; r < 4; ++r)
+				for (int c = 0; c < 4; ++c)
+					error = std::fmax(error, std::fabs(a.m[r][c] - b.m[r][c]));
+		}
+		return error;
+	}
+}
+
+int main()
+{
+	// A forest of 20 trees, each node's parent a little before it, so the
+	// trees run tens of levels deep.
+	const std::uint32_t nodeCount = 20000;
+	std::mt19937 random(31);
+
+	SceneGraph graph;
+	graph.Reserve(nodeCount);
+	for (std::uint32_t i = 0; i < nodeCount; ++i)
+	{
+		SceneGraph::NodeId parent = i % 1000 == 0 ? SceneGraph::InvalidNode : i - 1 - random() % std::min<std::uint32_t>(i % 1000, 8);
+		CHECK(graph.AddNode(parent, RandomLocal(random)) == i);
+	}
+
+	graph.Update();
+	CHECK(MaxError(graph) < 1e-4f);
+
+	// Move a few nodes, then a root.  Only their subtrees change.
+	for (int round = 0; round < 3; ++round)
+	{
+		std::vector<XMFLOAT4X4> before(nodeCount);
+		for (SceneGraph::NodeId node = 0; node < nodeCount; ++node)
+			XMStoreFloat4x4(&before[node], graph.GetWorld(node));
+
+		std::vector<bool> moved(nodeCount, false);
+		for (int i = 0; i < 10; ++i)
+		{
+			SceneGraph::NodeId node = round == 2 ? 5000 : random() % nodeCount;
+			graph.SetLocal(node, RandomLocal(random));
+			moved[node] = true;
+		}
+
+		graph.Update();
+		CHECK(MaxError(graph) < 1e-4f);
+
+		std::uint32_t changedOutside = 0;
+		for (SceneGraph::NodeId node = 0; node < nodeCount; ++node)
+		{
+			bool underMoved = false;
+			for (SceneGraph::NodeId n = node; n != SceneGraph::InvalidNode && !underMoved; n = graph.GetParent(n))
+				underMoved = moved[n];
+
+			XMFLOAT4X4 after;
+			XMStoreFloat4x4(&after, graph.GetWorld(node));
+			if (!underMoved && std::memcmp(&after, &before[node], sizeof(after)) != 0)
+				++changedOutside;
+		}
+		CHECK(changedOutside == 0);
+	}
+
+	// Nothing marked: the update leaves everything as it was.
+	graph.Update();
+	CHECK(MaxError(graph) < 1e-4f);
+
+	graph.Clear();
+	CHECK(graph.NodeCount() == 0);
+	CHECK(graph.AddNode(SceneGraph::InvalidNode, XMMatrixTranslation(1.0f, 2.0f, 3.0f)) == 0);
+	graph.Update();
+	CHECK(MaxError(graph) == 0.0f);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,99 @@
+// SpscQueue between two threads: every item arrives once, in order, and a
+// full or empty queue refuses rather than corrupting.
+
+#include "Check.h"
+#include "SpscQueue.h"
+#include <cstdint>
+#include <thread>
+
+namespace
+{
+	// Large enough that the indices wrap the ring many times and a torn
+	// item would show in one of its fields.
+	struct Item
+	{
+		std::uint64_t Sequence;
+		std::uint64_t Complement;
+	};
+
+	const std::uint64_t ItemCount = 4000000;
+}
+
+int main()
+{
+	// Single thread: capacity, refusal when full and empty, and wrapping.
+	{
+		SpscQueue<int, 4> queue;
+		int value = 0;
+
+		CHECK(!queue.Pop(value));
+		for (int i = 0; i < 4; ++i)
+			CHECK(queue.Push(i));
+		CHECK(!queue.Push(99));
+		CHECK(queue.Size() == 4);
+
+		for (int round = 0; round < 10; ++round)
+		{
+			CHECK(queue.Pop(value));
+			CHECK(value == round);
+			CHECK(queue.Push(round + 4));
+		}
+		CHECK(queue.Size() == 4);
+	}
+
+	// A producer and a consumer as fast as they can go, with a queue small
+	// enough to be full and empty often.  Each yields when it has to wait,
+	// so the test also finishes on one core.
+	{
+		static SpscQueue<Item, 64> queue;
+		std::uint64_t fullRetries = 0;
+
+		std::thread producer([&]()
+		{
+			for (std::uint64_t i = 0; i < ItemCount;)
+			{
+				Item item = { i, ~i };
+				if (queue.Push(item))
+				{
+					++i;
+				}
+				else
+				{
+					++fullRetries;
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		std::uint64_t expected = 0;
+		std::uint64_t misordered = 0;
+		std::uint64_t torn = 0;
+		Item item;
+
+		while (expected < ItemCount)
+		{
+			if (!queue.Pop(item))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (item.Sequence != expected)
+				++misordered;
+			if (item.Complement != ~item.Sequence)
+				++torn;
+			expected = item.Sequence + 1;
+		}
+
+		producer.join();
+
+		CHECK(misordered == 0);
+		CHECK(torn == 0);
+		CHECK(queue.Size() == 0);
+		CHECK(!queue.Pop(item));
+		std::printf("%llu items, producer found the queue full %llu times\n", (unsigned long long)ItemCount,
+			(unsigned long long)fullRetries);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,43 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Assertions for the test executables.  A failed CHECK prints where and
+// what, and the test returns nonzero from CHECK_RESULT at the end of main,
+// so one run reports every failure rather than only the first.
+
+#include <cstdio>
+
+inline int& CheckFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++CheckFailures(); \
+		} \
+	} while (0)
+
+// As CHECK, printing the two values when they are not within tolerance.
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do \
+	{ \
+		double checkActual = (double)(actual); \
+		double checkExpected = (double)(expected); \
+		if (!(checkActual - checkExpected <= (tolerance) && checkExpected - checkActual <= (tolerance))) \
+		{ \
+			std::fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #actual, #expected, \
+				checkActual, checkExpected); \
+			++CheckFailures(); \
+		} \
+	} while (0)
+
+#define CHECK_RESULT() \
+	(CheckFailures() ? (std::fprintf(stderr, "%d check(s) failed\n", CheckFailures()), 1) : (std::printf("passed\n"), 0))
+
+#endif // CHECK_H
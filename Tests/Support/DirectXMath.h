@@ -0,0 +1,352 @@
+#ifndef TESTS_DIRECTXMATH_H
+#define TESTS_DIRECTXMATH_H
+
+// The part of DirectXMath the portable modules use, on SSE2, for builds
+// where the real library is not installed.  Names, layouts and results
+// follow DirectXMath; the estimates (XMVectorReciprocalSqrt and the like)
+// are exact here, so tests must not depend on their error.
+
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+
+	typedef __m128 XMVECTOR;
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMVECTOR GXMVECTOR;
+	typedef const XMVECTOR HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+
+	struct alignas(16) XMMATRIX
+	{
+		XMVECTOR r[4];
+
+		XMMATRIX() = default;
+		XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, FXMVECTOR r3)
+		{
+			r[0] = r0;
+			r[1] = r1;
+			r[2] = r2;
+			r[3] = r3;
+		}
+	};
+	typedef const XMMATRIX& FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	struct XMFLOAT2
+	{
+		float x, y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct alignas(16) XMFLOAT4A : public XMFLOAT4
+	{
+		XMFLOAT4A() = default;
+		constexpr XMFLOAT4A(float _x, float _y, float _z, float _w) : XMFLOAT4(_x, _y, _z, _w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+
+	struct alignas(16) XMFLOAT4X4A : public XMFLOAT4X4
+	{
+	};
+
+	// Loads and stores.
+
+	inline XMVECTOR XMVectorZero() { return _mm_setzero_ps(); }
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+	inline XMVECTOR XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+	inline XMVECTOR XMVectorSplatOne() { return _mm_set1_ps(1.0f); }
+
+	inline XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return _mm_set_ps(0.0f, 0.0f, source->y, source->x); }
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return _mm_set_ps(0.0f, source->z, source->y, source->x); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return _mm_loadu_ps(&source->x); }
+	inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* source) { return _mm_load_ps(&source->x); }
+
+	inline void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v)
+	{
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, v);
+		destination->x = lanes[0];
+		destination->y = lanes[1];
+	}
+
+	inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+	{
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, v);
+		destination->x = lanes[0];
+		destination->y = lanes[1];
+		destination->z = lanes[2];
+	}
+
+	inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { _mm_storeu_ps(&destination->x, v); }
+	inline void XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { _mm_store_ps(&destination->x, v); }
+	inline void XMStoreInt4(std::uint32_t* destination, FXMVECTOR v) { _mm_storeu_si128((__m128i*)destination, _mm_castps_si128(v)); }
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+	{
+		return XMMATRIX(_mm_loadu_ps(source->m[0]), _mm_loadu_ps(source->m[1]), _mm_loadu_ps(source->m[2]), _mm_loadu_ps(source->m[3]));
+	}
+
+	inline XMMATRIX XMLoadFloat4x4A(const XMFLOAT4X4A* source) { return XMLoadFloat4x4(source); }
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+	{
+		for (int i = 0; i < 4; ++i)
+			_mm_storeu_ps(destination->m[i], m.r[i]);
+	}
+
+	inline void XMStoreFloat4x4A(XMFLOAT4X4A* destination, FXMMATRIX m) { XMStoreFloat4x4(destination, m); }
+
+	// Lanes.
+
+	inline float XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+	inline float XMVectorGetY(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+	inline float XMVectorGetZ(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+	inline float XMVectorGetW(FXMVECTOR v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+	inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+	inline XMVECTOR XMVectorSplatY(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+	inline XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+	inline XMVECTOR XMVectorSplatW(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+	// Arithmetic.
+
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return _mm_add_ps(a, b); }
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return _mm_sub_ps(a, b); }
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline XMVECTOR XMVectorNegativeMultiplySubtract(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return _mm_mul_ps(v, _mm_set1_ps(scale)); }
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return _mm_sub_ps(_mm_setzero_ps(), v); }
+	inline XMVECTOR XMVectorReciprocal(FXMVECTOR v) { return _mm_div_ps(_mm_set1_ps(1.0f), v); }
+	inline XMVECTOR XMVectorReciprocalSqrt(FXMVECTOR v) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(v)); }
+	inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return _mm_min_ps(a, b); }
+	inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return _mm_max_ps(a, b); }
+	inline XMVECTOR XMVectorClamp(FXMVECTOR v, FXMVECTOR min, FXMVECTOR max) { return _mm_min_ps(_mm_max_ps(v, min), max); }
+
+	inline XMVECTOR XMVectorLerp(FXMVECTOR a, FXMVECTOR b, float t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+	}
+
+	inline void XMVectorSinCos(XMVECTOR* sine, XMVECTOR* cosine, FXMVECTOR v)
+	{
+		alignas(16) float lanes[4], s[4], c[4];
+		_mm_store_ps(lanes, v);
+		for (int i = 0; i < 4; ++i)
+		{
+			s[i] = std::sin(lanes[i]);
+			c[i] = std::cos(lanes[i]);
+		}
+		*sine = _mm_load_ps(s);
+		*cosine = _mm_load_ps(c);
+	}
+
+	// Comparisons and masks.
+
+	inline XMVECTOR XMVectorEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpeq_ps(a, b); }
+	inline XMVECTOR XMVectorLess(FXMVECTOR a, FXMVECTOR b) { return _mm_cmplt_ps(a, b); }
+	inline XMVECTOR XMVectorLessOrEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmple_ps(a, b); }
+	inline XMVECTOR XMVectorGreater(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpgt_ps(a, b); }
+	inline XMVECTOR XMVectorGreaterOrEqual(FXMVECTOR a, FXMVECTOR b) { return _mm_cmpge_ps(a, b); }
+	inline XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b) { return _mm_and_ps(a, b); }
+	inline XMVECTOR XMVectorOrInt(FXMVECTOR a, FXMVECTOR b) { return _mm_or_ps(a, b); }
+
+	inline XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control)
+	{
+		return _mm_or_ps(_mm_andnot_ps(control, a), _mm_and_ps(control, b));
+	}
+
+	inline bool XMVector4EqualInt(FXMVECTOR a, FXMVECTOR b)
+	{
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_castps_si128(a), _mm_castps_si128(b)))) == 0xf;
+	}
+
+	// Geometry.
+
+	inline XMVECTOR XMVector2Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return _mm_set1_ps(XMVectorGetX(a) * XMVectorGetX(b) + XMVectorGetY(a) * XMVectorGetY(b));
+	}
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return _mm_set1_ps(XMVectorGetX(a) * XMVectorGetX(b) + XMVectorGetY(a) * XMVectorGetY(b) + XMVectorGetZ(a) * XMVectorGetZ(b));
+	}
+
+	inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return _mm_set1_ps(XMVectorGetX(a) * XMVectorGetX(b) + XMVectorGetY(a) * XMVectorGetY(b) +
+			XMVectorGetZ(a) * XMVectorGetZ(b) + XMVectorGetW(a) * XMVectorGetW(b));
+	}
+
+	inline XMVECTOR XMVector2LengthSq(FXMVECTOR v) { return XMVector2Dot(v, v); }
+	inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector4LengthSq(FXMVECTOR v) { return XMVector4Dot(v, v); }
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector3Dot(v, v)); }
+
+	namespace Internal
+	{
+		// Zero for zero length, as DirectXMath gives.
+		inline XMVECTOR NormalizeBy(FXMVECTOR v, FXMVECTOR lengthSq)
+		{
+			XMVECTOR length = _mm_sqrt_ps(lengthSq);
+			return _mm_and_ps(_mm_div_ps(v, length), _mm_cmpneq_ps(length, _mm_setzero_ps()));
+		}
+	}
+
+	inline XMVECTOR XMVector2Normalize(FXMVECTOR v) { return Internal::NormalizeBy(v, XMVector2Dot(v, v)); }
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v) { return Internal::NormalizeBy(v, XMVector3Dot(v, v)); }
+	inline XMVECTOR XMVector4Normalize(FXMVECTOR v) { return Internal::NormalizeBy(v, XMVector4Dot(v, v)); }
+	inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q) { return XMVector4Normalize(q); }
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		XMVECTOR bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		XMVECTOR c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+		return _mm_and_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)), _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+	}
+
+	inline XMVECTOR XMPlaneDotCoord(FXMVECTOR plane, FXMVECTOR point)
+	{
+		return _mm_set1_ps(XMVectorGetX(XMVector3Dot(plane, point)) + XMVectorGetW(plane));
+	}
+
+	// Matrices, row vectors on the left.
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMATRIX(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+			XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+		return _mm_add_ps(result, _mm_mul_ps(XMVectorSplatW(v), m.r[3]));
+	}
+
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = _mm_mul_ps(XMVectorSplatX(v), m.r[0]);
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatY(v), m.r[1]));
+		result = _mm_add_ps(result, _mm_mul_ps(XMVectorSplatZ(v), m.r[2]));
+		return _mm_add_ps(result, m.r[3]);
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR result = XMVector3Transform(v, m);
+		return _mm_div_ps(result, XMVectorSplatW(result));
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, FXMMATRIX b)
+	{
+		return XMMATRIX(XMVector4Transform(a.r[0], b), XMVector4Transform(a.r[1], b), XMVector4Transform(a.r[2], b),
+			XMVector4Transform(a.r[3], b));
+	}
+
+	inline XMMATRIX operator*(FXMMATRIX a, FXMMATRIX b) { return XMMatrixMultiply(a, b); }
+
+	inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+	{
+		XMMATRIX t = m;
+		_MM_TRANSPOSE4_PS(t.r[0], t.r[1], t.r[2], t.r[3]);
+		return t;
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		return XMMATRIX(XMVectorSet(x, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, y, 0.0f, 0.0f), XMVectorSet(0.0f, 0.0f, z, 0.0f),
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	inline XMMATRIX XMMatrixScalingFromVector(FXMVECTOR s)
+	{
+		return XMMatrixScaling(XMVectorGetX(s), XMVectorGetY(s), XMVectorGetZ(s));
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		XMMATRIX m = XMMatrixIdentity();
+		m.r[3] = XMVectorSet(x, y, z, 1.0f);
+		return m;
+	}
+
+	inline XMMATRIX XMMatrixTranslationFromVector(FXMVECTOR t)
+	{
+		return XMMatrixTranslation(XMVectorGetX(t), XMVectorGetY(t), XMVectorGetZ(t));
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle)
+	{
+		float s = std::sin(angle), c = std::cos(angle);
+		return XMMATRIX(XMVectorSet(c, 0.0f, -s, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMVectorSet(s, 0.0f, c, 0.0f),
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q)
+	{
+		float x = XMVectorGetX(q), y = XMVectorGetY(q), z = XMVectorGetZ(q), w = XMVectorGetW(q);
+		return XMMATRIX(
+			XMVectorSet(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f),
+			XMVectorSet(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f),
+			XMVectorSet(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f),
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+	{
+		XMVECTOR z = XMVector3Normalize(_mm_sub_ps(focus, eye));
+		XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+		XMVECTOR y = XMVector3Cross(z, x);
+		XMVECTOR negEye = XMVectorNegate(eye);
+
+		XMMATRIX m(x, y, z, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+		m = XMMatrixTranspose(m);
+		m.r[3] = XMVectorSet(XMVectorGetX(XMVector3Dot(x, negEye)), XMVectorGetX(XMVector3Dot(y, negEye)),
+			XMVectorGetX(XMVector3Dot(z, negEye)), 1.0f);
+		return m;
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = 1.0f / std::tan(0.5f * fovAngleY);
+		float range = farZ / (farZ - nearZ);
+		return XMMATRIX(XMVectorSet(height / aspectRatio, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, height, 0.0f, 0.0f),
+			XMVectorSet(0.0f, 0.0f, range, 1.0f), XMVectorSet(0.0f, 0.0f, -range * nearZ, 0.0f));
+	}
+}
+
+#endif // TESTS_DIRECTXMATH_H
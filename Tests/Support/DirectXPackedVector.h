@@ -0,0 +1,22 @@
+#ifndef TESTS_DIRECTXPACKEDVECTOR_H
+#define TESTS_DIRECTXPACKEDVECTOR_H
+
+#include "DirectXMath.h"
+
+namespace DirectX
+{
+	namespace PackedVector
+	{
+		struct XMUSHORT4
+		{
+			std::uint16_t x, y, z, w;
+		};
+
+		inline XMVECTOR XMLoadUShort4(const XMUSHORT4* source)
+		{
+			return XMVectorSet((float)source->x, (float)source->y, (float)source->z, (float)source->w);
+		}
+	}
+}
+
+#endif // TESTS_DIRECTXPACKEDVECTOR_H
@@ -0,0 +1,307 @@
+// Terrain on a small cooked heightmap: the cooked file reads back within
+// its quantization, every stitching pattern tiles its patch, the selection
+// keeps neighbours within a level and leaves no cracks, finer errors mean
+// more triangles, and the patch cache hands out slots least recently used
+// first.
+
+#include "Check.h"
+#include "Terrain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t Size = 257;
+	const std::uint32_t ChunkQuads = 16;
+	const std::uint32_t Chunks = (Size - 1) / ChunkQuads;
+	const float Spacing = 2.0f;
+
+	// Hills over ridges, rough enough that no two levels have the same error.
+	void MakeHeights(std::vector<float>& heights)
+	{
+		heights.resize((size_t)Size * Size);
+		for (std::uint32_t r = 0; r < Size; ++r)
+			for (std::uint32_t c = 0; c < Size; ++c)
+				heights[(size_t)r * Size + c] = 40.0f * std::sin(0.021f * c) * std::cos(0.017f * r)
+					+ 6.0f * std::sin(0.13f * c + 0.4f) * std::sin(0.11f * r) + 0.7f * std::sin(0.9f * c * r);
+	}
+
+	typedef std::pair<long, long> Sample;
+
+	Sample SampleAt(const XMFLOAT3& position)
+	{
+		return Sample(std::lround(position.x / Spacing), std::lround(position.z / Spacing));
+	}
+
+	struct Camera
+	{
+		XMMATRIX ViewProj;
+		XMVECTOR Eye;
+		float PixelScale;
+	};
+
+	Camera LookAt(FXMVECTOR eye, FXMVECTOR target)
+	{
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 5000.0f);
+		Camera camera;
+		camera.ViewProj = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * proj;
+		camera.Eye = eye;
+		camera.PixelScale = 1080.0f * 0.5f * XMVectorGetY(proj.r[1]);
+		return camera;
+	}
+}
+
+int main()
+{
+	std::vector<float> heights;
+	MakeHeights(heights);
+	const char* path = "TerrainTest.trn";
+
+	// Sizes the quadtree or the stitching cannot take.
+	CHECK(!Terrain::Cook(heights.data(), Size, 15, Spacing, path));
+	CHECK(!Terrain::Cook(heights.data(), Size, 12, Spacing, path));
+	CHECK(!Terrain::Cook(heights.data(), 3 * 16 + 1, ChunkQuads, Spacing, path));
+	CHECK(!Terrain::Cook(heights.data(), Size, 256, Spacing, path));
+
+	Terrain terrain;
+	CHECK(!terrain.Open("TerrainTestMissing.trn"));
+	CHECK(Terrain::Cook(heights.data(), Size, ChunkQuads, Spacing, path));
+	CHECK(terrain.Open(path));
+	CHECK(terrain.LevelCount() == 5);
+	CHECK(terrain.VertexCount() == (ChunkQuads + 1) * (ChunkQuads + 1));
+	CHECK_NEAR(terrain.Extent(), (Size - 1) * Spacing, 1e-4);
+
+	float lo = *std::min_element(heights.begin(), heights.end());
+	float hi = *std::max_element(heights.begin(), heights.end());
+	double quantization = 0.5 * (hi - lo) / 65535.0 + 1e-4;
+
+	// Each pattern covers the whole patch with one winding, and a stitched
+	// side uses none of its odd vertices.
+	{
+		const std::uint32_t side = ChunkQuads + 1;
+		std::uint32_t problems = 0;
+		for (std::uint32_t mask = 0; mask < Terrain::EdgePatterns; ++mask)
+		{
+			const std::vector<std::uint16_t>& indices = terrain.Indices(mask);
+			std::set<std::uint32_t> used(indices.begin(), indices.end());
+
+			double area = 0.0;
+			std::uint32_t clockwise = 0;
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				double x[3];
+				double z[3];
+				for (int v = 0; v < 3; ++v)
+				{
+					x[v] = indices[t + v] % side;
+					z[v] = -(double)(indices[t + v] / side);
+				}
+				double twice = (x[1] - x[0]) * (z[2] - z[0]) - (z[1] - z[0]) * (x[2] - x[0]);
+				area += 0.5 * std::fabs(twice);
+				clockwise += twice < 0.0;
+			}
+
+			problems += std::fabs(area - ChunkQuads * ChunkQuads) > 1e-6;
+			problems += clockwise != 0 && clockwise != indices.size() / 3;
+
+			for (std::uint32_t j = 1; j < ChunkQuads; j += 2)
+			{
+				problems += (mask & Terrain::North) && used.count(j);
+				problems += (mask & Terrain::South) && used.count(ChunkQuads * side + j);
+				problems += (mask & Terrain::West) && used.count(j * side);
+				problems += (mask & Terrain::East) && used.count(j * side + ChunkQuads);
+			}
+		}
+		CHECK(problems == 0);
+		CHECK(terrain.Indices(Terrain::North | Terrain::East).size() < terrain.Indices(0).size());
+	}
+
+	std::vector<XMFLOAT3> positions(terrain.VertexCount());
+	std::vector<XMFLOAT3> normals(terrain.VertexCount());
+
+	// The finest patches land on the samples, at their heights to within
+	// the 16-bit quantization, with unit normals.
+	{
+		TerrainPatch patch = { 5 * Chunks + 3, 0, 3, 5, 0 };
+		terrain.BuildPatch(patch, positions.data(), normals.data());
+
+		double worst = 0.0;
+		std::uint32_t strays = 0;
+		for (std::uint32_t i = 0; i < terrain.VertexCount(); ++i)
+		{
+			Sample s = SampleAt(positions[i]);
+			strays += s.first < 3 * (long)ChunkQuads || s.first > 4 * (long)ChunkQuads || s.second < 5 * (long)ChunkQuads
+				|| s.second > 6 * (long)ChunkQuads;
+			if (s.first >= 0 && s.first < (long)Size && s.second >= 0 && s.second < (long)Size)
+				worst = std::max(worst, (double)std::fabs(positions[i].y - heights[(size_t)s.second * Size + s.first]));
+			strays += std::fabs(XMVectorGetX(XMVector3Length(XMLoadFloat3(&normals[i]))) - 1.0f) > 1e-4f;
+		}
+		CHECK(strays == 0);
+		CHECK(worst <= quantization);
+	}
+
+	// Looking across the terrain from low over one corner.
+	Camera camera = LookAt(XMVectorSet(40.0f, 60.0f, 40.0f, 1.0f), XMVectorSet(300.0f, 0.0f, 300.0f, 1.0f));
+	std::vector<TerrainPatch> patches;
+	TerrainStats stats;
+
+	std::uint64_t previous = 0;
+	for (float pixelError : { 64.0f, 24.0f, 8.0f })
+	{
+		terrain.Select(camera.ViewProj, camera.Eye, camera.PixelScale, pixelError, patches, stats);
+		std::printf("%.1f px: %u patches, %llu triangles, flat grid %llu\n", pixelError, stats.Patches,
+			(unsigned long long)stats.Triangles, (unsigned long long)stats.FlatTriangles);
+		CHECK(stats.Patches == patches.size() && stats.Patches > 0);
+		CHECK(stats.Triangles <= stats.FlatTriangles);
+		CHECK(stats.Triangles >= previous);
+		previous = stats.Triangles;
+	}
+
+	// At 8 pixels the levels are mixed.  Every chunk is covered at most
+	// once, neighbours are at most a level apart, and every triangle edge
+	// is shared by two triangles unless it is on the rim of what is drawn.
+	// Vertices the patches share have one height.
+	{
+		std::vector<int> cellLevels(Chunks * Chunks, -1);
+		std::uint32_t overlaps = 0;
+		for (const TerrainPatch& patch : patches)
+		{
+			std::uint32_t cells = 1u << patch.Level;
+			for (std::uint32_t z = patch.Z * cells; z < (patch.Z + 1) * cells; ++z)
+				for (std::uint32_t x = patch.X * cells; x < (patch.X + 1) * cells; ++x)
+				{
+					overlaps += cellLevels[z * Chunks + x] >= 0;
+					cellLevels[z * Chunks + x] = (int)patch.Level;
+				}
+		}
+		CHECK(overlaps == 0);
+		CHECK(std::any_of(patches.begin(), patches.end(), [](const TerrainPatch& patch) { return patch.EdgeMask != 0; }));
+
+		std::uint32_t imbalance = 0;
+		for (std::uint32_t z = 0; z < Chunks; ++z)
+			for (std::uint32_t x = 0; x < Chunks; ++x)
+			{
+				int level = cellLevels[z * Chunks + x];
+				if (level < 0)
+					continue;
+				if (x + 1 < Chunks && cellLevels[z * Chunks + x + 1] >= 0)
+					imbalance += std::abs(cellLevels[z * Chunks + x + 1] - level) > 1;
+				if (z + 1 < Chunks && cellLevels[(z + 1) * Chunks + x] >= 0)
+					imbalance += std::abs(cellLevels[(z + 1) * Chunks + x] - level) > 1;
+			}
+		CHECK(imbalance == 0);
+
+		std::map<std::pair<Sample, Sample>, int> edges;
+		std::map<Sample, float> heightAt;
+		double mismatch = 0.0;
+		for (const TerrainPatch& patch : patches)
+		{
+			terrain.BuildPatch(patch, positions.data(), normals.data());
+			for (const XMFLOAT3& position : positions)
+			{
+				std::map<Sample, float>::iterator found = heightAt.find(SampleAt(position));
+				if (found == heightAt.end())
+					heightAt[SampleAt(position)] = position.y;
+				else
+					mismatch = std::max(mismatch, (double)std::fabs(found->second - position.y));
+			}
+
+			const std::vector<std::uint16_t>& indices = terrain.Indices(patch.EdgeMask);
+			for (size_t t = 0; t < indices.size(); t += 3)
+				for (int e = 0; e < 3; ++e)
+				{
+					Sample a = SampleAt(positions[indices[t + e]]);
+					Sample b = SampleAt(positions[indices[t + (e + 1) % 3]]);
+					edges[a < b ? std::make_pair(a, b) : std::make_pair(b, a)]++;
+				}
+		}
+		CHECK(mismatch == 0.0);
+
+		// An edge used once must have undrawn ground, or none, beside it.
+		std::uint32_t cracks = 0;
+		for (const std::pair<const std::pair<Sample, Sample>, int>& edge : edges)
+		{
+			if (edge.second == 2)
+				continue;
+			if (edge.second > 2)
+			{
+				++cracks;
+				continue;
+			}
+
+			double mx = 0.5 * (edge.first.first.first + edge.first.second.first);
+			double mz = 0.5 * (edge.first.first.second + edge.first.second.second);
+			bool rim = false;
+			for (double dx : { -0.25, 0.25 })
+				for (double dz : { -0.25, 0.25 })
+				{
+					double x = mx + dx;
+					double z = mz + dz;
+					if (x < 0.0 || z < 0.0 || x >= Size - 1 || z >= Size - 1)
+						rim = true;
+					else
+						rim = rim || cellLevels[(std::uint32_t)(z / ChunkQuads) * Chunks + (std::uint32_t)(x / ChunkQuads)] < 0;
+				}
+			cracks += !rim;
+		}
+		CHECK(cracks == 0);
+	}
+
+	// A loose enough error draws the root alone; a tight one refines every
+	// patch in view to the heightmap.
+	terrain.Select(camera.ViewProj, camera.Eye, camera.PixelScale, 1e6f, patches, stats);
+	CHECK(patches.size() == 1 && patches[0].Level == terrain.LevelCount() - 1 && patches[0].EdgeMask == 0);
+
+	terrain.Select(camera.ViewProj, camera.Eye, camera.PixelScale, 1e-6f, patches, stats);
+	std::uint32_t coarse = 0;
+	for (const TerrainPatch& patch : patches)
+		coarse += patch.Level != 0;
+	CHECK(coarse == 0);
+	CHECK(stats.FlatTriangles == 2ull * (Size - 1) * (Size - 1));
+
+	// Looking away from the terrain draws nothing.
+	Camera away = LookAt(XMVectorSet(-10.0f, 60.0f, -10.0f, 1.0f), XMVectorSet(-300.0f, 60.0f, -300.0f, 1.0f));
+	terrain.Select(away.ViewProj, away.Eye, away.PixelScale, 1.0f, patches, stats);
+	CHECK(patches.empty() && stats.Triangles == 0);
+
+	terrain.Close();
+	std::remove(path);
+
+	// A node keeps its slot while it is used; once every slot is taken in
+	// a frame nothing more fits, and the next frame takes the slot used
+	// longest ago.
+	{
+		TerrainPatchCache cache(4);
+		bool fresh = false;
+
+		cache.BeginFrame();
+		std::uint32_t first = cache.Acquire(10, fresh);
+		CHECK(first != TerrainPatchCache::InvalidSlot && fresh);
+		CHECK(cache.Acquire(10, fresh) == first && !fresh);
+		for (std::uint32_t node = 20; node < 23; ++node)
+			CHECK(cache.Acquire(node, fresh) != TerrainPatchCache::InvalidSlot && fresh);
+		CHECK(cache.Acquire(99, fresh) == TerrainPatchCache::InvalidSlot);
+
+		cache.BeginFrame();
+		for (std::uint32_t node = 20; node < 23; ++node)
+			CHECK(cache.Acquire(node, fresh) != TerrainPatchCache::InvalidSlot && !fresh);
+		CHECK(cache.Acquire(99, fresh) == first && fresh);
+
+		cache.BeginFrame();
+		CHECK(cache.Acquire(10, fresh) != TerrainPatchCache::InvalidSlot && fresh);
+
+		cache.Clear();
+		cache.BeginFrame();
+		CHECK(cache.Acquire(99, fresh) != TerrainPatchCache::InvalidSlot && fresh);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,230 @@
+// TextureAtlas: packed cells are aligned, inside the atlas, apart from each
+// other and cover most of it; Compose repeats edges into the gutter;
+// RemapTexCoords lands UVs on the rect; and Hash, stored as a DDS tag,
+// tells a stale cooked atlas from a current one.
+
+#include "Check.h"
+#include "DdsFile.h"
+#include "TextureAtlas.h"
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::uint32_t CellSize(std::uint32_t size, std::uint32_t gutter, std::uint32_t alignment)
+	{
+		return (size + 2 * gutter + alignment - 1) / alignment * alignment;
+	}
+
+	// Checks the cells against each other and the atlas, and returns the
+	// share of the atlas they cover.
+	double CheckPacking(const std::vector<AtlasRect>& rects, std::uint32_t gutter, std::uint32_t alignment,
+		std::uint32_t width, std::uint32_t height)
+	{
+		CHECK(width % alignment == 0 && height % alignment == 0);
+
+		std::vector<std::uint8_t> covered((size_t)width * height, 0);
+		std::uint32_t misplaced = 0;
+		std::uint32_t overlaps = 0;
+		double cellArea = 0.0;
+
+		for (const AtlasRect& rect : rects)
+		{
+			std::uint32_t left = rect.X - gutter;
+			std::uint32_t top = rect.Y - gutter;
+			std::uint32_t cellWidth = CellSize(rect.Width, gutter, alignment);
+			std::uint32_t cellHeight = CellSize(rect.Height, gutter, alignment);
+
+			if (rect.X < gutter || rect.Y < gutter || left % alignment || top % alignment || left + cellWidth > width
+				|| top + cellHeight > height)
+			{
+				++misplaced;
+				continue;
+			}
+
+			cellArea += (double)cellWidth * cellHeight;
+			for (std::uint32_t y = top; y < top + cellHeight; ++y)
+				for (std::uint32_t x = left; x < left + cellWidth; ++x)
+					overlaps += covered[(size_t)y * width + x]++ != 0;
+		}
+
+		CHECK(misplaced == 0);
+		CHECK(overlaps == 0);
+		return cellArea / ((double)width * height);
+	}
+}
+
+int main()
+{
+	// Random sizes, small and large, with and without a gutter.  The
+	// cells, gutters included, cover at least 93% of the atlas; the images
+	// alone less, by however much gutter there is.
+	{
+		struct Case
+		{
+			std::uint32_t Count;
+			std::uint32_t MaxSize;
+			std::uint32_t Gutter;
+			std::uint32_t Alignment;
+		};
+		const Case cases[] = { { 1000, 64, 2, 4 }, { 1000, 256, 2, 4 }, { 3000, 64, 8, 16 }, { 3000, 128, 0, 1 } };
+
+		std::mt19937 random(3);
+		for (const Case& c : cases)
+		{
+			std::vector<AtlasRect> rects(c.Count);
+			for (AtlasRect& rect : rects)
+			{
+				rect.Width = 1 + random() % c.MaxSize;
+				rect.Height = 1 + random() % c.MaxSize;
+			}
+
+			std::uint32_t width = 0;
+			std::uint32_t height = 0;
+			CHECK(TextureAtlas::Pack(rects, c.Gutter, c.Alignment, 16384, width, height));
+
+			double cells = CheckPacking(rects, c.Gutter, c.Alignment, width, height);
+			float images = TextureAtlas::Efficiency(rects, width, height);
+			std::printf("%u rects up to %u, gutter %u: %ux%u, cells %.1f%%, images %.1f%%\n", c.Count, c.MaxSize, c.Gutter,
+				width, height, 100.0 * cells, 100.0 * images);
+
+			CHECK(cells >= 0.93);
+			CHECK(images <= cells);
+
+			// About square: neither side more than twice the other.
+			CHECK(width <= 2 * height && height <= 2 * width);
+		}
+
+		// Too much for the size limit.
+		std::vector<AtlasRect> rects(4);
+		for (AtlasRect& rect : rects)
+		{
+			rect.Width = 100;
+			rect.Height = 100;
+		}
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+		CHECK(!TextureAtlas::Pack(rects, 0, 1, 150, width, height));
+	}
+
+	// Two images composed: each is copied to its rect, its edges repeat to
+	// the end of its cell, and the rest of the atlas is left clear.
+	std::vector<TextureImage> images(2);
+	images[0].Width = 4;
+	images[0].Height = 4;
+	images[0].Pixels.assign(4 * 4 * 4, 255);
+	images[1].Width = 8;
+	images[1].Height = 6;
+	for (std::uint32_t i = 0; i < 8 * 6; ++i)
+	{
+		std::uint8_t texel[4] = { (std::uint8_t)(i % 8), (std::uint8_t)(i / 8), 7, 200 };
+		images[1].Pixels.insert(images[1].Pixels.end(), texel, texel + 4);
+	}
+
+	const std::uint32_t gutter = 2;
+	const std::uint32_t alignment = 8;
+	std::vector<AtlasRect> rects = { { 0, 0, 4, 4 }, { 0, 0, 8, 6 } };
+	std::uint32_t width = 0;
+	std::uint32_t height = 0;
+	CHECK(TextureAtlas::Pack(rects, gutter, alignment, 1024, width, height));
+	CheckPacking(rects, gutter, alignment, width, height);
+
+	{
+		TextureImage atlas;
+		TextureAtlas::Compose(images, rects, gutter, alignment, width, height, atlas);
+		CHECK(atlas.Width == width && atlas.Height == height);
+
+		const AtlasRect& rect = rects[1];
+		std::uint32_t wrong = 0;
+		for (std::uint32_t y = rect.Y - gutter; y < rect.Y - gutter + CellSize(rect.Height, gutter, alignment); ++y)
+			for (std::uint32_t x = rect.X - gutter; x < rect.X - gutter + CellSize(rect.Width, gutter, alignment); ++x)
+			{
+				int sourceX = (int)x - (int)rect.X;
+				int sourceY = (int)y - (int)rect.Y;
+				sourceX = sourceX < 0 ? 0 : sourceX > 7 ? 7 : sourceX;
+				sourceY = sourceY < 0 ? 0 : sourceY > 5 ? 5 : sourceY;
+
+				const std::uint8_t* texel = &atlas.Pixels[4 * ((size_t)y * width + x)];
+				wrong += texel[0] != sourceX || texel[1] != sourceY || texel[3] != 200;
+			}
+		CHECK(wrong == 0);
+
+		// Every texel outside both cells is transparent black.
+		std::uint32_t stray = 0;
+		for (std::uint32_t y = 0; y < height; ++y)
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				bool inCell = false;
+				for (const AtlasRect& r : rects)
+					inCell = inCell || (x + gutter >= r.X && x + gutter < r.X + CellSize(r.Width, gutter, alignment)
+						&& y + gutter >= r.Y && y + gutter < r.Y + CellSize(r.Height, gutter, alignment));
+				if (!inCell)
+					stray += atlas.Pixels[4 * ((size_t)y * width + x) + 3] != 0;
+			}
+		CHECK(stray == 0);
+	}
+
+	// UVs over the image move onto its rect; any outside [0, 1] stop the
+	// whole remap.
+	{
+		DirectX::XMFLOAT2 texCoords[3] = { { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 0.5f, 0.25f } };
+		CHECK(TextureAtlas::RemapTexCoords(rects[1], width, height, texCoords, 3, sizeof(DirectX::XMFLOAT2)));
+		CHECK_NEAR(texCoords[0].x, (double)rects[1].X / width, 1e-6);
+		CHECK_NEAR(texCoords[0].y, (double)rects[1].Y / height, 1e-6);
+		CHECK_NEAR(texCoords[1].x, (double)(rects[1].X + 8) / width, 1e-6);
+		CHECK_NEAR(texCoords[1].y, (double)(rects[1].Y + 6) / height, 1e-6);
+		CHECK_NEAR(texCoords[2].x, (rects[1].X + 4.0) / width, 1e-6);
+		CHECK_NEAR(texCoords[2].y, (rects[1].Y + 1.5) / height, 1e-6);
+
+		DirectX::XMFLOAT2 wrapping[2] = { { 0.5f, 0.5f }, { 1.5f, 0.0f } };
+		CHECK(!TextureAtlas::RemapTexCoords(rects[1], width, height, wrapping, 2, sizeof(DirectX::XMFLOAT2)));
+		CHECK(wrapping[0].x == 0.5f && wrapping[1].x == 1.5f);
+	}
+
+	// The hash changes with the layout and with any texel, and survives a
+	// DDS round trip as its tag, which is how a stale cooked atlas is found.
+	{
+		std::uint64_t hash = TextureAtlas::Hash(images, rects, gutter, alignment, width, height);
+		CHECK(hash == TextureAtlas::Hash(images, rects, gutter, alignment, width, height));
+		CHECK(hash != TextureAtlas::Hash(images, rects, gutter, alignment, width + alignment, height));
+
+		std::vector<AtlasRect> moved = rects;
+		moved[0].X += alignment;
+		CHECK(hash != TextureAtlas::Hash(images, moved, gutter, alignment, width, height));
+
+		std::vector<TextureImage> edited = images;
+		edited[1].Pixels[17] ^= 1;
+		CHECK(hash != TextureAtlas::Hash(edited, rects, gutter, alignment, width, height));
+
+		// One image fewer, as when the character's UVs wrap.
+		std::vector<TextureImage> fewer(images.begin(), images.begin() + 1);
+		std::vector<AtlasRect> fewerRects(rects.begin(), rects.begin() + 1);
+		CHECK(hash != TextureAtlas::Hash(fewer, fewerRects, gutter, alignment, width, height));
+
+		CompressedTexture texture;
+		texture.Format = BlockCompressor::BC7;
+		texture.Width = 8;
+		texture.Height = 8;
+		texture.Levels.assign(1, std::vector<std::uint8_t>(BlockCompressor::LevelSize(texture.Format, 8, 8), 0));
+		texture.Tag = hash;
+
+		const char* path = "TextureAtlasTest.dds";
+		CHECK(DdsFile::Save(path, texture));
+
+		CompressedTexture loaded;
+		CHECK(DdsFile::Load(path, loaded));
+		CHECK(loaded.Tag == hash);
+		std::remove(path);
+
+		// Untagged files read back as zero.
+		texture.Tag = 0;
+		CHECK(DdsFile::Save(path, texture));
+		CHECK(DdsFile::Load(path, loaded));
+		CHECK(loaded.Tag == 0);
+		std::remove(path);
+	}
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,221 @@
+// TextureStreamer driven through a fake device: levels follow screen size,
+// the budget holds while loads are in flight, idle textures fall back to
+// their tails, failed loads are retried, and every texture the device
+// made is released.
+
+#include "Check.h"
+#include "TextureStreamer.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Hands out tokens for textures and counts the bytes behind them.
+	class FakeDevice : public StreamingDevice
+	{
+	public:
+		FakeDevice()
+			: Fail(false), Creates(0), CreatesOffMainThread(0), mMainThread(std::this_thread::get_id())
+		{
+		}
+
+		void* CreateTexture(const DdsLayout& layout, const std::uint8_t* data, std::uint32_t firstLevel) override
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			++Creates;
+			if (std::this_thread::get_id() != mMainThread)
+				++CreatesOffMainThread;
+			if (Fail)
+				return nullptr;
+
+			// Touch every level, as an upload would.
+			size_t bytes = 0;
+			std::uint32_t sum = 0;
+			for (size_t i = firstLevel; i < layout.LevelSizes.size(); ++i)
+			{
+				bytes += layout.LevelSizes[i];
+				sum += data[layout.LevelOffsets[i] + layout.LevelSizes[i] - 1];
+			}
+
+			void* texture = new std::uint32_t(sum);
+			mLive[texture] = bytes;
+			return texture;
+		}
+
+		void ReleaseTexture(void* texture) override
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			CHECK(mLive.count(texture) == 1);
+			mLive.erase(texture);
+			delete (std::uint32_t*)texture;
+		}
+
+		size_t LiveBytes()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			size_t bytes = 0;
+			for (const auto& live : mLive)
+				bytes += live.second;
+			return bytes;
+		}
+
+		size_t LiveCount()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mLive.size();
+		}
+
+		bool Fail;
+		std::uint32_t Creates;
+		std::uint32_t CreatesOffMainThread;
+
+	private:
+		std::thread::id mMainThread;
+		std::mutex mMutex;
+		std::map<void*, size_t> mLive;
+	};
+
+	// A BC1 DDS of the given size with a full mip chain of blank blocks.
+	bool WriteDds(const std::string& filename, std::uint32_t size)
+	{
+		CompressedTexture texture;
+		texture.Format = BlockCompressor::BC1;
+		texture.Width = size;
+		texture.Height = size;
+		for (std::uint32_t level = size; ; level /= 2)
+		{
+			texture.Levels.push_back(std::vector<std::uint8_t>(BlockCompressor::LevelSize(texture.Format, level, level), 0));
+			if (level == 1)
+				break;
+		}
+		return DdsFile::Save(filename, texture);
+	}
+
+	// Bytes of a square BC1 texture from size down to 1x1.
+	size_t ChainBytes(std::uint32_t size)
+	{
+		size_t bytes = 0;
+		for (; size > 0; size /= 2)
+			bytes += BlockCompressor::LevelSize(BlockCompressor::BC1, size, size);
+		return bytes;
+	}
+
+	void Frame(TextureStreamer& streamer)
+	{
+		streamer.Update();
+		streamer.Flush();
+	}
+}
+
+int main()
+{
+	const char* large = "TextureStreamerTest1024.dds";
+	const char* odd = "TextureStreamerTest30.dds";
+	CHECK(WriteDds(large, 1024));
+	CHECK(WriteDds(odd, 30));
+
+	FakeDevice device;
+	{
+		// Room for one full chain and one a level down.
+		const size_t budget = ChainBytes(1024) + ChainBytes(512);
+		TextureStreamer streamer(device, budget);
+
+		// Add uploads the tail, the first level no bigger than 64, at once.
+		TextureStreamer::TextureId a = streamer.Add(large);
+		TextureStreamer::TextureId b = streamer.Add(large);
+		CHECK(a != TextureStreamer::InvalidTexture && b != TextureStreamer::InvalidTexture);
+		CHECK(streamer.ResidentLevel(a) == 4);
+		CHECK(streamer.ResidentBytes() == 2 * ChainBytes(64));
+		CHECK(device.LiveBytes() == streamer.ResidentBytes());
+
+		// Missing files and ones whose top level is not whole blocks.
+		CHECK(streamer.Add("TextureStreamerTestMissing.dds") == TextureStreamer::InvalidTexture);
+		CHECK(streamer.Add(odd) == TextureStreamer::InvalidTexture);
+
+		// About a texel per pixel, rounding to the sharper level, and the
+		// largest request of the frame wins.
+		streamer.Request(a, 1024.0f);
+		streamer.Request(b, 100.0f);
+		streamer.Request(b, 200.0f);
+		Frame(streamer);
+		CHECK(streamer.ResidentLevel(a) == 0);
+		CHECK(streamer.ResidentLevel(b) == 2);
+
+		// Both wanted at full size: the one smaller on screen gives way.
+		for (int frame = 0; frame < 4; ++frame)
+		{
+			streamer.Request(a, 1024.0f);
+			streamer.Request(b, 600.0f);
+			Frame(streamer);
+			CHECK(streamer.ResidentBytes() <= budget);
+		}
+		CHECK(streamer.ResidentLevel(a) == 0);
+		CHECK(streamer.ResidentLevel(b) == 1);
+		CHECK(device.LiveBytes() == streamer.ResidentBytes());
+
+		// a goes unrequested: it keeps its level for EvictDelay frames, then
+		// drops to its tail and b takes the room.
+		for (std::uint32_t frame = 0; frame < TextureStreamer::EvictDelay; ++frame)
+		{
+			streamer.Request(b, 900.0f);
+			Frame(streamer);
+		}
+		CHECK(streamer.ResidentLevel(a) == 0);
+		CHECK(streamer.ResidentLevel(b) == 1);
+
+		for (int frame = 0; frame < 4; ++frame)
+		{
+			streamer.Request(b, 900.0f);
+			Frame(streamer);
+			CHECK(streamer.ResidentBytes() <= budget);
+		}
+		CHECK(streamer.ResidentLevel(a) == 4);
+		CHECK(streamer.ResidentLevel(b) == 0);
+
+		// A failed load leaves the texture as it was and is retried.
+		device.Fail = true;
+		streamer.Request(a, 256.0f);
+		Frame(streamer);
+		CHECK(streamer.ResidentLevel(a) == 4);
+		device.Fail = false;
+
+		streamer.Request(a, 256.0f);
+		streamer.Request(b, 256.0f);
+		Frame(streamer);
+		CHECK(streamer.ResidentLevel(a) == 2);
+		CHECK(streamer.ResidentLevel(b) == 2);
+
+		// Requests changing every frame without waiting for the loads: the
+		// resident bytes never pass the budget, and once the loads land the
+		// device holds exactly what the streamer counts.
+		for (std::uint32_t frame = 0; frame < 300; ++frame)
+		{
+			streamer.Request(a, (float)(frame * 37 % 1024));
+			streamer.Request(b, (float)(frame * 101 % 1024));
+			streamer.Update();
+			CHECK(streamer.ResidentBytes() <= budget);
+			if (frame % 3 == 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		streamer.Flush();
+		CHECK(device.LiveBytes() == streamer.ResidentBytes());
+		CHECK(device.LiveCount() == 2);
+
+		// Only the tails were made on the caller's thread.
+		CHECK(device.CreatesOffMainThread == device.Creates - 2);
+	}
+
+	// The streamer releases everything it still holds.
+	CHECK(device.LiveCount() == 0);
+
+	std::remove(large);
+	std::remove(odd);
+
+	return CHECK_RESULT();
+}
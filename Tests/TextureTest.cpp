@@ -0,0 +1,215 @@
+// TgaLoader against files written here in each layout it reads, and the
+// shipped texture; MipGenerator's chain sizes, gamma-correct averaging and
+// alpha.
+
+#include "Check.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// A TGA of image: raw or RLE, 24 or 32 bits, or gray from the red
+	// channel, with rows stored from the top or the bottom.
+	std::vector<std::uint8_t> EncodeTga(const TextureImage& image, bool rle, std::uint32_t bits, bool topDown)
+	{
+		bool gray = bits == 8;
+		std::uint32_t bytes = bits / 8;
+
+		std::vector<std::uint8_t> file(18, 0);
+		file[2] = (std::uint8_t)(gray ? (rle ? 11 : 3) : (rle ? 10 : 2));
+		file[12] = (std::uint8_t)(image.Width & 0xff);
+		file[13] = (std::uint8_t)(image.Width >> 8);
+		file[14] = (std::uint8_t)(image.Height & 0xff);
+		file[15] = (std::uint8_t)(image.Height >> 8);
+		file[16] = (std::uint8_t)bits;
+		file[17] = (std::uint8_t)((bits == 32 ? 8 : 0) | (topDown ? 0x20 : 0));
+
+		std::vector<std::uint8_t> pixels;
+		for (std::uint32_t row = 0; row < image.Height; ++row)
+		{
+			std::uint32_t y = topDown ? row : image.Height - 1 - row;
+			for (std::uint32_t x = 0; x < image.Width; ++x)
+			{
+				const std::uint8_t* p = &image.Pixels[4 * ((size_t)y * image.Width + x)];
+				std::uint8_t bgra[4] = { p[2], p[1], p[0], p[3] };
+				if (gray)
+					pixels.push_back(p[0]);
+				else
+					pixels.insert(pixels.end(), bgra, bgra + bytes);
+			}
+		}
+
+		if (!rle)
+		{
+			file.insert(file.end(), pixels.begin(), pixels.end());
+			return file;
+		}
+
+		// Runs of equal pixels as repeat packets, the rest as raw packets,
+		// neither longer than 128 and both free to cross row ends.
+		size_t count = pixels.size() / bytes;
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t run = 1;
+			while (i + run < count && run < 128 && std::equal(&pixels[(i + run) * bytes], &pixels[(i + run + 1) * bytes], &pixels[i * bytes]))
+				++run;
+
+			if (run > 1)
+			{
+				file.push_back((std::uint8_t)(0x80 | (run - 1)));
+				file.insert(file.end(), &pixels[i * bytes], &pixels[(i + 1) * bytes]);
+				i += run;
+				continue;
+			}
+
+			size_t literal = 1;
+			while (i + literal < count && literal < 128 &&
+				!(i + literal + 1 < count && std::equal(&pixels[(i + literal) * bytes], &pixels[(i + literal + 1) * bytes], &pixels[(i + literal + 1) * bytes])))
+				++literal;
+
+			file.push_back((std::uint8_t)(literal - 1));
+			file.insert(file.end(), &pixels[i * bytes], &pixels[(i + literal) * bytes]);
+			i += literal;
+		}
+
+		return file;
+	}
+
+	// What the loader should give back for a file written from image.
+	TextureImage Expected(const TextureImage& image, std::uint32_t bits)
+	{
+		TextureImage expected = image;
+		for (size_t i = 0; i < expected.Pixels.size(); i += 4)
+		{
+			if (bits == 8)
+				expected.Pixels[i + 1] = expected.Pixels[i + 2] = expected.Pixels[i];
+			if (bits != 32)
+				expected.Pixels[i + 3] = 255;
+		}
+		return expected;
+	}
+
+	TextureImage Checker(std::uint32_t width, std::uint32_t height, std::uint8_t alpha)
+	{
+		TextureImage image;
+		image.Width = width;
+		image.Height = height;
+		for (std::uint32_t y = 0; y < height; ++y)
+		{
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint8_t v = (x + y) % 2 ? 255 : 0;
+				std::uint8_t pixel[4] = { v, v, v, (x + y) % 2 ? alpha : (std::uint8_t)0 };
+				image.Pixels.insert(image.Pixels.end(), pixel, pixel + 4);
+			}
+		}
+		return image;
+	}
+}
+
+int main()
+{
+	// Blocks of flat color with noise between them, so RLE files have both
+	// kinds of packet.
+	TextureImage source;
+	source.Width = 301;
+	source.Height = 67;
+	std::mt19937 random(35);
+	for (std::uint32_t y = 0; y < source.Height; ++y)
+	{
+		for (std::uint32_t x = 0; x < source.Width; ++x)
+		{
+			bool flat = (x / 40 + y / 20) % 2 == 0;
+			std::uint8_t pixel[4] = { (std::uint8_t)(flat ? 200 : random()), (std::uint8_t)(flat ? 40 : random()),
+				(std::uint8_t)(flat ? 90 : random()), (std::uint8_t)(flat ? 255 : random()) };
+			source.Pixels.insert(source.Pixels.end(), pixel, pixel + 4);
+		}
+	}
+
+	for (std::uint32_t bits : { 8u, 24u, 32u })
+	{
+		for (bool rle : { false, true })
+		{
+			for (bool topDown : { false, true })
+			{
+				std::vector<std::uint8_t> file = EncodeTga(source, rle, bits, topDown);
+
+				TextureImage decoded;
+				CHECK(TgaLoader::Decode(file.data(), file.size(), decoded));
+				CHECK(decoded.Width == source.Width && decoded.Height == source.Height);
+				CHECK(decoded.Pixels == Expected(source, bits).Pixels);
+
+				// Cut short anywhere in the pixels: rejected, not overrun.
+				CHECK(!TgaLoader::Decode(file.data(), file.size() - 1 - file.size() / 3, decoded));
+			}
+		}
+	}
+
+	{
+		std::vector<std::uint8_t> file = EncodeTga(source, false, 32, true);
+		TextureImage decoded;
+
+		file[1] = 1;
+		file[2] = 1;
+		CHECK(!TgaLoader::Decode(file.data(), file.size(), decoded));
+		CHECK(!TgaLoader::Decode(file.data(), 10, decoded));
+	}
+
+	// The texture the project ships.
+	{
+		TextureImage image;
+		CHECK(TgaLoader::Load(RESOURCE_DIR "/ao_twinte_chan/ao_twinte_chan640x640.tga", image));
+		CHECK(image.Width == 640 && image.Height == 640);
+		CHECK(image.Pixels.size() == 640 * 640 * 4);
+		CHECK(!TgaLoader::Load(RESOURCE_DIR "/missing.tga", image));
+	}
+
+	// Chain sizes, non-square and odd.
+	CHECK(MipGenerator::LevelCount(1, 1) == 1);
+	CHECK(MipGenerator::LevelCount(640, 640) == 10);
+	CHECK(MipGenerator::LevelCount(301, 67) == 9);
+	{
+		std::vector<TextureImage> mips;
+		MipGenerator::Generate(source, MipGenerator::Kaiser, true, mips);
+		CHECK(mips.size() == 9);
+		CHECK(mips[1].Width == 150 && mips[1].Height == 33);
+		CHECK(mips.back().Width == 1 && mips.back().Height == 1);
+		for (const TextureImage& mip : mips)
+			CHECK(mip.Pixels.size() == (size_t)mip.Width * mip.Height * 4);
+	}
+
+	// A black and white checker averages to mid-gray in linear light: 188
+	// in sRGB, 128 if the image is linear.  Alpha averages as is.
+	for (MipGenerator::Filter filter : { MipGenerator::Box, MipGenerator::Kaiser })
+	{
+		TextureImage checker = Checker(64, 64, 200);
+		std::vector<TextureImage> mips;
+
+		MipGenerator::Generate(checker, filter, true, mips);
+		CHECK(std::abs(mips[1].Pixels[4 * 40] - 188) <= 1);
+		CHECK(std::abs(mips[1].Pixels[4 * 40 + 3] - 100) <= 1);
+
+		MipGenerator::Generate(checker, filter, false, mips);
+		CHECK(std::abs(mips[1].Pixels[4 * 40] - 128) <= 1);
+
+		// A flat image stays flat all the way down.
+		TextureImage flat = checker;
+		for (size_t i = 0; i < flat.Pixels.size(); ++i)
+			flat.Pixels[i] = (std::uint8_t)(i % 4 == 3 ? 255 : 77);
+		MipGenerator::Generate(flat, filter, true, mips);
+
+		std::uint32_t off = 0;
+		for (const TextureImage& mip : mips)
+			for (size_t i = 0; i < mip.Pixels.size(); ++i)
+				off += mip.Pixels[i] != flat.Pixels[i % 4];
+		CHECK(off == 0);
+	}
+
+	return CHECK_RESULT();
+}
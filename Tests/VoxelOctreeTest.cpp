@@ -0,0 +1,205 @@
+// VoxelOctree on a geosphere, solid and hollow: every voxel wholly inside
+// the mesh is set and every voxel clear of it is not, the octree holds the
+// same voxels it counts, and rays marched through its empty nodes stop at
+// the first set voxel along them.
+
+#include "Check.h"
+#include "GeometryGenerator.h"
+#include "ThreadPool.h"
+#include "VoxelOctree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// The voxels set, by going through all of them.
+	std::uint64_t CountVoxels(const VoxelOctree& voxels)
+	{
+		std::uint64_t count = 0;
+		std::uint32_t n = voxels.Resolution();
+		for (std::uint32_t z = 0; z < n; ++z)
+			for (std::uint32_t y = 0; y < n; ++y)
+				for (std::uint32_t x = 0; x < n; ++x)
+					count += voxels.Occupied(x, y, z);
+		return count;
+	}
+
+	// Voxels wholly inside inner that are clear, and voxels wholly outside
+	// outer that are set.
+	void CheckSphere(const VoxelOctree& voxels, float inner, float outer, std::uint32_t& holes, std::uint32_t& strays,
+		bool solid)
+	{
+		holes = 0;
+		strays = 0;
+		std::uint32_t n = voxels.Resolution();
+		float size = voxels.VoxelSize();
+		XMFLOAT3 origin = voxels.Origin();
+
+		for (std::uint32_t z = 0; z < n; ++z)
+			for (std::uint32_t y = 0; y < n; ++y)
+				for (std::uint32_t x = 0; x < n; ++x)
+				{
+					// The nearest and farthest points of the voxel from the
+					// sphere's center.
+					float corner[3] = { origin.x + x * size, origin.y + y * size, origin.z + z * size };
+					float nearest = 0.0f;
+					float farthest = 0.0f;
+					for (int k = 0; k < 3; ++k)
+					{
+						float lo = corner[k];
+						float hi = corner[k] + size;
+						float d = lo > 0.0f ? lo : hi < 0.0f ? -hi : 0.0f;
+						float f = std::max(std::fabs(lo), std::fabs(hi));
+						nearest += d * d;
+						farthest += f * f;
+					}
+					nearest = std::sqrt(nearest);
+					farthest = std::sqrt(farthest);
+
+					bool set = voxels.Occupied(x, y, z);
+					if (farthest < inner && !set && solid)
+						++holes;
+					if ((nearest > outer || (!solid && farthest < inner)) && set)
+						++strays;
+				}
+	}
+
+	// Points along the ray before the hit that are set, sampled far finer
+	// than a voxel.
+	std::uint32_t SetBeforeHit(const VoxelOctree& voxels, FXMVECTOR origin, FXMVECTOR direction, float distance)
+	{
+		std::uint32_t set = 0;
+		float step = 0.05f * voxels.VoxelSize() / XMVectorGetX(XMVector3Length(direction));
+		for (float t = 0.0f; t < distance - step; t += step)
+			set += voxels.Occupied(XMVectorAdd(origin, XMVectorScale(direction, t)));
+		return set;
+	}
+}
+
+int main()
+{
+	GeometryGenerator generator;
+	const float radius = 1.0f;
+	GeometryGenerator::MeshData sphere = generator.CreateGeosphere(radius, 3);
+
+	// The flat faces sit inside the sphere, as close as the nearest plane.
+	float inner = radius;
+	for (size_t t = 0; t < sphere.Indices32.size(); t += 3)
+	{
+		XMVECTOR a = XMLoadFloat3(&sphere.Vertices[sphere.Indices32[t]].Position);
+		XMVECTOR b = XMLoadFloat3(&sphere.Vertices[sphere.Indices32[t + 1]].Position);
+		XMVECTOR c = XMLoadFloat3(&sphere.Vertices[sphere.Indices32[t + 2]].Position);
+		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+		inner = std::min(inner, std::fabs(XMVectorGetX(XMVector3Dot(normal, a))));
+	}
+
+	// 128 voxels a side is four chunks, so the sphere crosses their seams
+	// and the interior is filled across columns.
+	VoxelOctree solid;
+	solid.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+		(std::uint32_t)sphere.Indices32.size() / 3, 128, true);
+	CHECK(solid.Resolution() == 128);
+	CHECK(CountVoxels(solid) == solid.VoxelCount());
+
+	double voxelVolume = std::pow((double)solid.VoxelSize(), 3.0);
+	double expected = 4.0 / 3.0 * XM_PI * radius * radius * radius / voxelVolume;
+	std::printf("solid: %llu voxels of about %.0f, %u nodes, %u bricks, %zu bytes\n", (unsigned long long)solid.VoxelCount(),
+		expected, solid.NodeCount(), solid.BrickCount(), solid.SizeInBytes());
+
+	std::uint32_t holes;
+	std::uint32_t strays;
+	CheckSphere(solid, inner, radius, holes, strays, true);
+	CHECK(holes == 0);
+	CHECK(strays == 0);
+	CHECK(std::fabs(solid.VoxelCount() - expected) < 0.05 * expected);
+
+	// Most of the solid is whole nodes, far smaller than a voxel a bit.
+	CHECK(solid.SizeInBytes() * 8 < solid.VoxelCount());
+
+	// A pool of its own, as a build in the background uses, sets the same
+	// voxels however many threads it has.
+	ThreadPool serial(0);
+	VoxelOctree solidSerial;
+	solidSerial.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+		(std::uint32_t)sphere.Indices32.size() / 3, 128, true, serial);
+	CHECK(solidSerial.VoxelCount() == solid.VoxelCount());
+	CHECK(solidSerial.SizeInBytes() == solid.SizeInBytes());
+
+	CHECK(solid.Occupied(XMVectorZero()));
+	CHECK(!solid.Occupied(XMVectorSet(0.9f, 0.9f, 0.0f, 1.0f)));
+	CHECK(!solid.Occupied(XMVectorSet(5.0f, 0.0f, 0.0f, 1.0f)));
+	CHECK(!solid.Occupied(XMVectorSet(-5.0f, 0.0f, 0.0f, 1.0f)));
+
+	// Hollow, only the shell is set.
+	VoxelOctree shell;
+	shell.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+		(std::uint32_t)sphere.Indices32.size() / 3, 128, false);
+	CHECK(CountVoxels(shell) == shell.VoxelCount());
+	CheckSphere(shell, inner - 2.0f * shell.VoxelSize(), radius, holes, strays, false);
+	CHECK(strays == 0);
+	CHECK(shell.VoxelCount() > 0 && shell.VoxelCount() < solid.VoxelCount() / 4);
+	CHECK(!shell.Occupied(XMVectorZero()));
+	std::printf("shell: %llu voxels\n", (unsigned long long)shell.VoxelCount());
+
+	// Straight at the center, a ray hits the surface within a voxel or so.
+	{
+		XMVECTOR origin = XMVectorSet(-3.0f, 0.0f, 0.0f, 1.0f);
+		XMVECTOR direction = XMVectorSet(6.0f, 0.0f, 0.0f, 0.0f);
+		VoxelHit hit;
+		CHECK(solid.RayMarch(origin, direction, 1.0f, hit));
+		CHECK(std::fabs(hit.Distance * 6.0f - (3.0f - radius)) < 2.0f * solid.VoxelSize());
+		CHECK(solid.Occupied(hit.X, hit.Y, hit.Z));
+
+		// Not so far.
+		CHECK(!solid.RayMarch(origin, direction, 0.25f, hit));
+
+		// From inside the solid, the hit is where it starts.
+		CHECK(solid.RayMarch(XMVectorZero(), direction, 1.0f, hit) && hit.Distance == 0.0f);
+
+		// Passing by it, nothing.
+		CHECK(!solid.RayMarch(XMVectorSet(-3.0f, 1.2f, 0.0f, 1.0f), direction, 1.0f, hit));
+	}
+
+	// Rays every way through both: the first set voxel, no set voxel
+	// before it, and a miss only where the ray never reaches one.
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uint32_t wrong = 0;
+	std::uint32_t hits = 0;
+	for (int i = 0; i < 400; ++i)
+	{
+		const VoxelOctree& voxels = i % 2 ? shell : solid;
+		XMVECTOR origin = XMVectorSet(3.0f * unit(random), 3.0f * unit(random), 3.0f * unit(random), 1.0f);
+		XMVECTOR target = XMVectorSet(0.8f * unit(random), 0.8f * unit(random), 0.8f * unit(random), 1.0f);
+		XMVECTOR direction = XMVectorScale(XMVectorSubtract(target, origin), 2.0f);
+
+		VoxelHit hit;
+		if (voxels.RayMarch(origin, direction, 1.0f, hit))
+		{
+			++hits;
+			wrong += !voxels.Occupied(hit.X, hit.Y, hit.Z);
+			wrong += SetBeforeHit(voxels, origin, direction, hit.Distance) != 0;
+		}
+		else
+			wrong += SetBeforeHit(voxels, origin, direction, 1.0f) != 0;
+	}
+	std::printf("rays: %u hits, %u wrong\n", hits, wrong);
+	CHECK(wrong == 0);
+	CHECK(hits > 300);
+
+	// Resolutions round up to a power of two; nothing to build is empty.
+	VoxelOctree other;
+	other.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(),
+		(std::uint32_t)sphere.Indices32.size() / 3, 100, true);
+	CHECK(other.Resolution() == 128);
+	CHECK(CountVoxels(other) == other.VoxelCount());
+	other.Build(&sphere.Vertices[0].Position, (std::uint32_t)sizeof(GeometryGenerator::Vertex), sphere.Indices32.data(), 0, 64, true);
+	CHECK(other.VoxelCount() == 0 && !other.Occupied(XMVectorZero()));
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Compares two benchmark JSON files written with --json.
+
+    compare_benchmarks.py baseline.json current.json [--threshold 10]
+
+A benchmark regresses when its items per second fall, or the bytes or
+allocations an iteration makes rise, by more than the threshold percent.
+Every benchmark in both files is listed; the exit code is 1 if any
+regressed, so the script can gate a build.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def change(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float("inf")
+    return 100.0 * (new - old) / old
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="percent change allowed (default 10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    print("%-40s %14s %10s %10s" % ("benchmark", "items/s", "bytes", "allocs"))
+
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            print("%-40s %s" % (name, "only in current" if name in current else "only in baseline"))
+            continue
+
+        old, new = baseline[name], current[name]
+
+        # Throughput should not fall; allocation should not rise.
+        speed = change(old["items_per_second"], new["items_per_second"])
+        size = change(old["bytes_allocated"], new["bytes_allocated"])
+        count = change(old["allocations"], new["allocations"])
+
+        flags = []
+        if speed < -args.threshold:
+            flags.append("slower")
+        if size > args.threshold:
+            flags.append("more bytes")
+        if count > args.threshold:
+            flags.append("more allocations")
+
+        if flags:
+            regressions += 1
+
+        print("%-40s %+13.1f%% %+9.1f%% %+9.1f%%  %s" % (name, speed, size, count, ", ".join(flags).upper() if flags else "ok"))
+
+    old_rss = max(b["peak_rss_bytes"] for b in baseline.values()) if baseline else 0
+    new_rss = max(b["peak_rss_bytes"] for b in current.values()) if current else 0
+    print("peak RSS %.1f MB -> %.1f MB (%+.1f%%)" % (old_rss / 1e6, new_rss / 1e6, change(old_rss, new_rss)))
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %g%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
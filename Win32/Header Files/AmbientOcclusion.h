@@ -0,0 +1,66 @@
+#ifndef AMBIENTOCCLUSION_H
+#define AMBIENTOCCLUSION_H
+
+#include "Bvh.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Bakes ambient occlusion per vertex by tracing cosine-weighted rays over
+// the hemisphere around each vertex normal against the mesh's Bvh.
+//
+// The bake is progressive: every Trace call adds samples to all vertices,
+// and the estimate after any call is usable, only noisier.  Sample i of a
+// vertex is point i of one low-discrepancy sequence, shifted per vertex by
+// a hash of the seed, so the result depends on neither the thread count
+// nor how the samples were split between calls, and a saved bake can be
+// resumed later.
+class AmbientOcclusionBaker
+{
+public:
+	// Normals are averaged from the triangles and point out of the
+	// mesh's volume.  Rays longer than radius count as open.  The baker
+	// keeps a pointer to bvh.
+	void Begin(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+		const std::uint32_t* indices, std::uint32_t triangleCount, const Bvh& bvh, float radius, std::uint32_t seed);
+
+	// Adds samples rays to every vertex, spread over the thread pool.  A
+	// bake in the background passes a pool of its own, so it does not hold
+	// up the shared one.
+	void Trace(std::uint32_t samples);
+	void Trace(std::uint32_t samples, ThreadPool& pool);
+
+	// How much of the hemisphere is open at each vertex, from 0 to 1.
+	void Resolve(float* visibility)const;
+
+	std::uint32_t SampleCount()const;
+	std::uint64_t RayCount()const;
+
+	// Progress so far, for Load to resume from.  Load fails unless the
+	// file was saved with the same vertex count, radius and seed.
+	bool Save(const std::string& filename)const;
+	bool Load(const std::string& filename);
+
+private:
+	// Vertices per task.
+	static const std::uint32_t GrainSize = 64;
+
+	const Bvh* mBvh = nullptr;
+	std::vector<DirectX::XMFLOAT3> mPositions;
+	std::vector<DirectX::XMFLOAT3> mNormals;
+
+	// Per vertex: the sequence shift, and the sum of open samples.
+	std::vector<DirectX::XMFLOAT2> mShifts;
+	std::vector<float> mOpen;
+
+	float mRadius = 0.0f;
+	float mBias = 0.0f;
+	std::uint32_t mSeed = 0;
+	std::uint32_t mSampleCount = 0;
+	std::uint64_t mRayCount = 0;
+};
+
+#endif // AMBIENTOCCLUSION_H
@@ -0,0 +1,104 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Skeletal animation runtime data.  Everything here is plain arrays filled
+// once by the importer; nothing refers back to the FBX scene.
+
+// Joint transform relative to its parent, kept decomposed so poses can be
+// interpolated and blended.  Vectors are 16-byte aligned for SIMD loads.
+struct BoneTransform
+{
+	DirectX::XMFLOAT4A Rotation;	// quaternion
+	DirectX::XMFLOAT4A Translation;
+	DirectX::XMFLOAT4A Scale;
+};
+
+// Joints are sorted parent-before-child; Parents[i] is -1 for a root.
+struct Skeleton
+{
+	std::vector<std::int32_t> Parents;
+	std::vector<DirectX::XMFLOAT4X4A> InverseBindPose;
+	std::vector<BoneTransform> BindPose;
+
+	std::uint32_t JointCount()const { return (std::uint32_t)Parents.size(); }
+};
+
+// Poses baked at a fixed rate.  Keys holds FrameCount poses of JointCount
+// joints each, one frame after another.
+struct AnimationClip
+{
+	std::string Name;
+	float Duration;
+	float SampleRate;
+	std::uint32_t FrameCount;
+	std::uint32_t JointCount;
+	std::vector<BoneTransform> Keys;
+};
+
+// Up to four joints per vertex, heaviest first.  Unused slots have zero
+// weight; a vertex with no weights is not deformed.
+struct SkinInfluence
+{
+	std::uint16_t Joints[4];
+	float Weights[4];
+};
+
+class CompressedClip;
+
+class Animator
+{
+public:
+	Animator();
+
+	void SetSkeleton(const Skeleton* skeleton);
+
+	// Replace the current pose with the clip sampled at time.
+	void Sample(const AnimationClip& clip, float time, bool loop);
+
+	// Blend the clip sampled at time into the current pose; weight 1 is
+	// the clip alone.
+	void Blend(const AnimationClip& clip, float time, bool loop, float weight);
+
+	// The same for clips kept compressed.
+	void Sample(const CompressedClip& clip, float time, bool loop);
+	void Blend(const CompressedClip& clip, float time, bool loop, float weight);
+
+	// Skinning matrices for the current pose, one per joint.
+	void BuildPalette();
+	const DirectX::XMFLOAT4X4A* Palette()const;
+
+	// Deform count bind pose positions with the current palette, spread over
+	// the thread pool.  Results are written outStride bytes apart so they can
+	// go straight into an interleaved vertex array.
+	void Skin(const DirectX::XMFLOAT3* bindPositions, const SkinInfluence* influences,
+		std::uint32_t count, DirectX::XMFLOAT3* out, std::uint32_t outStride)const;
+
+	// Kernels behind the members above.
+	static void SampleClip(const AnimationClip& clip, float time, bool loop, BoneTransform* pose);
+	static void BlendPoses(const BoneTransform* a, const BoneTransform* b, float weight,
+		std::uint32_t jointCount, BoneTransform* out);
+	static void BuildMatrixPalette(const Skeleton& skeleton, const BoneTransform* pose,
+		DirectX::XMFLOAT4X4A* modelSpace, DirectX::XMFLOAT4X4A* palette);
+	static void SkinPositions(const DirectX::XMFLOAT4X4A* palette, const DirectX::XMFLOAT3* bindPositions,
+		const SkinInfluence* influences, std::uint32_t count, DirectX::XMFLOAT3* out, std::uint32_t outStride);
+
+	// Importer helpers: keep the four heaviest influences, then scale them
+	// to sum to one.
+	static void AddInfluence(SkinInfluence& influence, std::uint16_t joint, float weight);
+	static void NormalizeInfluence(SkinInfluence& influence);
+
+private:
+	const Skeleton* mSkeleton;
+
+	std::vector<BoneTransform> mPose;
+	std::vector<BoneTransform> mScratchPose;
+	std::vector<DirectX::XMFLOAT4X4A> mModelSpace;
+	std::vector<DirectX::XMFLOAT4X4A> mPalette;
+};
+
+#endif // ANIMATION_H
@@ -0,0 +1,85 @@
+#ifndef ANIMATIONCOMPRESSION_H
+#define ANIMATIONCOMPRESSION_H
+
+#include "Animation.h"
+
+// Largest error the encoder may introduce, per component.
+struct CompressionSettings
+{
+	float RotationTolerance;
+	float TranslationTolerance;
+	float ScaleTolerance;
+};
+
+struct CompressionStats
+{
+	size_t RawBytes;
+	size_t CompressedBytes;
+	double Ratio;
+
+	// Measured by decoding every frame and comparing with the source clip.
+	// Rotation error is an angle in radians.
+	float MaxRotationError;
+	float MaxTranslationError;
+	float MaxScaleError;
+};
+
+// An AnimationClip stored compactly for playback.
+//
+// Each joint has three tracks: rotation, translation and scale.  A track
+// that stays within tolerance of one value is stored as that value.  The
+// rest are quantized to 16 bits over the track's own range, and keys that
+// linear interpolation reproduces within tolerance are dropped.
+//
+// Frames are grouped into blocks of BlockFrames.  A block holds, for every
+// animated track, a bitmask of the keys it kept followed by those keys, and
+// always keeps its first and last frame.  The last frame of one block is
+// the first of the next, so sampling a time reads exactly one block, found
+// through an offset table without scanning.
+class CompressedClip
+{
+public:
+	static const std::uint32_t BlockFrames = 16;
+
+	CompressedClip();
+
+	CompressionStats Compress(const AnimationClip& clip, const CompressionSettings& settings);
+
+	void Sample(float time, bool loop, BoneTransform* pose)const;
+
+	const std::string& Name()const { return mName; }
+	float Duration()const { return mDuration; }
+	std::uint32_t JointCount()const { return mJointCount; }
+
+	size_t SizeInBytes()const;
+
+private:
+	enum Channel
+	{
+		Rotation,
+		Translation,
+		Scale,
+		ChannelCount
+	};
+
+	static std::uint32_t ComponentCount(std::uint32_t track) { return track % ChannelCount == Rotation ? 4 : 3; }
+
+private:
+	std::string mName;
+	float mDuration;
+	float mSampleRate;
+	std::uint32_t mFrameCount;
+	std::uint32_t mJointCount;
+
+	// Per track, JointCount * ChannelCount of them.  Constant tracks keep
+	// their value in mTrackMin.
+	std::vector<DirectX::XMFLOAT4A> mTrackMin;
+	std::vector<DirectX::XMFLOAT4A> mTrackScale;
+	std::vector<std::uint8_t> mTrackAnimated;
+
+	// Start of each block in mBlockData.
+	std::vector<std::uint32_t> mBlockOffsets;
+	std::vector<std::uint16_t> mBlockData;
+};
+
+#endif // ANIMATIONCOMPRESSION_H
@@ -0,0 +1,105 @@
+#ifndef APPEVENTQUEUE_H
+#define APPEVENTQUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include "SpscQueue.h"
+
+// A window message forwarded from the window thread to the render thread.
+struct AppEvent
+{
+	enum Type
+	{
+		MouseDown,
+		MouseUp,
+		MouseMove,
+		KeyDown,
+		Resize,  // X, Y hold the new client width and height.
+		Pause,
+		Resume
+	};
+
+	Type EventType;
+	std::uintptr_t Param; // WPARAM
+	int X;
+	int Y;
+	std::int64_t Timestamp; // When the message arrived, in the poster's ticks.
+};
+
+// What a Drain saw besides the events it handed out.  Resizes are folded
+// into the last size; FirstInput is the timestamp of the oldest input, or
+// 0 when there was none.
+struct AppEventBatch
+{
+	std::uint32_t Count;
+	bool Resized;
+	int Width;
+	int Height;
+	std::int64_t FirstInput;
+};
+
+// Hands window messages from the window thread to the render thread
+// without the window thread ever waiting.  Events go through a SpscQueue;
+// while it is full they wait, in order, in a backlog the window thread
+// keeps, where a mouse move or resize replaces one just before it.  The
+// window thread calls Flush when it can to move the backlog on.
+class AppEventQueue
+{
+public:
+	static const std::uint32_t Capacity = 256;
+
+	AppEventQueue();
+
+	AppEventQueue(const AppEventQueue&) = delete;
+	AppEventQueue& operator=(const AppEventQueue&) = delete;
+
+	// Window thread only.  Post never blocks; Flush returns how many
+	// backlogged events it moved into the queue.
+	void Post(const AppEvent& e);
+	std::uint32_t Flush();
+	std::uint32_t Backlog()const;
+	std::uint64_t Coalesced()const;
+
+	// Render thread only.  Calls handle for every event but Resize, in the
+	// order they were posted.
+	template<typename Handler>
+	AppEventBatch Drain(Handler handle);
+
+private:
+	static bool IsInput(AppEvent::Type type);
+
+	SpscQueue<AppEvent, Capacity> mQueue;
+	std::deque<AppEvent> mBacklog;
+	std::uint64_t mCoalesced;
+};
+
+template<typename Handler>
+AppEventBatch AppEventQueue::Drain(Handler handle)
+{
+	AppEventBatch batch = { 0, false, 0, 0, 0 };
+	AppEvent e;
+
+	while (mQueue.Pop(e))
+	{
+		++batch.Count;
+
+		// A drag can queue many of these; only the last one matters.
+		if (e.EventType == AppEvent::Resize)
+		{
+			batch.Resized = true;
+			batch.Width = e.X;
+			batch.Height = e.Y;
+			continue;
+		}
+
+		handle(e);
+
+		// Events arrive in order, so the first input is the oldest one.
+		if (IsInput(e.EventType) && batch.FirstInput == 0)
+			batch.FirstInput = e.Timestamp;
+	}
+
+	return batch;
+}
+
+#endif // APPEVENTQUEUE_H
@@ -0,0 +1,81 @@
+#ifndef BEZIERSURFACE_H
+#define BEZIERSURFACE_H
+
+#include "GeometryGenerator.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Bicubic Bezier patches tessellated finely enough that the polygons stay
+// within a pixel error of the surface, and no finer.
+//
+// Each edge of a patch is cut into a number of segments chosen from that
+// edge's four control points alone, so the two patches sharing it choose
+// the same, and its vertices are evaluated from the same points in the
+// same direction, so they match bit for bit and the mesh has no cracks.
+// Inside the edges a patch is a regular grid, joined to each edge by a
+// strip that zips the two rows of vertices together.
+//
+// Update only retessellates the patches whose factors changed, spread
+// over the thread pool.
+class BezierSurface
+{
+public:
+	static const std::uint32_t MaxFactor = 32;
+
+	// Bounds on one patch's mesh, for sizing buffers.
+	static const std::uint32_t MaxPatchVertices = (MaxFactor + 1) * (MaxFactor + 1);
+	static const std::uint32_t MaxPatchIndices = 6 * MaxFactor * MaxFactor;
+
+	// patches holds 16 control point indices per patch, four rows of four
+	// with u along a row and v across rows.  Neighbouring patches share
+	// the indices of their common edge.  Front faces point along
+	// dP/du x dP/dv.
+	void Create(const DirectX::XMFLOAT3* controlPoints, std::uint32_t controlPointCount,
+		const std::uint32_t* patches, std::uint32_t patchCount);
+
+	// eye is the camera in surface space, and pixelScale is as for
+	// Terrain::Select: an error e at distance d covers e * pixelScale / d
+	// pixels.  Scaling the surface must be uniform.
+	void Update(DirectX::FXMVECTOR eye, float pixelScale, float pixelError);
+
+	std::uint32_t PatchCount()const;
+
+	// Patches retessellated by the last Update.
+	const std::vector<std::uint32_t>& ChangedPatches()const;
+
+	// TexC is the patch's (u, v).
+	const GeometryGenerator::MeshData& PatchMesh(std::uint32_t patch)const;
+
+	std::uint64_t TriangleCount()const;
+
+private:
+	// Factors of a patch: its grid across u and v, then its edges in the
+	// order v = 0, u = 1, v = 1, u = 0, counterclockwise in (u, v).
+	struct Factors
+	{
+		std::uint32_t U;
+		std::uint32_t V;
+		std::uint32_t Edges[4];
+	};
+
+	static std::uint32_t Factor(float flatness, float tolerance);
+	void Tessellate(std::uint32_t patch, GeometryGenerator::MeshData& mesh)const;
+
+	std::vector<DirectX::XMFLOAT3> mControlPoints;
+	std::vector<std::uint32_t> mPatches;
+
+	// The edges once each, by their control points in a canonical
+	// direction; a patch whose edge runs the other way is reversed.
+	std::vector<std::uint32_t> mEdgePoints;
+	std::vector<std::uint32_t> mPatchEdges;
+	std::vector<std::uint8_t> mPatchReversed;
+
+	std::vector<std::uint32_t> mEdgeFactors;
+	std::vector<Factors> mFactors;
+	std::vector<GeometryGenerator::MeshData> mMeshes;
+	std::vector<std::uint32_t> mChanged;
+	std::uint64_t mTriangleCount = 0;
+};
+
+#endif // BEZIERSURFACE_H
@@ -0,0 +1,53 @@
+#ifndef BLOCKCOMPRESSION_H
+#define BLOCKCOMPRESSION_H
+
+#include "Texture.h"
+#include <cstdint>
+#include <vector>
+
+// Encodes RGBA8 images into the GPU block formats, one 4x4 block at a
+// time.  Blocks are independent, so they are spread over the thread pool.
+//
+// BC1 stores RGB in 8 bytes, BC3 adds an interpolated alpha block for 16,
+// and BC7 is written in mode 6 only: one subset, RGBA endpoints and 4-bit
+// indices, which is the fastest mode to search and good for most content.
+class BlockCompressor
+{
+public:
+	enum Format
+	{
+		BC1,
+		BC3,
+		BC7
+	};
+
+	// Bytes per 4x4 block.
+	static std::uint32_t BlockSize(Format format);
+	static size_t LevelSize(Format format, std::uint32_t width, std::uint32_t height);
+
+	// Edge pixels are repeated to fill blocks that hang over the image.
+	static void Encode(const TextureImage& image, Format format, std::vector<std::uint8_t>& blocks);
+
+	// Decodes what Encode writes.  BC7 blocks in other modes come back as
+	// opaque magenta.
+	static bool Decode(const std::uint8_t* blocks, size_t size, Format format,
+		std::uint32_t width, std::uint32_t height, TextureImage& image);
+
+	// Peak signal to noise ratio in dB over RGB, or RGBA if alpha is set.
+	static double Psnr(const TextureImage& a, const TextureImage& b, bool alpha);
+};
+
+// A block-compressed image and its mips, ready to upload as is.
+struct CompressedTexture
+{
+	BlockCompressor::Format Format;
+	std::uint32_t Width;
+	std::uint32_t Height;
+	std::vector<std::vector<std::uint8_t>> Levels;
+
+	// The cooker's own identifier for what the texture was made from,
+	// stored in the DDS header's reserved words; zero if none.
+	std::uint64_t Tag = 0;
+};
+
+#endif // BLOCKCOMPRESSION_H
@@ -0,0 +1,110 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Axis-aligned boxes of many objects, a component per array, so passes
+// over them read only what they use.
+struct BoxArrays
+{
+	std::vector<float> MinX;
+	std::vector<float> MinY;
+	std::vector<float> MinZ;
+	std::vector<float> MaxX;
+	std::vector<float> MaxY;
+	std::vector<float> MaxZ;
+
+	void Resize(std::uint32_t count);
+	std::uint32_t Size()const;
+	void Set(std::uint32_t i, DirectX::FXMVECTOR min, DirectX::FXMVECTOR max);
+};
+
+// Two objects whose boxes overlap, touching included, with A < B.
+struct BroadphasePair
+{
+	std::uint32_t A;
+	std::uint32_t B;
+};
+
+// Both broadphases below give their pairs sorted by A and then B, the
+// same list for the same boxes whatever the thread count or history.
+
+// Sweep and prune along one axis.  The objects stay sorted from one
+// update to the next and are re-sorted by insertion, which is close to
+// linear while they move a little per frame.  Then each object's box is
+// tested against the following ones up to the end of its span, four at a
+// time, with the sorted objects split into ranges across the thread pool.
+class SweepAndPrune
+{
+public:
+	void Update(const BoxArrays& boxes);
+	void Clear();
+
+	const std::vector<BroadphasePair>& Pairs()const;
+
+	// Swaps the last re-sort made; a measure of how coherent motion was.
+	std::uint64_t SortSwaps()const;
+
+private:
+	void Gather(const BoxArrays& boxes);
+
+	// Sweeps along the axis with the widest spread of box centers, chosen
+	// when the objects are first sorted.
+	int mAxis = 0;
+
+	// Objects in sorted order, and their boxes in that order with the
+	// sweep axis first.  Ties between keys are broken by object so the
+	// order is unique.
+	std::vector<std::uint32_t> mOrder;
+	std::vector<float> mKeys;
+	BoxArrays mSorted;
+
+	std::vector<BroadphasePair> mPairs;
+	std::uint64_t mSortSwaps = 0;
+};
+
+// A uniform grid hashed by cell, for objects of about the same size.
+// Cells are as wide as the biggest box, so a box overlaps only boxes
+// whose centers are in its own cell or one of the 26 around it, and each
+// pair of neighbouring cells is visited from one side only.
+class HashGrid
+{
+public:
+	void Update(const BoxArrays& boxes);
+	void Clear();
+
+	const std::vector<BroadphasePair>& Pairs()const;
+
+	float CellSize()const;
+	std::uint32_t CellCount()const;
+
+private:
+	struct Cell
+	{
+		std::uint64_t Key;
+		std::uint32_t First;
+		std::uint32_t Count;
+	};
+
+	// The cell with key, or nullptr.
+	const Cell* Find(std::uint64_t key)const;
+
+	float mCellSize = 0.0f;
+
+	// Cell keys and objects, sorted by cell and then by object, and the
+	// boxes in the same order.
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> mEntries;
+	BoxArrays mSorted;
+
+	// The occupied cells in order, and again open addressed by key, where
+	// an empty slot has no objects.
+	std::vector<Cell> mCells;
+	std::vector<Cell> mTable;
+
+	std::vector<BroadphasePair> mPairs;
+};
+
+#endif // BROADPHASE_H
@@ -0,0 +1,102 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+struct BvhHit
+{
+	float Distance;
+	std::uint32_t Triangle;
+
+	// Barycentrics of the hit: weights of the triangle's second and third
+	// vertices.
+	float U;
+	float V;
+};
+
+// Bounding volume hierarchy over a triangle mesh for ray and nearest
+// point queries.
+//
+// It is built as a binary tree with a binned surface area heuristic, the
+// top splits binning on the thread pool and the subtrees below them built
+// in parallel, then collapsed to four children per node.  A node keeps its
+// children's bounds side by side so a ray is tested against all four in
+// one pass, and every leaf is a packet of up to four triangles, also
+// tested at once.  Triangles are copied into the packets, so the mesh is
+// not needed afterwards.
+class Bvh
+{
+public:
+	// positions is read with a stride of positionStride bytes, so it can
+	// point into a vertex array.
+	void Build(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride,
+		const std::uint32_t* indices, std::uint32_t triangleCount);
+
+	void Clear();
+
+	// The nearest hit along direction from origin, no further than
+	// maxDistance in units of direction's length.  Both sides of a
+	// triangle count.
+	bool Intersect(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, BvhHit& hit)const;
+
+	// Whether anything at all is hit; stops at the first triangle found.
+	bool Occluded(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance)const;
+
+	// The point of the mesh nearest to point, if any is closer than
+	// maxDistance.  Distance is then the distance to it, and U and V its
+	// barycentrics.
+	bool Nearest(DirectX::FXMVECTOR point, float maxDistance, BvhHit& nearest)const;
+
+	std::uint32_t TriangleCount()const;
+	std::uint32_t NodeCount()const;
+	size_t SizeInBytes()const;
+
+private:
+	// 112 bytes.  A child is a node index, LeafBit plus a packet index, or
+	// EmptyChild, whose bounds are inside out so no ray hits them.
+	struct Node
+	{
+		DirectX::XMFLOAT4A MinX;
+		DirectX::XMFLOAT4A MinY;
+		DirectX::XMFLOAT4A MinZ;
+		DirectX::XMFLOAT4A MaxX;
+		DirectX::XMFLOAT4A MaxY;
+		DirectX::XMFLOAT4A MaxZ;
+		std::uint32_t Children[4];
+	};
+
+	// Four triangles as a vertex and two edges each, one lane per
+	// triangle.  Unused lanes have zero edges and are never hit.
+	struct TrianglePacket
+	{
+		DirectX::XMFLOAT4A V0X;
+		DirectX::XMFLOAT4A V0Y;
+		DirectX::XMFLOAT4A V0Z;
+		DirectX::XMFLOAT4A E1X;
+		DirectX::XMFLOAT4A E1Y;
+		DirectX::XMFLOAT4A E1Z;
+		DirectX::XMFLOAT4A E2X;
+		DirectX::XMFLOAT4A E2Y;
+		DirectX::XMFLOAT4A E2Z;
+		std::uint32_t Triangles[4];
+	};
+
+	struct BuildNode;
+	struct BuildContext;
+
+	static const std::uint32_t LeafBit = 0x80000000;
+	static const std::uint32_t EmptyChild = 0xffffffff;
+
+	template <bool AnyHit>
+	bool Traverse(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, BvhHit& hit)const;
+
+	std::uint32_t Collapse(const BuildContext& context, std::uint32_t buildNode);
+
+	std::vector<Node> mNodes;
+	std::vector<TrianglePacket> mPackets;
+	std::uint32_t mTriangleCount = 0;
+};
+
+#endif // BVH_H
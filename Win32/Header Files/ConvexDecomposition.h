@@ -0,0 +1,52 @@
+#ifndef CONVEXDECOMPOSITION_H
+#define CONVEXDECOMPOSITION_H
+
+#include "ConvexHull.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// A closed triangle mesh split into convex pieces, after V-HACD (Mamou 2016):
+// cheap collision proxies for meshes too detailed to use.
+//
+// The mesh is voxelized solid with VoxelOctree, and a piece is the voxels
+// set inside a box.  A piece's concavity is the volume its hull adds to
+// it, over the volume of the whole mesh.  The most concave piece is cut in
+// two by the plane across one of the axes that leaves the least concavity
+// on the two sides, out of a few evenly spaced planes per axis, which are
+// tried in parallel on the thread pool.
+//
+// A hull is built from the ends of the rows of set voxels in its piece,
+// which have the same hull as the voxels.  Voxels are set wherever the
+// surface touches them, so the hulls cover the mesh.
+class ConvexDecomposition
+{
+public:
+	// resolution is the voxelization's, as for VoxelOctree.  Cutting stops
+	// once no piece is more concave than maxConcavity or there are
+	// maxHulls.  The hulls given keep at most maxHullVertices each, or all
+	// their vertices for 0.
+	void Build(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, std::uint32_t resolution, std::uint32_t maxHulls, float maxConcavity,
+		std::uint32_t maxHullVertices);
+
+	void Clear();
+
+	const std::vector<ConvexHull>& Hulls()const;
+
+	// The largest concavity of a piece, measured before the vertex budget.
+	float Concavity()const;
+
+private:
+	struct Piece;
+	struct BuildContext;
+
+	// Tightens piece's box to the set voxels in it and builds their hull
+	// with up to maxVertices.  False if there are none.
+	static bool Measure(const BuildContext& context, Piece& piece, std::uint32_t maxVertices);
+
+	std::vector<ConvexHull> mHulls;
+	float mConcavity = 0.0f;
+};
+
+#endif // CONVEXDECOMPOSITION_H
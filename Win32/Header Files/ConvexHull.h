@@ -0,0 +1,71 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// The convex hull of a set of points by quickhull (Barber, Dobkin and
+// Huhdanpaa 1996), as triangles.
+//
+// Points within a tolerance of a face count as on it, the tolerance
+// growing with the size of the coordinates, so flat and duplicated points
+// add nothing.  Where rounding would leave a point's new faces folded
+// over an old one, the old one is replaced too, and a point whose visible
+// faces do not make one patch is dropped.  The mesh stays closed and
+// convex, with every point inside it to within tens of times the
+// tolerance at worst.
+//
+// The first pass over the points and the larger passes after it are split
+// across the thread pool, into the same lists whatever the thread count.
+//
+// The furthest point from the hull so far is always added next, so a hull
+// stopped short at a vertex budget is the best of that many points the
+// algorithm can give, though points can be left outside it.
+class ConvexHull
+{
+public:
+	// points is read with a stride of pointStride bytes.  maxVertices of 0
+	// means no budget, and a budget under 4 counts as 4.  Returns false and
+	// leaves the hull empty if the points are all within the tolerance of
+	// one plane.
+	bool Build(const DirectX::XMFLOAT3* points, std::uint32_t pointStride, std::uint32_t count, std::uint32_t maxVertices = 0);
+
+	void Clear();
+
+	const std::vector<DirectX::XMFLOAT3>& Vertices()const;
+
+	// Three per triangle, with (b - a) x (c - a) pointing out.
+	const std::vector<std::uint32_t>& Indices()const;
+
+	// A plane per triangle, with xyz its outward unit normal and w so that
+	// dot(normal, p) + w is the distance out.
+	const std::vector<DirectX::XMFLOAT4>& Planes()const;
+
+	std::uint32_t TriangleCount()const;
+	float Tolerance()const;
+	float Volume()const;
+
+	// True for points no further out of any face than the tolerance.
+	bool Contains(DirectX::FXMVECTOR point)const;
+
+private:
+	struct Face;
+	struct BuildContext;
+
+	// Gives each of the points to the first of the faces it is outside of,
+	// in order, and notes the furthest out of each face.
+	static void Assign(BuildContext& context, const std::uint32_t* points, std::uint32_t count,
+		const std::uint32_t* faces, std::uint32_t faceCount);
+
+	// Adds the furthest point out of face, or drops it; false if dropped.
+	static bool AddPoint(BuildContext& context, std::uint32_t face);
+
+	std::vector<DirectX::XMFLOAT3> mVertices;
+	std::vector<std::uint32_t> mIndices;
+	std::vector<DirectX::XMFLOAT4> mPlanes;
+	float mTolerance = 0.0f;
+	float mVolume = 0.0f;
+};
+
+#endif // CONVEXHULL_H
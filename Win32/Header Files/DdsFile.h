@@ -0,0 +1,33 @@
+#ifndef DDSFILE_H
+#define DDSFILE_H
+
+#include "BlockCompression.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where each level of a DDS file's data lives, so the levels can be used
+// in place, for instance from a mapped file.
+struct DdsLayout
+{
+	BlockCompressor::Format Format;
+	std::uint32_t Width;
+	std::uint32_t Height;
+	std::vector<size_t> LevelOffsets;
+	std::vector<size_t> LevelSizes;
+	std::uint64_t Tag;
+};
+
+// DirectDraw Surface files holding a block-compressed texture and its
+// mips.  BC1 and BC3 are written with the legacy DXT1/DXT5 codes so older
+// tools can open them; BC7 needs the DX10 extension header.
+class DdsFile
+{
+public:
+	static bool Save(const std::string& filename, const CompressedTexture& texture);
+	static bool Load(const std::string& filename, CompressedTexture& texture);
+	static bool Parse(const std::uint8_t* data, size_t size, CompressedTexture& texture);
+	static bool ParseLayout(const std::uint8_t* data, size_t size, DdsLayout& layout);
+};
+
+#endif // DDSFILE_H
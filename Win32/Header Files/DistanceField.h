@@ -0,0 +1,82 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include "Bvh.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// A signed distance field of a closed triangle mesh, sampled at the
+// centers of a cube of resolution^3 voxels around it, negative inside.
+//
+// Only a narrow band around the surface is stored: the grid is split into
+// bricks of 8^3 samples, and a brick nothing of the surface comes within
+// the band of keeps just whether it is inside.  The other bricks hold
+// their distances as signed bytes, a step of band / 127 apiece.
+//
+// Distances are found with the mesh's Bvh.  Signs come from the parity of
+// crossings along x, as in VoxelOctree's fill, which needs no normals and
+// counts a crossing through a shared edge or vertex once.  A column of
+// bricks along x is baked per task on the thread pool.
+class DistanceField
+{
+public:
+	static const std::uint32_t BrickSize = 8;
+
+	// bvh is built over the same triangles.  resolution is rounded up to a
+	// multiple of BrickSize, and band is in voxels.  A bake in the
+	// background passes a pool of its own.
+	void Bake(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, const Bvh& bvh, std::uint32_t resolution, float band);
+	void Bake(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, const Bvh& bvh, std::uint32_t resolution, float band, ThreadPool& pool);
+
+	void Clear();
+
+	// Trilinear between samples, so exact at them.  Outside the band it is
+	// band, or -band inside; points beyond the grid take its nearest sample.
+	float Sample(DirectX::FXMVECTOR point)const;
+
+	// Sphere traces the field from origin along direction, no further than
+	// maxDistance in units of direction's length, to where it is within
+	// a tenth of a voxel of the surface.
+	bool SphereTrace(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, float& distance)const;
+
+	std::uint32_t Resolution()const;
+	float VoxelSize()const;
+
+	// The corner of voxel (0, 0, 0).
+	DirectX::XMFLOAT3 Origin()const;
+
+	// In the mesh's units.
+	float Band()const;
+
+	std::uint32_t BrickCount()const;
+	size_t SizeInBytes()const;
+
+private:
+	static const std::uint32_t BrickSamples = BrickSize * BrickSize * BrickSize;
+
+	// Brick indices of bricks with no samples stored.
+	static const std::uint32_t OutsideBrick = 0xffffffff;
+	static const std::uint32_t InsideBrick = 0xfffffffe;
+
+	struct BuildContext;
+
+	void BakeColumn(BuildContext& context, std::uint32_t column)const;
+
+	// The sample at voxel (x, y, z), clamped to the grid, in voxels.
+	float Voxel(std::int32_t x, std::int32_t y, std::int32_t z)const;
+
+	std::vector<std::uint32_t> mBricks;
+	std::vector<std::int8_t> mSamples;
+	std::uint32_t mResolution = 0;
+	std::uint32_t mGrid = 0;
+	float mVoxelSize = 0.0f;
+	float mBand = 0.0f;
+	DirectX::XMFLOAT3 mOrigin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+};
+
+#endif // DISTANCEFIELD_H
@@ -0,0 +1,48 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Complex FFTs of square grids on the CPU, radix 2 and decimation in time.
+//
+// Transforms are done four at a time, one per lane of a vector, so every
+// butterfly is vector arithmetic with a twiddle shared by the lanes.  Four
+// rows are transposed into a strip with a point of each row in a vector,
+// and four columns already are one, lying side by side in each row.  A
+// strip is bit-reversed as it is gathered and transformed in scratch of
+// its own, small enough to stay in cache however strided the gather.
+//
+// Rows and then columns are split across the thread pool a range of
+// strips per task, each task with scratch made by Create, so transforms
+// allocate nothing.  Results do not depend on the thread count.
+class Fft
+{
+public:
+	// size must be a power of two of at least 4.
+	void Create(std::uint32_t size);
+
+	// Transforms the size x size grid in real and imag, x fastest, in
+	// place.  The forward transform sums with exp(-2 pi i jk / size), the
+	// inverse with exp(+2 pi i jk / size), and neither scales the result.
+	void Transform(float* real, float* imag, bool inverse);
+
+	std::uint32_t Size()const;
+
+private:
+	std::uint32_t mSize = 0;
+	std::uint32_t mTaskCount = 0;
+
+	// Each index with its bits reversed.
+	std::vector<std::uint32_t> mReversed;
+
+	// exp(-pi i j / span) for each stage's span at [span + j].
+	std::vector<float> mTwiddleReal;
+	std::vector<float> mTwiddleImag;
+
+	// A strip's real then imaginary parts for each task.
+	std::vector<DirectX::XMFLOAT4A> mScratch;
+};
+
+#endif // FFT_H
@@ -0,0 +1,131 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Time source used by FramePacer.  Pass a fake implementation to drive the
+// pacer deterministically; HighResolutionClock is used otherwise.
+class PacingClock
+{
+public:
+	virtual ~PacingClock() { }
+
+	virtual std::int64_t Now() = 0;
+	virtual std::int64_t TicksPerSecond() = 0;
+
+	// Coarse wait.  May oversleep, and returns early if Wake is called.
+	virtual void Sleep(std::int64_t ticks) = 0;
+	virtual void Wake() = 0;
+
+	// Called once per iteration of the busy wait that follows Sleep.
+	virtual void Spin() { }
+};
+
+// steady_clock for time, a condition variable for sleeping.  On Windows the
+// system timer resolution is raised to 1 ms for the lifetime of the clock.
+class HighResolutionClock : public PacingClock
+{
+public:
+	HighResolutionClock();
+	~HighResolutionClock();
+
+	std::int64_t Now() override;
+	std::int64_t TicksPerSecond() override;
+	void Sleep(std::int64_t ticks) override;
+	void Wake() override;
+	void Spin() override;
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	bool mWoken;
+};
+
+// Pacing error statistics, in seconds.  Error is how late a frame started
+// relative to its deadline; interval is the time between frame starts.
+struct PacingStats
+{
+	std::uint32_t FrameCount;
+	double MeanError;
+	double MaxError;
+	double MeanInterval;
+	double IntervalJitter; // standard deviation of the interval
+};
+
+// Starts frames at a fixed rate by sleeping until shortly before each
+// deadline and spinning for the rest, which is both accurate and cheap.
+// While idle (minimized or inactive) frames are paced at a low rate that
+// keeps dropping the longer the app stays idle, and only sleeping is used.
+class FramePacer
+{
+public:
+	// The pacer does not own clock.  Null selects an internal HighResolutionClock.
+	explicit FramePacer(PacingClock* clock = nullptr);
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// 0 disables the cap (the swap chain's vsync is then the only limit).
+	void SetTargetFrameRate(double fps);
+	double TargetFrameRate()const;
+
+	// The idle rate starts at startFps and halves for every second spent idle,
+	// down to minFps.
+	void SetIdleFrameRate(double startFps, double minFps);
+
+	// How long before a deadline to stop sleeping and start spinning.
+	void SetSpinThreshold(double seconds);
+
+	void SetIdle(bool idle);
+	bool IsIdle()const;
+
+	// Block until the next frame should start.  Returns this frame's pacing
+	// error in seconds (0 when uncapped).  Only frames that are not idle
+	// are counted in Stats and ErrorHistory.
+	double WaitForNextFrame();
+
+	// Cut a pending idle sleep short, e.g. because input arrived.  Active
+	// frames keep their deadline.  Any thread.
+	void Wake();
+
+	const PacingStats& Stats()const;
+	void ResetStats();
+
+	// Per-frame error history in seconds, 0 being the most recent frame.
+	static const std::uint32_t HistorySize = 256;
+	double ErrorHistory(std::uint32_t framesAgo)const;
+
+private:
+	std::int64_t CurrentPeriod(std::int64_t now);
+	void Record(std::int64_t now, std::int64_t deadline);
+
+private:
+	PacingClock* mClock;
+	bool mOwnsClock;
+	double mSecondsPerTick;
+
+	double mTargetFrameRate;
+	double mIdleStartFrameRate;
+	double mIdleMinFrameRate;
+	std::int64_t mSpinThreshold;
+
+	bool mIdle;
+	std::int64_t mIdleSince;
+
+	std::int64_t mNextDeadline;
+	std::int64_t mLastFrameStart;
+
+	PacingStats mStats;
+	double mErrorSum;
+	double mIntervalSum;
+	double mIntervalSqSum;
+	std::uint32_t mIntervalCount;
+
+	float mErrorHistory[HistorySize];
+	std::uint32_t mHistoryIndex;
+};
+
+#endif // FRAMEPACER_H
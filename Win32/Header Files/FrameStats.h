@@ -0,0 +1,81 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Frame time summary in milliseconds.
+struct FrameStatsSummary
+{
+	std::uint32_t FrameCount;
+	double MinMs;
+	double AvgMs;
+	double P50Ms;
+	double P95Ms;
+	double P99Ms;
+	double MaxMs;
+	std::uint32_t StutterCount; // see FrameStats::StutterFactor
+};
+
+// Records the time of every frame.  The most recent frames are kept in a
+// ring; every frame since Reset is also counted in a fixed-bucket histogram.
+// Nothing allocates after construction.
+//
+// A frame is a stutter when it takes over StutterFactor times a slowly
+// moving average of the frames before it, so a single long frame counts
+// but a sustained drop in frame rate does not.  Frames are judged as they
+// arrive, and recent and session summaries count the same frames.
+//
+// AddFrame must be called from a single thread (the render thread).  The
+// query functions may be called from any thread at any time: the data is
+// read without locks, so a summary taken while frames are being added can
+// be off by the frames recorded during the read, but it is never invalid.
+class FrameStats
+{
+public:
+	static const std::uint32_t RingSize = 1024;     // power of two
+	static const std::uint32_t BucketCount = 256;   // plus one overflow bucket
+	static const double BucketWidthMs;              // 0.25 ms, so buckets cover 0-64 ms
+	static const double StutterFactor;              // 2x the moving average
+
+	FrameStats();
+
+	void AddFrame(double frameMs);
+	void Reset();
+
+	std::uint64_t FrameCount()const;
+
+	// Statistics over the last frameCount frames (at most RingSize), all
+	// exact.
+	FrameStatsSummary SummarizeRecent(std::uint32_t frameCount)const;
+
+	// Statistics over every frame since Reset.  Min, max and average are
+	// exact; percentiles come from the histogram, accurate to BucketWidthMs
+	// up to its 64 ms and within [min, max] past it.
+	FrameStatsSummary SummarizeSession()const;
+
+	// Write both summaries and the session histogram as JSON.
+	bool WriteJson(const char* path)const;
+
+private:
+	static std::uint32_t BucketIndex(double frameMs);
+	static double Percentile(const std::uint32_t* buckets, std::uint32_t total, double fraction);
+	static double Percentile(const float* sorted, std::uint32_t count, double fraction);
+
+private:
+	std::atomic<std::uint64_t> mFrameCount;
+	std::atomic<float> mRing[RingSize];
+	std::atomic<bool> mStutterRing[RingSize];
+
+	// Session statistics, written only by the recording thread.
+	std::atomic<std::uint32_t> mHistogram[BucketCount + 1];
+	std::atomic<double> mSessionMinMs;
+	std::atomic<double> mSessionMaxMs;
+	std::atomic<double> mSessionSumMs;
+	std::atomic<std::uint32_t> mSessionStutters;
+
+	// Smoothed frame time used to detect stutters as frames arrive.
+	double mAverageMs;
+};
+
+#endif // FRAMESTATS_H
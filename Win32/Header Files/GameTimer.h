@@ -9,6 +9,14 @@ public:
 	float TotalTime()const;  // in seconds
 	float DeltaTime()const; // in seconds
 
+	// Exact counterparts in performance counter ticks.  A float TotalTime
+	// loses millisecond precision after a few hours; use these, or
+	// TotalTimeSeconds, for anything that must stay accurate indefinitely.
+	__int64 TotalTicks()const;
+	__int64 DeltaTicks()const;
+	__int64 TicksPerSecond()const;
+	double TotalTimeSeconds()const;
+
 	void Reset(); // Call before message loop.
 	void Start(); // Call when unpaused.
 	void Stop();  // Call when paused.
@@ -18,6 +26,9 @@ private:
 	double mSecondsPerCount;
 	double mDeltaTime;
 
+	__int64 mCountsPerSecond;
+	__int64 mDeltaTicks;
+
 	__int64 mBaseTime;
 	__int64 mPausedTime;
 	__int64 mStopTime;
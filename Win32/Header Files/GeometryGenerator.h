@@ -16,6 +16,7 @@
 
 #include <cstdint>
 #include <DirectXMath.h>
+#include <functional>
 #include <vector>
 
 class GeometryGenerator
@@ -53,6 +54,13 @@ public:
         DirectX::XMFLOAT2 TexC;
 	};
 
+	///<summary>
+	/// Evaluates a scalar field at count points along a row, at (x[i], y, z).
+	/// Whole rows are asked for at once so the field can be evaluated several
+	/// points at a time.  A grid point always gets the same coordinates.
+	///</summary>
+	using FieldRow = std::function<void(const float* x, float y, float z, uint32 count, float* values)>;
+
 	struct MeshData
 	{
 		std::vector<Vertex> Vertices;
@@ -110,7 +118,28 @@ public:
 	///</summary>
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
+	///<summary>
+	/// Creates the surface where a field equals isoValue, sampled at nx*ny*nz
+	/// points cellSize apart starting from origin.  The field is below
+	/// isoValue inside, normals follow its gradient and the mesh is closed
+	/// wherever the surface stays inside the grid.  Blocks of the grid are
+	/// meshed in parallel, and the result does not depend on how many
+	/// threads there are.
+	///</summary>
+    MeshData CreateIsosurface(const FieldRow& field, const DirectX::XMFLOAT3& origin, float cellSize,
+        uint32 nx, uint32 ny, uint32 nz, float isoValue);
+
+	///<summary>
+	/// The same over a field already sampled on the grid, x varying fastest.
+	///</summary>
+    MeshData CreateIsosurface(const float* samples, const DirectX::XMFLOAT3& origin, float cellSize,
+        uint32 nx, uint32 ny, uint32 nz, float isoValue);
+
 private:
+	using SampleRow = std::function<void(uint32 x, uint32 y, uint32 z, uint32 count, float* values)>;
+
+    MeshData MarchTetrahedra(const SampleRow& sampleRow, const DirectX::XMFLOAT3& origin, float cellSize,
+        uint32 nx, uint32 ny, uint32 nz, float isoValue);
 	void Subdivide(MeshData& meshData);
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
     void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
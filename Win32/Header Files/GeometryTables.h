@@ -0,0 +1,524 @@
+#ifndef GEOMETRYTABLES_H
+#define GEOMETRYTABLES_H
+
+#include "GeometryGenerator.h"
+#include <DirectXMath.h>
+#include <cstdint>
+
+// GeometryGenerator's common primitives worked out by the compiler.  Bound
+// to a constexpr variable, a mesh is read-only data in the binary and
+// costs nothing at startup:
+//
+//   static constexpr auto Sphere = GeometryTables::UVSphere<60, 60>(1.0f);
+//
+// Each builder follows the runtime generator step for step, in the same
+// float arithmetic, so the tables match CreateBox, CreateSphere,
+// CreateGeosphere and CreateQuad to within the last bit of the
+// trigonometry.  The project raises MSVC's constexpr step limit, which the
+// larger meshes run past.
+namespace GeometryTables
+{
+	// Laid out like GeometryGenerator::Vertex, which has no constexpr
+	// constructor.
+	struct BakedVertex
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMFLOAT3 TangentU;
+		DirectX::XMFLOAT2 TexC;
+	};
+
+	static_assert(sizeof(BakedVertex) == sizeof(GeometryGenerator::Vertex), "BakedVertex must match GeometryGenerator::Vertex");
+
+	template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+	struct BakedMesh
+	{
+		static const std::uint32_t VertexCount = VertexCountT;
+		static const std::uint32_t IndexCount = IndexCountT;
+
+		BakedVertex Vertices[VertexCountT];
+		std::uint32_t Indices[IndexCountT];
+	};
+
+	template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+	const std::uint32_t BakedMesh<VertexCountT, IndexCountT>::VertexCount;
+
+	template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+	const std::uint32_t BakedMesh<VertexCountT, IndexCountT>::IndexCount;
+
+	// A copy for code that takes MeshData.
+	template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+	GeometryGenerator::MeshData ToMeshData(const BakedMesh<VertexCountT, IndexCountT>& mesh)
+	{
+		GeometryGenerator::MeshData meshData;
+		meshData.Vertices.resize(VertexCountT);
+		for (std::uint32_t i = 0; i < VertexCountT; ++i)
+		{
+			const BakedVertex& v = mesh.Vertices[i];
+			meshData.Vertices[i] = GeometryGenerator::Vertex(v.Position, v.Normal, v.TangentU, v.TexC);
+		}
+
+		meshData.Indices32.assign(mesh.Indices, mesh.Indices + IndexCountT);
+		return meshData;
+	}
+
+	namespace Detail
+	{
+		// The float constants of DirectXMath that the generator uses.
+		constexpr float Pi = 3.141592654f;
+		constexpr float TwoPi = 6.283185307f;
+
+		constexpr double PiD = 3.14159265358979323846;
+
+		// Double precision, so rounding to float gives what the CRT's
+		// float functions give but for the odd last bit.
+		constexpr double Sqrt(double x)
+		{
+			if (x <= 0.0)
+				return 0.0;
+
+			// Newton's steps fall towards the root from above.
+			double r = x > 1.0 ? x : 1.0;
+			for (int i = 0; i < 128; ++i)
+			{
+				double next = 0.5 * (r + x / r);
+				if (next >= r)
+					break;
+				r = next;
+			}
+			return r;
+		}
+
+		constexpr double Reduce(double x)
+		{
+			double turns = x / (2.0 * PiD);
+			long long k = (long long)(turns < 0.0 ? turns - 0.5 : turns + 0.5);
+			return x - k * 2.0 * PiD;
+		}
+
+		constexpr double Sin(double x)
+		{
+			x = Reduce(x);
+			double term = x;
+			double sum = x;
+			for (int n = 1; n < 30; ++n)
+			{
+				term *= -x * x / ((2 * n) * (2 * n + 1));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr double Cos(double x)
+		{
+			x = Reduce(x);
+			double term = 1.0;
+			double sum = 1.0;
+			for (int n = 1; n < 30; ++n)
+			{
+				term *= -x * x / ((2 * n - 1) * (2 * n));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr double Atan(double x)
+		{
+			if (x < 0.0)
+				return -Atan(-x);
+			if (x > 1.0)
+				return 0.5 * PiD - Atan(1.0 / x);
+
+			// Halve the angle twice, to under pi/16, for a short series.
+			x = x / (1.0 + Sqrt(1.0 + x * x));
+			x = x / (1.0 + Sqrt(1.0 + x * x));
+
+			double term = x;
+			double sum = x;
+			for (int n = 1; n < 20; ++n)
+			{
+				term *= -x * x;
+				sum += term / (2 * n + 1);
+			}
+			return 4.0 * sum;
+		}
+
+		constexpr double Atan2(double y, double x)
+		{
+			if (x > 0.0)
+				return Atan(y / x);
+			if (x < 0.0)
+				return y < 0.0 ? Atan(y / x) - PiD : Atan(y / x) + PiD;
+			return y > 0.0 ? 0.5 * PiD : y < 0.0 ? -0.5 * PiD : 0.0;
+		}
+
+		constexpr double Acos(double x)
+		{
+			return Atan2(Sqrt(1.0 - x * x), x);
+		}
+
+		constexpr float Sinf(float x)
+		{
+			return (float)Sin(x);
+		}
+
+		constexpr float Cosf(float x)
+		{
+			return (float)Cos(x);
+		}
+
+		// As XMVector3Normalize, which leaves a zero vector zero.
+		constexpr DirectX::XMFLOAT3 Normalize(DirectX::XMFLOAT3 v)
+		{
+			float length = (float)Sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+			if (length > 0.0f)
+			{
+				v.x = v.x / length;
+				v.y = v.y / length;
+				v.z = v.z / length;
+			}
+			return v;
+		}
+
+		constexpr void Set(BakedVertex& v, float px, float py, float pz, float nx, float ny, float nz,
+			float tx, float ty, float tz, float u, float w)
+		{
+			v.Position.x = px;
+			v.Position.y = py;
+			v.Position.z = pz;
+			v.Normal.x = nx;
+			v.Normal.y = ny;
+			v.Normal.z = nz;
+			v.TangentU.x = tx;
+			v.TangentU.y = ty;
+			v.TangentU.z = tz;
+			v.TexC.x = u;
+			v.TexC.y = w;
+		}
+
+		constexpr BakedVertex MidPoint(const BakedVertex& v0, const BakedVertex& v1)
+		{
+			BakedVertex v{};
+			v.Position.x = 0.5f * (v0.Position.x + v1.Position.x);
+			v.Position.y = 0.5f * (v0.Position.y + v1.Position.y);
+			v.Position.z = 0.5f * (v0.Position.z + v1.Position.z);
+			v.Normal.x = 0.5f * (v0.Normal.x + v1.Normal.x);
+			v.Normal.y = 0.5f * (v0.Normal.y + v1.Normal.y);
+			v.Normal.z = 0.5f * (v0.Normal.z + v1.Normal.z);
+			v.Normal = Normalize(v.Normal);
+			v.TangentU.x = 0.5f * (v0.TangentU.x + v1.TangentU.x);
+			v.TangentU.y = 0.5f * (v0.TangentU.y + v1.TangentU.y);
+			v.TangentU.z = 0.5f * (v0.TangentU.z + v1.TangentU.z);
+			v.TangentU = Normalize(v.TangentU);
+			v.TexC.x = 0.5f * (v0.TexC.x + v1.TexC.x);
+			v.TexC.y = 0.5f * (v0.TexC.y + v1.TexC.y);
+			return v;
+		}
+
+		constexpr std::uint32_t SubdividedVertexCount(std::uint32_t vertexCount, std::uint32_t indexCount, std::uint32_t levels)
+		{
+			return levels == 0 ? vertexCount : SubdividedVertexCount(2 * indexCount, 4 * indexCount, levels - 1);
+		}
+
+		constexpr std::uint32_t SubdividedIndexCount(std::uint32_t indexCount, std::uint32_t levels)
+		{
+			return levels == 0 ? indexCount : SubdividedIndexCount(4 * indexCount, levels - 1);
+		}
+
+		template<std::uint32_t VertexCountT, std::uint32_t IndexCountT, std::uint32_t Levels>
+		using SubdividedMesh = BakedMesh<SubdividedVertexCount(VertexCountT, IndexCountT, Levels), SubdividedIndexCount(IndexCountT, Levels)>;
+
+		// GeometryGenerator::Subdivide: six vertices and four triangles in
+		// place of each triangle, with no vertices shared.
+		template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+		constexpr BakedMesh<2 * IndexCountT, 4 * IndexCountT> Subdivide(const BakedMesh<VertexCountT, IndexCountT>& input)
+		{
+			BakedMesh<2 * IndexCountT, 4 * IndexCountT> mesh{};
+
+			for (std::uint32_t i = 0; i < IndexCountT / 3; ++i)
+			{
+				const BakedVertex& v0 = input.Vertices[input.Indices[i * 3 + 0]];
+				const BakedVertex& v1 = input.Vertices[input.Indices[i * 3 + 1]];
+				const BakedVertex& v2 = input.Vertices[input.Indices[i * 3 + 2]];
+
+				mesh.Vertices[i * 6 + 0] = v0;
+				mesh.Vertices[i * 6 + 1] = v1;
+				mesh.Vertices[i * 6 + 2] = v2;
+				mesh.Vertices[i * 6 + 3] = MidPoint(v0, v1);
+				mesh.Vertices[i * 6 + 4] = MidPoint(v1, v2);
+				mesh.Vertices[i * 6 + 5] = MidPoint(v0, v2);
+
+				const std::uint32_t corners[12] = { 0, 3, 5, 3, 4, 5, 5, 4, 2, 3, 1, 4 };
+				for (std::uint32_t k = 0; k < 12; ++k)
+					mesh.Indices[i * 12 + k] = i * 6 + corners[k];
+			}
+
+			return mesh;
+		}
+
+		template<std::uint32_t Levels>
+		struct SubdivideLevels
+		{
+			template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+			static constexpr SubdividedMesh<VertexCountT, IndexCountT, Levels> Apply(const BakedMesh<VertexCountT, IndexCountT>& mesh)
+			{
+				return SubdivideLevels<Levels - 1>::Apply(Subdivide(mesh));
+			}
+		};
+
+		template<>
+		struct SubdivideLevels<0>
+		{
+			template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+			static constexpr BakedMesh<VertexCountT, IndexCountT> Apply(const BakedMesh<VertexCountT, IndexCountT>& mesh)
+			{
+				return mesh;
+			}
+		};
+
+		constexpr BakedMesh<24, 36> BaseBox(float width, float height, float depth)
+		{
+			BakedMesh<24, 36> mesh{};
+
+			float w2 = 0.5f * width;
+			float h2 = 0.5f * height;
+			float d2 = 0.5f * depth;
+
+			// Front, back, top, bottom, left and right, as in CreateBox.
+			Set(mesh.Vertices[0], -w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[1], -w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[2], +w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+			Set(mesh.Vertices[3], +w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+			Set(mesh.Vertices[4], -w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+			Set(mesh.Vertices[5], +w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[6], +w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[7], -w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+
+			Set(mesh.Vertices[8], -w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[9], -w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[10], +w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+			Set(mesh.Vertices[11], +w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+			Set(mesh.Vertices[12], -w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+			Set(mesh.Vertices[13], +w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[14], +w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[15], -w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+
+			Set(mesh.Vertices[16], -w2, -h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[17], -w2, +h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[18], -w2, +h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f);
+			Set(mesh.Vertices[19], -w2, -h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f);
+
+			Set(mesh.Vertices[20], +w2, -h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f);
+			Set(mesh.Vertices[21], +w2, +h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+			Set(mesh.Vertices[22], +w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
+			Set(mesh.Vertices[23], +w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+
+			// Two triangles per face, four vertices apart.
+			for (std::uint32_t face = 0; face < 6; ++face)
+			{
+				mesh.Indices[face * 6 + 0] = face * 4 + 0;
+				mesh.Indices[face * 6 + 1] = face * 4 + 1;
+				mesh.Indices[face * 6 + 2] = face * 4 + 2;
+				mesh.Indices[face * 6 + 3] = face * 4 + 0;
+				mesh.Indices[face * 6 + 4] = face * 4 + 2;
+				mesh.Indices[face * 6 + 5] = face * 4 + 3;
+			}
+
+			return mesh;
+		}
+
+		constexpr BakedMesh<12, 60> Icosahedron()
+		{
+			BakedMesh<12, 60> mesh{};
+
+			const float X = 0.525731f;
+			const float Z = 0.850651f;
+
+			const float positions[12][3] =
+			{
+				{ -X, 0.0f, Z }, { X, 0.0f, Z },
+				{ -X, 0.0f, -Z }, { X, 0.0f, -Z },
+				{ 0.0f, Z, X }, { 0.0f, Z, -X },
+				{ 0.0f, -Z, X }, { 0.0f, -Z, -X },
+				{ Z, X, 0.0f }, { -Z, X, 0.0f },
+				{ Z, -X, 0.0f }, { -Z, -X, 0.0f }
+			};
+
+			const std::uint32_t indices[60] =
+			{
+				1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+				1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+				3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+				10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+			};
+
+			for (std::uint32_t i = 0; i < 12; ++i)
+			{
+				mesh.Vertices[i].Position.x = positions[i][0];
+				mesh.Vertices[i].Position.y = positions[i][1];
+				mesh.Vertices[i].Position.z = positions[i][2];
+			}
+
+			for (std::uint32_t i = 0; i < 60; ++i)
+				mesh.Indices[i] = indices[i];
+
+			return mesh;
+		}
+
+		// The last step of CreateGeosphere: every attribute from the
+		// direction of the position.
+		template<std::uint32_t VertexCountT, std::uint32_t IndexCountT>
+		constexpr BakedMesh<VertexCountT, IndexCountT> ProjectToSphere(BakedMesh<VertexCountT, IndexCountT> mesh, float radius)
+		{
+			for (std::uint32_t i = 0; i < VertexCountT; ++i)
+			{
+				BakedVertex& v = mesh.Vertices[i];
+
+				DirectX::XMFLOAT3 n = Normalize(v.Position);
+				v.Position.x = radius * n.x;
+				v.Position.y = radius * n.y;
+				v.Position.z = radius * n.z;
+				v.Normal = n;
+
+				float theta = (float)Atan2(v.Position.z, v.Position.x);
+				if (theta < 0.0f)
+					theta += TwoPi;
+
+				float phi = (float)Acos(v.Position.y / radius);
+
+				v.TexC.x = theta / TwoPi;
+				v.TexC.y = phi / Pi;
+
+				v.TangentU.x = -radius * Sinf(phi) * Sinf(theta);
+				v.TangentU.y = 0.0f;
+				v.TangentU.z = +radius * Sinf(phi) * Cosf(theta);
+				v.TangentU = Normalize(v.TangentU);
+			}
+
+			return mesh;
+		}
+	}
+
+	template<std::uint32_t Subdivisions>
+	using BoxMesh = Detail::SubdividedMesh<24, 36, Subdivisions>;
+
+	template<std::uint32_t SliceCount, std::uint32_t StackCount>
+	using UVSphereMesh = BakedMesh<2 + (StackCount - 1) * (SliceCount + 1), 6 * SliceCount * (StackCount - 1)>;
+
+	template<std::uint32_t Subdivisions>
+	using GeosphereMesh = Detail::SubdividedMesh<12, 60, Subdivisions>;
+
+	// GeometryGenerator::CreateBox.
+	template<std::uint32_t Subdivisions>
+	constexpr BoxMesh<Subdivisions> Box(float width, float height, float depth)
+	{
+		static_assert(Subdivisions <= 6, "CreateBox caps the subdivisions at 6");
+		return Detail::SubdivideLevels<Subdivisions>::Apply(Detail::BaseBox(width, height, depth));
+	}
+
+	// GeometryGenerator::CreateSphere.
+	template<std::uint32_t SliceCount, std::uint32_t StackCount>
+	constexpr UVSphereMesh<SliceCount, StackCount> UVSphere(float radius)
+	{
+		static_assert(SliceCount >= 3 && StackCount >= 2, "a sphere needs three slices and two stacks");
+
+		UVSphereMesh<SliceCount, StackCount> mesh{};
+
+		const float phiStep = Detail::Pi / StackCount;
+		const float thetaStep = 2.0f * Detail::Pi / SliceCount;
+
+		// The ring's sines and cosines once rather than per vertex.
+		float sinTheta[SliceCount + 1] = {};
+		float cosTheta[SliceCount + 1] = {};
+		for (std::uint32_t j = 0; j <= SliceCount; ++j)
+		{
+			sinTheta[j] = Detail::Sinf(j * thetaStep);
+			cosTheta[j] = Detail::Cosf(j * thetaStep);
+		}
+
+		Detail::Set(mesh.Vertices[0], 0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+		std::uint32_t n = 1;
+		for (std::uint32_t i = 1; i <= StackCount - 1; ++i)
+		{
+			float phi = i * phiStep;
+			float sinPhi = Detail::Sinf(phi);
+			float cosPhi = Detail::Cosf(phi);
+
+			for (std::uint32_t j = 0; j <= SliceCount; ++j)
+			{
+				float theta = j * thetaStep;
+				Detail::Set(mesh.Vertices[n++],
+					radius * sinPhi * cosTheta[j], radius * cosPhi, radius * sinPhi * sinTheta[j],
+					sinPhi * cosTheta[j], cosPhi, sinPhi * sinTheta[j],
+					-sinTheta[j], 0.0f, +cosTheta[j],
+					theta / Detail::TwoPi, phi / Detail::Pi);
+			}
+		}
+
+		Detail::Set(mesh.Vertices[n], 0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+		std::uint32_t k = 0;
+		for (std::uint32_t i = 1; i <= SliceCount; ++i)
+		{
+			mesh.Indices[k++] = 0;
+			mesh.Indices[k++] = i + 1;
+			mesh.Indices[k++] = i;
+		}
+
+		const std::uint32_t ringVertexCount = SliceCount + 1;
+		for (std::uint32_t i = 0; i < StackCount - 2; ++i)
+		{
+			for (std::uint32_t j = 0; j < SliceCount; ++j)
+			{
+				mesh.Indices[k++] = 1 + i * ringVertexCount + j;
+				mesh.Indices[k++] = 1 + i * ringVertexCount + j + 1;
+				mesh.Indices[k++] = 1 + (i + 1) * ringVertexCount + j;
+
+				mesh.Indices[k++] = 1 + (i + 1) * ringVertexCount + j;
+				mesh.Indices[k++] = 1 + i * ringVertexCount + j + 1;
+				mesh.Indices[k++] = 1 + (i + 1) * ringVertexCount + j + 1;
+			}
+		}
+
+		const std::uint32_t southPoleIndex = n;
+		const std::uint32_t baseIndex = southPoleIndex - ringVertexCount;
+		for (std::uint32_t i = 0; i < SliceCount; ++i)
+		{
+			mesh.Indices[k++] = southPoleIndex;
+			mesh.Indices[k++] = baseIndex + i;
+			mesh.Indices[k++] = baseIndex + i + 1;
+		}
+
+		return mesh;
+	}
+
+	// GeometryGenerator::CreateGeosphere.
+	template<std::uint32_t Subdivisions>
+	constexpr GeosphereMesh<Subdivisions> Geosphere(float radius)
+	{
+		static_assert(Subdivisions <= 6, "CreateGeosphere caps the subdivisions at 6");
+		return Detail::ProjectToSphere(Detail::SubdivideLevels<Subdivisions>::Apply(Detail::Icosahedron()), radius);
+	}
+
+	// GeometryGenerator::CreateQuad.
+	constexpr BakedMesh<4, 6> Quad(float x, float y, float w, float h, float depth)
+	{
+		BakedMesh<4, 6> mesh{};
+
+		Detail::Set(mesh.Vertices[0], x, y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+		Detail::Set(mesh.Vertices[1], x, y, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		Detail::Set(mesh.Vertices[2], x + w, y, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+		Detail::Set(mesh.Vertices[3], x + w, y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+		const std::uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+		for (std::uint32_t i = 0; i < 6; ++i)
+			mesh.Indices[i] = indices[i];
+
+		return mesh;
+	}
+}
+
+#endif // GEOMETRYTABLES_H
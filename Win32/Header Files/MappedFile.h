@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <string>
+
+// A read-only view of a whole file.  Pages are read in by the OS when they
+// are first touched, so opening is cheap however large the file is and
+// only the parts that are used cost memory.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& filename);
+	void Close();
+
+	const std::uint8_t* Data()const;
+	size_t Size()const;
+
+private:
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#else
+	int mFile;
+#endif
+	const std::uint8_t* mData;
+	size_t mSize;
+};
+
+#endif // MAPPEDFILE_H
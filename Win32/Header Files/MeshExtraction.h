@@ -0,0 +1,47 @@
+#ifndef MESHEXTRACTION_H
+#define MESHEXTRACTION_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// The loops that copy a mesh's control points and polygons out of an FBX
+// scene.  They take any type with FbxMesh's accessors, so they can be
+// measured on synthetic meshes where the FBX SDK is not available.
+
+// Appends the mesh's control points, as floats, to positions.
+template<class Mesh>
+void ExtractControlPoints(const Mesh& mesh, std::vector<DirectX::XMFLOAT3>& positions)
+{
+	int count = mesh.GetControlPointsCount();
+	const auto* points = mesh.GetControlPoints();
+
+	positions.reserve(positions.size() + count);
+
+	for (int i = 0; i < count; i++)
+	{
+		const auto& point = points[i];
+		positions.push_back(DirectX::XMFLOAT3(static_cast<float>(point[0]), static_cast<float>(point[1]),
+			static_cast<float>(point[2])));
+	}
+}
+
+// Appends the control point of every polygon corner to indices.  The mesh
+// is triangulated first, so there are three per polygon.
+template<class Mesh>
+void ExtractPolygons(const Mesh& mesh, std::vector<std::uint32_t>& indices)
+{
+	int polygonCount = mesh.GetPolygonCount();
+
+	indices.reserve(indices.size() + 3 * polygonCount);
+
+	for (int i = 0; i < polygonCount; i++)
+	{
+		int polygonSize = mesh.GetPolygonSize(i);
+
+		for (int j = 0; j < polygonSize; j++)
+			indices.push_back(mesh.GetPolygonVertex(i, j));
+	}
+}
+
+#endif // MESHEXTRACTION_H
@@ -0,0 +1,75 @@
+#ifndef MORPHTARGETS_H
+#define MORPHTARGETS_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One blend shape, holding only the vertices it moves.  Deltas are
+// quantized to 16 bits per component over the target's own range.
+struct MorphTarget
+{
+	std::string Name;
+
+	DirectX::XMFLOAT4A DeltaMin;
+	DirectX::XMFLOAT4A DeltaScale;
+
+	// Ascending vertex indices and three quantized components per vertex.
+	std::vector<std::uint32_t> Vertices;
+	std::vector<std::uint16_t> Deltas;
+
+	size_t SizeInBytes()const;
+};
+
+// Target weights baked at a fixed rate, one row of TargetCount per frame.
+struct MorphWeightTrack
+{
+	float Duration;
+	float SampleRate;
+	std::uint32_t FrameCount;
+	std::uint32_t TargetCount;
+	std::vector<float> Weights;
+
+	void Sample(float time, bool loop, float* weights)const;
+};
+
+class MorphTargetSet
+{
+public:
+	void Clear();
+
+	// Keep the vertices whose delta is longer than threshold.  Delta i
+	// belongs to vertex firstVertex + i.
+	std::uint32_t AddTarget(const std::string& name, std::uint32_t firstVertex,
+		const DirectX::XMFLOAT3* deltas, std::uint32_t count, float threshold);
+
+	std::uint32_t TargetCount()const;
+	const MorphTarget& Target(std::uint32_t index)const;
+	size_t SizeInBytes()const;
+
+	// out = base + the sum of weights[t] * delta of target t, for count
+	// vertices.  Zero-weight targets are skipped.  Work is split over
+	// vertex ranges on the thread pool; within a range every active target
+	// is applied while the range is still in cache.
+	void Apply(const DirectX::XMFLOAT3* base, std::uint32_t count, const float* weights,
+		DirectX::XMFLOAT3* out, std::uint32_t outStride);
+
+private:
+	struct ActiveTarget
+	{
+		const MorphTarget* Target;
+
+		// Weight folded into the dequantization constants.
+		DirectX::XMFLOAT4A WeightedMin;
+		DirectX::XMFLOAT4A WeightedScale;
+	};
+
+	// Vertices per task.
+	static const std::uint32_t GrainSize = 2048;
+
+	std::vector<MorphTarget> mTargets;
+	std::vector<ActiveTarget> mActive;
+};
+
+#endif // MORPHTARGETS_H
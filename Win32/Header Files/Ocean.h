@@ -0,0 +1,76 @@
+#ifndef OCEAN_H
+#define OCEAN_H
+
+#include "Fft.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// A patch of deep water after Tessendorf, "Simulating Ocean Water" (2001).
+//
+// Waves of a Phillips spectrum are given random amplitudes and phases
+// once, then advanced in time by the deep water dispersion relation and
+// brought back to heights, horizontal displacements and slopes by inverse
+// FFTs on each update.  The five fields are real, so each spectrum has
+// conjugate symmetry and two of them share an FFT, one as the real part
+// and one as the imaginary part; three FFTs do them all.
+//
+// The patch tiles, repeating every Length() metres along x and z, and
+// sample (x, z) lies at (x, z) * Length() / Size(), x fastest.  The fields
+// are evaluated four samples at a time and split across the thread pool.
+// Create allocates everything, so updates allocate nothing.
+class Ocean
+{
+public:
+	// size is a power of two of at least 4, and length the patch's width
+	// in metres.  windSpeed is in metres per second along windDirection.
+	// amplitude is Phillips' constant; the spectrum is taken per unit area
+	// of wave vectors, so the waves are about the same whatever the size
+	// and come to a root mean square height near
+	// windSpeed^2 / g * sqrt(pi * amplitude).  choppiness scales the
+	// horizontal displacement that sharpens the crests, 0 for none.  The
+	// same seed gives the same waves.
+	void Create(std::uint32_t size, float length, float windSpeed, DirectX::XMFLOAT2 windDirection, float amplitude,
+		float choppiness, std::uint32_t seed);
+
+	// The fields time seconds in.  The waves repeat exactly every few
+	// minutes, so time can grow without losing precision.
+	void Update(double time);
+
+	std::uint32_t Size()const;
+	float Length()const;
+
+	// Size() * Size() samples each, in metres.
+	const float* Heights()const;
+	const float* DisplacementsX()const;
+	const float* DisplacementsZ()const;
+
+	// Unit normals of the undisplaced heights.
+	const std::vector<DirectX::XMFLOAT3>& Normals()const;
+
+private:
+	std::uint32_t mSize = 0;
+	float mLength = 0.0f;
+	float mChoppiness = 0.0f;
+	Fft mFft;
+
+	// The wave number along an axis at each index.
+	std::vector<float> mWaveNumbers;
+
+	// The spectrum at time zero, h0(k), and the conjugate of h0(-k), with
+	// each wave's angular frequency.
+	std::vector<float> mSpectrumReal;
+	std::vector<float> mSpectrumImag;
+	std::vector<float> mMirrorReal;
+	std::vector<float> mMirrorImag;
+	std::vector<float> mFrequencies;
+
+	// Height and slope along x, displacement along x and z, and slope
+	// along z, as the real and imaginary parts of three transforms.
+	std::vector<float> mFieldReal[3];
+	std::vector<float> mFieldImag[3];
+
+	std::vector<DirectX::XMFLOAT3> mNormals;
+};
+
+#endif // OCEAN_H
@@ -0,0 +1,121 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// A source of particles, fixed in place.
+struct ParticleEmitter
+{
+	DirectX::XMFLOAT3 Position;
+
+	// Particles per second; fractions carry over to the next update.
+	float Rate;
+
+	// Each particle's velocity is this plus a random one of up to Spread.
+	DirectX::XMFLOAT3 Velocity;
+	float Spread;
+
+	// Particles live between half of Lifetime and all of it, shrinking
+	// from Size, a billboard's half-width, to nothing.
+	float Lifetime;
+	float Size;
+
+	DirectX::XMFLOAT4 Color;
+};
+
+// The live particles, a component per array, so passes over them read
+// only what they use.  The arrays are padded to a multiple of four.
+struct ParticleArrays
+{
+	std::vector<float> PositionX;
+	std::vector<float> PositionY;
+	std::vector<float> PositionZ;
+	std::vector<float> VelocityX;
+	std::vector<float> VelocityY;
+	std::vector<float> VelocityZ;
+	std::vector<float> Age;
+	std::vector<float> Lifetime;
+	std::vector<std::uint16_t> Emitter;
+
+	void Resize(std::uint32_t count);
+};
+
+// Particles falling under gravity from emitters, in a pool of fixed
+// capacity.
+//
+// Update moves the particles four at a time, in ranges across the thread
+// pool, and marks those past their lifetime.  The dead below the new count
+// are then filled with the live ones above it, found and moved in
+// parallel, so the pool stays packed without ever reallocating, at the
+// cost of the particles' order.  New particles go on the end, spread over
+// the thread pool too; each draws its randomness from a hash of its serial
+// number, so the particles do not depend on the thread count.
+class ParticleSystem
+{
+public:
+	void Create(std::uint32_t capacity, DirectX::XMFLOAT3 gravity, std::uint32_t seed);
+
+	// Up to 65536 emitters.
+	std::uint32_t AddEmitter(const ParticleEmitter& emitter);
+	ParticleEmitter& Emitter(std::uint32_t emitter);
+
+	// Ages and moves the particles by dt seconds, then emits new ones,
+	// as many as fit.
+	void Update(float dt);
+
+	std::uint32_t Count()const;
+	std::uint32_t Capacity()const;
+	const ParticleArrays& Particles()const;
+
+	// Four corners for each of the particles [first, first + count), facing
+	// along right and up, clockwise from the bottom left and split across
+	// the thread pool.  positions, colors and texCoords are written with a
+	// stride of vertexStride bytes, so straight into interleaved vertices;
+	// every corner gets texC.  Indices 0 1 2 0 2 3 per quad draw them.
+	void WriteBillboards(DirectX::FXMVECTOR right, DirectX::FXMVECTOR up, DirectX::XMFLOAT2 texC, std::uint32_t first,
+		std::uint32_t count, DirectX::XMFLOAT3* positions, DirectX::XMFLOAT4* colors, DirectX::XMFLOAT2* texCoords,
+		std::uint32_t vertexStride)const;
+
+private:
+	void Integrate(float dt);
+	void Compact();
+	void Emit(float dt);
+
+	// Copies particle from into to.
+	void Move(std::uint32_t from, std::uint32_t to);
+
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mCount = 0;
+	DirectX::XMFLOAT3 mGravity = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	std::uint32_t mSeed = 0;
+
+	// Particles emitted so far, which numbers the next one.
+	std::uint64_t mEmitted = 0;
+
+	std::vector<ParticleEmitter> mEmitters;
+	std::vector<float> mEmitterCarry;
+
+	// The first particle each emitter fills this update, and one past the
+	// last emitter's.
+	std::vector<std::uint32_t> mEmitterFirst;
+
+	ParticleArrays mParticles;
+
+	// All ones for each particle still alive after Integrate.
+	std::vector<std::uint32_t> mAlive;
+
+	// Per range of particles, its live count, and where its holes and
+	// movers start in mHoles and mMovers.
+	std::vector<std::uint32_t> mRangeAlive;
+	std::vector<std::uint32_t> mRangeHoles;
+	std::vector<std::uint32_t> mRangeMovers;
+
+	// Dead particles below the live count, and live ones above it, paired
+	// up in order.
+	std::vector<std::uint32_t> mHoles;
+	std::vector<std::uint32_t> mMovers;
+};
+
+#endif // PARTICLESYSTEM_H
@@ -0,0 +1,89 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Hierarchical CPU timing scopes.
+//
+//   void Foo()
+//   {
+//       PROFILE_FUNCTION();
+//       ...
+//       {
+//           PROFILE_SCOPE("Foo inner loop");
+//           ...
+//       }
+//   }
+//
+// Each thread records completed scopes into its own fixed-size ring, so
+// recording takes no locks and never allocates.  Profiler::WriteChromeTrace
+// exports whatever the rings hold as Chrome trace event JSON, which
+// chrome://tracing and ui.perfetto.dev open directly.
+//
+// Scopes only exist when ENABLE_PROFILER is defined.  Otherwise the macros
+// expand to nothing and none of the code below is compiled.
+
+#ifdef ENABLE_PROFILER
+
+#include <cstdint>
+
+class Profiler
+{
+public:
+	// Completed scopes kept per thread; older ones are overwritten.
+	static const std::uint32_t EventsPerThread = 1 << 16;
+
+	// Name shown for the calling thread in the trace viewer.
+	static void SetThreadName(const char* name);
+
+	// Export the recorded scopes of every thread.  Safe to call while other
+	// threads keep recording; scopes recorded during the export may be
+	// missed, and those overwritten during it are left out.
+	static bool WriteChromeTrace(const char* path);
+
+	// Raw timestamp in profiler ticks (rdtsc where available).
+	static std::uint64_t Now();
+
+	static void Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth);
+	static std::uint32_t& Depth();
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: mName(name), mDepth(Profiler::Depth()++), mStart(Profiler::Now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		std::uint64_t end = Profiler::Now();
+		Profiler::Depth()--;
+		Profiler::Record(mName, mStart, end, mDepth);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* mName;
+	std::uint32_t mDepth;
+	std::uint64_t mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// name must be a string literal or otherwise outlive the profiler.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
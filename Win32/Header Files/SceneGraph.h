@@ -0,0 +1,67 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Transform hierarchy stored as parallel arrays indexed by node id.
+//
+// A node's parent must already exist when the node is added, so ids are
+// sorted parent-before-child and a single forward pass sees every parent
+// ahead of its children.  SetLocal only marks a node dirty; Update then
+// recomputes the world matrices of dirty nodes and their descendants and
+// leaves clean subtrees alone.  Dirty nodes are grouped by depth and each
+// depth is spread over the thread pool, since nodes at the same depth never
+// depend on each other.
+class SceneGraph
+{
+public:
+	typedef std::uint32_t NodeId;
+
+	static const NodeId InvalidNode = 0xffffffff;
+
+	SceneGraph();
+
+	void Reserve(std::uint32_t nodeCount);
+	void Clear();
+
+	// parent is InvalidNode for a root.
+	NodeId AddNode(NodeId parent, DirectX::FXMMATRIX local);
+
+	void SetLocal(NodeId node, DirectX::FXMMATRIX local);
+
+	DirectX::XMMATRIX GetLocal(NodeId node)const;
+
+	// Valid as of the last Update.
+	DirectX::XMMATRIX GetWorld(NodeId node)const;
+
+	NodeId GetParent(NodeId node)const;
+	std::uint32_t NodeCount()const;
+
+	void Update();
+
+private:
+	void UpdateWorld(NodeId node);
+
+private:
+	// Nodes per parallel task.  A multiply is cheap, so chunks are large.
+	static const std::uint32_t GrainSize = 512;
+
+	std::vector<NodeId> mParents;
+	std::vector<std::uint32_t> mDepths;
+	std::vector<DirectX::XMFLOAT4X4A> mLocals;
+	std::vector<DirectX::XMFLOAT4X4A> mWorlds;
+	std::vector<std::uint8_t> mDirty;
+
+	// Nodes marked by SetLocal/AddNode since the last Update.
+	std::uint32_t mMarkedCount;
+	std::uint32_t mMaxDepth;
+
+	// Scratch for Update, kept to avoid reallocating every frame.
+	std::vector<NodeId> mDirtyNodes;
+	std::vector<NodeId> mDirtyByDepth;
+	std::vector<std::uint32_t> mDepthStart;
+};
+
+#endif // SCENEGRAPH_H
@@ -0,0 +1,82 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread.  The window thread uses it to hand input and resize events to the
+// render thread without either side ever blocking on the other.
+//
+// Capacity must be a power of two.  Push fails instead of blocking when the
+// queue is full, so the producer decides whether to drop or retry.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+		"SpscQueue capacity must be a power of two.");
+
+public:
+	SpscQueue() : mHead(0), mTailCache(0), mTail(0), mHeadCache(0) { }
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Producer only.
+	bool Push(const T& item)
+	{
+		const size_t tail = mTail.load(std::memory_order_relaxed);
+
+		// Only reload the consumer's index when the cached one says we are full.
+		if (tail - mHeadCache == Capacity)
+		{
+			mHeadCache = mHead.load(std::memory_order_acquire);
+			if (tail - mHeadCache == Capacity)
+				return false;
+		}
+
+		mItems[tail & (Capacity - 1)] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer only.
+	bool Pop(T& item)
+	{
+		const size_t head = mHead.load(std::memory_order_relaxed);
+
+		// Only reload the producer's index when the cached one says we are empty.
+		if (head == mTailCache)
+		{
+			mTailCache = mTail.load(std::memory_order_acquire);
+			if (head == mTailCache)
+				return false;
+		}
+
+		item = mItems[head & (Capacity - 1)];
+		mHead.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Approximate when called concurrently with Push or Pop.
+	size_t Size()const
+	{
+		return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+	}
+
+private:
+	// The consumer and producer indices live on separate cache lines so the
+	// two threads do not false-share.  Each side also keeps a private copy of
+	// the other side's index and only touches the shared one when it must.
+	alignas(64) std::atomic<size_t> mHead;
+	size_t mTailCache;
+
+	alignas(64) std::atomic<size_t> mTail;
+	size_t mHeadCache;
+
+	alignas(64) T mItems[Capacity];
+};
+
+#endif // SPSCQUEUE_H
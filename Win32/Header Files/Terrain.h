@@ -0,0 +1,159 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "MappedFile.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A square of terrain to draw: a quadtree node, which is always the same
+// grid of quads, spaced 2^Level samples apart.
+struct TerrainPatch
+{
+	std::uint32_t Node;
+	std::uint32_t Level;
+
+	// Position among the nodes of its level.
+	std::uint32_t X;
+	std::uint32_t Z;
+
+	// Terrain::Edge bits of the sides whose neighbour is a level coarser.
+	std::uint32_t EdgeMask;
+};
+
+struct TerrainStats
+{
+	std::uint32_t Patches;
+	std::uint64_t Triangles;
+
+	// A uniform grid with the same error everywhere needs the finest step
+	// any patch used across the whole terrain.
+	std::uint64_t FlatTriangles;
+};
+
+// Heightmap terrain split into fixed-size chunks under a quadtree.  A node
+// at level L covers 2^L by 2^L chunks with the same number of vertices as
+// a chunk, so each chunk's LOD chain is the path up to the root.
+//
+// Cook writes every node's heights, point-sampled so coarse vertices land
+// on fine ones, to one tile file along with each node's bounds and the
+// largest height error of drawing it instead of the full heightmap.  The
+// file is mapped, so only the tiles of patches actually built are read.
+//
+// Select refines nodes until their error is small enough on screen, then
+// splits more until neighbours are at most one level apart.  A patch next
+// to a coarser one drops its odd edge vertices to match, so with one index
+// list per combination of stitched edges every patch shares the same 16.
+class Terrain
+{
+public:
+	// Sides of a patch, with north towards +z.
+	enum Edge
+	{
+		North = 1,
+		East = 2,
+		South = 4,
+		West = 8
+	};
+
+	static const std::uint32_t EdgePatterns = 16;
+
+	// heights is size by size samples, row r at z = r * spacing and column
+	// c at x = c * spacing.  size - 1 must be chunkQuads times a power of
+	// two, and patches must fit 16-bit indices.
+	static bool Cook(const float* heights, std::uint32_t size, std::uint32_t chunkQuads, float spacing, const std::string& filename);
+
+	bool Open(const std::string& filename);
+	void Close();
+
+	// viewProj takes terrain space to clip space and eye is the camera in
+	// terrain space.  pixelScale is the viewport's height in pixels over
+	// twice the tangent of half the vertical field of view, so an error e
+	// at distance d covers e * pixelScale / d pixels.
+	void Select(DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR eye, float pixelScale, float pixelError,
+		std::vector<TerrainPatch>& patches, TerrainStats& stats);
+
+	// VertexCount positions and normals, in the row order of
+	// GeometryGenerator::CreateGrid.
+	void BuildPatch(const TerrainPatch& patch, DirectX::XMFLOAT3* positions, DirectX::XMFLOAT3* normals)const;
+
+	// Shared by every patch with these Edge bits.
+	const std::vector<std::uint16_t>& Indices(std::uint32_t edgeMask)const;
+
+	std::uint32_t VertexCount()const;
+	std::uint32_t LevelCount()const;
+
+	// Width and depth in terrain units.
+	float Extent()const;
+
+private:
+	struct FileHeader
+	{
+		std::uint32_t Magic;
+		std::uint32_t Size;
+		std::uint32_t ChunkQuads;
+		std::uint32_t LevelCount;
+		float Spacing;
+
+		// Heights are stored as HeightBase + HeightScale * q.
+		float HeightBase;
+		float HeightScale;
+	};
+
+	struct NodeInfo
+	{
+		float Error;
+		std::uint16_t MinHeight;
+		std::uint16_t MaxHeight;
+	};
+
+	std::uint32_t NodeIndex(std::uint32_t level, std::uint32_t x, std::uint32_t z)const;
+	void SelectNode(std::uint32_t level, std::uint32_t x, std::uint32_t z, const DirectX::XMFLOAT4* planes,
+		DirectX::FXMVECTOR eye, float pixelScale, float pixelError);
+	void Split(std::uint32_t cellX, std::uint32_t cellZ, std::uint32_t level);
+
+	MappedFile mFile;
+	FileHeader mHeader;
+	const NodeInfo* mNodes = nullptr;
+	const std::uint16_t* mHeights = nullptr;
+	std::uint32_t mChunks = 0;
+	std::vector<std::uint32_t> mLevelOffsets;
+	std::vector<std::uint16_t> mIndices[EdgePatterns];
+
+	// Per chunk, the level of the selected node covering it and whether
+	// that node is in view.
+	std::vector<std::uint8_t> mCellLevels;
+	std::vector<std::uint8_t> mCellVisible;
+};
+
+// Keeps built patches in the slots of a fixed vertex pool until the slot
+// is needed for another, least recently used first.
+class TerrainPatchCache
+{
+public:
+	static const std::uint32_t InvalidSlot = 0xffffffff;
+
+	explicit TerrainPatchCache(std::uint32_t slotCount);
+
+	// Once per frame before Acquire; slots acquired in earlier frames can
+	// be taken again.
+	void BeginFrame();
+
+	// The node's slot, with fresh set if its vertices must be built there.
+	// InvalidSlot when every slot is already in use this frame.
+	std::uint32_t Acquire(std::uint32_t node, bool& fresh);
+
+	void Clear();
+
+private:
+	static const std::uint32_t NoNode = 0xffffffff;
+
+	std::vector<std::uint32_t> mSlotNodes;
+	std::vector<std::uint64_t> mSlotFrames;
+	std::unordered_map<std::uint32_t, std::uint32_t> mNodeSlots;
+	std::uint64_t mFrame = 0;
+};
+
+#endif // TERRAIN_H
@@ -0,0 +1,43 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGBA pixels, rows top to bottom.
+struct TextureImage
+{
+	std::uint32_t Width;
+	std::uint32_t Height;
+	std::vector<std::uint8_t> Pixels;
+};
+
+// Truecolor and grayscale TGA, raw or run-length encoded.  Color-mapped
+// and 16-bit files are rejected.
+class TgaLoader
+{
+public:
+	static bool Load(const std::string& filename, TextureImage& image);
+	static bool Decode(const std::uint8_t* data, size_t size, TextureImage& image);
+};
+
+// Builds a full mip chain down to 1x1.  Each level is filtered from the one
+// above in linear light, so an sRGB image does not darken as it shrinks;
+// alpha is always filtered as is.  Rows are spread over the thread pool.
+class MipGenerator
+{
+public:
+	enum Filter
+	{
+		Box,
+		Kaiser
+	};
+
+	// mips[0] is a copy of image.
+	static void Generate(const TextureImage& image, Filter filter, bool srgb, std::vector<TextureImage>& mips);
+
+	static std::uint32_t LevelCount(std::uint32_t width, std::uint32_t height);
+};
+
+#endif // TEXTURE_H
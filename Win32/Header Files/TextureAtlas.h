@@ -0,0 +1,60 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include "Texture.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// Where one image's texels sit in an atlas, not counting its gutter.
+struct AtlasRect
+{
+	std::uint32_t X;
+	std::uint32_t Y;
+	std::uint32_t Width;
+	std::uint32_t Height;
+};
+
+// Packs many small textures into one, so objects that used to bind their
+// own can share a bind and be drawn together.
+//
+// Every image gets a cell: its texels plus gutter texels all round that
+// repeat its edges, rounded up to a multiple of alignment and placed on
+// one.  With alignment 2^k a box-filtered chain never mixes two cells down
+// to level k, and bilinear taps at a region's edge stay in its own gutter
+// while the gutter is still a texel wide.  Alignment of 4 or more also
+// keeps block-compressed blocks from straddling two images.
+class TextureAtlas
+{
+public:
+	// Skyline bottom-left packing, tallest cells first.  Takes each
+	// rect's Width and Height and fills in X and Y; the atlas size is a
+	// multiple of alignment and about square.  Returns false if the cells
+	// do not fit in maxSize squared.
+	static bool Pack(std::vector<AtlasRect>& rects, std::uint32_t gutter, std::uint32_t alignment, std::uint32_t maxSize,
+		std::uint32_t& width, std::uint32_t& height);
+
+	// Copies images[i] to rects[i] and fills its cell by repeating edges.
+	// Space no cell covers is left transparent black.
+	static void Compose(const std::vector<TextureImage>& images, const std::vector<AtlasRect>& rects, std::uint32_t gutter,
+		std::uint32_t alignment, std::uint32_t width, std::uint32_t height, TextureImage& atlas);
+
+	// Moves UVs over the whole image onto its rect.  A UV outside [0, 1]
+	// would wrap into its neighbours, so if any is, none are changed and
+	// false is returned.
+	static bool RemapTexCoords(const AtlasRect& rect, std::uint32_t width, std::uint32_t height,
+		DirectX::XMFLOAT2* texCoords, std::uint32_t count, std::uint32_t stride);
+
+	// Whether a mesh's UVs can go in an atlas at all.
+	static bool InUnitSquare(const DirectX::XMFLOAT2* texCoords, std::uint32_t count, std::uint32_t stride);
+
+	// Identifies an atlas by its layout and the images' texels, so a cooked
+	// copy can be checked against what would be composed now.
+	static std::uint64_t Hash(const std::vector<TextureImage>& images, const std::vector<AtlasRect>& rects, std::uint32_t gutter,
+		std::uint32_t alignment, std::uint32_t width, std::uint32_t height);
+
+	// The share of the atlas the images themselves cover.
+	static float Efficiency(const std::vector<AtlasRect>& rects, std::uint32_t width, std::uint32_t height);
+};
+
+#endif // TEXTUREATLAS_H
@@ -0,0 +1,141 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include "DdsFile.h"
+#include "MappedFile.h"
+#include "SpscQueue.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The GPU side of texture streaming.  The app implements it over Direct3D;
+// pass a fake one to drive the streamer without a device.
+class StreamingDevice
+{
+public:
+	virtual ~StreamingDevice() { }
+
+	// A texture holding level firstLevel and every smaller level of the
+	// file in data.  Called on the streaming thread, which is where the
+	// mapped pages get read in.
+	virtual void* CreateTexture(const DdsLayout& layout, const std::uint8_t* data, std::uint32_t firstLevel) = 0;
+
+	// Called on the thread that calls Update.
+	virtual void ReleaseTexture(void* texture) = 0;
+};
+
+// Keeps the mips of cooked textures resident only down to the level their
+// objects need on screen, within a byte budget.  A texture's small tail is
+// uploaded when it is added and always stays, so nothing is drawn blank.
+//
+// Direct3D 11 cannot add or drop levels of an existing texture, so every
+// change builds a new one on the streaming thread; Update swaps it in and
+// releases the old one.  Files are mapped, so only the levels that are
+// actually uploaded are ever read from disk.
+class TextureStreamer
+{
+public:
+	typedef std::uint32_t TextureId;
+
+	static const TextureId InvalidTexture = 0xffffffff;
+
+	// Largest tail dimension kept resident.
+	static const std::uint32_t TailSize = 64;
+
+	// Frames a texture can go unrequested before it drops to its tail.
+	static const std::uint32_t EvictDelay = 60;
+
+	TextureStreamer(StreamingDevice& device, size_t budget);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Maps a DDS file and uploads its tail before returning.
+	TextureId Add(const std::string& filename);
+
+	// Called for each object drawn with the texture, with the object's
+	// size on screen in pixels.  The largest request of the frame counts.
+	void Request(TextureId id, float screenPixels);
+
+	// Once per frame: swaps in finished loads, picks the level every
+	// texture should have within the budget, and queues the changes.
+	// Changes that would grow past the budget wait until evictions land.
+	void Update();
+
+	// Waits until no load is in flight and applies the results.
+	void Flush();
+
+	void* Texture(TextureId id)const;
+	std::uint32_t ResidentLevel(TextureId id)const;
+	std::uint32_t TargetLevel(TextureId id)const;
+
+	size_t ResidentBytes()const;
+	size_t Budget()const;
+
+private:
+	struct StreamedTexture
+	{
+		MappedFile File;
+		DdsLayout Layout;
+
+		// Bytes of levels i and smaller; the last entry is zero.
+		std::vector<size_t> LevelBytes;
+
+		// Whether level i can be the top of a texture: block-compressed
+		// textures need whole blocks there.
+		std::vector<bool> Usable;
+
+		void* Resource;
+		std::uint32_t ResidentLevel;
+		std::uint32_t TailLevel;
+		std::uint32_t TargetLevel;
+		bool Pending;
+
+		float ScreenPixels;
+		float LastScreenPixels;
+		std::uint64_t LastRequestFrame;
+	};
+
+	struct Load
+	{
+		StreamedTexture* Texture;
+		std::uint32_t FirstLevel;
+		void* Resource;
+	};
+
+	// Loads queued or finished but not yet applied; no more than the
+	// result queue holds, so the streaming thread never waits on it.
+	static const std::uint32_t MaxLoads = 32;
+
+	void ApplyLoads();
+	std::uint32_t LevelForSize(const StreamedTexture& texture, float screenPixels)const;
+	void StreamingThreadMain();
+
+	StreamingDevice& mDevice;
+	size_t mBudget;
+	size_t mResidentBytes;
+	size_t mIncomingBytes;
+	std::uint64_t mFrame;
+	std::uint32_t mLoadsInFlight;
+
+	std::vector<std::unique_ptr<StreamedTexture>> mTextures;
+	std::vector<StreamedTexture*> mChanges;
+
+	// Update queues loads for the streaming thread and it queues them back
+	// finished; one producer and one consumer each way.
+	SpscQueue<Load, MaxLoads> mRequests;
+	SpscQueue<Load, MaxLoads> mResults;
+
+	std::mutex mWakeMutex;
+	std::condition_variable mWake;
+	bool mWakePending;
+	bool mStop;
+	std::thread mThread;
+};
+
+#endif // TEXTURESTREAMER_H
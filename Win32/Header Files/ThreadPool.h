@@ -0,0 +1,71 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data-parallel loops.
+//
+//   ThreadPool::Get().ParallelFor(count, 256, [&](std::uint32_t begin, std::uint32_t end)
+//   {
+//       for (std::uint32_t i = begin; i < end; ++i)
+//           ...
+//   });
+//
+// The calling thread works on the loop too and ParallelFor returns once
+// every chunk is done.  A ParallelFor issued from inside another one runs
+// serially on the calling thread, so nesting is allowed but not parallel.
+class ThreadPool
+{
+public:
+	// Shared pool with one worker per hardware thread, minus the caller's.
+	static ThreadPool& Get();
+
+	explicit ThreadPool(std::uint32_t workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Workers plus the calling thread.
+	std::uint32_t ThreadCount()const;
+
+	// Calls body(begin, end) over disjoint ranges covering [0, count).  Each
+	// range holds grainSize items except possibly the last.
+	void ParallelFor(std::uint32_t count, std::uint32_t grainSize,
+		const std::function<void(std::uint32_t, std::uint32_t)>& body);
+
+private:
+	struct Job
+	{
+		const std::function<void(std::uint32_t, std::uint32_t)>* Body;
+		std::uint32_t Count;
+		std::uint32_t GrainSize;
+		std::uint32_t ChunkCount;
+		std::atomic<std::uint32_t> NextChunk;
+	};
+
+	void WorkerMain();
+	static void RunChunks(Job& job);
+
+private:
+	std::vector<std::thread> mWorkers;
+
+	// Serializes ParallelFor calls made from different threads.
+	std::mutex mSubmitMutex;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkFinished;
+	Job* mJob;
+	std::uint64_t mGeneration;
+	std::uint32_t mActiveWorkers;
+	bool mStop;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,108 @@
+#ifndef VOXELOCTREE_H
+#define VOXELOCTREE_H
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+struct VoxelHit
+{
+	float Distance;
+
+	// The voxel hit.
+	std::uint32_t X;
+	std::uint32_t Y;
+	std::uint32_t Z;
+};
+
+// A triangle mesh voxelized into a sparse octree over a cube of
+// resolution^3 voxels around it.
+//
+// A voxel is set where a triangle overlaps it (Schwarz and Seidel 2010),
+// and optionally where its center is inside the mesh by the parity of
+// the crossings along x.  The grid is voxelized in chunks of 32^3, a
+// column of chunks per task on the thread pool, and each chunk is
+// collapsed as soon as it is done, so the whole grid never exists at once.
+//
+// Nodes keep two masks: children with anything set, and children that are
+// entirely set, which need nothing more.  The other children are stored
+// together, each level after the one above, so a child is found from its
+// parent's first child and a count of mask bits.  The last level is
+// bricks of 4^3 voxels as 64-bit masks.
+class VoxelOctree
+{
+public:
+	// resolution is rounded up to a power of two from 8 to 4096.  positions
+	// is read with a stride of positionStride bytes.  Filling the interior
+	// needs a closed mesh.  A build in the background passes a pool of its
+	// own, as AmbientOcclusionBaker::Trace does.
+	void Build(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, std::uint32_t resolution, bool solid);
+	void Build(const DirectX::XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+		std::uint32_t triangleCount, std::uint32_t resolution, bool solid, ThreadPool& pool);
+
+	void Clear();
+
+	bool Occupied(DirectX::FXMVECTOR point)const;
+	bool Occupied(std::uint32_t x, std::uint32_t y, std::uint32_t z)const;
+
+	// The first set voxel along direction from origin, no further than
+	// maxDistance in units of direction's length.  Empty space is skipped
+	// a whole empty node at a time.
+	bool RayMarch(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, VoxelHit& hit)const;
+
+	std::uint32_t Resolution()const;
+	float VoxelSize()const;
+
+	// The corner of voxel (0, 0, 0).
+	DirectX::XMFLOAT3 Origin()const;
+
+	std::uint64_t VoxelCount()const;
+	std::uint32_t NodeCount()const;
+	std::uint32_t BrickCount()const;
+	size_t SizeInBytes()const;
+
+private:
+	enum Kind
+	{
+		Empty,
+		Full,
+		Mixed
+	};
+
+	// Octant i is bit i, with x in bit 0, y in bit 1 and z in bit 2.
+	// FirstChild indexes the next level's nodes, or the bricks under a
+	// node of 8^3 voxels.
+	struct Node
+	{
+		std::uint32_t FirstChild;
+		std::uint8_t ChildMask;
+		std::uint8_t FullMask;
+	};
+
+	struct Chunk;
+	struct BuildContext;
+
+	static const std::uint32_t BrickSize = 4;
+	static const std::uint32_t ChunkSize = 32;
+
+	void VoxelizeColumn(BuildContext& context, std::uint32_t column)const;
+	static Kind Collapse(const std::uint32_t* rows, std::uint32_t size, std::uint32_t level,
+		std::uint32_t x, std::uint32_t y, std::uint32_t z, Chunk& chunk);
+	Kind Splice(BuildContext& context, std::uint32_t level, std::uint32_t x, std::uint32_t y, std::uint32_t z);
+
+	// 0 if the voxel is set, otherwise the size of the empty node around it.
+	std::uint32_t EmptySize(std::uint32_t x, std::uint32_t y, std::uint32_t z)const;
+
+	std::vector<Node> mNodes;
+	std::vector<std::uint64_t> mBricks;
+	Kind mRoot = Empty;
+	std::uint32_t mResolution = 0;
+	float mVoxelSize = 0.0f;
+	DirectX::XMFLOAT3 mOrigin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	std::uint64_t mVoxelCount = 0;
+};
+
+#endif // VOXELOCTREE_H
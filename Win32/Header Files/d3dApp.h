@@ -9,9 +9,16 @@
 #include <string>
 #include <fstream>
 #include <assert.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "Resource.h"
+#include "FramePacer.h"
+#include "FrameStats.h"
 #include "GameTimer.h"
+#include "Profiler.h"
 #include "GeometryGenerator.h"
+#include "AppEventQueue.h"
 
 class D3DApp
 {
@@ -22,6 +29,9 @@ public:
 	HINSTANCE AppInst()const;
 	HWND      MainWnd()const;
 	float     AspectRatio()const;
+
+	// Caps the frame rate and turns vsync off; 0 restores vsync.  Call before Run.
+	void SetTargetFrameRate(double fps);
 	
 	int Run();
  
@@ -38,6 +48,12 @@ public:
 	virtual void OnMouseDown(WPARAM btnState, int x, int y){ }
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
+	virtual void OnKeyDown(WPARAM key){ }
+
+	// Extra figures for the once-a-second caption, written to text.
+	// Returns the number of characters written, or -1 if they were cut
+	// short to fit capacity.
+	virtual int AppendCaptionStats(wchar_t* text, int capacity){ return 0; }
 
 protected:
 	bool InitWindow();
@@ -45,9 +61,19 @@ protected:
 
 	void CalculateFrameStats();
 
+	// Render thread.
+	void RenderThreadMain();
+	void ProcessEvents();
+	void StopRenderThread();
+
+	// Window thread.
+	void PostAppEvent(AppEvent::Type type, WPARAM param, int x, int y);
+
 protected:
 	HINSTANCE mhAppInst;
 	
+	// mAppPaused is owned by the render thread; the other flags are only
+	// touched by the window thread while handling WM_SIZE.
 	bool      mAppPaused;
 	bool      mMinimized;
 	bool      mMaximized;
@@ -55,6 +81,11 @@ protected:
 	UINT      m4xMsaaQuality;
 
 	GameTimer mTimer;
+	FramePacer mFramePacer;
+	FrameStats mFrameStats;
+
+	// Pass to Present.  0 while a target frame rate is set, 1 (vsync) otherwise.
+	UINT mSyncInterval;
 
 	ID3D11Device* md3dDevice;
 	ID3D11DeviceContext* md3dDeviceContext;
@@ -70,6 +101,31 @@ protected:
 	int mClientWidth;
 	int mClientHeight;
 	bool mEnable4xMsaa;
+
+private:
+	// The window thread only pumps messages; simulation and rendering run on
+	// mRenderThread and receive input through mEventQueue.
+	std::thread mRenderThread;
+	std::atomic<bool> mQuitRequested;
+	AppEventQueue mEventQueue;
+
+	// Caption text is produced on the render thread and applied on the
+	// window thread, so the render thread never waits on SendMessage.
+	static const int CaptionLength = 1024;
+	std::mutex mCaptionMutex;
+	wchar_t mPendingCaption[CaptionLength];
+
+	// Next caption update, in GameTimer ticks, and the frame count at the last one.
+	__int64 mNextStatsTicks;
+	std::uint64_t mStatsFrameMark;
+
+	// Input-to-present latency, measured from the arrival of the oldest input
+	// message consumed in a frame to the return of that frame's Present.
+	double  mMillisecondsPerCount;
+	__int64 mFrameInputTimestamp;
+	double  mInputLatencySum;
+	double  mInputLatencyMax;
+	int     mInputLatencyCount;
 };
 
 #endif // D3DAPP_H
@@ -1,10 +1,14 @@
+Texture2D gDiffuseMap : register(t0);
+SamplerState gSampler : register(s0);
+
 struct PixelIn
 {
 	float4 PosH  : SV_POSITION;
     float4 Color : COLOR;
+    float2 TexC  : TEXCOORD;
 };
 
 float4 PS(PixelIn pin) : SV_Target
 {
-    return pin.Color;
+    return pin.Color * gDiffuseMap.Sample(gSampler, pin.TexC);
 }
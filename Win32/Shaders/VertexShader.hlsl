@@ -7,12 +7,14 @@ struct VertexIn
 {
 	float3 PosL  : POSITION;
     float4 Color : COLOR;
+    float2 TexC  : TEXCOORD;
 };
 
 struct VertexOut
 {
 	float4 PosH  : SV_POSITION;
     float4 Color : COLOR;
+    float2 TexC  : TEXCOORD;
 };
 
 VertexOut VS(VertexIn vin)
@@ -24,6 +26,7 @@ VertexOut VS(VertexIn vin)
 	
 	// Just pass vertex color into the pixel shader.
     vout.Color = vin.Color;
+    vout.TexC = vin.TexC;
     
     return vout;
 }
@@ -0,0 +1,225 @@
+#include "AmbientOcclusion.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t FileMagic = 0x31424f41; // "AOB1"
+
+	// Bias off the surface, as a fraction of the radius, so a ray does not
+	// hit the triangles it starts on.
+	const float BiasScale = 1e-3f;
+
+	// The R2 sequence: the plastic number's powers give the most even
+	// 2D coverage of any prefix, which is what a progressive bake needs.
+	const double R2A1 = 0.7548776662466927;
+	const double R2A2 = 0.5698402909980532;
+
+	std::uint32_t Hash(std::uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+
+	float Fraction(double x)
+	{
+		return (float)(x - std::floor(x));
+	}
+
+	// An orthonormal basis around n with no branch on its direction
+	// (Duff et al. 2017).
+	void Basis(const XMFLOAT3& n, XMFLOAT3& t, XMFLOAT3& b)
+	{
+		float sign = std::copysign(1.0f, n.z);
+		float a = -1.0f / (sign + n.z);
+		float c = n.x * n.y * a;
+		t = XMFLOAT3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+		b = XMFLOAT3(c, sign + n.y * n.y * a, -n.y);
+	}
+}
+
+void AmbientOcclusionBaker::Begin(const XMFLOAT3* positions, std::uint32_t positionStride, std::uint32_t vertexCount,
+	const std::uint32_t* indices, std::uint32_t triangleCount, const Bvh& bvh, float radius, std::uint32_t seed)
+{
+	PROFILE_FUNCTION();
+
+	mBvh = &bvh;
+	mRadius = radius;
+	mBias = radius * BiasScale;
+	mSeed = seed;
+	mSampleCount = 0;
+	mRayCount = 0;
+
+	mPositions.resize(vertexCount);
+	XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+	XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+
+	for (std::uint32_t i = 0; i < vertexCount; ++i)
+	{
+		mPositions[i] = *(const XMFLOAT3*)((const std::uint8_t*)positions + (size_t)i * positionStride);
+		lo = XMVectorMin(lo, XMLoadFloat3(&mPositions[i]));
+		hi = XMVectorMax(hi, XMLoadFloat3(&mPositions[i]));
+	}
+
+	XMVECTOR center = XMVectorScale(XMVectorAdd(lo, hi), 0.5f);
+
+	// Face normals weighted by area, which the cross product's length
+	// already is.  Imported meshes wind either way, so the sign of the
+	// volume they enclose about their center decides which way is out.
+	std::vector<XMFLOAT3> sums(vertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	float volume = 0.0f;
+
+	for (std::uint32_t i = 0; i < triangleCount; ++i)
+	{
+		const std::uint32_t* triangle = indices + 3 * i;
+		XMVECTOR p0 = XMLoadFloat3(&mPositions[triangle[0]]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&mPositions[triangle[1]]), p0),
+			XMVectorSubtract(XMLoadFloat3(&mPositions[triangle[2]]), p0));
+
+		volume += XMVectorGetX(XMVector3Dot(XMVectorSubtract(p0, center), normal));
+
+		for (int v = 0; v < 3; ++v)
+			XMStoreFloat3(&sums[triangle[v]], XMVectorAdd(XMLoadFloat3(&sums[triangle[v]]), normal));
+	}
+
+	float outward = volume < 0.0f ? -1.0f : 1.0f;
+
+	mNormals.resize(vertexCount);
+	mShifts.resize(vertexCount);
+	mOpen.assign(vertexCount, 0.0f);
+
+	for (std::uint32_t i = 0; i < vertexCount; ++i)
+	{
+		XMStoreFloat3(&mNormals[i], XMVectorScale(XMVector3Normalize(XMLoadFloat3(&sums[i])), outward));
+
+		std::uint32_t h = Hash(seed ^ Hash(i));
+		mShifts[i] = XMFLOAT2((h & 0xffff) / 65536.0f, (h >> 16) / 65536.0f);
+	}
+}
+
+void AmbientOcclusionBaker::Trace(std::uint32_t samples)
+{
+	Trace(samples, ThreadPool::Get());
+}
+
+void AmbientOcclusionBaker::Trace(std::uint32_t samples, ThreadPool& pool)
+{
+	PROFILE_FUNCTION();
+
+	std::uint32_t firstSample = mSampleCount;
+	std::atomic<std::uint64_t> rays(0);
+
+	pool.ParallelFor((std::uint32_t)mPositions.size(), GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		std::uint64_t traced = 0;
+
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			const XMFLOAT3& n = mNormals[i];
+			XMVECTOR normal = XMLoadFloat3(&n);
+
+			// A vertex on no triangle, or only on degenerate ones, is open.
+			if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+			{
+				mOpen[i] += (float)samples;
+				continue;
+			}
+
+			XMFLOAT3 t, b;
+			Basis(n, t, b);
+			XMVECTOR tangent = XMLoadFloat3(&t);
+			XMVECTOR bitangent = XMLoadFloat3(&b);
+			XMVECTOR origin = XMVectorAdd(XMLoadFloat3(&mPositions[i]), XMVectorScale(normal, mBias));
+
+			float open = 0.0f;
+			for (std::uint32_t s = firstSample; s < firstSample + samples; ++s)
+			{
+				// Cosine-weighted: a uniform point on the disc, lifted onto
+				// the hemisphere.
+				float u1 = Fraction(mShifts[i].x + R2A1 * (s + 1));
+				float u2 = Fraction(mShifts[i].y + R2A2 * (s + 1));
+				float r = std::sqrt(u1);
+				float phi = 2.0f * XM_PI * u2;
+
+				XMVECTOR direction = XMVectorAdd(XMVectorAdd(XMVectorScale(tangent, r * std::cos(phi)),
+					XMVectorScale(bitangent, r * std::sin(phi))), XMVectorScale(normal, std::sqrt(1.0f - u1)));
+
+				if (!mBvh->Occluded(origin, direction, mRadius))
+					open += 1.0f;
+			}
+
+			mOpen[i] += open;
+			traced += samples;
+		}
+
+		rays += traced;
+	});
+
+	mSampleCount += samples;
+	mRayCount += rays;
+}
+
+void AmbientOcclusionBaker::Resolve(float* visibility)const
+{
+	float scale = mSampleCount > 0 ? 1.0f / mSampleCount : 0.0f;
+	for (size_t i = 0; i < mOpen.size(); ++i)
+		visibility[i] = mSampleCount > 0 ? mOpen[i] * scale : 1.0f;
+}
+
+std::uint32_t AmbientOcclusionBaker::SampleCount()const
+{
+	return mSampleCount;
+}
+
+std::uint64_t AmbientOcclusionBaker::RayCount()const
+{
+	return mRayCount;
+}
+
+bool AmbientOcclusionBaker::Save(const std::string& filename)const
+{
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs)
+		return false;
+
+	std::uint32_t header[4] = { FileMagic, (std::uint32_t)mOpen.size(), mSeed, mSampleCount };
+	ofs.write((const char*)header, sizeof(header));
+	ofs.write((const char*)&mRadius, sizeof(mRadius));
+	ofs.write((const char*)mOpen.data(), mOpen.size() * sizeof(float));
+
+	return (bool)ofs;
+}
+
+bool AmbientOcclusionBaker::Load(const std::string& filename)
+{
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs)
+		return false;
+
+	std::uint32_t header[4];
+	float radius;
+	ifs.read((char*)header, sizeof(header));
+	ifs.read((char*)&radius, sizeof(radius));
+
+	if (!ifs || header[0] != FileMagic || header[1] != mOpen.size() || header[2] != mSeed || radius != mRadius)
+		return false;
+
+	std::vector<float> open(mOpen.size());
+	ifs.read((char*)open.data(), open.size() * sizeof(float));
+	if (!ifs)
+		return false;
+
+	mOpen.swap(open);
+	mSampleCount = header[3];
+	return true;
+}
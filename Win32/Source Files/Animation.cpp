@@ -0,0 +1,229 @@
+#include "Animation.h"
+#include "AnimationCompression.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Vertices per skinning task.
+	const std::uint32_t SkinGrainSize = 1024;
+
+	void InterpolateBone(const BoneTransform& a, const BoneTransform& b, float t, BoneTransform& out)
+	{
+		XMVECTOR q0 = XMLoadFloat4A(&a.Rotation);
+		XMVECTOR q1 = XMLoadFloat4A(&b.Rotation);
+
+		// Take the short way round, then normalized lerp.  Keys are close
+		// together, so this is indistinguishable from slerp and much cheaper.
+		XMVECTOR dot = XMVector4Dot(q0, q1);
+		q1 = XMVectorSelect(q1, XMVectorNegate(q1), XMVectorLess(dot, XMVectorZero()));
+
+		XMStoreFloat4A(&out.Rotation, XMQuaternionNormalize(XMVectorLerp(q0, q1, t)));
+		XMStoreFloat4A(&out.Translation, XMVectorLerp(XMLoadFloat4A(&a.Translation), XMLoadFloat4A(&b.Translation), t));
+		XMStoreFloat4A(&out.Scale, XMVectorLerp(XMLoadFloat4A(&a.Scale), XMLoadFloat4A(&b.Scale), t));
+	}
+}
+
+Animator::Animator()
+	: mSkeleton(nullptr)
+{
+}
+
+void Animator::SetSkeleton(const Skeleton* skeleton)
+{
+	mSkeleton = skeleton;
+
+	std::uint32_t jointCount = skeleton->JointCount();
+
+	mPose = skeleton->BindPose;
+	mScratchPose.resize(jointCount);
+	mModelSpace.resize(jointCount);
+	mPalette.resize(jointCount);
+}
+
+void Animator::Sample(const AnimationClip& clip, float time, bool loop)
+{
+	SampleClip(clip, time, loop, mPose.data());
+}
+
+void Animator::Blend(const AnimationClip& clip, float time, bool loop, float weight)
+{
+	SampleClip(clip, time, loop, mScratchPose.data());
+	BlendPoses(mPose.data(), mScratchPose.data(), weight, (std::uint32_t)mPose.size(), mPose.data());
+}
+
+void Animator::Sample(const CompressedClip& clip, float time, bool loop)
+{
+	clip.Sample(time, loop, mPose.data());
+}
+
+void Animator::Blend(const CompressedClip& clip, float time, bool loop, float weight)
+{
+	clip.Sample(time, loop, mScratchPose.data());
+	BlendPoses(mPose.data(), mScratchPose.data(), weight, (std::uint32_t)mPose.size(), mPose.data());
+}
+
+void Animator::BuildPalette()
+{
+	BuildMatrixPalette(*mSkeleton, mPose.data(), mModelSpace.data(), mPalette.data());
+}
+
+const XMFLOAT4X4A* Animator::Palette()const
+{
+	return mPalette.data();
+}
+
+void Animator::Skin(const XMFLOAT3* bindPositions, const SkinInfluence* influences,
+	std::uint32_t count, XMFLOAT3* out, std::uint32_t outStride)const
+{
+	PROFILE_FUNCTION();
+
+	const XMFLOAT4X4A* palette = mPalette.data();
+
+	ThreadPool::Get().ParallelFor(count, SkinGrainSize, [=](std::uint32_t begin, std::uint32_t end)
+	{
+		SkinPositions(palette, bindPositions + begin, influences + begin, end - begin,
+			(XMFLOAT3*)((std::uint8_t*)out + (size_t)begin * outStride), outStride);
+	});
+}
+
+void Animator::SampleClip(const AnimationClip& clip, float time, bool loop, BoneTransform* pose)
+{
+	std::uint32_t jointCount = clip.JointCount;
+
+	if (clip.FrameCount == 0)
+		return;
+
+	if (loop && clip.Duration > 0.0f)
+	{
+		time = std::fmod(time, clip.Duration);
+		if (time < 0.0f)
+			time += clip.Duration;
+	}
+
+	float frame = time * clip.SampleRate;
+	if (frame < 0.0f)
+		frame = 0.0f;
+
+	std::uint32_t f0 = (std::uint32_t)frame;
+	if (f0 >= clip.FrameCount - 1)
+	{
+		// At or past the last key.
+		const BoneTransform* last = &clip.Keys[(size_t)(clip.FrameCount - 1) * jointCount];
+		for (std::uint32_t j = 0; j < jointCount; ++j)
+			pose[j] = last[j];
+		return;
+	}
+
+	float t = frame - (float)f0;
+
+	const BoneTransform* k0 = &clip.Keys[(size_t)f0 * jointCount];
+	const BoneTransform* k1 = k0 + jointCount;
+
+	for (std::uint32_t j = 0; j < jointCount; ++j)
+		InterpolateBone(k0[j], k1[j], t, pose[j]);
+}
+
+void Animator::BlendPoses(const BoneTransform* a, const BoneTransform* b, float weight,
+	std::uint32_t jointCount, BoneTransform* out)
+{
+	for (std::uint32_t j = 0; j < jointCount; ++j)
+		InterpolateBone(a[j], b[j], weight, out[j]);
+}
+
+void Animator::BuildMatrixPalette(const Skeleton& skeleton, const BoneTransform* pose,
+	XMFLOAT4X4A* modelSpace, XMFLOAT4X4A* palette)
+{
+	std::uint32_t jointCount = skeleton.JointCount();
+
+	// Parents come first, so each parent's model space matrix is ready when
+	// its children need it.
+	for (std::uint32_t j = 0; j < jointCount; ++j)
+	{
+		const BoneTransform& bone = pose[j];
+
+		XMMATRIX local = XMMatrixScalingFromVector(XMLoadFloat4A(&bone.Scale))
+			* XMMatrixRotationQuaternion(XMLoadFloat4A(&bone.Rotation))
+			* XMMatrixTranslationFromVector(XMLoadFloat4A(&bone.Translation));
+
+		std::int32_t parent = skeleton.Parents[j];
+		XMMATRIX model = parent < 0 ? local : local * XMLoadFloat4x4A(&modelSpace[parent]);
+
+		XMStoreFloat4x4A(&modelSpace[j], model);
+		XMStoreFloat4x4A(&palette[j], XMLoadFloat4x4A(&skeleton.InverseBindPose[j]) * model);
+	}
+}
+
+void Animator::SkinPositions(const XMFLOAT4X4A* palette, const XMFLOAT3* bindPositions,
+	const SkinInfluence* influences, std::uint32_t count, XMFLOAT3* out, std::uint32_t outStride)
+{
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		const SkinInfluence& influence = influences[i];
+		XMFLOAT3* dest = (XMFLOAT3*)((std::uint8_t*)out + (size_t)i * outStride);
+
+		if (influence.Weights[0] == 0.0f)
+		{
+			*dest = bindPositions[i];
+			continue;
+		}
+
+		XMVECTOR p = XMLoadFloat3(&bindPositions[i]);
+		XMVECTOR result = XMVectorScale(XMVector3Transform(p, XMLoadFloat4x4A(&palette[influence.Joints[0]])), influence.Weights[0]);
+
+		// Weights are sorted, so the first empty slot ends the list.
+		for (int k = 1; k < 4 && influence.Weights[k] != 0.0f; ++k)
+		{
+			XMVECTOR skinned = XMVector3Transform(p, XMLoadFloat4x4A(&palette[influence.Joints[k]]));
+			result = XMVectorMultiplyAdd(skinned, XMVectorReplicate(influence.Weights[k]), result);
+		}
+
+		XMStoreFloat3(dest, result);
+	}
+}
+
+void Animator::AddInfluence(SkinInfluence& influence, std::uint16_t joint, float weight)
+{
+	if (weight <= 0.0f)
+		return;
+
+	// A joint named twice (say, by two skins on one mesh) gets the sum.
+	int k = 3;
+	for (int i = 0; i < 4 && influence.Weights[i] > 0.0f; ++i)
+	{
+		if (influence.Joints[i] == joint)
+		{
+			weight += influence.Weights[i];
+			k = i;
+			break;
+		}
+	}
+
+	// Insertion into a list of four sorted heaviest first; the lightest
+	// falls off the end.
+	if (weight <= influence.Weights[k])
+		return;
+
+	while (k > 0 && influence.Weights[k - 1] < weight)
+	{
+		influence.Weights[k] = influence.Weights[k - 1];
+		influence.Joints[k] = influence.Joints[k - 1];
+		--k;
+	}
+
+	influence.Weights[k] = weight;
+	influence.Joints[k] = joint;
+}
+
+void Animator::NormalizeInfluence(SkinInfluence& influence)
+{
+	float sum = influence.Weights[0] + influence.Weights[1] + influence.Weights[2] + influence.Weights[3];
+	if (sum <= 0.0f)
+		return;
+
+	for (int k = 0; k < 4; ++k)
+		influence.Weights[k] /= sum;
+}
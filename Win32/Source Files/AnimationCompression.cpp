@@ -0,0 +1,363 @@
+#include "AnimationCompression.h"
+#include "Profiler.h"
+#include <DirectXPackedVector.h>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	std::uint32_t HighestBit(std::uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, mask);
+		return index;
+#else
+		return 31 - __builtin_clz(mask);
+#endif
+	}
+
+	std::uint32_t LowestBit(std::uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	std::uint32_t PopCount(std::uint32_t mask)
+	{
+		mask = mask - ((mask >> 1) & 0x55555555);
+		mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+		return (((mask + (mask >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+	}
+
+	const XMFLOAT4A& SourceKey(const AnimationClip& clip, std::uint32_t frame, std::uint32_t track)
+	{
+		const BoneTransform& bone = clip.Keys[(size_t)frame * clip.JointCount + track / 3];
+
+		switch (track % 3)
+		{
+		case 0: return bone.Rotation;
+		case 1: return bone.Translation;
+		default: return bone.Scale;
+		}
+	}
+
+	float Component(const XMFLOAT4A& v, std::uint32_t c)
+	{
+		return (&v.x)[c];
+	}
+}
+
+CompressedClip::CompressedClip()
+	: mDuration(0.0f),
+	mSampleRate(0.0f),
+	mFrameCount(0),
+	mJointCount(0)
+{
+}
+
+size_t CompressedClip::SizeInBytes()const
+{
+	return mTrackMin.size() * sizeof(XMFLOAT4A)
+		+ mTrackScale.size() * sizeof(XMFLOAT4A)
+		+ mTrackAnimated.size() * sizeof(std::uint8_t)
+		+ mBlockOffsets.size() * sizeof(std::uint32_t)
+		+ mBlockData.size() * sizeof(std::uint16_t);
+}
+
+CompressionStats CompressedClip::Compress(const AnimationClip& clip, const CompressionSettings& settings)
+{
+	PROFILE_FUNCTION();
+
+	mName = clip.Name;
+	mDuration = clip.Duration;
+	mSampleRate = clip.SampleRate;
+	mFrameCount = clip.FrameCount;
+	mJointCount = clip.JointCount;
+
+	std::uint32_t trackCount = mJointCount * ChannelCount;
+	std::uint32_t blockCount = mFrameCount > 1 ? (mFrameCount - 2) / BlockFrames + 1 : 0;
+
+	mTrackMin.assign(trackCount, XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f));
+	mTrackScale.assign(trackCount, XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f));
+	mTrackAnimated.assign(trackCount, 0);
+	mBlockOffsets.assign(blockCount, 0);
+	mBlockData.clear();
+
+	CompressionStats stats = { };
+	stats.RawBytes = clip.Keys.size() * sizeof(BoneTransform);
+
+	if (mFrameCount == 0)
+		return stats;
+
+	// Quantized keys and kept-key masks of every animated track, laid out
+	// track by track until the blocks are assembled.
+	std::vector<std::vector<std::uint16_t>> quantized(trackCount);
+	std::vector<std::uint32_t> masks((size_t)trackCount * blockCount, 0);
+
+	std::vector<XMFLOAT4A> values(mFrameCount);
+	std::vector<XMFLOAT4A> decoded(mFrameCount);
+
+	for (std::uint32_t track = 0; track < trackCount; ++track)
+	{
+		std::uint32_t components = ComponentCount(track);
+		float tolerance = track % ChannelCount == Rotation ? settings.RotationTolerance
+			: track % ChannelCount == Translation ? settings.TranslationTolerance : settings.ScaleTolerance;
+
+		for (std::uint32_t f = 0; f < mFrameCount; ++f)
+			values[f] = SourceKey(clip, f, track);
+
+		// q and -q are the same rotation.  Keep neighbouring keys in the same
+		// hemisphere so that interpolating between any two of them is valid.
+		if (track % ChannelCount == Rotation)
+		{
+			for (std::uint32_t f = 1; f < mFrameCount; ++f)
+			{
+				XMVECTOR q = XMLoadFloat4A(&values[f]);
+				if (XMVectorGetX(XMVector4Dot(XMLoadFloat4A(&values[f - 1]), q)) < 0.0f)
+					XMStoreFloat4A(&values[f], XMVectorNegate(q));
+			}
+		}
+
+		float lo[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float hi[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		bool constant = true;
+
+		for (std::uint32_t c = 0; c < components; ++c)
+		{
+			lo[c] = hi[c] = Component(values[0], c);
+			for (std::uint32_t f = 1; f < mFrameCount; ++f)
+			{
+				float v = Component(values[f], c);
+				lo[c] = v < lo[c] ? v : lo[c];
+				hi[c] = v > hi[c] ? v : hi[c];
+			}
+
+			if (hi[c] - lo[c] > tolerance)
+				constant = false;
+		}
+
+		if (constant || blockCount == 0)
+		{
+			// The midpoint is within half the tolerance of every key.
+			XMVECTOR mid = XMVectorSet(0.5f * (lo[0] + hi[0]), 0.5f * (lo[1] + hi[1]), 0.5f * (lo[2] + hi[2]), 0.5f * (lo[3] + hi[3]));
+			if (track % ChannelCount == Rotation)
+				mid = XMQuaternionNormalize(mid);
+
+			XMStoreFloat4A(&mTrackMin[track], mid);
+			continue;
+		}
+
+		mTrackAnimated[track] = 1;
+
+		float scale[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (std::uint32_t c = 0; c < components; ++c)
+			scale[c] = (hi[c] - lo[c]) / 65535.0f;
+
+		mTrackMin[track] = XMFLOAT4A(lo[0], lo[1], lo[2], lo[3]);
+		mTrackScale[track] = XMFLOAT4A(scale[0], scale[1], scale[2], scale[3]);
+
+		std::vector<std::uint16_t>& q = quantized[track];
+		q.resize((size_t)mFrameCount * components);
+
+		for (std::uint32_t f = 0; f < mFrameCount; ++f)
+		{
+			float d[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (std::uint32_t c = 0; c < components; ++c)
+			{
+				std::uint16_t k = 0;
+				if (scale[c] > 0.0f)
+				{
+					float x = (Component(values[f], c) - lo[c]) / scale[c] + 0.5f;
+					k = x >= 65535.0f ? 65535 : (std::uint16_t)x;
+				}
+
+				q[(size_t)f * components + c] = k;
+				d[c] = lo[c] + k * scale[c];
+			}
+			decoded[f] = XMFLOAT4A(d[0], d[1], d[2], d[3]);
+		}
+
+		// Within each block keep the first key, then greedily reach for the
+		// furthest key that still reproduces everything in between.
+		for (std::uint32_t b = 0; b < blockCount; ++b)
+		{
+			std::uint32_t first = b * BlockFrames;
+			std::uint32_t last = first + BlockFrames < mFrameCount - 1 ? first + BlockFrames : mFrameCount - 1;
+
+			std::uint32_t mask = 1;
+			std::uint32_t a = first;
+
+			while (a < last)
+			{
+				std::uint32_t e = a + 1;
+
+				for (std::uint32_t candidate = a + 2; candidate <= last; ++candidate)
+				{
+					bool fits = true;
+					for (std::uint32_t k = a + 1; k < candidate && fits; ++k)
+					{
+						float t = (float)(k - a) / (float)(candidate - a);
+						for (std::uint32_t c = 0; c < components; ++c)
+						{
+							float da = Component(decoded[a], c);
+							float de = Component(decoded[candidate], c);
+							if (std::fabs(da + t * (de - da) - Component(values[k], c)) > tolerance)
+							{
+								fits = false;
+								break;
+							}
+						}
+					}
+
+					if (!fits)
+						break;
+					e = candidate;
+				}
+
+				mask |= 1u << (e - first);
+				a = e;
+			}
+
+			masks[(size_t)b * trackCount + track] = mask;
+		}
+	}
+
+	for (std::uint32_t b = 0; b < blockCount; ++b)
+	{
+		mBlockOffsets[b] = (std::uint32_t)mBlockData.size();
+
+		for (std::uint32_t track = 0; track < trackCount; ++track)
+		{
+			if (!mTrackAnimated[track])
+				continue;
+
+			std::uint32_t components = ComponentCount(track);
+			std::uint32_t mask = masks[(size_t)b * trackCount + track];
+
+			mBlockData.push_back((std::uint16_t)(mask & 0xffff));
+			mBlockData.push_back((std::uint16_t)(mask >> 16));
+
+			for (std::uint32_t bits = mask; bits; bits &= bits - 1)
+			{
+				std::uint32_t frame = b * BlockFrames + LowestBit(bits);
+				for (std::uint32_t c = 0; c < components; ++c)
+					mBlockData.push_back(quantized[track][(size_t)frame * components + c]);
+			}
+		}
+	}
+
+	// Keys are loaded four components at a time; the padding keeps the
+	// fourth read of a three-component key at the very end in bounds.
+	mBlockData.push_back(0);
+
+	stats.CompressedBytes = SizeInBytes();
+	stats.Ratio = stats.CompressedBytes > 0 ? (double)stats.RawBytes / stats.CompressedBytes : 0.0;
+
+	std::vector<BoneTransform> pose(mJointCount);
+	for (std::uint32_t f = 0; f < mFrameCount; ++f)
+	{
+		Sample(f / mSampleRate, false, pose.data());
+
+		for (std::uint32_t j = 0; j < mJointCount; ++j)
+		{
+			const BoneTransform& source = clip.Keys[(size_t)f * mJointCount + j];
+
+			float dot = std::fabs(XMVectorGetX(XMVector4Dot(
+				XMQuaternionNormalize(XMLoadFloat4A(&source.Rotation)), XMLoadFloat4A(&pose[j].Rotation))));
+			float angle = 2.0f * std::acos(dot < 1.0f ? dot : 1.0f);
+			float translation = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat4A(&source.Translation), XMLoadFloat4A(&pose[j].Translation))));
+			float scale = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat4A(&source.Scale), XMLoadFloat4A(&pose[j].Scale))));
+
+			stats.MaxRotationError = angle > stats.MaxRotationError ? angle : stats.MaxRotationError;
+			stats.MaxTranslationError = translation > stats.MaxTranslationError ? translation : stats.MaxTranslationError;
+			stats.MaxScaleError = scale > stats.MaxScaleError ? scale : stats.MaxScaleError;
+		}
+	}
+
+	return stats;
+}
+
+void CompressedClip::Sample(float time, bool loop, BoneTransform* pose)const
+{
+	if (mFrameCount == 0)
+		return;
+
+	if (loop && mDuration > 0.0f)
+	{
+		time = std::fmod(time, mDuration);
+		if (time < 0.0f)
+			time += mDuration;
+	}
+
+	float frame = time * mSampleRate;
+	if (frame < 0.0f)
+		frame = 0.0f;
+	if (frame > (float)(mFrameCount - 1))
+		frame = (float)(mFrameCount - 1);
+
+	std::uint32_t blockCount = (std::uint32_t)mBlockOffsets.size();
+	std::uint32_t f0 = (std::uint32_t)frame;
+	std::uint32_t block = blockCount > 0 && f0 / BlockFrames >= blockCount ? blockCount - 1 : f0 / BlockFrames;
+	std::uint32_t first = block * BlockFrames;
+	std::uint32_t i = f0 - first;
+	float local = frame - (float)first;
+
+	const std::uint16_t* data = blockCount > 0 ? &mBlockData[mBlockOffsets[block]] : nullptr;
+
+	for (std::uint32_t j = 0; j < mJointCount; ++j)
+	{
+		XMFLOAT4A* out[ChannelCount] = { &pose[j].Rotation, &pose[j].Translation, &pose[j].Scale };
+
+		for (std::uint32_t channel = 0; channel < ChannelCount; ++channel)
+		{
+			std::uint32_t track = j * ChannelCount + channel;
+
+			if (!mTrackAnimated[track])
+			{
+				*out[channel] = mTrackMin[track];
+				continue;
+			}
+
+			std::uint32_t components = ComponentCount(track);
+			std::uint32_t mask = data[0] | ((std::uint32_t)data[1] << 16);
+			const std::uint16_t* keys = data + 2;
+			data = keys + PopCount(mask) * components;
+
+			// The kept keys either side of the frame.  Bit i may itself be
+			// the last key of the block, in which case there is no next.
+			std::uint32_t upTo = (2u << i) - 1;
+			std::uint32_t prev = HighestBit(mask & upTo);
+			std::uint32_t above = mask & ~upTo;
+
+			const std::uint16_t* k0 = keys + PopCount(mask & ((1u << prev) - 1)) * components;
+			XMVECTOR v = XMLoadUShort4((const XMUSHORT4*)k0);
+
+			if (above)
+			{
+				std::uint32_t next = LowestBit(above);
+				float t = (local - (float)prev) / (float)(next - prev);
+				v = XMVectorLerp(v, XMLoadUShort4((const XMUSHORT4*)(k0 + components)), t);
+			}
+
+			// Dequantizing is linear, so it can follow the interpolation.
+			v = XMVectorMultiplyAdd(v, XMLoadFloat4A(&mTrackScale[track]), XMLoadFloat4A(&mTrackMin[track]));
+
+			if (channel == Rotation)
+				v = XMQuaternionNormalize(v);
+
+			XMStoreFloat4A(out[channel], v);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#include "AppEventQueue.h"
+
+const std::uint32_t AppEventQueue::Capacity;
+
+AppEventQueue::AppEventQueue()
+	: mCoalesced(0)
+{
+}
+
+void AppEventQueue::Post(const AppEvent& e)
+{
+	// Anything already waiting goes first, or events would overtake it.
+	Flush();
+	if (mBacklog.empty() && mQueue.Push(e))
+		return;
+
+	// Only the latest mouse position and window size matter.  The one
+	// replaced keeps its timestamp, so latency counts from the older input.
+	if (!mBacklog.empty() && mBacklog.back().EventType == e.EventType
+		&& (e.EventType == AppEvent::MouseMove || e.EventType == AppEvent::Resize))
+	{
+		std::int64_t timestamp = mBacklog.back().Timestamp;
+		mBacklog.back() = e;
+		mBacklog.back().Timestamp = timestamp;
+		++mCoalesced;
+		return;
+	}
+
+	mBacklog.push_back(e);
+}
+
+std::uint32_t AppEventQueue::Flush()
+{
+	std::uint32_t moved = 0;
+	while (!mBacklog.empty() && mQueue.Push(mBacklog.front()))
+	{
+		mBacklog.pop_front();
+		++moved;
+	}
+	return moved;
+}
+
+std::uint32_t AppEventQueue::Backlog()const
+{
+	return (std::uint32_t)mBacklog.size();
+}
+
+std::uint64_t AppEventQueue::Coalesced()const
+{
+	return mCoalesced;
+}
+
+bool AppEventQueue::IsInput(AppEvent::Type type)
+{
+	return type == AppEvent::MouseDown || type == AppEvent::MouseUp || type == AppEvent::MouseMove || type == AppEvent::KeyDown;
+}
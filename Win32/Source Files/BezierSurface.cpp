@@ -0,0 +1,385 @@
+#include "BezierSurface.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+using namespace DirectX;
+
+namespace
+{
+	// Patches per task.
+	const std::uint32_t GrainSize = 4;
+
+	// The control points of each side of a patch, in the order the side
+	// runs counterclockwise around (u, v).
+	const std::uint32_t SidePoints[4][4] =
+	{
+		{ 0, 1, 2, 3 },
+		{ 3, 7, 11, 15 },
+		{ 15, 14, 13, 12 },
+		{ 12, 8, 4, 0 }
+	};
+
+	const XMFLOAT2 Corners[4] =
+	{
+		XMFLOAT2(0.0f, 0.0f),
+		XMFLOAT2(1.0f, 0.0f),
+		XMFLOAT2(1.0f, 1.0f),
+		XMFLOAT2(0.0f, 1.0f)
+	};
+
+	// The cubic Bernstein polynomials at t and their derivatives.
+	void Bernstein(float t, float b[4], float d[4])
+	{
+		float s = 1.0f - t;
+		b[0] = s * s * s;
+		b[1] = 3.0f * t * s * s;
+		b[2] = 3.0f * t * t * s;
+		b[3] = t * t * t;
+		d[0] = -3.0f * s * s;
+		d[1] = 3.0f * s * s - 6.0f * t * s;
+		d[2] = 6.0f * t * s - 3.0f * t * t;
+		d[3] = 3.0f * t * t;
+	}
+
+	XMVECTOR Combine(const float w[4], const XMVECTOR* p, size_t stride)
+	{
+		XMVECTOR sum = XMVectorScale(p[0], w[0]);
+		sum = XMVectorMultiplyAdd(XMVectorReplicate(w[1]), p[stride], sum);
+		sum = XMVectorMultiplyAdd(XMVectorReplicate(w[2]), p[2 * stride], sum);
+		return XMVectorMultiplyAdd(XMVectorReplicate(w[3]), p[3 * stride], sum);
+	}
+
+	// The four curves across v at v, and their derivatives in v, so the
+	// points of a row cost one curve each.
+	void Columns(const XMVECTOR* p, float v, XMVECTOR* c, XMVECTOR* dc)
+	{
+		float b[4], d[4];
+		Bernstein(v, b, d);
+		for (int i = 0; i < 4; ++i)
+		{
+			c[i] = Combine(b, p + i, 4);
+			dc[i] = Combine(d, p + i, 4);
+		}
+	}
+
+	void Point(const XMVECTOR* c, const XMVECTOR* dc, float u, XMVECTOR& position, XMVECTOR& du, XMVECTOR& dv)
+	{
+		float b[4], d[4];
+		Bernstein(u, b, d);
+		position = Combine(b, c, 1);
+		du = Combine(d, c, 1);
+		dv = Combine(b, dc, 1);
+	}
+
+	float Flatness(XMVECTOR p0, XMVECTOR p1, XMVECTOR p2, XMVECTOR p3)
+	{
+		XMVECTOR twice = XMVectorReplicate(2.0f);
+		XMVECTOR a = XMVector3LengthSq(XMVectorAdd(XMVectorNegativeMultiplySubtract(twice, p1, p0), p2));
+		XMVECTOR b = XMVector3LengthSq(XMVectorAdd(XMVectorNegativeMultiplySubtract(twice, p2, p1), p3));
+		return std::sqrt(XMVectorGetX(XMVectorMax(a, b)));
+	}
+
+	float BoxDistance(FXMVECTOR eye, const XMVECTOR* points, size_t count)
+	{
+		XMVECTOR lo = points[0];
+		XMVECTOR hi = points[0];
+		for (size_t i = 1; i < count; ++i)
+		{
+			lo = XMVectorMin(lo, points[i]);
+			hi = XMVectorMax(hi, points[i]);
+		}
+
+		return XMVectorGetX(XMVector3Length(XMVectorSubtract(eye, XMVectorClamp(eye, lo, hi))));
+	}
+}
+
+void BezierSurface::Create(const XMFLOAT3* controlPoints, std::uint32_t controlPointCount,
+	const std::uint32_t* patches, std::uint32_t patchCount)
+{
+	PROFILE_FUNCTION();
+
+	mControlPoints.assign(controlPoints, controlPoints + controlPointCount);
+	mPatches.assign(patches, patches + 16 * (size_t)patchCount);
+
+	mEdgePoints.clear();
+	mPatchEdges.resize(4 * (size_t)patchCount);
+	mPatchReversed.resize(4 * (size_t)patchCount);
+
+	std::map<std::array<std::uint32_t, 4>, std::uint32_t> edges;
+
+	for (std::uint32_t p = 0; p < patchCount; ++p)
+	{
+		for (std::uint32_t s = 0; s < 4; ++s)
+		{
+			std::array<std::uint32_t, 4> points;
+			for (std::uint32_t k = 0; k < 4; ++k)
+				points[k] = mPatches[16 * p + SidePoints[s][k]];
+
+			bool reversed = points[3] < points[0] || (points[3] == points[0] && points[2] < points[1]);
+			if (reversed)
+				std::reverse(points.begin(), points.end());
+
+			auto found = edges.emplace(points, (std::uint32_t)edges.size());
+			if (found.second)
+				mEdgePoints.insert(mEdgePoints.end(), points.begin(), points.end());
+
+			mPatchEdges[4 * p + s] = found.first->second;
+			mPatchReversed[4 * p + s] = reversed;
+		}
+	}
+
+	// Zero factors never match, so the first Update builds every patch.
+	mEdgeFactors.assign(edges.size(), 0);
+	mFactors.assign(patchCount, Factors{});
+	mMeshes.assign(patchCount, GeometryGenerator::MeshData());
+	mChanged.clear();
+	mTriangleCount = 0;
+}
+
+void BezierSurface::Update(FXMVECTOR eye, float pixelScale, float pixelError)
+{
+	PROFILE_FUNCTION();
+
+	mChanged.clear();
+
+	float toleranceScale = pixelError / pixelScale;
+
+	for (size_t e = 0; e < mEdgeFactors.size(); ++e)
+	{
+		XMVECTOR q[4];
+		for (int k = 0; k < 4; ++k)
+			q[k] = XMLoadFloat3(&mControlPoints[mEdgePoints[4 * e + k]]);
+
+		mEdgeFactors[e] = Factor(Flatness(q[0], q[1], q[2], q[3]), toleranceScale * BoxDistance(eye, q, 4));
+	}
+
+	for (std::uint32_t patch = 0; patch < PatchCount(); ++patch)
+	{
+		XMVECTOR p[16];
+		for (int k = 0; k < 16; ++k)
+			p[k] = XMLoadFloat3(&mControlPoints[mPatches[16 * patch + k]]);
+
+		// Every curve of the patch in one direction blends the rows of
+		// control points in that direction, so it is no less flat than
+		// the least flat row.
+		float flatnessU = 0.0f;
+		float flatnessV = 0.0f;
+		for (int k = 0; k < 4; ++k)
+		{
+			flatnessU = std::max(flatnessU, Flatness(p[4 * k], p[4 * k + 1], p[4 * k + 2], p[4 * k + 3]));
+			flatnessV = std::max(flatnessV, Flatness(p[k], p[k + 4], p[k + 8], p[k + 12]));
+		}
+
+		// Inside the patch the two directions' errors add, so each gets
+		// half of it.
+		float tolerance = 0.5f * toleranceScale * BoxDistance(eye, p, 16);
+
+		// At least two across, so there is an inner grid for the edges to
+		// join, and never coarser than an edge.
+		Factors factors;
+		for (std::uint32_t s = 0; s < 4; ++s)
+			factors.Edges[s] = mEdgeFactors[mPatchEdges[4 * patch + s]];
+
+		factors.U = std::max(std::max(Factor(flatnessU, tolerance), 2u), std::max(factors.Edges[0], factors.Edges[2]));
+		factors.V = std::max(std::max(Factor(flatnessV, tolerance), 2u), std::max(factors.Edges[1], factors.Edges[3]));
+
+		if (std::memcmp(&factors, &mFactors[patch], sizeof(Factors)) != 0)
+		{
+			mFactors[patch] = factors;
+			mChanged.push_back(patch);
+		}
+	}
+
+	ThreadPool::Get().ParallelFor((std::uint32_t)mChanged.size(), GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+			Tessellate(mChanged[i], mMeshes[mChanged[i]]);
+	});
+
+	if (!mChanged.empty())
+	{
+		mTriangleCount = 0;
+		for (const GeometryGenerator::MeshData& mesh : mMeshes)
+			mTriangleCount += mesh.Indices32.size() / 3;
+	}
+}
+
+std::uint32_t BezierSurface::PatchCount()const
+{
+	return (std::uint32_t)mFactors.size();
+}
+
+const std::vector<std::uint32_t>& BezierSurface::ChangedPatches()const
+{
+	return mChanged;
+}
+
+const GeometryGenerator::MeshData& BezierSurface::PatchMesh(std::uint32_t patch)const
+{
+	return mMeshes[patch];
+}
+
+std::uint64_t BezierSurface::TriangleCount()const
+{
+	return mTriangleCount;
+}
+
+// A cubic's polyline of n equal steps in t is within 3/4 of the largest
+// second difference of its control points over n^2.
+std::uint32_t BezierSurface::Factor(float flatness, float tolerance)
+{
+	if (flatness <= 0.0f)
+		return 1;
+	if (tolerance <= 0.0f)
+		return MaxFactor;
+
+	float n = std::ceil(std::sqrt(0.75f * flatness / tolerance));
+	return n >= (float)MaxFactor ? MaxFactor : std::max((std::uint32_t)n, 1u);
+}
+
+void BezierSurface::Tessellate(std::uint32_t patch, GeometryGenerator::MeshData& mesh)const
+{
+	typedef GeometryGenerator::Vertex Vertex;
+
+	const Factors& factors = mFactors[patch];
+	const std::uint32_t nu = factors.U;
+	const std::uint32_t nv = factors.V;
+
+	XMVECTOR p[16];
+	for (int k = 0; k < 16; ++k)
+		p[k] = XMLoadFloat3(&mControlPoints[mPatches[16 * patch + k]]);
+
+	mesh.Vertices.clear();
+	mesh.Indices32.clear();
+
+	auto addVertex = [&](FXMVECTOR position, FXMVECTOR du, FXMVECTOR dv, float u, float v)
+	{
+		XMVECTOR normal = XMVector3Cross(du, dv);
+
+		// Where the patch pinches to a point, take the frame from just
+		// inside instead.
+		if (XMVectorGetX(XMVector3LengthSq(normal)) <= FLT_MIN)
+		{
+			XMVECTOR c[4], dc[4], unused, du2, dv2;
+			Columns(p, v + (0.5f - v) * 1e-3f, c, dc);
+			Point(c, dc, u + (0.5f - u) * 1e-3f, unused, du2, dv2);
+			normal = XMVector3Cross(du2, dv2);
+		}
+
+		Vertex vertex;
+		XMStoreFloat3(&vertex.Position, position);
+		XMStoreFloat3(&vertex.Normal, XMVector3Normalize(normal));
+		XMStoreFloat3(&vertex.TangentU, XMVector3Normalize(du));
+		vertex.TexC = XMFLOAT2(u, v);
+		mesh.Vertices.push_back(vertex);
+		return (std::uint32_t)mesh.Vertices.size() - 1;
+	};
+
+	auto addTriangle = [&](std::uint32_t a, std::uint32_t b, std::uint32_t c)
+	{
+		mesh.Indices32.push_back(a);
+		mesh.Indices32.push_back(b);
+		mesh.Indices32.push_back(c);
+	};
+
+	// The inner grid, (nu - 1) by (nv - 1) points a row at a time.
+	XMVECTOR c[4], dc[4], position, du, dv;
+	for (std::uint32_t j = 1; j < nv; ++j)
+	{
+		float v = (float)j / nv;
+		Columns(p, v, c, dc);
+
+		for (std::uint32_t i = 1; i < nu; ++i)
+		{
+			float u = (float)i / nu;
+			Point(c, dc, u, position, du, dv);
+			addVertex(position, du, dv, u, v);
+		}
+	}
+
+	auto inner = [nu](std::uint32_t i, std::uint32_t j)
+	{
+		return (j - 1) * (nu - 1) + (i - 1);
+	};
+
+	for (std::uint32_t j = 1; j + 1 < nv; ++j)
+	{
+		for (std::uint32_t i = 1; i + 1 < nu; ++i)
+		{
+			addTriangle(inner(i, j), inner(i + 1, j), inner(i + 1, j + 1));
+			addTriangle(inner(i, j), inner(i + 1, j + 1), inner(i, j + 1));
+		}
+	}
+
+	// Corners are the control points themselves, exactly.
+	std::uint32_t corners[4];
+	for (std::uint32_t s = 0; s < 4; ++s)
+	{
+		float u = Corners[s].x;
+		float v = Corners[s].y;
+		Columns(p, v, c, dc);
+		Point(c, dc, u, position, du, dv);
+		corners[s] = addVertex(p[SidePoints[s][0]], du, dv, u, v);
+	}
+
+	std::vector<std::uint32_t> outer;
+	for (std::uint32_t s = 0; s < 4; ++s)
+	{
+		const std::uint32_t e = factors.Edges[s];
+		const std::uint32_t n = s % 2 == 0 ? nu : nv;
+		const std::uint32_t edge = mPatchEdges[4 * patch + s];
+		const bool reversed = mPatchReversed[4 * patch + s] != 0;
+
+		XMVECTOR q[4];
+		for (int k = 0; k < 4; ++k)
+			q[k] = XMLoadFloat3(&mControlPoints[mEdgePoints[4 * edge + k]]);
+
+		// The edge's vertices come from its own control points at the
+		// parameter the neighbour uses too.
+		outer.assign(1, corners[s]);
+		for (std::uint32_t k = 1; k < e; ++k)
+		{
+			float b[4], d[4];
+			Bernstein((float)(reversed ? e - k : k) / e, b, d);
+			XMVECTOR edgePosition = Combine(b, q, 1);
+
+			float f = (float)k / e;
+			XMFLOAT2 uv = s == 0 ? XMFLOAT2(f, 0.0f) : s == 1 ? XMFLOAT2(1.0f, f) : s == 2 ? XMFLOAT2(1.0f - f, 1.0f) : XMFLOAT2(0.0f, 1.0f - f);
+			Columns(p, uv.y, c, dc);
+			Point(c, dc, uv.x, position, du, dv);
+			outer.push_back(addVertex(edgePosition, du, dv, uv.x, uv.y));
+		}
+		outer.push_back(corners[(s + 1) % 4]);
+
+		// The inner row along this side, in the same direction.
+		auto row = [&](std::uint32_t m)
+		{
+			return s == 0 ? inner(m, 1) : s == 1 ? inner(nu - 1, m) : s == 2 ? inner(nu - m, nv - 1) : inner(1, nv - m);
+		};
+
+		// Zip the rows together, always stepping along the one whose next
+		// vertex comes first.  The inner row starts and ends a step in, so
+		// the strips of neighbouring sides meet on the corner diagonals.
+		std::uint32_t a = 0;
+		std::uint32_t m = 1;
+		while (a < e || m < n - 1)
+		{
+			if (m == n - 1 || (a < e && (a + 1) * n <= (m + 1) * e))
+			{
+				addTriangle(outer[a], outer[a + 1], row(m));
+				++a;
+			}
+			else
+			{
+				addTriangle(outer[a], row(m + 1), row(m));
+				++m;
+			}
+		}
+	}
+}
@@ -0,0 +1,816 @@
+#include "BlockCompression.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Blocks per task.
+	const std::uint32_t GrainSize = 64;
+
+	// BC7 interpolation weights for 4-bit indices, out of 64.
+	const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	std::uint32_t BlocksAcross(std::uint32_t size)
+	{
+		return size > 4 ? (size + 3) / 4 : 1;
+	}
+
+	void StoreLittleEndian(std::uint8_t* p, std::uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			p[i] = (std::uint8_t)(value >> (8 * i));
+	}
+
+	std::uint64_t LoadLittleEndian(const std::uint8_t* p, int bytes)
+	{
+		std::uint64_t value = 0;
+		for (int i = 0; i < bytes; ++i)
+			value |= (std::uint64_t)p[i] << (8 * i);
+		return value;
+	}
+
+	// BC7 fields are packed least significant bit first across the block.
+	struct BitWriter
+	{
+		std::uint8_t* Data;
+		std::uint32_t Position;
+
+		void Write(std::uint32_t value, std::uint32_t bits)
+		{
+			for (std::uint32_t b = 0; b < bits; ++b, ++Position)
+			{
+				if ((value >> b) & 1)
+					Data[Position >> 3] |= (std::uint8_t)(1 << (Position & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const std::uint8_t* Data;
+		std::uint32_t Position;
+
+		std::uint32_t Read(std::uint32_t bits)
+		{
+			std::uint32_t value = 0;
+			for (std::uint32_t b = 0; b < bits; ++b, ++Position)
+				value |= (std::uint32_t)((Data[Position >> 3] >> (Position & 7)) & 1) << b;
+			return value;
+		}
+	};
+
+	// The 4x4 block at (bx, by) as floats in [0, 255], repeating the last
+	// row and column where the block hangs over the image.
+	void LoadBlock(const TextureImage& image, std::uint32_t bx, std::uint32_t by, XMVECTOR* pixels)
+	{
+		for (std::uint32_t y = 0; y < 4; ++y)
+		{
+			std::uint32_t sy = by * 4 + y < image.Height ? by * 4 + y : image.Height - 1;
+
+			for (std::uint32_t x = 0; x < 4; ++x)
+			{
+				std::uint32_t sx = bx * 4 + x < image.Width ? bx * 4 + x : image.Width - 1;
+				const std::uint8_t* p = &image.Pixels[((size_t)sy * image.Width + sx) * 4];
+				pixels[y * 4 + x] = XMVectorSet((float)p[0], (float)p[1], (float)p[2], (float)p[3]);
+			}
+		}
+	}
+
+	void StoreBlock(const std::uint8_t* rgba, std::uint32_t bx, std::uint32_t by, TextureImage& image)
+	{
+		for (std::uint32_t y = 0; y < 4 && by * 4 + y < image.Height; ++y)
+		{
+			for (std::uint32_t x = 0; x < 4 && bx * 4 + x < image.Width; ++x)
+			{
+				std::uint8_t* p = &image.Pixels[((size_t)(by * 4 + y) * image.Width + bx * 4 + x) * 4];
+				std::memcpy(p, rgba + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+
+	XMVECTOR ClampColor(FXMVECTOR c)
+	{
+		return XMVectorClamp(c, XMVectorZero(), XMVectorReplicate(255.0f));
+	}
+
+	// Ends of the line of best fit through the pixels: the principal axis of
+	// their covariance by power iteration, spanning their projections.  Mask
+	// zeroes the channels left out of the fit.
+	void FitLine(const XMVECTOR* pixels, FXMVECTOR mask, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		XMVECTOR mean = XMVectorZero();
+		for (int i = 0; i < 16; ++i)
+			mean = XMVectorAdd(mean, pixels[i]);
+		mean = XMVectorMultiply(XMVectorScale(mean, 1.0f / 16.0f), mask);
+
+		XMVECTOR cov0 = XMVectorZero();
+		XMVECTOR cov1 = XMVectorZero();
+		XMVECTOR cov2 = XMVectorZero();
+		XMVECTOR cov3 = XMVectorZero();
+
+		// Starting from the pixel farthest from the mean keeps the first
+		// guess off any axis the covariance would cancel.
+		XMVECTOR axis = XMVectorZero();
+		float farthest = 0.0f;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			XMVECTOR d = XMVectorSubtract(XMVectorMultiply(pixels[i], mask), mean);
+			cov0 = XMVectorMultiplyAdd(d, XMVectorSplatX(d), cov0);
+			cov1 = XMVectorMultiplyAdd(d, XMVectorSplatY(d), cov1);
+			cov2 = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), cov2);
+			cov3 = XMVectorMultiplyAdd(d, XMVectorSplatW(d), cov3);
+
+			float distance = XMVectorGetX(XMVector4LengthSq(d));
+			if (distance > farthest)
+			{
+				farthest = distance;
+				axis = d;
+			}
+		}
+
+		if (farthest < 1e-4f)
+		{
+			e0 = e1 = mean;
+			return;
+		}
+
+		for (int k = 0; k < 8; ++k)
+		{
+			XMVECTOR next = XMVectorMultiply(cov0, XMVectorSplatX(axis));
+			next = XMVectorMultiplyAdd(cov1, XMVectorSplatY(axis), next);
+			next = XMVectorMultiplyAdd(cov2, XMVectorSplatZ(axis), next);
+			next = XMVectorMultiplyAdd(cov3, XMVectorSplatW(axis), next);
+			axis = XMVector4Normalize(next);
+		}
+
+		float lo = FLT_MAX;
+		float hi = -FLT_MAX;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(XMVectorMultiply(pixels[i], mask), mean), axis));
+			lo = t < lo ? t : lo;
+			hi = t > hi ? t : hi;
+		}
+
+		e0 = ClampColor(XMVectorMultiplyAdd(axis, XMVectorReplicate(lo), mean));
+		e1 = ClampColor(XMVectorMultiplyAdd(axis, XMVectorReplicate(hi), mean));
+	}
+
+	// Least squares endpoints for pixels already placed at fractions t
+	// between them.  Fails when every pixel sits at the same fraction and
+	// the endpoints are not determined.
+	bool FitEndpoints(const XMVECTOR* pixels, const float* t, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float aa = 0.0f;
+		float bb = 0.0f;
+		float ab = 0.0f;
+		XMVECTOR ap = XMVectorZero();
+		XMVECTOR bp = XMVectorZero();
+
+		for (int i = 0; i < 16; ++i)
+		{
+			float s = 1.0f - t[i];
+			aa += s * s;
+			bb += t[i] * t[i];
+			ab += s * t[i];
+			ap = XMVectorMultiplyAdd(pixels[i], XMVectorReplicate(s), ap);
+			bp = XMVectorMultiplyAdd(pixels[i], XMVectorReplicate(t[i]), bp);
+		}
+
+		float det = aa * bb - ab * ab;
+		if (det < 1e-4f)
+			return false;
+
+		float inv = 1.0f / det;
+		e0 = ClampColor(XMVectorScale(XMVectorSubtract(XMVectorScale(ap, bb), XMVectorScale(bp, ab)), inv));
+		e1 = ClampColor(XMVectorScale(XMVectorSubtract(XMVectorScale(bp, aa), XMVectorScale(ap, ab)), inv));
+		return true;
+	}
+
+	std::uint16_t PackRgb565(FXMVECTOR c)
+	{
+		XMFLOAT4A f;
+		XMStoreFloat4A(&f, c);
+
+		std::uint32_t r = (std::uint32_t)(f.x * (31.0f / 255.0f) + 0.5f);
+		std::uint32_t g = (std::uint32_t)(f.y * (63.0f / 255.0f) + 0.5f);
+		std::uint32_t b = (std::uint32_t)(f.z * (31.0f / 255.0f) + 0.5f);
+		return (std::uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(std::uint32_t c, int* rgb)
+	{
+		std::uint32_t r = (c >> 11) & 31;
+		std::uint32_t g = (c >> 5) & 63;
+		std::uint32_t b = c & 31;
+
+		rgb[0] = (int)((r << 3) | (r >> 2));
+		rgb[1] = (int)((g << 2) | (g >> 4));
+		rgb[2] = (int)((b << 3) | (b >> 2));
+	}
+
+	// The colors of a BC1 block in index order.  Four-color blocks (always
+	// the case inside BC3) interpolate thirds; otherwise index 2 is the
+	// midpoint and index 3 transparent black.
+	void ColorPalette(std::uint16_t c0, std::uint16_t c1, bool fourColor, std::uint8_t* palette)
+	{
+		int a[3];
+		int b[3];
+		UnpackRgb565(c0, a);
+		UnpackRgb565(c1, b);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[c] = (std::uint8_t)a[c];
+			palette[4 + c] = (std::uint8_t)b[c];
+
+			if (fourColor)
+			{
+				palette[8 + c] = (std::uint8_t)((2 * a[c] + b[c] + 1) / 3);
+				palette[12 + c] = (std::uint8_t)((a[c] + 2 * b[c] + 1) / 3);
+			}
+			else
+			{
+				palette[8 + c] = (std::uint8_t)((a[c] + b[c]) / 2);
+				palette[12 + c] = 0;
+			}
+		}
+
+		palette[3] = palette[7] = palette[11] = 255;
+		palette[15] = fourColor ? 255 : 0;
+	}
+
+	// Picks the nearest of the first paletteSize colors for every pixel and
+	// returns the total squared error.
+	float AssignColorIndices(const XMVECTOR* pixels, const std::uint8_t* bytes, int paletteSize, std::uint8_t* indices)
+	{
+		XMVECTOR palette[4];
+		for (int k = 0; k < paletteSize; ++k)
+			palette[k] = XMVectorSet((float)bytes[4 * k], (float)bytes[4 * k + 1], (float)bytes[4 * k + 2], 0.0f);
+
+		const XMVECTOR mask = XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f);
+		float total = 0.0f;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			XMVECTOR p = XMVectorMultiply(pixels[i], mask);
+			float best = FLT_MAX;
+
+			for (int k = 0; k < paletteSize; ++k)
+			{
+				float e = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, palette[k])));
+				if (e < best)
+				{
+					best = e;
+					indices[i] = (std::uint8_t)k;
+				}
+			}
+
+			total += best;
+		}
+
+		return total;
+	}
+
+	// BC3 color blocks always decode as four colors, so threeColor is only
+	// set for BC1.
+	void EncodeColorBlock(const XMVECTOR* pixels, bool threeColor, std::uint8_t* block)
+	{
+		// Where each index sits between color0 and color1, in four- and
+		// three-color blocks.
+		static const float Fractions[2][4] =
+		{
+			{ 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f },
+			{ 0.0f, 1.0f, 0.5f, 0.0f }
+		};
+
+		XMVECTOR e0;
+		XMVECTOR e1;
+		FitLine(pixels, XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f), e0, e1);
+
+		float bestError = FLT_MAX;
+
+		// A second pass refits the endpoints to the indices the first chose.
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			std::uint16_t lo = PackRgb565(e0);
+			std::uint16_t hi = PackRgb565(e1);
+			if (lo > hi)
+				std::swap(lo, hi);
+
+			float passError = FLT_MAX;
+			float t[16];
+
+			// color0 > color1 selects four colors.  The other order gives a
+			// midpoint instead of thirds (and transparent black, unused here),
+			// which suits three-step ramps better.
+			int modeCount = threeColor && lo != hi ? 2 : 1;
+
+			for (int mode = 0; mode < modeCount; ++mode)
+			{
+				std::uint16_t c0 = mode == 0 ? hi : lo;
+				std::uint16_t c1 = mode == 0 ? lo : hi;
+
+				std::uint8_t bytes[16];
+				ColorPalette(c0, c1, mode == 0, bytes);
+
+				// Equal endpoints leave index 0 as the only safe choice.
+				int paletteSize = lo == hi ? 1 : mode == 0 ? 4 : 3;
+
+				std::uint8_t indices[16];
+				float error = AssignColorIndices(pixels, bytes, paletteSize, indices);
+
+				if (error < bestError)
+				{
+					std::uint32_t bits = 0;
+					for (int i = 0; i < 16; ++i)
+						bits |= (std::uint32_t)indices[i] << (2 * i);
+
+					bestError = error;
+					StoreLittleEndian(block, c0, 2);
+					StoreLittleEndian(block + 2, c1, 2);
+					StoreLittleEndian(block + 4, bits, 4);
+				}
+
+				if (error < passError)
+				{
+					passError = error;
+					for (int i = 0; i < 16; ++i)
+						t[i] = Fractions[mode][indices[i]];
+				}
+			}
+
+			if (lo == hi || passError == 0.0f)
+				break;
+
+			if (!FitEndpoints(pixels, t, e0, e1))
+				break;
+		}
+	}
+
+	void AlphaPalette(int a0, int a1, int* palette)
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void EncodeAlphaBlock(const XMVECTOR* pixels, std::uint8_t* block)
+	{
+		int alpha[16];
+		int lo = 255;
+		int hi = 0;
+		int innerLo = 255;
+		int innerHi = 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int a = (int)XMVectorGetW(pixels[i]);
+			alpha[i] = a;
+			lo = a < lo ? a : lo;
+			hi = a > hi ? a : hi;
+
+			if (a != 0 && a != 255)
+			{
+				innerLo = a < innerLo ? a : innerLo;
+				innerHi = a > innerHi ? a : innerHi;
+			}
+		}
+
+		if (innerLo > innerHi)
+			innerLo = innerHi = 0;
+
+		// Eight steps across the whole range, or six across the values
+		// strictly inside it with exact 0 and 255 on the side.  Cut-out
+		// edges usually prefer the second.
+		const int candidates[2][2] = { { hi, lo }, { innerLo, innerHi } };
+		int bestError = std::numeric_limits<int>::max();
+
+		for (int c = 0; c < 2; ++c)
+		{
+			int palette[8];
+			AlphaPalette(candidates[c][0], candidates[c][1], palette);
+
+			std::uint64_t bits = 0;
+			int error = 0;
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int best = std::numeric_limits<int>::max();
+				int index = 0;
+
+				for (int k = 0; k < 8; ++k)
+				{
+					int d = (alpha[i] - palette[k]) * (alpha[i] - palette[k]);
+					if (d < best)
+					{
+						best = d;
+						index = k;
+					}
+				}
+
+				bits |= (std::uint64_t)index << (3 * i);
+				error += best;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				block[0] = (std::uint8_t)candidates[c][0];
+				block[1] = (std::uint8_t)candidates[c][1];
+				StoreLittleEndian(block + 2, bits, 6);
+			}
+
+			if (error == 0)
+				break;
+		}
+	}
+
+	// Nearest of the sixteen BC7 weights to every fraction k / 64.
+	struct Bc7IndexTable
+	{
+		Bc7IndexTable()
+		{
+			for (int k = 0; k <= 64; ++k)
+			{
+				int best = 0;
+				for (int i = 1; i < 16; ++i)
+				{
+					if (std::abs(Bc7Weights[i] - k) < std::abs(Bc7Weights[best] - k))
+						best = i;
+				}
+				Index[k] = (std::uint8_t)best;
+			}
+		}
+
+		std::uint8_t Index[65];
+	};
+
+	const Bc7IndexTable& GetBc7IndexTable()
+	{
+		static Bc7IndexTable table;
+		return table;
+	}
+
+	// Seven bits per channel plus a low bit shared by the whole endpoint,
+	// whichever value of it lands closer.
+	void QuantizeBc7Endpoint(FXMVECTOR e, int* q, int& p)
+	{
+		XMFLOAT4A f;
+		XMStoreFloat4A(&f, e);
+		const float* channels = &f.x;
+
+		float bestError = FLT_MAX;
+
+		for (int pbit = 0; pbit < 2; ++pbit)
+		{
+			int v[4];
+			float error = 0.0f;
+
+			for (int c = 0; c < 4; ++c)
+			{
+				int x = (int)((channels[c] - pbit) * 0.5f + 0.5f);
+				v[c] = x < 0 ? 0 : x > 127 ? 127 : x;
+
+				float d = (float)((v[c] << 1) | pbit) - channels[c];
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				p = pbit;
+				std::memcpy(q, v, sizeof(v));
+			}
+		}
+	}
+
+	void Bc7Palette(const int* e0, const int* e1, std::uint8_t* palette)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int w = Bc7Weights[i];
+			for (int c = 0; c < 4; ++c)
+				palette[4 * i + c] = (std::uint8_t)(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+		}
+	}
+
+	// Projects every pixel onto the endpoint line to pick its index, then
+	// checks the neighbours, since endpoint rounding bends the palette a
+	// little off the line.  Returns the total squared error.
+	float AssignBc7Indices(const XMVECTOR* pixels, const XMVECTOR* palette, std::uint8_t* indices)
+	{
+		const std::uint8_t* table = GetBc7IndexTable().Index;
+
+		XMVECTOR axis = XMVectorSubtract(palette[15], palette[0]);
+		float lengthSq = XMVectorGetX(XMVector4LengthSq(axis));
+		XMVECTOR scale = lengthSq > 0.0f ? XMVectorScale(axis, 64.0f / lengthSq) : XMVectorZero();
+
+		float total = 0.0f;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int k = (int)(XMVectorGetX(XMVector4Dot(XMVectorSubtract(pixels[i], palette[0]), scale)) + 0.5f);
+			int index = table[k < 0 ? 0 : k > 64 ? 64 : k];
+
+			float best = FLT_MAX;
+			int first = index > 0 ? index - 1 : 0;
+			int last = index < 15 ? index + 1 : 15;
+
+			for (int n = first; n <= last; ++n)
+			{
+				float e = XMVectorGetX(XMVector4LengthSq(XMVectorSubtract(pixels[i], palette[n])));
+				if (e < best)
+				{
+					best = e;
+					indices[i] = (std::uint8_t)n;
+				}
+			}
+
+			total += best;
+		}
+
+		return total;
+	}
+
+	void PackBc7Mode6(const int* q0, int p0, const int* q1, int p1, const std::uint8_t* indices, std::uint8_t* block)
+	{
+		// The first index has no top bit; if it would be set, swapping the
+		// endpoints and mirroring every index gives the same colors.
+		int flip = 0;
+		if (indices[0] & 8)
+		{
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			flip = 15;
+		}
+
+		std::memset(block, 0, 16);
+		BitWriter writer = { block, 0 };
+
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(q0[c], 7);
+			writer.Write(q1[c], 7);
+		}
+		writer.Write(p0, 1);
+		writer.Write(p1, 1);
+
+		writer.Write(indices[0] ^ flip, 3);
+		for (int i = 1; i < 16; ++i)
+			writer.Write(indices[i] ^ flip, 4);
+	}
+
+	void EncodeBc7Block(const XMVECTOR* pixels, std::uint8_t* block)
+	{
+		XMVECTOR e0;
+		XMVECTOR e1;
+		FitLine(pixels, XMVectorSplatOne(), e0, e1);
+
+		float bestError = FLT_MAX;
+
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			int q0[4];
+			int q1[4];
+			int p0;
+			int p1;
+			QuantizeBc7Endpoint(e0, q0, p0);
+			QuantizeBc7Endpoint(e1, q1, p1);
+
+			int v0[4];
+			int v1[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				v0[c] = (q0[c] << 1) | p0;
+				v1[c] = (q1[c] << 1) | p1;
+			}
+
+			std::uint8_t bytes[64];
+			Bc7Palette(v0, v1, bytes);
+
+			XMVECTOR palette[16];
+			for (int k = 0; k < 16; ++k)
+				palette[k] = XMVectorSet((float)bytes[4 * k], (float)bytes[4 * k + 1], (float)bytes[4 * k + 2], (float)bytes[4 * k + 3]);
+
+			std::uint8_t indices[16];
+			float error = AssignBc7Indices(pixels, palette, indices);
+
+			if (error < bestError)
+			{
+				bestError = error;
+				PackBc7Mode6(q0, p0, q1, p1, indices, block);
+			}
+
+			if (error == 0.0f)
+				break;
+
+			float t[16];
+			for (int i = 0; i < 16; ++i)
+				t[i] = Bc7Weights[indices[i]] / 64.0f;
+
+			if (!FitEndpoints(pixels, t, e0, e1))
+				break;
+		}
+	}
+
+	void DecodeColorBlock(const std::uint8_t* block, bool alwaysFourColor, std::uint8_t* rgba)
+	{
+		std::uint16_t c0 = (std::uint16_t)LoadLittleEndian(block, 2);
+		std::uint16_t c1 = (std::uint16_t)LoadLittleEndian(block + 2, 2);
+		std::uint32_t bits = (std::uint32_t)LoadLittleEndian(block + 4, 4);
+
+		std::uint8_t palette[16];
+		ColorPalette(c0, c1, alwaysFourColor || c0 > c1, palette);
+
+		for (int i = 0; i < 16; ++i)
+			std::memcpy(rgba + 4 * i, palette + 4 * ((bits >> (2 * i)) & 3), 4);
+	}
+
+	void DecodeAlphaBlock(const std::uint8_t* block, std::uint8_t* rgba)
+	{
+		int palette[8];
+		AlphaPalette(block[0], block[1], palette);
+
+		std::uint64_t bits = LoadLittleEndian(block + 2, 6);
+		for (int i = 0; i < 16; ++i)
+			rgba[4 * i + 3] = (std::uint8_t)palette[(bits >> (3 * i)) & 7];
+	}
+
+	void DecodeBc7Block(const std::uint8_t* block, std::uint8_t* rgba)
+	{
+		if ((block[0] & 0x7f) != 0x40)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				rgba[4 * i] = rgba[4 * i + 2] = rgba[4 * i + 3] = 255;
+				rgba[4 * i + 1] = 0;
+			}
+			return;
+		}
+
+		BitReader reader = { block, 7 };
+
+		int e0[4];
+		int e1[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = (int)reader.Read(7) << 1;
+			e1[c] = (int)reader.Read(7) << 1;
+		}
+
+		std::uint32_t p0 = reader.Read(1);
+		std::uint32_t p1 = reader.Read(1);
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] |= p0;
+			e1[c] |= p1;
+		}
+
+		std::uint8_t palette[64];
+		Bc7Palette(e0, e1, palette);
+
+		for (int i = 0; i < 16; ++i)
+			std::memcpy(rgba + 4 * i, palette + 4 * reader.Read(i == 0 ? 3 : 4), 4);
+	}
+}
+
+std::uint32_t BlockCompressor::BlockSize(Format format)
+{
+	return format == BC1 ? 8 : 16;
+}
+
+size_t BlockCompressor::LevelSize(Format format, std::uint32_t width, std::uint32_t height)
+{
+	return (size_t)BlocksAcross(width) * BlocksAcross(height) * BlockSize(format);
+}
+
+void BlockCompressor::Encode(const TextureImage& image, Format format, std::vector<std::uint8_t>& blocks)
+{
+	PROFILE_FUNCTION();
+
+	std::uint32_t blocksWide = BlocksAcross(image.Width);
+	std::uint32_t blocksHigh = BlocksAcross(image.Height);
+	std::uint32_t blockSize = BlockSize(format);
+
+	blocks.resize((size_t)blocksWide * blocksHigh * blockSize);
+	std::uint8_t* out = blocks.data();
+
+	ThreadPool::Get().ParallelFor(blocksWide * blocksHigh, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		XMVECTOR pixels[16];
+
+		for (std::uint32_t b = begin; b < end; ++b)
+		{
+			LoadBlock(image, b % blocksWide, b / blocksWide, pixels);
+			std::uint8_t* block = out + (size_t)b * blockSize;
+
+			switch (format)
+			{
+			case BC1:
+				EncodeColorBlock(pixels, true, block);
+				break;
+			case BC3:
+				EncodeAlphaBlock(pixels, block);
+				EncodeColorBlock(pixels, false, block + 8);
+				break;
+			default:
+				EncodeBc7Block(pixels, block);
+				break;
+			}
+		}
+	});
+}
+
+bool BlockCompressor::Decode(const std::uint8_t* blocks, size_t size, Format format,
+	std::uint32_t width, std::uint32_t height, TextureImage& image)
+{
+	PROFILE_FUNCTION();
+
+	if (width == 0 || height == 0 || size < LevelSize(format, width, height))
+		return false;
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	std::uint32_t blocksWide = BlocksAcross(width);
+	std::uint32_t blocksHigh = BlocksAcross(height);
+	std::uint32_t blockSize = BlockSize(format);
+
+	ThreadPool::Get().ParallelFor(blocksWide * blocksHigh, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		std::uint8_t rgba[64];
+
+		for (std::uint32_t b = begin; b < end; ++b)
+		{
+			const std::uint8_t* block = blocks + (size_t)b * blockSize;
+
+			switch (format)
+			{
+			case BC1:
+				DecodeColorBlock(block, false, rgba);
+				break;
+			case BC3:
+				DecodeColorBlock(block + 8, true, rgba);
+				DecodeAlphaBlock(block, rgba);
+				break;
+			default:
+				DecodeBc7Block(block, rgba);
+				break;
+			}
+
+			StoreBlock(rgba, b % blocksWide, b / blocksWide, image);
+		}
+	});
+
+	return true;
+}
+
+double BlockCompressor::Psnr(const TextureImage& a, const TextureImage& b, bool alpha)
+{
+	if (a.Width != b.Width || a.Height != b.Height || a.Pixels.size() != b.Pixels.size())
+		return 0.0;
+
+	int channels = alpha ? 4 : 3;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < a.Pixels.size(); i += 4)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			double d = (double)a.Pixels[i + c] - b.Pixels[i + c];
+			sum += d * d;
+		}
+	}
+
+	if (sum == 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	double mse = sum / ((double)(a.Pixels.size() / 4) * channels);
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,472 @@
+#include "Broadphase.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Objects swept, and cells searched, per task.
+	const std::uint32_t SweepGrainSize = 1024;
+	const std::uint32_t CellGrainSize = 256;
+	const std::uint32_t GatherGrainSize = 8192;
+
+	// Re-sorting by insertion gives up past this many swaps per object
+	// and sorts from scratch, for when everything jumped at once.
+	const std::uint64_t MaxSwapsPerObject = 16;
+
+	// Cell coordinates are packed 21 bits apiece.
+	const std::int32_t CellBias = 1 << 20;
+	const std::uint64_t CellMask = (1 << 21) - 1;
+
+	bool PairLess(const BroadphasePair& a, const BroadphasePair& b)
+	{
+		return a.A < b.A || (a.A == b.A && a.B < b.B);
+	}
+
+	BroadphasePair MakePair(std::uint32_t a, std::uint32_t b)
+	{
+		BroadphasePair pair;
+		pair.A = std::min(a, b);
+		pair.B = std::max(a, b);
+		return pair;
+	}
+
+	// Joins the pairs the tasks found and puts them in order.
+	void MergePairs(std::vector<std::vector<BroadphasePair>>& taskPairs, std::vector<BroadphasePair>& pairs)
+	{
+		size_t count = 0;
+		for (const std::vector<BroadphasePair>& task : taskPairs)
+			count += task.size();
+
+		pairs.clear();
+		pairs.reserve(count);
+		for (const std::vector<BroadphasePair>& task : taskPairs)
+			pairs.insert(pairs.end(), task.begin(), task.end());
+
+		std::sort(pairs.begin(), pairs.end(), PairLess);
+	}
+
+	bool Overlaps(const BoxArrays& boxes, std::uint32_t a, std::uint32_t b)
+	{
+		return boxes.MinX[a] <= boxes.MaxX[b] && boxes.MinX[b] <= boxes.MaxX[a] &&
+			boxes.MinY[a] <= boxes.MaxY[b] && boxes.MinY[b] <= boxes.MaxY[a] &&
+			boxes.MinZ[a] <= boxes.MaxZ[b] && boxes.MinZ[b] <= boxes.MaxZ[a];
+	}
+
+	std::int32_t CellCoordinate(std::uint64_t key, int axis)
+	{
+		return (std::int32_t)((key >> (21 * axis)) & CellMask) - CellBias;
+	}
+
+	std::uint64_t CellKey(std::int32_t x, std::int32_t y, std::int32_t z)
+	{
+		return ((std::uint64_t)(x + CellBias) & CellMask) | (((std::uint64_t)(y + CellBias) & CellMask) << 21) |
+			(((std::uint64_t)(z + CellBias) & CellMask) << 42);
+	}
+
+	// Rows of cells along x hash to runs of slots, so looking up the
+	// neighbours of cells in order reads the table in order too.
+	std::uint32_t HashKey(std::uint64_t key, std::uint32_t tableMask)
+	{
+		std::uint64_t row = key >> 21;
+		return (std::uint32_t)(((row * 0x9e3779b97f4a7c15ull) >> 32) + (key & CellMask)) & tableMask;
+	}
+
+	// The 13 neighbours after a cell in z, y, x order; the other 13 see
+	// it as one of theirs.
+	const std::int32_t ForwardNeighbours[13][3] =
+	{
+		{ 1, 0, 0 },
+		{ -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+		{ -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+		{ -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+		{ -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 }
+	};
+}
+
+void BoxArrays::Resize(std::uint32_t count)
+{
+	MinX.resize(count);
+	MinY.resize(count);
+	MinZ.resize(count);
+	MaxX.resize(count);
+	MaxY.resize(count);
+	MaxZ.resize(count);
+}
+
+std::uint32_t BoxArrays::Size()const
+{
+	return (std::uint32_t)MinX.size();
+}
+
+void BoxArrays::Set(std::uint32_t i, FXMVECTOR min, FXMVECTOR max)
+{
+	MinX[i] = XMVectorGetX(min);
+	MinY[i] = XMVectorGetY(min);
+	MinZ[i] = XMVectorGetZ(min);
+	MaxX[i] = XMVectorGetX(max);
+	MaxY[i] = XMVectorGetY(max);
+	MaxZ[i] = XMVectorGetZ(max);
+}
+
+void SweepAndPrune::Update(const BoxArrays& boxes)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t count = boxes.Size();
+	const std::vector<float>* mins[3] = { &boxes.MinX, &boxes.MinY, &boxes.MinZ };
+	const std::vector<float>* maxs[3] = { &boxes.MaxX, &boxes.MaxY, &boxes.MaxZ };
+
+	auto less = [&](std::uint32_t a, std::uint32_t b)
+	{
+		float keyA = (*mins[mAxis])[a];
+		float keyB = (*mins[mAxis])[b];
+		return keyA < keyB || (keyA == keyB && a < b);
+	};
+
+	bool sorted = false;
+	if (mOrder.size() == count)
+	{
+		PROFILE_SCOPE("Insertion sort");
+
+		const std::vector<float>& keys = *mins[mAxis];
+		mKeys.resize(count);
+		ThreadPool::Get().ParallelFor(count, GatherGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				mKeys[i] = keys[mOrder[i]];
+		});
+
+		const std::uint64_t maxSwaps = MaxSwapsPerObject * count;
+		mSortSwaps = 0;
+		sorted = true;
+
+		for (std::uint32_t i = 1; i < count && sorted; ++i)
+		{
+			float key = mKeys[i];
+			std::uint32_t object = mOrder[i];
+			std::uint32_t j = i;
+
+			while (j > 0 && (mKeys[j - 1] > key || (mKeys[j - 1] == key && mOrder[j - 1] > object)))
+			{
+				mKeys[j] = mKeys[j - 1];
+				mOrder[j] = mOrder[j - 1];
+				--j;
+			}
+
+			mKeys[j] = key;
+			mOrder[j] = object;
+			mSortSwaps += i - j;
+			sorted = mSortSwaps <= maxSwaps;
+		}
+	}
+
+	if (!sorted)
+	{
+		PROFILE_SCOPE("Full sort");
+
+		// The axis is chosen again only for a new set of objects.
+		if (mOrder.size() != count)
+		{
+			double sums[3] = {};
+			double squares[3] = {};
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (std::uint32_t i = 0; i < count; ++i)
+				{
+					double center = 0.5 * ((*mins[axis])[i] + (*maxs[axis])[i]);
+					sums[axis] += center;
+					squares[axis] += center * center;
+				}
+			}
+
+			mAxis = 0;
+			for (int axis = 1; axis < 3; ++axis)
+			{
+				if (squares[axis] * count - sums[axis] * sums[axis] > squares[mAxis] * count - sums[mAxis] * sums[mAxis])
+					mAxis = axis;
+			}
+		}
+
+		mOrder.resize(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+			mOrder[i] = i;
+		std::sort(mOrder.begin(), mOrder.end(), less);
+	}
+
+	Gather(boxes);
+
+	// Each object against the ones after it until their spans along the
+	// axis start past its end.  The arrays are padded so four can always
+	// be loaded.
+	const std::uint32_t taskCount = (count + SweepGrainSize - 1) / SweepGrainSize;
+	std::vector<std::vector<BroadphasePair>> taskPairs(taskCount);
+
+	ThreadPool::Get().ParallelFor(taskCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		const float* minX = mSorted.MinX.data();
+		const float* minY = mSorted.MinY.data();
+		const float* minZ = mSorted.MinZ.data();
+		const float* maxX = mSorted.MaxX.data();
+		const float* maxY = mSorted.MaxY.data();
+		const float* maxZ = mSorted.MaxZ.data();
+
+		for (std::uint32_t task = begin; task < end; ++task)
+		{
+			std::vector<BroadphasePair>& pairs = taskPairs[task];
+			std::uint32_t last = std::min(count, (task + 1) * SweepGrainSize);
+
+			for (std::uint32_t i = task * SweepGrainSize; i < last; ++i)
+			{
+				XMVECTOR spanEnd = XMVectorReplicate(maxX[i]);
+				XMVECTOR lowY = XMVectorReplicate(minY[i]);
+				XMVECTOR highY = XMVectorReplicate(maxY[i]);
+				XMVECTOR lowZ = XMVectorReplicate(minZ[i]);
+				XMVECTOR highZ = XMVectorReplicate(maxZ[i]);
+
+				for (std::uint32_t j = i + 1; j < count && minX[j] <= maxX[i]; j += 4)
+				{
+					XMVECTOR overlap = XMVectorLessOrEqual(XMLoadFloat4((const XMFLOAT4*)&minX[j]), spanEnd);
+					overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMLoadFloat4((const XMFLOAT4*)&minY[j]), highY));
+					overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(XMLoadFloat4((const XMFLOAT4*)&maxY[j]), lowY));
+					overlap = XMVectorAndInt(overlap, XMVectorLessOrEqual(XMLoadFloat4((const XMFLOAT4*)&minZ[j]), highZ));
+					overlap = XMVectorAndInt(overlap, XMVectorGreaterOrEqual(XMLoadFloat4((const XMFLOAT4*)&maxZ[j]), lowZ));
+
+					if (XMVector4EqualInt(overlap, XMVectorZero()))
+						continue;
+
+					std::uint32_t lanes[4];
+					XMStoreInt4(lanes, overlap);
+					for (std::uint32_t lane = 0; lane < 4; ++lane)
+					{
+						if (lanes[lane] && j + lane < count)
+							pairs.push_back(MakePair(mOrder[i], mOrder[j + lane]));
+					}
+				}
+			}
+		}
+	});
+
+	MergePairs(taskPairs, mPairs);
+}
+
+void SweepAndPrune::Gather(const BoxArrays& boxes)
+{
+	PROFILE_FUNCTION();
+
+	// The sweep axis goes in X, and the other two after it in turn.
+	const std::vector<float>* mins[3] = { &boxes.MinX, &boxes.MinY, &boxes.MinZ };
+	const std::vector<float>* maxs[3] = { &boxes.MaxX, &boxes.MaxY, &boxes.MaxZ };
+	std::vector<float>* sortedMins[3] = { &mSorted.MinX, &mSorted.MinY, &mSorted.MinZ };
+	std::vector<float>* sortedMaxs[3] = { &mSorted.MaxX, &mSorted.MaxY, &mSorted.MaxZ };
+
+	const std::uint32_t count = (std::uint32_t)mOrder.size();
+	mSorted.Resize(count + 3);
+
+	for (int k = 0; k < 3; ++k)
+	{
+		int axis = (mAxis + k) % 3;
+		for (std::uint32_t pad = count; pad < count + 3; ++pad)
+		{
+			(*sortedMins[k])[pad] = FLT_MAX;
+			(*sortedMaxs[k])[pad] = -FLT_MAX;
+		}
+
+		ThreadPool::Get().ParallelFor(count, GatherGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+			{
+				(*sortedMins[k])[i] = (*mins[axis])[mOrder[i]];
+				(*sortedMaxs[k])[i] = (*maxs[axis])[mOrder[i]];
+			}
+		});
+	}
+}
+
+void SweepAndPrune::Clear()
+{
+	mOrder.clear();
+	mKeys.clear();
+	mSorted.Resize(0);
+	mPairs.clear();
+	mSortSwaps = 0;
+}
+
+const std::vector<BroadphasePair>& SweepAndPrune::Pairs()const
+{
+	return mPairs;
+}
+
+std::uint64_t SweepAndPrune::SortSwaps()const
+{
+	return mSortSwaps;
+}
+
+void HashGrid::Update(const BoxArrays& boxes)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t count = boxes.Size();
+
+	mCellSize = 0.0f;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		mCellSize = std::max(mCellSize, boxes.MaxX[i] - boxes.MinX[i]);
+		mCellSize = std::max(mCellSize, boxes.MaxY[i] - boxes.MinY[i]);
+		mCellSize = std::max(mCellSize, boxes.MaxZ[i] - boxes.MinZ[i]);
+	}
+	mCellSize = std::max(mCellSize, FLT_MIN);
+
+	// Each object in the cell of its center.
+	mEntries.resize(count);
+	float scale = 0.5f / mCellSize;
+
+	ThreadPool::Get().ParallelFor(count, GatherGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			std::int32_t x = (std::int32_t)std::floor((boxes.MinX[i] + boxes.MaxX[i]) * scale);
+			std::int32_t y = (std::int32_t)std::floor((boxes.MinY[i] + boxes.MaxY[i]) * scale);
+			std::int32_t z = (std::int32_t)std::floor((boxes.MinZ[i] + boxes.MaxZ[i]) * scale);
+			mEntries[i] = std::make_pair(CellKey(x, y, z), i);
+		}
+	});
+
+	{
+		PROFILE_SCOPE("Sort by cell");
+		std::sort(mEntries.begin(), mEntries.end());
+	}
+
+	// The boxes in cell order, so a cell's boxes are together and its
+	// neighbours' not far off.
+	mSorted.Resize(count);
+	ThreadPool::Get().ParallelFor(count, GatherGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			std::uint32_t object = mEntries[i].second;
+			mSorted.MinX[i] = boxes.MinX[object];
+			mSorted.MinY[i] = boxes.MinY[object];
+			mSorted.MinZ[i] = boxes.MinZ[object];
+			mSorted.MaxX[i] = boxes.MaxX[object];
+			mSorted.MaxY[i] = boxes.MaxY[object];
+			mSorted.MaxZ[i] = boxes.MaxZ[object];
+		}
+	});
+
+	mCells.clear();
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		std::uint64_t key = mEntries[i].first;
+		if (mCells.empty() || mCells.back().Key != key)
+		{
+			Cell cell = { key, i, 0 };
+			mCells.push_back(cell);
+		}
+		++mCells.back().Count;
+	}
+
+	std::uint32_t tableSize = 16;
+	while (tableSize < 2 * mCells.size())
+		tableSize *= 2;
+	Cell empty = { 0, 0, 0 };
+	mTable.assign(tableSize, empty);
+
+	for (const Cell& cell : mCells)
+	{
+		std::uint32_t slot = HashKey(cell.Key, tableSize - 1);
+		while (mTable[slot].Count != 0)
+			slot = (slot + 1) & (tableSize - 1);
+		mTable[slot] = cell;
+	}
+
+	const std::uint32_t cellCount = (std::uint32_t)mCells.size();
+	const std::uint32_t taskCount = (cellCount + CellGrainSize - 1) / CellGrainSize;
+	std::vector<std::vector<BroadphasePair>> taskPairs(taskCount);
+
+	ThreadPool::Get().ParallelFor(taskCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t task = begin; task < end; ++task)
+		{
+			std::vector<BroadphasePair>& pairs = taskPairs[task];
+			std::uint32_t last = std::min(cellCount, (task + 1) * CellGrainSize);
+
+			for (std::uint32_t c = task * CellGrainSize; c < last; ++c)
+			{
+				const Cell& cell = mCells[c];
+				std::uint32_t cellEnd = cell.First + cell.Count;
+
+				for (std::uint32_t i = cell.First; i < cellEnd; ++i)
+				{
+					for (std::uint32_t j = i + 1; j < cellEnd; ++j)
+					{
+						if (Overlaps(mSorted, i, j))
+							pairs.push_back(MakePair(mEntries[i].second, mEntries[j].second));
+					}
+				}
+
+				std::int32_t x = CellCoordinate(cell.Key, 0);
+				std::int32_t y = CellCoordinate(cell.Key, 1);
+				std::int32_t z = CellCoordinate(cell.Key, 2);
+
+				for (const std::int32_t* offset : ForwardNeighbours)
+				{
+					const Cell* neighbour = Find(CellKey(x + offset[0], y + offset[1], z + offset[2]));
+					if (!neighbour)
+						continue;
+
+					for (std::uint32_t i = cell.First; i < cellEnd; ++i)
+					{
+						for (std::uint32_t j = neighbour->First; j < neighbour->First + neighbour->Count; ++j)
+						{
+							if (Overlaps(mSorted, i, j))
+								pairs.push_back(MakePair(mEntries[i].second, mEntries[j].second));
+						}
+					}
+				}
+			}
+		}
+	});
+
+	MergePairs(taskPairs, mPairs);
+}
+
+const HashGrid::Cell* HashGrid::Find(std::uint64_t key)const
+{
+	std::uint32_t mask = (std::uint32_t)mTable.size() - 1;
+	for (std::uint32_t slot = HashKey(key, mask); mTable[slot].Count != 0; slot = (slot + 1) & mask)
+	{
+		if (mTable[slot].Key == key)
+			return &mTable[slot];
+	}
+	return nullptr;
+}
+
+void HashGrid::Clear()
+{
+	mCellSize = 0.0f;
+	mEntries.clear();
+	mSorted.Resize(0);
+	mCells.clear();
+	mTable.clear();
+	mPairs.clear();
+}
+
+const std::vector<BroadphasePair>& HashGrid::Pairs()const
+{
+	return mPairs;
+}
+
+float HashGrid::CellSize()const
+{
+	return mCellSize;
+}
+
+std::uint32_t HashGrid::CellCount()const
+{
+	return (std::uint32_t)mCells.size();
+}
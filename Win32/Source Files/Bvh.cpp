@@ -0,0 +1,900 @@
+#include "Bvh.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t BinCount = 16;
+	const std::uint32_t MaxLeafSize = 4;
+
+	// Past this depth splits are at the median, which bounds the depth at
+	// MedianDepth + 32.  Each level visited leaves at most three siblings
+	// on the stack.
+	const std::uint32_t MedianDepth = 48;
+	const std::uint32_t StackSize = 3 * (MedianDepth + 32) + 1;
+
+	// Ranges at least this big are split with their triangles binned on the
+	// thread pool; below it whole subtrees are built one per thread.
+	const std::uint32_t MinParallelSplit = 4096;
+	const std::uint32_t BinGrainSize = 4096;
+
+	// Triangles whose bounds and centroids are computed per task.
+	const std::uint32_t PrepareGrainSize = 1024;
+
+	struct Bounds
+	{
+		float Min[3];
+		float Max[3];
+
+		void Reset()
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				Min[a] = FLT_MAX;
+				Max[a] = -FLT_MAX;
+			}
+		}
+
+		void Grow(const float* p)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				Min[a] = std::min(Min[a], p[a]);
+				Max[a] = std::max(Max[a], p[a]);
+			}
+		}
+
+		void Grow(const Bounds& b)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				Min[a] = std::min(Min[a], b.Min[a]);
+				Max[a] = std::max(Max[a], b.Max[a]);
+			}
+		}
+
+		float HalfArea()const
+		{
+			float x = Max[0] - Min[0];
+			float y = Max[1] - Min[1];
+			float z = Max[2] - Min[2];
+			return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+		}
+	};
+
+	// A triangle as the build sees it.  These are what get partitioned,
+	// so every pass over a range reads memory in order.
+	struct Primitive
+	{
+		Bounds Box;
+		XMFLOAT3 Centroid;
+		std::uint32_t Triangle;
+	};
+
+	struct Bin
+	{
+		Bounds Box;
+		std::uint32_t Count;
+	};
+
+	// Everything one pass over a range gathers, so chunks done on different
+	// threads can be merged.
+	struct RangeStats
+	{
+		Bounds Box;
+		Bounds CentroidBox;
+		Bin Bins[3][BinCount];
+
+		void Reset()
+		{
+			Box.Reset();
+			CentroidBox.Reset();
+			for (int a = 0; a < 3; ++a)
+			{
+				for (std::uint32_t b = 0; b < BinCount; ++b)
+				{
+					Bins[a][b].Box.Reset();
+					Bins[a][b].Count = 0;
+				}
+			}
+		}
+	};
+
+	std::uint32_t BinIndex(float centroid, float min, float scale)
+	{
+		std::int32_t bin = (std::int32_t)((centroid - min) * scale);
+		return (std::uint32_t)std::min(std::max(bin, 0), (std::int32_t)BinCount - 1);
+	}
+
+	// The point of triangle (v0, v0 + e1, v0 + e2) nearest to p, as the
+	// weights of its second and third vertices, by the triangle's Voronoi
+	// regions (Ericson, Real-Time Collision Detection 5.1.5).
+	void NearestOnTriangle(const float* p, const float* v0, const float* e1, const float* e2, float& u, float& v)
+	{
+		float ap[3] = { p[0] - v0[0], p[1] - v0[1], p[2] - v0[2] };
+		float d1 = e1[0] * ap[0] + e1[1] * ap[1] + e1[2] * ap[2];
+		float d2 = e2[0] * ap[0] + e2[1] * ap[1] + e2[2] * ap[2];
+		float e11 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+		float e12 = e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2];
+		float e22 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+
+		// The same dot products from the other two vertices.
+		float d3 = d1 - e11;
+		float d4 = d2 - e12;
+		float d5 = d1 - e12;
+		float d6 = d2 - e22;
+
+		u = 0.0f;
+		v = 0.0f;
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return;
+
+		if (d3 >= 0.0f && d4 <= d3)
+		{
+			u = 1.0f;
+			return;
+		}
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			u = d1 / (d1 - d3);
+			return;
+		}
+
+		if (d6 >= 0.0f && d5 <= d6)
+		{
+			v = 1.0f;
+			return;
+		}
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			v = d2 / (d2 - d6);
+			return;
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		{
+			v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			u = 1.0f - v;
+			return;
+		}
+
+		// Inside the face; a triangle with no area has none.
+		float sum = va + vb + vc;
+		if (sum > 0.0f)
+		{
+			u = vb / sum;
+			v = vc / sum;
+		}
+	}
+
+	// Nudges zero components so their reciprocals are huge rather than
+	// infinite, keeping NaNs out of the slab tests.
+	float SafeReciprocal(float d)
+	{
+		const float tiny = 1e-20f;
+		return 1.0f / (std::fabs(d) > tiny ? d : std::copysign(tiny, d));
+	}
+}
+
+struct Bvh::BuildNode
+{
+	Bounds Box;
+	std::uint32_t Left;
+	std::uint32_t First;
+	std::uint32_t Count;
+	std::uint32_t Depth;
+};
+
+struct Bvh::BuildContext
+{
+	const std::uint8_t* Positions;
+	std::uint32_t PositionStride;
+	const std::uint32_t* Indices;
+
+	// Reordered so every node's triangles are a range.
+	std::vector<Primitive> Primitives;
+
+	// Children are allocated in pairs: Left and Left + 1.
+	std::vector<BuildNode> Nodes;
+	std::atomic<std::uint32_t> NodeCount;
+
+	const XMFLOAT3& Position(std::uint32_t vertex)const
+	{
+		return *(const XMFLOAT3*)(Positions + (size_t)vertex * PositionStride);
+	}
+
+	void Gather(std::uint32_t begin, std::uint32_t end, RangeStats& stats)const
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			stats.Box.Grow(Primitives[i].Box);
+			stats.CentroidBox.Grow(&Primitives[i].Centroid.x);
+		}
+	}
+
+	void BinRange(std::uint32_t begin, std::uint32_t end, const Bounds& centroidBox, RangeStats& stats)const
+	{
+		for (int a = 0; a < 3; ++a)
+		{
+			float extent = centroidBox.Max[a] - centroidBox.Min[a];
+			if (extent <= 0.0f)
+				continue;
+
+			float scale = BinCount / extent;
+			for (std::uint32_t i = begin; i < end; ++i)
+			{
+				const Primitive& primitive = Primitives[i];
+				Bin& bin = stats.Bins[a][BinIndex((&primitive.Centroid.x)[a], centroidBox.Min[a], scale)];
+				bin.Box.Grow(primitive.Box);
+				++bin.Count;
+			}
+		}
+	}
+
+	// Fills in the node's bounds and, unless it is small enough for a
+	// leaf, splits it.  Returns false for a leaf.
+	bool Split(std::uint32_t nodeIndex, bool parallel)
+	{
+		BuildNode& node = Nodes[nodeIndex];
+		std::uint32_t begin = node.First;
+		std::uint32_t end = node.First + node.Count;
+
+		RangeStats stats;
+		stats.Reset();
+
+		std::vector<RangeStats> chunks;
+		if (parallel)
+		{
+			chunks.resize((node.Count + BinGrainSize - 1) / BinGrainSize);
+			ThreadPool::Get().ParallelFor(node.Count, BinGrainSize, [&](std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+			{
+				RangeStats& chunk = chunks[chunkBegin / BinGrainSize];
+				chunk.Reset();
+				Gather(begin + chunkBegin, begin + chunkEnd, chunk);
+			});
+
+			for (const RangeStats& chunk : chunks)
+			{
+				stats.Box.Grow(chunk.Box);
+				stats.CentroidBox.Grow(chunk.CentroidBox);
+			}
+		}
+		else
+		{
+			Gather(begin, end, stats);
+		}
+
+		node.Box = stats.Box;
+		if (node.Count <= MaxLeafSize)
+			return false;
+
+		const Bounds& centroidBox = stats.CentroidBox;
+		int bestAxis = -1;
+		std::uint32_t bestSplit = 0;
+
+		if (node.Depth < MedianDepth)
+		{
+			if (parallel)
+			{
+				ThreadPool::Get().ParallelFor(node.Count, BinGrainSize, [&](std::uint32_t chunkBegin, std::uint32_t chunkEnd)
+				{
+					BinRange(begin + chunkBegin, begin + chunkEnd, centroidBox, chunks[chunkBegin / BinGrainSize]);
+				});
+
+				for (const RangeStats& chunk : chunks)
+				{
+					for (int a = 0; a < 3; ++a)
+					{
+						for (std::uint32_t b = 0; b < BinCount; ++b)
+						{
+							stats.Bins[a][b].Box.Grow(chunk.Bins[a][b].Box);
+							stats.Bins[a][b].Count += chunk.Bins[a][b].Count;
+						}
+					}
+				}
+			}
+			else
+			{
+				BinRange(begin, end, centroidBox, stats);
+			}
+
+			// Cost of each plane between bins: area times triangle count on
+			// either side, swept in from both ends.
+			float bestCost = FLT_MAX;
+
+			for (int a = 0; a < 3; ++a)
+			{
+				if (centroidBox.Max[a] - centroidBox.Min[a] <= 0.0f)
+					continue;
+
+				const Bin* bins = stats.Bins[a];
+				float rightCosts[BinCount];
+				Bounds box;
+				box.Reset();
+				std::uint32_t count = 0;
+
+				for (std::uint32_t b = BinCount - 1; b > 0; --b)
+				{
+					box.Grow(bins[b].Box);
+					count += bins[b].Count;
+					rightCosts[b] = box.HalfArea() * count;
+				}
+
+				box.Reset();
+				count = 0;
+
+				for (std::uint32_t b = 0; b + 1 < BinCount; ++b)
+				{
+					box.Grow(bins[b].Box);
+					count += bins[b].Count;
+
+					float cost = box.HalfArea() * count + rightCosts[b + 1];
+					if (count > 0 && count < node.Count && cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = a;
+						bestSplit = b + 1;
+					}
+				}
+			}
+		}
+
+		Primitive* primitives = Primitives.data();
+		std::uint32_t middle;
+
+		if (bestAxis >= 0)
+		{
+			float min = centroidBox.Min[bestAxis];
+			float scale = BinCount / (centroidBox.Max[bestAxis] - min);
+			middle = (std::uint32_t)(std::partition(primitives + begin, primitives + end, [&](const Primitive& primitive)
+			{
+				return BinIndex((&primitive.Centroid.x)[bestAxis], min, scale) < bestSplit;
+			}) - primitives);
+		}
+		else
+		{
+			// Too deep, or every centroid in one spot: halve along the
+			// longest axis.
+			int axis = 0;
+			for (int a = 1; a < 3; ++a)
+			{
+				if (centroidBox.Max[a] - centroidBox.Min[a] > centroidBox.Max[axis] - centroidBox.Min[axis])
+					axis = a;
+			}
+
+			middle = begin + node.Count / 2;
+			std::nth_element(primitives + begin, primitives + middle, primitives + end, [&](const Primitive& a, const Primitive& b)
+			{
+				return (&a.Centroid.x)[axis] < (&b.Centroid.x)[axis];
+			});
+		}
+
+		std::uint32_t left = NodeCount.fetch_add(2, std::memory_order_relaxed);
+		Nodes[left].First = begin;
+		Nodes[left].Count = middle - begin;
+		Nodes[left].Depth = node.Depth + 1;
+		Nodes[left + 1].First = middle;
+		Nodes[left + 1].Count = end - middle;
+		Nodes[left + 1].Depth = node.Depth + 1;
+
+		node.Left = left;
+		node.Count = 0;
+		return true;
+	}
+
+	void BuildSubtree(std::uint32_t root)
+	{
+		std::vector<std::uint32_t> stack(1, root);
+		while (!stack.empty())
+		{
+			std::uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+
+			if (Split(nodeIndex, false))
+			{
+				stack.push_back(Nodes[nodeIndex].Left);
+				stack.push_back(Nodes[nodeIndex].Left + 1);
+			}
+		}
+	}
+};
+
+void Bvh::Build(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices, std::uint32_t triangleCount)
+{
+	PROFILE_FUNCTION();
+
+	Clear();
+	if (triangleCount == 0)
+		return;
+
+	BuildContext context;
+	context.Positions = (const std::uint8_t*)positions;
+	context.PositionStride = positionStride;
+	context.Indices = indices;
+	context.Primitives.resize(triangleCount);
+
+	ThreadPool::Get().ParallelFor(triangleCount, PrepareGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			Primitive& primitive = context.Primitives[i];
+			Bounds& box = primitive.Box;
+			box.Reset();
+			for (int v = 0; v < 3; ++v)
+				box.Grow(&context.Position(indices[3 * i + v]).x);
+
+			primitive.Centroid = XMFLOAT3(0.5f * (box.Min[0] + box.Max[0]), 0.5f * (box.Min[1] + box.Max[1]),
+				0.5f * (box.Min[2] + box.Max[2]));
+			primitive.Triangle = i;
+		}
+	});
+
+	// A binary tree over n triangles has at most 2n - 1 nodes.
+	context.Nodes.resize(2 * (size_t)triangleCount);
+	context.Nodes[0].First = 0;
+	context.Nodes[0].Count = triangleCount;
+	context.Nodes[0].Depth = 0;
+	context.NodeCount = 1;
+
+	// Split the big ranges one at a time with every thread binning, until
+	// there are enough subtrees to go round.
+	std::uint32_t parallelSplit = std::max(MinParallelSplit, triangleCount / (4 * ThreadPool::Get().ThreadCount()));
+	std::vector<std::uint32_t> pending(1, 0);
+	std::vector<std::uint32_t> subtrees;
+
+	{
+		PROFILE_SCOPE("BVH Top Splits");
+
+		while (!pending.empty())
+		{
+			std::uint32_t nodeIndex = pending.back();
+			pending.pop_back();
+
+			if (context.Nodes[nodeIndex].Count < parallelSplit)
+			{
+				subtrees.push_back(nodeIndex);
+			}
+			else if (context.Split(nodeIndex, true))
+			{
+				pending.push_back(context.Nodes[nodeIndex].Left);
+				pending.push_back(context.Nodes[nodeIndex].Left + 1);
+			}
+		}
+	}
+
+	{
+		PROFILE_SCOPE("BVH Subtrees");
+
+		ThreadPool::Get().ParallelFor((std::uint32_t)subtrees.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				context.BuildSubtree(subtrees[i]);
+		});
+	}
+
+	PROFILE_SCOPE("BVH Collapse");
+
+	mTriangleCount = triangleCount;
+	mNodes.reserve(context.NodeCount / 3 + 1);
+	mPackets.reserve(triangleCount / 2 + 1);
+
+	if (context.Nodes[0].Count > 0)
+	{
+		// One leaf: the root still has to be a node.
+		mNodes.resize(1);
+		std::uint32_t leaf = Collapse(context, 0);
+
+		Node& root = mNodes[0];
+		float* lanes = &root.MinX.x;
+		std::fill(lanes, lanes + 3 * 4, FLT_MAX);
+		std::fill(lanes + 3 * 4, lanes + 6 * 4, -FLT_MAX);
+		for (int c = 0; c < 4; ++c)
+			root.Children[c] = EmptyChild;
+
+		const Bounds& box = context.Nodes[0].Box;
+		root.MinX.x = box.Min[0];
+		root.MinY.x = box.Min[1];
+		root.MinZ.x = box.Min[2];
+		root.MaxX.x = box.Max[0];
+		root.MaxY.x = box.Max[1];
+		root.MaxZ.x = box.Max[2];
+		root.Children[0] = leaf;
+	}
+	else
+	{
+		Collapse(context, 0);
+	}
+}
+
+std::uint32_t Bvh::Collapse(const BuildContext& context, std::uint32_t buildNode)
+{
+	const BuildNode& node = context.Nodes[buildNode];
+
+	if (node.Count > 0)
+	{
+		TrianglePacket packet;
+		float* lanes = &packet.V0X.x;
+		std::fill(lanes, lanes + 9 * 4, 0.0f);
+
+		for (std::uint32_t i = 0; i < 4; ++i)
+		{
+			if (i >= node.Count)
+			{
+				packet.Triangles[i] = EmptyChild;
+				continue;
+			}
+
+			std::uint32_t triangle = context.Primitives[node.First + i].Triangle;
+			const std::uint32_t* indices = context.Indices + 3 * triangle;
+			const XMFLOAT3& p0 = context.Position(indices[0]);
+			const XMFLOAT3& p1 = context.Position(indices[1]);
+			const XMFLOAT3& p2 = context.Position(indices[2]);
+
+			(&packet.V0X.x)[i] = p0.x;
+			(&packet.V0Y.x)[i] = p0.y;
+			(&packet.V0Z.x)[i] = p0.z;
+			(&packet.E1X.x)[i] = p1.x - p0.x;
+			(&packet.E1Y.x)[i] = p1.y - p0.y;
+			(&packet.E1Z.x)[i] = p1.z - p0.z;
+			(&packet.E2X.x)[i] = p2.x - p0.x;
+			(&packet.E2Y.x)[i] = p2.y - p0.y;
+			(&packet.E2Z.x)[i] = p2.z - p0.z;
+			packet.Triangles[i] = triangle;
+		}
+
+		mPackets.push_back(packet);
+		return LeafBit | (std::uint32_t)(mPackets.size() - 1);
+	}
+
+	// Pull grandchildren up until there are four children, opening the
+	// biggest inner child first.
+	std::uint32_t children[4] = { node.Left, node.Left + 1 };
+	std::uint32_t childCount = 2;
+
+	while (childCount < 4)
+	{
+		int widest = -1;
+		float widestArea = -1.0f;
+
+		for (std::uint32_t c = 0; c < childCount; ++c)
+		{
+			const BuildNode& child = context.Nodes[children[c]];
+			if (child.Count == 0 && child.Box.HalfArea() > widestArea)
+			{
+				widest = (int)c;
+				widestArea = child.Box.HalfArea();
+			}
+		}
+
+		if (widest < 0)
+			break;
+
+		std::uint32_t opened = children[widest];
+		children[widest] = context.Nodes[opened].Left;
+		children[childCount++] = context.Nodes[opened].Left + 1;
+	}
+
+	std::uint32_t index = (std::uint32_t)mNodes.size();
+	mNodes.resize(index + 1);
+
+	// Inside-out bounds for the empty slots.
+	float* lanes = &mNodes[index].MinX.x;
+	std::fill(lanes, lanes + 3 * 4, FLT_MAX);
+	std::fill(lanes + 3 * 4, lanes + 6 * 4, -FLT_MAX);
+
+	for (std::uint32_t c = 0; c < 4; ++c)
+	{
+		if (c >= childCount)
+		{
+			mNodes[index].Children[c] = EmptyChild;
+			continue;
+		}
+
+		// Collapsing the child can grow mNodes, so the node is looked up
+		// again afterwards.
+		std::uint32_t child = Collapse(context, children[c]);
+
+		Node& result = mNodes[index];
+		const Bounds& box = context.Nodes[children[c]].Box;
+		(&result.MinX.x)[c] = box.Min[0];
+		(&result.MinY.x)[c] = box.Min[1];
+		(&result.MinZ.x)[c] = box.Min[2];
+		(&result.MaxX.x)[c] = box.Max[0];
+		(&result.MaxY.x)[c] = box.Max[1];
+		(&result.MaxZ.x)[c] = box.Max[2];
+		result.Children[c] = child;
+	}
+
+	return index;
+}
+
+void Bvh::Clear()
+{
+	mNodes.clear();
+	mPackets.clear();
+	mTriangleCount = 0;
+}
+
+bool Bvh::Intersect(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, BvhHit& hit)const
+{
+	return Traverse<false>(origin, direction, maxDistance, hit);
+}
+
+bool Bvh::Occluded(FXMVECTOR origin, FXMVECTOR direction, float maxDistance)const
+{
+	BvhHit hit;
+	return Traverse<true>(origin, direction, maxDistance, hit);
+}
+
+bool Bvh::Nearest(FXMVECTOR point, float maxDistance, BvhHit& nearest)const
+{
+	if (mNodes.empty())
+		return false;
+
+	float p[3] = { XMVectorGetX(point), XMVectorGetY(point), XMVectorGetZ(point) };
+	XMVECTOR px = XMVectorSplatX(point);
+	XMVECTOR py = XMVectorSplatY(point);
+	XMVECTOR pz = XMVectorSplatZ(point);
+	XMVECTOR zero = XMVectorZero();
+
+	float closest = maxDistance * maxDistance;
+	bool found = false;
+
+	// Squared distances to the entries' bounds come along, so entries the
+	// search has since got closer than are dropped unopened.
+	std::uint32_t stack[StackSize];
+	float stackDistances[StackSize];
+	std::uint32_t top = 0;
+	stack[top] = 0;
+	stackDistances[top++] = 0.0f;
+
+	while (top > 0)
+	{
+		--top;
+		std::uint32_t next = stack[top];
+		if (stackDistances[top] >= closest)
+			continue;
+
+		if (next & LeafBit)
+		{
+			const TrianglePacket& packet = mPackets[next & ~LeafBit];
+
+			for (int i = 0; i < 4; ++i)
+			{
+				if (packet.Triangles[i] == EmptyChild)
+					continue;
+
+				float v0[3] = { (&packet.V0X.x)[i], (&packet.V0Y.x)[i], (&packet.V0Z.x)[i] };
+				float e1[3] = { (&packet.E1X.x)[i], (&packet.E1Y.x)[i], (&packet.E1Z.x)[i] };
+				float e2[3] = { (&packet.E2X.x)[i], (&packet.E2Y.x)[i], (&packet.E2Z.x)[i] };
+
+				float u, v;
+				NearestOnTriangle(p, v0, e1, e2, u, v);
+
+				float distance = 0.0f;
+				for (int a = 0; a < 3; ++a)
+				{
+					float d = v0[a] + u * e1[a] + v * e2[a] - p[a];
+					distance += d * d;
+				}
+
+				if (distance >= closest)
+					continue;
+
+				closest = distance;
+				found = true;
+				nearest.Triangle = packet.Triangles[i];
+				nearest.U = u;
+				nearest.V = v;
+			}
+
+			continue;
+		}
+
+		// Distance to the four children's bounds at once.
+		const Node& node = mNodes[next];
+
+		XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4A(&node.MinX), px), XMVectorSubtract(px, XMLoadFloat4A(&node.MaxX))), zero);
+		XMVECTOR dy = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4A(&node.MinY), py), XMVectorSubtract(py, XMLoadFloat4A(&node.MaxY))), zero);
+		XMVECTOR dz = XMVectorMax(XMVectorMax(XMVectorSubtract(XMLoadFloat4A(&node.MinZ), pz), XMVectorSubtract(pz, XMLoadFloat4A(&node.MaxZ))), zero);
+
+		XMFLOAT4A distances;
+		XMStoreFloat4A(&distances, XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+
+		// Nearest child on top of the stack, as for rays.
+		std::uint32_t hits[4];
+		float hitDistances[4];
+		std::uint32_t hitCount = 0;
+
+		for (std::uint32_t c = 0; c < 4; ++c)
+		{
+			float distance = (&distances.x)[c];
+			if (node.Children[c] == EmptyChild || distance >= closest)
+				continue;
+
+			std::uint32_t slot = hitCount++;
+			while (slot > 0 && hitDistances[slot - 1] < distance)
+			{
+				hits[slot] = hits[slot - 1];
+				hitDistances[slot] = hitDistances[slot - 1];
+				--slot;
+			}
+			hits[slot] = node.Children[c];
+			hitDistances[slot] = distance;
+		}
+
+		for (std::uint32_t c = 0; c < hitCount; ++c)
+		{
+			stack[top] = hits[c];
+			stackDistances[top++] = hitDistances[c];
+		}
+	}
+
+	if (found)
+		nearest.Distance = std::sqrt(closest);
+	return found;
+}
+
+template <bool AnyHit>
+bool Bvh::Traverse(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, BvhHit& hit)const
+{
+	if (mNodes.empty())
+		return false;
+
+	XMVECTOR ox = XMVectorSplatX(origin);
+	XMVECTOR oy = XMVectorSplatY(origin);
+	XMVECTOR oz = XMVectorSplatZ(origin);
+	XMVECTOR dx = XMVectorSplatX(direction);
+	XMVECTOR dy = XMVectorSplatY(direction);
+	XMVECTOR dz = XMVectorSplatZ(direction);
+	XMVECTOR idx = XMVectorReplicate(SafeReciprocal(XMVectorGetX(direction)));
+	XMVECTOR idy = XMVectorReplicate(SafeReciprocal(XMVectorGetY(direction)));
+	XMVECTOR idz = XMVectorReplicate(SafeReciprocal(XMVectorGetZ(direction)));
+
+	float closest = maxDistance;
+	bool found = false;
+
+	std::uint32_t stack[StackSize];
+	std::uint32_t top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		std::uint32_t next = stack[--top];
+
+		if (next & LeafBit)
+		{
+			const TrianglePacket& packet = mPackets[next & ~LeafBit];
+
+			// Moller-Trumbore on all four lanes.
+			XMVECTOR e1x = XMLoadFloat4A(&packet.E1X);
+			XMVECTOR e1y = XMLoadFloat4A(&packet.E1Y);
+			XMVECTOR e1z = XMLoadFloat4A(&packet.E1Z);
+			XMVECTOR e2x = XMLoadFloat4A(&packet.E2X);
+			XMVECTOR e2y = XMLoadFloat4A(&packet.E2Y);
+			XMVECTOR e2z = XMLoadFloat4A(&packet.E2Z);
+
+			XMVECTOR px = XMVectorSubtract(XMVectorMultiply(dy, e2z), XMVectorMultiply(dz, e2y));
+			XMVECTOR py = XMVectorSubtract(XMVectorMultiply(dz, e2x), XMVectorMultiply(dx, e2z));
+			XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(dx, e2y), XMVectorMultiply(dy, e2x));
+			XMVECTOR det = XMVectorMultiplyAdd(e1x, px, XMVectorMultiplyAdd(e1y, py, XMVectorMultiply(e1z, pz)));
+
+			XMVECTOR tx = XMVectorSubtract(ox, XMLoadFloat4A(&packet.V0X));
+			XMVECTOR ty = XMVectorSubtract(oy, XMLoadFloat4A(&packet.V0Y));
+			XMVECTOR tz = XMVectorSubtract(oz, XMLoadFloat4A(&packet.V0Z));
+			XMVECTOR u = XMVectorMultiplyAdd(tx, px, XMVectorMultiplyAdd(ty, py, XMVectorMultiply(tz, pz)));
+
+			XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(ty, e1z), XMVectorMultiply(tz, e1y));
+			XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(tz, e1x), XMVectorMultiply(tx, e1z));
+			XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(tx, e1y), XMVectorMultiply(ty, e1x));
+			XMVECTOR v = XMVectorMultiplyAdd(dx, qx, XMVectorMultiplyAdd(dy, qy, XMVectorMultiply(dz, qz)));
+			XMVECTOR t = XMVectorMultiplyAdd(e2x, qx, XMVectorMultiplyAdd(e2y, qy, XMVectorMultiply(e2z, qz)));
+
+			XMVECTOR invDet = XMVectorReciprocal(det);
+			XMFLOAT4A dets, us, vs, ts;
+			XMStoreFloat4A(&dets, det);
+			XMStoreFloat4A(&us, XMVectorMultiply(u, invDet));
+			XMStoreFloat4A(&vs, XMVectorMultiply(v, invDet));
+			XMStoreFloat4A(&ts, XMVectorMultiply(t, invDet));
+
+			for (int i = 0; i < 4; ++i)
+			{
+				float laneU = (&us.x)[i];
+				float laneV = (&vs.x)[i];
+				float laneT = (&ts.x)[i];
+
+				if ((&dets.x)[i] == 0.0f || !(laneU >= 0.0f && laneV >= 0.0f && laneU + laneV <= 1.0f && laneT >= 0.0f && laneT < closest))
+					continue;
+
+				closest = laneT;
+				found = true;
+				hit.Distance = laneT;
+				hit.Triangle = packet.Triangles[i];
+				hit.U = laneU;
+				hit.V = laneV;
+
+				if (AnyHit)
+					return true;
+			}
+
+			continue;
+		}
+
+		// Slab test against the four children at once.
+		const Node& node = mNodes[next];
+
+		XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinX), ox), idx);
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxX), ox), idx);
+		XMVECTOR tNear = XMVectorMin(t0, t1);
+		XMVECTOR tFar = XMVectorMax(t0, t1);
+
+		t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinY), oy), idy);
+		t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxY), oy), idy);
+		tNear = XMVectorMax(tNear, XMVectorMin(t0, t1));
+		tFar = XMVectorMin(tFar, XMVectorMax(t0, t1));
+
+		t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MinZ), oz), idz);
+		t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4A(&node.MaxZ), oz), idz);
+		tNear = XMVectorMax(tNear, XMVectorMin(t0, t1));
+		tFar = XMVectorMin(tFar, XMVectorMax(t0, t1));
+
+		XMFLOAT4A nears, fars;
+		XMStoreFloat4A(&nears, tNear);
+		XMStoreFloat4A(&fars, tFar);
+
+		// Nearest child on top of the stack, so it is visited first and
+		// shortens the ray for the rest.
+		std::uint32_t hits[4];
+		float hitNears[4];
+		std::uint32_t hitCount = 0;
+
+		for (std::uint32_t c = 0; c < 4; ++c)
+		{
+			float laneNear = std::max((&nears.x)[c], 0.0f);
+			float laneFar = std::min((&fars.x)[c], closest);
+			if (node.Children[c] == EmptyChild || laneNear > laneFar)
+				continue;
+
+			std::uint32_t slot = hitCount++;
+			while (slot > 0 && hitNears[slot - 1] < laneNear)
+			{
+				hits[slot] = hits[slot - 1];
+				hitNears[slot] = hitNears[slot - 1];
+				--slot;
+			}
+			hits[slot] = node.Children[c];
+			hitNears[slot] = laneNear;
+		}
+
+		for (std::uint32_t c = 0; c < hitCount; ++c)
+			stack[top++] = hits[c];
+	}
+
+	return found;
+}
+
+std::uint32_t Bvh::TriangleCount()const
+{
+	return mTriangleCount;
+}
+
+std::uint32_t Bvh::NodeCount()const
+{
+	return (std::uint32_t)mNodes.size();
+}
+
+size_t Bvh::SizeInBytes()const
+{
+	return mNodes.size() * sizeof(Node) + mPackets.size() * sizeof(TrianglePacket);
+}
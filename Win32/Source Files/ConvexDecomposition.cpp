@@ -0,0 +1,275 @@
+#include "ConvexDecomposition.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "VoxelOctree.h"
+#include <algorithm>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Cutting planes tried along each axis of a piece.
+	const std::uint32_t CutsPerAxis = 8;
+}
+
+struct ConvexDecomposition::Piece
+{
+	// Voxels, inclusive.
+	std::uint32_t Min[3];
+	std::uint32_t Max[3];
+
+	std::uint64_t VoxelCount;
+	ConvexHull Hull;
+	float Concavity;
+
+	// No cut leaves voxels on both sides.
+	bool Final;
+};
+
+struct ConvexDecomposition::BuildContext
+{
+	// Set voxels, x fastest.
+	std::vector<std::uint8_t> Voxels;
+	std::uint32_t Resolution;
+	float VoxelSize;
+	XMFLOAT3 Origin;
+
+	// The whole mesh's, in voxels.
+	double Volume;
+};
+
+void ConvexDecomposition::Build(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, std::uint32_t resolution, std::uint32_t maxHulls, float maxConcavity,
+	std::uint32_t maxHullVertices)
+{
+	PROFILE_FUNCTION();
+
+	Clear();
+
+	VoxelOctree octree;
+	octree.Build(positions, positionStride, indices, triangleCount, resolution, true);
+	if (octree.VoxelCount() == 0)
+		return;
+
+	BuildContext context;
+	context.Resolution = octree.Resolution();
+	context.VoxelSize = octree.VoxelSize();
+	context.Origin = octree.Origin();
+	context.Volume = (double)octree.VoxelCount();
+
+	// Cuts look at every voxel of a piece many times over, too often to
+	// walk the octree for each.
+	const std::uint32_t r = context.Resolution;
+	context.Voxels.resize((size_t)r * r * r);
+
+	ThreadPool::Get().ParallelFor(r, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t z = begin; z < end; ++z)
+			for (std::uint32_t y = 0; y < r; ++y)
+				for (std::uint32_t x = 0; x < r; ++x)
+					context.Voxels[x + r * (y + (size_t)r * z)] = octree.Occupied(x, y, z) ? 1 : 0;
+	});
+
+	std::vector<Piece> pieces(1);
+	for (int k = 0; k < 3; ++k)
+	{
+		pieces[0].Min[k] = 0;
+		pieces[0].Max[k] = r - 1;
+	}
+	pieces[0].Final = false;
+	Measure(context, pieces[0], 0);
+
+	if (maxHulls == 0)
+		maxHulls = 1;
+
+	struct Cut
+	{
+		Piece Sides[2];
+		bool Valid;
+	};
+
+	std::vector<Cut> cuts;
+
+	while (pieces.size() < maxHulls)
+	{
+		// The most concave piece left, the first of equals.
+		std::uint32_t worst = 0;
+		for (std::uint32_t i = 1; i < (std::uint32_t)pieces.size(); ++i)
+		{
+			if (!pieces[i].Final && (pieces[worst].Final || pieces[i].Concavity > pieces[worst].Concavity))
+				worst = i;
+		}
+
+		if (pieces[worst].Final || pieces[worst].Concavity <= maxConcavity)
+			break;
+
+		const Piece& piece = pieces[worst];
+
+		// Evenly spaced planes between voxels, the lower side keeping
+		// voxels below the plane.
+		std::vector<std::pair<int, std::uint32_t>> planes;
+		for (int k = 0; k < 3; ++k)
+		{
+			std::uint32_t span = piece.Max[k] - piece.Min[k];
+			std::uint32_t count = span < CutsPerAxis ? span : CutsPerAxis;
+			for (std::uint32_t i = 1; i <= count; ++i)
+				planes.push_back(std::make_pair(k, piece.Min[k] + (std::uint32_t)((std::uint64_t)span * i / (count + 1)) + 1));
+		}
+
+		cuts.resize(planes.size());
+
+		ThreadPool::Get().ParallelFor((std::uint32_t)planes.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+			{
+				Cut& cut = cuts[i];
+				const int axis = planes[i].first;
+
+				for (int side = 0; side < 2; ++side)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						cut.Sides[side].Min[k] = piece.Min[k];
+						cut.Sides[side].Max[k] = piece.Max[k];
+					}
+					cut.Sides[side].Final = false;
+				}
+				cut.Sides[0].Max[axis] = planes[i].second - 1;
+				cut.Sides[1].Min[axis] = planes[i].second;
+
+				cut.Valid = Measure(context, cut.Sides[0], 0) && Measure(context, cut.Sides[1], 0);
+			}
+		});
+
+		std::uint32_t best = 0;
+		bool found = false;
+		for (std::uint32_t i = 0; i < (std::uint32_t)cuts.size(); ++i)
+		{
+			if (!cuts[i].Valid)
+				continue;
+
+			float concavity = cuts[i].Sides[0].Concavity + cuts[i].Sides[1].Concavity;
+			if (!found || concavity < cuts[best].Sides[0].Concavity + cuts[best].Sides[1].Concavity)
+			{
+				best = i;
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			pieces[worst].Final = true;
+			continue;
+		}
+
+		pieces[worst] = std::move(cuts[best].Sides[0]);
+		pieces.push_back(std::move(cuts[best].Sides[1]));
+	}
+
+	for (const Piece& piece : pieces)
+		mConcavity = std::max(mConcavity, piece.Concavity);
+
+	// The hulls again under the vertex budget, which measuring left out so
+	// cuts were judged on the whole hull.
+	if (maxHullVertices != 0)
+	{
+		ThreadPool::Get().ParallelFor((std::uint32_t)pieces.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t i = begin; i < end; ++i)
+				Measure(context, pieces[i], maxHullVertices);
+		});
+	}
+
+	mHulls.reserve(pieces.size());
+	for (Piece& piece : pieces)
+		mHulls.push_back(std::move(piece.Hull));
+}
+
+bool ConvexDecomposition::Measure(const BuildContext& context, Piece& piece, std::uint32_t maxVertices)
+{
+	const std::uint32_t r = context.Resolution;
+	const std::uint8_t* voxels = context.Voxels.data();
+
+	std::uint32_t lo[3] = { r, r, r };
+	std::uint32_t hi[3] = { 0, 0, 0 };
+	std::uint64_t count = 0;
+
+	// The first and last set voxel of each row along x; the corners on
+	// their outer faces hold the hull of the whole row.
+	std::vector<XMFLOAT3> points;
+
+	for (std::uint32_t z = piece.Min[2]; z <= piece.Max[2]; ++z)
+	{
+		for (std::uint32_t y = piece.Min[1]; y <= piece.Max[1]; ++y)
+		{
+			const std::uint8_t* row = voxels + r * (y + (size_t)r * z);
+
+			std::uint32_t first = piece.Max[0] + 1;
+			std::uint32_t last = 0;
+			for (std::uint32_t x = piece.Min[0]; x <= piece.Max[0]; ++x)
+			{
+				if (row[x])
+				{
+					first = std::min(first, x);
+					last = x;
+					++count;
+				}
+			}
+
+			if (first > piece.Max[0])
+				continue;
+
+			lo[0] = std::min(lo[0], first);
+			hi[0] = std::max(hi[0], last);
+			lo[1] = std::min(lo[1], y);
+			hi[1] = std::max(hi[1], y);
+			lo[2] = std::min(lo[2], z);
+			hi[2] = std::max(hi[2], z);
+
+			for (std::uint32_t corner = 0; corner < 8; ++corner)
+			{
+				float x = (float)((corner & 1) ? last + 1 : first);
+				float cy = (float)(y + ((corner >> 1) & 1));
+				float cz = (float)(z + ((corner >> 2) & 1));
+				points.push_back(XMFLOAT3(context.Origin.x + x * context.VoxelSize, context.Origin.y + cy * context.VoxelSize,
+					context.Origin.z + cz * context.VoxelSize));
+			}
+		}
+	}
+
+	if (count == 0)
+		return false;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		piece.Min[k] = lo[k];
+		piece.Max[k] = hi[k];
+	}
+
+	piece.VoxelCount = count;
+	piece.Hull.Build(points.data(), (std::uint32_t)sizeof(XMFLOAT3), (std::uint32_t)points.size(), maxVertices);
+
+	if (maxVertices == 0)
+	{
+		double voxelVolume = (double)context.VoxelSize * context.VoxelSize * context.VoxelSize;
+		piece.Concavity = (float)std::max((piece.Hull.Volume() / voxelVolume - (double)count) / context.Volume, 0.0);
+	}
+	return true;
+}
+
+void ConvexDecomposition::Clear()
+{
+	mHulls.clear();
+	mConcavity = 0.0f;
+}
+
+const std::vector<ConvexHull>& ConvexDecomposition::Hulls()const
+{
+	return mHulls;
+}
+
+float ConvexDecomposition::Concavity()const
+{
+	return mConcavity;
+}
@@ -0,0 +1,729 @@
+#include "ConvexHull.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Points per task when giving them to faces.  Smaller lists, which is
+	// nearly all of them after the first pass, take no tasks.
+	const std::uint32_t AssignGrainSize = 16384;
+
+	const std::uint32_t NoVertex = 0xffffffff;
+
+	// A face to take the furthest point of, as it was when queued.
+	struct Candidate
+	{
+		float Distance;
+		std::uint32_t Face;
+		std::uint32_t Stamp;
+
+		bool operator<(const Candidate& other)const
+		{
+			return Distance < other.Distance || (Distance == other.Distance && Face > other.Face);
+		}
+	};
+
+	// A visible face on the depth first walk, with the edges left to cross.
+	struct Visit
+	{
+		std::uint32_t Face;
+		std::uint32_t Edge;
+		std::uint32_t Left;
+	};
+
+	struct HorizonEdge
+	{
+		std::uint32_t From;
+		std::uint32_t To;
+
+		// The face beyond it, which stays.
+		std::uint32_t Neighbour;
+	};
+
+	// A face's corners and plane, for planes of faces not yet made.
+	struct Triangle
+	{
+		std::uint32_t V[3];
+		XMFLOAT3 Normal;
+		float Offset;
+	};
+
+	float Squared(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		float x = b.x - a.x;
+		float y = b.y - a.y;
+		float z = b.z - a.z;
+		return x * x + y * y + z * z;
+	}
+}
+
+struct ConvexHull::Face
+{
+	std::uint32_t V[3];
+
+	// The face across the edge from V[i] to V[i + 1].
+	std::uint32_t Adjacent[3];
+
+	XMFLOAT3 Normal;
+	float Offset;
+
+	// Points outside the face and not outside any face before it, linked
+	// through BuildContext::Next, and the furthest out of them.
+	std::uint32_t FirstOutside;
+	std::uint32_t LastOutside;
+	std::uint32_t Furthest;
+	float FurthestDistance;
+
+	// Counts reuses of the slot, so stale queue entries can be told apart.
+	std::uint32_t Stamp;
+	std::uint32_t Visited;
+
+	// Set for a face that must go with the current point.
+	std::uint32_t Forced;
+	bool Alive;
+};
+
+struct ConvexHull::BuildContext
+{
+	std::vector<XMFLOAT3> Points;
+	std::vector<std::uint32_t> Next;
+	std::vector<Face> Faces;
+	std::vector<std::uint32_t> FreeFaces;
+	float Tolerance = 0.0f;
+
+	// Faces with points out of them, furthest first.  Taking the newest
+	// faces first would be kinder to the cache, but adds points barely out
+	// of the hull while far ones wait, which makes many more folds.
+	std::vector<Candidate> Queue;
+
+	void Push(const Candidate& candidate)
+	{
+		Queue.push_back(candidate);
+		std::push_heap(Queue.begin(), Queue.end());
+	}
+
+	Candidate Pop()
+	{
+		std::pop_heap(Queue.begin(), Queue.end());
+		Candidate candidate = Queue.back();
+		Queue.pop_back();
+		return candidate;
+	}
+
+	// Marks faces and vertices met by the current point.
+	std::vector<std::uint32_t> VertexMarks;
+	std::uint32_t Mark = 0;
+
+	// Scratch for AddPoint.
+	std::vector<Visit> Walk;
+	std::vector<std::uint32_t> Visible;
+	std::vector<HorizonEdge> Horizon;
+	std::vector<std::uint32_t> Orphans;
+	std::vector<std::uint32_t> NewFaces;
+};
+
+namespace
+{
+	template <typename FaceType>
+	float Distance(const FaceType& face, const XMFLOAT3& p)
+	{
+		return face.Normal.x * p.x + face.Normal.y * p.y + face.Normal.z * p.z + face.Offset;
+	}
+
+	// The plane through the face's corners, in double so long thin faces
+	// keep a good normal.
+	template <typename FaceType>
+	void SetPlane(FaceType& face, const std::vector<XMFLOAT3>& points)
+	{
+		const XMFLOAT3& a = points[face.V[0]];
+		const XMFLOAT3& b = points[face.V[1]];
+		const XMFLOAT3& c = points[face.V[2]];
+
+		double e1[3] = { (double)b.x - a.x, (double)b.y - a.y, (double)b.z - a.z };
+		double e2[3] = { (double)c.x - a.x, (double)c.y - a.y, (double)c.z - a.z };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length > 0.0)
+		{
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+		}
+
+		face.Normal = XMFLOAT3((float)n[0], (float)n[1], (float)n[2]);
+		face.Offset = (float)(-(n[0] * ((double)a.x + b.x + c.x) + n[1] * ((double)a.y + b.y + c.y) + n[2] * ((double)a.z + b.z + c.z)) / 3.0);
+	}
+}
+
+bool ConvexHull::Build(const XMFLOAT3* points, std::uint32_t pointStride, std::uint32_t count, std::uint32_t maxVertices)
+{
+	PROFILE_FUNCTION();
+
+	Clear();
+
+	if (count < 4)
+		return false;
+
+	BuildContext context;
+	context.Points.resize(count);
+	context.Next.resize(count);
+	context.VertexMarks.assign(count, 0);
+
+	const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(points);
+	float extent[3] = { 0.0f, 0.0f, 0.0f };
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	std::uint32_t extremes[6] = { 0, 0, 0, 0, 0, 0 };
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& point = *reinterpret_cast<const XMFLOAT3*>(bytes + (size_t)i * pointStride);
+		context.Points[i] = point;
+
+		const float coordinates[3] = { point.x, point.y, point.z };
+		for (int k = 0; k < 3; ++k)
+		{
+			extent[k] = std::max(extent[k], std::fabs(coordinates[k]));
+			if (coordinates[k] < lo[k])
+			{
+				lo[k] = coordinates[k];
+				extremes[2 * k] = i;
+			}
+			if (coordinates[k] > hi[k])
+			{
+				hi[k] = coordinates[k];
+				extremes[2 * k + 1] = i;
+			}
+		}
+	}
+
+	// As in qhull, a few units in the last place of the largest coordinates.
+	context.Tolerance = 3.0f * FLT_EPSILON * (extent[0] + extent[1] + extent[2]);
+	const float tolerance = context.Tolerance;
+	const std::vector<XMFLOAT3>& p = context.Points;
+
+	// The first tetrahedron: the furthest apart pair of the extremes along
+	// the axes, the point furthest from the line through them, and the
+	// point furthest from the plane through those three.
+	std::uint32_t a = extremes[0];
+	std::uint32_t b = extremes[1];
+	for (int i = 0; i < 6; ++i)
+	{
+		for (int j = i + 1; j < 6; ++j)
+		{
+			if (Squared(p[extremes[i]], p[extremes[j]]) > Squared(p[a], p[b]))
+			{
+				a = extremes[i];
+				b = extremes[j];
+			}
+		}
+	}
+
+	if (std::sqrt(Squared(p[a], p[b])) <= tolerance)
+		return false;
+
+	XMVECTOR pa = XMLoadFloat3(&p[a]);
+	XMVECTOR line = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&p[b]), pa));
+
+	std::uint32_t c = a;
+	float best = 0.0f;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		float distance = XMVectorGetX(XMVector3LengthSq(XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p[i]), pa), line)));
+		if (distance > best)
+		{
+			best = distance;
+			c = i;
+		}
+	}
+
+	if (std::sqrt(best) <= tolerance)
+		return false;
+
+	XMVECTOR normal = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p[b]), pa), XMVectorSubtract(XMLoadFloat3(&p[c]), pa)));
+
+	std::uint32_t d = a;
+	float signedBest = 0.0f;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		float distance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(XMLoadFloat3(&p[i]), pa), normal));
+		if (std::fabs(distance) > std::fabs(signedBest))
+		{
+			signedBest = distance;
+			d = i;
+		}
+	}
+
+	if (std::fabs(signedBest) <= tolerance)
+		return false;
+
+	// Wound so each face points away from the corner opposite.
+	if (signedBest > 0.0f)
+		std::swap(b, c);
+
+	const std::uint32_t corners[4][3] = { { a, b, c }, { b, a, d }, { c, b, d }, { a, c, d } };
+
+	context.Faces.resize(4);
+	for (std::uint32_t f = 0; f < 4; ++f)
+	{
+		Face& face = context.Faces[f];
+		for (int k = 0; k < 3; ++k)
+			face.V[k] = corners[f][k];
+		face.FirstOutside = NoVertex;
+		face.LastOutside = NoVertex;
+		face.Furthest = 0;
+		face.FurthestDistance = 0.0f;
+		face.Stamp = 0;
+		face.Visited = 0;
+		face.Forced = 0;
+		face.Alive = true;
+		SetPlane(face, p);
+	}
+
+	for (std::uint32_t f = 0; f < 4; ++f)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			std::uint32_t from = corners[f][k];
+			std::uint32_t to = corners[f][(k + 1) % 3];
+			for (std::uint32_t g = 0; g < 4; ++g)
+				for (int j = 0; j < 3; ++j)
+					if (corners[g][j] == to && corners[g][(j + 1) % 3] == from)
+						context.Faces[f].Adjacent[k] = g;
+		}
+	}
+
+	{
+		PROFILE_SCOPE("Assign points");
+
+		std::vector<std::uint32_t> all(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+			all[i] = i;
+
+		const std::uint32_t faces[4] = { 0, 1, 2, 3 };
+		Assign(context, all.data(), count, faces, 4);
+	}
+
+	for (std::uint32_t f = 0; f < 4; ++f)
+	{
+		if (context.Faces[f].FirstOutside != NoVertex)
+			context.Push(Candidate{ context.Faces[f].FurthestDistance, f, 0 });
+	}
+
+	if (maxVertices != 0 && maxVertices < 4)
+		maxVertices = 4;
+
+	std::uint32_t vertexCount = 4;
+
+	{
+		PROFILE_SCOPE("Add points");
+
+		while (!context.Queue.empty() && (maxVertices == 0 || vertexCount < maxVertices))
+		{
+			Candidate candidate = context.Pop();
+
+			const Face& face = context.Faces[candidate.Face];
+			if (!face.Alive || face.Stamp != candidate.Stamp || face.FirstOutside == NoVertex)
+				continue;
+
+			if (AddPoint(context, candidate.Face))
+				++vertexCount;
+		}
+	}
+
+	// Points no face uses any more have ended up inside.
+	std::vector<std::uint32_t> remap(count, NoVertex);
+	double volume = 0.0;
+
+	for (const Face& face : context.Faces)
+	{
+		if (!face.Alive)
+			continue;
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (remap[face.V[k]] == NoVertex)
+			{
+				remap[face.V[k]] = (std::uint32_t)mVertices.size();
+				mVertices.push_back(p[face.V[k]]);
+			}
+			mIndices.push_back(remap[face.V[k]]);
+		}
+		mPlanes.push_back(XMFLOAT4(face.Normal.x, face.Normal.y, face.Normal.z, face.Offset));
+
+		// Tetrahedra from the first corner of the first tetrahedron, which
+		// keeps the terms small.
+		const XMFLOAT3& o = p[a];
+		double u[3] = { (double)p[face.V[0]].x - o.x, (double)p[face.V[0]].y - o.y, (double)p[face.V[0]].z - o.z };
+		double v[3] = { (double)p[face.V[1]].x - o.x, (double)p[face.V[1]].y - o.y, (double)p[face.V[1]].z - o.z };
+		double w[3] = { (double)p[face.V[2]].x - o.x, (double)p[face.V[2]].y - o.y, (double)p[face.V[2]].z - o.z };
+		volume += u[0] * (v[1] * w[2] - v[2] * w[1]) + u[1] * (v[2] * w[0] - v[0] * w[2]) + u[2] * (v[0] * w[1] - v[1] * w[0]);
+	}
+
+	mTolerance = tolerance;
+	mVolume = (float)(volume / 6.0);
+	return true;
+}
+
+void ConvexHull::Assign(BuildContext& context, const std::uint32_t* points, std::uint32_t count,
+	const std::uint32_t* faces, std::uint32_t faceCount)
+{
+	std::vector<Face>& all = context.Faces;
+	std::vector<std::uint32_t>& next = context.Next;
+	const std::vector<XMFLOAT3>& p = context.Points;
+	const float tolerance = context.Tolerance;
+
+	// Each range of points is split into lists by face, which are joined in
+	// range order, so the lists are as one pass in order would make them.
+	// A nested call gets its ranges all at once, so they are split again.
+	const std::uint32_t rangeCount = (count + AssignGrainSize - 1) / AssignGrainSize;
+
+	struct Bucket
+	{
+		std::uint32_t First;
+		std::uint32_t Last;
+		std::uint32_t Furthest;
+		float FurthestDistance;
+	};
+
+	std::vector<Bucket> buckets((size_t)rangeCount * faceCount, Bucket{ NoVertex, NoVertex, 0, 0.0f });
+
+	auto assignRange = [&](std::uint32_t range)
+	{
+		std::uint32_t last = std::min(count, (range + 1) * AssignGrainSize);
+		for (std::uint32_t i = range * AssignGrainSize; i < last; ++i)
+		{
+			const std::uint32_t point = points[i];
+			for (std::uint32_t j = 0; j < faceCount; ++j)
+			{
+				float distance = Distance(all[faces[j]], p[point]);
+				if (distance > tolerance)
+				{
+					Bucket& bucket = buckets[(size_t)range * faceCount + j];
+					next[point] = NoVertex;
+					if (bucket.First == NoVertex)
+						bucket.First = point;
+					else
+						next[bucket.Last] = point;
+					bucket.Last = point;
+
+					if (distance > bucket.FurthestDistance)
+					{
+						bucket.FurthestDistance = distance;
+						bucket.Furthest = point;
+					}
+					break;
+				}
+			}
+		}
+	};
+
+	if (rangeCount == 1)
+	{
+		assignRange(0);
+	}
+	else
+	{
+		ThreadPool::Get().ParallelFor(count, AssignGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t range = begin / AssignGrainSize; range * AssignGrainSize < end; ++range)
+				assignRange(range);
+		});
+	}
+
+	for (std::uint32_t j = 0; j < faceCount; ++j)
+	{
+		Face& face = all[faces[j]];
+		for (std::uint32_t range = 0; range < rangeCount; ++range)
+		{
+			const Bucket& bucket = buckets[(size_t)range * faceCount + j];
+			if (bucket.First == NoVertex)
+				continue;
+
+			if (face.FirstOutside == NoVertex)
+				face.FirstOutside = bucket.First;
+			else
+				next[face.LastOutside] = bucket.First;
+			face.LastOutside = bucket.Last;
+
+			if (bucket.FurthestDistance > face.FurthestDistance)
+			{
+				face.FurthestDistance = bucket.FurthestDistance;
+				face.Furthest = bucket.Furthest;
+			}
+		}
+	}
+}
+
+bool ConvexHull::AddPoint(BuildContext& context, std::uint32_t eyeFace)
+{
+	std::vector<Face>& faces = context.Faces;
+	const std::uint32_t eye = faces[eyeFace].Furthest;
+	const XMFLOAT3 eyePoint = context.Points[eye];
+	const std::uint32_t forced = ++context.Mark;
+	std::uint32_t horizonCount = 0;
+
+	for (;;)
+	{
+		const std::uint32_t mark = ++context.Mark;
+
+		// The faces the point sees, depth first from the one it is out of,
+		// and the edges around them.  Crossing each face's edges in turn,
+		// starting after the one it was entered by, meets the horizon in
+		// order.
+		context.Walk.clear();
+		context.Visible.clear();
+		context.Horizon.clear();
+
+		faces[eyeFace].Visited = mark;
+		context.Visible.push_back(eyeFace);
+		context.Walk.push_back(Visit{ eyeFace, 0, 3 });
+
+		while (!context.Walk.empty())
+		{
+			Visit& visit = context.Walk.back();
+			if (visit.Left == 0)
+			{
+				context.Walk.pop_back();
+				continue;
+			}
+
+			const std::uint32_t f = visit.Face;
+			const std::uint32_t edge = visit.Edge;
+			visit.Edge = (edge + 1) % 3;
+			--visit.Left;
+
+			const std::uint32_t neighbour = faces[f].Adjacent[edge];
+			if (faces[neighbour].Visited == mark)
+				continue;
+
+			if (faces[neighbour].Forced == forced || Distance(faces[neighbour], eyePoint) > context.Tolerance)
+			{
+				faces[neighbour].Visited = mark;
+				context.Visible.push_back(neighbour);
+
+				std::uint32_t back = 0;
+				while (faces[neighbour].Adjacent[back] != f)
+					++back;
+				context.Walk.push_back(Visit{ neighbour, (back + 1) % 3, 2 });
+			}
+			else
+			{
+				context.Horizon.push_back(HorizonEdge{ faces[f].V[edge], faces[f].V[(edge + 1) % 3], neighbour });
+			}
+		}
+
+		// Rounding can leave the visible faces as a patch with a hole or
+		// pinched at a vertex, with no single loop around it.  The point is
+		// then too close to the hull to matter, so it is dropped.
+		horizonCount = (std::uint32_t)context.Horizon.size();
+		bool loop = horizonCount >= 3;
+		for (std::uint32_t k = 0; k < horizonCount && loop; ++k)
+		{
+			const HorizonEdge& edge = context.Horizon[k];
+			loop = edge.To == context.Horizon[(k + 1) % horizonCount].From && context.VertexMarks[edge.From] != mark;
+			context.VertexMarks[edge.From] = mark;
+		}
+
+		if (!loop)
+		{
+			Face& face = faces[eyeFace];
+			std::uint32_t previous = NoVertex;
+			std::uint32_t point = face.FirstOutside;
+			face.FirstOutside = NoVertex;
+			face.LastOutside = NoVertex;
+			face.FurthestDistance = 0.0f;
+
+			for (; point != NoVertex; point = context.Next[point])
+			{
+				if (point == eye)
+					continue;
+
+				if (previous == NoVertex)
+					face.FirstOutside = point;
+				else
+					context.Next[previous] = point;
+				previous = point;
+				face.LastOutside = point;
+
+				float distance = Distance(face, context.Points[point]);
+				if (distance > face.FurthestDistance)
+				{
+					face.FurthestDistance = distance;
+					face.Furthest = point;
+				}
+			}
+
+			if (previous != NoVertex)
+				context.Next[previous] = NoVertex;
+
+			if (face.FirstOutside != NoVertex)
+				context.Push(Candidate{ face.FurthestDistance, eyeFace, face.Stamp });
+			return false;
+		}
+
+		// A point out of one face by more than the tolerance can be within
+		// it of the next, beyond their shared edge, and the new face there
+		// would fold back over the one that stays.  That face is as good as
+		// seen, so it goes too and the walk is made again.  With the point
+		// in its plane the fold is flat, and shows only in the normals.
+		bool convex = true;
+		for (std::uint32_t k = 0; k < horizonCount; ++k)
+		{
+			const HorizonEdge& edge = context.Horizon[k];
+			const Face& neighbour = faces[edge.Neighbour];
+
+			Triangle fan;
+			fan.V[0] = edge.From;
+			fan.V[1] = edge.To;
+			fan.V[2] = eye;
+			SetPlane(fan, context.Points);
+
+			bool fold = fan.Normal.x * neighbour.Normal.x + fan.Normal.y * neighbour.Normal.y + fan.Normal.z * neighbour.Normal.z <= 0.0f &&
+				Distance(neighbour, eyePoint) >= -context.Tolerance;
+			for (int j = 0; j < 3 && !fold; ++j)
+			{
+				std::uint32_t v = neighbour.V[j];
+				fold = v != edge.From && v != edge.To && Distance(fan, context.Points[v]) > context.Tolerance;
+			}
+
+			if (fold)
+			{
+				faces[edge.Neighbour].Forced = forced;
+				convex = false;
+			}
+		}
+
+		if (convex)
+			break;
+	}
+
+	context.Orphans.clear();
+	for (std::uint32_t f : context.Visible)
+	{
+		Face& face = faces[f];
+		for (std::uint32_t point = face.FirstOutside; point != NoVertex; point = context.Next[point])
+		{
+			if (point != eye)
+				context.Orphans.push_back(point);
+		}
+
+		face.Alive = false;
+		context.FreeFaces.push_back(f);
+	}
+
+	// A fan of faces from the horizon to the point.
+	context.NewFaces.clear();
+	for (std::uint32_t k = 0; k < horizonCount; ++k)
+	{
+		std::uint32_t f;
+		if (context.FreeFaces.empty())
+		{
+			f = (std::uint32_t)faces.size();
+			faces.emplace_back();
+			faces.back().Stamp = 0;
+			faces.back().Visited = 0;
+			faces.back().Forced = 0;
+		}
+		else
+		{
+			f = context.FreeFaces.back();
+			context.FreeFaces.pop_back();
+			++faces[f].Stamp;
+		}
+		context.NewFaces.push_back(f);
+	}
+
+	for (std::uint32_t k = 0; k < horizonCount; ++k)
+	{
+		const HorizonEdge& edge = context.Horizon[k];
+		Face& face = faces[context.NewFaces[k]];
+		face.V[0] = edge.From;
+		face.V[1] = edge.To;
+		face.V[2] = eye;
+		face.Adjacent[0] = edge.Neighbour;
+		face.Adjacent[1] = context.NewFaces[(k + 1) % horizonCount];
+		face.Adjacent[2] = context.NewFaces[(k + horizonCount - 1) % horizonCount];
+		face.FirstOutside = NoVertex;
+		face.LastOutside = NoVertex;
+		face.Furthest = 0;
+		face.FurthestDistance = 0.0f;
+		face.Alive = true;
+		SetPlane(face, context.Points);
+
+		Face& neighbour = faces[edge.Neighbour];
+		for (int j = 0; j < 3; ++j)
+		{
+			if (neighbour.V[j] == edge.To && neighbour.V[(j + 1) % 3] == edge.From)
+				neighbour.Adjacent[j] = context.NewFaces[k];
+		}
+	}
+
+	Assign(context, context.Orphans.data(), (std::uint32_t)context.Orphans.size(), context.NewFaces.data(), horizonCount);
+
+	for (std::uint32_t f : context.NewFaces)
+	{
+		if (faces[f].FirstOutside != NoVertex)
+			context.Push(Candidate{ faces[f].FurthestDistance, f, faces[f].Stamp });
+	}
+
+	return true;
+}
+
+void ConvexHull::Clear()
+{
+	mVertices.clear();
+	mIndices.clear();
+	mPlanes.clear();
+	mTolerance = 0.0f;
+	mVolume = 0.0f;
+}
+
+const std::vector<XMFLOAT3>& ConvexHull::Vertices()const
+{
+	return mVertices;
+}
+
+const std::vector<std::uint32_t>& ConvexHull::Indices()const
+{
+	return mIndices;
+}
+
+const std::vector<XMFLOAT4>& ConvexHull::Planes()const
+{
+	return mPlanes;
+}
+
+std::uint32_t ConvexHull::TriangleCount()const
+{
+	return (std::uint32_t)mPlanes.size();
+}
+
+float ConvexHull::Tolerance()const
+{
+	return mTolerance;
+}
+
+float ConvexHull::Volume()const
+{
+	return mVolume;
+}
+
+bool ConvexHull::Contains(FXMVECTOR point)const
+{
+	XMFLOAT3 q;
+	XMStoreFloat3(&q, point);
+
+	for (const XMFLOAT4& plane : mPlanes)
+	{
+		if (plane.x * q.x + plane.y * q.y + plane.z * q.z + plane.w > mTolerance)
+			return false;
+	}
+	return true;
+}
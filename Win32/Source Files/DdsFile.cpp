@@ -0,0 +1,222 @@
+#include "DdsFile.h"
+#include "Profiler.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	const std::uint32_t Magic = 0x20534444; // "DDS "
+
+	// DDS_HEADER is 31 words after the magic; these are the ones we use.
+	const std::uint32_t HeaderWords = 31;
+	const std::uint32_t HeaderSize = 0;
+	const std::uint32_t HeaderFlags = 1;
+	const std::uint32_t HeaderHeight = 2;
+	const std::uint32_t HeaderWidth = 3;
+	const std::uint32_t HeaderLinearSize = 4;
+	const std::uint32_t HeaderMipCount = 6;
+	const std::uint32_t HeaderReserved = 7;
+	const std::uint32_t PixelFormatSize = 18;
+	const std::uint32_t PixelFormatFlags = 19;
+	const std::uint32_t PixelFormatFourCC = 20;
+	const std::uint32_t HeaderCaps = 26;
+
+	// DDS_HEADER_DXT10 follows when the FourCC is "DX10".
+	const std::uint32_t Dx10Words = 5;
+
+	const std::uint32_t FlagCaps = 0x1;
+	const std::uint32_t FlagHeight = 0x2;
+	const std::uint32_t FlagWidth = 0x4;
+	const std::uint32_t FlagPixelFormat = 0x1000;
+	const std::uint32_t FlagMipCount = 0x20000;
+	const std::uint32_t FlagLinearSize = 0x80000;
+	const std::uint32_t PixelFormatFourCCFlag = 0x4;
+	const std::uint32_t CapsComplex = 0x8;
+	const std::uint32_t CapsTexture = 0x1000;
+	const std::uint32_t CapsMipMap = 0x400000;
+
+	// DXGI_FORMAT values, kept here so the file format does not need the
+	// Direct3D headers.
+	const std::uint32_t DxgiBC1 = 71;
+	const std::uint32_t DxgiBC3 = 77;
+	const std::uint32_t DxgiBC7 = 98;
+	const std::uint32_t DimensionTexture2D = 3;
+
+	std::uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return (std::uint32_t)(std::uint8_t)a | ((std::uint32_t)(std::uint8_t)b << 8)
+			| ((std::uint32_t)(std::uint8_t)c << 16) | ((std::uint32_t)(std::uint8_t)d << 24);
+	}
+}
+
+bool DdsFile::Save(const std::string& filename, const CompressedTexture& texture)
+{
+	PROFILE_FUNCTION();
+
+	std::uint32_t header[1 + HeaderWords + Dx10Words] = {};
+	std::uint32_t* dds = header + 1;
+	std::uint32_t* dx10 = header + 1 + HeaderWords;
+
+	header[0] = Magic;
+	dds[HeaderSize] = HeaderWords * 4;
+	dds[HeaderFlags] = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | FlagMipCount | FlagLinearSize;
+	dds[HeaderHeight] = texture.Height;
+	dds[HeaderWidth] = texture.Width;
+	dds[HeaderLinearSize] = (std::uint32_t)BlockCompressor::LevelSize(texture.Format, texture.Width, texture.Height);
+	dds[HeaderMipCount] = (std::uint32_t)texture.Levels.size();
+	dds[HeaderReserved] = (std::uint32_t)texture.Tag;
+	dds[HeaderReserved + 1] = (std::uint32_t)(texture.Tag >> 32);
+	dds[PixelFormatSize] = 32;
+	dds[PixelFormatFlags] = PixelFormatFourCCFlag;
+	dds[HeaderCaps] = CapsTexture | (texture.Levels.size() > 1 ? CapsComplex | CapsMipMap : 0);
+
+	size_t headerSize = (1 + HeaderWords) * 4;
+
+	switch (texture.Format)
+	{
+	case BlockCompressor::BC1:
+		dds[PixelFormatFourCC] = FourCC('D', 'X', 'T', '1');
+		break;
+	case BlockCompressor::BC3:
+		dds[PixelFormatFourCC] = FourCC('D', 'X', 'T', '5');
+		break;
+	default:
+		dds[PixelFormatFourCC] = FourCC('D', 'X', '1', '0');
+		dx10[0] = DxgiBC7;
+		dx10[1] = DimensionTexture2D;
+		dx10[3] = 1;
+		headerSize += Dx10Words * 4;
+		break;
+	}
+
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs)
+		return false;
+
+	ofs.write((const char*)header, headerSize);
+	for (const std::vector<std::uint8_t>& level : texture.Levels)
+		ofs.write((const char*)level.data(), level.size());
+
+	return (bool)ofs;
+}
+
+bool DdsFile::Load(const std::string& filename, CompressedTexture& texture)
+{
+	PROFILE_FUNCTION();
+
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs)
+		return false;
+
+	ifs.seekg(0, std::ios::end);
+	size_t size = (size_t)ifs.tellg();
+	ifs.seekg(0, std::ios::beg);
+
+	std::vector<std::uint8_t> data(size);
+	ifs.read((char*)data.data(), size);
+	if (!ifs)
+		return false;
+
+	return Parse(data.data(), size, texture);
+}
+
+bool DdsFile::Parse(const std::uint8_t* data, size_t size, CompressedTexture& texture)
+{
+	DdsLayout layout;
+	if (!ParseLayout(data, size, layout))
+		return false;
+
+	texture.Format = layout.Format;
+	texture.Width = layout.Width;
+	texture.Height = layout.Height;
+	texture.Tag = layout.Tag;
+	texture.Levels.resize(layout.LevelOffsets.size());
+
+	for (size_t i = 0; i < texture.Levels.size(); ++i)
+		texture.Levels[i].assign(data + layout.LevelOffsets[i], data + layout.LevelOffsets[i] + layout.LevelSizes[i]);
+
+	return true;
+}
+
+bool DdsFile::ParseLayout(const std::uint8_t* data, size_t size, DdsLayout& layout)
+{
+	size_t offset = (1 + HeaderWords) * 4;
+	if (size < offset)
+		return false;
+
+	std::uint32_t header[1 + HeaderWords];
+	std::memcpy(header, data, sizeof(header));
+	const std::uint32_t* dds = header + 1;
+
+	if (header[0] != Magic || dds[HeaderSize] != HeaderWords * 4 || !(dds[PixelFormatFlags] & PixelFormatFourCCFlag))
+		return false;
+
+	std::uint32_t fourCC = dds[PixelFormatFourCC];
+
+	if (fourCC == FourCC('D', 'X', 'T', '1'))
+	{
+		layout.Format = BlockCompressor::BC1;
+	}
+	else if (fourCC == FourCC('D', 'X', 'T', '5'))
+	{
+		layout.Format = BlockCompressor::BC3;
+	}
+	else if (fourCC == FourCC('D', 'X', '1', '0'))
+	{
+		if (size < offset + Dx10Words * 4)
+			return false;
+
+		std::uint32_t dx10[Dx10Words];
+		std::memcpy(dx10, data + offset, sizeof(dx10));
+		offset += Dx10Words * 4;
+
+		if (dx10[1] != DimensionTexture2D || dx10[3] != 1)
+			return false;
+
+		switch (dx10[0])
+		{
+		case DxgiBC1: layout.Format = BlockCompressor::BC1; break;
+		case DxgiBC3: layout.Format = BlockCompressor::BC3; break;
+		case DxgiBC7: layout.Format = BlockCompressor::BC7; break;
+		default: return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	layout.Width = dds[HeaderWidth];
+	layout.Height = dds[HeaderHeight];
+	if (layout.Width == 0 || layout.Height == 0)
+		return false;
+
+	layout.Tag = dds[HeaderReserved] | (std::uint64_t)dds[HeaderReserved + 1] << 32;
+
+	std::uint32_t levelCount = (dds[HeaderFlags] & FlagMipCount) && dds[HeaderMipCount] ? dds[HeaderMipCount] : 1;
+	if (levelCount > MipGenerator::LevelCount(layout.Width, layout.Height))
+		return false;
+
+	layout.LevelOffsets.resize(levelCount);
+	layout.LevelSizes.resize(levelCount);
+
+	std::uint32_t width = layout.Width;
+	std::uint32_t height = layout.Height;
+
+	for (std::uint32_t i = 0; i < levelCount; ++i)
+	{
+		size_t levelSize = BlockCompressor::LevelSize(layout.Format, width, height);
+		if (size - offset < levelSize)
+			return false;
+
+		layout.LevelOffsets[i] = offset;
+		layout.LevelSizes[i] = levelSize;
+		offset += levelSize;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
@@ -0,0 +1,432 @@
+#include "DistanceField.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Triangles per task when moving them to voxel space.
+	const std::uint32_t GrainSize = 1024;
+
+	const std::uint32_t MaxTraceSteps = 1024;
+
+	// Sample centers in the row (y, z) crosses, by rounding up.
+	std::int32_t FirstCenter(float lo)
+	{
+		return (std::int32_t)std::ceil(lo - 0.5f);
+	}
+
+	std::int32_t LastCenter(float hi)
+	{
+		return (std::int32_t)std::floor(hi - 0.5f);
+	}
+}
+
+struct DistanceField::BuildContext
+{
+	const Bvh* Triangles;
+	std::uint32_t Grid;
+
+	// Three voxel-space corners per triangle.
+	std::vector<XMFLOAT3> Corners;
+
+	// Triangles by the columns of bricks along x their bounds touch.
+	std::vector<std::uint32_t> ColumnStarts;
+	std::vector<std::uint32_t> ColumnTriangles;
+
+	// What each column baked: its bricks' indices into its own samples,
+	// or OutsideBrick or InsideBrick.
+	std::vector<std::vector<std::uint32_t>> ColumnBricks;
+	std::vector<std::vector<std::int8_t>> ColumnSamples;
+};
+
+void DistanceField::Bake(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, const Bvh& bvh, std::uint32_t resolution, float band)
+{
+	Bake(positions, positionStride, indices, triangleCount, bvh, resolution, band, ThreadPool::Get());
+}
+
+void DistanceField::Bake(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, const Bvh& bvh, std::uint32_t resolution, float band, ThreadPool& pool)
+{
+	PROFILE_FUNCTION();
+
+	Clear();
+
+	if (triangleCount == 0)
+		return;
+
+	mResolution = (std::max(resolution, 2 * BrickSize) + BrickSize - 1) / BrickSize * BrickSize;
+	mGrid = mResolution / BrickSize;
+	mBand = std::min(std::max(band, 1.0f), (float)(mResolution / 4));
+
+	auto position = [&](std::uint32_t index)
+	{
+		return XMLoadFloat3((const XMFLOAT3*)((const std::uint8_t*)positions + (size_t)index * positionStride));
+	};
+
+	XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+	XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+	for (std::uint32_t i = 0; i < 3 * triangleCount; ++i)
+	{
+		lo = XMVectorMin(lo, position(indices[i]));
+		hi = XMVectorMax(hi, position(indices[i]));
+	}
+
+	// A cube around the mesh with the band and a voxel more on every side,
+	// so the samples on the grid's faces are all outside the band.
+	XMFLOAT3 extent;
+	XMStoreFloat3(&extent, XMVectorSubtract(hi, lo));
+	float padding = mBand + 1.0f;
+	mVoxelSize = std::max(std::max(std::max(extent.x, extent.y), extent.z), FLT_MIN) / (mResolution - 2.0f * padding);
+	XMStoreFloat3(&mOrigin, XMVectorSubtract(XMVectorScale(XMVectorAdd(lo, hi), 0.5f), XMVectorReplicate(0.5f * mResolution * mVoxelSize)));
+
+	BuildContext context;
+	context.Triangles = &bvh;
+	context.Grid = mGrid;
+	context.Corners.resize(3 * (size_t)triangleCount);
+
+	XMVECTOR origin = XMLoadFloat3(&mOrigin);
+	float scale = 1.0f / mVoxelSize;
+
+	pool.ParallelFor(triangleCount, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t t = begin; t < end; ++t)
+		{
+			for (std::uint32_t k = 0; k < 3; ++k)
+				XMStoreFloat3(&context.Corners[3 * (size_t)t + k], XMVectorScale(XMVectorSubtract(position(indices[3 * t + k]), origin), scale));
+		}
+	});
+
+	// Counting sort of the triangles into the columns of rows they cross.
+	const std::uint32_t columnCount = mGrid * mGrid;
+	std::vector<std::int32_t> ranges(4 * (size_t)triangleCount);
+	context.ColumnStarts.assign(columnCount + 1, 0);
+
+	for (std::uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const XMFLOAT3* corners = &context.Corners[3 * (size_t)t];
+		std::int32_t* range = &ranges[4 * (size_t)t];
+		range[0] = std::max(FirstCenter(std::min(std::min(corners[0].y, corners[1].y), corners[2].y)), 0) / (std::int32_t)BrickSize;
+		range[1] = std::min(LastCenter(std::max(std::max(corners[0].y, corners[1].y), corners[2].y)), (std::int32_t)mResolution - 1) / (std::int32_t)BrickSize;
+		range[2] = std::max(FirstCenter(std::min(std::min(corners[0].z, corners[1].z), corners[2].z)), 0) / (std::int32_t)BrickSize;
+		range[3] = std::min(LastCenter(std::max(std::max(corners[0].z, corners[1].z), corners[2].z)), (std::int32_t)mResolution - 1) / (std::int32_t)BrickSize;
+
+		for (std::int32_t z = range[2]; z <= range[3]; ++z)
+			for (std::int32_t y = range[0]; y <= range[1]; ++y)
+				++context.ColumnStarts[y + mGrid * z + 1];
+	}
+
+	for (std::uint32_t c = 0; c < columnCount; ++c)
+		context.ColumnStarts[c + 1] += context.ColumnStarts[c];
+
+	std::vector<std::uint32_t> next(context.ColumnStarts.begin(), context.ColumnStarts.end() - 1);
+	context.ColumnTriangles.resize(context.ColumnStarts[columnCount]);
+	for (std::uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const std::int32_t* range = &ranges[4 * (size_t)t];
+		for (std::int32_t z = range[2]; z <= range[3]; ++z)
+			for (std::int32_t y = range[0]; y <= range[1]; ++y)
+				context.ColumnTriangles[next[y + mGrid * z]++] = t;
+	}
+
+	context.ColumnBricks.resize(columnCount);
+	context.ColumnSamples.resize(columnCount);
+
+	pool.ParallelFor(columnCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t column = begin; column < end; ++column)
+			BakeColumn(context, column);
+	});
+
+	// Columns in order, so the bricks are laid out as the grid is.
+	mBricks.resize((size_t)mGrid * columnCount);
+	for (std::uint32_t column = 0; column < columnCount; ++column)
+	{
+		std::uint32_t first = (std::uint32_t)(mSamples.size() / BrickSamples);
+		for (std::uint32_t x = 0; x < mGrid; ++x)
+		{
+			std::uint32_t brick = context.ColumnBricks[column][x];
+			mBricks[x + mGrid * (size_t)column] = brick == OutsideBrick || brick == InsideBrick ? brick : first + brick;
+		}
+
+		mSamples.insert(mSamples.end(), context.ColumnSamples[column].begin(), context.ColumnSamples[column].end());
+		context.ColumnSamples[column] = std::vector<std::int8_t>();
+	}
+}
+
+void DistanceField::BakeColumn(BuildContext& context, std::uint32_t column)const
+{
+	const std::int32_t y0 = (std::int32_t)(column % mGrid * BrickSize);
+	const std::int32_t z0 = (std::int32_t)(column / mGrid * BrickSize);
+
+	// Where each row through the column's sample centers crosses the mesh,
+	// as in VoxelOctree's fill: a center on a shared edge or vertex belongs
+	// to exactly one of the triangles facing the same way along x.
+	std::vector<std::pair<std::uint32_t, float>> crossings;
+
+	for (std::uint32_t i = context.ColumnStarts[column]; i < context.ColumnStarts[column + 1]; ++i)
+	{
+		const XMFLOAT3* corners = &context.Corners[3 * (size_t)context.ColumnTriangles[i]];
+		XMFLOAT3 a = corners[0];
+		XMFLOAT3 b = corners[1];
+		XMFLOAT3 c = corners[2];
+
+		double normalX = ((double)b.y - a.y) * ((double)c.z - a.z) - ((double)b.z - a.z) * ((double)c.y - a.y);
+		if (normalX == 0.0)
+			continue;
+		if (normalX < 0.0)
+			std::swap(b, c);
+
+		double normalY = ((double)b.z - a.z) * ((double)c.x - a.x) - ((double)b.x - a.x) * ((double)c.z - a.z);
+		double normalZ = ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+		double absNormalX = std::fabs(normalX);
+
+		const XMFLOAT3* edges[3][2] = { { &a, &b }, { &b, &c }, { &c, &a } };
+
+		std::int32_t yMin = std::max(FirstCenter(std::min(std::min(a.y, b.y), c.y)), y0);
+		std::int32_t yMax = std::min(LastCenter(std::max(std::max(a.y, b.y), c.y)), y0 + (std::int32_t)BrickSize - 1);
+		std::int32_t zMin = std::max(FirstCenter(std::min(std::min(a.z, b.z), c.z)), z0);
+		std::int32_t zMax = std::min(LastCenter(std::max(std::max(a.z, b.z), c.z)), z0 + (std::int32_t)BrickSize - 1);
+
+		for (std::int32_t z = zMin; z <= zMax; ++z)
+		{
+			for (std::int32_t y = yMin; y <= yMax; ++y)
+			{
+				double py = y + 0.5;
+				double pz = z + 0.5;
+
+				bool inside = true;
+				for (int k = 0; k < 3 && inside; ++k)
+				{
+					const XMFLOAT3& p = *edges[k][0];
+					const XMFLOAT3& q = *edges[k][1];
+					double dy = (double)q.y - p.y;
+					double dz = (double)q.z - p.z;
+					double side = dy * (pz - p.z) - dz * (py - p.y);
+					inside = side > 0.0 || (side == 0.0 && (dz < 0.0 || (dz == 0.0 && dy > 0.0)));
+				}
+
+				if (!inside)
+					continue;
+
+				double x = a.x - (normalY * (py - a.y) + normalZ * (pz - a.z)) / absNormalX;
+				crossings.push_back(std::make_pair((std::uint32_t)((y - y0) + BrickSize * (z - z0)), (float)x));
+			}
+		}
+	}
+
+	std::sort(crossings.begin(), crossings.end());
+
+	const std::uint32_t rowCount = BrickSize * BrickSize;
+	std::uint32_t rowStarts[BrickSize * BrickSize + 1] = {};
+	std::vector<float> xs(crossings.size());
+	for (size_t i = 0; i < crossings.size(); ++i)
+	{
+		++rowStarts[crossings[i].first + 1];
+		xs[i] = crossings[i].second;
+	}
+	for (std::uint32_t r = 0; r < rowCount; ++r)
+		rowStarts[r + 1] += rowStarts[r];
+
+	// Whether sample x of a row is inside: an odd number of crossings
+	// before it.
+	auto inside = [&](std::uint32_t row, std::int32_t x)
+	{
+		const float* first = xs.data() + rowStarts[row];
+		const float* last = xs.data() + rowStarts[row + 1];
+		return ((std::lower_bound(first, last, x + 0.5f) - first) & 1) != 0;
+	};
+
+	std::vector<std::uint32_t>& bricks = context.ColumnBricks[column];
+	std::vector<std::int8_t>& samples = context.ColumnSamples[column];
+	bricks.resize(mGrid);
+
+	const float band = mBand * mVoxelSize;
+	const float halfDiagonal = std::sqrt(3.0f) * 0.5f * (BrickSize - 1) * mVoxelSize;
+	const float quantize = 127.0f / mBand;
+
+	for (std::uint32_t bx = 0; bx < mGrid; ++bx)
+	{
+		const std::int32_t x0 = (std::int32_t)(bx * BrickSize);
+
+		// Nothing within the band of any of the brick's samples.
+		XMVECTOR center = XMVectorSet(mOrigin.x + (x0 + 0.5f * BrickSize) * mVoxelSize, mOrigin.y + (y0 + 0.5f * BrickSize) * mVoxelSize,
+			mOrigin.z + (z0 + 0.5f * BrickSize) * mVoxelSize, 1.0f);
+		BvhHit hit;
+		if (!context.Triangles->Nearest(center, band + halfDiagonal, hit))
+		{
+			bricks[bx] = inside(0, x0) ? InsideBrick : OutsideBrick;
+			continue;
+		}
+
+		bricks[bx] = (std::uint32_t)(samples.size() / BrickSamples);
+		samples.resize(samples.size() + BrickSamples);
+		std::int8_t* brick = &samples[samples.size() - BrickSamples];
+
+		for (std::uint32_t z = 0; z < BrickSize; ++z)
+		{
+			for (std::uint32_t y = 0; y < BrickSize; ++y)
+			{
+				std::uint32_t row = y + BrickSize * z;
+				for (std::uint32_t x = 0; x < BrickSize; ++x)
+				{
+					XMVECTOR point = XMVectorSet(mOrigin.x + (x0 + x + 0.5f) * mVoxelSize, mOrigin.y + (y0 + y + 0.5f) * mVoxelSize,
+						mOrigin.z + (z0 + z + 0.5f) * mVoxelSize, 1.0f);
+
+					float distance = mBand;
+					if (context.Triangles->Nearest(point, band, hit))
+						distance = hit.Distance / mVoxelSize;
+					if (inside(row, x0 + x))
+						distance = -distance;
+
+					brick[x + row * BrickSize] = (std::int8_t)std::min(std::max(std::round(distance * quantize), -127.0f), 127.0f);
+				}
+			}
+		}
+	}
+}
+
+void DistanceField::Clear()
+{
+	mBricks.clear();
+	mSamples.clear();
+	mResolution = 0;
+	mGrid = 0;
+	mVoxelSize = 0.0f;
+	mBand = 0.0f;
+	mOrigin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+float DistanceField::Voxel(std::int32_t x, std::int32_t y, std::int32_t z)const
+{
+	std::int32_t last = (std::int32_t)mResolution - 1;
+	x = std::min(std::max(x, 0), last);
+	y = std::min(std::max(y, 0), last);
+	z = std::min(std::max(z, 0), last);
+
+	std::uint32_t brick = mBricks[x / BrickSize + mGrid * (y / BrickSize + mGrid * (z / BrickSize))];
+	if (brick == OutsideBrick)
+		return mBand;
+	if (brick == InsideBrick)
+		return -mBand;
+
+	std::uint32_t sample = x % BrickSize + BrickSize * (y % BrickSize + BrickSize * (z % BrickSize));
+	return mSamples[brick * BrickSamples + sample] * (mBand / 127.0f);
+}
+
+float DistanceField::Sample(FXMVECTOR point)const
+{
+	if (mResolution == 0)
+		return FLT_MAX;
+
+	// In voxels from the first sample, held to the grid.
+	XMFLOAT3 p;
+	XMStoreFloat3(&p, XMVectorSubtract(XMVectorScale(XMVectorSubtract(point, XMLoadFloat3(&mOrigin)), 1.0f / mVoxelSize), XMVectorReplicate(0.5f)));
+
+	float last = (float)(mResolution - 1);
+	float fx = std::min(std::max(p.x, 0.0f), last);
+	float fy = std::min(std::max(p.y, 0.0f), last);
+	float fz = std::min(std::max(p.z, 0.0f), last);
+
+	std::int32_t x = (std::int32_t)fx;
+	std::int32_t y = (std::int32_t)fy;
+	std::int32_t z = (std::int32_t)fz;
+	fx -= x;
+	fy -= y;
+	fz -= z;
+
+	float c00 = Voxel(x, y, z) + (Voxel(x + 1, y, z) - Voxel(x, y, z)) * fx;
+	float c10 = Voxel(x, y + 1, z) + (Voxel(x + 1, y + 1, z) - Voxel(x, y + 1, z)) * fx;
+	float c01 = Voxel(x, y, z + 1) + (Voxel(x + 1, y, z + 1) - Voxel(x, y, z + 1)) * fx;
+	float c11 = Voxel(x, y + 1, z + 1) + (Voxel(x + 1, y + 1, z + 1) - Voxel(x, y + 1, z + 1)) * fx;
+
+	float c0 = c00 + (c10 - c00) * fy;
+	float c1 = c01 + (c11 - c01) * fy;
+	return (c0 + (c1 - c0) * fz) * mVoxelSize;
+}
+
+bool DistanceField::SphereTrace(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, float& distance)const
+{
+	if (mResolution == 0)
+		return false;
+
+	// Start where the ray enters the grid.
+	float o[3] = { XMVectorGetX(origin), XMVectorGetY(origin), XMVectorGetZ(origin) };
+	float d[3] = { XMVectorGetX(direction), XMVectorGetY(direction), XMVectorGetZ(direction) };
+	float lo[3] = { mOrigin.x, mOrigin.y, mOrigin.z };
+	float side = mResolution * mVoxelSize;
+
+	float t = 0.0f;
+	float tEnd = maxDistance;
+	for (int k = 0; k < 3; ++k)
+	{
+		if (d[k] == 0.0f)
+		{
+			if (o[k] < lo[k] || o[k] > lo[k] + side)
+				return false;
+			continue;
+		}
+
+		float t0 = (lo[k] - o[k]) / d[k];
+		float t1 = (lo[k] + side - o[k]) / d[k];
+		t = std::max(t, std::min(t0, t1));
+		tEnd = std::min(tEnd, std::max(t0, t1));
+	}
+
+	float length = XMVectorGetX(XMVector3Length(direction));
+	if (t > tEnd || length == 0.0f)
+		return false;
+
+	// Far from the surface the field is held at the band, which only
+	// shortens the steps.
+	float threshold = 0.1f * mVoxelSize;
+	for (std::uint32_t step = 0; step < MaxTraceSteps && t <= tEnd; ++step)
+	{
+		float field = Sample(XMVectorMultiplyAdd(direction, XMVectorReplicate(t), origin));
+		if (field < threshold)
+		{
+			distance = t;
+			return true;
+		}
+
+		t += field / length;
+	}
+
+	return false;
+}
+
+std::uint32_t DistanceField::Resolution()const
+{
+	return mResolution;
+}
+
+float DistanceField::VoxelSize()const
+{
+	return mVoxelSize;
+}
+
+XMFLOAT3 DistanceField::Origin()const
+{
+	return mOrigin;
+}
+
+float DistanceField::Band()const
+{
+	return mBand * mVoxelSize;
+}
+
+std::uint32_t DistanceField::BrickCount()const
+{
+	return (std::uint32_t)(mSamples.size() / BrickSamples);
+}
+
+size_t DistanceField::SizeInBytes()const
+{
+	return mBricks.size() * sizeof(std::uint32_t) + mSamples.size();
+}
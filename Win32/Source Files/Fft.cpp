@@ -0,0 +1,241 @@
+#include "Fft.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// Strips of four columns transformed together.
+	const std::uint32_t ColumnStrips = 4;
+
+	// a + w b and a - w b, for a twiddle w shared by the lanes.
+	inline void Butterfly(XMVECTOR& ar, XMVECTOR& ai, XMVECTOR& br, XMVECTOR& bi, FXMVECTOR wr, FXMVECTOR wi)
+	{
+		XMVECTOR tr = XMVectorNegativeMultiplySubtract(bi, wi, XMVectorMultiply(br, wr));
+		XMVECTOR ti = XMVectorMultiplyAdd(bi, wr, XMVectorMultiply(br, wi));
+		br = XMVectorSubtract(ar, tr);
+		bi = XMVectorSubtract(ai, ti);
+		ar = XMVectorAdd(ar, tr);
+		ai = XMVectorAdd(ai, ti);
+	}
+
+	// Four transforms of count points, one per lane, already in
+	// bit-reversed order.  sign of -1 conjugates the twiddles.  Stages go
+	// two to a pass, four points at a time, to halve the loads and stores.
+	void Butterflies(XMFLOAT4A* real, XMFLOAT4A* imag, std::uint32_t count, const float* twiddleReal,
+		const float* twiddleImag, float sign)
+	{
+		std::uint32_t span = 1;
+		for (; span * 4 <= count; span *= 4)
+		{
+			for (std::uint32_t j = 0; j < span; ++j)
+			{
+				XMVECTOR w1r = XMVectorReplicate(twiddleReal[span + j]);
+				XMVECTOR w1i = XMVectorReplicate(sign * twiddleImag[span + j]);
+				XMVECTOR w2r = XMVectorReplicate(twiddleReal[2 * span + j]);
+				XMVECTOR w2i = XMVectorReplicate(sign * twiddleImag[2 * span + j]);
+				XMVECTOR w3r = XMVectorReplicate(twiddleReal[3 * span + j]);
+				XMVECTOR w3i = XMVectorReplicate(sign * twiddleImag[3 * span + j]);
+
+				for (std::uint32_t a = j; a < count; a += 4 * span)
+				{
+					XMVECTOR r0 = XMLoadFloat4A(&real[a]);
+					XMVECTOR i0 = XMLoadFloat4A(&imag[a]);
+					XMVECTOR r1 = XMLoadFloat4A(&real[a + span]);
+					XMVECTOR i1 = XMLoadFloat4A(&imag[a + span]);
+					XMVECTOR r2 = XMLoadFloat4A(&real[a + 2 * span]);
+					XMVECTOR i2 = XMLoadFloat4A(&imag[a + 2 * span]);
+					XMVECTOR r3 = XMLoadFloat4A(&real[a + 3 * span]);
+					XMVECTOR i3 = XMLoadFloat4A(&imag[a + 3 * span]);
+
+					Butterfly(r0, i0, r1, i1, w1r, w1i);
+					Butterfly(r2, i2, r3, i3, w1r, w1i);
+					Butterfly(r0, i0, r2, i2, w2r, w2i);
+					Butterfly(r1, i1, r3, i3, w3r, w3i);
+
+					XMStoreFloat4A(&real[a], r0);
+					XMStoreFloat4A(&imag[a], i0);
+					XMStoreFloat4A(&real[a + span], r1);
+					XMStoreFloat4A(&imag[a + span], i1);
+					XMStoreFloat4A(&real[a + 2 * span], r2);
+					XMStoreFloat4A(&imag[a + 2 * span], i2);
+					XMStoreFloat4A(&real[a + 3 * span], r3);
+					XMStoreFloat4A(&imag[a + 3 * span], i3);
+				}
+			}
+		}
+
+		// The last stage alone when there is an odd number.
+		if (span < count)
+		{
+			for (std::uint32_t j = 0; j < span; ++j)
+			{
+				XMVECTOR wr = XMVectorReplicate(twiddleReal[span + j]);
+				XMVECTOR wi = XMVectorReplicate(sign * twiddleImag[span + j]);
+
+				XMVECTOR ar = XMLoadFloat4A(&real[j]);
+				XMVECTOR ai = XMLoadFloat4A(&imag[j]);
+				XMVECTOR br = XMLoadFloat4A(&real[j + span]);
+				XMVECTOR bi = XMLoadFloat4A(&imag[j + span]);
+
+				Butterfly(ar, ai, br, bi, wr, wi);
+
+				XMStoreFloat4A(&real[j], ar);
+				XMStoreFloat4A(&imag[j], ai);
+				XMStoreFloat4A(&real[j + span], br);
+				XMStoreFloat4A(&imag[j + span], bi);
+			}
+		}
+	}
+}
+
+void Fft::Create(std::uint32_t size)
+{
+	PROFILE_FUNCTION();
+
+	mSize = size;
+	mTaskCount = ThreadPool::Get().ThreadCount();
+
+	std::uint32_t bits = 0;
+	while ((1u << bits) < size)
+		++bits;
+
+	mReversed.resize(size);
+	for (std::uint32_t i = 0; i < size; ++i)
+	{
+		std::uint32_t reversed = 0;
+		for (std::uint32_t bit = 0; bit < bits; ++bit)
+			reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+		mReversed[i] = reversed;
+	}
+
+	mTwiddleReal.assign(size, 0.0f);
+	mTwiddleImag.assign(size, 0.0f);
+	for (std::uint32_t span = 1; span < size; span *= 2)
+	{
+		for (std::uint32_t j = 0; j < span; ++j)
+		{
+			double angle = -Pi * j / span;
+			mTwiddleReal[span + j] = (float)std::cos(angle);
+			mTwiddleImag[span + j] = (float)std::sin(angle);
+		}
+	}
+
+	mScratch.resize((size_t)mTaskCount * ColumnStrips * 2 * size);
+}
+
+void Fft::Transform(float* real, float* imag, bool inverse)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t n = mSize;
+	const std::uint32_t strips = n / 4;
+	const std::uint32_t taskCount = mTaskCount;
+	const float sign = inverse ? -1.0f : 1.0f;
+
+	// Rows, four at a time, transposed so each vector holds a point of
+	// each row.
+	ThreadPool::Get().ParallelFor(taskCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t task = begin; task < end; ++task)
+		{
+			XMFLOAT4A* stripReal = &mScratch[(size_t)task * ColumnStrips * 2 * n];
+			XMFLOAT4A* stripImag = stripReal + n;
+
+			for (std::uint32_t strip = task * strips / taskCount; strip < (task + 1) * strips / taskCount; ++strip)
+			{
+				float* rowsReal = real + (size_t)strip * 4 * n;
+				float* rowsImag = imag + (size_t)strip * 4 * n;
+
+				for (std::uint32_t x = 0; x < n; x += 4)
+				{
+					XMMATRIX re, im;
+					for (std::uint32_t k = 0; k < 4; ++k)
+					{
+						re.r[k] = XMLoadFloat4((const XMFLOAT4*)&rowsReal[k * n + x]);
+						im.r[k] = XMLoadFloat4((const XMFLOAT4*)&rowsImag[k * n + x]);
+					}
+
+					re = XMMatrixTranspose(re);
+					im = XMMatrixTranspose(im);
+					for (std::uint32_t k = 0; k < 4; ++k)
+					{
+						XMStoreFloat4A(&stripReal[mReversed[x + k]], re.r[k]);
+						XMStoreFloat4A(&stripImag[mReversed[x + k]], im.r[k]);
+					}
+				}
+
+				Butterflies(stripReal, stripImag, n, mTwiddleReal.data(), mTwiddleImag.data(), sign);
+
+				for (std::uint32_t x = 0; x < n; x += 4)
+				{
+					XMMATRIX re, im;
+					for (std::uint32_t k = 0; k < 4; ++k)
+					{
+						re.r[k] = XMLoadFloat4A(&stripReal[x + k]);
+						im.r[k] = XMLoadFloat4A(&stripImag[x + k]);
+					}
+
+					re = XMMatrixTranspose(re);
+					im = XMMatrixTranspose(im);
+					for (std::uint32_t k = 0; k < 4; ++k)
+					{
+						XMStoreFloat4((XMFLOAT4*)&rowsReal[k * n + x], re.r[k]);
+						XMStoreFloat4((XMFLOAT4*)&rowsImag[k * n + x], im.r[k]);
+					}
+				}
+			}
+		}
+	});
+
+	// Columns, sixteen at a time as four strips, so each cache line of a
+	// row is read whole.  Rows a power of two apart fall in the same cache
+	// sets, and gathering fewer columns would have the next strip miss on
+	// the lines this one had.
+	const std::uint32_t group = strips < ColumnStrips ? strips : ColumnStrips;
+	const std::uint32_t groups = strips / group;
+
+	ThreadPool::Get().ParallelFor(taskCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t task = begin; task < end; ++task)
+		{
+			XMFLOAT4A* scratch = &mScratch[(size_t)task * ColumnStrips * 2 * n];
+
+			for (std::uint32_t g = task * groups / taskCount; g < (task + 1) * groups / taskCount; ++g)
+			{
+				float* columnsReal = real + g * group * 4;
+				float* columnsImag = imag + g * group * 4;
+
+				for (std::uint32_t y = 0; y < n; ++y)
+				{
+					for (std::uint32_t s = 0; s < group; ++s)
+					{
+						XMStoreFloat4A(&scratch[2 * s * n + mReversed[y]], XMLoadFloat4((const XMFLOAT4*)&columnsReal[(size_t)y * n + s * 4]));
+						XMStoreFloat4A(&scratch[(2 * s + 1) * n + mReversed[y]], XMLoadFloat4((const XMFLOAT4*)&columnsImag[(size_t)y * n + s * 4]));
+					}
+				}
+
+				for (std::uint32_t s = 0; s < group; ++s)
+					Butterflies(&scratch[2 * s * n], &scratch[(2 * s + 1) * n], n, mTwiddleReal.data(), mTwiddleImag.data(), sign);
+
+				for (std::uint32_t y = 0; y < n; ++y)
+				{
+					for (std::uint32_t s = 0; s < group; ++s)
+					{
+						XMStoreFloat4((XMFLOAT4*)&columnsReal[(size_t)y * n + s * 4], XMLoadFloat4A(&scratch[2 * s * n + y]));
+						XMStoreFloat4((XMFLOAT4*)&columnsImag[(size_t)y * n + s * 4], XMLoadFloat4A(&scratch[(2 * s + 1) * n + y]));
+					}
+				}
+			}
+		}
+	});
+}
+
+std::uint32_t Fft::Size()const
+{
+	return mSize;
+}
@@ -0,0 +1,277 @@
+#include "FramePacer.h"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "WinMM")
+#endif
+
+HighResolutionClock::HighResolutionClock()
+	: mWoken(false)
+{
+#ifdef _WIN32
+	// The default 15.6 ms scheduler tick would make every sleep overshoot.
+	timeBeginPeriod(1);
+#endif
+}
+
+HighResolutionClock::~HighResolutionClock()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+std::int64_t HighResolutionClock::Now()
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+std::int64_t HighResolutionClock::TicksPerSecond()
+{
+	return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+}
+
+void HighResolutionClock::Sleep(std::int64_t ticks)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mWakeCondition.wait_for(lock, std::chrono::steady_clock::duration(ticks), [this] { return mWoken; });
+	mWoken = false;
+}
+
+void HighResolutionClock::Wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mWoken = true;
+	}
+	mWakeCondition.notify_one();
+}
+
+void HighResolutionClock::Spin()
+{
+	std::this_thread::yield();
+}
+
+FramePacer::FramePacer(PacingClock* clock)
+	: mClock(clock),
+	mOwnsClock(clock == nullptr),
+	mTargetFrameRate(0.0),
+	mIdleStartFrameRate(10.0),
+	mIdleMinFrameRate(2.0),
+	mIdle(false),
+	mIdleSince(0),
+	mNextDeadline(0),
+	mLastFrameStart(0)
+{
+	if (mOwnsClock)
+		mClock = new HighResolutionClock();
+
+	mSecondsPerTick = 1.0 / (double)mClock->TicksPerSecond();
+
+	SetSpinThreshold(0.002);
+	ResetStats();
+}
+
+FramePacer::~FramePacer()
+{
+	if (mOwnsClock)
+		delete mClock;
+}
+
+void FramePacer::SetTargetFrameRate(double fps)
+{
+	mTargetFrameRate = fps > 0.0 ? fps : 0.0;
+
+	// Restart the deadline sequence from the next frame.
+	mNextDeadline = 0;
+}
+
+double FramePacer::TargetFrameRate()const
+{
+	return mTargetFrameRate;
+}
+
+void FramePacer::SetIdleFrameRate(double startFps, double minFps)
+{
+	mIdleStartFrameRate = startFps;
+	mIdleMinFrameRate = minFps < startFps ? minFps : startFps;
+}
+
+void FramePacer::SetSpinThreshold(double seconds)
+{
+	mSpinThreshold = (std::int64_t)(seconds / mSecondsPerTick);
+}
+
+void FramePacer::SetIdle(bool idle)
+{
+	if (idle == mIdle)
+		return;
+
+	mIdle = idle;
+	mIdleSince = mClock->Now();
+	mNextDeadline = 0;
+
+	// The gap spent idle is not an interval between paced frames.
+	mLastFrameStart = 0;
+}
+
+bool FramePacer::IsIdle()const
+{
+	return mIdle;
+}
+
+std::int64_t FramePacer::CurrentPeriod(std::int64_t now)
+{
+	double fps = mTargetFrameRate;
+
+	if (mIdle)
+	{
+		// Halve the rate for every full second spent idle.
+		double idleSeconds = (now - mIdleSince) * mSecondsPerTick;
+		fps = mIdleStartFrameRate * std::pow(0.5, std::floor(idleSeconds));
+		if (fps < mIdleMinFrameRate)
+			fps = mIdleMinFrameRate;
+	}
+
+	if (fps <= 0.0)
+		return 0;
+
+	return (std::int64_t)(1.0 / (fps * mSecondsPerTick));
+}
+
+double FramePacer::WaitForNextFrame()
+{
+	std::int64_t now = mClock->Now();
+	std::int64_t period = CurrentPeriod(now);
+
+	if (period == 0)
+	{
+		if (!mIdle)
+			Record(now, now);
+		return 0.0;
+	}
+
+	if (mNextDeadline == 0)
+		mNextDeadline = now + period;
+
+	std::int64_t deadline = mNextDeadline;
+
+	if (mIdle)
+	{
+		// Idle frames accept the sleep's inaccuracy, and a Wake ends the
+		// sleep so input is handled at once.
+		if (deadline > now)
+		{
+			mClock->Sleep(deadline - now);
+			now = mClock->Now();
+		}
+	}
+	else
+	{
+		// Sleep through most of the wait and spin up to the deadline.  Input
+		// waits for the next frame here, so a Wake, or one left over from
+		// an earlier frame, only costs another sleep, not a long spin.
+		std::int64_t sleepUntil = deadline - mSpinThreshold;
+		while (now < sleepUntil)
+		{
+			mClock->Sleep(sleepUntil - now);
+			now = mClock->Now();
+		}
+
+		while (now < deadline)
+		{
+			mClock->Spin();
+			now = mClock->Now();
+		}
+	}
+
+	// A Wake can end an idle sleep early; the frame then starts right away
+	// and the next deadline is measured from it.
+	if (now < deadline)
+		deadline = now;
+
+	// Keep a fixed cadence, but if we fell more than a whole period behind
+	// start over from now instead of rushing frames to catch up.
+	mNextDeadline = deadline + period;
+	if (now - deadline > period)
+		mNextDeadline = now + period;
+
+	// Idle frames are late or early on purpose, so only active ones count.
+	if (!mIdle)
+		Record(now, deadline);
+
+	return (now - deadline) * mSecondsPerTick;
+}
+
+void FramePacer::Wake()
+{
+	mClock->Wake();
+}
+
+void FramePacer::Record(std::int64_t now, std::int64_t deadline)
+{
+	double error = (now - deadline) * mSecondsPerTick;
+
+	mErrorHistory[mHistoryIndex] = (float)error;
+	mHistoryIndex = (mHistoryIndex + 1) % HistorySize;
+
+	mStats.FrameCount++;
+	mErrorSum += error;
+	mStats.MeanError = mErrorSum / mStats.FrameCount;
+	if (error > mStats.MaxError)
+		mStats.MaxError = error;
+
+	if (mLastFrameStart != 0)
+	{
+		double interval = (now - mLastFrameStart) * mSecondsPerTick;
+
+		mIntervalCount++;
+		mIntervalSum += interval;
+		mIntervalSqSum += interval * interval;
+
+		double mean = mIntervalSum / mIntervalCount;
+		double variance = mIntervalSqSum / mIntervalCount - mean * mean;
+
+		mStats.MeanInterval = mean;
+		mStats.IntervalJitter = variance > 0.0 ? std::sqrt(variance) : 0.0;
+	}
+
+	mLastFrameStart = now;
+}
+
+const PacingStats& FramePacer::Stats()const
+{
+	return mStats;
+}
+
+void FramePacer::ResetStats()
+{
+	mStats.FrameCount = 0;
+	mStats.MeanError = 0.0;
+	mStats.MaxError = 0.0;
+	mStats.MeanInterval = 0.0;
+	mStats.IntervalJitter = 0.0;
+
+	mErrorSum = 0.0;
+	mIntervalSum = 0.0;
+	mIntervalSqSum = 0.0;
+	mIntervalCount = 0;
+	mLastFrameStart = 0;
+
+	for (std::uint32_t i = 0; i < HistorySize; ++i)
+		mErrorHistory[i] = 0.0f;
+	mHistoryIndex = 0;
+}
+
+double FramePacer::ErrorHistory(std::uint32_t framesAgo)const
+{
+	if (framesAgo >= HistorySize)
+		return 0.0;
+
+	return mErrorHistory[(mHistoryIndex + HistorySize - 1 - framesAgo) % HistorySize];
+}
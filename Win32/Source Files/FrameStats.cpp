@@ -0,0 +1,218 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+const double FrameStats::BucketWidthMs = 0.25;
+const double FrameStats::StutterFactor = 2.0;
+
+FrameStats::FrameStats()
+{
+	Reset();
+}
+
+void FrameStats::Reset()
+{
+	mFrameCount.store(0, std::memory_order_relaxed);
+
+	for (std::uint32_t i = 0; i < RingSize; ++i)
+	{
+		mRing[i].store(0.0f, std::memory_order_relaxed);
+		mStutterRing[i].store(false, std::memory_order_relaxed);
+	}
+
+	for (std::uint32_t i = 0; i <= BucketCount; ++i)
+		mHistogram[i].store(0, std::memory_order_relaxed);
+
+	mSessionMinMs.store(0.0, std::memory_order_relaxed);
+	mSessionMaxMs.store(0.0, std::memory_order_relaxed);
+	mSessionSumMs.store(0.0, std::memory_order_relaxed);
+	mSessionStutters.store(0, std::memory_order_relaxed);
+
+	mAverageMs = 0.0;
+}
+
+std::uint32_t FrameStats::BucketIndex(double frameMs)
+{
+	if (frameMs <= 0.0)
+		return 0;
+
+	double bucket = frameMs / BucketWidthMs;
+	return bucket >= BucketCount ? BucketCount : (std::uint32_t)bucket;
+}
+
+void FrameStats::AddFrame(double frameMs)
+{
+	std::uint64_t count = mFrameCount.load(std::memory_order_relaxed);
+
+	mRing[count & (RingSize - 1)].store((float)frameMs, std::memory_order_relaxed);
+
+	std::uint32_t bucket = BucketIndex(frameMs);
+	mHistogram[bucket].store(mHistogram[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	if (count == 0 || frameMs < mSessionMinMs.load(std::memory_order_relaxed))
+		mSessionMinMs.store(frameMs, std::memory_order_relaxed);
+	if (frameMs > mSessionMaxMs.load(std::memory_order_relaxed))
+		mSessionMaxMs.store(frameMs, std::memory_order_relaxed);
+	mSessionSumMs.store(mSessionSumMs.load(std::memory_order_relaxed) + frameMs, std::memory_order_relaxed);
+
+	bool stutter = count > 0 && frameMs > StutterFactor * mAverageMs;
+	mStutterRing[count & (RingSize - 1)].store(stutter, std::memory_order_relaxed);
+	if (stutter)
+		mSessionStutters.store(mSessionStutters.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	mAverageMs = count == 0 ? frameMs : mAverageMs + 0.05 * (frameMs - mAverageMs);
+
+	mFrameCount.store(count + 1, std::memory_order_release);
+}
+
+std::uint64_t FrameStats::FrameCount()const
+{
+	return mFrameCount.load(std::memory_order_acquire);
+}
+
+double FrameStats::Percentile(const std::uint32_t* buckets, std::uint32_t total, double fraction)
+{
+	if (total == 0)
+		return 0.0;
+
+	// Rank of the requested sample, then walk the cumulative counts and
+	// interpolate within the bucket that contains it.
+	double rank = fraction * total;
+	std::uint32_t cumulative = 0;
+
+	for (std::uint32_t i = 0; i <= BucketCount; ++i)
+	{
+		if (buckets[i] == 0)
+			continue;
+
+		if (cumulative + buckets[i] >= rank)
+		{
+			double within = (rank - cumulative) / buckets[i];
+			return (i + within) * BucketWidthMs;
+		}
+
+		cumulative += buckets[i];
+	}
+
+	return (BucketCount + 1) * BucketWidthMs;
+}
+
+double FrameStats::Percentile(const float* sorted, std::uint32_t count, double fraction)
+{
+	if (count == 0)
+		return 0.0;
+
+	// Interpolate between the two samples either side of the rank.
+	double rank = fraction * (count - 1);
+	std::uint32_t below = (std::uint32_t)rank;
+	if (below + 1 >= count)
+		return sorted[count - 1];
+
+	return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+FrameStatsSummary FrameStats::SummarizeRecent(std::uint32_t frameCount)const
+{
+	FrameStatsSummary summary = { };
+
+	std::uint64_t end = mFrameCount.load(std::memory_order_acquire);
+	if (frameCount > RingSize)
+		frameCount = RingSize;
+	if (frameCount > end)
+		frameCount = (std::uint32_t)end;
+
+	if (frameCount == 0)
+		return summary;
+
+	// Small enough to live on the stack, and sorted for the percentiles.
+	float samples[RingSize];
+
+	double sum = 0.0;
+
+	for (std::uint32_t i = 0; i < frameCount; ++i)
+	{
+		std::uint64_t frame = end - frameCount + i;
+
+		samples[i] = mRing[frame & (RingSize - 1)].load(std::memory_order_relaxed);
+		sum += samples[i];
+		if (mStutterRing[frame & (RingSize - 1)].load(std::memory_order_relaxed))
+			summary.StutterCount++;
+	}
+
+	std::sort(samples, samples + frameCount);
+
+	summary.FrameCount = frameCount;
+	summary.MinMs = samples[0];
+	summary.MaxMs = samples[frameCount - 1];
+	summary.AvgMs = sum / frameCount;
+	summary.P50Ms = Percentile(samples, frameCount, 0.50);
+	summary.P95Ms = Percentile(samples, frameCount, 0.95);
+	summary.P99Ms = Percentile(samples, frameCount, 0.99);
+
+	return summary;
+}
+
+FrameStatsSummary FrameStats::SummarizeSession()const
+{
+	FrameStatsSummary summary = { };
+
+	std::uint32_t buckets[BucketCount + 1];
+	std::uint32_t total = 0;
+
+	for (std::uint32_t i = 0; i <= BucketCount; ++i)
+	{
+		buckets[i] = mHistogram[i].load(std::memory_order_relaxed);
+		total += buckets[i];
+	}
+
+	if (total == 0)
+		return summary;
+
+	summary.FrameCount = total;
+	summary.MinMs = mSessionMinMs.load(std::memory_order_relaxed);
+	summary.MaxMs = mSessionMaxMs.load(std::memory_order_relaxed);
+	summary.AvgMs = mSessionSumMs.load(std::memory_order_relaxed) / total;
+	summary.P50Ms = Percentile(buckets, total, 0.50);
+	summary.P95Ms = Percentile(buckets, total, 0.95);
+	summary.P99Ms = Percentile(buckets, total, 0.99);
+
+	// The buckets are coarser than the extremes, and the overflow bucket
+	// has no upper edge.
+	summary.P50Ms = std::min(std::max(summary.P50Ms, summary.MinMs), summary.MaxMs);
+	summary.P95Ms = std::min(std::max(summary.P95Ms, summary.MinMs), summary.MaxMs);
+	summary.P99Ms = std::min(std::max(summary.P99Ms, summary.MinMs), summary.MaxMs);
+	summary.StutterCount = mSessionStutters.load(std::memory_order_relaxed);
+
+	return summary;
+}
+
+namespace
+{
+	void WriteSummaryJson(std::ofstream& ofs, const char* name, const FrameStatsSummary& s)
+	{
+		char line[512];
+		snprintf(line, sizeof(line),
+			"  \"%s\": { \"frames\": %u, \"min_ms\": %.4f, \"avg_ms\": %.4f, \"p50_ms\": %.4f, "
+			"\"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"stutters\": %u },\n",
+			name, s.FrameCount, s.MinMs, s.AvgMs, s.P50Ms, s.P95Ms, s.P99Ms, s.MaxMs, s.StutterCount);
+		ofs << line;
+	}
+}
+
+bool FrameStats::WriteJson(const char* path)const
+{
+	std::ofstream ofs(path);
+	if (!ofs)
+		return false;
+
+	ofs << "{\n";
+	WriteSummaryJson(ofs, "recent", SummarizeRecent(RingSize));
+	WriteSummaryJson(ofs, "session", SummarizeSession());
+
+	ofs << "  \"histogram\": { \"bucket_ms\": " << BucketWidthMs << ", \"counts\": [";
+	for (std::uint32_t i = 0; i <= BucketCount; ++i)
+		ofs << (i == 0 ? "" : ", ") << mHistogram[i].load(std::memory_order_relaxed);
+	ofs << "] }\n}\n";
+
+	return ofs.good();
+}
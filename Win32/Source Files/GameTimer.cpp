@@ -2,17 +2,28 @@
 #include "GameTimer.h"
 
 GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+: mSecondsPerCount(0.0), mDeltaTime(-1.0), mCountsPerSecond(0), mDeltaTicks(0),
+  mBaseTime(0), mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
 	__int64 countsPerSec;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mCountsPerSecond = countsPerSec;
 	mSecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
 // time when the clock is stopped.
 float GameTimer::TotalTime()const
+{
+	return (float)TotalTimeSeconds();
+}
+
+double GameTimer::TotalTimeSeconds()const
+{
+	return TotalTicks()*mSecondsPerCount;
+}
+
+__int64 GameTimer::TotalTicks()const
 {
 	// If we are stopped, do not count the time that has passed since we stopped.
 	// Moreover, if we previously already had a pause, the distance 
@@ -25,7 +36,7 @@ float GameTimer::TotalTime()const
 
 	if( mStopped )
 	{
-		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (mStopTime - mPausedTime)-mBaseTime;
 	}
 
 	// The distance mCurrTime - mBaseTime includes paused time,
@@ -40,7 +51,7 @@ float GameTimer::TotalTime()const
 	
 	else
 	{
-		return (float)(((mCurrTime-mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (mCurrTime-mPausedTime)-mBaseTime;
 	}
 }
 
@@ -49,6 +60,16 @@ float GameTimer::DeltaTime()const
 	return (float)mDeltaTime;
 }
 
+__int64 GameTimer::DeltaTicks()const
+{
+	return mDeltaTicks;
+}
+
+__int64 GameTimer::TicksPerSecond()const
+{
+	return mCountsPerSecond;
+}
+
 void GameTimer::Reset()
 {
 	__int64 currTime;
@@ -56,6 +77,8 @@ void GameTimer::Reset()
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
 }
@@ -98,6 +121,7 @@ void GameTimer::Tick()
 	if( mStopped )
 	{
 		mDeltaTime = 0.0;
+		mDeltaTicks = 0;
 		return;
 	}
 
@@ -106,7 +130,8 @@ void GameTimer::Tick()
 	mCurrTime = currTime;
 
 	// Time difference between this frame and the previous.
-	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
+	mDeltaTicks = mCurrTime - mPrevTime;
+	mDeltaTime = mDeltaTicks*mSecondsPerCount;
 
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
@@ -117,5 +142,6 @@ void GameTimer::Tick()
 	if(mDeltaTime < 0.0)
 	{
 		mDeltaTime = 0.0;
+		mDeltaTicks = 0;
 	}
 }
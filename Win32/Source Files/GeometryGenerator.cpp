@@ -3,12 +3,17 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <cstring>
 
 using namespace DirectX;
 
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
     //
@@ -102,6 +107,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 
 GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
 	//
@@ -114,6 +121,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
+	// Two poles plus (stackCount-1) rings of sliceCount+1 vertices; sliceCount
+	// triangles per polar stack and 2*sliceCount per inner stack.
+	meshData.Vertices.reserve(2 + (stackCount-1)*(sliceCount+1));
+	meshData.Indices32.reserve(6*sliceCount*(stackCount-1));
+
 	meshData.Vertices.push_back( topVertex );
 
 	float phiStep   = XM_PI/stackCount;
@@ -124,28 +136,35 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	{
 		float phi = i*phiStep;
 
+		// The whole ring shares phi.
+		float sinPhi = sinf(phi);
+		float cosPhi = cosf(phi);
+
 		// Vertices of ring.
         for(uint32 j = 0; j <= sliceCount; ++j)
 		{
 			float theta = j*thetaStep;
 
+			float sinTheta = sinf(theta);
+			float cosTheta = cosf(theta);
+
 			Vertex v;
 
 			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
+			v.Position.x = radius*sinPhi*cosTheta;
+			v.Position.y = radius*cosPhi;
+			v.Position.z = radius*sinPhi*sinTheta;
 
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
+			// Partial derivative of P with respect to theta, normalized.  It
+			// has length radius*sin(phi), so it is (-sin(theta), 0, cos(theta)).
+			v.TangentU.x = -sinTheta;
 			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+			v.TangentU.z = +cosTheta;
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
-
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+			// The unit sphere position is the normal.
+			v.Normal.x = sinPhi*cosTheta;
+			v.Normal.y = cosPhi;
+			v.Normal.z = sinPhi*sinTheta;
 
 			v.TexC.x = theta / XM_2PI;
 			v.TexC.y = phi / XM_PI;
@@ -213,12 +232,17 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
+    PROFILE_FUNCTION();
 
+	// Take the input geometry; meshData is rebuilt from it below.  Swapping
+	// the vectors out avoids copying them.
+	MeshData inputCopy;
+	inputCopy.Vertices.swap(meshData.Vertices);
+	inputCopy.Indices32.swap(meshData.Indices32);
 
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// Every input triangle becomes 6 vertices and 4 triangles.
+	meshData.Vertices.reserve(inputCopy.Indices32.size()*2);
+	meshData.Indices32.reserve(inputCopy.Indices32.size()*4);
 
 	//       v1
 	//       *
@@ -306,6 +330,8 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
 	// Put a cap on the number of subdivisions.
@@ -381,6 +407,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 
 GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
 	//
@@ -394,6 +422,10 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 
 	uint32 ringCount = stackCount+1;
 
+	// Side rings plus two caps of sliceCount+2 vertices each.
+	meshData.Vertices.reserve(ringCount*(sliceCount+1) + 2*(sliceCount+2));
+	meshData.Indices32.reserve(6*sliceCount*stackCount + 2*3*sliceCount);
+
 	// Compute vertices for each stack ring starting at the bottom and moving up.
 	for(uint32 i = 0; i < ringCount; ++i)
 	{
@@ -550,6 +582,8 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
 	uint32 vertexCount = m*n;
@@ -615,6 +649,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
 {
+    PROFILE_FUNCTION();
+
     MeshData meshData;
 
 	meshData.Vertices.resize(4);
@@ -655,3 +691,377 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 
     return meshData;
 }
+
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+
+	// Cells along each side of the blocks meshed in parallel.
+	const uint32 IsoBlockSize = 32;
+
+	// Marks a triangle index that is a position in IsoBlock::Foreign.
+	const uint32 ForeignBit = 0x80000000;
+
+	// The six tetrahedra of a cube, as corners x + 2y + 4z.  Each runs from
+	// corner 0 to corner 7 along edges that only ever step up, so two cubes
+	// always split the face they share along the same diagonal and the
+	// surface closes across it.
+	const int CubeTetrahedra[6][4] =
+	{
+		{ 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 }, { 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 }
+	};
+
+	// One block's share of the mesh.  A vertex belongs to the block holding
+	// the lower end of its grid edge; triangles using another block's
+	// vertices name them by edge until the blocks are joined.
+	struct IsoBlock
+	{
+		std::vector<GeometryGenerator::Vertex> Vertices;
+
+		// Edge key and local index of every vertex, sorted by key.
+		std::vector<std::pair<std::uint64_t, uint32>> Edges;
+
+		std::vector<uint32> Indices;
+		std::vector<std::uint64_t> Foreign;
+	};
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateIsosurface(const FieldRow& field, const XMFLOAT3& origin, float cellSize,
+	uint32 nx, uint32 ny, uint32 nz, float isoValue)
+{
+    PROFILE_FUNCTION();
+
+	// Coordinates are computed once, so a point on the border of two
+	// blocks is evaluated the same in both and they agree on its side.
+	std::vector<float> xs(nx);
+	for(uint32 x = 0; x < nx; ++x)
+		xs[x] = origin.x + x * cellSize;
+
+	return MarchTetrahedra([&](uint32 x, uint32 y, uint32 z, uint32 count, float* values)
+	{
+		field(&xs[x], origin.y + y * cellSize, origin.z + z * cellSize, count, values);
+	}, origin, cellSize, nx, ny, nz, isoValue);
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateIsosurface(const float* samples, const XMFLOAT3& origin, float cellSize,
+	uint32 nx, uint32 ny, uint32 nz, float isoValue)
+{
+    PROFILE_FUNCTION();
+
+	return MarchTetrahedra([&](uint32 x, uint32 y, uint32 z, uint32 count, float* values)
+	{
+		std::memcpy(values, samples + ((size_t)z * ny + y) * nx + x, count * sizeof(float));
+	}, origin, cellSize, nx, ny, nz, isoValue);
+}
+
+GeometryGenerator::MeshData GeometryGenerator::MarchTetrahedra(const SampleRow& sampleRow, const XMFLOAT3& origin, float cellSize,
+	uint32 nx, uint32 ny, uint32 nz, float isoValue)
+{
+    MeshData meshData;
+
+	if(nx < 2 || ny < 2 || nz < 2)
+		return meshData;
+
+	uint32 blocksX = (nx - 2) / IsoBlockSize + 1;
+	uint32 blocksY = (ny - 2) / IsoBlockSize + 1;
+	uint32 blocksZ = (nz - 2) / IsoBlockSize + 1;
+
+	std::vector<IsoBlock> blocks(blocksX * blocksY * blocksZ);
+
+	// An edge is keyed by its lower point and its direction, one bit per
+	// axis, which is never zero.
+	auto edgeKey = [&](const uint32* point, uint32 direction)
+	{
+		return (((std::uint64_t)point[2] * ny + point[1]) * nx + point[0]) * 7 + direction - 1;
+	};
+
+	auto ownerOf = [&](const uint32* point)
+	{
+		uint32 bx = std::min(point[0] / IsoBlockSize, blocksX - 1);
+		uint32 by = std::min(point[1] / IsoBlockSize, blocksY - 1);
+		uint32 bz = std::min(point[2] / IsoBlockSize, blocksZ - 1);
+		return (bz * blocksY + by) * blocksX + bx;
+	};
+
+	//
+	// Mesh every block on its own.
+	//
+
+	ThreadPool::Get().ParallelFor((uint32)blocks.size(), 1, [&](uint32 begin, uint32 end)
+	{
+		std::vector<float> values;
+		std::vector<int> planes[2];
+
+		for(uint32 b = begin; b < end; ++b)
+		{
+			IsoBlock& block = blocks[b];
+
+			uint32 x0 = (b % blocksX) * IsoBlockSize;
+			uint32 y0 = (b / blocksX % blocksY) * IsoBlockSize;
+			uint32 z0 = (b / (blocksX * blocksY)) * IsoBlockSize;
+			uint32 x1 = std::min(x0 + IsoBlockSize, nx - 1);
+			uint32 y1 = std::min(y0 + IsoBlockSize, ny - 1);
+			uint32 z1 = std::min(z0 + IsoBlockSize, nz - 1);
+
+			// The block's points and one more on every side for gradients.
+			// Past the grid's edge the nearest sample repeats.
+			uint32 sx = x1 - x0 + 3;
+			uint32 sy = y1 - y0 + 3;
+			uint32 sz = z1 - z0 + 3;
+			values.resize((size_t)sx * sy * sz);
+
+			uint32 rowBegin = x0 > 0 ? x0 - 1 : 0;
+			uint32 rowEnd = std::min(x1 + 1, nx - 1);
+
+			for(uint32 k = 0; k < sz; ++k)
+			{
+				uint32 z = (uint32)std::min(std::max((int)(z0 + k) - 1, 0), (int)nz - 1);
+				for(uint32 j = 0; j < sy; ++j)
+				{
+					uint32 y = (uint32)std::min(std::max((int)(y0 + j) - 1, 0), (int)ny - 1);
+					float* row = &values[((size_t)k * sy + j) * sx];
+
+					sampleRow(rowBegin, y, z, rowEnd - rowBegin + 1, row + (rowBegin + 1 - x0));
+					if(x0 == 0)
+						row[0] = row[1];
+					if(x1 + 1 > nx - 1)
+						row[sx - 1] = row[sx - 2];
+				}
+			}
+
+			// Nothing to do in a block wholly on one side.
+			std::pair<std::vector<float>::iterator, std::vector<float>::iterator> range = std::minmax_element(values.begin(), values.end());
+			if(!(*range.first < isoValue) || *range.second < isoValue)
+				continue;
+
+			auto sampleIndex = [&](const uint32* point)
+			{
+				return ((size_t)(point[2] - z0 + 1) * sy + (point[1] - y0 + 1)) * sx + (point[0] - x0 + 1);
+			};
+
+			auto gradient = [&](size_t s)
+			{
+				size_t slice = (size_t)sx * sy;
+				return XMVectorSet(values[s + 1] - values[s - 1], values[s + sx] - values[s - sx], values[s + slice] - values[s - slice], 0.0f);
+			};
+
+			// This block's vertices on edges from the two planes of points a
+			// slice of cells touches, reused as the slices advance.
+			uint32 planeWidth = x1 - x0 + 1;
+			size_t planeSize = (size_t)planeWidth * (y1 - y0 + 1) * 7;
+			planes[0].assign(planeSize, -1);
+			planes[1].assign(planeSize, -1);
+
+			for(uint32 z = z0; z < z1; ++z)
+			{
+				if(z > z0)
+					std::fill(planes[(z + 1 - z0) & 1].begin(), planes[(z + 1 - z0) & 1].end(), -1);
+
+				for(uint32 y = y0; y < y1; ++y)
+				{
+					for(uint32 x = x0; x < x1; ++x)
+					{
+						// Most cells are wholly on one side.
+						uint32 cell[3] = { x, y, z };
+						size_t s = sampleIndex(cell);
+						size_t slice = (size_t)sx * sy;
+						size_t cube[8] = { s, s + 1, s + sx, s + sx + 1, s + slice, s + slice + 1, s + slice + sx, s + slice + sx + 1 };
+
+						int below = 0;
+						for(size_t c : cube)
+							below += values[c] < isoValue;
+						if(below == 0 || below == 8)
+							continue;
+
+						for(const int* tetrahedron : CubeTetrahedra)
+						{
+							uint32 corners[4][3];
+							float v[4];
+							uint32 inside = 0;
+
+							for(int t = 0; t < 4; ++t)
+							{
+								int c = tetrahedron[t];
+								corners[t][0] = x + (c & 1);
+								corners[t][1] = y + ((c >> 1) & 1);
+								corners[t][2] = z + ((c >> 2) & 1);
+								v[t] = values[sampleIndex(corners[t])];
+								if(v[t] < isoValue)
+									inside |= 1 << t;
+							}
+
+							if(inside == 0 || inside == 15)
+								continue;
+
+							// Corners come in the order of the path, so the first
+							// of two is always the lower end of their edge.
+							auto edgeVertex = [&](int a, int c) -> uint32
+							{
+								int lo = std::min(a, c);
+								int hi = std::max(a, c);
+								const uint32* p = corners[lo];
+								const uint32* q = corners[hi];
+								uint32 direction = (q[0] - p[0]) | ((q[1] - p[1]) << 1) | ((q[2] - p[2]) << 2);
+
+								if(ownerOf(p) != b)
+								{
+									block.Foreign.push_back(edgeKey(p, direction));
+									return ForeignBit | (uint32)(block.Foreign.size() - 1);
+								}
+
+								int& slot = planes[(p[2] - z0) & 1][((size_t)(p[1] - y0) * planeWidth + (p[0] - x0)) * 7 + direction - 1];
+								if(slot < 0)
+								{
+									float s = (isoValue - v[lo]) / (v[hi] - v[lo]);
+
+									XMVECTOR lower = XMVectorSet((float)p[0], (float)p[1], (float)p[2], 0.0f);
+									XMVECTOR upper = XMVectorSet((float)q[0], (float)q[1], (float)q[2], 0.0f);
+									XMVECTOR position = XMVectorAdd(XMLoadFloat3(&origin), XMVectorScale(XMVectorLerp(lower, upper, s), cellSize));
+
+									XMVECTOR normal = XMVector3Normalize(XMVectorLerp(gradient(sampleIndex(p)), gradient(sampleIndex(q)), s));
+									if(XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+										normal = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+									// Texture coordinates are projected from above, so
+									// u runs along x.
+									XMVECTOR tangent = XMVectorSubtract(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorScale(normal, XMVectorGetX(normal)));
+									if(XMVectorGetX(XMVector3LengthSq(tangent)) < 1e-6f)
+										tangent = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+									Vertex vertex;
+									XMStoreFloat3(&vertex.Position, position);
+									XMStoreFloat3(&vertex.Normal, normal);
+									XMStoreFloat3(&vertex.TangentU, XMVector3Normalize(tangent));
+									vertex.TexC.x = (p[0] + s * (q[0] - p[0])) / (nx - 1);
+									vertex.TexC.y = 1.0f - (p[2] + s * (q[2] - p[2])) / (nz - 1);
+
+									slot = (int)block.Vertices.size();
+									block.Vertices.push_back(vertex);
+									block.Edges.push_back(std::make_pair(edgeKey(p, direction), (uint32)slot));
+								}
+
+								return (uint32)slot;
+							};
+
+							int in[4];
+							int out[4];
+							int inCount = 0;
+							int outCount = 0;
+							std::int64_t towardsOut[3] = { 0, 0, 0 };
+
+							for(int t = 0; t < 4; ++t)
+							{
+								if(inside & (1 << t))
+									in[inCount++] = t;
+								else
+									out[outCount++] = t;
+							}
+
+							// Facing is decided on the edges' midpoints, in doubled
+							// grid units so it is exact: a triangle faces outward
+							// when its normal points from the inside corners to the
+							// outside ones.
+							for(int a = 0; a < 3; ++a)
+							{
+								for(int t = 0; t < inCount; ++t)
+									towardsOut[a] -= (std::int64_t)corners[in[t]][a] * outCount;
+								for(int t = 0; t < outCount; ++t)
+									towardsOut[a] += (std::int64_t)corners[out[t]][a] * inCount;
+							}
+
+							auto emit = [&](int a0, int c0, int a1, int c1, int a2, int c2)
+							{
+								std::int64_t m[3][3];
+								for(int a = 0; a < 3; ++a)
+								{
+									m[0][a] = (std::int64_t)corners[a0][a] + corners[c0][a];
+									m[1][a] = (std::int64_t)corners[a1][a] + corners[c1][a];
+									m[2][a] = (std::int64_t)corners[a2][a] + corners[c2][a];
+								}
+
+								std::int64_t e1[3] = { m[1][0] - m[0][0], m[1][1] - m[0][1], m[1][2] - m[0][2] };
+								std::int64_t e2[3] = { m[2][0] - m[0][0], m[2][1] - m[0][1], m[2][2] - m[0][2] };
+								std::int64_t facing =
+									(e1[1] * e2[2] - e1[2] * e2[1]) * towardsOut[0] +
+									(e1[2] * e2[0] - e1[0] * e2[2]) * towardsOut[1] +
+									(e1[0] * e2[1] - e1[1] * e2[0]) * towardsOut[2];
+
+								uint32 i0 = edgeVertex(a0, c0);
+								uint32 i1 = edgeVertex(a1, c1);
+								uint32 i2 = edgeVertex(a2, c2);
+
+								block.Indices.push_back(i0);
+								block.Indices.push_back(facing >= 0 ? i1 : i2);
+								block.Indices.push_back(facing >= 0 ? i2 : i1);
+							};
+
+							if(inCount == 1 || outCount == 1)
+							{
+								// One corner cut off by a triangle.
+								int lone = inCount == 1 ? in[0] : out[0];
+								const int* others = inCount == 1 ? out : in;
+								emit(lone, others[0], lone, others[1], lone, others[2]);
+							}
+							else
+							{
+								// Two against two: a quad around the tetrahedron.
+								emit(in[0], out[0], in[0], out[1], in[1], out[1]);
+								emit(in[0], out[0], in[1], out[1], in[1], out[0]);
+							}
+						}
+					}
+				}
+			}
+
+			std::sort(block.Edges.begin(), block.Edges.end());
+		}
+	});
+
+	//
+	// Join the blocks in order, resolving the vertices they share.
+	//
+
+	std::vector<uint32> vertexBase(blocks.size() + 1, 0);
+	std::vector<uint32> indexBase(blocks.size() + 1, 0);
+	for(size_t b = 0; b < blocks.size(); ++b)
+	{
+		vertexBase[b + 1] = vertexBase[b] + (uint32)blocks[b].Vertices.size();
+		indexBase[b + 1] = indexBase[b] + (uint32)blocks[b].Indices.size();
+	}
+
+	meshData.Vertices.resize(vertexBase.back());
+	meshData.Indices32.resize(indexBase.back());
+
+	ThreadPool::Get().ParallelFor((uint32)blocks.size(), 1, [&](uint32 begin, uint32 end)
+	{
+		for(uint32 b = begin; b < end; ++b)
+		{
+			const IsoBlock& block = blocks[b];
+			std::copy(block.Vertices.begin(), block.Vertices.end(), meshData.Vertices.begin() + vertexBase[b]);
+
+			for(size_t i = 0; i < block.Indices.size(); ++i)
+			{
+				uint32 index = block.Indices[i];
+				if(index & ForeignBit)
+				{
+					std::uint64_t key = block.Foreign[index & ~ForeignBit];
+					std::uint64_t point = key / 7;
+					uint32 p[3] = { (uint32)(point % nx), (uint32)(point / nx % ny), (uint32)(point / ((std::uint64_t)nx * ny)) };
+
+					uint32 owner = ownerOf(p);
+					const std::vector<std::pair<std::uint64_t, uint32>>& edges = blocks[owner].Edges;
+					auto found = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, (uint32)0));
+					index = vertexBase[owner] + found->second;
+				}
+				else
+				{
+					index += vertexBase[b];
+				}
+
+				meshData.Indices32[indexBase[b] + i] = index;
+			}
+		}
+	});
+
+    return meshData;
+}
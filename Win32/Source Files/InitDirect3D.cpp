@@ -2,6 +2,41 @@
 #pragma comment(lib, "WinMM")
 
 #include "d3dApp.h"
+#include "AmbientOcclusion.h"
+#include "Animation.h"
+#include "BezierSurface.h"
+#include "Bvh.h"
+#include "AnimationCompression.h"
+#include "BlockCompression.h"
+#include "Broadphase.h"
+#include "DdsFile.h"
+#include "DistanceField.h"
+#include "GeometryTables.h"
+#include "MappedFile.h"
+#include "MeshExtraction.h"
+#include "MorphTargets.h"
+#include "Ocean.h"
+#include "ParticleSystem.h"
+#include "SceneGraph.h"
+#include "Terrain.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "VoxelOctree.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
 
 using namespace std;
 using namespace DirectX;
@@ -10,6 +45,7 @@ struct Vertex
 {
 	XMFLOAT3 Pos;
 	XMFLOAT4 Color;
+	XMFLOAT2 TexC;
 };
 
 struct ConstantBuffer
@@ -17,7 +53,25 @@ struct ConstantBuffer
 	XMFLOAT4X4 WorldViewProj;
 };
 
-class InitDirect3DApp : public D3DApp
+// Everything DrawScene needs from UpdateScene for one frame.
+struct SceneState
+{
+	XMFLOAT4X4 BoxWorld;
+	XMFLOAT4X4 SphereWorld;
+	XMFLOAT4X4 BlobWorld;
+	XMFLOAT4X4 BezierWorld;
+
+	// One per mesh node of the imported files.
+	vector<XMFLOAT4X4> MeshPartWorlds;
+
+	XMFLOAT4X4 ViewProj;
+
+	// The camera's axes in world space, for billboards.
+	XMFLOAT3 CameraRight;
+	XMFLOAT3 CameraUp;
+};
+
+class InitDirect3DApp : public D3DApp, public StreamingDevice
 {
 public:
 	InitDirect3DApp(HINSTANCE hInstance);
@@ -27,15 +81,52 @@ public:
 	void OnResize();
 	void UpdateScene(float dt);
 	void DrawScene();
+	int AppendCaptionStats(wchar_t* text, int capacity);
+	void OnMouseDown(WPARAM btnState, int x, int y);
+	void OnKeyDown(WPARAM key);
+
+	void* CreateTexture(const DdsLayout& layout, const uint8_t* data, uint32_t firstLevel) override;
+	void ReleaseTexture(void* texture) override;
 
 private:
 	void InputAssembler();
-	void DisplayContent(FbxScene* pScene);
-	void DisplayContent(FbxNode* pNode);
-	void DisplayMesh(FbxNode* pNode);
+	void DisplayContent(FbxScene* pScene, SceneGraph::NodeId parent);
+	void DisplayContent(FbxNode* pNode, SceneGraph::NodeId parent);
+	void DisplayMesh(FbxNode* pNode, SceneGraph::NodeId node);
 	void DisplayControlPoints(FbxMesh* pMesh);
 	void DisplayPolygons(FbxMesh* pMesh);
+	void DisplaySkin(FbxMesh* pMesh, UINT baseVertex);
+	void DisplayBlendShapes(FbxMesh* pMesh, UINT baseVertex);
+	void DisplayUVs(FbxMesh* pMesh, UINT baseVertex);
+	void DisplaySkeleton();
+	void DisplayAnimation(FbxScene* pScene);
+	void DisplayPose(FbxTime time, BoneTransform* pose);
+	void AddPickable(const char* name, SceneGraph::NodeId node, const XMFLOAT3* positions, uint32_t positionStride,
+		const uint32_t* indices, uint32_t triangleCount);
+	struct OcclusionBake;
+	OcclusionBake* BakeOcclusion(const string& cacheName, const vector<XMFLOAT3>& positions, const vector<uint32_t>& indices,
+		const Bvh& bvh, XMFLOAT4 color, UINT vertexOffset, vector<float>& visibility);
+	void OcclusionThreadMain();
+	void UpdateOcclusion();
+	void LucyThreadMain();
 	ID3DBlob* LoadShader(const string& filename);
+	TextureStreamer::TextureId LoadAtlas(const string& cookedName, const vector<TextureImage>& images, vector<AtlasRect>& rects,
+		UINT& width, UINT& height);
+	bool CookTexture(const TextureImage& image, MipGenerator::Filter filter, uint64_t tag, const string& cookedName);
+	bool LoadTerrain(const string& cookedName);
+	void UpdateTerrain();
+	bool CreateBezier();
+	void UpdateBezier();
+	bool CreateOcean();
+	void UpdateOcean();
+	bool CreateParticles();
+	void UpdateParticles(float dt);
+	bool CreateBodies();
+	void UpdateBodies(float dt);
+	const vector<BroadphasePair>& BodyPairs()const;
+	GeometryGenerator::MeshData CreateBlob(GeometryGenerator& generator);
+	ID3D11ShaderResourceView* CreateTexture(const vector<TextureImage>& mips);
+	ID3D11ShaderResourceView* CreateTexture(UINT width, UINT height, DXGI_FORMAT format, const vector<D3D11_SUBRESOURCE_DATA>& levels);
 
 private:
 	ID3D11Buffer* mVertexBuffer;
@@ -48,10 +139,174 @@ private:
 	ID3D11InputLayout* mInputLayout;
 	ID3D11RasterizerState* mRasterizerState;
 
-	XMMATRIX mBoxWorld;
-	XMMATRIX mSphereWorld;
-	XMMATRIX mFbx1World;
-	XMMATRIX mFbx2World;
+	// Untextured objects sample a 1x1 white texture so every draw can use
+	// the same shaders.
+	ID3D11ShaderResourceView* mWhiteTexture = nullptr;
+	ID3D11SamplerState* mSamplerState = nullptr;
+
+	// Cooked textures stream their mips in as objects need them.
+	static const size_t TextureBudget = 16 * 1024 * 1024;
+	TextureStreamer mTextureStreamer;
+
+	// Every object samples one atlas, so a single bind covers the scene.
+	// Only the character is textured; its region is this much smaller
+	// than the atlas, which scales up the detail it asks for.
+	TextureStreamer::TextureId mSceneAtlas = TextureStreamer::InvalidTexture;
+	float mFbx2AtlasScale = 0.0f;
+
+	// Bind-pose bounding sphere of the character, for its size on screen.
+	XMFLOAT3 mFbx2Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float mFbx2Radius = 0.0f;
+
+	SceneState mSceneState;
+
+	// Objects the mouse can pick, each with a tree over its triangles in
+	// its own space.
+	struct Pickable
+	{
+		const char* Name;
+		SceneGraph::NodeId Node;
+		Bvh Triangles;
+	};
+
+	vector<Pickable> mPickables;
+	const char* mPickedName = nullptr;
+
+	// Models whose occlusion was not all in the cache are baked further on
+	// a thread of their own, and their vertex colors rewritten each time a
+	// pass finishes.  Each keeps its own tree over the triangles, since
+	// the pickables' can move.
+	static const uint32_t OcclusionSamples = 256;
+	static const uint32_t OcclusionSamplesPerPass = 4;
+
+	struct OcclusionBake
+	{
+		string CacheName;
+		AmbientOcclusionBaker Baker;
+		Bvh Triangles;
+		XMFLOAT4 Color;
+		UINT VertexOffset;
+		vector<Vertex> Vertices;
+
+		// The latest pass's result, under mOcclusionMutex.
+		vector<float> Visibility;
+		bool Updated = false;
+	};
+
+	vector<unique_ptr<OcclusionBake>> mOcclusionBakes;
+	mutex mOcclusionMutex;
+	atomic<bool> mOcclusionStop{false};
+	thread mOcclusionThread;
+
+	// AngelLucy as solid voxels and as a distance field in its own space,
+	// marched alongside the pick to compare with the triangles, from a copy
+	// of the mesh kept for them.  Both are built on a thread of their own,
+	// and picks skip them until mLucyReady is set.
+	vector<XMFLOAT3> mLucyPositions;
+	vector<uint32_t> mLucyIndices;
+	VoxelOctree mLucyVoxels;
+	DistanceField mLucyField;
+	atomic<bool> mLucyReady{false};
+	thread mLucyThread;
+
+	// Patches of the terrain stay in slots of one vertex buffer while they
+	// are drawn, and every patch draws with one of the shared index lists.
+	// UpdateScene builds the patches that are new this frame and DrawScene
+	// uploads them.
+	struct TerrainDraw
+	{
+		UINT Slot;
+		UINT EdgeMask;
+	};
+
+	static const UINT TerrainSlots = 256;
+
+	Terrain mTerrain;
+	TerrainPatchCache mTerrainCache;
+	XMFLOAT3 mTerrainOrigin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT2 mTerrainTexC = XMFLOAT2(0.0f, 0.0f);
+	ID3D11Buffer* mTerrainVertexBuffer = nullptr;
+	ID3D11Buffer* mTerrainIndexBuffer = nullptr;
+	UINT mTerrainIndexOffsets[Terrain::EdgePatterns];
+	UINT mTerrainIndexCounts[Terrain::EdgePatterns];
+	vector<TerrainPatch> mTerrainPatches;
+	TerrainStats mTerrainStats = {};
+	vector<TerrainDraw> mTerrainDraws;
+	vector<UINT> mTerrainUploadSlots;
+	vector<Vertex> mTerrainUploads;
+
+	// Each Bezier patch has a slot of the largest size it can need in the
+	// vertex and index buffers, rewritten when it is retessellated.
+	BezierSurface mBezier;
+	XMFLOAT2 mBezierTexC = XMFLOAT2(0.0f, 0.0f);
+	ID3D11Buffer* mBezierVertexBuffer = nullptr;
+	ID3D11Buffer* mBezierIndexBuffer = nullptr;
+	vector<Vertex> mBezierUploads;
+	double mBezierPatchRate = 0.0;
+
+	// A patch of water flooding the valley floor, one grid vertex per
+	// sample with its vertices rewritten from the fields every frame.
+	Ocean mOcean;
+	XMFLOAT3 mOceanOrigin = XMFLOAT3(0.0f, -2.8f, 0.0f);
+	XMFLOAT2 mOceanTexC = XMFLOAT2(0.0f, 0.0f);
+	ID3D11Buffer* mOceanVertexBuffer = nullptr;
+	ID3D11Buffer* mOceanIndexBuffer = nullptr;
+	UINT mOceanIndexCount = 0;
+	vector<XMFLOAT3> mOceanGrid;
+	vector<Vertex> mOceanUploads;
+	double mOceanMs = 0.0;
+
+	// Fountains of sparks, their billboards streamed through a ring of
+	// vertices.  Each frame's are appended without overwriting, so the
+	// draws still reading earlier ones are not waited on, and the ring is
+	// discarded for a fresh one when full.  It holds a few frames of the
+	// most particles there can be, so that is rare.
+	static const UINT ParticleCapacity = 32768;
+	static const UINT ParticleRingVertices = 3 * 4 * ParticleCapacity;
+
+	ParticleSystem mParticles;
+	XMFLOAT2 mParticleTexC = XMFLOAT2(0.0f, 0.0f);
+	ID3D11Buffer* mParticleVertexBuffer = nullptr;
+	ID3D11Buffer* mParticleIndexBuffer = nullptr;
+	UINT mParticleRingOffset = ParticleRingVertices;
+	double mParticleMs = 0.0;
+
+	// Spheres and cubes bouncing around a room, which swap momentum where
+	// they meet, drawn as cubes and octahedra that turn red while they
+	// touch.  A debug view: F4 cycles them from off to running on sweep
+	// and prune to running on the hash grid, and they stand still while off.
+	enum BodyMode
+	{
+		BodiesOff,
+		BodiesSweepAndPrune,
+		BodiesHashGrid,
+		BodyModeCount
+	};
+
+	static const UINT BodyCount = 4096;
+
+	BodyMode mBodyMode = BodiesOff;
+	vector<XMFLOAT3> mBodyPositions;
+	vector<XMFLOAT3> mBodyVelocities;
+	vector<float> mBodyRadii;
+	vector<uint8_t> mBodyIsBox;
+	vector<uint8_t> mBodyTouching;
+	BoxArrays mBodyBoxes;
+	SweepAndPrune mBroadphase;
+	HashGrid mBodyGrid;
+	double mBroadphaseMs = 0.0;
+	XMFLOAT2 mBodyTexC = XMFLOAT2(0.0f, 0.0f);
+	ID3D11Buffer* mBodyVertexBuffer = nullptr;
+	ID3D11Buffer* mBodyIndexBuffer = nullptr;
+	UINT mBodyIndexCount = 0;
+
+	SceneGraph mSceneGraph;
+	SceneGraph::NodeId mBoxNode;
+	SceneGraph::NodeId mSphereNode;
+	SceneGraph::NodeId mFbx1Node;
+	SceneGraph::NodeId mFbx2Node;
+	SceneGraph::NodeId mBlobNode;
+	SceneGraph::NodeId mBezierNode;
 
 	XMMATRIX mView;
 	XMMATRIX mProj;
@@ -60,19 +315,67 @@ private:
 	UINT mSphereVertexOffset;
 	UINT mFbx1VertexOffset;
 	UINT mFbx2VertexOffset;
+	UINT mBlobVertexOffset;
 
 	UINT mBoxIndexOffset;
 	UINT mSphereIndexOffset;
 	UINT mFbx1IndexOffset;
 	UINT mFbx2IndexOffset;
+	UINT mBlobIndexOffset;
 
 	UINT mBoxIndexCount;
 	UINT mSphereIndexCount;
 	UINT mFbx1IndexCount;
 	UINT mFbx2IndexCount;
+	UINT mBlobIndexCount;
+
+	// A mesh node of an imported file: its range of the index buffer and
+	// the scene graph node whose world matrix it is drawn with.
+	struct MeshPart
+	{
+		SceneGraph::NodeId Node;
+		UINT IndexOffset;
+		UINT IndexCount;
+		UINT VertexOffset;
+	};
+
+	vector<MeshPart> mMeshParts;
 
 	vector<XMFLOAT3> fbxVertices;
 	vector<uint32_t> fbxIndices;
+	vector<XMFLOAT2> fbxTexCoords;
+
+	// Mesh nodes of the file being extracted, with index offsets into
+	// fbxIndices, and the node the file's hierarchy hangs from.
+	vector<MeshPart> fbxParts;
+	SceneGraph::NodeId fbxRootNode = SceneGraph::InvalidNode;
+
+	// Skin data of the file being extracted, indexed like fbxVertices.
+	vector<SkinInfluence> fbxInfluences;
+	vector<FbxNode*> fbxJointNodes;
+	unordered_map<FbxNode*, uint16_t> fbxJointIndices;
+	vector<XMFLOAT4X4A> fbxInverseBindPose;
+	vector<FbxAMatrix> fbxJointGlobals;
+	MorphTargetSet fbxMorphTargets;
+	vector<FbxBlendShapeChannel*> fbxMorphChannels;
+	vector<XMFLOAT3> fbxShapeDeltas;
+
+	// The second model is a rigged character; when it has animation its
+	// vertices are morphed and skinned on the CPU every frame.
+	Skeleton mSkeleton;
+	vector<CompressedClip> mClips;
+	MorphTargetSet mMorphTargets;
+	vector<MorphWeightTrack> mMorphWeights;
+	vector<float> mCurrentMorphWeights;
+	vector<float> mPreviousMorphWeights;
+	vector<XMFLOAT3> mMorphedPositions;
+	Animator mAnimator;
+	vector<XMFLOAT3> mBindPositions;
+	vector<SkinInfluence> mSkinInfluences;
+	vector<Vertex> mSkinnedVertices;
+	UINT mClipIndex = 0;
+	int mPreviousClip = -1;
+	float mAnimationTime = 0.0f;
 
 	float angle = 0.0f;
 };
@@ -86,6 +389,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 #endif
 
 	InitDirect3DApp theApp(hInstance);
+
+	// "-fps N" caps the frame rate with vsync off, for benchmarking.
+	const char* fpsArg = strstr(cmdLine, "-fps ");
+	if (fpsArg)
+		theApp.SetTargetFrameRate(atof(fpsArg + 5));
 	
 	if( !theApp.Init() )
 		return 0;
@@ -100,21 +408,39 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 }
 
 InitDirect3DApp::InitDirect3DApp(HINSTANCE hInstance)
-: D3DApp(hInstance)
+: D3DApp(hInstance), mTextureStreamer(*this, TextureBudget), mTerrainCache(TerrainSlots)
 {
 	XMMATRIX I = XMMatrixIdentity();
 
-	mBoxWorld = I;
-	mSphereWorld = I;
-	mFbx1World = I;
-	mFbx2World = I;
+	// The camera does not move, so the view matrix is built once.
+	XMVECTOR eyePosition = XMVectorSet(0.0f, 0.0f, -7.0f, 1.0f);
+	XMVECTOR focusPosition = XMVectorZero();
+	XMVECTOR upDirection = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
-	mView = I;
+	mView = XMMatrixLookAtLH(eyePosition, focusPosition, upDirection);
 	mProj = I;
+
+	// Fixed roots for the drawn objects.  The sphere never moves, so after
+	// the first update its world matrix is never recomputed.
+	mBoxNode = mSceneGraph.AddNode(SceneGraph::InvalidNode, I);
+	mSphereNode = mSceneGraph.AddNode(SceneGraph::InvalidNode, XMMatrixTranslation(0.0f, 1.0f, 0.0f));
+	mFbx1Node = mSceneGraph.AddNode(SceneGraph::InvalidNode, I);
+	mFbx2Node = mSceneGraph.AddNode(SceneGraph::InvalidNode, I);
+	mBlobNode = mSceneGraph.AddNode(SceneGraph::InvalidNode, I);
+	mBezierNode = mSceneGraph.AddNode(SceneGraph::InvalidNode, I);
 }
 
 InitDirect3DApp::~InitDirect3DApp()
 {
+	// A pass in progress finishes first; they are kept short for this.
+	mOcclusionStop = true;
+	if (mOcclusionThread.joinable())
+		mOcclusionThread.join();
+
+	// A build cannot be stopped part way, so this waits out one begun
+	// just before closing.
+	if (mLucyThread.joinable())
+		mLucyThread.join();
 }
 
 bool InitDirect3DApp::Init()
@@ -122,6 +448,10 @@ bool InitDirect3DApp::Init()
 	if(!D3DApp::Init())
 		return false;
 
+	// Cooked and baked files are derived from Resource Files and can be
+	// deleted at any time; they are made again on the next run.
+	CreateDirectoryA("Cache", nullptr);
+
 	InputAssembler();
 
 	return true;
@@ -136,19 +466,144 @@ void InitDirect3DApp::OnResize()
 
 void InitDirect3DApp::UpdateScene(float dt)
 {
-	// Build the view matrix.
-	XMVECTOR eyePosition = XMVectorSet(0.0f, 0.0f, -7.0f, 1.0f);
-	XMVECTOR focusPosition = XMVectorZero();
-	XMVECTOR upDirection = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	PROFILE_FUNCTION();
 
-	mView = XMMatrixLookAtLH(eyePosition, focusPosition, upDirection);
+	// Advance the animation by elapsed time rather than per drawn frame.
+	angle += 0.6f * dt;
+
+	mSceneGraph.SetLocal(mBoxNode, XMMatrixTranslation(0.0f, -1.0f, 0.0f) * XMMatrixRotationY(-angle));
+	mSceneGraph.SetLocal(mFbx1Node, XMMatrixRotationZ(XM_PI) * XMMatrixScaling(0.00003f, 0.00003f, 0.00003f) * XMMatrixRotationY(-angle) * XMMatrixTranslation(-3.0f, 0.0f, 0.0f));
+	mSceneGraph.SetLocal(mFbx2Node, XMMatrixRotationX(-0.5f * XM_PI) * XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixRotationY(angle) * XMMatrixTranslation(3.0f, 0.0f, 0.0f));
+	mSceneGraph.SetLocal(mBlobNode, XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixRotationY(angle) * XMMatrixTranslation(-1.5f, -1.6f, -1.5f));
+	mSceneGraph.SetLocal(mBezierNode, XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixRotationX(angle) * XMMatrixTranslation(1.5f, -1.6f, -1.0f + 1.5f * sinf(angle)));
+
+	mSceneGraph.Update();
+
+	if (!mClips.empty())
+	{
+		PROFILE_SCOPE("Animate character");
+
+		// Play the clips in turn, cross-fading from the last pose of one
+		// into the start of the next.
+		const float crossFade = 0.3f;
+
+		mAnimationTime += dt;
+		if (mClips.size() > 1 && mAnimationTime >= mClips[mClipIndex].Duration())
+		{
+			mPreviousClip = (int)mClipIndex;
+			mClipIndex = (mClipIndex + 1) % (UINT)mClips.size();
+			mAnimationTime = 0.0f;
+		}
+
+		bool fading = mPreviousClip >= 0 && mAnimationTime < crossFade;
+		float fadeWeight = 1.0f - mAnimationTime / crossFade;
+
+		uint32_t vertexCount = (uint32_t)mBindPositions.size();
+		const XMFLOAT3* positions = mBindPositions.data();
+		bool skinned = mSkeleton.JointCount() > 0;
+
+		if (mMorphTargets.TargetCount() > 0)
+		{
+			mMorphWeights[mClipIndex].Sample(mAnimationTime, true, mCurrentMorphWeights.data());
+
+			if (fading)
+			{
+				const MorphWeightTrack& previous = mMorphWeights[mPreviousClip];
+				previous.Sample(previous.Duration, false, mPreviousMorphWeights.data());
+
+				for (size_t i = 0; i < mCurrentMorphWeights.size(); i++)
+					mCurrentMorphWeights[i] += fadeWeight * (mPreviousMorphWeights[i] - mCurrentMorphWeights[i]);
+			}
+
+			// Morph in bind space, before skinning.  Without a skeleton the
+			// result goes straight into the vertices.
+			if (skinned)
+			{
+				mMorphTargets.Apply(positions, vertexCount, mCurrentMorphWeights.data(), mMorphedPositions.data(), (uint32_t)sizeof(XMFLOAT3));
+				positions = mMorphedPositions.data();
+			}
+			else
+			{
+				mMorphTargets.Apply(positions, vertexCount, mCurrentMorphWeights.data(), &mSkinnedVertices[0].Pos, (uint32_t)sizeof(Vertex));
+			}
+		}
+
+		if (skinned)
+		{
+			mAnimator.Sample(mClips[mClipIndex], mAnimationTime, true);
+
+			if (fading)
+			{
+				const CompressedClip& previous = mClips[mPreviousClip];
+				mAnimator.Blend(previous, previous.Duration(), false, fadeWeight);
+			}
+
+			mAnimator.BuildPalette();
+			mAnimator.Skin(positions, mSkinInfluences.data(), vertexCount, &mSkinnedVertices[0].Pos, (uint32_t)sizeof(Vertex));
+		}
+	}
+
+	SceneState& state = mSceneState;
+
+	XMStoreFloat4x4(&state.BoxWorld, mSceneGraph.GetWorld(mBoxNode));
+	XMStoreFloat4x4(&state.SphereWorld, mSceneGraph.GetWorld(mSphereNode));
+	XMStoreFloat4x4(&state.BlobWorld, mSceneGraph.GetWorld(mBlobNode));
+	XMStoreFloat4x4(&state.BezierWorld, mSceneGraph.GetWorld(mBezierNode));
+
+	state.MeshPartWorlds.resize(mMeshParts.size());
+	for (size_t i = 0; i < mMeshParts.size(); i++)
+		XMStoreFloat4x4(&state.MeshPartWorlds[i], mSceneGraph.GetWorld(mMeshParts[i].Node));
+	XMStoreFloat4x4(&state.ViewProj, mView * mProj);
+
+	XMMATRIX viewAxes = XMMatrixTranspose(mView);
+	XMStoreFloat3(&state.CameraRight, viewAxes.r[0]);
+	XMStoreFloat3(&state.CameraUp, viewAxes.r[1]);
+
+	if (mSceneAtlas != TextureStreamer::InvalidTexture && mFbx2AtlasScale > 0.0f)
+	{
+		// The character's height on screen in pixels, from its bounding
+		// sphere's depth in view space.
+		XMMATRIX worldView = mSceneGraph.GetWorld(mFbx2Node) * mView;
+		float depth = XMVectorGetZ(XMVector3Transform(XMLoadFloat3(&mFbx2Center), worldView));
+		float radius = mFbx2Radius * XMVectorGetX(XMVector3Length(worldView.r[0]));
+
+		if (depth > radius)
+			mTextureStreamer.Request(mSceneAtlas, mFbx2AtlasScale * radius * XMVectorGetY(mProj.r[1]) * mClientHeight / depth);
+	}
+
+	mTextureStreamer.Update();
+
+	UpdateTerrain();
+	UpdateBezier();
+	UpdateOcean();
+	UpdateParticles(dt);
+	UpdateBodies(dt);
 }
 
 void InitDirect3DApp::DrawScene()
 {
+	PROFILE_FUNCTION();
+
 	md3dDeviceContext->ClearRenderTargetView(mRenderTargetView, Colors::Black);
 	md3dDeviceContext->ClearDepthStencilView(mDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
+	UpdateOcclusion();
+
+	if (!mSkinnedVertices.empty())
+	{
+		// UpdateScene runs just before on this thread, so these are this
+		// frame's vertices.
+		D3D11_BOX box;
+		box.left = mFbx2VertexOffset * (UINT)sizeof(Vertex);
+		box.right = box.left + (UINT)(mSkinnedVertices.size() * sizeof(Vertex));
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+
+		md3dDeviceContext->UpdateSubresource(mVertexBuffer, 0, &box, mSkinnedVertices.data(), 0, 0);
+	}
+
 	md3dDeviceContext->IASetInputLayout(mInputLayout);
 
 	UINT stride = sizeof(Vertex);
@@ -165,13 +620,19 @@ void InitDirect3DApp::DrawScene()
 
 	md3dDeviceContext->RSSetState(mRasterizerState);
 
+	md3dDeviceContext->PSSetSamplers(0, 1, &mSamplerState);
+
+	ID3D11ShaderResourceView* atlas = mSceneAtlas != TextureStreamer::InvalidTexture
+		? (ID3D11ShaderResourceView*)mTextureStreamer.Texture(mSceneAtlas) : mWhiteTexture;
+	md3dDeviceContext->PSSetShaderResources(0, 1, &atlas);
+
+	const SceneState& state = mSceneState;
+	XMMATRIX viewProj = XMLoadFloat4x4(&state.ViewProj);
+
 	ConstantBuffer cb;
 	XMMATRIX worldViewProj;
 
-	angle += 0.01f;
-
-	mBoxWorld = XMMatrixTranslation(0.0f, -1.0f, 0.0f) * XMMatrixRotationY(-angle);
-	worldViewProj = mBoxWorld * mView * mProj;
+	worldViewProj = XMLoadFloat4x4(&state.BoxWorld) * viewProj;
 
 	// Update the constant buffer with the latest worldViewProj matrix.
 	XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
@@ -180,8 +641,7 @@ void InitDirect3DApp::DrawScene()
 
 	md3dDeviceContext->DrawIndexed(mBoxIndexCount, mBoxIndexOffset, mBoxVertexOffset);
 	
-	mSphereWorld = XMMatrixTranslation(0.0f, 1.0f, 0.0f);
-	worldViewProj = mSphereWorld * mView * mProj;
+	worldViewProj = XMLoadFloat4x4(&state.SphereWorld) * viewProj;
 
 	// Update the constant buffer with the latest worldViewProj matrix.
 	XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
@@ -190,34 +650,310 @@ void InitDirect3DApp::DrawScene()
 
 	md3dDeviceContext->DrawIndexed(mSphereIndexCount, mSphereIndexOffset, mSphereVertexOffset);
 
-	mFbx1World = XMMatrixRotationZ(XM_PI) * XMMatrixScaling(0.00003f, 0.00003f, 0.00003f) * XMMatrixRotationY(-angle) * XMMatrixTranslation(-3.0f, 0.0f, 0.0f);
-	worldViewProj = mFbx1World * mView * mProj;
+	for (size_t i = 0; i < mMeshParts.size(); i++)
+	{
+		const MeshPart& part = mMeshParts[i];
+		worldViewProj = XMLoadFloat4x4(&state.MeshPartWorlds[i]) * viewProj;
 
-	// Update the constant buffer with the latest worldViewProj matrix.
-	XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
-	md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
-	md3dDeviceContext->VSSetConstantBuffers(0, 1, &mConstantBuffer);
+		// Update the constant buffer with the latest worldViewProj matrix.
+		XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
+		md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+		md3dDeviceContext->VSSetConstantBuffers(0, 1, &mConstantBuffer);
 
-	md3dDeviceContext->DrawIndexed(mFbx1IndexCount, mFbx1IndexOffset, mFbx1VertexOffset);
+		md3dDeviceContext->DrawIndexed(part.IndexCount, part.IndexOffset, part.VertexOffset);
+	}
 
-	mFbx2World = XMMatrixRotationX(-0.5f * XM_PI) * XMMatrixScaling(0.5f, 0.5f, 0.5f) * XMMatrixRotationY(angle) * XMMatrixTranslation(3.0f, 0.0f, 0.0f);
-	worldViewProj = mFbx2World * mView * mProj;
+	worldViewProj = XMLoadFloat4x4(&state.BlobWorld) * viewProj;
 
 	// Update the constant buffer with the latest worldViewProj matrix.
 	XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
 	md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
 	md3dDeviceContext->VSSetConstantBuffers(0, 1, &mConstantBuffer);
 
-	md3dDeviceContext->DrawIndexed(mFbx2IndexCount, mFbx2IndexOffset, mFbx2VertexOffset);
+	md3dDeviceContext->DrawIndexed(mBlobIndexCount, mBlobIndexOffset, mBlobVertexOffset);
+
+	if (mBezierIndexBuffer)
+	{
+		PROFILE_SCOPE("Draw Bezier patches");
+
+		const vector<uint32_t>& changed = mBezier.ChangedPatches();
+		for (size_t i = 0; i < changed.size(); i++)
+		{
+			const GeometryGenerator::MeshData& mesh = mBezier.PatchMesh(changed[i]);
+
+			D3D11_BOX box;
+			box.left = changed[i] * BezierSurface::MaxPatchVertices * (UINT)sizeof(Vertex);
+			box.right = box.left + (UINT)(mesh.Vertices.size() * sizeof(Vertex));
+			box.top = 0;
+			box.bottom = 1;
+			box.front = 0;
+			box.back = 1;
+
+			md3dDeviceContext->UpdateSubresource(mBezierVertexBuffer, 0, &box, &mBezierUploads[i * BezierSurface::MaxPatchVertices], 0, 0);
+
+			box.left = changed[i] * BezierSurface::MaxPatchIndices * (UINT)sizeof(uint32_t);
+			box.right = box.left + (UINT)(mesh.Indices32.size() * sizeof(uint32_t));
+
+			md3dDeviceContext->UpdateSubresource(mBezierIndexBuffer, 0, &box, mesh.Indices32.data(), 0, 0);
+		}
+
+		md3dDeviceContext->IASetVertexBuffers(0, 1, &mBezierVertexBuffer, &stride, &offset);
+		md3dDeviceContext->IASetIndexBuffer(mBezierIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+		worldViewProj = XMLoadFloat4x4(&state.BezierWorld) * viewProj;
+
+		XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
+		md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+		for (UINT patch = 0; patch < mBezier.PatchCount(); patch++)
+			md3dDeviceContext->DrawIndexed((UINT)mBezier.PatchMesh(patch).Indices32.size(), patch * BezierSurface::MaxPatchIndices,
+				patch * BezierSurface::MaxPatchVertices);
+	}
+
+	if (!mTerrainDraws.empty())
+	{
+		PROFILE_SCOPE("Draw terrain");
+
+		UINT patchBytes = mTerrain.VertexCount() * (UINT)sizeof(Vertex);
+		for (size_t i = 0; i < mTerrainUploadSlots.size(); i++)
+		{
+			D3D11_BOX box;
+			box.left = mTerrainUploadSlots[i] * patchBytes;
+			box.right = box.left + patchBytes;
+			box.top = 0;
+			box.bottom = 1;
+			box.front = 0;
+			box.back = 1;
+
+			md3dDeviceContext->UpdateSubresource(mTerrainVertexBuffer, 0, &box, &mTerrainUploads[i * mTerrain.VertexCount()], 0, 0);
+		}
+
+		md3dDeviceContext->IASetVertexBuffers(0, 1, &mTerrainVertexBuffer, &stride, &offset);
+		md3dDeviceContext->IASetIndexBuffer(mTerrainIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+
+		worldViewProj = XMMatrixTranslation(mTerrainOrigin.x, mTerrainOrigin.y, mTerrainOrigin.z) * viewProj;
+
+		XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
+		md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+		for (const TerrainDraw& draw : mTerrainDraws)
+			md3dDeviceContext->DrawIndexed(mTerrainIndexCounts[draw.EdgeMask], mTerrainIndexOffsets[draw.EdgeMask], draw.Slot * mTerrain.VertexCount());
+	}
+
+	if (mOceanIndexBuffer)
+	{
+		PROFILE_SCOPE("Draw ocean");
+
+		md3dDeviceContext->UpdateSubresource(mOceanVertexBuffer, 0, nullptr, mOceanUploads.data(), 0, 0);
+
+		md3dDeviceContext->IASetVertexBuffers(0, 1, &mOceanVertexBuffer, &stride, &offset);
+		md3dDeviceContext->IASetIndexBuffer(mOceanIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+		worldViewProj = XMMatrixTranslation(mOceanOrigin.x, mOceanOrigin.y, mOceanOrigin.z) * viewProj;
+
+		XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(worldViewProj));
+		md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+		md3dDeviceContext->DrawIndexed(mOceanIndexCount, 0, 0);
+	}
+
+	if (mBodyIndexBuffer && mBodyMode != BodiesOff)
+	{
+		PROFILE_SCOPE("Draw bodies");
+
+		// Eight vertices a body: a cube's corners, in the order of the box
+		// above, or an octahedron's tips and two unused.
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(md3dDeviceContext->Map(mBodyVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			static const XMFLOAT3 corners[8] =
+			{
+				XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT3(1.0f, -1.0f, -1.0f),
+				XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, -1.0f, 1.0f)
+			};
+			static const XMFLOAT3 tips[8] =
+			{
+				XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f),
+				XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f)
+			};
+
+			Vertex* vertices = (Vertex*)mapped.pData;
+			for (uint32_t i = 0; i < BodyCount; i++)
+			{
+				const XMFLOAT3* shape = mBodyIsBox[i] ? corners : tips;
+				XMFLOAT4 color = mBodyTouching[i] ? XMFLOAT4(0.9f, 0.2f, 0.15f, 1.0f)
+					: mBodyIsBox[i] ? XMFLOAT4(0.3f, 0.7f, 0.4f, 1.0f) : XMFLOAT4(0.3f, 0.5f, 0.9f, 1.0f);
+				const XMFLOAT3& center = mBodyPositions[i];
+				float radius = mBodyRadii[i];
+
+				for (uint32_t k = 0; k < 8; k++)
+				{
+					Vertex& vertex = vertices[8 * i + k];
+					vertex.Pos = XMFLOAT3(center.x + radius * shape[k].x, center.y + radius * shape[k].y, center.z + radius * shape[k].z);
+					vertex.Color = color;
+					vertex.TexC = mBodyTexC;
+				}
+			}
+			md3dDeviceContext->Unmap(mBodyVertexBuffer, 0);
+
+			md3dDeviceContext->IASetVertexBuffers(0, 1, &mBodyVertexBuffer, &stride, &offset);
+			md3dDeviceContext->IASetIndexBuffer(mBodyIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+			XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(viewProj));
+			md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+			md3dDeviceContext->DrawIndexed(mBodyIndexCount, 0, 0);
+		}
+	}
+
+	if (mParticleIndexBuffer && mParticles.Count() > 0)
+	{
+		PROFILE_SCOPE("Draw particles");
+
+		UINT vertexCount = mParticles.Count() * 4;
+		D3D11_MAP map = D3D11_MAP_WRITE_NO_OVERWRITE;
+		if (mParticleRingOffset + vertexCount > ParticleRingVertices)
+		{
+			map = D3D11_MAP_WRITE_DISCARD;
+			mParticleRingOffset = 0;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (SUCCEEDED(md3dDeviceContext->Map(mParticleVertexBuffer, 0, map, 0, &mapped)))
+		{
+			Vertex* vertices = (Vertex*)mapped.pData + mParticleRingOffset;
+			mParticles.WriteBillboards(XMLoadFloat3(&state.CameraRight), XMLoadFloat3(&state.CameraUp), mParticleTexC, 0,
+				mParticles.Count(), &vertices[0].Pos, &vertices[0].Color, &vertices[0].TexC, (UINT)sizeof(Vertex));
+			md3dDeviceContext->Unmap(mParticleVertexBuffer, 0);
+
+			md3dDeviceContext->IASetVertexBuffers(0, 1, &mParticleVertexBuffer, &stride, &offset);
+			md3dDeviceContext->IASetIndexBuffer(mParticleIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+			XMStoreFloat4x4(&cb.WorldViewProj, XMMatrixTranspose(viewProj));
+			md3dDeviceContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb, 0, 0);
+
+			md3dDeviceContext->DrawIndexed(mParticles.Count() * 6, 0, mParticleRingOffset);
+			mParticleRingOffset += vertexCount;
+		}
+	}
 
 	// Present the rendered image to the window.  Because the maximum frame latency is set to 1,
 	// the render loop will generally be throttled to the screen refresh rate, typically around
-	// 60 Hz, by sleeping the application on Present until the screen is refreshed.
-	mSwapChain->Present(1, 0);
+	// 60 Hz, by sleeping the application on Present until the screen is refreshed.  With a
+	// target frame rate set, vsync is off and the frame pacer does the throttling instead.
+	PROFILE_SCOPE("Present");
+	mSwapChain->Present(mSyncInterval, 0);
+}
+
+int InitDirect3DApp::AppendCaptionStats(wchar_t* text, int capacity)
+{
+	return _snwprintf_s(text, capacity, _TRUNCATE, L"    Textures: %.2f / %.2f MB    Picked: %hs    Terrain: %u patches, %.2fM tris (flat grid %.2fM)"
+		L"    Bezier: %.1fK tris, %.0f patches/ms    Ocean: %ux%u in %.2f ms    Particles: %u in %.2f ms    Bodies: %u on %hs, %u pairs in %.2f ms",
+		mTextureStreamer.ResidentBytes() / (1024.0 * 1024.0), mTextureStreamer.Budget() / (1024.0 * 1024.0),
+		mPickedName ? mPickedName : "none", mTerrainStats.Patches, mTerrainStats.Triangles / 1e6, mTerrainStats.FlatTriangles / 1e6,
+		mBezier.TriangleCount() / 1e3, mBezierPatchRate, mOcean.Size(), mOcean.Size(), mOceanMs, mParticles.Count(), mParticleMs, mBodyBoxes.Size(),
+		mBodyMode == BodiesSweepAndPrune ? "sweep and prune" : mBodyMode == BodiesHashGrid ? "hash grid" : "nothing",
+		(UINT)BodyPairs().size(), mBroadphaseMs);
+}
+
+void InitDirect3DApp::OnKeyDown(WPARAM key)
+{
+	if (key == VK_F4)
+	{
+		// Each broadphase starts over from the bodies as they are.
+		mBodyMode = (BodyMode)((mBodyMode + 1) % BodyModeCount);
+		mBroadphase.Clear();
+		mBodyGrid.Clear();
+		mBroadphaseMs = 0.0;
+	}
+}
+
+void InitDirect3DApp::OnMouseDown(WPARAM btnState, int x, int y)
+{
+	PROFILE_FUNCTION();
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// The cursor as a segment from the near plane to the far plane.
+	float ndcX = 2.0f * (x + 0.5f) / mClientWidth - 1.0f;
+	float ndcY = 1.0f - 2.0f * (y + 0.5f) / mClientHeight;
+
+	XMMATRIX invViewProj = XMMatrixInverse(nullptr, mView * mProj);
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), invViewProj);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), invViewProj);
+
+	// Each object is tested in its own space.  The segment's ends are
+	// moved there rather than a unit direction, so hit distances stay
+	// fractions of the segment and compare across objects.
+	const Pickable* picked = nullptr;
+	BvhHit closest;
+	closest.Distance = 1.0f;
+
+	for (const Pickable& pickable : mPickables)
+	{
+		XMMATRIX invWorld = XMMatrixInverse(nullptr, mSceneGraph.GetWorld(pickable.Node));
+		XMVECTOR origin = XMVector3TransformCoord(nearPoint, invWorld);
+		XMVECTOR direction = XMVectorSubtract(XMVector3TransformCoord(farPoint, invWorld), origin);
+
+		BvhHit hit;
+		if (pickable.Triangles.Intersect(origin, direction, closest.Distance, hit))
+		{
+			picked = &pickable;
+			closest = hit;
+		}
+	}
+
+	mPickedName = picked ? picked->Name : nullptr;
+
+	char line[256];
+	if (picked)
+		snprintf(line, sizeof(line), "Picked %s triangle %u in %.1f us\n", picked->Name, closest.Triangle,
+			chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+	else
+		snprintf(line, sizeof(line), "Picked nothing in %.1f us\n", chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	if (mLucyReady)
+	{
+		start = chrono::steady_clock::now();
+
+		XMMATRIX invWorld = XMMatrixInverse(nullptr, mSceneGraph.GetWorld(mFbx1Node));
+		XMVECTOR origin = XMVector3TransformCoord(nearPoint, invWorld);
+		XMVECTOR direction = XMVectorSubtract(XMVector3TransformCoord(farPoint, invWorld), origin);
+
+		VoxelHit hit;
+		if (mLucyVoxels.RayMarch(origin, direction, 1.0f, hit))
+			snprintf(line, sizeof(line), "Marched AngelLucy voxels to (%u, %u, %u) at %.4f in %.1f us\n", hit.X, hit.Y, hit.Z, hit.Distance,
+				chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+		else
+			snprintf(line, sizeof(line), "Marched AngelLucy voxels to nothing in %.1f us\n",
+				chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+		OutputDebugStringA(line);
+
+		start = chrono::steady_clock::now();
+
+		float distance;
+		if (mLucyField.SphereTrace(origin, direction, 1.0f, distance))
+			snprintf(line, sizeof(line), "Traced AngelLucy distance field to %.4f in %.1f us\n", distance,
+				chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+		else
+			snprintf(line, sizeof(line), "Traced AngelLucy distance field to nothing in %.1f us\n",
+				chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+		OutputDebugStringA(line);
+	}
 }
 
 void InitDirect3DApp::InputAssembler()
 {
+	PROFILE_FUNCTION();
+
+	TextureImage white;
+	white.Width = 1;
+	white.Height = 1;
+	white.Pixels.assign(4, 255);
+
+	mWhiteTexture = CreateTexture(vector<TextureImage>(1, white));
+
 	vector<Vertex> vertices =
 	{
 		{XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::White)},
@@ -257,15 +993,19 @@ void InitDirect3DApp::InputAssembler()
 		4, 3, 7
 	};
 
-	GeometryGenerator generator;
-	GeometryGenerator::MeshData mesh = generator.CreateSphere(1.0f, 60, 60);
+	// The sphere is built by the compiler, so there is nothing to generate.
+	static constexpr GeometryTables::UVSphereMesh<60, 60> sphere = GeometryTables::UVSphere<60, 60>(1.0f);
 
-	for (uint32_t i = 0; i < mesh.Vertices.size(); i++)
+	for (uint32_t i = 0; i < sphere.VertexCount; i++)
 	{
-		vertices.push_back(Vertex({mesh.Vertices[i].Position, XMFLOAT4(Colors::LimeGreen)}));
+		vertices.push_back(Vertex({sphere.Vertices[i].Position, XMFLOAT4(Colors::LimeGreen), sphere.Vertices[i].TexC}));
 	}
 
-	indices.insert(indices.end(), mesh.GetIndices16().begin(), mesh.GetIndices16().end());
+	indices.insert(indices.end(), sphere.Indices, sphere.Indices + sphere.IndexCount);
+
+	AddPickable("Box", mBoxNode, &vertices[0].Pos, (uint32_t)sizeof(Vertex), indices.data(), 12);
+	AddPickable("Sphere", mSphereNode, &sphere.Vertices[0].Position, (uint32_t)sizeof(GeometryTables::BakedVertex),
+		sphere.Indices, sphere.IndexCount / 3);
 
 	FbxManager* manager = FbxManager::Create();
 	FbxIOSettings* ios = FbxIOSettings::Create(manager, IOSROOT);
@@ -273,66 +1013,277 @@ void InitDirect3DApp::InputAssembler()
 	FbxScene* scene = FbxScene::Create(manager, "");
 
 	FbxImporter* importer = FbxImporter::Create(manager, "");
-	importer->Initialize("Resource Files/AngelLucy/AngelLucy.fbx", -1, manager->GetIOSettings());
-	importer->Import(scene);
+	{
+		PROFILE_SCOPE("FBX Import AngelLucy");
+		importer->Initialize("Resource Files/AngelLucy/AngelLucy.fbx", -1, manager->GetIOSettings());
+		importer->Import(scene);
+	}
 	importer->Destroy();
 
 	FbxGeometryConverter geometryConverter(manager);
-	geometryConverter.Triangulate(scene, true);
+	{
+		PROFILE_SCOPE("FBX Triangulate AngelLucy");
+		geometryConverter.Triangulate(scene, true);
+	}
 
 	fbxVertices.resize(0);
 	fbxIndices.resize(0);
+	fbxTexCoords.resize(0);
+	fbxInfluences.resize(0);
+	fbxJointNodes.clear();
+	fbxJointIndices.clear();
+	fbxInverseBindPose.clear();
+	fbxMorphTargets.Clear();
+	fbxMorphChannels.clear();
+	fbxParts.clear();
 
-	DisplayContent(scene);
+	{
+		PROFILE_SCOPE("FBX Extract AngelLucy");
+		DisplayContent(scene, mFbx1Node);
+	}
 
 	UINT fbx1VertexCount = (UINT)fbxVertices.size();
 	UINT fbx1IndexCount = (UINT)fbxIndices.size();
+	mMeshParts = fbxParts;
+	size_t fbx1PartCount = mMeshParts.size();
+
+	vector<float> visibility(fbx1VertexCount, 1.0f);
+	OcclusionBake* lucyBake = nullptr;
+
+	if (fbx1IndexCount > 0)
+	{
+		// Each mesh node is picked in its own space.  The bakes below treat
+		// the file's meshes as one, with their control points as stored.
+		for (const MeshPart& part : fbxParts)
+			AddPickable("AngelLucy", part.Node, fbxVertices.data(), (uint32_t)sizeof(XMFLOAT3), fbxIndices.data() + part.IndexOffset,
+				part.IndexCount / 3);
+
+		Bvh lucyTriangles;
+		if (fbxParts.size() > 1)
+			lucyTriangles.Build(fbxVertices.data(), (uint32_t)sizeof(XMFLOAT3), fbxIndices.data(), fbx1IndexCount / 3);
+		const Bvh& lucyBvh = fbxParts.size() > 1 ? lucyTriangles : mPickables.back().Triangles;
+
+		lucyBake = BakeOcclusion("Cache/AngelLucy.ao", fbxVertices, fbxIndices, lucyBvh, XMFLOAT4(Colors::Gold), (UINT)vertices.size(),
+			visibility);
+
+		mLucyPositions = fbxVertices;
+		mLucyIndices = fbxIndices;
+	}
 
 	for (uint32_t i = 0; i < fbx1VertexCount; i++)
 	{
-		vertices.push_back(Vertex({fbxVertices[i], XMFLOAT4(Colors::Gold)}));
+		XMFLOAT4 color(Colors::Gold);
+		color.x *= visibility[i];
+		color.y *= visibility[i];
+		color.z *= visibility[i];
+		vertices.push_back(Vertex({fbxVertices[i], color, fbxTexCoords[i]}));
 	}
 
+	if (lucyBake)
+		lucyBake->Vertices.assign(vertices.end() - fbx1VertexCount, vertices.end());
+
 	indices.insert(indices.end(), fbxIndices.begin(), fbxIndices.end());
 
 	importer = FbxImporter::Create(manager, "");
-	importer->Initialize("Resource Files/ao_twinte_chan/ao_twinte_chan.fbx", -1, manager->GetIOSettings());
-	importer->Import(scene);
+	{
+		PROFILE_SCOPE("FBX Import ao_twinte_chan");
+		importer->Initialize("Resource Files/ao_twinte_chan/ao_twinte_chan.fbx", -1, manager->GetIOSettings());
+		importer->Import(scene);
+	}
 	importer->Destroy();
 
-	geometryConverter.Triangulate(scene, true);
+	{
+		PROFILE_SCOPE("FBX Triangulate ao_twinte_chan");
+		geometryConverter.Triangulate(scene, true);
+	}
 
 	fbxVertices.resize(0);
 	fbxIndices.resize(0);
+	fbxTexCoords.resize(0);
+	fbxInfluences.resize(0);
+	fbxJointNodes.clear();
+	fbxJointIndices.clear();
+	fbxInverseBindPose.clear();
+	fbxMorphTargets.Clear();
+	fbxMorphChannels.clear();
+	fbxParts.clear();
+
+	{
+		PROFILE_SCOPE("FBX Extract ao_twinte_chan");
+		DisplayContent(scene, mFbx2Node);
+	}
 
-	DisplayContent(scene);
+	if (!fbxJointNodes.empty() || !fbxMorphChannels.empty())
+	{
+		PROFILE_SCOPE("FBX Animation ao_twinte_chan");
+		if (!fbxJointNodes.empty())
+			DisplaySkeleton();
+		DisplayAnimation(scene);
+	}
 
 	UINT fbx2VertexCount = (UINT)fbxVertices.size();
 	UINT fbx2IndexCount = (UINT)fbxIndices.size();
+	mMeshParts.insert(mMeshParts.end(), fbxParts.begin(), fbxParts.end());
+
+	if (fbx2VertexCount > 0)
+	{
+		XMVECTOR lo = XMLoadFloat3(&fbxVertices[0]);
+		XMVECTOR hi = lo;
+		for (uint32_t i = 1; i < fbx2VertexCount; i++)
+		{
+			lo = XMVectorMin(lo, XMLoadFloat3(&fbxVertices[i]));
+			hi = XMVectorMax(hi, XMLoadFloat3(&fbxVertices[i]));
+		}
+
+		XMVECTOR center = XMVectorScale(XMVectorAdd(lo, hi), 0.5f);
+		XMStoreFloat3(&mFbx2Center, center);
+		mFbx2Radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(hi, center)));
+	}
+
+	// The atlas holds a white patch that the untextured objects point all
+	// their UVs at, and the character's texture unless its UVs wrap.  The
+	// sources are decoded every run since packing needs their sizes; only
+	// the cooking is cached.
+	vector<TextureImage> atlasImages(1);
+	atlasImages[0].Width = 4;
+	atlasImages[0].Height = 4;
+	atlasImages[0].Pixels.assign(4 * 4 * 4, 255);
+
+	TextureImage character;
+	if (TgaLoader::Load("Resource Files/ao_twinte_chan/ao_twinte_chan640x640.tga", character)
+		&& TextureAtlas::InUnitSquare(fbxTexCoords.data(), fbx2VertexCount, (uint32_t)sizeof(XMFLOAT2)))
+		atlasImages.push_back(move(character));
+
+	vector<AtlasRect> atlasRects;
+	UINT atlasWidth = 0;
+	UINT atlasHeight = 0;
+	mSceneAtlas = LoadAtlas("Cache/SceneAtlas.dds", atlasImages, atlasRects, atlasWidth, atlasHeight);
+
+	XMFLOAT2 whiteTexC(0.0f, 0.0f);
+	bool fbx2Textured = false;
+
+	if (mSceneAtlas != TextureStreamer::InvalidTexture)
+	{
+		const AtlasRect& white = atlasRects[0];
+		whiteTexC = XMFLOAT2((white.X + 0.5f * white.Width) / atlasWidth, (white.Y + 0.5f * white.Height) / atlasHeight);
+
+		for (Vertex& vertex : vertices)
+			vertex.TexC = whiteTexC;
+
+		if (atlasImages.size() > 1)
+			fbx2Textured = TextureAtlas::RemapTexCoords(atlasRects[1], atlasWidth, atlasHeight,
+				fbxTexCoords.data(), fbx2VertexCount, (uint32_t)sizeof(XMFLOAT2));
+
+		if (fbx2Textured)
+			mFbx2AtlasScale = (float)max(atlasWidth, atlasHeight) / max(atlasRects[1].Width, atlasRects[1].Height);
+	}
+
+	// A tree over the bind pose would not follow an animated character,
+	// so it is only picked when still; the occlusion is baked in the bind
+	// pose either way.
+	visibility.assign(fbx2VertexCount, 1.0f);
+	OcclusionBake* fbx2Bake = nullptr;
+
+	// The vertex color tints the texture, so a textured model is white.
+	XMFLOAT4 fbx2Color = fbx2Textured ? XMFLOAT4(Colors::White) : XMFLOAT4(Colors::Pink);
+
+	if (fbx2IndexCount > 0)
+	{
+		if (mClips.empty())
+		{
+			for (const MeshPart& part : fbxParts)
+				AddPickable("ao_twinte_chan", part.Node, fbxVertices.data(), (uint32_t)sizeof(XMFLOAT3), fbxIndices.data() + part.IndexOffset,
+					part.IndexCount / 3);
+		}
+
+		Bvh bindPose;
+		bool reusePickable = mClips.empty() && fbxParts.size() == 1;
+		if (!reusePickable)
+			bindPose.Build(fbxVertices.data(), (uint32_t)sizeof(XMFLOAT3), fbxIndices.data(), fbx2IndexCount / 3);
+
+		fbx2Bake = BakeOcclusion("Cache/ao_twinte_chan.ao", fbxVertices, fbxIndices, reusePickable ? mPickables.back().Triangles : bindPose,
+			fbx2Color, (UINT)vertices.size(), visibility);
+	}
 
 	for (uint32_t i = 0; i < fbx2VertexCount; i++)
 	{
-		vertices.push_back(Vertex({fbxVertices[i], XMFLOAT4(Colors::Pink)}));
+		XMFLOAT4 color = fbx2Color;
+		color.x *= visibility[i];
+		color.y *= visibility[i];
+		color.z *= visibility[i];
+		vertices.push_back(Vertex({fbxVertices[i], color, fbx2Textured ? fbxTexCoords[i] : whiteTexC}));
+	}
+
+	if (fbx2Bake)
+		fbx2Bake->Vertices.assign(vertices.end() - fbx2VertexCount, vertices.end());
+
+	if (!mClips.empty())
+	{
+		if (mSkeleton.JointCount() > 0)
+			mAnimator.SetSkeleton(&mSkeleton);
+
+		mBindPositions = fbxVertices;
+		mSkinInfluences = fbxInfluences;
+		mSkinnedVertices.assign(vertices.end() - fbx2VertexCount, vertices.end());
+
+		mMorphTargets = move(fbxMorphTargets);
+		mCurrentMorphWeights.assign(mMorphTargets.TargetCount(), 0.0f);
+		mPreviousMorphWeights.assign(mMorphTargets.TargetCount(), 0.0f);
+		mMorphedPositions.resize(fbxVertices.size());
+
+		if (mMorphTargets.TargetCount() > 0)
+		{
+			char line[256];
+			snprintf(line, sizeof(line), "Morph targets: %u, %zu bytes (%zu per target, %zu dense)\n",
+				mMorphTargets.TargetCount(), mMorphTargets.SizeInBytes(),
+				mMorphTargets.SizeInBytes() / mMorphTargets.TargetCount(), fbxVertices.size() * sizeof(XMFLOAT3));
+			OutputDebugStringA(line);
+		}
 	}
 
 	indices.insert(indices.end(), fbxIndices.begin(), fbxIndices.end());
 
 	manager->Destroy();
 
+	GeometryGenerator generator;
+	GeometryGenerator::MeshData blob = CreateBlob(generator);
+
+	for (const GeometryGenerator::Vertex& vertex : blob.Vertices)
+	{
+		// Shaded from the normal, as nothing lights the scene.
+		float light = 0.45f + 0.55f * max(vertex.Normal.y * 0.8f + vertex.Normal.x * 0.4f - vertex.Normal.z * 0.45f, 0.0f);
+		vertices.push_back(Vertex({vertex.Position, XMFLOAT4(0.85f * light, 0.35f * light, 0.55f * light, 1.0f), whiteTexC}));
+	}
+
+	indices.insert(indices.end(), blob.Indices32.begin(), blob.Indices32.end());
+
+	AddPickable("Blob", mBlobNode, &blob.Vertices[0].Position, (uint32_t)sizeof(GeometryGenerator::Vertex),
+		blob.Indices32.data(), (uint32_t)blob.Indices32.size() / 3);
+
 	mBoxIndexCount = 36;
-	mSphereIndexCount = (UINT)mesh.Indices32.size();
+	mSphereIndexCount = sphere.IndexCount;
 	mFbx1IndexCount = fbx1IndexCount;
 	mFbx2IndexCount = fbx2IndexCount;
+	mBlobIndexCount = (UINT)blob.Indices32.size();
 
 	mBoxIndexOffset = 0;
 	mSphereIndexOffset = mBoxIndexOffset + mBoxIndexCount;
 	mFbx1IndexOffset = mSphereIndexOffset + mSphereIndexCount;
 	mFbx2IndexOffset = mFbx1IndexOffset + fbx1IndexCount;
+	mBlobIndexOffset = mFbx2IndexOffset + fbx2IndexCount;
 
 	mBoxVertexOffset = 0;
 	mSphereVertexOffset = mBoxVertexOffset + 8;
-	mFbx1VertexOffset = mSphereVertexOffset + (UINT)mesh.Vertices.size();
+	mFbx1VertexOffset = mSphereVertexOffset + sphere.VertexCount;
 	mFbx2VertexOffset = mFbx1VertexOffset + fbx1VertexCount;
+	mBlobVertexOffset = mFbx2VertexOffset + fbx2VertexCount;
+
+	for (size_t i = 0; i < mMeshParts.size(); i++)
+	{
+		bool first = i < fbx1PartCount;
+		mMeshParts[i].IndexOffset += first ? mFbx1IndexOffset : mFbx2IndexOffset;
+		mMeshParts[i].VertexOffset = first ? mFbx1VertexOffset : mFbx2VertexOffset;
+	}
 
 	D3D11_BUFFER_DESC vbd;
 	vbd.ByteWidth = sizeof(Vertex) * (UINT)vertices.size();
@@ -347,7 +1298,10 @@ void InitDirect3DApp::InputAssembler()
 	vsd.SysMemPitch = 0;
 	vsd.SysMemSlicePitch = 0;
 
-	md3dDevice->CreateBuffer(&vbd, &vsd, &mVertexBuffer);
+	{
+		PROFILE_SCOPE("Create Vertex Buffer");
+		md3dDevice->CreateBuffer(&vbd, &vsd, &mVertexBuffer);
+	}
 
 	D3D11_BUFFER_DESC ibd;
 	ibd.ByteWidth = sizeof(uint32_t) * (UINT)indices.size();
@@ -362,7 +1316,33 @@ void InitDirect3DApp::InputAssembler()
 	isd.SysMemPitch = 0;
 	isd.SysMemSlicePitch = 0;
 	
-	md3dDevice->CreateBuffer(&ibd, &isd, &mIndexBuffer);
+	{
+		PROFILE_SCOPE("Create Index Buffer");
+		md3dDevice->CreateBuffer(&ibd, &isd, &mIndexBuffer);
+	}
+
+	if (!mOcclusionBakes.empty())
+		mOcclusionThread = thread(&InitDirect3DApp::OcclusionThreadMain, this);
+
+	if (!mLucyPositions.empty())
+		mLucyThread = thread(&InitDirect3DApp::LucyThreadMain, this);
+
+	// Terrain patches point at the white patch like the other untextured
+	// objects.
+	mTerrainTexC = whiteTexC;
+	LoadTerrain("Cache/Terrain.trn");
+
+	mBezierTexC = whiteTexC;
+	CreateBezier();
+
+	mOceanTexC = whiteTexC;
+	CreateOcean();
+
+	mParticleTexC = whiteTexC;
+	CreateParticles();
+
+	mBodyTexC = whiteTexC;
+	CreateBodies();
 
 	D3D11_BUFFER_DESC cbd;
 	cbd.ByteWidth = sizeof(ConstantBuffer);
@@ -379,13 +1359,14 @@ void InitDirect3DApp::InputAssembler()
 
 	md3dDevice->CreateVertexShader(vertexShader->GetBufferPointer(), vertexShader->GetBufferSize(), nullptr, &mVertexShader);
 
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[2] =
+	D3D11_INPUT_ELEMENT_DESC vertexDesc[3] =
 	{
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
 		{"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0},
 	};
 
-	md3dDevice->CreateInputLayout(vertexDesc, 2, vertexShader->GetBufferPointer(), vertexShader->GetBufferSize(), &mInputLayout);
+	md3dDevice->CreateInputLayout(vertexDesc, 3, vertexShader->GetBufferPointer(), vertexShader->GetBufferSize(), &mInputLayout);
 
 	md3dDevice->CreatePixelShader(pixelShader->GetBufferPointer(), pixelShader->GetBufferSize(), nullptr, &mPixelShader);
 
@@ -396,72 +1377,226 @@ void InitDirect3DApp::InputAssembler()
 	rd.DepthClipEnable = TRUE;
 
 	md3dDevice->CreateRasterizerState(&rd, &mRasterizerState);
+
+	D3D11_SAMPLER_DESC sd;
+	ZeroMemory(&sd, sizeof(D3D11_SAMPLER_DESC));
+	sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sd.MaxLOD = D3D11_FLOAT32_MAX;
+
+	md3dDevice->CreateSamplerState(&sd, &mSamplerState);
 }
 
-void InitDirect3DApp::DisplayContent(FbxScene* pScene)
+static float TerrainNoise(float x, float z, uint32_t octave)
 {
-	int i;
-	FbxNode* lNode = pScene->GetRootNode();
-
-	if (lNode)
+	auto lattice = [octave](int32_t ix, int32_t iz)
 	{
-		for (i = 0; i < lNode->GetChildCount(); i++)
-		{
-			DisplayContent(lNode->GetChild(i));
-		}
-	}
+		uint32_t h = (uint32_t)ix * 374761393u + (uint32_t)iz * 668265263u + octave * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return (h ^ (h >> 16)) / 4294967295.0f;
+	};
+
+	int32_t ix = (int32_t)floor(x);
+	int32_t iz = (int32_t)floor(z);
+	float fx = x - ix;
+	float fz = z - iz;
+	fx = fx * fx * (3.0f - 2.0f * fx);
+	fz = fz * fz * (3.0f - 2.0f * fz);
+
+	float a = lattice(ix, iz);
+	float b = lattice(ix + 1, iz);
+	float c = lattice(ix, iz + 1);
+	float d = lattice(ix + 1, iz + 1);
+	return a + (b - a) * fx + (c - a) * fz + (a - b - c + d) * fx * fz;
 }
 
-void InitDirect3DApp::DisplayContent(FbxNode* pNode)
+// A torus of 16 bicubic patches over a 12 by 12 grid of control points,
+// each quarter circle a cubic with its handles 0.5523 of the radius long.
+static void GenerateTorusPatches(float majorRadius, float minorRadius, vector<XMFLOAT3>& points, vector<uint32_t>& patches)
 {
-	FbxNodeAttribute::EType lAttributeType;
+	const float handle = 0.5522847f;
 
-	if (pNode->GetNodeAttribute() == NULL)
+	XMFLOAT2 circle[12];
+	for (uint32_t q = 0; q < 4; q++)
 	{
-		FBXSDK_printf("NULL Node Attribute\n\n");
+		XMFLOAT2 c = q == 0 ? XMFLOAT2(1.0f, 0.0f) : q == 1 ? XMFLOAT2(0.0f, 1.0f) : q == 2 ? XMFLOAT2(-1.0f, 0.0f) : XMFLOAT2(0.0f, -1.0f);
+		XMFLOAT2 n(-c.y, c.x);
+		circle[3 * q] = c;
+		circle[3 * q + 1] = XMFLOAT2(c.x + handle * n.x, c.y + handle * n.y);
+		circle[3 * q + 2] = XMFLOAT2(n.x + handle * c.x, n.y + handle * c.y);
 	}
-	else
+
+	// Swept clockwise about y so dP/du x dP/dv points out of the tube.
+	points.clear();
+	for (uint32_t j = 0; j < 12; j++)
 	{
-		lAttributeType = (pNode->GetNodeAttribute()->GetAttributeType());
+		float radius = majorRadius + minorRadius * circle[j].x;
+		for (uint32_t i = 0; i < 12; i++)
+			points.push_back(XMFLOAT3(radius * circle[i].x, minorRadius * circle[j].y, -radius * circle[i].y));
+	}
+
+	patches.clear();
+	for (uint32_t b = 0; b < 4; b++)
+		for (uint32_t a = 0; a < 4; a++)
+			for (uint32_t r = 0; r < 4; r++)
+				for (uint32_t c = 0; c < 4; c++)
+					patches.push_back((3 * b + r) % 12 * 12 + (3 * a + c) % 12);
+}
+
+// Hills of value noise around a flat valley in the middle, where the rest
+// of the scene stands.
+static void GenerateTerrainHeights(uint32_t size, float spacing, vector<float>& heights)
+{
+	PROFILE_FUNCTION();
+
+	const float valleyRadius = 80.0f;
+	const float valleyFalloff = 160.0f;
+
+	heights.resize((size_t)size * size);
+	float center = 0.5f * (size - 1) * spacing;
+
+	ThreadPool::Get().ParallelFor(size, 16, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t r = begin; r < end; r++)
+		{
+			for (uint32_t c = 0; c < size; c++)
+			{
+				float x = c * spacing;
+				float z = r * spacing;
+
+				float height = 0.0f;
+				float amplitude = 120.0f;
+				float frequency = 1.0f / 512.0f;
+				for (uint32_t octave = 0; octave < 8; octave++)
+				{
+					height += amplitude * TerrainNoise(x * frequency, z * frequency, octave);
+					amplitude *= 0.5f;
+					frequency *= 2.0f;
+				}
+
+				float distance = sqrt((x - center) * (x - center) + (z - center) * (z - center));
+				float t = min(max((distance - valleyRadius) / valleyFalloff, 0.0f), 1.0f);
+				heights[(size_t)r * size + c] = height * t * t * (3.0f - 2.0f * t);
+			}
+		}
+	});
+}
+
+static XMMATRIX ToXMMatrix(const FbxAMatrix& m)
+{
+	// FBX matrices are row-major with the translation in the last row, the
+	// same layout DirectXMath uses.
+	return XMMatrixSet(
+		(float)m.Get(0, 0), (float)m.Get(0, 1), (float)m.Get(0, 2), (float)m.Get(0, 3),
+		(float)m.Get(1, 0), (float)m.Get(1, 1), (float)m.Get(1, 2), (float)m.Get(1, 3),
+		(float)m.Get(2, 0), (float)m.Get(2, 1), (float)m.Get(2, 2), (float)m.Get(2, 3),
+		(float)m.Get(3, 0), (float)m.Get(3, 1), (float)m.Get(3, 2), (float)m.Get(3, 3));
+}
+
+void InitDirect3DApp::DisplayContent(FbxScene* pScene, SceneGraph::NodeId parent)
+{
+	int i;
+	FbxNode* lNode = pScene->GetRootNode();
+	fbxRootNode = parent;
+
+	if (lNode)
+	{
+		for (i = 0; i < lNode->GetChildCount(); i++)
+		{
+			DisplayContent(lNode->GetChild(i), parent);
+		}
+	}
+}
+
+void InitDirect3DApp::DisplayContent(FbxNode* pNode, SceneGraph::NodeId parent)
+{
+	FbxNodeAttribute::EType lAttributeType;
+
+	// Keep the file's node hierarchy under the object's root node.
+	SceneGraph::NodeId node = mSceneGraph.AddNode(parent, ToXMMatrix(pNode->EvaluateLocalTransform()));
+
+	if (pNode->GetNodeAttribute() == NULL)
+	{
+		FBXSDK_printf("NULL Node Attribute\n\n");
+	}
+	else
+	{
+		lAttributeType = (pNode->GetNodeAttribute()->GetAttributeType());
 
 		switch (lAttributeType)
 		{
 		default:
 			break;
 		case FbxNodeAttribute::eMesh:
-			DisplayMesh(pNode);
+			DisplayMesh(pNode, node);
 			break;
 		}
 	}
 
 	for (int i = 0; i < pNode->GetChildCount(); i++)
 	{
-		DisplayContent(pNode->GetChild(i));
+		DisplayContent(pNode->GetChild(i), node);
 	}
 }
 
-void InitDirect3DApp::DisplayMesh(FbxNode* pNode)
+void InitDirect3DApp::DisplayMesh(FbxNode* pNode, SceneGraph::NodeId node)
 {
 	FbxMesh* lMesh = (FbxMesh*)pNode->GetNodeAttribute();
+	UINT baseVertex = (UINT)fbxVertices.size();
+
+	// Skinning carries a mesh's vertices into the space of the file, so a
+	// skinned mesh is drawn with the file's root rather than its node.
+	MeshPart part;
+	part.Node = lMesh->GetDeformerCount(FbxDeformer::eSkin) > 0 ? fbxRootNode : node;
+	part.IndexOffset = (UINT)fbxIndices.size();
+	part.VertexOffset = 0;
 
 	DisplayControlPoints(lMesh);
 	DisplayPolygons(lMesh);
+
+	// The file's meshes share fbxVertices, so each mesh's indices are
+	// offset past the control points of the meshes before it.
+	for (size_t i = part.IndexOffset; i < fbxIndices.size(); i++)
+		fbxIndices[i] += baseVertex;
+
+	part.IndexCount = (UINT)fbxIndices.size() - part.IndexOffset;
+	fbxParts.push_back(part);
+
+	DisplaySkin(lMesh, baseVertex);
+	DisplayBlendShapes(lMesh, baseVertex);
+	DisplayUVs(lMesh, baseVertex);
 }
 
 void InitDirect3DApp::DisplayControlPoints(FbxMesh* pMesh)
 {
-	int lControlPointsCount = pMesh->GetControlPointsCount();
-	FbxVector4* lControlPoints = pMesh->GetControlPoints();
-
-	for (int i = 0; i < lControlPointsCount; i++)
-	{
-		FbxVector4 vector4 = lControlPoints[i];
-		fbxVertices.push_back(XMFLOAT3(static_cast<float>(vector4[0]), static_cast<float>(vector4[1]), static_cast<float>(vector4[2])));
-	}
+	ExtractControlPoints(*pMesh, fbxVertices);
 }
 
 void InitDirect3DApp::DisplayPolygons(FbxMesh* pMesh)
 {
+	// The scene is triangulated before extraction.
+	ExtractPolygons(*pMesh, fbxIndices);
+}
+
+void InitDirect3DApp::DisplayUVs(FbxMesh* pMesh, UINT baseVertex)
+{
+	fbxTexCoords.resize(fbxVertices.size(), XMFLOAT2(0.0f, 0.0f));
+
+	if (pMesh->GetElementUVCount() == 0)
+		return;
+
+	FbxGeometryElementUV* lUV = pMesh->GetElementUV(0);
+	FbxGeometryElement::EMappingMode lMapping = lUV->GetMappingMode();
+	bool lIndexed = lUV->GetReferenceMode() != FbxGeometryElement::eDirect;
+
+	if (lMapping != FbxGeometryElement::eByControlPoint && lMapping != FbxGeometryElement::eByPolygonVertex)
+		return;
+
+	// Render vertices are control points, so a control point on a UV seam
+	// keeps the coordinates of the last polygon corner that uses it.
 	int lPolygonCount = pMesh->GetPolygonCount();
 
 	for (int i = 0; i < lPolygonCount; i++)
@@ -471,13 +1606,1074 @@ void InitDirect3DApp::DisplayPolygons(FbxMesh* pMesh)
 		for (int j = 0; j < lPolygonSize; j++)
 		{
 			int lControlPointIndex = pMesh->GetPolygonVertex(i, j);
-			fbxIndices.push_back(lControlPointIndex);
-		} // for polygonSize
-	} // for polygonCount
+			int lUVIndex;
+
+			if (lMapping == FbxGeometryElement::eByControlPoint)
+				lUVIndex = lIndexed ? lUV->GetIndexArray().GetAt(lControlPointIndex) : lControlPointIndex;
+			else
+				lUVIndex = pMesh->GetTextureUVIndex(i, j);
+
+			// FBX puts v = 0 at the bottom of the image.
+			FbxVector2 lTexC = lUV->GetDirectArray().GetAt(lUVIndex);
+			fbxTexCoords[baseVertex + lControlPointIndex] = XMFLOAT2((float)lTexC[0], 1.0f - (float)lTexC[1]);
+		}
+	}
+}
+
+void InitDirect3DApp::DisplaySkin(FbxMesh* pMesh, UINT baseVertex)
+{
+	// Control points no cluster mentions keep zero weights and stay put.
+	fbxInfluences.resize(fbxVertices.size(), SkinInfluence());
+
+	int lSkinCount = pMesh->GetDeformerCount(FbxDeformer::eSkin);
+
+	for (int i = 0; i < lSkinCount; i++)
+	{
+		FbxSkin* lSkin = (FbxSkin*)pMesh->GetDeformer(i, FbxDeformer::eSkin);
+		int lClusterCount = lSkin->GetClusterCount();
+
+		for (int j = 0; j < lClusterCount; j++)
+		{
+			FbxCluster* lCluster = lSkin->GetCluster(j);
+			FbxNode* lLink = lCluster->GetLink();
+			if (!lLink)
+				continue;
+
+			uint16_t joint;
+			auto found = fbxJointIndices.find(lLink);
+
+			if (found == fbxJointIndices.end())
+			{
+				joint = (uint16_t)fbxJointNodes.size();
+				fbxJointIndices[lLink] = joint;
+				fbxJointNodes.push_back(lLink);
+
+				// Mesh space to joint space at bind time.  A joint shared by
+				// several meshes keeps the first mesh's bind matrix.
+				FbxAMatrix lMeshBind;
+				FbxAMatrix lLinkBind;
+				lCluster->GetTransformMatrix(lMeshBind);
+				lCluster->GetTransformLinkMatrix(lLinkBind);
+
+				XMFLOAT4X4A inverseBind;
+				XMStoreFloat4x4A(&inverseBind, ToXMMatrix(lLinkBind.Inverse() * lMeshBind));
+				fbxInverseBindPose.push_back(inverseBind);
+			}
+			else
+			{
+				joint = found->second;
+			}
+
+			int lIndexCount = lCluster->GetControlPointIndicesCount();
+			int* lIndices = lCluster->GetControlPointIndices();
+			double* lWeights = lCluster->GetControlPointWeights();
+
+			for (int k = 0; k < lIndexCount; k++)
+			{
+				Animator::AddInfluence(fbxInfluences[baseVertex + lIndices[k]], joint, (float)lWeights[k]);
+			}
+		}
+	}
+
+	for (size_t i = baseVertex; i < fbxInfluences.size(); i++)
+	{
+		Animator::NormalizeInfluence(fbxInfluences[i]);
+	}
+}
+
+void InitDirect3DApp::DisplayBlendShapes(FbxMesh* pMesh, UINT baseVertex)
+{
+	// Vertices that move less than this are left out of a target.
+	const float lThreshold = 1e-4f;
+
+	int lControlPointsCount = pMesh->GetControlPointsCount();
+	FbxVector4* lControlPoints = pMesh->GetControlPoints();
+
+	int lBlendShapeCount = pMesh->GetDeformerCount(FbxDeformer::eBlendShape);
+
+	for (int i = 0; i < lBlendShapeCount; i++)
+	{
+		FbxBlendShape* lBlendShape = (FbxBlendShape*)pMesh->GetDeformer(i, FbxDeformer::eBlendShape);
+		int lChannelCount = lBlendShape->GetBlendShapeChannelCount();
+
+		for (int j = 0; j < lChannelCount; j++)
+		{
+			FbxBlendShapeChannel* lChannel = lBlendShape->GetBlendShapeChannel(j);
+			int lShapeCount = lChannel->GetTargetShapeCount();
+			if (lShapeCount == 0)
+				continue;
+
+			// In-between shapes are not supported; the full-weight shape is
+			// used across the whole range.
+			FbxShape* lShape = lChannel->GetTargetShape(lShapeCount - 1);
+			FbxVector4* lShapePoints = lShape->GetControlPoints();
+			int lCount = min(lShape->GetControlPointsCount(), lControlPointsCount);
+
+			fbxShapeDeltas.resize(lCount);
+			for (int k = 0; k < lCount; k++)
+			{
+				FbxVector4 lDelta = lShapePoints[k] - lControlPoints[k];
+				fbxShapeDeltas[k] = XMFLOAT3((float)lDelta[0], (float)lDelta[1], (float)lDelta[2]);
+			}
+
+			fbxMorphTargets.AddTarget(lChannel->GetName(), baseVertex, fbxShapeDeltas.data(), (uint32_t)lCount, lThreshold);
+			fbxMorphChannels.push_back(lChannel);
+		}
+	}
+}
+
+void InitDirect3DApp::DisplaySkeleton()
+{
+	UINT jointCount = (UINT)fbxJointNodes.size();
+
+	// Clusters list joints in no particular order.  Sorting by depth in the
+	// file puts every joint after its ancestors.
+	vector<UINT> depth(jointCount, 0);
+	vector<uint16_t> order(jointCount);
+
+	for (UINT j = 0; j < jointCount; j++)
+	{
+		for (FbxNode* lNode = fbxJointNodes[j]->GetParent(); lNode; lNode = lNode->GetParent())
+			depth[j]++;
+
+		order[j] = (uint16_t)j;
+	}
+
+	stable_sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) { return depth[a] < depth[b]; });
+
+	vector<uint16_t> remap(jointCount);
+	vector<FbxNode*> nodes(jointCount);
+
+	mSkeleton.InverseBindPose.resize(jointCount);
+
+	for (UINT j = 0; j < jointCount; j++)
+	{
+		remap[order[j]] = (uint16_t)j;
+		nodes[j] = fbxJointNodes[order[j]];
+		mSkeleton.InverseBindPose[j] = fbxInverseBindPose[order[j]];
+	}
+
+	fbxJointNodes.swap(nodes);
+
+	for (UINT j = 0; j < jointCount; j++)
+		fbxJointIndices[fbxJointNodes[j]] = (uint16_t)j;
+
+	// A joint's parent is its nearest ancestor that is also a joint; any
+	// nodes in between are folded into the joint's local transform.
+	mSkeleton.Parents.assign(jointCount, -1);
+
+	for (UINT j = 0; j < jointCount; j++)
+	{
+		for (FbxNode* lNode = fbxJointNodes[j]->GetParent(); lNode; lNode = lNode->GetParent())
+		{
+			auto found = fbxJointIndices.find(lNode);
+			if (found != fbxJointIndices.end())
+			{
+				mSkeleton.Parents[j] = found->second;
+				break;
+			}
+		}
+	}
+
+	for (SkinInfluence& influence : fbxInfluences)
+	{
+		for (int k = 0; k < 4 && influence.Weights[k] > 0.0f; k++)
+			influence.Joints[k] = remap[influence.Joints[k]];
+	}
+
+	mSkeleton.BindPose.resize(jointCount);
+	DisplayPose(FBXSDK_TIME_INFINITE, mSkeleton.BindPose.data());
+}
+
+void InitDirect3DApp::DisplayAnimation(FbxScene* pScene)
+{
+	// Bake every stack at a fixed rate so playback never touches the FBX
+	// curves, then keep only the compressed clip.
+	const float lSampleRate = 30.0f;
+	const CompressionSettings lSettings = { 0.0005f, 0.005f, 0.0005f };
+	UINT jointCount = mSkeleton.JointCount();
+
+	int lStackCount = pScene->GetSrcObjectCount<FbxAnimStack>();
+
+	for (int i = 0; i < lStackCount; i++)
+	{
+		FbxAnimStack* lStack = pScene->GetSrcObject<FbxAnimStack>(i);
+		pScene->SetCurrentAnimationStack(lStack);
+
+		FbxTimeSpan lSpan = lStack->GetLocalTimeSpan();
+		double lStart = lSpan.GetStart().GetSecondDouble();
+		double lDuration = lSpan.GetDuration().GetSecondDouble();
+
+		if (lDuration <= 0.0)
+			continue;
+
+		AnimationClip clip;
+		clip.Name = lStack->GetName();
+		clip.Duration = (float)lDuration;
+		clip.SampleRate = lSampleRate;
+		clip.FrameCount = (uint32_t)ceil(lDuration * lSampleRate) + 1;
+		clip.JointCount = jointCount;
+		clip.Keys.resize((size_t)clip.FrameCount * jointCount);
+
+		// Blend shape weights are baked alongside, 0-100 percent mapped to 0-1.
+		MorphWeightTrack weights;
+		weights.Duration = clip.Duration;
+		weights.SampleRate = lSampleRate;
+		weights.FrameCount = clip.FrameCount;
+		weights.TargetCount = (uint32_t)fbxMorphChannels.size();
+		weights.Weights.resize((size_t)weights.FrameCount * weights.TargetCount);
+
+		for (uint32_t f = 0; f < clip.FrameCount; f++)
+		{
+			FbxTime lTime;
+			lTime.SetSecondDouble(lStart + min(f / (double)lSampleRate, lDuration));
+
+			DisplayPose(lTime, &clip.Keys[(size_t)f * jointCount]);
+
+			for (uint32_t k = 0; k < weights.TargetCount; k++)
+				weights.Weights[(size_t)f * weights.TargetCount + k] = (float)(fbxMorphChannels[k]->DeformPercent.EvaluateValue(lTime) / 100.0);
+		}
+
+		mMorphWeights.push_back(move(weights));
+
+		mClips.push_back(CompressedClip());
+		CompressionStats stats = mClips.back().Compress(clip, lSettings);
+
+		char line[256];
+		snprintf(line, sizeof(line), "Animation \"%s\": %zu -> %zu bytes (%.1f:1), max error %.5f rad / %.5f / %.5f\n",
+			clip.Name.c_str(), stats.RawBytes, stats.CompressedBytes, stats.Ratio,
+			stats.MaxRotationError, stats.MaxTranslationError, stats.MaxScaleError);
+		OutputDebugStringA(line);
+	}
+}
+
+void InitDirect3DApp::DisplayPose(FbxTime time, BoneTransform* pose)
+{
+	UINT jointCount = (UINT)fbxJointNodes.size();
+	fbxJointGlobals.resize(jointCount);
+
+	for (UINT j = 0; j < jointCount; j++)
+	{
+		fbxJointGlobals[j] = fbxJointNodes[j]->EvaluateGlobalTransform(time);
+
+		int parent = mSkeleton.Parents[j];
+		FbxAMatrix lLocal = parent < 0 ? fbxJointGlobals[j] : fbxJointGlobals[parent].Inverse() * fbxJointGlobals[j];
+
+		FbxQuaternion lRotation = lLocal.GetQ();
+		FbxVector4 lTranslation = lLocal.GetT();
+		FbxVector4 lScale = lLocal.GetS();
+
+		pose[j].Rotation = XMFLOAT4A((float)lRotation[0], (float)lRotation[1], (float)lRotation[2], (float)lRotation[3]);
+		pose[j].Translation = XMFLOAT4A((float)lTranslation[0], (float)lTranslation[1], (float)lTranslation[2], 0.0f);
+		pose[j].Scale = XMFLOAT4A((float)lScale[0], (float)lScale[1], (float)lScale[2], 0.0f);
+	}
+}
+
+void InitDirect3DApp::AddPickable(const char* name, SceneGraph::NodeId node, const XMFLOAT3* positions, uint32_t positionStride,
+	const uint32_t* indices, uint32_t triangleCount)
+{
+	Pickable pickable;
+	pickable.Name = name;
+	pickable.Node = node;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	pickable.Triangles.Build(positions, positionStride, indices, triangleCount);
+
+	char line[256];
+	snprintf(line, sizeof(line), "BVH %s: %u triangles, %u nodes, %zu KB, built in %.2f ms\n", name, triangleCount,
+		pickable.Triangles.NodeCount(), pickable.Triangles.SizeInBytes() / 1024,
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	mPickables.push_back(move(pickable));
+}
+
+InitDirect3DApp::OcclusionBake* InitDirect3DApp::BakeOcclusion(const string& cacheName, const vector<XMFLOAT3>& positions,
+	const vector<uint32_t>& indices, const Bvh& bvh, XMFLOAT4 color, UINT vertexOffset, vector<float>& visibility)
+{
+	PROFILE_FUNCTION();
+
+	// The model starts with whatever the cache holds, or unshaded, and a
+	// bake short of OcclusionSamples carries on in the background from
+	// there, saving as it goes so the next run resumes it.
+	const uint32_t seed = 0x414f;
+
+	XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+	XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+	for (const XMFLOAT3& position : positions)
+	{
+		lo = XMVectorMin(lo, XMLoadFloat3(&position));
+		hi = XMVectorMax(hi, XMLoadFloat3(&position));
+	}
+
+	// Occluders further than a tenth of the model darken nothing.
+	float radius = 0.1f * XMVectorGetX(XMVector3Length(XMVectorSubtract(hi, lo)));
+
+	unique_ptr<OcclusionBake> bake(new OcclusionBake());
+	bake->CacheName = cacheName;
+	bake->Triangles = bvh;
+	bake->Color = color;
+	bake->VertexOffset = vertexOffset;
+	bake->Baker.Begin(positions.data(), (uint32_t)sizeof(XMFLOAT3), (uint32_t)positions.size(), indices.data(),
+		(uint32_t)indices.size() / 3, bake->Triangles, radius, seed);
+	bake->Baker.Load(cacheName);
+
+	char line[256];
+	snprintf(line, sizeof(line), "AO %s: %u/%u samples cached\n", cacheName.c_str(), bake->Baker.SampleCount(), OcclusionSamples);
+	OutputDebugStringA(line);
+
+	visibility.resize(positions.size());
+	bake->Baker.Resolve(visibility.data());
+
+	if (bake->Baker.SampleCount() >= OcclusionSamples)
+		return nullptr;
+
+	mOcclusionBakes.push_back(move(bake));
+	return mOcclusionBakes.back().get();
+}
+
+void InitDirect3DApp::LucyThreadMain()
+{
+	// Nothing reads the volumes until mLucyReady is set, so they are built
+	// in place, on a pool of their own like the AO bake's.
+	ThreadPool pool(max(thread::hardware_concurrency() / 2, 1u) - 1);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mLucyVoxels.Build(mLucyPositions.data(), (uint32_t)sizeof(XMFLOAT3), mLucyIndices.data(), (uint32_t)mLucyIndices.size() / 3, 256, true,
+		pool);
+
+	char line[256];
+	snprintf(line, sizeof(line), "Voxels AngelLucy: %u^3, %llu set, %u nodes, %u bricks, %zu KB (%.3f bytes per voxel), built in %.2f ms\n",
+		mLucyVoxels.Resolution(), (unsigned long long)mLucyVoxels.VoxelCount(), mLucyVoxels.NodeCount(), mLucyVoxels.BrickCount(),
+		mLucyVoxels.SizeInBytes() / 1024, (double)mLucyVoxels.SizeInBytes() / max(mLucyVoxels.VoxelCount(), (uint64_t)1),
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	// The pickables are per mesh node, so the field has a Bvh of its own
+	// over the whole file.
+	start = chrono::steady_clock::now();
+	Bvh triangles;
+	triangles.Build(mLucyPositions.data(), (uint32_t)sizeof(XMFLOAT3), mLucyIndices.data(), (uint32_t)mLucyIndices.size() / 3);
+	mLucyField.Bake(mLucyPositions.data(), (uint32_t)sizeof(XMFLOAT3), mLucyIndices.data(), (uint32_t)mLucyIndices.size() / 3, triangles,
+		128, 4.0f, pool);
+
+	snprintf(line, sizeof(line), "Distance field AngelLucy: %u^3, %u bricks, %zu KB, baked in %.2f ms\n", mLucyField.Resolution(),
+		mLucyField.BrickCount(), mLucyField.SizeInBytes() / 1024, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	mLucyReady = true;
+}
+
+void InitDirect3DApp::OcclusionThreadMain()
+{
+	// Half the cores, so the frame's own parallel loops keep the rest.
+	ThreadPool pool(max(thread::hardware_concurrency() / 2, 1u) - 1);
+
+	for (const unique_ptr<OcclusionBake>& bake : mOcclusionBakes)
+	{
+		AmbientOcclusionBaker& baker = bake->Baker;
+		uint32_t cachedSamples = baker.SampleCount();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		while (!mOcclusionStop && baker.SampleCount() < OcclusionSamples)
+		{
+			baker.Trace(min(OcclusionSamplesPerPass, OcclusionSamples - baker.SampleCount()), pool);
+			baker.Save(bake->CacheName);
+
+			vector<float> visibility(bake->Vertices.size());
+			baker.Resolve(visibility.data());
+
+			lock_guard<mutex> lock(mOcclusionMutex);
+			bake->Visibility.swap(visibility);
+			bake->Updated = true;
+		}
+
+		double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		char line[256];
+		snprintf(line, sizeof(line), "AO %s: %u/%u samples (%u cached), %llu rays in %.1f ms, %.2f Mrays/s\n", bake->CacheName.c_str(),
+			baker.SampleCount(), OcclusionSamples, cachedSamples, (unsigned long long)baker.RayCount(), elapsedMs,
+			elapsedMs > 0.0 ? baker.RayCount() / (elapsedMs * 1e3) : 0.0);
+		OutputDebugStringA(line);
+	}
+}
+
+void InitDirect3DApp::UpdateOcclusion()
+{
+	PROFILE_FUNCTION();
+
+	for (const unique_ptr<OcclusionBake>& bake : mOcclusionBakes)
+	{
+		// The frame does not wait for a pass being published; it picks it
+		// up on the next one.
+		vector<float> visibility;
+		{
+			unique_lock<mutex> lock(mOcclusionMutex, try_to_lock);
+			if (!lock || !bake->Updated)
+				continue;
+
+			visibility.swap(bake->Visibility);
+			bake->Updated = false;
+		}
+
+		// An animated character's vertices are uploaded every frame from
+		// its skinned copy, so that is where its colors go.
+		bool skinned = bake->VertexOffset == mFbx2VertexOffset && !mSkinnedVertices.empty();
+
+		for (size_t i = 0; i < bake->Vertices.size(); i++)
+		{
+			XMFLOAT4 color = bake->Color;
+			color.x *= visibility[i];
+			color.y *= visibility[i];
+			color.z *= visibility[i];
+			bake->Vertices[i].Color = color;
+			if (skinned)
+				mSkinnedVertices[i].Color = color;
+		}
+
+		if (skinned)
+			continue;
+
+		D3D11_BOX box;
+		box.left = bake->VertexOffset * (UINT)sizeof(Vertex);
+		box.right = box.left + (UINT)(bake->Vertices.size() * sizeof(Vertex));
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+
+		md3dDeviceContext->UpdateSubresource(mVertexBuffer, 0, &box, bake->Vertices.data(), 0, 0);
+	}
+}
+
+TextureStreamer::TextureId InitDirect3DApp::LoadAtlas(const string& cookedName, const vector<TextureImage>& images, vector<AtlasRect>& rects,
+	UINT& width, UINT& height)
+{
+	PROFILE_FUNCTION();
+
+	// A 16-texel grid keeps the box-filtered mips of each image apart down
+	// to level 4, and the gutter keeps bilinear taps in their own image
+	// down to level 3.
+	const uint32_t gutter = 8;
+	const uint32_t alignment = 16;
+
+	rects.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		rects[i].Width = images[i].Width;
+		rects[i].Height = images[i].Height;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	if (!TextureAtlas::Pack(rects, gutter, alignment, D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION, width, height))
+		return TextureStreamer::InvalidTexture;
+
+	char line[256];
+	snprintf(line, sizeof(line), "Atlas %s: %zu images in %ux%u, %.1f%% used, packed in %.3f ms\n", cookedName.c_str(),
+		images.size(), width, height, 100.0f * TextureAtlas::Efficiency(rects, width, height),
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	// The cooked atlas is streamed from if it was cooked from this layout
+	// and these images.  Otherwise, say when an image was left out on an
+	// earlier run, its rects would not match the UVs, so it is composed and
+	// cooked again.
+	uint64_t hash = TextureAtlas::Hash(images, rects, gutter, alignment, width, height);
+	bool current = false;
+	{
+		MappedFile cooked;
+		DdsLayout layout;
+		current = cooked.Open(cookedName) && DdsFile::ParseLayout(cooked.Data(), cooked.Size(), layout)
+			&& layout.Tag == hash && layout.Width == width && layout.Height == height;
+	}
+
+	if (!current)
+	{
+		TextureImage atlas;
+		TextureAtlas::Compose(images, rects, gutter, alignment, width, height, atlas);
+
+		// A wider filter would blend neighbouring images into each other.
+		if (!CookTexture(atlas, MipGenerator::Box, hash, cookedName))
+			return TextureStreamer::InvalidTexture;
+	}
+
+	return mTextureStreamer.Add(cookedName);
+}
+
+bool InitDirect3DApp::LoadTerrain(const string& cookedName)
+{
+	PROFILE_FUNCTION();
+
+	// Two kilometres at a metre a sample.  The heightmap is generated and
+	// cooked only when there is no cooked file yet, or one of another
+	// layout.
+	const uint32_t size = 2049;
+	const uint32_t chunkQuads = 32;
+	const float spacing = 1.0f;
+
+	if (!mTerrain.Open(cookedName) || mTerrain.Extent() != (size - 1) * spacing
+		|| mTerrain.VertexCount() != (chunkQuads + 1) * (chunkQuads + 1))
+	{
+		// The file stays mapped while open, so it could not be rewritten.
+		mTerrain.Close();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		vector<float> heights;
+		GenerateTerrainHeights(size, spacing, heights);
+		if (!Terrain::Cook(heights.data(), size, chunkQuads, spacing, cookedName) || !mTerrain.Open(cookedName))
+			return false;
+
+		char line[256];
+		snprintf(line, sizeof(line), "Terrain %s: %ux%u samples cooked in %.1f ms\n", cookedName.c_str(), size, size,
+			chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		OutputDebugStringA(line);
+	}
+
+	// The valley floor, at height zero, sits just under the other objects.
+	float extent = mTerrain.Extent();
+	mTerrainOrigin = XMFLOAT3(-0.5f * extent, -3.0f, -0.5f * extent);
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.ByteWidth = TerrainSlots * mTerrain.VertexCount() * (UINT)sizeof(Vertex);
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&vbd, nullptr, &mTerrainVertexBuffer)))
+		return false;
+
+	vector<uint16_t> indices;
+	for (uint32_t mask = 0; mask < Terrain::EdgePatterns; mask++)
+	{
+		const vector<uint16_t>& pattern = mTerrain.Indices(mask);
+		mTerrainIndexOffsets[mask] = (UINT)indices.size();
+		mTerrainIndexCounts[mask] = (UINT)pattern.size();
+		indices.insert(indices.end(), pattern.begin(), pattern.end());
+	}
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.ByteWidth = sizeof(uint16_t) * (UINT)indices.size();
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA isd;
+	isd.pSysMem = indices.data();
+	isd.SysMemPitch = 0;
+	isd.SysMemSlicePitch = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&ibd, &isd, &mTerrainIndexBuffer)))
+		return false;
+
+	mTerrainCache.Clear();
+	return true;
+}
+
+void InitDirect3DApp::UpdateTerrain()
+{
+	PROFILE_FUNCTION();
+
+	mTerrainDraws.clear();
+	mTerrainUploadSlots.clear();
+
+	if (!mTerrainIndexBuffer)
+		return;
+
+	// Selection works in terrain space, which is world space shifted.
+	XMMATRIX terrainWorld = XMMatrixTranslation(mTerrainOrigin.x, mTerrainOrigin.y, mTerrainOrigin.z);
+	XMVECTOR eye = XMVector3TransformCoord(XMVectorZero(), XMMatrixInverse(nullptr, terrainWorld * mView));
+	float pixelScale = 0.5f * mClientHeight * XMVectorGetY(mProj.r[1]);
+	const float pixelError = 1.0f;
+
+	mTerrain.Select(terrainWorld * mView * mProj, eye, pixelScale, pixelError, mTerrainPatches, mTerrainStats);
+
+	// A patch that finds no free slot is skipped this frame; the pool is
+	// sized so that does not happen at this error.
+	vector<const TerrainPatch*> builds;
+	mTerrainCache.BeginFrame();
+
+	for (const TerrainPatch& patch : mTerrainPatches)
+	{
+		bool fresh;
+		UINT slot = mTerrainCache.Acquire(patch.Node, fresh);
+		if (slot == TerrainPatchCache::InvalidSlot)
+			continue;
+
+		mTerrainDraws.push_back({ slot, patch.EdgeMask });
+		if (fresh)
+		{
+			mTerrainUploadSlots.push_back(slot);
+			builds.push_back(&patch);
+		}
+	}
+
+	if (builds.empty())
+		return;
+
+	// Grass on the flats and rock on the slopes, lit by a fixed sun.
+	const XMVECTOR sun = XMVector3Normalize(XMVectorSet(0.4f, 0.8f, -0.3f, 0.0f));
+	const XMVECTOR grass = XMVectorSet(0.30f, 0.45f, 0.20f, 1.0f);
+	const XMVECTOR rock = XMVectorSet(0.45f, 0.42f, 0.40f, 1.0f);
+
+	UINT vertexCount = mTerrain.VertexCount();
+	mTerrainUploads.resize(builds.size() * vertexCount);
+
+	ThreadPool::Get().ParallelFor((uint32_t)builds.size(), 1, [&](uint32_t begin, uint32_t end)
+	{
+		vector<XMFLOAT3> positions(vertexCount);
+		vector<XMFLOAT3> normals(vertexCount);
+
+		for (uint32_t b = begin; b < end; b++)
+		{
+			mTerrain.BuildPatch(*builds[b], positions.data(), normals.data());
+
+			Vertex* vertices = &mTerrainUploads[b * vertexCount];
+			for (UINT v = 0; v < vertexCount; v++)
+			{
+				XMVECTOR normal = XMLoadFloat3(&normals[v]);
+				float slope = min(max((0.9f - normals[v].y) * 5.0f, 0.0f), 1.0f);
+				float light = 0.35f + 0.65f * max(XMVectorGetX(XMVector3Dot(normal, sun)), 0.0f);
+
+				vertices[v].Pos = positions[v];
+				XMStoreFloat4(&vertices[v].Color, XMVectorSetW(XMVectorScale(XMVectorLerp(grass, rock, slope), light), 1.0f));
+				vertices[v].TexC = mTerrainTexC;
+			}
+		}
+	});
+}
+
+bool InitDirect3DApp::CreateBezier()
+{
+	PROFILE_FUNCTION();
+
+	vector<XMFLOAT3> points;
+	vector<uint32_t> patches;
+	GenerateTorusPatches(1.0f, 0.4f, points, patches);
+	mBezier.Create(points.data(), (uint32_t)points.size(), patches.data(), (uint32_t)patches.size() / 16);
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.ByteWidth = mBezier.PatchCount() * BezierSurface::MaxPatchVertices * (UINT)sizeof(Vertex);
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&vbd, nullptr, &mBezierVertexBuffer)))
+		return false;
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.ByteWidth = mBezier.PatchCount() * BezierSurface::MaxPatchIndices * (UINT)sizeof(uint32_t);
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	return SUCCEEDED(md3dDevice->CreateBuffer(&ibd, nullptr, &mBezierIndexBuffer));
+}
+
+void InitDirect3DApp::UpdateBezier()
+{
+	PROFILE_FUNCTION();
+
+	if (!mBezierIndexBuffer)
+		return;
+
+	XMVECTOR eye = XMVector3TransformCoord(XMVectorZero(), XMMatrixInverse(nullptr, mSceneGraph.GetWorld(mBezierNode) * mView));
+	float pixelScale = 0.5f * mClientHeight * XMVectorGetY(mProj.r[1]);
+	const float pixelError = 1.0f;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mBezier.Update(eye, pixelScale, pixelError);
+
+	const vector<uint32_t>& changed = mBezier.ChangedPatches();
+	if (changed.empty())
+		return;
+
+	double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	if (elapsed > 0.0)
+		mBezierPatchRate = changed.size() / elapsed;
+
+	mBezierUploads.resize(changed.size() * BezierSurface::MaxPatchVertices);
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		const GeometryGenerator::MeshData& mesh = mBezier.PatchMesh(changed[i]);
+		Vertex* vertices = &mBezierUploads[i * BezierSurface::MaxPatchVertices];
+
+		for (size_t v = 0; v < mesh.Vertices.size(); v++)
+		{
+			const XMFLOAT3& normal = mesh.Vertices[v].Normal;
+			float light = 0.45f + 0.55f * max(normal.y * 0.8f + normal.x * 0.4f - normal.z * 0.45f, 0.0f);
+			vertices[v] = Vertex({mesh.Vertices[v].Position, XMFLOAT4(0.45f * light, 0.6f * light, 0.85f * light, 1.0f), mBezierTexC});
+		}
+	}
+}
+
+bool InitDirect3DApp::CreateOcean()
+{
+	PROFILE_FUNCTION();
+
+	// A light wind over 32 metres, sampled every eighth of a metre.
+	const uint32_t size = 256;
+	const float length = 32.0f;
+	mOcean.Create(size, length, 6.0f, XMFLOAT2(0.8f, 0.6f), 0.0004f, 1.0f, 0x6f63);
+
+	// A row and column more than there are samples, the last of each
+	// taking the first's samples, so the patch's edges match.
+	GeometryGenerator generator;
+	GeometryGenerator::MeshData grid = generator.CreateGrid(length, length, size + 1, size + 1);
+
+	mOceanGrid.resize(grid.Vertices.size());
+	mOceanUploads.resize(grid.Vertices.size());
+	for (size_t v = 0; v < grid.Vertices.size(); v++)
+	{
+		mOceanGrid[v] = grid.Vertices[v].Position;
+		mOceanUploads[v].TexC = mOceanTexC;
+	}
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.ByteWidth = (UINT)(mOceanUploads.size() * sizeof(Vertex));
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&vbd, nullptr, &mOceanVertexBuffer)))
+		return false;
+
+	mOceanIndexCount = (UINT)grid.Indices32.size();
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.ByteWidth = mOceanIndexCount * (UINT)sizeof(uint32_t);
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA isd;
+	isd.pSysMem = grid.Indices32.data();
+	isd.SysMemPitch = 0;
+	isd.SysMemSlicePitch = 0;
+
+	return SUCCEEDED(md3dDevice->CreateBuffer(&ibd, &isd, &mOceanIndexBuffer));
+}
+
+void InitDirect3DApp::UpdateOcean()
+{
+	PROFILE_FUNCTION();
+
+	if (!mOceanIndexBuffer)
+		return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mOcean.Update(mTimer.TotalTimeSeconds());
+	mOceanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	// Deep blue under the terrain's sun.
+	const XMVECTOR sun = XMVector3Normalize(XMVectorSet(0.4f, 0.8f, -0.3f, 0.0f));
+	const XMVECTOR water = XMVectorSet(0.10f, 0.28f, 0.42f, 1.0f);
+
+	const uint32_t size = mOcean.Size();
+	const uint32_t columns = size + 1;
+	const float* heights = mOcean.Heights();
+	const float* displacementsX = mOcean.DisplacementsX();
+	const float* displacementsZ = mOcean.DisplacementsZ();
+	const vector<XMFLOAT3>& normals = mOcean.Normals();
+
+	ThreadPool::Get().ParallelFor(columns, 16, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			// Grid rows run from +z to -z, and the grid starts half a patch
+			// before the samples' origin on both axes.
+			uint32_t z = (size + size / 2 - i) % size;
+
+			for (uint32_t j = 0; j < columns; j++)
+			{
+				uint32_t sample = (j + size / 2) % size + size * z;
+				uint32_t v = i * columns + j;
+
+				const XMFLOAT3& rest = mOceanGrid[v];
+				float light = 0.35f + 0.65f * max(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[sample]), sun)), 0.0f);
+
+				mOceanUploads[v].Pos = XMFLOAT3(rest.x + displacementsX[sample], rest.y + heights[sample], rest.z + displacementsZ[sample]);
+				XMStoreFloat4(&mOceanUploads[v].Color, XMVectorSetW(XMVectorScale(water, light), 1.0f));
+			}
+		}
+	});
+}
+
+bool InitDirect3DApp::CreateParticles()
+{
+	PROFILE_FUNCTION();
+
+	mParticles.Create(ParticleCapacity, XMFLOAT3(0.0f, -9.8f, 0.0f), 0x7073);
+
+	// Three fountains standing in the water around the other objects.
+	static const XMFLOAT3 fountains[] =
+	{
+		XMFLOAT3(-6.0f, -2.8f, 4.0f),
+		XMFLOAT3(6.0f, -2.8f, 4.0f),
+		XMFLOAT3(0.0f, -2.8f, 8.0f)
+	};
+
+	for (const XMFLOAT3& fountain : fountains)
+	{
+		ParticleEmitter emitter;
+		emitter.Position = fountain;
+		emitter.Rate = 4000.0f;
+		emitter.Velocity = XMFLOAT3(0.0f, 6.0f, 0.0f);
+		emitter.Spread = 1.5f;
+		emitter.Lifetime = 2.5f;
+		emitter.Size = 0.04f;
+		emitter.Color = XMFLOAT4(1.0f, 0.75f, 0.35f, 1.0f);
+		mParticles.AddEmitter(emitter);
+	}
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.ByteWidth = ParticleRingVertices * (UINT)sizeof(Vertex);
+	vbd.Usage = D3D11_USAGE_DYNAMIC;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&vbd, nullptr, &mParticleVertexBuffer)))
+		return false;
+
+	// The same two triangles for every quad, drawn from wherever in the
+	// ring the frame's vertices start.
+	static const uint32_t corners[6] = { 0, 1, 2, 0, 2, 3 };
+	vector<uint32_t> indices(ParticleCapacity * 6);
+	for (uint32_t quad = 0; quad < ParticleCapacity; quad++)
+	{
+		for (uint32_t k = 0; k < 6; k++)
+			indices[quad * 6 + k] = quad * 4 + corners[k];
+	}
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.ByteWidth = (UINT)(indices.size() * sizeof(uint32_t));
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA isd;
+	isd.pSysMem = indices.data();
+	isd.SysMemPitch = 0;
+	isd.SysMemSlicePitch = 0;
+
+	return SUCCEEDED(md3dDevice->CreateBuffer(&ibd, &isd, &mParticleIndexBuffer));
+}
+
+void InitDirect3DApp::UpdateParticles(float dt)
+{
+	PROFILE_FUNCTION();
+
+	if (!mParticleIndexBuffer)
+		return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mParticles.Update(dt);
+	mParticleMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Metaballs meshed as an isosurface of their summed falloff.  The field
+// is evaluated four points of a row at a time.
+GeometryGenerator::MeshData InitDirect3DApp::CreateBlob(GeometryGenerator& generator)
+{
+	PROFILE_FUNCTION();
+
+	// Center and radius of each ball.
+	static const XMFLOAT4 balls[] =
+	{
+		XMFLOAT4(0.0f, 0.0f, 0.0f, 0.9f),
+		XMFLOAT4(0.5f, 0.35f, 0.1f, 0.6f),
+		XMFLOAT4(-0.45f, 0.3f, -0.2f, 0.55f),
+		XMFLOAT4(0.1f, -0.5f, 0.4f, 0.6f),
+		XMFLOAT4(-0.2f, 0.55f, 0.45f, 0.45f)
+	};
+
+	const float threshold = 0.35f;
+	const uint32_t size = 64;
+
+	auto field = [&](const float* x, float y, float z, uint32_t count, float* values)
+	{
+		for (uint32_t i = 0; i < count; i += 4)
+		{
+			uint32_t lanes = min(count - i, 4u);
+			XMFLOAT4 row(x[i], lanes > 1 ? x[i + 1] : 0.0f, lanes > 2 ? x[i + 2] : 0.0f, lanes > 3 ? x[i + 3] : 0.0f);
+			XMVECTOR px = XMLoadFloat4(&row);
+			XMVECTOR sum = XMVectorZero();
+
+			for (const XMFLOAT4& ball : balls)
+			{
+				// (1 - d^2 / r^2)^3 inside the ball and zero outside.
+				XMVECTOR dx = XMVectorSubtract(px, XMVectorReplicate(ball.x));
+				float dyz = (y - ball.y) * (y - ball.y) + (z - ball.z) * (z - ball.z);
+				XMVECTOR d2 = XMVectorAdd(XMVectorMultiply(dx, dx), XMVectorReplicate(dyz));
+				XMVECTOR t = XMVectorMax(XMVectorSubtract(XMVectorReplicate(1.0f), XMVectorScale(d2, 1.0f / (ball.w * ball.w))), XMVectorZero());
+				sum = XMVectorAdd(sum, XMVectorMultiply(XMVectorMultiply(t, t), t));
+			}
+
+			XMFLOAT4 result;
+			XMStoreFloat4(&result, XMVectorSubtract(XMVectorReplicate(threshold), sum));
+			memcpy(values + i, &result, lanes * sizeof(float));
+		}
+	};
+
+	auto start = chrono::steady_clock::now();
+	GeometryGenerator::MeshData mesh = generator.CreateIsosurface(field, XMFLOAT3(-1.5f, -1.5f, -1.5f), 3.0f / (size - 1),
+		size, size, size, 0.0f);
+
+	char line[256];
+	snprintf(line, sizeof(line), "Blob: %zu triangles from %u^3 samples in %.1f ms\n", mesh.Indices32.size() / 3, size,
+		chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	OutputDebugStringA(line);
+
+	return mesh;
+}
+
+bool InitDirect3DApp::CookTexture(const TextureImage& image, MipGenerator::Filter filter, uint64_t tag, const string& cookedName)
+{
+	PROFILE_FUNCTION();
+
+	// Block formats need whole blocks at the top level.
+	if (image.Width % 4 != 0 || image.Height % 4 != 0)
+		return false;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<TextureImage> mips;
+	MipGenerator::Generate(image, filter, true, mips);
+
+	chrono::steady_clock::time_point filtered = chrono::steady_clock::now();
+
+	CompressedTexture cooked;
+	cooked.Format = BlockCompressor::BC7;
+	cooked.Width = image.Width;
+	cooked.Height = image.Height;
+	cooked.Levels.resize(mips.size());
+	cooked.Tag = tag;
+
+	double chainMegapixels = 0.0;
+	for (size_t i = 0; i < mips.size(); i++)
+	{
+		BlockCompressor::Encode(mips[i], cooked.Format, cooked.Levels[i]);
+		chainMegapixels += mips[i].Width * (double)mips[i].Height / 1e6;
+	}
+
+	chrono::steady_clock::time_point encoded = chrono::steady_clock::now();
+
+	TextureImage check;
+	BlockCompressor::Decode(cooked.Levels[0].data(), cooked.Levels[0].size(), cooked.Format, image.Width, image.Height, check);
+
+	char line[256];
+	snprintf(line, sizeof(line), "Texture %s: %ux%u, mips %.1f MP/s, BC7 %.1f MP/s, PSNR %.2f dB RGB, %.2f dB RGBA\n",
+		cookedName.c_str(), image.Width, image.Height,
+		image.Width * (double)image.Height / 1e6 / chrono::duration<double>(filtered - start).count(),
+		chainMegapixels / chrono::duration<double>(encoded - filtered).count(),
+		BlockCompressor::Psnr(image, check, false), BlockCompressor::Psnr(image, check, true));
+	OutputDebugStringA(line);
+
+	return DdsFile::Save(cookedName, cooked);
+}
+
+ID3D11ShaderResourceView* InitDirect3DApp::CreateTexture(const vector<TextureImage>& mips)
+{
+	vector<D3D11_SUBRESOURCE_DATA> levels(mips.size());
+	for (size_t i = 0; i < mips.size(); i++)
+	{
+		levels[i].pSysMem = mips[i].Pixels.data();
+		levels[i].SysMemPitch = mips[i].Width * 4;
+		levels[i].SysMemSlicePitch = 0;
+	}
+
+	// The back buffer is UNORM and vertex colors are written as is, so the
+	// texture is sampled without sRGB conversion too.  The mips were still
+	// filtered in linear light.
+	return CreateTexture(mips[0].Width, mips[0].Height, DXGI_FORMAT_R8G8B8A8_UNORM, levels);
+}
+
+void* InitDirect3DApp::CreateTexture(const DdsLayout& layout, const uint8_t* data, uint32_t firstLevel)
+{
+	DXGI_FORMAT format;
+	switch (layout.Format)
+	{
+	case BlockCompressor::BC1: format = DXGI_FORMAT_BC1_UNORM; break;
+	case BlockCompressor::BC3: format = DXGI_FORMAT_BC3_UNORM; break;
+	default: format = DXGI_FORMAT_BC7_UNORM; break;
+	}
+
+	UINT width = max(layout.Width >> firstLevel, 1u);
+	UINT height = max(layout.Height >> firstLevel, 1u);
+
+	vector<D3D11_SUBRESOURCE_DATA> levels(layout.LevelOffsets.size() - firstLevel);
+	UINT levelWidth = width;
+
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		// The pitch of a block format is one row of blocks.
+		levels[i].pSysMem = data + layout.LevelOffsets[firstLevel + i];
+		levels[i].SysMemPitch = (UINT)BlockCompressor::LevelSize(layout.Format, levelWidth, 1);
+		levels[i].SysMemSlicePitch = 0;
+
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+	}
+
+	// Called from the streaming thread; the device is free-threaded.
+	return CreateTexture(width, height, format, levels);
+}
+
+void InitDirect3DApp::ReleaseTexture(void* texture)
+{
+	((ID3D11ShaderResourceView*)texture)->Release();
+}
+
+ID3D11ShaderResourceView* InitDirect3DApp::CreateTexture(UINT width, UINT height, DXGI_FORMAT format, const vector<D3D11_SUBRESOURCE_DATA>& levels)
+{
+	D3D11_TEXTURE2D_DESC td;
+	td.Width = width;
+	td.Height = height;
+	td.MipLevels = (UINT)levels.size();
+	td.ArraySize = 1;
+	td.Format = format;
+	td.SampleDesc.Count = 1;
+	td.SampleDesc.Quality = 0;
+	td.Usage = D3D11_USAGE_IMMUTABLE;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	td.CPUAccessFlags = 0;
+	td.MiscFlags = 0;
+
+	// Every level goes up in the one call.
+	ID3D11Texture2D* texture = nullptr;
+	{
+		PROFILE_SCOPE("Create Texture");
+		if (FAILED(md3dDevice->CreateTexture2D(&td, levels.data(), &texture)))
+			return nullptr;
+	}
+
+	ID3D11ShaderResourceView* view = nullptr;
+	md3dDevice->CreateShaderResourceView(texture, nullptr, &view);
+	texture->Release();
+
+	return view;
 }
 
 ID3DBlob* InitDirect3DApp::LoadShader(const string& filename)
 {
+	PROFILE_FUNCTION();
+
 	ifstream ifs(filename, ios::binary);
 
 	ifs.seekg(0, ios::end);
@@ -492,3 +2688,157 @@ ID3DBlob* InitDirect3DApp::LoadShader(const string& filename)
 
 	return pBlob;
 }
+
+bool InitDirect3DApp::CreateBodies()
+{
+	PROFILE_FUNCTION();
+
+	mt19937 random(0x626f);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	mBodyPositions.resize(BodyCount);
+	mBodyVelocities.resize(BodyCount);
+	mBodyRadii.resize(BodyCount);
+	mBodyIsBox.resize(BodyCount);
+	mBodyTouching.assign(BodyCount, 0);
+
+	for (uint32_t i = 0; i < BodyCount; i++)
+	{
+		mBodyPositions[i] = XMFLOAT3(40.0f * unit(random) - 20.0f, 10.0f * unit(random), 40.0f * unit(random) - 20.0f);
+		mBodyVelocities[i] = XMFLOAT3(4.0f * unit(random) - 2.0f, 4.0f * unit(random) - 2.0f, 4.0f * unit(random) - 2.0f);
+		mBodyRadii[i] = 0.1f + 0.15f * unit(random);
+		mBodyIsBox[i] = (uint8_t)(i % 2);
+	}
+
+	mBodyBoxes.Resize(BodyCount);
+
+	D3D11_BUFFER_DESC vbd;
+	vbd.ByteWidth = 8 * BodyCount * (UINT)sizeof(Vertex);
+	vbd.Usage = D3D11_USAGE_DYNAMIC;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	if (FAILED(md3dDevice->CreateBuffer(&vbd, nullptr, &mBodyVertexBuffer)))
+		return false;
+
+	// The cube's faces as the box's above, the octahedron's between its
+	// tips along x, y and z.
+	static const uint32_t cube[36] =
+	{
+		0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 4, 5, 1, 4, 1, 0, 3, 2, 6, 3, 6, 7, 1, 5, 6, 1, 6, 2, 4, 0, 3, 4, 3, 7
+	};
+	static const uint32_t octahedron[24] =
+	{
+		2, 0, 4, 2, 5, 0, 2, 1, 5, 2, 4, 1, 3, 4, 0, 3, 0, 5, 3, 5, 1, 3, 1, 4
+	};
+
+	vector<uint32_t> indices;
+	for (uint32_t i = 0; i < BodyCount; i++)
+	{
+		if (mBodyIsBox[i])
+			for (uint32_t index : cube)
+				indices.push_back(8 * i + index);
+		else
+			for (uint32_t index : octahedron)
+				indices.push_back(8 * i + index);
+	}
+	mBodyIndexCount = (UINT)indices.size();
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.ByteWidth = (UINT)(indices.size() * sizeof(uint32_t));
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA isd;
+	isd.pSysMem = indices.data();
+	isd.SysMemPitch = 0;
+	isd.SysMemSlicePitch = 0;
+
+	return SUCCEEDED(md3dDevice->CreateBuffer(&ibd, &isd, &mBodyIndexBuffer));
+}
+
+void InitDirect3DApp::UpdateBodies(float dt)
+{
+	PROFILE_FUNCTION();
+
+	if (mBodyMode == BodiesOff)
+		return;
+
+	const XMVECTOR roomMin = XMVectorSet(-20.0f, 0.0f, -20.0f, 0.0f);
+	const XMVECTOR roomMax = XMVectorSet(20.0f, 10.0f, 20.0f, 0.0f);
+
+	for (uint32_t i = 0; i < mBodyBoxes.Size(); i++)
+	{
+		XMVECTOR position = XMVectorMultiplyAdd(XMLoadFloat3(&mBodyVelocities[i]), XMVectorReplicate(dt), XMLoadFloat3(&mBodyPositions[i]));
+		XMVECTOR radius = XMVectorReplicate(mBodyRadii[i]);
+
+		// Bounce off the walls by turning back whatever points out.
+		XMVECTOR velocity = XMLoadFloat3(&mBodyVelocities[i]);
+		XMVECTOR below = XMVectorAndInt(XMVectorLess(position, XMVectorAdd(roomMin, radius)), XMVectorLess(velocity, XMVectorZero()));
+		XMVECTOR above = XMVectorAndInt(XMVectorGreater(position, XMVectorSubtract(roomMax, radius)), XMVectorGreater(velocity, XMVectorZero()));
+		velocity = XMVectorSelect(velocity, XMVectorNegate(velocity), XMVectorOrInt(below, above));
+
+		XMStoreFloat3(&mBodyPositions[i], position);
+		XMStoreFloat3(&mBodyVelocities[i], velocity);
+		mBodyBoxes.Set(i, XMVectorSubtract(position, radius), XMVectorAdd(position, radius));
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (mBodyMode == BodiesSweepAndPrune)
+		mBroadphase.Update(mBodyBoxes);
+	else
+		mBodyGrid.Update(mBodyBoxes);
+	mBroadphaseMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	// Two cubes touch where their boxes do; a sphere touches a cube where
+	// its center is within its radius of the cube.
+	fill(mBodyTouching.begin(), mBodyTouching.end(), (uint8_t)0);
+	for (const BroadphasePair& pair : BodyPairs())
+	{
+		XMVECTOR a = XMLoadFloat3(&mBodyPositions[pair.A]);
+		XMVECTOR b = XMLoadFloat3(&mBodyPositions[pair.B]);
+
+		if (mBodyIsBox[pair.A] != mBodyIsBox[pair.B])
+		{
+			uint32_t box = mBodyIsBox[pair.A] ? pair.A : pair.B;
+			uint32_t sphere = mBodyIsBox[pair.A] ? pair.B : pair.A;
+			XMVECTOR center = XMLoadFloat3(&mBodyPositions[sphere]);
+			XMVECTOR extent = XMVectorReplicate(mBodyRadii[box]);
+			XMVECTOR boxCenter = XMLoadFloat3(&mBodyPositions[box]);
+			XMVECTOR closest = XMVectorClamp(center, XMVectorSubtract(boxCenter, extent), XMVectorAdd(boxCenter, extent));
+			if (XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(center, closest))) > mBodyRadii[sphere] * mBodyRadii[sphere])
+				continue;
+		}
+		else if (!mBodyIsBox[pair.A])
+		{
+			float reach = mBodyRadii[pair.A] + mBodyRadii[pair.B];
+			if (XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(b, a))) > reach * reach)
+				continue;
+		}
+
+		mBodyTouching[pair.A] = 1;
+		mBodyTouching[pair.B] = 1;
+
+		// Equal masses swap their velocities along the line between
+		// centers, if they are closing.
+		XMVECTOR normal = XMVector3Normalize(XMVectorSubtract(b, a));
+		XMVECTOR velocityA = XMLoadFloat3(&mBodyVelocities[pair.A]);
+		XMVECTOR velocityB = XMLoadFloat3(&mBodyVelocities[pair.B]);
+		XMVECTOR closing = XMVector3Dot(XMVectorSubtract(velocityB, velocityA), normal);
+		if (XMVectorGetX(closing) >= 0.0f)
+			continue;
+
+		XMStoreFloat3(&mBodyVelocities[pair.A], XMVectorMultiplyAdd(closing, normal, velocityA));
+		XMStoreFloat3(&mBodyVelocities[pair.B], XMVectorNegativeMultiplySubtract(closing, normal, velocityB));
+	}
+}
+
+const vector<BroadphasePair>& InitDirect3DApp::BodyPairs()const
+{
+	return mBodyMode == BodiesHashGrid ? mBodyGrid.Pairs() : mBroadphase.Pairs();
+}
@@ -0,0 +1,168 @@
+#include "MorphTargets.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+size_t MorphTarget::SizeInBytes()const
+{
+	return sizeof(MorphTarget) + Name.size()
+		+ Vertices.size() * sizeof(std::uint32_t)
+		+ Deltas.size() * sizeof(std::uint16_t);
+}
+
+void MorphWeightTrack::Sample(float time, bool loop, float* weights)const
+{
+	if (FrameCount == 0)
+	{
+		for (std::uint32_t t = 0; t < TargetCount; ++t)
+			weights[t] = 0.0f;
+		return;
+	}
+
+	if (loop && Duration > 0.0f)
+	{
+		time = std::fmod(time, Duration);
+		if (time < 0.0f)
+			time += Duration;
+	}
+
+	float frame = time * SampleRate;
+	if (frame < 0.0f)
+		frame = 0.0f;
+
+	std::uint32_t f0 = (std::uint32_t)frame;
+	std::uint32_t f1 = f0 + 1;
+	if (f0 >= FrameCount - 1)
+		f0 = f1 = FrameCount - 1;
+
+	float s = frame - (float)f0;
+	const float* w0 = &Weights[(size_t)f0 * TargetCount];
+	const float* w1 = &Weights[(size_t)f1 * TargetCount];
+
+	for (std::uint32_t t = 0; t < TargetCount; ++t)
+		weights[t] = f0 == f1 ? w0[t] : w0[t] + s * (w1[t] - w0[t]);
+}
+
+void MorphTargetSet::Clear()
+{
+	mTargets.clear();
+	mActive.clear();
+}
+
+std::uint32_t MorphTargetSet::AddTarget(const std::string& name, std::uint32_t firstVertex,
+	const XMFLOAT3* deltas, std::uint32_t count, float threshold)
+{
+	mTargets.push_back(MorphTarget());
+	MorphTarget& target = mTargets.back();
+	target.Name = name;
+
+	float lo[3] = { 0.0f, 0.0f, 0.0f };
+	float hi[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		XMVECTOR d = XMLoadFloat3(&deltas[i]);
+		if (XMVectorGetX(XMVector3LengthSq(d)) <= threshold * threshold)
+			continue;
+
+		const float* c = &deltas[i].x;
+		for (int k = 0; k < 3; ++k)
+		{
+			lo[k] = target.Vertices.empty() || c[k] < lo[k] ? c[k] : lo[k];
+			hi[k] = target.Vertices.empty() || c[k] > hi[k] ? c[k] : hi[k];
+		}
+
+		target.Vertices.push_back(firstVertex + i);
+	}
+
+	target.DeltaMin = XMFLOAT4A(lo[0], lo[1], lo[2], 0.0f);
+	target.DeltaScale = XMFLOAT4A((hi[0] - lo[0]) / 65535.0f, (hi[1] - lo[1]) / 65535.0f, (hi[2] - lo[2]) / 65535.0f, 0.0f);
+
+	// A fourth slot at the end lets the last delta be loaded four wide.
+	target.Deltas.reserve(target.Vertices.size() * 3 + 1);
+
+	const float* scale = &target.DeltaScale.x;
+	for (std::uint32_t v : target.Vertices)
+	{
+		const float* c = &deltas[v - firstVertex].x;
+		for (int k = 0; k < 3; ++k)
+		{
+			float x = scale[k] > 0.0f ? (c[k] - lo[k]) / scale[k] + 0.5f : 0.0f;
+			target.Deltas.push_back(x >= 65535.0f ? 65535 : (std::uint16_t)x);
+		}
+	}
+	target.Deltas.push_back(0);
+
+	return (std::uint32_t)mTargets.size() - 1;
+}
+
+std::uint32_t MorphTargetSet::TargetCount()const
+{
+	return (std::uint32_t)mTargets.size();
+}
+
+const MorphTarget& MorphTargetSet::Target(std::uint32_t index)const
+{
+	return mTargets[index];
+}
+
+size_t MorphTargetSet::SizeInBytes()const
+{
+	size_t size = 0;
+	for (const MorphTarget& target : mTargets)
+		size += target.SizeInBytes();
+	return size;
+}
+
+void MorphTargetSet::Apply(const XMFLOAT3* base, std::uint32_t count, const float* weights,
+	XMFLOAT3* out, std::uint32_t outStride)
+{
+	PROFILE_FUNCTION();
+
+	mActive.clear();
+
+	for (const MorphTarget& target : mTargets)
+	{
+		float w = weights[&target - mTargets.data()];
+		if (w == 0.0f || target.Vertices.empty())
+			continue;
+
+		ActiveTarget active;
+		active.Target = &target;
+		XMStoreFloat4A(&active.WeightedMin, XMVectorScale(XMLoadFloat4A(&target.DeltaMin), w));
+		XMStoreFloat4A(&active.WeightedScale, XMVectorScale(XMLoadFloat4A(&target.DeltaScale), w));
+		mActive.push_back(active);
+	}
+
+	const std::vector<ActiveTarget>& activeTargets = mActive;
+
+	ThreadPool::Get().ParallelFor(count, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+			*(XMFLOAT3*)((std::uint8_t*)out + (size_t)i * outStride) = base[i];
+
+		for (const ActiveTarget& active : activeTargets)
+		{
+			const std::vector<std::uint32_t>& vertices = active.Target->Vertices;
+			const std::uint16_t* deltas = active.Target->Deltas.data();
+
+			XMVECTOR weightedMin = XMLoadFloat4A(&active.WeightedMin);
+			XMVECTOR weightedScale = XMLoadFloat4A(&active.WeightedScale);
+
+			size_t k = std::lower_bound(vertices.begin(), vertices.end(), begin) - vertices.begin();
+
+			for (; k < vertices.size() && vertices[k] < end; ++k)
+			{
+				XMFLOAT3* p = (XMFLOAT3*)((std::uint8_t*)out + (size_t)vertices[k] * outStride);
+
+				XMVECTOR delta = XMVectorMultiplyAdd(XMLoadUShort4((const XMUSHORT4*)(deltas + 3 * k)), weightedScale, weightedMin);
+				XMStoreFloat3(p, XMVectorAdd(XMLoadFloat3(p), delta));
+			}
+		}
+	});
+}
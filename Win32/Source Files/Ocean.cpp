@@ -0,0 +1,203 @@
+#include "Ocean.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+	const float Gravity = 9.81f;
+
+	// Frequencies are whole multiples of 2 pi over this, so every wave
+	// goes through whole cycles in it and time can be taken modulo it.
+	const double RepeatSeconds = 200.0;
+
+	// Rows of samples per task.
+	const std::uint32_t RowGrainSize = 8;
+}
+
+void Ocean::Create(std::uint32_t size, float length, float windSpeed, XMFLOAT2 windDirection, float amplitude,
+	float choppiness, std::uint32_t seed)
+{
+	PROFILE_FUNCTION();
+
+	mSize = size;
+	mLength = length;
+	mChoppiness = choppiness;
+	mFft.Create(size);
+
+	const std::uint32_t n = size;
+	const size_t count = (size_t)n * n;
+
+	mWaveNumbers.resize(n);
+	for (std::uint32_t i = 0; i < n; ++i)
+		mWaveNumbers[i] = (float)(2.0 * Pi * ((int)i - (i < n / 2 ? 0 : (int)n)) / length);
+
+	// The largest waves the wind makes, and a cut-off far below them.
+	const float largest = windSpeed * windSpeed / Gravity;
+	const float smallest = 0.001f * largest;
+	const float step = (float)(2.0 * Pi / length);
+	const float baseFrequency = (float)(2.0 * Pi / RepeatSeconds);
+
+	XMVECTOR wind = XMVector2Normalize(XMLoadFloat2(&windDirection));
+
+	std::mt19937 random(seed);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+	mSpectrumReal.assign(count, 0.0f);
+	mSpectrumImag.assign(count, 0.0f);
+	mFrequencies.assign(count, 0.0f);
+
+	for (std::uint32_t z = 0; z < n; ++z)
+	{
+		for (std::uint32_t x = 0; x < n; ++x)
+		{
+			size_t i = x + (size_t)n * z;
+
+			// Drawn for every sample so the waves depend on nothing but
+			// the seed and the size.
+			float gaussianReal = gaussian(random);
+			float gaussianImag = gaussian(random);
+
+			XMVECTOR k = XMVectorSet(mWaveNumbers[x], mWaveNumbers[z], 0.0f, 0.0f);
+			float k2 = XMVectorGetX(XMVector2LengthSq(k));
+
+			// The highest frequency along either axis has no conjugate
+			// partner, and the constant term no wave; both stay zero so
+			// every field is real.
+			if (x == n / 2 || z == n / 2 || k2 == 0.0f)
+				continue;
+
+			float along = XMVectorGetX(XMVector2Dot(k, wind));
+			float phillips = amplitude * expf(-1.0f / (k2 * largest * largest)) / (k2 * k2) * (along * along / k2)
+				* expf(-k2 * smallest * smallest);
+
+			float scale = step * sqrtf(0.5f * phillips);
+			mSpectrumReal[i] = gaussianReal * scale;
+			mSpectrumImag[i] = gaussianImag * scale;
+			mFrequencies[i] = floorf(sqrtf(Gravity * sqrtf(k2)) / baseFrequency) * baseFrequency;
+		}
+	}
+
+	mMirrorReal.resize(count);
+	mMirrorImag.resize(count);
+	for (std::uint32_t z = 0; z < n; ++z)
+	{
+		for (std::uint32_t x = 0; x < n; ++x)
+		{
+			size_t mirror = (n - x) % n + (size_t)n * ((n - z) % n);
+			mMirrorReal[x + (size_t)n * z] = mSpectrumReal[mirror];
+			mMirrorImag[x + (size_t)n * z] = -mSpectrumImag[mirror];
+		}
+	}
+
+	for (int field = 0; field < 3; ++field)
+	{
+		mFieldReal[field].assign(count, 0.0f);
+		mFieldImag[field].assign(count, 0.0f);
+	}
+
+	mNormals.assign(count, XMFLOAT3(0.0f, 1.0f, 0.0f));
+}
+
+void Ocean::Update(double time)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t n = mSize;
+	const float t = (float)std::fmod(time, RepeatSeconds);
+	const XMVECTOR choppiness = XMVectorReplicate(mChoppiness);
+
+	// h(k, t) = h0(k) exp(i w t) + conj(h0(-k)) exp(-i w t), then the
+	// other spectra from it: i k h for the slopes and i k / |k| h for the
+	// displacements.
+	ThreadPool::Get().ParallelFor(n, RowGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t z = begin; z < end; ++z)
+		{
+			XMVECTOR kz = XMVectorReplicate(mWaveNumbers[z]);
+
+			for (std::uint32_t x = 0; x < n; x += 4)
+			{
+				size_t i = x + (size_t)n * z;
+
+				XMVECTOR kx = XMLoadFloat4((const XMFLOAT4*)&mWaveNumbers[x]);
+				XMVECTOR sine, cosine;
+				XMVectorSinCos(&sine, &cosine, XMVectorScale(XMLoadFloat4((const XMFLOAT4*)&mFrequencies[i]), t));
+
+				XMVECTOR h0r = XMLoadFloat4((const XMFLOAT4*)&mSpectrumReal[i]);
+				XMVECTOR h0i = XMLoadFloat4((const XMFLOAT4*)&mSpectrumImag[i]);
+				XMVECTOR mr = XMLoadFloat4((const XMFLOAT4*)&mMirrorReal[i]);
+				XMVECTOR mi = XMLoadFloat4((const XMFLOAT4*)&mMirrorImag[i]);
+
+				XMVECTOR hr = XMVectorMultiplyAdd(XMVectorAdd(h0r, mr), cosine, XMVectorMultiply(XMVectorSubtract(mi, h0i), sine));
+				XMVECTOR hi = XMVectorMultiplyAdd(XMVectorAdd(h0i, mi), cosine, XMVectorMultiply(XMVectorSubtract(h0r, mr), sine));
+
+				// The constant term has no direction; its h is zero anyway.
+				XMVECTOR k2 = XMVectorMultiplyAdd(kx, kx, XMVectorMultiply(kz, kz));
+				XMVECTOR scale = XMVectorMultiply(choppiness, XMVectorReciprocalSqrt(k2));
+				scale = XMVectorSelect(scale, XMVectorZero(), XMVectorEqual(k2, XMVectorZero()));
+
+				// h + i (i kx h) = (1 - kx) h.
+				XMVECTOR oneMinusKx = XMVectorSubtract(XMVectorReplicate(1.0f), kx);
+				XMStoreFloat4((XMFLOAT4*)&mFieldReal[0][i], XMVectorMultiply(oneMinusKx, hr));
+				XMStoreFloat4((XMFLOAT4*)&mFieldImag[0][i], XMVectorMultiply(oneMinusKx, hi));
+
+				// i kx / |k| h + i (i kz / |k| h) = (i kx - kz) h / |k|.
+				XMVECTOR dr = XMVectorNegate(XMVectorMultiplyAdd(kz, hr, XMVectorMultiply(kx, hi)));
+				XMVECTOR di = XMVectorNegativeMultiplySubtract(kz, hi, XMVectorMultiply(kx, hr));
+				XMStoreFloat4((XMFLOAT4*)&mFieldReal[1][i], XMVectorMultiply(dr, scale));
+				XMStoreFloat4((XMFLOAT4*)&mFieldImag[1][i], XMVectorMultiply(di, scale));
+
+				// i kz h.
+				XMStoreFloat4((XMFLOAT4*)&mFieldReal[2][i], XMVectorNegate(XMVectorMultiply(kz, hi)));
+				XMStoreFloat4((XMFLOAT4*)&mFieldImag[2][i], XMVectorMultiply(kz, hr));
+			}
+		}
+	});
+
+	for (int field = 0; field < 3; ++field)
+		mFft.Transform(mFieldReal[field].data(), mFieldImag[field].data(), true);
+
+	ThreadPool::Get().ParallelFor(n, RowGrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		const float* slopesX = mFieldImag[0].data();
+		const float* slopesZ = mFieldReal[2].data();
+
+		for (size_t i = (size_t)begin * n; i < (size_t)end * n; ++i)
+			XMStoreFloat3(&mNormals[i], XMVector3Normalize(XMVectorSet(-slopesX[i], 1.0f, -slopesZ[i], 0.0f)));
+	});
+}
+
+std::uint32_t Ocean::Size()const
+{
+	return mSize;
+}
+
+float Ocean::Length()const
+{
+	return mLength;
+}
+
+const float* Ocean::Heights()const
+{
+	return mFieldReal[0].data();
+}
+
+const float* Ocean::DisplacementsX()const
+{
+	return mFieldReal[1].data();
+}
+
+const float* Ocean::DisplacementsZ()const
+{
+	return mFieldImag[1].data();
+}
+
+const std::vector<XMFLOAT3>& Ocean::Normals()const
+{
+	return mNormals;
+}
@@ -0,0 +1,351 @@
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Particles per task, a multiple of four so ranges start on a vector.
+	const std::uint32_t GrainSize = 4096;
+
+	// splitmix64's finalizer; consecutive inputs give unrelated outputs.
+	std::uint64_t Mix(std::uint64_t x)
+	{
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	// The next number in [0, 1) of the sequence state starts.
+	float Unit(std::uint64_t& state)
+	{
+		state += 0x9e3779b97f4a7c15ull;
+		return (float)(Mix(state) >> 40) * (1.0f / 16777216.0f);
+	}
+}
+
+void ParticleArrays::Resize(std::uint32_t count)
+{
+	count = (count + 3) & ~3u;
+
+	PositionX.resize(count);
+	PositionY.resize(count);
+	PositionZ.resize(count);
+	VelocityX.resize(count);
+	VelocityY.resize(count);
+	VelocityZ.resize(count);
+	Age.resize(count);
+	Lifetime.resize(count);
+	Emitter.resize(count);
+}
+
+void ParticleSystem::Create(std::uint32_t capacity, XMFLOAT3 gravity, std::uint32_t seed)
+{
+	PROFILE_FUNCTION();
+
+	mCapacity = capacity;
+	mCount = 0;
+	mGravity = gravity;
+	mSeed = seed;
+	mEmitted = 0;
+
+	mEmitters.clear();
+	mEmitterCarry.clear();
+	mEmitterFirst.assign(1, 0);
+
+	mParticles.Resize(capacity);
+	mAlive.assign((capacity + 3) & ~3u, 0);
+
+	std::uint32_t ranges = (capacity + GrainSize - 1) / GrainSize;
+	mRangeAlive.assign(ranges, 0);
+	mRangeHoles.assign(ranges, 0);
+	mRangeMovers.assign(ranges, 0);
+
+	mHoles.resize(capacity);
+	mMovers.resize(capacity);
+}
+
+std::uint32_t ParticleSystem::AddEmitter(const ParticleEmitter& emitter)
+{
+	mEmitters.push_back(emitter);
+	mEmitterCarry.push_back(0.0f);
+	mEmitterFirst.push_back(0);
+	return (std::uint32_t)mEmitters.size() - 1;
+}
+
+ParticleEmitter& ParticleSystem::Emitter(std::uint32_t emitter)
+{
+	return mEmitters[emitter];
+}
+
+void ParticleSystem::Update(float dt)
+{
+	PROFILE_FUNCTION();
+
+	Integrate(dt);
+	Compact();
+	Emit(dt);
+}
+
+void ParticleSystem::Integrate(float dt)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t count = mCount;
+	const XMVECTOR step = XMVectorReplicate(dt);
+	const XMVECTOR gravityX = XMVectorReplicate(mGravity.x * dt);
+	const XMVECTOR gravityY = XMVectorReplicate(mGravity.y * dt);
+	const XMVECTOR gravityZ = XMVectorReplicate(mGravity.z * dt);
+
+	ThreadPool::Get().ParallelFor(count, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		ParticleArrays& p = mParticles;
+
+		for (std::uint32_t range = begin / GrainSize; range * GrainSize < end; ++range)
+		{
+			std::uint32_t first = range * GrainSize;
+			std::uint32_t last = std::min(first + GrainSize, count);
+
+			// The last vector can run past the count, into particles nothing
+			// reads.
+			for (std::uint32_t i = first; i < last; i += 4)
+			{
+				XMVECTOR vx = XMVectorAdd(XMLoadFloat4((const XMFLOAT4*)&p.VelocityX[i]), gravityX);
+				XMVECTOR vy = XMVectorAdd(XMLoadFloat4((const XMFLOAT4*)&p.VelocityY[i]), gravityY);
+				XMVECTOR vz = XMVectorAdd(XMLoadFloat4((const XMFLOAT4*)&p.VelocityZ[i]), gravityZ);
+				XMStoreFloat4((XMFLOAT4*)&p.VelocityX[i], vx);
+				XMStoreFloat4((XMFLOAT4*)&p.VelocityY[i], vy);
+				XMStoreFloat4((XMFLOAT4*)&p.VelocityZ[i], vz);
+
+				XMStoreFloat4((XMFLOAT4*)&p.PositionX[i], XMVectorMultiplyAdd(vx, step, XMLoadFloat4((const XMFLOAT4*)&p.PositionX[i])));
+				XMStoreFloat4((XMFLOAT4*)&p.PositionY[i], XMVectorMultiplyAdd(vy, step, XMLoadFloat4((const XMFLOAT4*)&p.PositionY[i])));
+				XMStoreFloat4((XMFLOAT4*)&p.PositionZ[i], XMVectorMultiplyAdd(vz, step, XMLoadFloat4((const XMFLOAT4*)&p.PositionZ[i])));
+
+				XMVECTOR age = XMVectorAdd(XMLoadFloat4((const XMFLOAT4*)&p.Age[i]), step);
+				XMStoreFloat4((XMFLOAT4*)&p.Age[i], age);
+				XMStoreInt4(&mAlive[i], XMVectorLess(age, XMLoadFloat4((const XMFLOAT4*)&p.Lifetime[i])));
+			}
+
+			std::uint32_t alive = 0;
+			for (std::uint32_t i = first; i < last; ++i)
+				alive += mAlive[i] & 1;
+			mRangeAlive[range] = alive;
+		}
+	});
+}
+
+void ParticleSystem::Compact()
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t count = mCount;
+	const std::uint32_t ranges = (count + GrainSize - 1) / GrainSize;
+
+	std::uint32_t alive = 0;
+	for (std::uint32_t range = 0; range < ranges; ++range)
+		alive += mRangeAlive[range];
+
+	if (alive == count)
+		return;
+
+	// Every dead particle below the live count is a hole, and every live
+	// one above it must move into one; there are as many of each.  A range
+	// wholly on one side holds only one kind, so only the range across the
+	// live count is counted one by one.
+	std::uint32_t holes = 0;
+	std::uint32_t movers = 0;
+	for (std::uint32_t range = 0; range < ranges; ++range)
+	{
+		std::uint32_t first = range * GrainSize;
+		std::uint32_t last = std::min(first + GrainSize, count);
+
+		mRangeHoles[range] = holes;
+		mRangeMovers[range] = movers;
+
+		if (last <= alive)
+		{
+			holes += last - first - mRangeAlive[range];
+		}
+		else if (first >= alive)
+		{
+			movers += mRangeAlive[range];
+		}
+		else
+		{
+			for (std::uint32_t i = first; i < alive; ++i)
+				holes += ~mAlive[i] & 1;
+			for (std::uint32_t i = alive; i < last; ++i)
+				movers += mAlive[i] & 1;
+		}
+	}
+
+	ThreadPool::Get().ParallelFor(count, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t range = begin / GrainSize; range * GrainSize < end; ++range)
+		{
+			std::uint32_t first = range * GrainSize;
+			std::uint32_t last = std::min(first + GrainSize, count);
+			std::uint32_t hole = mRangeHoles[range];
+			std::uint32_t mover = mRangeMovers[range];
+
+			for (std::uint32_t i = first; i < last; ++i)
+			{
+				if (i < alive)
+				{
+					if (!mAlive[i])
+						mHoles[hole++] = i;
+				}
+				else if (mAlive[i])
+				{
+					mMovers[mover++] = i;
+				}
+			}
+		}
+	});
+
+	ThreadPool::Get().ParallelFor(holes, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+			Move(mMovers[i], mHoles[i]);
+	});
+
+	mCount = alive;
+}
+
+void ParticleSystem::Emit(float dt)
+{
+	PROFILE_FUNCTION();
+
+	const std::uint32_t emitterCount = (std::uint32_t)mEmitters.size();
+	const std::uint32_t start = mCount;
+
+	// Emitters in order take what room is left.
+	std::uint32_t end = start;
+	for (std::uint32_t e = 0; e < emitterCount; ++e)
+	{
+		mEmitterFirst[e] = end;
+
+		float wanted = mEmitterCarry[e] + mEmitters[e].Rate * dt;
+		std::uint32_t count = (std::uint32_t)wanted;
+		mEmitterCarry[e] = wanted - (float)count;
+
+		count = std::min(count, mCapacity - end);
+		end += count;
+	}
+	mEmitterFirst[emitterCount] = end;
+
+	if (end == start)
+		return;
+
+	ThreadPool::Get().ParallelFor(end - start, GrainSize, [&](std::uint32_t begin, std::uint32_t finish)
+	{
+		ParticleArrays& p = mParticles;
+
+		// The last emitter starting at or before the first particle, which
+		// skips those emitting nothing.
+		std::uint32_t e = (std::uint32_t)(std::upper_bound(mEmitterFirst.begin(), mEmitterFirst.begin() + emitterCount, start + begin)
+			- mEmitterFirst.begin()) - 1;
+
+		for (std::uint32_t i = start + begin; i < start + finish; ++i)
+		{
+			while (i >= mEmitterFirst[e + 1])
+				++e;
+
+			const ParticleEmitter& emitter = mEmitters[e];
+			std::uint64_t state = Mix(mSeed ^ Mix(mEmitted + (i - start)));
+
+			// Uniform in a ball: a direction uniform over the sphere, and a
+			// radius with the cube root to even out the volume.
+			float z = 2.0f * Unit(state) - 1.0f;
+			float angle = XM_2PI * Unit(state);
+			float radius = emitter.Spread * std::cbrt(Unit(state));
+			float ring = radius * std::sqrt(std::max(1.0f - z * z, 0.0f));
+
+			p.PositionX[i] = emitter.Position.x;
+			p.PositionY[i] = emitter.Position.y;
+			p.PositionZ[i] = emitter.Position.z;
+			p.VelocityX[i] = emitter.Velocity.x + ring * std::cos(angle);
+			p.VelocityY[i] = emitter.Velocity.y + ring * std::sin(angle);
+			p.VelocityZ[i] = emitter.Velocity.z + radius * z;
+			p.Age[i] = 0.0f;
+			p.Lifetime[i] = emitter.Lifetime * (0.5f + 0.5f * Unit(state));
+			p.Emitter[i] = (std::uint16_t)e;
+		}
+	});
+
+	mEmitted += end - start;
+	mCount = end;
+}
+
+void ParticleSystem::Move(std::uint32_t from, std::uint32_t to)
+{
+	ParticleArrays& p = mParticles;
+
+	p.PositionX[to] = p.PositionX[from];
+	p.PositionY[to] = p.PositionY[from];
+	p.PositionZ[to] = p.PositionZ[from];
+	p.VelocityX[to] = p.VelocityX[from];
+	p.VelocityY[to] = p.VelocityY[from];
+	p.VelocityZ[to] = p.VelocityZ[from];
+	p.Age[to] = p.Age[from];
+	p.Lifetime[to] = p.Lifetime[from];
+	p.Emitter[to] = p.Emitter[from];
+}
+
+void ParticleSystem::WriteBillboards(FXMVECTOR right, FXMVECTOR up, XMFLOAT2 texC, std::uint32_t first, std::uint32_t count,
+	XMFLOAT3* positions, XMFLOAT4* colors, XMFLOAT2* texCoords, std::uint32_t vertexStride)const
+{
+	PROFILE_FUNCTION();
+
+	const XMVECTOR side = right;
+	const XMVECTOR height = up;
+
+	ThreadPool::Get().ParallelFor(count, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		const ParticleArrays& p = mParticles;
+
+		for (std::uint32_t k = begin; k < end; ++k)
+		{
+			std::uint32_t i = first + k;
+			const ParticleEmitter& emitter = mEmitters[p.Emitter[i]];
+
+			float size = emitter.Size * (1.0f - p.Age[i] / p.Lifetime[i]);
+			XMVECTOR center = XMVectorSet(p.PositionX[i], p.PositionY[i], p.PositionZ[i], 0.0f);
+			XMVECTOR across = XMVectorScale(side, size);
+			XMVECTOR along = XMVectorScale(height, size);
+
+			XMVECTOR corners[4];
+			corners[0] = XMVectorSubtract(XMVectorSubtract(center, across), along);
+			corners[1] = XMVectorAdd(XMVectorSubtract(center, across), along);
+			corners[2] = XMVectorAdd(XMVectorAdd(center, across), along);
+			corners[3] = XMVectorSubtract(XMVectorAdd(center, across), along);
+
+			// Written in vertex order, as the memory may be write-combined.
+			for (std::uint32_t c = 0; c < 4; ++c)
+			{
+				size_t offset = ((size_t)k * 4 + c) * vertexStride;
+				XMStoreFloat3((XMFLOAT3*)((std::uint8_t*)positions + offset), corners[c]);
+				*(XMFLOAT4*)((std::uint8_t*)colors + offset) = emitter.Color;
+				*(XMFLOAT2*)((std::uint8_t*)texCoords + offset) = texC;
+			}
+		}
+	});
+}
+
+std::uint32_t ParticleSystem::Count()const
+{
+	return mCount;
+}
+
+std::uint32_t ParticleSystem::Capacity()const
+{
+	return mCapacity;
+}
+
+const ParticleArrays& ParticleSystem::Particles()const
+{
+	return mParticles;
+}
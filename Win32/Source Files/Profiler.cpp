@@ -0,0 +1,233 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#endif
+
+namespace
+{
+	// Fields are atomics so the exporter may read a slot while its owner
+	// overwrites it; the exporter then finds out and drops it.  Relaxed
+	// stores compile to plain ones.
+	struct ProfileEvent
+	{
+		std::atomic<const char*> Name;
+		std::atomic<std::uint64_t> Start;
+		std::atomic<std::uint64_t> End;
+		std::atomic<std::uint32_t> Depth;
+	};
+
+	// One per recording thread, written only by the owning thread.  Before
+	// writing event n into the ring, the owner sets Claimed to n + 1; after,
+	// it publishes Committed as n + 1 with release.  An exporter reads up to
+	// Committed, then checks Claimed to see which of the slots it read may
+	// have been reused meanwhile.
+	struct ThreadBuffer
+	{
+		explicit ThreadBuffer(std::uint32_t id)
+			: Id(id), Claimed(0), Committed(0), Events(new ProfileEvent[Profiler::EventsPerThread])
+		{
+			Name[0] = '\0';
+		}
+
+		std::uint32_t Id;
+		char Name[64];
+		std::atomic<std::uint64_t> Claimed;
+		std::atomic<std::uint64_t> Committed;
+		std::unique_ptr<ProfileEvent[]> Events;
+	};
+
+	// An event as the exporter copied it.
+	struct ExportedEvent
+	{
+		const char* Name;
+		std::uint64_t Start;
+		std::uint64_t End;
+		std::uint32_t Depth;
+	};
+
+	struct Registry
+	{
+		Registry()
+		{
+			BaseTicks = Profiler::Now();
+			BaseTime = std::chrono::steady_clock::now();
+		}
+
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+
+		// Pairs a raw timestamp with wall time so ticks can be converted to
+		// microseconds at export without a calibration delay at startup.
+		std::uint64_t BaseTicks;
+		std::chrono::steady_clock::time_point BaseTime;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* tBuffer = nullptr;
+	thread_local std::uint32_t tDepth = 0;
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (!tBuffer)
+		{
+			// Buffers live until exit so the exporter can still read the
+			// scopes of threads that have finished.
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+
+			registry.Buffers.emplace_back(new ThreadBuffer((std::uint32_t)registry.Buffers.size() + 1));
+			tBuffer = registry.Buffers.back().get();
+		}
+
+		return *tBuffer;
+	}
+
+	void WriteJsonString(std::ofstream& ofs, const char* s)
+	{
+		ofs << '"';
+		for (; *s; ++s)
+		{
+			if (*s == '"' || *s == '\\')
+				ofs << '\\';
+			ofs << *s;
+		}
+		ofs << '"';
+	}
+}
+
+std::uint64_t Profiler::Now()
+{
+#ifdef PROFILER_HAS_RDTSC
+	return __rdtsc();
+#else
+	return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+std::uint32_t& Profiler::Depth()
+{
+	return tDepth;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	size_t i = 0;
+	for (; name[i] && i < sizeof(buffer.Name) - 1; ++i)
+		buffer.Name[i] = name[i];
+	buffer.Name[i] = '\0';
+}
+
+void Profiler::Record(const char* name, std::uint64_t start, std::uint64_t end, std::uint32_t depth)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::uint64_t count = buffer.Committed.load(std::memory_order_relaxed);
+
+	// Claim the slot before touching it, so an exporter that reads any of
+	// the new values also sees the claim.
+	buffer.Claimed.store(count + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	ProfileEvent& e = buffer.Events[count & (EventsPerThread - 1)];
+	e.Name.store(name, std::memory_order_relaxed);
+	e.Start.store(start, std::memory_order_relaxed);
+	e.End.store(end, std::memory_order_relaxed);
+	e.Depth.store(depth, std::memory_order_relaxed);
+
+	buffer.Committed.store(count + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const char* path)
+{
+	Registry& registry = GetRegistry();
+
+	std::uint64_t nowTicks = Now();
+	double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry.BaseTime).count();
+	double usPerTick = elapsedUs > 0.0 ? elapsedUs / (double)(nowTicks - registry.BaseTicks) : 0.0;
+
+	std::ofstream ofs(path);
+	if (!ofs)
+		return false;
+
+	ofs.setf(std::ios::fixed);
+	ofs.precision(3);
+
+	ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	std::vector<ExportedEvent> events;
+
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : registry.Buffers)
+	{
+		if (buffer->Name[0])
+		{
+			ofs << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->Id
+				<< ",\"args\":{\"name\":";
+			WriteJsonString(ofs, buffer->Name);
+			ofs << "}}";
+			first = false;
+		}
+
+		// Copy everything committed, then drop the events whose slots the
+		// owner claimed for newer ones during the copy.
+		std::uint64_t committed = buffer->Committed.load(std::memory_order_acquire);
+		std::uint64_t oldest = committed < EventsPerThread ? 0 : committed - EventsPerThread;
+
+		events.resize((size_t)(committed - oldest));
+		for (std::uint64_t i = oldest; i < committed; ++i)
+		{
+			const ProfileEvent& e = buffer->Events[i & (EventsPerThread - 1)];
+			ExportedEvent& copy = events[(size_t)(i - oldest)];
+
+			copy.Name = e.Name.load(std::memory_order_relaxed);
+			copy.Start = e.Start.load(std::memory_order_relaxed);
+			copy.End = e.End.load(std::memory_order_relaxed);
+			copy.Depth = e.Depth.load(std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		std::uint64_t claimed = buffer->Claimed.load(std::memory_order_relaxed);
+		std::uint64_t intact = claimed < EventsPerThread ? 0 : claimed - EventsPerThread;
+
+		for (std::uint64_t i = oldest > intact ? oldest : intact; i < committed; ++i)
+		{
+			const ExportedEvent& e = events[(size_t)(i - oldest)];
+
+			ofs << (first ? "" : ",\n") << "{\"name\":";
+			WriteJsonString(ofs, e.Name);
+			ofs << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->Id
+				<< ",\"ts\":" << (double)(std::int64_t)(e.Start - registry.BaseTicks) * usPerTick
+				<< ",\"dur\":" << (double)(e.End - e.Start) * usPerTick
+				<< ",\"args\":{\"depth\":" << e.Depth << "}}";
+			first = false;
+		}
+	}
+
+	ofs << "\n]}\n";
+
+	return ofs.good();
+}
+
+#endif // ENABLE_PROFILER
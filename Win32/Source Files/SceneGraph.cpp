@@ -0,0 +1,162 @@
+#include "SceneGraph.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+SceneGraph::SceneGraph()
+	: mMarkedCount(0),
+	mMaxDepth(0)
+{
+}
+
+void SceneGraph::Reserve(std::uint32_t nodeCount)
+{
+	mParents.reserve(nodeCount);
+	mDepths.reserve(nodeCount);
+	mLocals.reserve(nodeCount);
+	mWorlds.reserve(nodeCount);
+	mDirty.reserve(nodeCount);
+}
+
+void SceneGraph::Clear()
+{
+	mParents.clear();
+	mDepths.clear();
+	mLocals.clear();
+	mWorlds.clear();
+	mDirty.clear();
+
+	mMarkedCount = 0;
+	mMaxDepth = 0;
+}
+
+SceneGraph::NodeId SceneGraph::AddNode(NodeId parent, FXMMATRIX local)
+{
+	NodeId node = (NodeId)mParents.size();
+	std::uint32_t depth = parent == InvalidNode ? 0 : mDepths[parent] + 1;
+
+	mParents.push_back(parent);
+	mDepths.push_back(depth);
+
+	XMFLOAT4X4A m;
+	XMStoreFloat4x4A(&m, local);
+	mLocals.push_back(m);
+	mWorlds.push_back(m);
+
+	mDirty.push_back(1);
+	mMarkedCount++;
+
+	if (depth > mMaxDepth)
+		mMaxDepth = depth;
+
+	return node;
+}
+
+void SceneGraph::SetLocal(NodeId node, FXMMATRIX local)
+{
+	XMStoreFloat4x4A(&mLocals[node], local);
+
+	if (!mDirty[node])
+	{
+		mDirty[node] = 1;
+		mMarkedCount++;
+	}
+}
+
+XMMATRIX SceneGraph::GetLocal(NodeId node)const
+{
+	return XMLoadFloat4x4A(&mLocals[node]);
+}
+
+XMMATRIX SceneGraph::GetWorld(NodeId node)const
+{
+	return XMLoadFloat4x4A(&mWorlds[node]);
+}
+
+SceneGraph::NodeId SceneGraph::GetParent(NodeId node)const
+{
+	return mParents[node];
+}
+
+std::uint32_t SceneGraph::NodeCount()const
+{
+	return (std::uint32_t)mParents.size();
+}
+
+void SceneGraph::UpdateWorld(NodeId node)
+{
+	XMMATRIX local = XMLoadFloat4x4A(&mLocals[node]);
+	NodeId parent = mParents[node];
+
+	if (parent == InvalidNode)
+		XMStoreFloat4x4A(&mWorlds[node], local);
+	else
+		XMStoreFloat4x4A(&mWorlds[node], XMMatrixMultiply(local, XMLoadFloat4x4A(&mWorlds[parent])));
+}
+
+void SceneGraph::Update()
+{
+	PROFILE_FUNCTION();
+
+	// Nothing moved since the last update, so every world matrix still holds.
+	if (mMarkedCount == 0)
+		return;
+
+	std::uint32_t nodeCount = NodeCount();
+
+	mDirtyNodes.clear();
+	mDepthStart.assign(mMaxDepth + 2, 0);
+
+	// Parents precede children, so one pass carries each mark down to the
+	// whole subtree below it.  Count the dirty nodes per depth as we go.
+	for (NodeId i = 0; i < nodeCount; ++i)
+	{
+		NodeId parent = mParents[i];
+		if (!mDirty[i] && parent != InvalidNode && mDirty[parent])
+			mDirty[i] = 1;
+
+		if (mDirty[i])
+		{
+			mDirtyNodes.push_back(i);
+			mDepthStart[mDepths[i] + 1]++;
+		}
+	}
+
+	for (std::uint32_t d = 1; d < mDepthStart.size(); ++d)
+		mDepthStart[d] += mDepthStart[d - 1];
+
+	// Bucket the dirty nodes by depth, keeping id order within each depth so
+	// neighbouring tasks touch neighbouring matrices.
+	mDirtyByDepth.resize(mDirtyNodes.size());
+	{
+		std::vector<std::uint32_t>& cursor = mDepthStart;
+		for (NodeId node : mDirtyNodes)
+			mDirtyByDepth[cursor[mDepths[node]]++] = node;
+
+		// The scatter advanced each start to the next depth's start; shift back.
+		for (std::uint32_t d = (std::uint32_t)cursor.size() - 1; d > 0; --d)
+			cursor[d] = cursor[d - 1];
+		cursor[0] = 0;
+	}
+
+	ThreadPool& pool = ThreadPool::Get();
+
+	for (std::uint32_t d = 0; d <= mMaxDepth; ++d)
+	{
+		std::uint32_t begin = mDepthStart[d];
+		std::uint32_t end = mDepthStart[d + 1];
+
+		const NodeId* nodes = mDirtyByDepth.data() + begin;
+		pool.ParallelFor(end - begin, GrainSize, [this, nodes](std::uint32_t first, std::uint32_t last)
+		{
+			for (std::uint32_t k = first; k < last; ++k)
+				UpdateWorld(nodes[k]);
+		});
+	}
+
+	for (NodeId node : mDirtyNodes)
+		mDirty[node] = 0;
+
+	mMarkedCount = 0;
+}
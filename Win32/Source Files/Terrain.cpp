@@ -0,0 +1,542 @@
+#include "Terrain.h"
+#include "GeometryGenerator.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t FileMagic = 0x314e5254; // "TRN1"
+
+	std::uint32_t LevelCountFor(std::uint32_t chunks)
+	{
+		std::uint32_t levels = 1;
+		while ((1u << (levels - 1)) < chunks)
+			++levels;
+		return levels;
+	}
+
+	// First node of each level, finest first, and the total after them.
+	std::uint32_t LevelOffsets(std::uint32_t chunks, std::uint32_t levelCount, std::vector<std::uint32_t>& offsets)
+	{
+		offsets.resize(levelCount);
+		std::uint32_t nodeCount = 0;
+		for (std::uint32_t level = 0; level < levelCount; ++level)
+		{
+			offsets[level] = nodeCount;
+			nodeCount += (chunks >> level) * (chunks >> level);
+		}
+		return nodeCount;
+	}
+}
+
+const std::uint32_t Terrain::EdgePatterns;
+
+bool Terrain::Cook(const float* heights, std::uint32_t size, std::uint32_t chunkQuads, float spacing, const std::string& filename)
+{
+	PROFILE_FUNCTION();
+
+	// Stitching drops every other edge vertex, so a patch needs an even
+	// number of quads a side.
+	if (chunkQuads < 2 || chunkQuads % 2 != 0 || (chunkQuads + 1) * (chunkQuads + 1) > 0x10000)
+		return false;
+	if (size < chunkQuads + 1 || (size - 1) % chunkQuads != 0)
+		return false;
+
+	std::uint32_t chunks = (size - 1) / chunkQuads;
+	if ((chunks & (chunks - 1)) != 0)
+		return false;
+
+	size_t sampleCount = (size_t)size * size;
+	std::pair<const float*, const float*> range = std::minmax_element(heights, heights + sampleCount);
+
+	FileHeader header;
+	header.Magic = FileMagic;
+	header.Size = size;
+	header.ChunkQuads = chunkQuads;
+	header.LevelCount = LevelCountFor(chunks);
+	header.Spacing = spacing;
+	header.HeightBase = *range.first;
+	header.HeightScale = *range.second > *range.first ? (*range.second - *range.first) / 65535.0f : 1.0f;
+
+	std::vector<std::uint16_t> quantized(sampleCount);
+	ThreadPool::Get().ParallelFor(size, 16, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (size_t i = (size_t)begin * size; i < (size_t)end * size; ++i)
+		{
+			float q = std::round((heights[i] - header.HeightBase) / header.HeightScale);
+			quantized[i] = (std::uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+		}
+	});
+
+	std::vector<std::uint32_t> offsets;
+	std::uint32_t nodeCount = LevelOffsets(chunks, header.LevelCount, offsets);
+	std::uint32_t side = chunkQuads + 1;
+	size_t tileSize = (size_t)side * side;
+
+	std::vector<NodeInfo> nodes(nodeCount);
+	std::vector<std::uint16_t> tiles((size_t)nodeCount * tileSize);
+
+	// Finest level first, so a node's children already hold the bounds and
+	// error of everything below it.
+	for (std::uint32_t level = 0; level < header.LevelCount; ++level)
+	{
+		std::uint32_t count = chunks >> level;
+		std::uint32_t step = 1u << level;
+		std::uint32_t nodeSamples = chunkQuads * step;
+
+		ThreadPool::Get().ParallelFor(count * count, 1, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t n = begin; n < end; ++n)
+			{
+				std::uint32_t x0 = (n % count) * nodeSamples;
+				std::uint32_t z0 = (n / count) * nodeSamples;
+				std::uint16_t* tile = &tiles[(offsets[level] + n) * tileSize];
+				NodeInfo& info = nodes[offsets[level] + n];
+
+				// Rows run north to south, as CreateGrid's do.
+				for (std::uint32_t i = 0; i < side; ++i)
+					for (std::uint32_t j = 0; j < side; ++j)
+						tile[i * side + j] = quantized[(size_t)(z0 + (chunkQuads - i) * step) * size + x0 + j * step];
+
+				if (level == 0)
+				{
+					std::pair<const std::uint16_t*, const std::uint16_t*> bounds = std::minmax_element(tile, tile + tileSize);
+					info.Error = 0.0f;
+					info.MinHeight = *bounds.first;
+					info.MaxHeight = *bounds.second;
+					continue;
+				}
+
+				std::uint32_t childCount = count * 2;
+				std::uint32_t child = offsets[level - 1] + (n / count) * 2 * childCount + (n % count) * 2;
+				const NodeInfo* children[4] = { &nodes[child], &nodes[child + 1], &nodes[child + childCount], &nodes[child + childCount + 1] };
+
+				info.Error = 0.0f;
+				info.MinHeight = 0xffff;
+				info.MaxHeight = 0;
+				for (const NodeInfo* c : children)
+				{
+					info.Error = std::max(info.Error, c->Error);
+					info.MinHeight = std::min(info.MinHeight, c->MinHeight);
+					info.MaxHeight = std::max(info.MaxHeight, c->MaxHeight);
+				}
+
+				// The patch's own error: every sample against the triangles
+				// drawn over it, split along the same diagonal as CreateGrid.
+				float worst = 0.0f;
+				for (std::uint32_t r = z0; r <= z0 + nodeSamples; ++r)
+				{
+					std::uint32_t di = z0 + nodeSamples - r;
+					std::uint32_t qi = std::min(di / step, chunkQuads - 1);
+					float v = (float)(di - qi * step) / step;
+
+					for (std::uint32_t c = x0; c <= x0 + nodeSamples; ++c)
+					{
+						std::uint32_t dj = c - x0;
+						std::uint32_t qj = std::min(dj / step, chunkQuads - 1);
+						float u = (float)(dj - qj * step) / step;
+
+						float h00 = tile[qi * side + qj];
+						float h01 = tile[qi * side + qj + 1];
+						float h10 = tile[(qi + 1) * side + qj];
+						float h11 = tile[(qi + 1) * side + qj + 1];
+
+						float h = u + v <= 1.0f
+							? h00 + u * (h01 - h00) + v * (h10 - h00)
+							: h11 + (1.0f - u) * (h10 - h11) + (1.0f - v) * (h01 - h11);
+
+						worst = std::max(worst, std::abs(h - quantized[(size_t)r * size + c]));
+					}
+				}
+
+				info.Error = std::max(info.Error, worst * header.HeightScale);
+			}
+		});
+	}
+
+	std::ofstream ofs(filename, std::ios::binary);
+	if (!ofs)
+		return false;
+
+	ofs.write((const char*)&header, sizeof(header));
+	ofs.write((const char*)nodes.data(), nodes.size() * sizeof(NodeInfo));
+	ofs.write((const char*)tiles.data(), tiles.size() * sizeof(std::uint16_t));
+
+	return (bool)ofs;
+}
+
+bool Terrain::Open(const std::string& filename)
+{
+	PROFILE_FUNCTION();
+
+	Close();
+
+	if (!mFile.Open(filename) || mFile.Size() < sizeof(FileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	std::memcpy(&mHeader, mFile.Data(), sizeof(mHeader));
+
+	std::uint32_t chunkQuads = mHeader.ChunkQuads;
+	if (mHeader.Magic != FileMagic || chunkQuads < 2 || chunkQuads % 2 != 0 || (chunkQuads + 1) * (chunkQuads + 1) > 0x10000
+		|| mHeader.Size <= chunkQuads || (mHeader.Size - 1) % chunkQuads != 0)
+	{
+		Close();
+		return false;
+	}
+
+	mChunks = (mHeader.Size - 1) / chunkQuads;
+	if ((mChunks & (mChunks - 1)) != 0 || mHeader.LevelCount != LevelCountFor(mChunks))
+	{
+		Close();
+		return false;
+	}
+
+	std::uint32_t nodeCount = LevelOffsets(mChunks, mHeader.LevelCount, mLevelOffsets);
+	size_t expected = sizeof(FileHeader) + nodeCount * (sizeof(NodeInfo) + (size_t)VertexCount() * sizeof(std::uint16_t));
+	if (mFile.Size() != expected)
+	{
+		Close();
+		return false;
+	}
+
+	mNodes = (const NodeInfo*)(mFile.Data() + sizeof(FileHeader));
+	mHeights = (const std::uint16_t*)(mNodes + nodeCount);
+
+	// Every pattern starts from CreateGrid's triangles.  On a stitched side
+	// each odd vertex collapses onto an even neighbour, which leaves that
+	// side with the coarse neighbour's vertices and no holes, and the
+	// triangles that collapse with it are dropped.  Collapsing towards the
+	// two corners the quads' diagonals miss keeps the corners clean when
+	// two sides are stitched.
+	GeometryGenerator generator;
+	GeometryGenerator::MeshData grid = generator.CreateGrid(1.0f, 1.0f, chunkQuads + 1, chunkQuads + 1);
+	std::uint32_t side = chunkQuads + 1;
+
+	for (std::uint32_t mask = 0; mask < EdgePatterns; ++mask)
+	{
+		std::vector<std::uint16_t>& indices = mIndices[mask];
+		indices.clear();
+
+		for (size_t t = 0; t < grid.Indices32.size(); t += 3)
+		{
+			std::uint32_t triangle[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				std::uint32_t i = grid.Indices32[t + k] / side;
+				std::uint32_t j = grid.Indices32[t + k] % side;
+
+				if ((mask & North) && i == 0 && (j & 1))
+					--j;
+				else if ((mask & South) && i == chunkQuads && (j & 1))
+					++j;
+
+				if ((mask & West) && j == 0 && (i & 1))
+					--i;
+				else if ((mask & East) && j == chunkQuads && (i & 1))
+					++i;
+
+				triangle[k] = i * side + j;
+			}
+
+			if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+				continue;
+
+			indices.insert(indices.end(), triangle, triangle + 3);
+		}
+	}
+
+	mCellLevels.assign((size_t)mChunks * mChunks, 0);
+	mCellVisible.assign((size_t)mChunks * mChunks, 0);
+	return true;
+}
+
+void Terrain::Close()
+{
+	mFile.Close();
+	mNodes = nullptr;
+	mHeights = nullptr;
+	mChunks = 0;
+	mLevelOffsets.clear();
+	for (std::vector<std::uint16_t>& indices : mIndices)
+		indices.clear();
+	mCellLevels.clear();
+	mCellVisible.clear();
+}
+
+void Terrain::Select(FXMMATRIX viewProj, FXMVECTOR eye, float pixelScale, float pixelError,
+	std::vector<TerrainPatch>& patches, TerrainStats& stats)
+{
+	PROFILE_FUNCTION();
+
+	patches.clear();
+	stats.Patches = 0;
+	stats.Triangles = 0;
+	stats.FlatTriangles = 0;
+
+	if (!mNodes)
+		return;
+
+	// The frustum's planes from the columns of viewProj, facing inwards.
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+	XMFLOAT4 planes[6];
+	XMStoreFloat4(&planes[0], XMVectorAdd(columns.r[3], columns.r[0]));
+	XMStoreFloat4(&planes[1], XMVectorSubtract(columns.r[3], columns.r[0]));
+	XMStoreFloat4(&planes[2], XMVectorAdd(columns.r[3], columns.r[1]));
+	XMStoreFloat4(&planes[3], XMVectorSubtract(columns.r[3], columns.r[1]));
+	XMStoreFloat4(&planes[4], columns.r[2]);
+	XMStoreFloat4(&planes[5], XMVectorSubtract(columns.r[3], columns.r[2]));
+
+	SelectNode(mHeader.LevelCount - 1, 0, 0, planes, eye, pixelScale, pixelError);
+
+	// Split any node more than one level coarser than a neighbour until
+	// none is left.  Splits only ever refine, so this settles.
+	std::uint32_t chunks = mChunks;
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (std::uint32_t cz = 0; cz < chunks; ++cz)
+		{
+			for (std::uint32_t cx = 0; cx < chunks; ++cx)
+			{
+				std::uint32_t level = mCellLevels[cz * chunks + cx];
+				std::uint32_t cells = 1u << level;
+				if (level == 0 || ((cx | cz) & (cells - 1)) != 0)
+					continue;
+
+				bool split = false;
+				for (std::uint32_t k = 0; k < cells && !split; ++k)
+				{
+					split = (cx > 0 && mCellLevels[(cz + k) * chunks + cx - 1] + 1u < level)
+						|| (cx + cells < chunks && mCellLevels[(cz + k) * chunks + cx + cells] + 1u < level)
+						|| (cz > 0 && mCellLevels[(cz - 1) * chunks + cx + k] + 1u < level)
+						|| (cz + cells < chunks && mCellLevels[(cz + cells) * chunks + cx + k] + 1u < level);
+				}
+
+				if (split)
+				{
+					Split(cx, cz, level);
+					changed = true;
+				}
+			}
+		}
+	}
+
+	std::uint32_t finest = mHeader.LevelCount;
+
+	for (std::uint32_t cz = 0; cz < chunks; ++cz)
+	{
+		for (std::uint32_t cx = 0; cx < chunks; ++cx)
+		{
+			std::uint32_t level = mCellLevels[cz * chunks + cx];
+			std::uint32_t cells = 1u << level;
+			if (((cx | cz) & (cells - 1)) != 0 || !mCellVisible[cz * chunks + cx])
+				continue;
+
+			// Nodes out of view are not drawn, so there is nothing to match.
+			TerrainPatch patch;
+			patch.Level = level;
+			patch.X = cx >> level;
+			patch.Z = cz >> level;
+			patch.Node = NodeIndex(level, patch.X, patch.Z);
+			patch.EdgeMask = 0;
+
+			std::uint32_t north = (cz + cells) * chunks + cx;
+			std::uint32_t east = cz * chunks + cx + cells;
+			std::uint32_t south = (cz - 1) * chunks + cx;
+			std::uint32_t west = cz * chunks + cx - 1;
+
+			if (cz + cells < chunks && mCellVisible[north] && mCellLevels[north] > level)
+				patch.EdgeMask |= North;
+			if (cx + cells < chunks && mCellVisible[east] && mCellLevels[east] > level)
+				patch.EdgeMask |= East;
+			if (cz > 0 && mCellVisible[south] && mCellLevels[south] > level)
+				patch.EdgeMask |= South;
+			if (cx > 0 && mCellVisible[west] && mCellLevels[west] > level)
+				patch.EdgeMask |= West;
+
+			patches.push_back(patch);
+			stats.Triangles += mIndices[patch.EdgeMask].size() / 3;
+			finest = std::min(finest, level);
+		}
+	}
+
+	stats.Patches = (std::uint32_t)patches.size();
+	if (!patches.empty())
+	{
+		std::uint64_t quads = (mHeader.Size - 1) >> finest;
+		stats.FlatTriangles = 2 * quads * quads;
+	}
+}
+
+void Terrain::SelectNode(std::uint32_t level, std::uint32_t x, std::uint32_t z, const XMFLOAT4* planes,
+	FXMVECTOR eye, float pixelScale, float pixelError)
+{
+	const NodeInfo& info = mNodes[NodeIndex(level, x, z)];
+
+	float nodeSize = (float)(mHeader.ChunkQuads << level) * mHeader.Spacing;
+	XMVECTOR lo = XMVectorSet(x * nodeSize, mHeader.HeightBase + info.MinHeight * mHeader.HeightScale, z * nodeSize, 0.0f);
+	XMVECTOR hi = XMVectorSet((x + 1) * nodeSize, mHeader.HeightBase + info.MaxHeight * mHeader.HeightScale, (z + 1) * nodeSize, 0.0f);
+
+	// Out of view when the box's corner furthest along some plane's normal
+	// is still behind it.
+	bool visible = true;
+	for (int p = 0; p < 6 && visible; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[p]);
+		XMVECTOR corner = XMVectorSelect(lo, hi, XMVectorGreaterOrEqual(plane, XMVectorZero()));
+		visible = XMVectorGetX(XMPlaneDotCoord(plane, corner)) >= 0.0f;
+	}
+
+	if (visible && level > 0)
+	{
+		// Distance to the nearest point of the box, so the error is never
+		// underestimated anywhere on the patch.
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(eye, XMVectorClamp(eye, lo, hi))));
+
+		if (info.Error * pixelScale > pixelError * distance)
+		{
+			for (std::uint32_t child = 0; child < 4; ++child)
+				SelectNode(level - 1, 2 * x + (child & 1), 2 * z + (child >> 1), planes, eye, pixelScale, pixelError);
+			return;
+		}
+	}
+
+	std::uint32_t cells = 1u << level;
+	for (std::uint32_t cz = z * cells; cz < (z + 1) * cells; ++cz)
+	{
+		for (std::uint32_t cx = x * cells; cx < (x + 1) * cells; ++cx)
+		{
+			mCellLevels[cz * mChunks + cx] = (std::uint8_t)level;
+			mCellVisible[cz * mChunks + cx] = visible ? 1 : 0;
+		}
+	}
+}
+
+void Terrain::Split(std::uint32_t cellX, std::uint32_t cellZ, std::uint32_t level)
+{
+	std::uint32_t cells = 1u << level;
+	for (std::uint32_t cz = cellZ; cz < cellZ + cells; ++cz)
+		for (std::uint32_t cx = cellX; cx < cellX + cells; ++cx)
+			mCellLevels[cz * mChunks + cx] = (std::uint8_t)(level - 1);
+}
+
+void Terrain::BuildPatch(const TerrainPatch& patch, XMFLOAT3* positions, XMFLOAT3* normals)const
+{
+	std::uint32_t quads = mHeader.ChunkQuads;
+	std::uint32_t side = quads + 1;
+	const std::uint16_t* tile = mHeights + (size_t)patch.Node * VertexCount();
+
+	float cell = (float)(1u << patch.Level) * mHeader.Spacing;
+	float x0 = patch.X * quads * cell;
+	float z0 = patch.Z * quads * cell;
+
+	for (std::uint32_t i = 0; i < side; ++i)
+		for (std::uint32_t j = 0; j < side; ++j)
+			positions[i * side + j] = XMFLOAT3(x0 + j * cell, mHeader.HeightBase + tile[i * side + j] * mHeader.HeightScale, z0 + (quads - i) * cell);
+
+	// Central differences, one-sided at the patch's border.
+	for (std::uint32_t i = 0; i < side; ++i)
+	{
+		std::uint32_t north = i > 0 ? i - 1 : i;
+		std::uint32_t south = i < quads ? i + 1 : i;
+
+		for (std::uint32_t j = 0; j < side; ++j)
+		{
+			std::uint32_t west = j > 0 ? j - 1 : j;
+			std::uint32_t east = j < quads ? j + 1 : j;
+
+			float dx = (positions[i * side + east].y - positions[i * side + west].y) / ((east - west) * cell);
+			float dz = (positions[north * side + j].y - positions[south * side + j].y) / ((south - north) * cell);
+
+			XMStoreFloat3(&normals[i * side + j], XMVector3Normalize(XMVectorSet(-dx, 1.0f, -dz, 0.0f)));
+		}
+	}
+}
+
+const std::vector<std::uint16_t>& Terrain::Indices(std::uint32_t edgeMask)const
+{
+	return mIndices[edgeMask & (EdgePatterns - 1)];
+}
+
+std::uint32_t Terrain::VertexCount()const
+{
+	return (mHeader.ChunkQuads + 1) * (mHeader.ChunkQuads + 1);
+}
+
+std::uint32_t Terrain::LevelCount()const
+{
+	return mNodes ? mHeader.LevelCount : 0;
+}
+
+float Terrain::Extent()const
+{
+	return mNodes ? (mHeader.Size - 1) * mHeader.Spacing : 0.0f;
+}
+
+std::uint32_t Terrain::NodeIndex(std::uint32_t level, std::uint32_t x, std::uint32_t z)const
+{
+	return mLevelOffsets[level] + z * (mChunks >> level) + x;
+}
+
+const std::uint32_t TerrainPatchCache::InvalidSlot;
+const std::uint32_t TerrainPatchCache::NoNode;
+
+TerrainPatchCache::TerrainPatchCache(std::uint32_t slotCount)
+	: mSlotNodes(slotCount, NoNode), mSlotFrames(slotCount, 0)
+{
+}
+
+void TerrainPatchCache::BeginFrame()
+{
+	++mFrame;
+}
+
+std::uint32_t TerrainPatchCache::Acquire(std::uint32_t node, bool& fresh)
+{
+	fresh = false;
+
+	std::unordered_map<std::uint32_t, std::uint32_t>::iterator found = mNodeSlots.find(node);
+	if (found != mNodeSlots.end())
+	{
+		mSlotFrames[found->second] = mFrame;
+		return found->second;
+	}
+
+	// Slots never used have frame zero, so they go first.
+	std::uint32_t slot = InvalidSlot;
+	for (std::uint32_t s = 0; s < (std::uint32_t)mSlotNodes.size(); ++s)
+	{
+		if (mSlotFrames[s] != mFrame && (slot == InvalidSlot || mSlotFrames[s] < mSlotFrames[slot]))
+			slot = s;
+	}
+
+	if (slot == InvalidSlot)
+		return InvalidSlot;
+
+	if (mSlotNodes[slot] != NoNode)
+		mNodeSlots.erase(mSlotNodes[slot]);
+
+	mSlotNodes[slot] = node;
+	mSlotFrames[slot] = mFrame;
+	mNodeSlots[node] = slot;
+	fresh = true;
+	return slot;
+}
+
+void TerrainPatchCache::Clear()
+{
+	std::fill(mSlotNodes.begin(), mSlotNodes.end(), NoNode);
+	std::fill(mSlotFrames.begin(), mSlotFrames.end(), 0);
+	mNodeSlots.clear();
+}
@@ -0,0 +1,458 @@
+#include "Texture.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	std::uint32_t SwapRedBlue(std::uint32_t bgra)
+	{
+		return (bgra & 0xff00ff00) | ((bgra >> 16) & 0xff) | ((bgra & 0xff) << 16);
+	}
+
+	// One source pixel of bytesPerPixel bytes as little-endian RGBA.
+	std::uint32_t ReadPixel(const std::uint8_t* p, std::uint32_t bytesPerPixel)
+	{
+		switch (bytesPerPixel)
+		{
+		case 1: return 0xff000000 | p[0] * 0x010101u;
+		case 3: return 0xff000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+		default: return SwapRedBlue(p[0] | (p[1] << 8) | (p[2] << 16) | ((std::uint32_t)p[3] << 24));
+		}
+	}
+
+	struct ColorTables
+	{
+		ColorTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				double c = i / 255.0;
+				ToLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+			}
+
+			for (int i = 0; i < EncodeSize; ++i)
+			{
+				double l = i / (double)(EncodeSize - 1);
+				double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+				ToSrgb[i] = (std::uint8_t)(c * 255.0 + 0.5);
+			}
+		}
+
+		static const int EncodeSize = 8192;
+
+		float ToLinear[256];
+		std::uint8_t ToSrgb[EncodeSize];
+	};
+
+	const ColorTables& GetColorTables()
+	{
+		static ColorTables tables;
+		return tables;
+	}
+
+	// Source taps for every destination pixel along one axis.
+	struct FilterTaps
+	{
+		std::uint32_t MaxTaps;
+		std::vector<std::int32_t> First;
+		std::vector<float> Weights;
+	};
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	double KaiserWeight(double d)
+	{
+		// Windowed sinc three destination pixels wide, as used by most
+		// offline mip tools.
+		const double width = 3.0;
+		const double alpha = 4.0;
+
+		if (std::fabs(d) >= width)
+			return 0.0;
+
+		double sinc = d == 0.0 ? 1.0 : std::sin(Pi * d) / (Pi * d);
+		double x = d / width;
+		return sinc * BesselI0(alpha * std::sqrt(1.0 - x * x)) / BesselI0(alpha);
+	}
+
+	FilterTaps BuildTaps(std::uint32_t srcSize, std::uint32_t dstSize, MipGenerator::Filter filter)
+	{
+		double scale = (double)srcSize / dstSize;
+		double radius = filter == MipGenerator::Box ? 0.5 * scale : 3.0 * scale;
+
+		FilterTaps taps;
+		taps.MaxTaps = (std::uint32_t)std::ceil(2.0 * radius) + 1;
+		taps.First.resize(dstSize);
+		taps.Weights.assign((size_t)dstSize * taps.MaxTaps, 0.0f);
+
+		for (std::uint32_t o = 0; o < dstSize; ++o)
+		{
+			double center = (o + 0.5) * scale;
+			std::int32_t first = (std::int32_t)std::floor(center - radius);
+			taps.First[o] = first;
+
+			float* weights = &taps.Weights[(size_t)o * taps.MaxTaps];
+			double sum = 0.0;
+
+			for (std::uint32_t t = 0; t < taps.MaxTaps; ++t)
+			{
+				double i = first + (double)t;
+				double w;
+
+				if (filter == MipGenerator::Box)
+				{
+					// Overlap of source pixel [i, i + 1) with the footprint.
+					double lo = i > center - radius ? i : center - radius;
+					double hi = i + 1.0 < center + radius ? i + 1.0 : center + radius;
+					w = hi > lo ? hi - lo : 0.0;
+				}
+				else
+				{
+					w = KaiserWeight((i + 0.5 - center) / scale);
+				}
+
+				weights[t] = (float)w;
+				sum += w;
+			}
+
+			for (std::uint32_t t = 0; t < taps.MaxTaps; ++t)
+				weights[t] = (float)(weights[t] / sum);
+		}
+
+		return taps;
+	}
+
+	std::int32_t Clamp(std::int32_t i, std::int32_t size)
+	{
+		return i < 0 ? 0 : i >= size ? size - 1 : i;
+	}
+}
+
+bool TgaLoader::Load(const std::string& filename, TextureImage& image)
+{
+	PROFILE_FUNCTION();
+
+	std::ifstream ifs(filename, std::ios::binary);
+	if (!ifs)
+		return false;
+
+	ifs.seekg(0, std::ios::end);
+	size_t size = (size_t)ifs.tellg();
+	ifs.seekg(0, std::ios::beg);
+
+	std::vector<std::uint8_t> data(size);
+	ifs.read((char*)data.data(), size);
+	if (!ifs)
+		return false;
+
+	return Decode(data.data(), size, image);
+}
+
+bool TgaLoader::Decode(const std::uint8_t* data, size_t size, TextureImage& image)
+{
+	PROFILE_FUNCTION();
+
+	if (size < 18)
+		return false;
+
+	std::uint32_t idLength = data[0];
+	std::uint32_t colorMapType = data[1];
+	std::uint32_t imageType = data[2];
+	std::uint32_t colorMapLength = data[5] | (data[6] << 8);
+	std::uint32_t colorMapEntryBits = data[7];
+	std::uint32_t width = data[12] | (data[13] << 8);
+	std::uint32_t height = data[14] | (data[15] << 8);
+	std::uint32_t bitsPerPixel = data[16];
+	std::uint32_t descriptor = data[17];
+
+	bool rle = imageType == 10 || imageType == 11;
+	bool gray = imageType == 3 || imageType == 11;
+
+	if (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11)
+		return false;
+	if (gray ? bitsPerPixel != 8 : bitsPerPixel != 24 && bitsPerPixel != 32)
+		return false;
+	if (width == 0 || height == 0)
+		return false;
+
+	size_t offset = 18 + idLength + (colorMapType ? colorMapLength * ((colorMapEntryBits + 7) / 8) : 0);
+	if (offset > size)
+		return false;
+
+	const std::uint8_t* src = data + offset;
+	const std::uint8_t* srcEnd = data + size;
+	std::uint32_t bytesPerPixel = bitsPerPixel / 8;
+	size_t pixelCount = (size_t)width * height;
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(pixelCount * 4);
+
+	std::uint32_t* dst = (std::uint32_t*)image.Pixels.data();
+
+	if (!rle)
+	{
+		if ((size_t)(srcEnd - src) < pixelCount * bytesPerPixel)
+			return false;
+
+		if (bytesPerPixel == 4)
+		{
+			std::memcpy(dst, src, pixelCount * 4);
+			for (size_t i = 0; i < pixelCount; ++i)
+				dst[i] = SwapRedBlue(dst[i]);
+		}
+		else
+		{
+			for (size_t i = 0; i < pixelCount; ++i, src += bytesPerPixel)
+				dst[i] = ReadPixel(src, bytesPerPixel);
+		}
+	}
+	else
+	{
+		// Packets may run across row ends, so decode as one long run.
+		size_t i = 0;
+		while (i < pixelCount)
+		{
+			if (src >= srcEnd)
+				return false;
+
+			std::uint32_t header = *src++;
+			size_t count = (header & 0x7f) + 1;
+			if (count > pixelCount - i)
+				count = pixelCount - i;
+
+			if (header & 0x80)
+			{
+				if ((size_t)(srcEnd - src) < bytesPerPixel)
+					return false;
+
+				std::uint32_t pixel = ReadPixel(src, bytesPerPixel);
+				src += bytesPerPixel;
+
+				for (size_t k = 0; k < count; ++k)
+					dst[i + k] = pixel;
+			}
+			else
+			{
+				if ((size_t)(srcEnd - src) < count * bytesPerPixel)
+					return false;
+
+				for (size_t k = 0; k < count; ++k, src += bytesPerPixel)
+					dst[i + k] = ReadPixel(src, bytesPerPixel);
+			}
+
+			i += count;
+		}
+	}
+
+	// A 32-bit file that declares no alpha bits uses the fourth byte as
+	// padding.
+	if (bytesPerPixel == 4 && (descriptor & 0x0f) == 0)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+			dst[i] |= 0xff000000;
+	}
+
+	// Bit 5 clear means the first row is the bottom one.
+	if (!(descriptor & 0x20))
+	{
+		for (std::uint32_t y = 0; y < height / 2; ++y)
+		{
+			std::uint32_t* a = dst + (size_t)y * width;
+			std::uint32_t* b = dst + (size_t)(height - 1 - y) * width;
+			for (std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint32_t t = a[x];
+				a[x] = b[x];
+				b[x] = t;
+			}
+		}
+	}
+
+	// Bit 4 set means the first column is the right one.
+	if (descriptor & 0x10)
+	{
+		for (std::uint32_t y = 0; y < height; ++y)
+		{
+			std::uint32_t* row = dst + (size_t)y * width;
+			for (std::uint32_t x = 0; x < width / 2; ++x)
+			{
+				std::uint32_t t = row[x];
+				row[x] = row[width - 1 - x];
+				row[width - 1 - x] = t;
+			}
+		}
+	}
+
+	return true;
+}
+
+std::uint32_t MipGenerator::LevelCount(std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+	}
+	return levels;
+}
+
+void MipGenerator::Generate(const TextureImage& image, Filter filter, bool srgb, std::vector<TextureImage>& mips)
+{
+	PROFILE_FUNCTION();
+
+	const ColorTables& tables = GetColorTables();
+	ThreadPool& pool = ThreadPool::Get();
+
+	std::uint32_t levelCount = LevelCount(image.Width, image.Height);
+	mips.resize(levelCount);
+	mips[0] = image;
+
+	// Levels are filtered from the previous level kept in linear float, so
+	// 8-bit rounding does not accumulate down the chain.
+	std::uint32_t srcWidth = image.Width;
+	std::uint32_t srcHeight = image.Height;
+
+	std::vector<XMFLOAT4A> src((size_t)srcWidth * srcHeight);
+	std::vector<XMFLOAT4A> dst;
+	std::vector<XMFLOAT4A> rows;
+
+	pool.ParallelFor(srcHeight, 16, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (size_t i = (size_t)begin * srcWidth; i < (size_t)end * srcWidth; ++i)
+		{
+			const std::uint8_t* p = &image.Pixels[i * 4];
+			if (srgb)
+				src[i] = XMFLOAT4A(tables.ToLinear[p[0]], tables.ToLinear[p[1]], tables.ToLinear[p[2]], p[3] / 255.0f);
+			else
+				src[i] = XMFLOAT4A(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
+		}
+	});
+
+	for (std::uint32_t level = 1; level < levelCount; ++level)
+	{
+		std::uint32_t dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+		std::uint32_t dstHeight = srcHeight > 1 ? srcHeight / 2 : 1;
+
+		FilterTaps xTaps = BuildTaps(srcWidth, dstWidth, filter);
+		FilterTaps yTaps = BuildTaps(srcHeight, dstHeight, filter);
+
+		// Horizontal pass over every source row, then a vertical pass that
+		// streams whole rows through the weights.
+		rows.resize((size_t)dstWidth * srcHeight);
+		dst.resize((size_t)dstWidth * dstHeight);
+
+		pool.ParallelFor(srcHeight, 8, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t y = begin; y < end; ++y)
+			{
+				const XMFLOAT4A* in = &src[(size_t)y * srcWidth];
+				XMFLOAT4A* out = &rows[(size_t)y * dstWidth];
+
+				for (std::uint32_t x = 0; x < dstWidth; ++x)
+				{
+					const float* weights = &xTaps.Weights[(size_t)x * xTaps.MaxTaps];
+					XMVECTOR sum = XMVectorZero();
+
+					for (std::uint32_t t = 0; t < xTaps.MaxTaps; ++t)
+					{
+						if (weights[t] != 0.0f)
+						{
+							std::int32_t sx = Clamp(xTaps.First[x] + (std::int32_t)t, (std::int32_t)srcWidth);
+							sum = XMVectorMultiplyAdd(XMLoadFloat4A(&in[sx]), XMVectorReplicate(weights[t]), sum);
+						}
+					}
+
+					XMStoreFloat4A(&out[x], sum);
+				}
+			}
+		});
+
+		pool.ParallelFor(dstHeight, 4, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			for (std::uint32_t y = begin; y < end; ++y)
+			{
+				const float* weights = &yTaps.Weights[(size_t)y * yTaps.MaxTaps];
+				XMFLOAT4A* out = &dst[(size_t)y * dstWidth];
+
+				for (std::uint32_t x = 0; x < dstWidth; ++x)
+					out[x] = XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f);
+
+				for (std::uint32_t t = 0; t < yTaps.MaxTaps; ++t)
+				{
+					if (weights[t] == 0.0f)
+						continue;
+
+					std::int32_t sy = Clamp(yTaps.First[y] + (std::int32_t)t, (std::int32_t)srcHeight);
+					const XMFLOAT4A* in = &rows[(size_t)sy * dstWidth];
+					XMVECTOR w = XMVectorReplicate(weights[t]);
+
+					for (std::uint32_t x = 0; x < dstWidth; ++x)
+						XMStoreFloat4A(&out[x], XMVectorMultiplyAdd(XMLoadFloat4A(&in[x]), w, XMLoadFloat4A(&out[x])));
+				}
+			}
+		});
+
+		TextureImage& mip = mips[level];
+		mip.Width = dstWidth;
+		mip.Height = dstHeight;
+		mip.Pixels.resize((size_t)dstWidth * dstHeight * 4);
+
+		pool.ParallelFor(dstHeight, 16, [&](std::uint32_t begin, std::uint32_t end)
+		{
+			XMVECTOR zero = XMVectorZero();
+			XMVECTOR one = XMVectorSplatOne();
+			// sRGB color indexes the encode table; everything else is 8-bit.
+			float colorScale = srgb ? ColorTables::EncodeSize - 1.0f : 255.0f;
+			XMVECTOR encodeScale = XMVectorSet(colorScale, colorScale, colorScale, 255.0f);
+
+			for (size_t i = (size_t)begin * dstWidth; i < (size_t)end * dstWidth; ++i)
+			{
+				// The Kaiser filter's negative lobes can overshoot [0, 1].
+				XMFLOAT4A c;
+				XMStoreFloat4A(&c, XMVectorMultiplyAdd(XMVectorClamp(XMLoadFloat4A(&dst[i]), zero, one), encodeScale, XMVectorReplicate(0.5f)));
+
+				std::uint8_t* p = &mip.Pixels[i * 4];
+				if (srgb)
+				{
+					p[0] = tables.ToSrgb[(int)c.x];
+					p[1] = tables.ToSrgb[(int)c.y];
+					p[2] = tables.ToSrgb[(int)c.z];
+				}
+				else
+				{
+					p[0] = (std::uint8_t)c.x;
+					p[1] = (std::uint8_t)c.y;
+					p[2] = (std::uint8_t)c.z;
+				}
+				p[3] = (std::uint8_t)c.w;
+			}
+		});
+
+		src.swap(dst);
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+}
@@ -0,0 +1,330 @@
+#include "TextureAtlas.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Each width tried is this fraction wider than the last.
+	const std::uint32_t WidthStep = 32;
+
+	std::uint32_t Align(std::uint32_t size, std::uint32_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	std::uint32_t CellSize(std::uint32_t size, std::uint32_t gutter, std::uint32_t alignment)
+	{
+		return Align(size + 2 * gutter, alignment);
+	}
+
+	// 64-bit FNV-1a.
+	const std::uint64_t HashBasis = 0xcbf29ce484222325ull;
+
+	std::uint64_t HashBytes(std::uint64_t hash, const void* data, size_t size)
+	{
+		const std::uint8_t* bytes = (const std::uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		return hash;
+	}
+
+	// The top edge of everything placed so far, as runs of equal height
+	// from left to right.
+	class Skyline
+	{
+	public:
+		Skyline(std::uint32_t width, std::uint32_t maxHeight)
+			: mWidth(width), mMaxHeight(maxHeight)
+		{
+			Segment floor = { 0, 0, width };
+			mSegments.push_back(floor);
+		}
+
+		// The lowest spot for the top of the cell, ties going to the
+		// narrowest segment so wide gaps are kept for wide cells.
+		bool Insert(std::uint32_t width, std::uint32_t height, std::uint32_t& x, std::uint32_t& y)
+		{
+			size_t best = mSegments.size();
+			std::uint32_t bestTop = 0;
+			std::uint32_t bestWidth = 0;
+			std::uint32_t bestY = 0;
+
+			for (size_t i = 0; i < mSegments.size(); ++i)
+			{
+				std::uint32_t fitY;
+				if (!Fit(i, width, fitY) || fitY + height > mMaxHeight)
+					continue;
+
+				std::uint32_t top = fitY + height;
+				if (best == mSegments.size() || top < bestTop || (top == bestTop && mSegments[i].Width < bestWidth))
+				{
+					best = i;
+					bestTop = top;
+					bestWidth = mSegments[i].Width;
+					bestY = fitY;
+				}
+			}
+
+			if (best == mSegments.size())
+				return false;
+
+			x = mSegments[best].X;
+			y = bestY;
+
+			// The new segment covers the cell; the ones under it shrink
+			// or go.
+			Segment placed = { x, bestTop, width };
+			mSegments.insert(mSegments.begin() + best, placed);
+
+			std::uint32_t right = x + width;
+			size_t i = best + 1;
+			while (i < mSegments.size() && mSegments[i].X < right)
+			{
+				Segment& segment = mSegments[i];
+				std::uint32_t covered = right - segment.X;
+				if (segment.Width <= covered)
+				{
+					mSegments.erase(mSegments.begin() + i);
+					continue;
+				}
+
+				segment.X += covered;
+				segment.Width -= covered;
+				break;
+			}
+
+			for (i = best > 0 ? best - 1 : 0; i + 1 < mSegments.size() && i <= best; )
+			{
+				if (mSegments[i].Y == mSegments[i + 1].Y)
+				{
+					mSegments[i].Width += mSegments[i + 1].Width;
+					mSegments.erase(mSegments.begin() + i + 1);
+				}
+				else
+				{
+					++i;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		struct Segment
+		{
+			std::uint32_t X;
+			std::uint32_t Y;
+			std::uint32_t Width;
+		};
+
+		// Where a cell starting at segment i would rest: on the highest
+		// segment it spans.
+		bool Fit(size_t i, std::uint32_t width, std::uint32_t& y)const
+		{
+			if (mSegments[i].X + width > mWidth)
+				return false;
+
+			y = 0;
+			std::uint32_t remaining = width;
+			for (; remaining > 0; ++i)
+			{
+				y = std::max(y, mSegments[i].Y);
+				if (mSegments[i].Width >= remaining)
+					break;
+				remaining -= mSegments[i].Width;
+			}
+
+			return true;
+		}
+
+		std::uint32_t mWidth;
+		std::uint32_t mMaxHeight;
+		std::vector<Segment> mSegments;
+	};
+}
+
+bool TextureAtlas::Pack(std::vector<AtlasRect>& rects, std::uint32_t gutter, std::uint32_t alignment, std::uint32_t maxSize,
+	std::uint32_t& width, std::uint32_t& height)
+{
+	PROFILE_FUNCTION();
+
+	std::vector<std::uint32_t> order(rects.size());
+	std::vector<std::uint32_t> cellWidths(rects.size());
+	std::vector<std::uint32_t> cellHeights(rects.size());
+	std::uint64_t area = 0;
+	std::uint32_t widest = alignment;
+
+	for (std::uint32_t i = 0; i < rects.size(); ++i)
+	{
+		order[i] = i;
+		cellWidths[i] = CellSize(rects[i].Width, gutter, alignment);
+		cellHeights[i] = CellSize(rects[i].Height, gutter, alignment);
+		area += (std::uint64_t)cellWidths[i] * cellHeights[i];
+		widest = std::max(widest, cellWidths[i]);
+	}
+
+	std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b)
+	{
+		if (cellHeights[a] != cellHeights[b])
+			return cellHeights[a] > cellHeights[b];
+		return cellWidths[a] > cellWidths[b];
+	});
+
+	std::vector<std::uint32_t> xs(rects.size());
+	std::vector<std::uint32_t> ys(rects.size());
+	bool packed = false;
+
+	// From the square root of the cell area, widen until the packing comes
+	// out no taller than wide and keep the one with the smallest side.
+	// Wider still would pack a little tighter but makes long strips.
+	std::uint32_t tryWidth = std::max(widest, Align((std::uint32_t)std::ceil(std::sqrt((double)area)), alignment));
+
+	for (; tryWidth <= maxSize; tryWidth = Align(tryWidth + tryWidth / WidthStep + 1, alignment))
+	{
+		Skyline skyline(tryWidth, maxSize);
+		std::uint32_t top = 0;
+		bool fits = true;
+
+		for (std::uint32_t i : order)
+		{
+			if (!skyline.Insert(cellWidths[i], cellHeights[i], xs[i], ys[i]))
+			{
+				fits = false;
+				break;
+			}
+			top = std::max(top, ys[i] + cellHeights[i]);
+		}
+
+		if (!fits)
+			continue;
+
+		std::uint32_t tryHeight = std::max(top, alignment);
+		std::uint32_t side = std::max(tryWidth, tryHeight);
+
+		if (!packed || side < std::max(width, height)
+			|| (side == std::max(width, height) && (std::uint64_t)tryWidth * tryHeight < (std::uint64_t)width * height))
+		{
+			packed = true;
+			width = tryWidth;
+			height = tryHeight;
+
+			for (std::uint32_t i = 0; i < rects.size(); ++i)
+			{
+				rects[i].X = xs[i] + gutter;
+				rects[i].Y = ys[i] + gutter;
+			}
+		}
+
+		if (tryHeight <= tryWidth)
+			break;
+	}
+
+	return packed;
+}
+
+void TextureAtlas::Compose(const std::vector<TextureImage>& images, const std::vector<AtlasRect>& rects, std::uint32_t gutter,
+	std::uint32_t alignment, std::uint32_t width, std::uint32_t height, TextureImage& atlas)
+{
+	PROFILE_FUNCTION();
+
+	atlas.Width = width;
+	atlas.Height = height;
+	atlas.Pixels.assign((size_t)width * height * 4, 0);
+
+	std::uint32_t* dest = (std::uint32_t*)atlas.Pixels.data();
+
+	ThreadPool::Get().ParallelFor((std::uint32_t)images.size(), 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			const TextureImage& image = images[i];
+			const AtlasRect& rect = rects[i];
+			const std::uint32_t* source = (const std::uint32_t*)image.Pixels.data();
+
+			std::uint32_t left = rect.X - gutter;
+			std::uint32_t right = left + CellSize(rect.Width, gutter, alignment);
+			std::uint32_t top = rect.Y - gutter;
+			std::uint32_t bottom = top + CellSize(rect.Height, gutter, alignment);
+
+			for (std::uint32_t y = top; y < bottom; ++y)
+			{
+				std::uint32_t sourceY = std::min(y > rect.Y ? y - rect.Y : 0, image.Height - 1);
+				const std::uint32_t* sourceRow = source + (size_t)sourceY * image.Width;
+				std::uint32_t* destRow = dest + (size_t)y * width;
+
+				for (std::uint32_t x = left; x < rect.X; ++x)
+					destRow[x] = sourceRow[0];
+
+				std::memcpy(destRow + rect.X, sourceRow, image.Width * 4);
+
+				for (std::uint32_t x = rect.X + image.Width; x < right; ++x)
+					destRow[x] = sourceRow[image.Width - 1];
+			}
+		}
+	});
+}
+
+bool TextureAtlas::RemapTexCoords(const AtlasRect& rect, std::uint32_t width, std::uint32_t height,
+	XMFLOAT2* texCoords, std::uint32_t count, std::uint32_t stride)
+{
+	if (!InUnitSquare(texCoords, count, stride))
+		return false;
+
+	float scaleU = (float)rect.Width / width;
+	float scaleV = (float)rect.Height / height;
+	float offsetU = (float)rect.X / width;
+	float offsetV = (float)rect.Y / height;
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		XMFLOAT2& texC = *(XMFLOAT2*)((std::uint8_t*)texCoords + (size_t)i * stride);
+		texC.x = offsetU + texC.x * scaleU;
+		texC.y = offsetV + texC.y * scaleV;
+	}
+
+	return true;
+}
+
+bool TextureAtlas::InUnitSquare(const XMFLOAT2* texCoords, std::uint32_t count, std::uint32_t stride)
+{
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT2& texC = *(const XMFLOAT2*)((const std::uint8_t*)texCoords + (size_t)i * stride);
+		if (texC.x < 0.0f || texC.x > 1.0f || texC.y < 0.0f || texC.y > 1.0f)
+			return false;
+	}
+
+	return true;
+}
+
+std::uint64_t TextureAtlas::Hash(const std::vector<TextureImage>& images, const std::vector<AtlasRect>& rects, std::uint32_t gutter,
+	std::uint32_t alignment, std::uint32_t width, std::uint32_t height)
+{
+	PROFILE_FUNCTION();
+
+	std::uint32_t params[4] = { gutter, alignment, width, height };
+	std::uint64_t hash = HashBytes(HashBasis, params, sizeof(params));
+
+	for (size_t i = 0; i < images.size() && i < rects.size(); ++i)
+	{
+		std::uint32_t placement[6] = { rects[i].X, rects[i].Y, rects[i].Width, rects[i].Height, images[i].Width, images[i].Height };
+		hash = HashBytes(hash, placement, sizeof(placement));
+		hash = HashBytes(hash, images[i].Pixels.data(), images[i].Pixels.size());
+	}
+
+	return hash;
+}
+
+float TextureAtlas::Efficiency(const std::vector<AtlasRect>& rects, std::uint32_t width, std::uint32_t height)
+{
+	double used = 0.0;
+	for (const AtlasRect& rect : rects)
+		used += (double)rect.Width * rect.Height;
+
+	return (float)(used / ((double)width * height));
+}
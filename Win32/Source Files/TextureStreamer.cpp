@@ -0,0 +1,318 @@
+#include "TextureStreamer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(StreamingDevice& device, size_t budget)
+	: mDevice(device), mBudget(budget), mResidentBytes(0), mIncomingBytes(0), mFrame(0), mLoadsInFlight(0),
+	mWakePending(false), mStop(false)
+{
+	mThread = std::thread(&TextureStreamer::StreamingThreadMain, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		mStop = true;
+	}
+	mWake.notify_one();
+	mThread.join();
+
+	// The thread finishes whatever was queued before it stops.
+	ApplyLoads();
+
+	for (const std::unique_ptr<StreamedTexture>& texture : mTextures)
+		mDevice.ReleaseTexture(texture->Resource);
+}
+
+TextureStreamer::TextureId TextureStreamer::Add(const std::string& filename)
+{
+	PROFILE_FUNCTION();
+
+	std::unique_ptr<StreamedTexture> texture(new StreamedTexture());
+
+	if (!texture->File.Open(filename) || !DdsFile::ParseLayout(texture->File.Data(), texture->File.Size(), texture->Layout))
+		return InvalidTexture;
+
+	const DdsLayout& layout = texture->Layout;
+	std::uint32_t levelCount = (std::uint32_t)layout.LevelSizes.size();
+
+	texture->LevelBytes.assign(levelCount + 1, 0);
+	texture->Usable.resize(levelCount);
+
+	for (std::uint32_t i = levelCount; i-- > 0; )
+	{
+		std::uint32_t width = std::max(layout.Width >> i, 1u);
+		std::uint32_t height = std::max(layout.Height >> i, 1u);
+
+		texture->LevelBytes[i] = texture->LevelBytes[i + 1] + layout.LevelSizes[i];
+		texture->Usable[i] = width % 4 == 0 && height % 4 == 0;
+	}
+
+	if (!texture->Usable[0])
+		return InvalidTexture;
+
+	// The tail starts at the first usable level no bigger than TailSize,
+	// or at the smallest usable level if they are all bigger.
+	std::uint32_t tail = 0;
+	for (std::uint32_t i = 0; i < levelCount; ++i)
+	{
+		if (!texture->Usable[i])
+			continue;
+
+		tail = i;
+		if (std::max(layout.Width >> i, layout.Height >> i) <= TailSize)
+			break;
+	}
+
+	texture->Resource = mDevice.CreateTexture(layout, texture->File.Data(), tail);
+	if (!texture->Resource)
+		return InvalidTexture;
+
+	texture->ResidentLevel = tail;
+	texture->TailLevel = tail;
+	texture->TargetLevel = tail;
+	texture->Pending = false;
+	texture->ScreenPixels = 0.0f;
+	texture->LastScreenPixels = 0.0f;
+	texture->LastRequestFrame = 0;
+
+	mResidentBytes += texture->LevelBytes[tail];
+	mTextures.push_back(std::move(texture));
+
+	return (TextureId)mTextures.size() - 1;
+}
+
+void TextureStreamer::Request(TextureId id, float screenPixels)
+{
+	StreamedTexture& texture = *mTextures[id];
+	texture.ScreenPixels = std::max(texture.ScreenPixels, screenPixels);
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_FUNCTION();
+
+	ApplyLoads();
+
+	// Every texture starts at the level its objects need; a texture nobody
+	// asked for lately falls back to its tail.
+	size_t total = 0;
+
+	for (const std::unique_ptr<StreamedTexture>& texture : mTextures)
+	{
+		if (texture->ScreenPixels > 0.0f)
+		{
+			texture->LastScreenPixels = texture->ScreenPixels;
+			texture->LastRequestFrame = mFrame;
+		}
+		else if (mFrame - texture->LastRequestFrame > EvictDelay)
+		{
+			texture->LastScreenPixels = 0.0f;
+		}
+
+		texture->ScreenPixels = 0.0f;
+		texture->TargetLevel = LevelForSize(*texture, texture->LastScreenPixels);
+		total += texture->LevelBytes[texture->TargetLevel];
+	}
+
+	// Over budget, coarsen one level at a time wherever the most texels
+	// land on each screen pixel.  Tails are never given up, so the loop
+	// stops if they alone exceed the budget.
+	while (total > mBudget)
+	{
+		StreamedTexture* coarsest = nullptr;
+		std::uint32_t coarsestNext = 0;
+		float coarsestDensity = -1.0f;
+
+		for (const std::unique_ptr<StreamedTexture>& texture : mTextures)
+		{
+			std::uint32_t next = texture->TargetLevel + 1;
+			while (next <= texture->TailLevel && !texture->Usable[next])
+				++next;
+			if (next > texture->TailLevel)
+				continue;
+
+			float texels = (float)std::max(texture->Layout.Width >> texture->TargetLevel, texture->Layout.Height >> texture->TargetLevel);
+			float density = texels / std::max(texture->LastScreenPixels, 1.0f);
+
+			if (density > coarsestDensity)
+			{
+				coarsest = texture.get();
+				coarsestNext = next;
+				coarsestDensity = density;
+			}
+		}
+
+		if (!coarsest)
+			break;
+
+		total -= coarsest->LevelBytes[coarsest->TargetLevel] - coarsest->LevelBytes[coarsestNext];
+		coarsest->TargetLevel = coarsestNext;
+	}
+
+	// Evictions first, since they make room; then the largest objects on
+	// screen get their detail first.
+	mChanges.clear();
+	for (const std::unique_ptr<StreamedTexture>& texture : mTextures)
+	{
+		if (!texture->Pending && texture->TargetLevel != texture->ResidentLevel)
+			mChanges.push_back(texture.get());
+	}
+
+	std::sort(mChanges.begin(), mChanges.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		bool aEvicts = a->TargetLevel > a->ResidentLevel;
+		bool bEvicts = b->TargetLevel > b->ResidentLevel;
+		if (aEvicts != bEvicts)
+			return aEvicts;
+		return a->LastScreenPixels > b->LastScreenPixels;
+	});
+
+	bool queued = false;
+
+	for (StreamedTexture* texture : mChanges)
+	{
+		if (mLoadsInFlight == MaxLoads)
+			break;
+
+		size_t growth = 0;
+		if (texture->TargetLevel < texture->ResidentLevel)
+		{
+			growth = texture->LevelBytes[texture->TargetLevel] - texture->LevelBytes[texture->ResidentLevel];
+			if (mResidentBytes + mIncomingBytes + growth > mBudget)
+				continue;
+		}
+
+		Load load = { texture, texture->TargetLevel, nullptr };
+		if (!mRequests.Push(load))
+			break;
+
+		texture->Pending = true;
+		mIncomingBytes += growth;
+		++mLoadsInFlight;
+		queued = true;
+	}
+
+	if (queued)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+			mWakePending = true;
+		}
+		mWake.notify_one();
+	}
+
+	++mFrame;
+}
+
+void TextureStreamer::Flush()
+{
+	PROFILE_FUNCTION();
+
+	ApplyLoads();
+
+	while (mLoadsInFlight > 0)
+	{
+		std::this_thread::yield();
+		ApplyLoads();
+	}
+}
+
+void* TextureStreamer::Texture(TextureId id)const
+{
+	return mTextures[id]->Resource;
+}
+
+std::uint32_t TextureStreamer::ResidentLevel(TextureId id)const
+{
+	return mTextures[id]->ResidentLevel;
+}
+
+std::uint32_t TextureStreamer::TargetLevel(TextureId id)const
+{
+	return mTextures[id]->TargetLevel;
+}
+
+size_t TextureStreamer::ResidentBytes()const
+{
+	return mResidentBytes;
+}
+
+size_t TextureStreamer::Budget()const
+{
+	return mBudget;
+}
+
+void TextureStreamer::ApplyLoads()
+{
+	Load load;
+
+	while (mResults.Pop(load))
+	{
+		StreamedTexture& texture = *load.Texture;
+
+		if (load.FirstLevel < texture.ResidentLevel)
+			mIncomingBytes -= texture.LevelBytes[load.FirstLevel] - texture.LevelBytes[texture.ResidentLevel];
+
+		// A failed load keeps what was there and is retried next frame.
+		if (load.Resource)
+		{
+			mDevice.ReleaseTexture(texture.Resource);
+			mResidentBytes -= texture.LevelBytes[texture.ResidentLevel];
+
+			texture.Resource = load.Resource;
+			texture.ResidentLevel = load.FirstLevel;
+			mResidentBytes += texture.LevelBytes[texture.ResidentLevel];
+		}
+
+		texture.Pending = false;
+		--mLoadsInFlight;
+	}
+}
+
+std::uint32_t TextureStreamer::LevelForSize(const StreamedTexture& texture, float screenPixels)const
+{
+	if (screenPixels <= 0.0f)
+		return texture.TailLevel;
+
+	// About one texel per pixel; rounding down errs on the sharp side.
+	float texels = (float)std::max(texture.Layout.Width, texture.Layout.Height);
+	std::uint32_t level = texels > screenPixels ? (std::uint32_t)std::log2(texels / screenPixels) : 0;
+
+	level = std::min(level, texture.TailLevel);
+	while (level > 0 && !texture.Usable[level])
+		--level;
+
+	return level;
+}
+
+void TextureStreamer::StreamingThreadMain()
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWake.wait(lock, [this] { return mWakePending || mStop; });
+			mWakePending = false;
+		}
+
+		Load load;
+		while (mRequests.Pop(load))
+		{
+			PROFILE_SCOPE("Stream Texture");
+
+			const StreamedTexture& texture = *load.Texture;
+			load.Resource = mDevice.CreateTexture(texture.Layout, texture.File.Data(), load.FirstLevel);
+
+			// MaxLoads bounds what is in flight, so there is always room.
+			while (!mResults.Push(load))
+				std::this_thread::yield();
+		}
+
+		std::lock_guard<std::mutex> lock(mWakeMutex);
+		if (mStop)
+			return;
+	}
+}
@@ -0,0 +1,132 @@
+#include "ThreadPool.h"
+
+namespace
+{
+	// Set while a thread is running chunks, so nested loops run inline
+	// instead of waiting on workers that may all be busy with the outer one.
+	thread_local bool tInParallelFor = false;
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+	return pool;
+}
+
+ThreadPool::ThreadPool(std::uint32_t workerCount)
+	: mJob(nullptr),
+	mGeneration(0),
+	mActiveWorkers(0),
+	mStop(false)
+{
+	for (std::uint32_t i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back(&ThreadPool::WorkerMain, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWorkAvailable.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+std::uint32_t ThreadPool::ThreadCount()const
+{
+	return (std::uint32_t)mWorkers.size() + 1;
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, std::uint32_t grainSize,
+	const std::function<void(std::uint32_t, std::uint32_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	if (grainSize == 0)
+		grainSize = 1;
+
+	std::uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	if (mWorkers.empty() || chunkCount == 1 || tInParallelFor)
+	{
+		body(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(mSubmitMutex);
+
+	Job job;
+	job.Body = &body;
+	job.Count = count;
+	job.GrainSize = grainSize;
+	job.ChunkCount = chunkCount;
+	job.NextChunk = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mGeneration++;
+	}
+	mWorkAvailable.notify_all();
+
+	tInParallelFor = true;
+	RunChunks(job);
+	tInParallelFor = false;
+
+	// Every chunk has been claimed; wait for the workers still running one.
+	// Clearing mJob under the lock keeps late wakers away from the stack frame.
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkFinished.wait(lock, [this] { return mActiveWorkers == 0; });
+	mJob = nullptr;
+}
+
+void ThreadPool::RunChunks(Job& job)
+{
+	for (;;)
+	{
+		std::uint32_t chunk = job.NextChunk.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= job.ChunkCount)
+			return;
+
+		std::uint32_t begin = chunk * job.GrainSize;
+		std::uint32_t end = begin + job.GrainSize < job.Count ? begin + job.GrainSize : job.Count;
+
+		(*job.Body)(begin, end);
+	}
+}
+
+void ThreadPool::WorkerMain()
+{
+	std::uint64_t seenGeneration = 0;
+
+	for (;;)
+	{
+		Job* job;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [&] { return mStop || (mJob && mGeneration != seenGeneration); });
+
+			if (mStop)
+				return;
+
+			seenGeneration = mGeneration;
+			job = mJob;
+			mActiveWorkers++;
+		}
+
+		tInParallelFor = true;
+		RunChunks(*job);
+		tInParallelFor = false;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mActiveWorkers--;
+		}
+		mWorkFinished.notify_all();
+	}
+}
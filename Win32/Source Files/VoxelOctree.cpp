@@ -0,0 +1,780 @@
+#include "VoxelOctree.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	// Triangles per task when setting them up.
+	const std::uint32_t GrainSize = 1024;
+
+	const std::uint32_t MaxResolution = 4096;
+
+	std::uint32_t PopCount(std::uint32_t mask)
+	{
+		mask = mask - ((mask >> 1) & 0x55555555);
+		mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+		return (((mask + (mask >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+	}
+
+	std::uint32_t Log2(std::uint32_t x)
+	{
+		std::uint32_t log = 0;
+		while ((1u << log) < x)
+			++log;
+		return log;
+	}
+
+	// Bits lo to hi of a row.
+	std::uint32_t RowBits(std::uint32_t lo, std::uint32_t hi)
+	{
+		std::uint32_t count = hi - lo + 1;
+		return (count >= 32 ? 0xffffffff : (1u << count) - 1) << lo;
+	}
+
+	// A triangle's overlap test against unit voxels in voxel space: the
+	// plane must pass between two opposite corners of the voxel, and each
+	// of the three axis projections must overlap.  Projections are indexed
+	// by the axis they drop, and lay out their two axes as (y, z), (z, x)
+	// and (x, y).
+	struct TriangleSetup
+	{
+		float Normal[3];
+		float PlaneNear;
+		float PlaneFar;
+		float EdgeNormals[3][3][2];
+		float EdgeOffsets[3][3];
+
+		// Voxels its bounds touch.
+		std::int32_t Min[3];
+		std::int32_t Max[3];
+		bool Degenerate;
+	};
+
+	void SetUp(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, std::int32_t resolution, TriangleSetup& setup)
+	{
+		const float v[3][3] = { { a.x, a.y, a.z }, { b.x, b.y, b.z }, { c.x, c.y, c.z } };
+
+		float e[3][3];
+		for (int i = 0; i < 3; ++i)
+			for (int k = 0; k < 3; ++k)
+				e[i][k] = v[(i + 1) % 3][k] - v[i][k];
+
+		float* n = setup.Normal;
+		n[0] = e[0][1] * (v[2][2] - v[0][2]) - e[0][2] * (v[2][1] - v[0][1]);
+		n[1] = e[0][2] * (v[2][0] - v[0][0]) - e[0][0] * (v[2][2] - v[0][2]);
+		n[2] = e[0][0] * (v[2][1] - v[0][1]) - e[0][1] * (v[2][0] - v[0][0]);
+		setup.Degenerate = n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+
+		// The corner furthest along the normal, and the one opposite.
+		setup.PlaneNear = 0.0f;
+		setup.PlaneFar = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			float corner = n[k] > 0.0f ? 1.0f : 0.0f;
+			setup.PlaneNear += n[k] * (corner - v[0][k]);
+			setup.PlaneFar += n[k] * (1.0f - corner - v[0][k]);
+		}
+
+		for (int drop = 0; drop < 3; ++drop)
+		{
+			int s = (drop + 1) % 3;
+			int t = (drop + 2) % 3;
+			float sign = n[drop] >= 0.0f ? 1.0f : -1.0f;
+
+			for (int i = 0; i < 3; ++i)
+			{
+				float ns = -e[i][t] * sign;
+				float nt = e[i][s] * sign;
+				setup.EdgeNormals[drop][i][0] = ns;
+				setup.EdgeNormals[drop][i][1] = nt;
+				setup.EdgeOffsets[drop][i] = -(ns * v[i][s] + nt * v[i][t]) + std::max(0.0f, ns) + std::max(0.0f, nt);
+			}
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			float lo = std::min(std::min(v[0][k], v[1][k]), v[2][k]);
+			float hi = std::max(std::max(v[0][k], v[1][k]), v[2][k]);
+			setup.Min[k] = std::min(std::max((std::int32_t)std::floor(lo), 0), resolution - 1);
+			setup.Max[k] = std::min(std::max((std::int32_t)std::floor(hi), 0), resolution - 1);
+		}
+	}
+
+	bool ProjectionOverlaps(const TriangleSetup& setup, int drop, float s, float t)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (setup.EdgeNormals[drop][i][0] * s + setup.EdgeNormals[drop][i][1] * t + setup.EdgeOffsets[drop][i] < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	bool Overlaps(const TriangleSetup& setup, std::int32_t x, std::int32_t y, std::int32_t z)
+	{
+		float plane = setup.Normal[0] * x + setup.Normal[1] * y + setup.Normal[2] * z;
+		return (plane + setup.PlaneNear) * (plane + setup.PlaneFar) <= 0.0f &&
+			ProjectionOverlaps(setup, 0, (float)y, (float)z) &&
+			ProjectionOverlaps(setup, 1, (float)z, (float)x) &&
+			ProjectionOverlaps(setup, 2, (float)x, (float)y);
+	}
+
+	// Narrows first to last to the voxels of row (y, z) the triangle
+	// overlaps.  Along a row every test is linear in x, so the voxels are
+	// one run, found by solving for its ends and then checking them with
+	// the tests themselves.
+	bool RowSpan(const TriangleSetup& setup, std::int32_t y, std::int32_t z, std::int32_t& first, std::int32_t& last)
+	{
+		if (!ProjectionOverlaps(setup, 0, (float)y, (float)z))
+			return false;
+
+		float lo = (float)first - 1.0f;
+		float hi = (float)last + 1.0f;
+
+		// a * x + b >= 0.
+		auto clip = [&](float a, float b)
+		{
+			if (a > 0.0f)
+				lo = std::max(lo, -b / a);
+			else if (a < 0.0f)
+				hi = std::min(hi, -b / a);
+			else if (b < 0.0f)
+				hi = lo - 1.0f;
+		};
+
+		float planeYZ = setup.Normal[1] * y + setup.Normal[2] * z;
+		clip(setup.Normal[0], planeYZ + setup.PlaneNear);
+		clip(-setup.Normal[0], -(planeYZ + setup.PlaneFar));
+		for (int i = 0; i < 3; ++i)
+		{
+			clip(setup.EdgeNormals[1][i][1], setup.EdgeNormals[1][i][0] * z + setup.EdgeOffsets[1][i]);
+			clip(setup.EdgeNormals[2][i][0], setup.EdgeNormals[2][i][1] * y + setup.EdgeOffsets[2][i]);
+		}
+
+		if (lo > hi)
+			return false;
+
+		first = std::max(first, (std::int32_t)std::floor(lo));
+		last = std::min(last, (std::int32_t)std::ceil(hi));
+		while (first <= last && !Overlaps(setup, first, y, z))
+			++first;
+		while (last >= first && !Overlaps(setup, last, y, z))
+			--last;
+		return first <= last;
+	}
+
+	// Counting sort of triangles into bins over a range of bins each.
+	template <typename Range>
+	void Bin(std::uint32_t triangleCount, std::uint32_t binCount, const Range& range,
+		std::vector<std::uint32_t>& starts, std::vector<std::uint32_t>& triangles)
+	{
+		starts.assign(binCount + 1, 0);
+		for (std::uint32_t t = 0; t < triangleCount; ++t)
+			range(t, [&](std::uint32_t bin) { ++starts[bin + 1]; });
+
+		for (std::uint32_t b = 0; b < binCount; ++b)
+			starts[b + 1] += starts[b];
+
+		std::vector<std::uint32_t> next(starts.begin(), starts.end() - 1);
+		triangles.resize(starts[binCount]);
+		for (std::uint32_t t = 0; t < triangleCount; ++t)
+			range(t, [&](std::uint32_t bin) { triangles[next[bin]++] = t; });
+	}
+}
+
+struct VoxelOctree::Chunk
+{
+	Kind Root = Empty;
+	std::vector<std::uint64_t> Bricks;
+
+	// Mixed nodes of each level within the chunk, from level 1.
+	std::vector<Node> Levels[4];
+};
+
+struct VoxelOctree::BuildContext
+{
+	std::uint32_t Resolution;
+	std::uint32_t Size;
+	std::uint32_t Grid;
+	std::uint32_t ChunkLevel;
+	bool Solid;
+
+	// Three voxel-space corners per triangle.
+	std::vector<XMFLOAT3> Corners;
+	std::vector<TriangleSetup> Setups;
+
+	// Triangles by the chunks their bounds touch, and for filling, by
+	// the columns of chunks along x.
+	std::vector<std::uint32_t> ChunkStarts;
+	std::vector<std::uint32_t> ChunkTriangles;
+	std::vector<std::uint32_t> ColumnStarts;
+	std::vector<std::uint32_t> ColumnTriangles;
+
+	std::vector<Chunk> Chunks;
+
+	std::vector<std::uint64_t> Bricks;
+	std::vector<std::vector<Node>> Levels;
+};
+
+void VoxelOctree::Build(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, std::uint32_t resolution, bool solid)
+{
+	Build(positions, positionStride, indices, triangleCount, resolution, solid, ThreadPool::Get());
+}
+
+void VoxelOctree::Build(const XMFLOAT3* positions, std::uint32_t positionStride, const std::uint32_t* indices,
+	std::uint32_t triangleCount, std::uint32_t resolution, bool solid, ThreadPool& pool)
+{
+	PROFILE_FUNCTION();
+
+	Clear();
+
+	resolution = std::min(std::max(resolution, 2 * BrickSize), MaxResolution);
+	mResolution = 1u << Log2(resolution);
+
+	auto position = [&](std::uint32_t index)
+	{
+		return XMLoadFloat3((const XMFLOAT3*)((const std::uint8_t*)positions + (size_t)index * positionStride));
+	};
+
+	XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+	XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+	for (std::uint32_t i = 0; i < 3 * triangleCount; ++i)
+	{
+		lo = XMVectorMin(lo, position(indices[i]));
+		hi = XMVectorMax(hi, position(indices[i]));
+	}
+
+	if (triangleCount == 0)
+		return;
+
+	// A cube around the mesh with a voxel to spare on every side, so no
+	// triangle rounds onto the outside of the grid.
+	XMFLOAT3 extent;
+	XMStoreFloat3(&extent, XMVectorSubtract(hi, lo));
+	float side = std::max(std::max(std::max(extent.x, extent.y), extent.z), FLT_MIN) * mResolution / (mResolution - 2);
+	mVoxelSize = side / mResolution;
+	XMStoreFloat3(&mOrigin, XMVectorSubtract(XMVectorScale(XMVectorAdd(lo, hi), 0.5f), XMVectorReplicate(0.5f * side)));
+
+	BuildContext context;
+	context.Resolution = mResolution;
+	context.Size = mResolution < ChunkSize ? mResolution : ChunkSize;
+	context.Grid = mResolution / context.Size;
+	context.ChunkLevel = Log2(context.Size / BrickSize);
+	context.Solid = solid;
+
+	context.Corners.resize(3 * (size_t)triangleCount);
+	context.Setups.resize(triangleCount);
+
+	XMVECTOR origin = XMLoadFloat3(&mOrigin);
+	float scale = 1.0f / mVoxelSize;
+
+	pool.ParallelFor(triangleCount, GrainSize, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t t = begin; t < end; ++t)
+		{
+			XMFLOAT3* corners = &context.Corners[3 * (size_t)t];
+			for (int k = 0; k < 3; ++k)
+				XMStoreFloat3(&corners[k], XMVectorScale(XMVectorSubtract(position(indices[3 * t + k]), origin), scale));
+
+			SetUp(corners[0], corners[1], corners[2], (std::int32_t)mResolution, context.Setups[t]);
+		}
+	});
+
+	const std::uint32_t size = context.Size;
+	const std::uint32_t grid = context.Grid;
+
+	Bin(triangleCount, grid * grid * grid, [&](std::uint32_t t, const auto& add)
+	{
+		const TriangleSetup& setup = context.Setups[t];
+		if (setup.Degenerate)
+			return;
+
+		for (std::int32_t z = setup.Min[2] / size; z <= setup.Max[2] / (std::int32_t)size; ++z)
+			for (std::int32_t y = setup.Min[1] / size; y <= setup.Max[1] / (std::int32_t)size; ++y)
+				for (std::int32_t x = setup.Min[0] / size; x <= setup.Max[0] / (std::int32_t)size; ++x)
+					add(x + grid * (y + grid * z));
+	}, context.ChunkStarts, context.ChunkTriangles);
+
+	if (solid)
+	{
+		Bin(triangleCount, grid * grid, [&](std::uint32_t t, const auto& add)
+		{
+			const TriangleSetup& setup = context.Setups[t];
+			if (setup.Normal[0] == 0.0f)
+				return;
+
+			for (std::int32_t z = setup.Min[2] / size; z <= setup.Max[2] / (std::int32_t)size; ++z)
+				for (std::int32_t y = setup.Min[1] / size; y <= setup.Max[1] / (std::int32_t)size; ++y)
+					add(y + grid * z);
+		}, context.ColumnStarts, context.ColumnTriangles);
+	}
+
+	context.Chunks.resize(grid * grid * grid);
+
+	pool.ParallelFor(grid * grid, 1, [&](std::uint32_t begin, std::uint32_t end)
+	{
+		for (std::uint32_t column = begin; column < end; ++column)
+			VoxelizeColumn(context, column);
+	});
+
+	// Splice the chunks into one tree in Morton order, which keeps the
+	// children of every node together on each level.
+	std::uint32_t topLevel = Log2(mResolution / BrickSize);
+	context.Levels.resize(topLevel + 1);
+	mRoot = Splice(context, topLevel, 0, 0, 0);
+
+	std::vector<std::uint32_t> levelOffsets(topLevel + 1, 0);
+	for (std::uint32_t level = topLevel; level >= 1; --level)
+	{
+		levelOffsets[level] = (std::uint32_t)mNodes.size();
+		mNodes.insert(mNodes.end(), context.Levels[level].begin(), context.Levels[level].end());
+	}
+
+	mVoxelCount = mRoot == Full ? (std::uint64_t)mResolution * mResolution * mResolution : 0;
+	for (std::uint32_t level = topLevel; level >= 1; --level)
+	{
+		std::uint32_t first = level == 1 ? 0 : levelOffsets[level - 1];
+		std::uint64_t childSize = BrickSize << (level - 1);
+
+		for (std::uint32_t i = levelOffsets[level]; i < levelOffsets[level] + context.Levels[level].size(); ++i)
+		{
+			Node& node = mNodes[i];
+			node.FirstChild = first;
+			first += PopCount(node.ChildMask & ~node.FullMask);
+			mVoxelCount += PopCount(node.FullMask) * childSize * childSize * childSize;
+		}
+	}
+
+	mBricks.swap(context.Bricks);
+	for (std::uint64_t brick : mBricks)
+		mVoxelCount += PopCount((std::uint32_t)brick) + PopCount((std::uint32_t)(brick >> 32));
+}
+
+void VoxelOctree::VoxelizeColumn(BuildContext& context, std::uint32_t column)const
+{
+	const std::uint32_t size = context.Size;
+	const std::uint32_t grid = context.Grid;
+	const std::int32_t gy = (std::int32_t)(column % grid);
+	const std::int32_t gz = (std::int32_t)(column / grid);
+	const std::int32_t y0 = gy * size;
+	const std::int32_t z0 = gz * size;
+
+	// One bit per voxel, a row of x per word, for every chunk of the
+	// column: row y + size * z of chunk x is rows[(x * size + z) * size + y].
+	std::vector<std::uint32_t> rows((size_t)grid * size * size, 0);
+
+	for (std::uint32_t gx = 0; gx < grid; ++gx)
+	{
+		std::uint32_t chunk = gx + grid * column;
+		const std::int32_t x0 = gx * size;
+		std::uint32_t* chunkRows = &rows[(size_t)gx * size * size];
+
+		for (std::uint32_t i = context.ChunkStarts[chunk]; i < context.ChunkStarts[chunk + 1]; ++i)
+		{
+			const TriangleSetup& setup = context.Setups[context.ChunkTriangles[i]];
+
+			std::int32_t xMin = std::max(setup.Min[0], x0);
+			std::int32_t xMax = std::min(setup.Max[0], x0 + (std::int32_t)size - 1);
+			std::int32_t yMin = std::max(setup.Min[1], y0);
+			std::int32_t yMax = std::min(setup.Max[1], y0 + (std::int32_t)size - 1);
+			std::int32_t zMin = std::max(setup.Min[2], z0);
+			std::int32_t zMax = std::min(setup.Max[2], z0 + (std::int32_t)size - 1);
+
+			for (std::int32_t z = zMin; z <= zMax; ++z)
+			{
+				for (std::int32_t y = yMin; y <= yMax; ++y)
+				{
+					std::int32_t first = xMin;
+					std::int32_t last = xMax;
+					if (!RowSpan(setup, y, z, first, last))
+						continue;
+
+					std::uint32_t bits = RowBits(first - x0, last - x0);
+					chunkRows[(y - y0) + size * (z - z0)] |= bits;
+				}
+			}
+		}
+	}
+
+	if (context.Solid)
+	{
+		// Where each row through voxel centers crosses the triangles.  A
+		// center on a shared edge or vertex belongs to exactly one of the
+		// triangles facing the same way, so a closed mesh always gives an
+		// even count.
+		std::vector<std::pair<std::uint32_t, float>> crossings;
+
+		for (std::uint32_t i = context.ColumnStarts[column]; i < context.ColumnStarts[column + 1]; ++i)
+		{
+			std::uint32_t t = context.ColumnTriangles[i];
+			const XMFLOAT3* corners = &context.Corners[3 * (size_t)t];
+			XMFLOAT3 a = corners[0];
+			XMFLOAT3 b = corners[1];
+			XMFLOAT3 c = corners[2];
+
+			double normalX = ((double)b.y - a.y) * ((double)c.z - a.z) - ((double)b.z - a.z) * ((double)c.y - a.y);
+			if (normalX == 0.0)
+				continue;
+			if (normalX < 0.0)
+				std::swap(b, c);
+
+			double normalY = ((double)b.z - a.z) * ((double)c.x - a.x) - ((double)b.x - a.x) * ((double)c.z - a.z);
+			double normalZ = ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+			double absNormalX = std::fabs(normalX);
+
+			const XMFLOAT3* edges[3][2] = { { &a, &b }, { &b, &c }, { &c, &a } };
+
+			std::int32_t yMin = std::max((std::int32_t)std::ceil(std::min(std::min(a.y, b.y), c.y) - 0.5f), y0);
+			std::int32_t yMax = std::min((std::int32_t)std::floor(std::max(std::max(a.y, b.y), c.y) - 0.5f), y0 + (std::int32_t)size - 1);
+			std::int32_t zMin = std::max((std::int32_t)std::ceil(std::min(std::min(a.z, b.z), c.z) - 0.5f), z0);
+			std::int32_t zMax = std::min((std::int32_t)std::floor(std::max(std::max(a.z, b.z), c.z) - 0.5f), z0 + (std::int32_t)size - 1);
+
+			for (std::int32_t z = zMin; z <= zMax; ++z)
+			{
+				for (std::int32_t y = yMin; y <= yMax; ++y)
+				{
+					double py = y + 0.5;
+					double pz = z + 0.5;
+
+					bool inside = true;
+					for (int k = 0; k < 3 && inside; ++k)
+					{
+						const XMFLOAT3& p = *edges[k][0];
+						const XMFLOAT3& q = *edges[k][1];
+						double dy = (double)q.y - p.y;
+						double dz = (double)q.z - p.z;
+						double side = dy * (pz - p.z) - dz * (py - p.y);
+						inside = side > 0.0 || (side == 0.0 && (dz < 0.0 || (dz == 0.0 && dy > 0.0)));
+					}
+
+					if (!inside)
+						continue;
+
+					double x = a.x - (normalY * (py - a.y) + normalZ * (pz - a.z)) / absNormalX;
+					crossings.push_back(std::make_pair((std::uint32_t)((y - y0) + size * (z - z0)), (float)x));
+				}
+			}
+		}
+
+		std::sort(crossings.begin(), crossings.end());
+
+		// Centers from each odd crossing to the next even one are inside.
+		for (size_t i = 0; i + 1 < crossings.size(); )
+		{
+			if (crossings[i].first != crossings[i + 1].first)
+			{
+				++i;
+				continue;
+			}
+
+			std::uint32_t row = crossings[i].first;
+			std::int32_t first = std::max((std::int32_t)std::ceil(crossings[i].second - 0.5f), 0);
+			std::int32_t last = std::min((std::int32_t)std::ceil(crossings[i + 1].second - 0.5f) - 1, (std::int32_t)context.Resolution - 1);
+
+			for (std::int32_t x = first; x <= last; )
+			{
+				std::uint32_t gx = x / size;
+				std::int32_t chunkLast = std::min(last, (std::int32_t)((gx + 1) * size) - 1);
+				rows[(size_t)gx * size * size + row] |= RowBits(x - gx * size, chunkLast - gx * size);
+				x = chunkLast + 1;
+			}
+
+			i += 2;
+		}
+	}
+
+	for (std::uint32_t gx = 0; gx < grid; ++gx)
+	{
+		Chunk& chunk = context.Chunks[gx + grid * column];
+		chunk.Root = Collapse(&rows[(size_t)gx * size * size], size, context.ChunkLevel, 0, 0, 0, chunk);
+	}
+}
+
+VoxelOctree::Kind VoxelOctree::Collapse(const std::uint32_t* rows, std::uint32_t size, std::uint32_t level,
+	std::uint32_t x, std::uint32_t y, std::uint32_t z, Chunk& chunk)
+{
+	if (level == 0)
+	{
+		std::uint64_t brick = 0;
+		for (std::uint32_t dz = 0; dz < BrickSize; ++dz)
+		{
+			for (std::uint32_t dy = 0; dy < BrickSize; ++dy)
+			{
+				std::uint64_t row = (rows[(BrickSize * y + dy) + size * (BrickSize * z + dz)] >> (BrickSize * x)) & 0xf;
+				brick |= row << (BrickSize * dy + BrickSize * BrickSize * dz);
+			}
+		}
+
+		if (brick == 0)
+			return Empty;
+		if (brick == ~0ull)
+			return Full;
+
+		chunk.Bricks.push_back(brick);
+		return Mixed;
+	}
+
+	// Most of the grid is empty, or full inside a solid, so look at the
+	// node's rows as a whole before its children.
+	std::uint32_t side = BrickSize << level;
+	std::uint32_t mask = RowBits(side * x, side * x + side - 1);
+	std::uint32_t any = 0;
+	std::uint32_t all = mask;
+	for (std::uint32_t dz = 0; dz < side; ++dz)
+	{
+		const std::uint32_t* row = &rows[side * y + size * (side * z + dz)];
+		for (std::uint32_t dy = 0; dy < side; ++dy)
+		{
+			any |= row[dy] & mask;
+			all &= row[dy];
+		}
+	}
+
+	if (any == 0)
+		return Empty;
+	if (all == mask)
+		return Full;
+
+	Node node = { 0, 0, 0 };
+	for (std::uint32_t octant = 0; octant < 8; ++octant)
+	{
+		Kind kind = Collapse(rows, size, level - 1, 2 * x + (octant & 1), 2 * y + ((octant >> 1) & 1), 2 * z + (octant >> 2), chunk);
+		if (kind != Empty)
+			node.ChildMask |= 1 << octant;
+		if (kind == Full)
+			node.FullMask |= 1 << octant;
+	}
+
+	if (node.ChildMask == 0)
+		return Empty;
+	if (node.FullMask == 0xff)
+		return Full;
+
+	chunk.Levels[level].push_back(node);
+	return Mixed;
+}
+
+VoxelOctree::Kind VoxelOctree::Splice(BuildContext& context, std::uint32_t level, std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+	if (level == context.ChunkLevel)
+	{
+		Chunk& chunk = context.Chunks[x + context.Grid * (y + context.Grid * z)];
+		context.Bricks.insert(context.Bricks.end(), chunk.Bricks.begin(), chunk.Bricks.end());
+		for (std::uint32_t l = 1; l <= context.ChunkLevel; ++l)
+			context.Levels[l].insert(context.Levels[l].end(), chunk.Levels[l].begin(), chunk.Levels[l].end());
+
+		Kind root = chunk.Root;
+		chunk = Chunk();
+		return root;
+	}
+
+	Node node = { 0, 0, 0 };
+	for (std::uint32_t octant = 0; octant < 8; ++octant)
+	{
+		Kind kind = Splice(context, level - 1, 2 * x + (octant & 1), 2 * y + ((octant >> 1) & 1), 2 * z + (octant >> 2));
+		if (kind != Empty)
+			node.ChildMask |= 1 << octant;
+		if (kind == Full)
+			node.FullMask |= 1 << octant;
+	}
+
+	if (node.ChildMask == 0)
+		return Empty;
+	if (node.FullMask == 0xff)
+		return Full;
+
+	context.Levels[level].push_back(node);
+	return Mixed;
+}
+
+void VoxelOctree::Clear()
+{
+	mNodes.clear();
+	mBricks.clear();
+	mRoot = Empty;
+	mResolution = 0;
+	mVoxelSize = 0.0f;
+	mOrigin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	mVoxelCount = 0;
+}
+
+std::uint32_t VoxelOctree::EmptySize(std::uint32_t x, std::uint32_t y, std::uint32_t z)const
+{
+	if (mRoot != Mixed)
+		return mRoot == Full ? 0 : mResolution;
+
+	std::uint32_t index = 0;
+	std::uint32_t size = mResolution;
+
+	for (;;)
+	{
+		const Node& node = mNodes[index];
+		size >>= 1;
+
+		std::uint32_t octant = ((x & size) ? 1 : 0) | ((y & size) ? 2 : 0) | ((z & size) ? 4 : 0);
+		std::uint32_t bit = 1u << octant;
+
+		if (!(node.ChildMask & bit))
+			return size;
+		if (node.FullMask & bit)
+			return 0;
+
+		index = node.FirstChild + PopCount(node.ChildMask & ~node.FullMask & (bit - 1));
+
+		if (size == BrickSize)
+		{
+			std::uint32_t voxel = (x & 3) + BrickSize * (y & 3) + BrickSize * BrickSize * (z & 3);
+			return (mBricks[index] >> voxel) & 1 ? 0 : 1;
+		}
+	}
+}
+
+bool VoxelOctree::Occupied(std::uint32_t x, std::uint32_t y, std::uint32_t z)const
+{
+	return x < mResolution && y < mResolution && z < mResolution && EmptySize(x, y, z) == 0;
+}
+
+bool VoxelOctree::Occupied(FXMVECTOR point)const
+{
+	if (mResolution == 0)
+		return false;
+
+	XMFLOAT3 p;
+	XMStoreFloat3(&p, XMVectorScale(XMVectorSubtract(point, XMLoadFloat3(&mOrigin)), 1.0f / mVoxelSize));
+	if (p.x < 0.0f || p.y < 0.0f || p.z < 0.0f)
+		return false;
+
+	return Occupied((std::uint32_t)p.x, (std::uint32_t)p.y, (std::uint32_t)p.z);
+}
+
+bool VoxelOctree::RayMarch(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, VoxelHit& hit)const
+{
+	if (mRoot == Empty)
+		return false;
+
+	// In voxel units the parameter along the ray is unchanged.
+	float o[3];
+	float d[3];
+	XMStoreFloat3((XMFLOAT3*)o, XMVectorScale(XMVectorSubtract(origin, XMLoadFloat3(&mOrigin)), 1.0f / mVoxelSize));
+	XMStoreFloat3((XMFLOAT3*)d, XMVectorScale(direction, 1.0f / mVoxelSize));
+
+	float t = 0.0f;
+	float tEnd = maxDistance;
+	float inverse[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		inverse[k] = d[k] != 0.0f ? 1.0f / d[k] : FLT_MAX;
+		if (d[k] == 0.0f)
+		{
+			if (o[k] < 0.0f || o[k] > (float)mResolution)
+				return false;
+			continue;
+		}
+
+		float t0 = (0.0f - o[k]) * inverse[k];
+		float t1 = ((float)mResolution - o[k]) * inverse[k];
+		t = std::max(t, std::min(t0, t1));
+		tEnd = std::min(tEnd, std::max(t0, t1));
+	}
+
+	if (t > tEnd)
+		return false;
+
+	std::uint32_t voxel[3];
+	for (int k = 0; k < 3; ++k)
+		voxel[k] = (std::uint32_t)std::min(std::max(std::floor(o[k] + t * d[k]), 0.0f), (float)(mResolution - 1));
+
+	for (;;)
+	{
+		std::uint32_t empty = EmptySize(voxel[0], voxel[1], voxel[2]);
+		if (empty == 0)
+		{
+			hit.Distance = t;
+			hit.X = voxel[0];
+			hit.Y = voxel[1];
+			hit.Z = voxel[2];
+			return true;
+		}
+
+		// Leave the empty node through the face the ray reaches first,
+		// into the voxel beyond it.
+		std::uint32_t lo[3];
+		float exit = FLT_MAX;
+		int axis = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			lo[k] = voxel[k] & ~(empty - 1);
+			if (d[k] == 0.0f)
+				continue;
+
+			float boundary = (float)(d[k] > 0.0f ? lo[k] + empty : lo[k]);
+			float tk = (boundary - o[k]) * inverse[k];
+			if (tk < exit)
+			{
+				exit = tk;
+				axis = k;
+			}
+		}
+
+		t = std::max(t, exit);
+		if (t > tEnd)
+			return false;
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (k == axis)
+			{
+				if (d[k] > 0.0f ? lo[k] + empty >= mResolution : lo[k] == 0)
+					return false;
+				voxel[k] = d[k] > 0.0f ? lo[k] + empty : lo[k] - 1;
+			}
+			else
+			{
+				float p = std::floor(o[k] + t * d[k]);
+				voxel[k] = (std::uint32_t)std::min(std::max(p, (float)lo[k]), (float)(lo[k] + empty - 1));
+			}
+		}
+	}
+}
+
+std::uint32_t VoxelOctree::Resolution()const
+{
+	return mResolution;
+}
+
+float VoxelOctree::VoxelSize()const
+{
+	return mVoxelSize;
+}
+
+XMFLOAT3 VoxelOctree::Origin()const
+{
+	return mOrigin;
+}
+
+std::uint64_t VoxelOctree::VoxelCount()const
+{
+	return mVoxelCount;
+}
+
+std::uint32_t VoxelOctree::NodeCount()const
+{
+	return (std::uint32_t)mNodes.size();
+}
+
+std::uint32_t VoxelOctree::BrickCount()const
+{
+	return (std::uint32_t)mBricks.size();
+}
+
+size_t VoxelOctree::SizeInBytes()const
+{
+	return mNodes.size() * sizeof(Node) + mBricks.size() * sizeof(std::uint64_t);
+}
@@ -1,6 +1,6 @@
 #include "d3dApp.h"
 #include <WindowsX.h>
-#include <sstream>
+#include <cstdarg>
 
 namespace
 {
@@ -18,6 +18,24 @@ namespace
 	LONG bitmapHeight;
 	HDC hSplashDC;
 	HDC hMemoryDC;
+
+	// Posted by the render thread when it has a new window caption ready.
+	const UINT WM_APP_CAPTION = WM_APP + 1;
+
+	// Appends to the length characters of text, cutting the new text short
+	// rather than overrunning capacity.
+	void AppendText(wchar_t* text, int capacity, int& length, const wchar_t* format, ...)
+	{
+		if (length >= capacity - 1)
+			return;
+
+		va_list args;
+		va_start(args, format);
+		int written = _vsnwprintf_s(text + length, capacity - length, _TRUNCATE, format, args);
+		va_end(args);
+
+		length = written < 0 ? capacity - 1 : length + written;
+	}
 }
 
 LRESULT CALLBACK
@@ -117,16 +135,32 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 	mMaximized(false),
 	mResizing(false),
 	m4xMsaaQuality(0),
+	mSyncInterval(1),
 
 	md3dDevice(0),
 	md3dDeviceContext(0),
 	mSwapChain(0),
 	mDepthStencilBuffer(0),
 	mRenderTargetView(0),
-	mDepthStencilView(0)
+	mDepthStencilView(0),
+
+	mQuitRequested(false),
+	mMillisecondsPerCount(0.0),
+	mFrameInputTimestamp(0),
+	mInputLatencySum(0.0),
+	mInputLatencyMax(0.0),
+	mInputLatencyCount(0),
+	mNextStatsTicks(0),
+	mStatsFrameMark(0)
 {
+	mPendingCaption[0] = L'\0';
+
 	ZeroMemory(&mScreenViewport, sizeof(D3D11_VIEWPORT));
 
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mMillisecondsPerCount = 1000.0 / (double)countsPerSec;
+
 	// Get a pointer to the application object so we can forward 
 	// Windows messages to the object's window procedure through
 	// the global window procedure.
@@ -135,6 +169,8 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 
 D3DApp::~D3DApp()
 {
+	StopRenderThread();
+
 	mRenderTargetView->Release();
 	mDepthStencilView->Release();
 	mSwapChain->Release();
@@ -163,43 +199,183 @@ float D3DApp::AspectRatio()const
 	return static_cast<float>(mClientWidth) / mClientHeight;
 }
 
+void D3DApp::SetTargetFrameRate(double fps)
+{
+	mFramePacer.SetTargetFrameRate(fps);
+	mSyncInterval = fps > 0.0 ? 0 : 1;
+}
+
 int D3DApp::Run()
 {
 	MSG msg = { 0 };
 
-	mTimer.Reset();
+	// Animation and rendering run on their own thread, so a burst of window
+	// messages cannot delay a frame and a blocking Present cannot delay input
+	// handling.  This thread only waits for messages and forwards what it
+	// receives through mEventQueue.
+	mQuitRequested = false;
+	mRenderThread = std::thread(&D3DApp::RenderThreadMain, this);
 
 	while (msg.message != WM_QUIT)
 	{
-		// If there are Window messages then process them.
 		if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
 		}
-		// Otherwise, do animation/game stuff.
-		else
+
+		// While events wait behind a full queue, look again every
+		// millisecond, message or not.
+		if (mEventQueue.Flush() != 0)
+			mFramePacer.Wake();
+		MsgWaitForMultipleObjectsEx(0, nullptr, mEventQueue.Backlog() != 0 ? 1 : INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+
+	StopRenderThread();
+
+	return (int)msg.wParam;
+}
+
+void D3DApp::RenderThreadMain()
+{
+	PROFILE_THREAD_NAME("Render");
+
+	mTimer.Reset();
+	mNextStatsTicks = mTimer.TicksPerSecond();
+	mStatsFrameMark = mFrameStats.FrameCount();
+
+	while (!mQuitRequested.load(std::memory_order_acquire))
+	{
+		PROFILE_SCOPE("Frame");
+
+		// Paused frames are paced at a low idle rate instead of a fixed
+		// Sleep(100); input still wakes the loop right away.
+		mFramePacer.SetIdle(mAppPaused);
+		{
+			PROFILE_SCOPE("Wait For Next Frame");
+			mFramePacer.WaitForNextFrame();
+		}
+
+		ProcessEvents();
+
+		mTimer.Tick();
+
+		if (!mAppPaused)
 		{
-			mTimer.Tick();
+			CalculateFrameStats();
+			UpdateScene(mTimer.DeltaTime());
+			DrawScene();
+
+			// DrawScene has returned from Present, so any input consumed this
+			// frame is now on its way to the screen.
+			if (mFrameInputTimestamp != 0)
+			{
+				__int64 currTime;
+				QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+
+				double latency = (currTime - mFrameInputTimestamp) * mMillisecondsPerCount;
+				mInputLatencySum += latency;
+				if (latency > mInputLatencyMax)
+					mInputLatencyMax = latency;
+				mInputLatencyCount++;
+			}
+		}
+	}
+}
+
+void D3DApp::ProcessEvents()
+{
+	PROFILE_FUNCTION();
 
-			if (!mAppPaused)
+	AppEventBatch batch = mEventQueue.Drain([this](const AppEvent& e)
+	{
+		switch (e.EventType)
+		{
+		case AppEvent::MouseDown:
+			OnMouseDown(e.Param, e.X, e.Y);
+			break;
+		case AppEvent::MouseUp:
+			OnMouseUp(e.Param, e.X, e.Y);
+			break;
+		case AppEvent::MouseMove:
+			OnMouseMove(e.Param, e.X, e.Y);
+			break;
+		case AppEvent::KeyDown:
+			// F2 dumps frame time statistics for offline analysis, F3 the
+			// profiler's recent scopes, into the Captures directory.
+			if (e.Param == VK_F2)
 			{
-				CalculateFrameStats();
-				UpdateScene(mTimer.DeltaTime());
-				DrawScene();
+				CreateDirectoryA("Captures", nullptr);
+				mFrameStats.WriteJson("Captures/FrameStats.json");
 			}
-			else
+#ifdef ENABLE_PROFILER
+			if (e.Param == VK_F3)
 			{
-				Sleep(100);
+				CreateDirectoryA("Captures", nullptr);
+				Profiler::WriteChromeTrace("Captures/ProfileTrace.json");
 			}
+#endif
+			OnKeyDown(e.Param);
+			break;
+		case AppEvent::Pause:
+			mAppPaused = true;
+			mTimer.Stop();
+			break;
+		case AppEvent::Resume:
+			mAppPaused = false;
+			mTimer.Start();
+			break;
+		default:
+			break;
 		}
+	});
+
+	mFrameInputTimestamp = batch.FirstInput;
+
+	if (batch.Resized)
+	{
+		mClientWidth = batch.Width;
+		mClientHeight = batch.Height;
+		OnResize();
 	}
+}
 
-	return (int)msg.wParam;
+void D3DApp::StopRenderThread()
+{
+	if (mRenderThread.joinable())
+	{
+		mQuitRequested.store(true, std::memory_order_release);
+
+		// An idle render thread may be in a long sleep in the frame pacer.
+		mFramePacer.Wake();
+		mRenderThread.join();
+	}
+}
+
+void D3DApp::PostAppEvent(AppEvent::Type type, WPARAM param, int x, int y)
+{
+	AppEvent e;
+	e.EventType = type;
+	e.Param = param;
+	e.X = x;
+	e.Y = y;
+	QueryPerformanceCounter((LARGE_INTEGER*)&e.Timestamp);
+
+	// Never waits: behind a full queue the event is backlogged, and mouse
+	// moves and resizes there are coalesced.
+	mEventQueue.Post(e);
+
+	// Cut an idle frame's sleep short.  Mouse moves alone are not worth it.
+	if (type != AppEvent::MouseMove)
+		mFramePacer.Wake();
 }
 
 bool D3DApp::Init()
 {
+	PROFILE_THREAD_NAME("Main");
+	PROFILE_FUNCTION();
+
 	if (!InitWindow())
 		return false;
 
@@ -211,6 +387,8 @@ bool D3DApp::Init()
 
 void D3DApp::OnResize()
 {
+	PROFILE_FUNCTION();
+
 	assert(md3dDeviceContext);
 	assert(md3dDevice);
 	assert(mSwapChain);
@@ -288,35 +466,38 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	case WM_ACTIVATE:
 		if (LOWORD(wParam) == WA_INACTIVE)
 		{
-			mAppPaused = true;
-			mTimer.Stop();
+			PostAppEvent(AppEvent::Pause, 0, 0, 0);
 		}
 		else
 		{
-			mAppPaused = false;
-			mTimer.Start();
+			PostAppEvent(AppEvent::Resume, 0, 0, 0);
 		}
 		return 0;
 
 		// WM_SIZE is sent when the user resizes the window.  
 	case WM_SIZE:
-		// Save the new client area dimensions.
-		mClientWidth = LOWORD(lParam);
-		mClientHeight = HIWORD(lParam);
-		if (md3dDevice)
+		// Before the device exists nothing else reads the client area, so
+		// save it directly.  Afterwards the render thread owns it and picks
+		// up the new dimensions from the Resize event.
+		if (!md3dDevice)
+		{
+			mClientWidth = LOWORD(lParam);
+			mClientHeight = HIWORD(lParam);
+		}
+		else
 		{
 			if (wParam == SIZE_MINIMIZED)
 			{
-				mAppPaused = true;
+				PostAppEvent(AppEvent::Pause, 0, 0, 0);
 				mMinimized = true;
 				mMaximized = false;
 			}
 			else if (wParam == SIZE_MAXIMIZED)
 			{
-				mAppPaused = false;
+				PostAppEvent(AppEvent::Resume, 0, 0, 0);
 				mMinimized = false;
 				mMaximized = true;
-				OnResize();
+				PostAppEvent(AppEvent::Resize, 0, LOWORD(lParam), HIWORD(lParam));
 			}
 			else if (wParam == SIZE_RESTORED)
 			{
@@ -324,17 +505,17 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				// Restoring from minimized state?
 				if (mMinimized)
 				{
-					mAppPaused = false;
+					PostAppEvent(AppEvent::Resume, 0, 0, 0);
 					mMinimized = false;
-					OnResize();
+					PostAppEvent(AppEvent::Resize, 0, LOWORD(lParam), HIWORD(lParam));
 				}
 
 				// Restoring from maximized state?
 				else if (mMaximized)
 				{
-					mAppPaused = false;
+					PostAppEvent(AppEvent::Resume, 0, 0, 0);
 					mMaximized = false;
-					OnResize();
+					PostAppEvent(AppEvent::Resize, 0, LOWORD(lParam), HIWORD(lParam));
 				}
 				else if (mResizing)
 				{
@@ -349,7 +530,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				}
 				else // API call such as SetWindowPos or mSwapChain->SetFullscreenState.
 				{
-					OnResize();
+					PostAppEvent(AppEvent::Resize, 0, LOWORD(lParam), HIWORD(lParam));
 				}
 			}
 		}
@@ -357,25 +538,38 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 		// WM_EXITSIZEMOVE is sent when the user grabs the resize bars.
 	case WM_ENTERSIZEMOVE:
-		mAppPaused = true;
+		PostAppEvent(AppEvent::Pause, 0, 0, 0);
 		mResizing = true;
-		mTimer.Stop();
 		return 0;
 
 		// WM_EXITSIZEMOVE is sent when the user releases the resize bars.
 		// Here we reset everything based on the new window dimensions.
 	case WM_EXITSIZEMOVE:
-		mAppPaused = false;
-		mResizing = false;
-		mTimer.Start();
-		OnResize();
+		{
+			RECT clientRect;
+			GetClientRect(hwnd, &clientRect);
+
+			PostAppEvent(AppEvent::Resume, 0, 0, 0);
+			mResizing = false;
+			PostAppEvent(AppEvent::Resize, 0, clientRect.right, clientRect.bottom);
+		}
 		return 0;
 
-		// WM_DESTROY is sent when the window is being destroyed.
+		// WM_DESTROY is sent when the window is being destroyed.  Stop the
+		// render thread first so it never presents to a destroyed window.
 	case WM_DESTROY:
+		StopRenderThread();
 		PostQuitMessage(0);
 		return 0;
 
+		// The render thread has formatted a new caption for us.
+	case WM_APP_CAPTION:
+		{
+			std::lock_guard<std::mutex> lock(mCaptionMutex);
+			SetWindowText(hwnd, mPendingCaption);
+		}
+		return 0;
+
 		// The WM_MENUCHAR message is sent when a menu is active and the user presses 
 		// a key that does not correspond to any mnemonic or accelerator key. 
 	case WM_MENUCHAR:
@@ -388,18 +582,22 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		((MINMAXINFO*)lParam)->ptMinTrackSize.y = 200;
 		return 0;
 
+	// Input is handled on the render thread; see ProcessEvents.
 	case WM_LBUTTONDOWN:
 	case WM_MBUTTONDOWN:
 	case WM_RBUTTONDOWN:
-		OnMouseDown(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		PostAppEvent(AppEvent::MouseDown, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 	case WM_LBUTTONUP:
 	case WM_MBUTTONUP:
 	case WM_RBUTTONUP:
-		OnMouseUp(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		PostAppEvent(AppEvent::MouseUp, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 	case WM_MOUSEMOVE:
-		OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		PostAppEvent(AppEvent::MouseMove, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		return 0;
+	case WM_KEYDOWN:
+		PostAppEvent(AppEvent::KeyDown, wParam, 0, 0);
 		return 0;
 	}
 
@@ -522,6 +720,8 @@ bool D3DApp::InitWindow()
 
 bool D3DApp::InitDirect3D()
 {
+	PROFILE_FUNCTION();
+
 	// Create the device and device context.
 	UINT createDeviceFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG)  
@@ -623,32 +823,63 @@ bool D3DApp::InitDirect3D()
 
 void D3DApp::CalculateFrameStats()
 {
-	// Code computes the average frames per second, and also the 
-	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
+	// Every frame's time goes into mFrameStats; once a second the recent
+	// frames are summarized into the window caption.  Nothing here allocates.
+
+	mFrameStats.AddFrame(mTimer.DeltaTicks() * 1000.0 / mTimer.TicksPerSecond());
+
+	// Count whole seconds on the integer tick clock so the update period
+	// cannot drift the way an accumulated float would.
+	__int64 totalTicks = mTimer.TotalTicks();
+	if (totalTicks < mNextStatsTicks)
+		return;
+
+	mNextStatsTicks += mTimer.TicksPerSecond();
+	if (mNextStatsTicks <= totalTicks)
+		mNextStatsTicks = totalTicks + mTimer.TicksPerSecond();
+
+	std::uint64_t frameCount = mFrameStats.FrameCount();
+	FrameStatsSummary stats = mFrameStats.SummarizeRecent((std::uint32_t)(frameCount - mStatsFrameMark));
+	mStatsFrameMark = frameCount;
+
+	double fps = stats.AvgMs > 0.0 ? 1000.0 / stats.AvgMs : 0.0;
 
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	wchar_t caption[CaptionLength];
+	int length = 0;
+	AppendText(caption, CaptionLength, length, L"%ls    FPS: %.0f    Frame: %.2f / %.2f / %.2f / %.2f / %.2f / %.2f ms (min/avg/p50/p95/p99/max)    Stutters: %u",
+		mMainWndCaption.c_str(), fps,
+		stats.MinMs, stats.AvgMs, stats.P50Ms, stats.P95Ms, stats.P99Ms, stats.MaxMs, stats.StutterCount);
 
-	frameCnt++;
+	if (mInputLatencyCount > 0)
+	{
+		AppendText(caption, CaptionLength, length, L"    Input Latency: %.3f (max %.3f) ms",
+			mInputLatencySum / mInputLatencyCount, mInputLatencyMax);
+
+		mInputLatencySum = 0.0;
+		mInputLatencyMax = 0.0;
+		mInputLatencyCount = 0;
+	}
+
+	if (mFramePacer.TargetFrameRate() > 0.0)
+	{
+		const PacingStats& pacing = mFramePacer.Stats();
+
+		AppendText(caption, CaptionLength, length, L"    Pacing Error: %.3f (max %.3f) ms    Jitter: %.3f ms",
+			pacing.MeanError * 1000.0, pacing.MaxError * 1000.0, pacing.IntervalJitter * 1000.0);
+
+		mFramePacer.ResetStats();
+	}
+
+	if (length < CaptionLength - 1)
+	{
+		int appended = AppendCaptionStats(caption + length, CaptionLength - length);
+		length = appended < 0 ? CaptionLength - 1 : length + appended;
+	}
 
-	// Compute averages over one second period.
-	if ((mTimer.TotalTime() - timeElapsed) >= 1.0f)
+	// We are on the render thread; let the window thread apply it.
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
-		float mspf = 1000.0f / fps;
-
-		std::wostringstream outs;
-		outs.precision(6);
-		/*outs << mMainWndCaption << L"    "
-			<< L"FPS: " << fps << L"    "
-			<< L"Frame Time: " << mspf << L" (ms)";*/
-		outs << mMainWndCaption << L"    "
-			<< L"FPS: " << fps;
-		SetWindowText(mhMainWnd, outs.str().c_str());
-
-		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+		std::lock_guard<std::mutex> lock(mCaptionMutex);
+		wmemcpy(mPendingCaption, caption, length + 1);
 	}
+	PostMessage(mhMainWnd, WM_APP_CAPTION, 0, 0);
 }